@@ -102,6 +102,10 @@ DECLVBGL(int)  VbglR0SfLock(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, SHFLHANDLE h
 
 DECLVBGL(int)  VbglR0SfDirInfo(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, SHFLHANDLE hFile,PSHFLSTRING ParsedPath, uint32_t flags,
                                uint32_t index, uint32_t *pcbBuffer, PSHFLDIRINFO pBuffer, uint32_t *pcFiles);
+DECLVBGL(int)  VbglR0SfDirInfoBatch(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, SHFLHANDLE hFile, uint32_t flags,
+                                    uint32_t *pcbBuffer, PSHFLDIRBATCHENTRY pBuffer, uint32_t *pcEntries, bool *pfEnd);
+DECLVBGL(int)  VbglR0SfQueryInfoBulk(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, uint32_t cPaths, void *pvPaths, uint32_t cbPaths,
+                                     PSHFLINFOBULKRESULT paResults);
 DECLVBGL(int)  VbglR0SfFsInfo(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, SHFLHANDLE hFile, uint32_t flags, uint32_t *pcbBuffer, PSHFLDIRINFO pBuffer);
 
 DECLVBGL(int)  VbglR0SfMapFolder(PVBGLSFCLIENT pClient, PSHFLSTRING szFolderName, PVBGLSFMAP pMap);
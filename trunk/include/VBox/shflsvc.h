@@ -104,6 +104,10 @@
 #define SHFL_FN_SYMLINK             (19)
 /** Ask host to show symlinks (as of VBox 4.0) */
 #define SHFL_FN_SET_SYMLINKS        (20)
+/** List directory entries with their object information in compact batches. */
+#define SHFL_FN_LIST_BATCH          (21)
+/** Query the object information of several paths at once. */
+#define SHFL_FN_QUERY_INFO_BULK     (22)
 
 /** @} */
 
@@ -1189,6 +1193,90 @@ typedef struct _VBoxSFList
 #define SHFL_CPARMS_LIST (8)
 
 
+/**
+ * SHFL_FN_LIST_BATCH
+ */
+
+/**
+ * Directory entry returned by SHFL_FN_LIST_BATCH.
+ *
+ * The entries are stored back to back, each one starting at an 8 byte aligned
+ * offset in the buffer.  Unlike SHFLDIRINFO there is no short name and the
+ * name is not wrapped in a SHFLSTRING, so a buffer holds considerably more
+ * entries.
+ */
+#pragma pack(1)
+typedef struct SHFLDIRBATCHENTRY
+{
+    /** Offset of the next entry relative to this one, 0 for the last entry. */
+    uint32_t        offNext;
+    /** Size of the name in bytes, excluding the terminator. */
+    uint16_t        cbName;
+    /** Reserved, zero. */
+    uint16_t        u16Reserved;
+    /** Information about the object. */
+    SHFLFSOBJINFO   Info;
+    /** The zero terminated name, UTF-8 or UTF-16 depending on whether the
+     *  client called SHFL_FN_SET_UTF8. */
+    union
+    {
+        char        utf8[1];
+        RTUTF16     ucs2[1];
+    } Name;
+} SHFLDIRBATCHENTRY;
+#pragma pack()
+AssertCompileMemberOffset(SHFLDIRBATCHENTRY, Name, 100);
+/** Pointer to a directory entry returned by SHFL_FN_LIST_BATCH. */
+typedef SHFLDIRBATCHENTRY *PSHFLDIRBATCHENTRY;
+
+/** Parameters structure. */
+typedef struct _VBoxSFListBatch
+{
+    VBoxGuestHGCMCallInfo callInfo;
+
+    /** value32, in: SHFLROOT
+     * Root handle of the mapping.
+     */
+    HGCMFunctionParameter root;
+
+    /** value64, in:
+     * SHFLHANDLE of the directory to be listed.  The listing continues where
+     * the previous SHFL_FN_LIST or SHFL_FN_LIST_BATCH call on the handle
+     * stopped.  Handles with a SHFL_FN_LIST search pattern are not supported.
+     */
+    HGCMFunctionParameter handle;
+
+    /** value32, in:
+     * Flags, must be zero.
+     */
+    HGCMFunctionParameter flags;
+
+    /** value32, in/out:
+     * Bytes available in the buffer/How many bytes were used.
+     */
+    HGCMFunctionParameter cb;
+
+    /** pointer, out:
+     * Buffer to place the entries to (SHFLDIRBATCHENTRY).
+     */
+    HGCMFunctionParameter buffer;
+
+    /** value32, out:
+     * Number of entries returned.
+     */
+    HGCMFunctionParameter cEntries;
+
+    /** value32, out:
+     * Non-zero if the end of the directory was reached.
+     */
+    HGCMFunctionParameter fEnd;
+
+} VBoxSFListBatch;
+
+/** Number of parameters */
+#define SHFL_CPARMS_LIST_BATCH (7)
+
+
 
 /**
  * SHFL_FN_READLINK
@@ -1281,6 +1369,70 @@ typedef struct _VBoxSFInformation
 #define SHFL_CPARMS_INFORMATION (5)
 
 
+/**
+ * SHFL_FN_QUERY_INFO_BULK
+ */
+
+/** Maximum number of paths in one SHFL_FN_QUERY_INFO_BULK call. */
+#define SHFL_QUERY_INFO_BULK_MAX_PATHS  (1024)
+
+/**
+ * Result for one path of SHFL_FN_QUERY_INFO_BULK.
+ */
+#pragma pack(1)
+typedef struct SHFLINFOBULKRESULT
+{
+    /** IPRT status code of the query.  A path which does not exist is not
+     *  an error, see Result. */
+    int32_t         rc;
+    /** SHFL_FILE_EXISTS, SHFL_FILE_NOT_FOUND or SHFL_PATH_NOT_FOUND, like
+     *  SHFL_FN_CREATE with SHFL_CF_LOOKUP returns. */
+    SHFLCREATERESULT Result;
+    /** Information about the object if it exists. */
+    SHFLFSOBJINFO   Info;
+} SHFLINFOBULKRESULT;
+#pragma pack()
+AssertCompileSize(SHFLINFOBULKRESULT, 100);
+/** Pointer to a SHFL_FN_QUERY_INFO_BULK result. */
+typedef SHFLINFOBULKRESULT *PSHFLINFOBULKRESULT;
+
+/** Parameters structure. */
+typedef struct _VBoxSFQueryInfoBulk
+{
+    VBoxGuestHGCMCallInfo callInfo;
+
+    /** value32, in: SHFLROOT
+     * Root handle of the mapping.
+     */
+    HGCMFunctionParameter root;
+
+    /** value32, in:
+     * Flags, must be zero.
+     */
+    HGCMFunctionParameter flags;
+
+    /** value32, in:
+     * Number of paths, at most SHFL_QUERY_INFO_BULK_MAX_PATHS.
+     */
+    HGCMFunctionParameter cPaths;
+
+    /** pointer, in:
+     * The paths, SHFLSTRING structures stored back to back, each one starting
+     * at a 4 byte aligned offset.
+     */
+    HGCMFunctionParameter paths;
+
+    /** pointer, out:
+     * Array of cPaths SHFLINFOBULKRESULT structures.
+     */
+    HGCMFunctionParameter results;
+
+} VBoxSFQueryInfoBulk;
+
+/** Number of parameters */
+#define SHFL_CPARMS_QUERY_INFO_BULK (5)
+
+
 /**
  * SHFL_FN_REMOVE
  */
@@ -164,9 +164,38 @@ typedef struct PDMINETWORKDOWN
      */
     DECLR3CALLBACKMEMBER(void, pfnXmitPending,(PPDMINETWORKDOWN pInterface));
 
+    /**
+     * Begins a receive batch.
+     *
+     * Until the matching pfnEndReceiveBatch call the device may defer making
+     * the frames passed to pfnReceive and pfnReceiveGso visible to the guest
+     * (updating the used ring / raising the receive interrupt), so that a
+     * burst of frames only costs a single guest notification.
+     *
+     * The caller must end the batch before blocking in pfnWaitReceiveAvail,
+     * otherwise the guest may never see the frames and hand back buffers.
+     *
+     * Optional, NULL if not implemented.
+     *
+     * @param   pInterface      Pointer to this interface.
+     * @thread  Non-EMT.
+     */
+    DECLR3CALLBACKMEMBER(void, pfnBeginReceiveBatch,(PPDMINETWORKDOWN pInterface));
+
+    /**
+     * Ends a receive batch started by pfnBeginReceiveBatch, making all frames
+     * received since then visible to the guest and notifying it.
+     *
+     * Optional, NULL if not implemented.
+     *
+     * @param   pInterface      Pointer to this interface.
+     * @thread  Non-EMT.
+     */
+    DECLR3CALLBACKMEMBER(void, pfnEndReceiveBatch,(PPDMINETWORKDOWN pInterface));
+
 } PDMINETWORKDOWN;
 /** PDMINETWORKDOWN interface ID. */
-#define PDMINETWORKDOWN_IID                     "52b8cdbb-a087-493b-baa7-81ec3b803e06"
+#define PDMINETWORKDOWN_IID                     "2f4b7a0c-93e5-4c1d-8a6b-5e0d7c2f1b94"
 
 
 /**
@@ -41,6 +41,9 @@
 
 #define PDM_NETSHAPER_MIN_BUCKET_SIZE UINT32_C(65536) /**< bytes */
 #define PDM_NETSHAPER_MAX_LATENCY     UINT32_C(100)   /**< milliseconds */
+/** The fraction of the bucket a filter takes from its bandwidth group in one
+ * go and caches for the following transfers. */
+#define PDM_NETSHAPER_FILTER_CACHE_DIV UINT32_C(16)
 
 RT_C_DECLS_BEGIN
 
@@ -55,7 +58,10 @@ typedef struct PDMNSFILTER
     /** Set when the filter fails to obtain bandwidth. */
     bool                                fChoked;
     /** Aligment padding. */
-    bool                                afPadding[HC_ARCH_BITS == 32 ? 3 : 7];
+    bool                                afPadding[3];
+    /** Number of bytes taken from the bandwidth group (hierarchy) in advance
+     * which this filter may transfer without consulting the group. */
+    volatile uint32_t                   cbTokensCached;
     /** The driver this filter is aggregated into (ring-3). */
     R3PTRTYPE(PPDMINETWORKDOWN)         pIDrvNetR3;
 } PDMNSFILTER;
@@ -578,6 +578,64 @@ RTDECL(int) RTFileCopyEx(const char *pszSrc, const char *pszDst, uint32_t fFlags
  */
 RTDECL(int) RTFileCopyByHandlesEx(RTFILE FileSrc, RTFILE FileDst, PFNRTPROGRESS pfnProgress, void *pvUser);
 
+/**
+ * Copies a part of a file from one file handle to another without passing
+ * the data thru user space, where the host supports it.
+ *
+ * The file positions are not used nor changed.  Depending on the host and the
+ * file systems involved, the data may end up shared between the files
+ * (server side copy, reflink) rather than physically duplicated.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NOT_SUPPORTED if the host or the combination of file systems
+ *          does not support this.  The caller should read and write instead.
+ *
+ * @param   hFileSrc    The source file.
+ * @param   offSrc      The source offset.
+ * @param   hFileDst    The destination file.
+ * @param   offDst      The destination offset.
+ * @param   cbToCopy    The number of bytes to copy.
+ * @param   fFlags      Reserved, MBZ.
+ * @param   pcbCopied   Where to return the number of bytes copied.  This may
+ *                      be less than requested, zero if the end of the source
+ *                      file was reached.
+ */
+RTDECL(int) RTFileCopyPart(RTFILE hFileSrc, RTFOFF offSrc, RTFILE hFileDst, RTFOFF offDst, uint64_t cbToCopy,
+                           uint32_t fFlags, uint64_t *pcbCopied);
+
+/**
+ * Makes the destination file a copy of the source file by sharing all its
+ * blocks (reflink / clone), where the host and file system support it.
+ *
+ * The destination file content and size are replaced.  This is close to
+ * instant regardless of the file size.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NOT_SUPPORTED if not supported by the host or the file
+ *          systems (e.g. the files are on different file systems).
+ *
+ * @param   hFileSrc    The source file.
+ * @param   hFileDst    The destination file.
+ */
+RTDECL(int) RTFileClone(RTFILE hFileSrc, RTFILE hFileDst);
+
+/**
+ * Finds the next range of data (as opposed to holes) in a sparse file.
+ *
+ * The file position is undefined on return.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_EOF if there is no data at or after @a off.
+ * @retval  VERR_NOT_SUPPORTED if the host or file system cannot tell.  The
+ *          caller should treat the whole file as data.
+ *
+ * @param   hFile       The file handle.
+ * @param   off         Where to start looking.
+ * @param   poffData    Where to return the start of the data range.
+ * @param   pcbData     Where to return the size of the data range.
+ */
+RTDECL(int) RTFileQueryDataRange(RTFILE hFile, uint64_t off, uint64_t *poffData, uint64_t *pcbData);
+
 
 /**
  * Compares two file given the paths to both files.
@@ -1278,10 +1336,20 @@ typedef struct RTFILEAIOLIMITS
     /** The alignment data buffers need to have.
      * 0 means no alignment restrictions. */
     uint32_t cbBufferAlignment;
+    /** Combination of RTFILEAIOLIMITS_F_*. */
+    uint32_t fFlags;
 } RTFILEAIOLIMITS;
 /** A pointer to a AIO limits structure. */
 typedef RTFILEAIOLIMITS *PRTFILEAIOLIMITS;
 
+/** @name RTFILEAIOLIMITS_F_XXX - Async I/O capability flags.
+ * @{ */
+/** Requests are processed asynchronously for files opened without
+ * RTFILE_O_NO_CACHE too.  Without it such files may only be used with the
+ * async I/O API on hosts where that is known to work (not Linux). */
+#define RTFILEAIOLIMITS_F_BUFFERED_IO                    RT_BIT_32(0)
+/** @} */
+
 /**
  * Returns the global limits for the AIO API.
  *
@@ -1424,8 +1492,14 @@ RTDECL(int) RTFileAioCtxCreate(PRTFILEAIOCTX phAioCtx, uint32_t cAioReqsMax,
  * even when there is none waiting currently, instead of returning
  * VERR_FILE_AIO_NO_REQUEST. */
 #define RTFILEAIOCTX_FLAGS_WAIT_WITHOUT_PENDING_REQUESTS RT_BIT_32(0)
+/** Hint that submitted requests should be picked up by a host thread polling
+ * for them instead of the submitter having to notify the host every time
+ * (Linux io_uring with SQPOLL).  This trades CPU time for lower submission
+ * latency and is ignored where not supported. */
+#define RTFILEAIOCTX_FLAGS_POLL_SUBMISSIONS              RT_BIT_32(1)
 /** mask of valid flags. */
-#define RTFILEAIOCTX_FLAGS_VALID_MASK (RTFILEAIOCTX_FLAGS_WAIT_WITHOUT_PENDING_REQUESTS)
+#define RTFILEAIOCTX_FLAGS_VALID_MASK (  RTFILEAIOCTX_FLAGS_WAIT_WITHOUT_PENDING_REQUESTS \
+                                       | RTFILEAIOCTX_FLAGS_POLL_SUBMISSIONS)
 
 /**
  * Destroys an async I/O context.
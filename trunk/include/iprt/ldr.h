@@ -1013,6 +1013,9 @@ typedef enum RTLDRPROP
     RTLDRPROP_IMPORT_COUNT,
     /** Import module by index (32-bit) stored in the buffer. */
     RTLDRPROP_IMPORT_MODULE,
+    /** The build ID (ELF: NT_GNU_BUILD_ID note).
+     * Returns a variable sized byte string, typically 20 bytes (SHA-1). */
+    RTLDRPROP_BUILDID,
 
     /** End of valid properties.  */
     RTLDRPROP_END,
@@ -357,6 +357,9 @@ typedef enum RTLOGFLAGS
     RTLOGFLAGS_FLUSH                = 0x00000200,
     /** Restrict the number of log entries per group. */
     RTLOGFLAGS_RESTRICT_GROUPS      = 0x00000400,
+    /** Defer formatting and writing to a background thread (ring-3 only).
+     * See RTLogSetDeferred for details. */
+    RTLOGFLAGS_DEFERRED             = 0x00000800,
     /** New lines should be prefixed with the write and read lock counts. */
     RTLOGFLAGS_PREFIX_LOCK_COUNTS   = 0x00008000,
     /** New lines should be prefixed with the CPU id (ApicID on intel/amd). */
@@ -2217,6 +2220,49 @@ RTDECL(bool) RTLogSetBuffering(PRTLOGGER pLogger, bool fBuffered);
  */
 RTDECL(uint32_t) RTLogSetGroupLimit(PRTLOGGER pLogger, uint32_t cMaxEntriesPerGroup);
 
+/**
+ * What a thread should do when its deferred log buffer is full.
+ */
+typedef enum RTLOGDEFERREDOVERFLOW
+{
+    /** Invalid zero value. */
+    RTLOGDEFERREDOVERFLOW_INVALID = 0,
+    /** Drop the message and report the number of dropped messages later. */
+    RTLOGDEFERREDOVERFLOW_DROP,
+    /** Wait for the flusher thread to make room. */
+    RTLOGDEFERREDOVERFLOW_WAIT,
+    /** End of valid values. */
+    RTLOGDEFERREDOVERFLOW_END,
+    /** Make sure the type is 32-bit. */
+    RTLOGDEFERREDOVERFLOW_32BIT_HACK = 0x7fffffff
+} RTLOGDEFERREDOVERFLOW;
+
+/**
+ * Configures deferred logging for a ring-3 logger.
+ *
+ * In deferred mode the logging thread does not take the logger lock and does
+ * not format the message.  It copies the format string and the raw arguments
+ * (string arguments are copied too) into a lock-free per-thread ring buffer
+ * together with a TSC timestamp.  A background thread merges the per-thread
+ * buffers in timestamp order, formats the messages and writes them to the
+ * log destinations.  RTLogFlush drains the buffers synchronously.
+ *
+ * Messages whose format string uses types that cannot be captured by value
+ * (e.g. %Rhxd, %ls, %RTuuid or custom %R[] types) are formatted and written
+ * synchronously as usual, after draining the deferred messages.
+ *
+ * The mode can also be enabled with defaults using the "deferred" flag.
+ *
+ * @returns IPRT status code.
+ * @param   pLogger         The logger instance (NULL is an alias for the
+ *                          default logger).
+ * @param   fEnable         Whether to enable or disable deferred logging.
+ * @param   cbPerThread     The size of each per-thread buffer, 0 for the
+ *                          default (256KB).  Rounded up to a power of two.
+ * @param   enmOverflow     What to do when a per-thread buffer is full.
+ */
+RTDECL(int) RTLogSetDeferred(PRTLOGGER pLogger, bool fEnable, uint32_t cbPerThread, RTLOGDEFERREDOVERFLOW enmOverflow);
+
 #ifndef IN_RC
 /**
  * Get the current log flags as a string.
@@ -849,6 +849,7 @@
 # define RTFileAioReqPrepareRead                        RT_MANGLER(RTFileAioReqPrepareRead)
 # define RTFileAioReqPrepareWrite                       RT_MANGLER(RTFileAioReqPrepareWrite)
 # define RTFileChangeLock                               RT_MANGLER(RTFileChangeLock)
+# define RTFileClone                                    RT_MANGLER(RTFileClone)
 # define RTFileClose                                    RT_MANGLER(RTFileClose)
 # define RTFileCompare                                  RT_MANGLER(RTFileCompare)
 # define RTFileCompareByHandles                         RT_MANGLER(RTFileCompareByHandles)
@@ -858,6 +859,7 @@
 # define RTFileCopyByHandles                            RT_MANGLER(RTFileCopyByHandles)
 # define RTFileCopyByHandlesEx                          RT_MANGLER(RTFileCopyByHandlesEx)
 # define RTFileCopyEx                                   RT_MANGLER(RTFileCopyEx)
+# define RTFileCopyPart                                 RT_MANGLER(RTFileCopyPart)
 # define RTFileCreateTemp                               RT_MANGLER(RTFileCreateTemp)
 # define RTFileCreateTempSecure                         RT_MANGLER(RTFileCreateTempSecure)
 # define RTFileDelete                                   RT_MANGLER(RTFileDelete)
@@ -878,6 +880,7 @@
 # define RTFileOpenF                                    RT_MANGLER(RTFileOpenF)
 # define RTFileOpenV                                    RT_MANGLER(RTFileOpenV)
 # define RTFileOpenTemp                                 RT_MANGLER(RTFileOpenTemp)
+# define RTFileQueryDataRange                           RT_MANGLER(RTFileQueryDataRange)
 # define RTFileQueryFsSizes                             RT_MANGLER(RTFileQueryFsSizes)
 # define RTFileQueryInfo                                RT_MANGLER(RTFileQueryInfo)
 # define RTFileQuerySize                                RT_MANGLER(RTFileQuerySize)
@@ -1170,6 +1173,7 @@
 # define RTLogSetCustomPrefixCallbackForR0              RT_MANGLER(RTLogSetCustomPrefixCallbackForR0)
 # define RTLogSetDefaultInstance                        RT_MANGLER(RTLogSetDefaultInstance)
 # define RTLogSetDefaultInstanceThread                  RT_MANGLER(RTLogSetDefaultInstanceThread) /* r0drv */
+# define RTLogSetDeferred                               RT_MANGLER(RTLogSetDeferred)
 # define RTLogSetGroupLimit                             RT_MANGLER(RTLogSetGroupLimit)
 # define RTLogWriteCom                                  RT_MANGLER(RTLogWriteCom)
 # define RTLogWriteCom                                  RT_MANGLER(RTLogWriteCom)
@@ -1224,6 +1228,7 @@
 # define RTMemCacheCreate                               RT_MANGLER(RTMemCacheCreate)
 # define RTMemCacheDestroy                              RT_MANGLER(RTMemCacheDestroy)
 # define RTMemCacheFree                                 RT_MANGLER(RTMemCacheFree)
+# define RTMemCacheQueryStats                           RT_MANGLER(RTMemCacheQueryStats)
 # define RTMemContAlloc                                 RT_MANGLER(RTMemContAlloc) /* r0drv */
 # define RTMemContFree                                  RT_MANGLER(RTMemContFree) /* r0drv */
 # define RTMemDump                                      RT_MANGLER(RTMemDump)
@@ -1563,6 +1568,7 @@
 # define RTReqPoolCallNoWait                            RT_MANGLER(RTReqPoolCallNoWait)
 # define RTReqPoolCallVoidWait                          RT_MANGLER(RTReqPoolCallVoidWait)
 # define RTReqPoolCallVoidNoWait                        RT_MANGLER(RTReqPoolCallVoidNoWait)
+# define RTReqPoolCallVoidNoWaitBatch                   RT_MANGLER(RTReqPoolCallVoidNoWaitBatch)
 # define RTReqPoolCreate                                RT_MANGLER(RTReqPoolCreate)
 # define RTReqPoolGetCfgVar                             RT_MANGLER(RTReqPoolGetCfgVar)
 # define RTReqPoolGetStat                               RT_MANGLER(RTReqPoolGetStat)
@@ -1766,9 +1772,16 @@
 # define RTSocketWriteNB                                RT_MANGLER(RTSocketWriteNB)
 # define RTSocketWriteTo                                RT_MANGLER(RTSocketWriteTo)
 # define RTSocketWriteToNB                              RT_MANGLER(RTSocketWriteToNB)
+# define RTSort                                         RT_MANGLER(RTSort)
+# define RTSortApv                                      RT_MANGLER(RTSortApv)
 # define RTSortApvIsSorted                              RT_MANGLER(RTSortApvIsSorted)
+# define RTSortApvMerge                                 RT_MANGLER(RTSortApvMerge)
 # define RTSortApvShell                                 RT_MANGLER(RTSortApvShell)
 # define RTSortIsSorted                                 RT_MANGLER(RTSortIsSorted)
+# define RTSortMerge                                    RT_MANGLER(RTSortMerge)
+# define RTSortParallel                                 RT_MANGLER(RTSortParallel)
+# define RTSortRadixU32                                 RT_MANGLER(RTSortRadixU32)
+# define RTSortRadixU64                                 RT_MANGLER(RTSortRadixU64)
 # define RTSortShell                                    RT_MANGLER(RTSortShell)
 # define RTSpinlockAcquire                              RT_MANGLER(RTSpinlockAcquire)
 # define RTSpinlockAcquireNoInts                        RT_MANGLER(RTSpinlockAcquireNoInts)
@@ -149,6 +149,56 @@ RTDECL(int)     RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj);
  */
 RTDECL(void)    RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj);
 
+/**
+ * Memory cache statistics, see RTMemCacheQueryStats.
+ */
+typedef struct RTMEMCACHESTATS
+{
+    /** The (aligned) object size. */
+    uint32_t        cbObject;
+    /** The number of pages backing the cache. */
+    uint32_t        cPages;
+    /** The total number of objects in the pages. */
+    uint32_t        cTotal;
+    /** The number of free objects in the pages.  This excludes the objects
+     * parked in magazines. */
+    uint32_t        cFree;
+    /** The number of free objects parked in magazines. */
+    uint32_t        cMagazineObjs;
+    /** The number of magazine slots. */
+    uint32_t        cSlots;
+    /** Allocations served by the magazines. */
+    uint64_t        cAllocHits;
+    /** Frees served by the magazines. */
+    uint64_t        cFreeHits;
+    /** Magazine exchanges with the depot. */
+    uint64_t        cDepotExchanges;
+    /** Bulk refills of magazines from the pages. */
+    uint64_t        cRefills;
+    /** Full magazines flushed back to the pages. */
+    uint64_t        cFlushes;
+    /** Number of times the magazines were bypassed because the slot was
+     * busy. */
+    uint64_t        cSlotBusy;
+    /** Number of times the magazines were reclaimed because the cache hit its
+     * max size. */
+    uint64_t        cReclaims;
+} RTMEMCACHESTATS;
+/** Pointer to memory cache statistics. */
+typedef RTMEMCACHESTATS *PRTMEMCACHESTATS;
+
+/**
+ * Queries the statistics of a cache.
+ *
+ * The values are gathered without stopping other threads, so they are only a
+ * snapshot.
+ *
+ * @returns IPRT status code.
+ * @param   hMemCache           The cache handle.
+ * @param   pStats              Where to return the statistics.
+ */
+RTDECL(int)     RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats);
+
 /** @} */
 
 RT_C_DECLS_END
@@ -352,6 +352,21 @@ typedef enum RTREQPOOLCFGVAR
     RTREQPOOLCFGVAR_PUSH_BACK_MAX_MS,
     /** The maximum number of free requests to keep handy for recycling. */
     RTREQPOOLCFGVAR_MAX_FREE_REQUESTS,
+    /** The number of worker threads to use in work stealing mode.  Zero, the
+     * default, selects the classic mode with a single request queue and a
+     * dynamic number of workers.  UINT64_MAX means one worker per online CPU,
+     * capped by RTREQPOOLCFGVAR_MAX_THREADS.
+     *
+     * In work stealing mode each worker has its own request queue, submitting
+     * is lock free, and idle workers steal requests from busy ones.  The
+     * workers are started when the first request is submitted and stay around
+     * until the pool is destroyed; push back doesn't apply.  This can only be
+     * changed before the first request is submitted. */
+    RTREQPOOLCFGVAR_WORK_STEALING_THREADS,
+    /** Whether to bind each worker thread to a CPU (non-zero) or not (zero,
+     * default).  The workers are spread round robin over the online CPUs.
+     * Only affects workers started after the change. */
+    RTREQPOOLCFGVAR_CPU_AFFINITY,
     /** The end of the range of valid config variables. */
     RTREQPOOLCFGVAR_END,
     /** Blow the type up to 32-bits. */
@@ -537,6 +552,25 @@ RTDECL(int) RTReqPoolCallVoidWait(RTREQPOOL hPool, PFNRT pfnFunction, unsigned c
  */
 RTDECL(int) RTReqPoolCallVoidNoWait(RTREQPOOL hPool, PFNRT pfnFunction, unsigned cArgs, ...);
 
+/**
+ * Call a void function on worker threads once for each element in an argument
+ * array, don't wait for them to return.
+ *
+ * This is the batch version of RTReqPoolCallVoidNoWait for functions taking a
+ * single argument.  All the requests are allocated up front and then queued in
+ * one go, which is a lot cheaper than submitting them one by one.
+ *
+ * @returns IPRT status code.  On failure none of the calls were made.
+ * @param   hPool           The request thread pool handle.
+ * @param   pfnFunction     The function to be called.  Must be declared by a
+ *                          DECL macro because of calling conventions.  Takes
+ *                          one pointer sized argument; the return value is
+ *                          ignored.
+ * @param   cCalls          The number of calls to make.
+ * @param   pauArgs         Array of @a cCalls arguments, one for each call.
+ */
+RTDECL(int) RTReqPoolCallVoidNoWaitBatch(RTREQPOOL hPool, PFNRT pfnFunction, uint32_t cCalls, uintptr_t const *pauArgs);
+
 
 /**
  * Retainsa reference to a request.
@@ -34,6 +34,9 @@
 
 RT_C_DECLS_BEGIN
 
+/** The request pool handle (RTREQPOOL), see iprt/req.h. */
+struct RTREQPOOLINT;
+
 /**
  * Callback for comparing two array elements.
  *
@@ -96,6 +99,109 @@ RTDECL(void) RTSortShell(void *pvArray, size_t cElements, size_t cbElement, PFNR
  */
 RTDECL(void) RTSortApvShell(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
 
+/**
+ * Sorts an array of variable sized elementes.
+ *
+ * This is an introspective quick sort: median of three (ninther for larger
+ * partitions) quick sort, insertion sort for the small partitions, and a heap
+ * sort fallback should the recursion get too deep.  It is O(n log n) in the
+ * worst case, does not allocate memory and is not stable.  Prefer this over
+ * RTSortShell for anything but tiny arrays.
+ *
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(void) RTSort(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSort but speciallized for an array containing element pointers.
+ *
+ * @param   papvArray       The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(void) RTSortApv(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Stable merge sort of an array of variable sized elementes.
+ *
+ * Elements comparing equal keep their relative order.  Needs a temporary
+ * buffer the size of the array.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NO_MEMORY if the temporary buffer couldn't be allocated, the
+ *          array is unchanged.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortMerge(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Same as RTSortMerge but speciallized for an array containing element
+ * pointers.
+ *
+ * @returns IPRT status code.
+ * @param   papvArray       The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   pfnCmp          Callback function comparing two elements.
+ * @param   pvUser          User argument for the callback.
+ */
+RTDECL(int) RTSortApvMerge(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser);
+
+/**
+ * Stable LSD radix sort of an array of elements with an unsigned 32-bit key.
+ *
+ * No compare callback is involved, the elements are ordered by the numerical
+ * value of the key.  Needs a temporary buffer the size of the array.
+ *
+ * @returns IPRT status code.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   offKey          The offset of the uint32_t key into the element.
+ *                          Need not be aligned.
+ */
+RTDECL(int) RTSortRadixU32(void *pvArray, size_t cElements, size_t cbElement, size_t offKey);
+
+/**
+ * Same as RTSortRadixU32 but for an unsigned 64-bit key.
+ *
+ * @returns IPRT status code.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   offKey          The offset of the uint64_t key into the element.
+ *                          Need not be aligned.
+ */
+RTDECL(int) RTSortRadixU64(void *pvArray, size_t cElements, size_t cbElement, size_t offKey);
+
+/**
+ * Stable merge sort spreading the work over a request thread pool.
+ *
+ * The array is split into one chunk per online CPU, the chunks are sorted
+ * concurrently and then merged pairwise, also concurrently.  Small arrays
+ * are handled by RTSortMerge on the calling thread.
+ *
+ * @returns IPRT status code.
+ * @param   pvArray         The array to sort.
+ * @param   cElements       The number of elements in the array.
+ * @param   cbElement       The size of an array element.
+ * @param   pfnCmp          Callback function comparing two elements.  This
+ *                          will be called concurrently from several threads.
+ * @param   pvUser          User argument for the callback.
+ * @param   hPool           The request pool to use.  NIL_RTREQPOOL to use a
+ *                          private pool for the duration of the call.
+ */
+RTDECL(int) RTSortParallel(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser,
+                           struct RTREQPOOLINT *hPool);
+
 /**
  * Checks if an array of variable sized elementes is sorted.
  *
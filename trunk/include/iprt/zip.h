@@ -87,6 +87,10 @@ typedef enum RTZIPTYPE
     RTZIPTYPE_LZO,
     /* Zlib compression the data without zlib header. */
     RTZIPTYPE_ZLIB_NO_HEADER,
+    /** Zstandard compression. */
+    RTZIPTYPE_ZSTD,
+    /** LZ4 compression (frame format when streaming). */
+    RTZIPTYPE_LZ4,
     /** End of valid the valid compression types.  */
     RTZIPTYPE_END
 } RTZIPTYPE;
@@ -606,6 +606,74 @@ DECLVBGL(int) VbglR0SfDirInfo(
     return rc;
 }
 
+DECLVBGL(int) VbglR0SfDirInfoBatch(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, SHFLHANDLE hFile, uint32_t flags,
+                                   uint32_t *pcbBuffer, PSHFLDIRBATCHENTRY pBuffer, uint32_t *pcEntries, bool *pfEnd)
+{
+    int rc;
+    VBoxSFListBatch data;
+
+    VBOX_INIT_CALL(&data.callInfo, LIST_BATCH, pClient);
+
+    data.root.type                      = VMMDevHGCMParmType_32bit;
+    data.root.u.value32                 = pMap->root;
+
+    data.handle.type                    = VMMDevHGCMParmType_64bit;
+    data.handle.u.value64               = hFile;
+    data.flags.type                     = VMMDevHGCMParmType_32bit;
+    data.flags.u.value32                = flags;
+    data.cb.type                        = VMMDevHGCMParmType_32bit;
+    data.cb.u.value32                   = *pcbBuffer;
+
+    data.buffer.type                    = VMMDevHGCMParmType_LinAddr_Out;
+    data.buffer.u.Pointer.size          = *pcbBuffer;
+    data.buffer.u.Pointer.u.linearAddr  = (uintptr_t)pBuffer;
+
+    data.cEntries.type                  = VMMDevHGCMParmType_32bit;
+    data.cEntries.u.value32             = 0; /* out parameters only */
+    data.fEnd.type                      = VMMDevHGCMParmType_32bit;
+    data.fEnd.u.value32                 = 0;
+
+    rc = VbglHGCMCall(pClient->handle, &data.callInfo, sizeof(data));
+/*    Log(("VBOXSF: VbglR0SfDirInfoBatch: rc = %#x, result = %#x\n", rc, data.callInfo.result)); */
+    if (RT_SUCCESS(rc))
+        rc = data.callInfo.result;
+    *pcbBuffer = data.cb.u.value32;
+    *pcEntries = data.cEntries.u.value32;
+    *pfEnd     = data.fEnd.u.value32 != 0;
+    return rc;
+}
+
+DECLVBGL(int) VbglR0SfQueryInfoBulk(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, uint32_t cPaths, void *pvPaths, uint32_t cbPaths,
+                                    PSHFLINFOBULKRESULT paResults)
+{
+    int rc;
+    VBoxSFQueryInfoBulk data;
+
+    VBOX_INIT_CALL(&data.callInfo, QUERY_INFO_BULK, pClient);
+
+    data.root.type                      = VMMDevHGCMParmType_32bit;
+    data.root.u.value32                 = pMap->root;
+
+    data.flags.type                     = VMMDevHGCMParmType_32bit;
+    data.flags.u.value32                = 0;
+    data.cPaths.type                    = VMMDevHGCMParmType_32bit;
+    data.cPaths.u.value32               = cPaths;
+
+    data.paths.type                     = VMMDevHGCMParmType_LinAddr_In;
+    data.paths.u.Pointer.size           = cbPaths;
+    data.paths.u.Pointer.u.linearAddr   = (uintptr_t)pvPaths;
+
+    data.results.type                   = VMMDevHGCMParmType_LinAddr_Out;
+    data.results.u.Pointer.size         = cPaths * sizeof(SHFLINFOBULKRESULT);
+    data.results.u.Pointer.u.linearAddr = (uintptr_t)paResults;
+
+    rc = VbglHGCMCall(pClient->handle, &data.callInfo, sizeof(data));
+/*    Log(("VBOXSF: VbglR0SfQueryInfoBulk: rc = %#x, result = %#x\n", rc, data.callInfo.result)); */
+    if (RT_SUCCESS(rc))
+        rc = data.callInfo.result;
+    return rc;
+}
+
 DECLVBGL(int) VbglR0SfFsInfo(PVBGLSFCLIENT pClient, PVBGLSFMAP pMap, SHFLHANDLE hFile,
                              uint32_t flags, uint32_t *pcbBuffer, PSHFLDIRINFO pBuffer)
 {
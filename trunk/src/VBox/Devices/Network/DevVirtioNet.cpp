@@ -179,6 +179,11 @@ typedef struct VNetState_st
     bool                    fPromiscuous;
     /** AllMulti mode -- RX filter accepts all multicast packets. */
     bool                    fAllMulti;
+    /** RX: Set while the attached driver has a receive batch open, the used
+     * index update and guest notification is then deferred until it ends. */
+    bool                    fRxBatch;
+    /** RX: Set if packets were stored during the current batch. */
+    bool                    fRxSyncPending;
     /** The number of actually used slots in aMacTable. */
     uint32_t                nMacFilterEntries;
     /** Array of MAC addresses accepted by RX filter. */
@@ -473,6 +478,7 @@ static DECLCALLBACK(int) vnetIoCb_Reset(void *pvState)
         return rc;
     }
     vpciReset(&pThis->VPCI);
+    pThis->fRxSyncPending = false;
     vnetCsRxLeave(pThis);
 
     /// @todo Implement reset
@@ -669,6 +675,22 @@ static int vnetCanReceive(PVNETSTATE pThis)
     return rc;
 }
 
+/**
+ * Makes the packets stored during a receive batch visible to the guest.
+ *
+ * @param   pThis           The device state structure.
+ * @thread  RX
+ */
+static void vnetRxBatchSync(PVNETSTATE pThis)
+{
+    if (pThis->fRxSyncPending)
+    {
+        pThis->fRxSyncPending = false;
+        if (vqueueIsReady(&pThis->VPCI, pThis->pRxQueue))
+            vqueueSync(&pThis->VPCI, pThis->pRxQueue);
+    }
+}
+
 /**
  * @interface_method_impl{PDMINETWORKDOWN,pfnWaitReceiveAvail}
  */
@@ -683,6 +705,17 @@ static DECLCALLBACK(int) vnetNetworkDown_WaitReceiveAvail(PPDMINETWORKDOWN pInte
     if (RT_UNLIKELY(cMillies == 0))
         return VERR_NET_NO_BUFFER_SPACE;
 
+    /* Never block with packets the guest hasn't been told about. */
+    if (pThis->fRxSyncPending)
+    {
+        rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+        if (RT_SUCCESS(rc))
+        {
+            vnetRxBatchSync(pThis);
+            vnetCsRxLeave(pThis);
+        }
+    }
+
     rc = VERR_INTERRUPTED;
     ASMAtomicXchgBool(&pThis->fMaybeOutOfSpace, true);
     STAM_PROFILE_START(&pThis->StatRxOverflow, a);
@@ -915,7 +948,10 @@ static int vnetHandleRxPacket(PVNETSTATE pThis, const void *pvBuf, size_t cb,
             return rc;
         }
     }
-    vqueueSync(&pThis->VPCI, pThis->pRxQueue);
+    if (pThis->fRxBatch)
+        pThis->fRxSyncPending = true;
+    else
+        vqueueSync(&pThis->VPCI, pThis->pRxQueue);
     if (uOffset < cb)
     {
         Log(("%s vnetHandleRxPacket: Packet did not fit into RX queue (packet size=%u)!\n", INSTANCE(pThis), cb));
@@ -998,6 +1034,33 @@ static DECLCALLBACK(int) vnetNetworkDown_Receive(PPDMINETWORKDOWN pInterface, co
     return vnetNetworkDown_ReceiveGso(pInterface, pvBuf, cb, NULL);
 }
 
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnBeginReceiveBatch}
+ */
+static DECLCALLBACK(void) vnetNetworkDown_BeginReceiveBatch(PPDMINETWORKDOWN pInterface)
+{
+    PVNETSTATE pThis = RT_FROM_MEMBER(pInterface, VNETSTATE, INetworkDown);
+    pThis->fRxBatch = true;
+}
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnEndReceiveBatch}
+ */
+static DECLCALLBACK(void) vnetNetworkDown_EndReceiveBatch(PPDMINETWORKDOWN pInterface)
+{
+    PVNETSTATE pThis = RT_FROM_MEMBER(pInterface, VNETSTATE, INetworkDown);
+    pThis->fRxBatch = false;
+    if (pThis->fRxSyncPending)
+    {
+        int rc = vnetCsRxEnter(pThis, VERR_SEM_BUSY);
+        if (RT_SUCCESS(rc))
+        {
+            vnetRxBatchSync(pThis);
+            vnetCsRxLeave(pThis);
+        }
+    }
+}
+
 /**
  * Gets the current Media Access Control (MAC) address.
  *
@@ -2032,6 +2095,8 @@ static DECLCALLBACK(int) vnetConstruct(PPDMDEVINS pDevIns, int iInstance, PCFGMN
     pThis->INetworkDown.pfnReceive          = vnetNetworkDown_Receive;
     pThis->INetworkDown.pfnReceiveGso       = vnetNetworkDown_ReceiveGso;
     pThis->INetworkDown.pfnXmitPending      = vnetNetworkDown_XmitPending;
+    pThis->INetworkDown.pfnBeginReceiveBatch = vnetNetworkDown_BeginReceiveBatch;
+    pThis->INetworkDown.pfnEndReceiveBatch  = vnetNetworkDown_EndReceiveBatch;
 
     pThis->INetworkConfig.pfnGetMac         = vnetGetMac;
     pThis->INetworkConfig.pfnGetLinkState   = vnetGetLinkState;
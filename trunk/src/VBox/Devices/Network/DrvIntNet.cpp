@@ -54,6 +54,9 @@
 *********************************************************************************************************************************/
 /** Enables the ring-0 part. */
 #define VBOX_WITH_DRVINTNET_IN_R0
+/** The max number of frames passed up in one receive batch before the device
+ * is told to make them visible to the guest. */
+#define DRVINTNET_RECV_BATCH_MAX        64
 
 
 /*********************************************************************************************************************************
@@ -141,8 +144,11 @@ typedef struct DRVINTNET
     /** Set if data transmission should start immediately and deactivate
      * as late as possible. */
     bool                            fActivateEarlyDeactivateLate;
+    /** Set while the receive thread has a receive batch open above us.
+     * Only accessed by the receive thread. */
+    bool                            fRecvBatch;
     /** Padding. */
-    bool                            afReserved[HC_ARCH_BITS == 64 ? 3 : 3];
+    bool                            afReserved[HC_ARCH_BITS == 64 ? 2 : 2];
     /** Scratch space for holding the ring-0 scatter / gather descriptor.
      * The PDMSCATTERGATHER::fFlags member is used to indicate whether it is in
      * use or not.  Always accessed while owning the XmitLock. */
@@ -651,6 +657,38 @@ static DECLCALLBACK(int) drvR3IntNetXmitWakeUp(PPDMDRVINS pDrvIns, PPDMTHREAD pT
 
 /* -=-=-=-=- Receive Thread -=-=-=-=- */
 
+/**
+ * Opens a receive batch above us if the device supports it and none is open.
+ *
+ * @param   pThis       Pointer to the instance data.
+ */
+DECLINLINE(void) drvR3IntNetRecvBatchBegin(PDRVINTNET pThis)
+{
+    if (   !pThis->fRecvBatch
+        && pThis->pIAboveNet->pfnBeginReceiveBatch)
+    {
+        pThis->pIAboveNet->pfnBeginReceiveBatch(pThis->pIAboveNet);
+        pThis->fRecvBatch = true;
+    }
+}
+
+
+/**
+ * Closes the current receive batch, if any, letting the device notify the
+ * guest about everything received since it was opened.
+ *
+ * @param   pThis       Pointer to the instance data.
+ */
+DECLINLINE(void) drvR3IntNetRecvBatchEnd(PDRVINTNET pThis)
+{
+    if (pThis->fRecvBatch)
+    {
+        pThis->fRecvBatch = false;
+        pThis->pIAboveNet->pfnEndReceiveBatch(pThis->pIAboveNet);
+    }
+}
+
+
 /**
  * Wait for space to become available up the driver/device chain.
  *
@@ -662,6 +700,8 @@ static DECLCALLBACK(int) drvR3IntNetXmitWakeUp(PPDMDRVINS pDrvIns, PPDMTHREAD pT
 static int drvR3IntNetRecvWaitForSpace(PDRVINTNET pThis)
 {
     LogFlow(("drvR3IntNetRecvWaitForSpace:\n"));
+    /* The guest has to see what we've given it so far before it can return buffers. */
+    drvR3IntNetRecvBatchEnd(pThis);
     STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
     int rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
     STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
@@ -686,8 +726,9 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
      * The running loop - processing received data and waiting for more to arrive.
      */
     STAM_PROFILE_ADV_START(&pThis->StatReceive, a);
-    PINTNETBUF      pBuf     = pThis->CTX_SUFF(pBuf);
-    PINTNETRINGBUF  pRingBuf = &pBuf->Recv;
+    PINTNETBUF      pBuf         = pThis->CTX_SUFF(pBuf);
+    PINTNETRINGBUF  pRingBuf     = &pBuf->Recv;
+    uint32_t        cBatchFrames = 0;
     for (;;)
     {
         /*
@@ -701,6 +742,7 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
              */
             if (pThis->enmRecvState != RECVSTATE_RUNNING)
             {
+                drvR3IntNetRecvBatchEnd(pThis);
                 STAM_PROFILE_ADV_STOP(&pThis->StatReceive, a);
                 LogFlow(("drvR3IntNetRecvRun: returns VERR_STATE_CHANGED (state changed - #0)\n"));
                 return VERR_STATE_CHANGED;
@@ -719,6 +761,16 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
                 int rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, 0);
                 if (rc == VINF_SUCCESS)
                 {
+                    /*
+                     * Batch up frames so the device only has to notify the
+                     * guest once per burst rather than once per frame.
+                     */
+                    if (!pThis->fRecvBatch)
+                    {
+                        drvR3IntNetRecvBatchBegin(pThis);
+                        cBatchFrames = 0;
+                    }
+
                     if (u8Type == INTNETHDR_TYPE_FRAME)
                     {
                         /*
@@ -784,7 +836,9 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
                                     uint32_t cbSegFrame;
                                     void    *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, (uint8_t *)(pGso + 1), cbFrame,
                                                                                   abHdrScratch, iSeg, cSegs, &cbSegFrame);
-                                    rc = drvR3IntNetRecvWaitForSpace(pThis);
+                                    rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, 0);
+                                    if (rc != VINF_SUCCESS)
+                                        rc = drvR3IntNetRecvWaitForSpace(pThis);
                                     if (RT_FAILURE(rc))
                                     {
                                         Log(("drvR3IntNetRecvRun: drvR3IntNetRecvWaitForSpace -> %Rrc; iSeg=%u cSegs=%u\n", rc, iSeg, cSegs));
@@ -804,6 +858,10 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
 
                         IntNetRingSkipFrame(pRingBuf);
                     }
+
+                    /* Don't hold back frames from the guest for too long. */
+                    if (++cBatchFrames >= DRVINTNET_RECV_BATCH_MAX)
+                        drvR3IntNetRecvBatchEnd(pThis);
                 }
                 else
                 {
@@ -841,6 +899,11 @@ static int drvR3IntNetRecvRun(PDRVINTNET pThis)
             }
         } /* while more received data */
 
+        /*
+         * The ring is drained, let the guest know about the last batch.
+         */
+        drvR3IntNetRecvBatchEnd(pThis);
+
         /*
          * Wait for data, checking the state before we block.
          */
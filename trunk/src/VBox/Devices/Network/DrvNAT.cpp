@@ -71,6 +71,9 @@ extern "C" {
 
 #define DRVNAT_MAXFRAMESIZE (16 * 1024)
 
+/** The max size of a TCP super-frame coalesced for the guest (GRO). */
+#define DRVNAT_GRO_MAXFRAMESIZE (sizeof(RTNETETHERHDR) + UINT16_MAX)
+
 /**
  * @todo: This is a bad hack to prevent freezing the guest during high network
  *        activity. Windows host only. This needs to be fixed properly.
@@ -219,6 +222,20 @@ typedef struct DRVNAT
     /* Handle of the DNS watcher runloop source. */
     CFRunLoopSourceRef      hRunLoopSrcDnsWatcher;
 #endif
+
+    /** @name Receive coalescing (GRO), only accessed by the receive thread.
+     * @{ */
+    /** Buffer the TCP super-frame is assembled in, NULL if GRO is disabled. */
+    uint8_t                *pbGro;
+    /** Number of bytes in pbGro, 0 if nothing is pending. */
+    uint32_t                cbGro;
+    /** Number of segments coalesced into pbGro. */
+    uint32_t                cGroSegs;
+    /** The sequence number the next segment must start with. */
+    uint32_t                uGroNextSeq;
+    /** The GSO context describing pbGro. */
+    PDMNETWORKGSO           GroGso;
+    /** @} */
 } DRVNAT;
 AssertCompileMemberAlignment(DRVNAT, StatNATRecvWakeups, 8);
 /** Pointer to the NAT driver instance data. */
@@ -333,22 +350,19 @@ static DECLCALLBACK(void) drvNATUrgRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, in
 }
 
 
-static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int cb, struct mbuf *m)
+/**
+ * Passes a frame to the device, segmenting GSO frames the device or guest
+ * can't take.
+ *
+ * @param   pThis               Pointer to the NAT instance.
+ * @param   pvFrame             The frame.
+ * @param   cbFrame             The frame size.
+ * @param   pGso                The GSO context, NULL for normal frames.
+ * @thread  RX
+ */
+static void drvNATRecvDeliver(PDRVNAT pThis, const void *pvFrame, size_t cbFrame, PCPDMNETWORKGSO pGso)
 {
-    int rc;
-    STAM_PROFILE_START(&pThis->StatNATRecv, a);
-
-
-    while (ASMAtomicReadU32(&pThis->cUrgPkts) != 0)
-    {
-        rc = RTSemEventWait(pThis->EventRecv, RT_INDEFINITE_WAIT);
-        if (   RT_FAILURE(rc)
-            && (   rc == VERR_TIMEOUT
-                || rc == VERR_INTERRUPTED))
-            goto done_unlocked;
-    }
-
-    rc = RTCritSectEnter(&pThis->DevAccessLock);
+    int rc = RTCritSectEnter(&pThis->DevAccessLock);
     AssertRC(rc);
 
     STAM_PROFILE_START(&pThis->StatNATRecvWait, b);
@@ -357,8 +371,31 @@ static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int c
 
     if (RT_SUCCESS(rc))
     {
-        rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pu8Buf, cb);
-        AssertRC(rc);
+        if (!pGso)
+        {
+            rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvFrame, cbFrame);
+            AssertRC(rc);
+        }
+        else if (RT_FAILURE(pThis->pIAboveNet->pfnReceiveGso(pThis->pIAboveNet, pvFrame, cbFrame, pGso)))
+        {
+            /* The guest didn't negotiate large receives, hand it the segments. */
+            uint8_t         abHdrScratch[256];
+            uint32_t const  cSegs = PDMNetGsoCalcSegmentCount(pGso, cbFrame);
+            for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+            {
+                uint32_t cbSegFrame;
+                void    *pvSegFrame = PDMNetGsoCarveSegmentQD(pGso, (uint8_t *)pvFrame, cbFrame, abHdrScratch,
+                                                              iSeg, cSegs, &cbSegFrame);
+                if (iSeg > 0)
+                {
+                    rc = pThis->pIAboveNet->pfnWaitReceiveAvail(pThis->pIAboveNet, RT_INDEFINITE_WAIT);
+                    if (RT_FAILURE(rc))
+                        break; /* drop the rest */
+                }
+                rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvSegFrame, cbSegFrame);
+                AssertRC(rc);
+            }
+        }
     }
     else if (   rc != VERR_TIMEOUT
              && rc != VERR_INTERRUPTED)
@@ -368,6 +405,161 @@ static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int c
 
     rc = RTCritSectLeave(&pThis->DevAccessLock);
     AssertRC(rc);
+}
+
+
+/**
+ * Passes the pending coalesced TCP frame, if any, to the device.
+ *
+ * @param   pThis               Pointer to the NAT instance.
+ * @thread  RX
+ */
+static void drvNATRecvGroFlush(PDRVNAT pThis)
+{
+    if (!pThis->cbGro)
+        return;
+
+    if (pThis->cGroSegs == 1)
+        drvNATRecvDeliver(pThis, pThis->pbGro, pThis->cbGro, NULL);
+    else
+    {
+        STAM_COUNTER_INC(&pThis->StatNATRecvGroFrames);
+        STAM_COUNTER_ADD(&pThis->StatNATRecvGroSegs, pThis->cGroSegs);
+        PDMNetGsoPrepForDirectUse(&pThis->GroGso, pThis->pbGro, pThis->cbGro, PDMNETCSUMTYPE_PSEUDO);
+        drvNATRecvDeliver(pThis, pThis->pbGro, pThis->cbGro, &pThis->GroGso);
+    }
+    pThis->cbGro    = 0;
+    pThis->cGroSegs = 0;
+}
+
+
+/**
+ * Tries to coalesce a frame coming from slirp into the pending TCP
+ * super-frame (GRO), starting a new one if it's a suitable TCP segment.
+ *
+ * Only plain in-order IPv4 TCP data segments of the same flow with identical
+ * headers (apart from sequence number, IP ID and checksums) are merged, all
+ * but the last of them of the same size.  Anything else flushes the pending
+ * frame and is delivered as is.
+ *
+ * @returns true if the frame was consumed, false if the caller must deliver
+ *          it (after the pending frame has been flushed).
+ * @param   pThis               Pointer to the NAT instance.
+ * @param   pbFrame             The frame.
+ * @param   cbFrame             The frame size.
+ * @thread  RX
+ */
+static bool drvNATRecvGroAdd(PDRVNAT pThis, const uint8_t *pbFrame, size_t cbFrame)
+{
+    /*
+     * Is it a plain IPv4 TCP data segment?
+     */
+    uint32_t const offIp = sizeof(RTNETETHERHDR);
+    if (cbFrame < offIp + RTNETIPV4_MIN_LEN + RTNETTCP_MIN_LEN)
+        return false;
+    PCRTNETETHERHDR pEth = (PCRTNETETHERHDR)pbFrame;
+    PCRTNETIPV4     pIp  = (PCRTNETIPV4)(pbFrame + offIp);
+    if (   pEth->EtherType != RT_H2N_U16_C(RTNET_ETHERTYPE_IPV4)
+        || pIp->ip_v   != 4
+        || pIp->ip_hl  != RTNETIPV4_MIN_LEN / 4
+        || pIp->ip_p   != RTNETIPV4_PROT_TCP
+        || (RT_N2H_U16(pIp->ip_off) & (RTNETIPV4_FLAGS_MF | UINT16_C(0x1fff)))
+        || RT_N2H_U16(pIp->ip_len) != cbFrame - offIp)
+        return false;
+    uint32_t const offTcp = offIp + RTNETIPV4_MIN_LEN;
+    PCRTNETTCP     pTcp   = (PCRTNETTCP)(pbFrame + offTcp);
+    uint32_t const cbHdrs = offTcp + pTcp->th_off * 4;
+    if (   pTcp->th_off < RTNETTCP_MIN_LEN / 4
+        || cbHdrs >= cbFrame
+        || cbHdrs > 128
+        || (pTcp->th_flags & ~(RTNETTCP_F_ACK | RTNETTCP_F_PSH)) != 0
+        || !(pTcp->th_flags & RTNETTCP_F_ACK))
+        return false;
+    uint32_t const cbPayload = (uint32_t)cbFrame - cbHdrs;
+    uint32_t const uSeq      = RT_N2H_U32(pTcp->th_seq);
+
+    /*
+     * Append it to the pending frame if it continues it.
+     */
+    if (pThis->cbGro)
+    {
+        PCRTNETIPV4 pGroIp  = (PCRTNETIPV4)(pThis->pbGro + offIp);
+        PCRTNETTCP  pGroTcp = (PCRTNETTCP)(pThis->pbGro + offTcp);
+        if (   pThis->GroGso.cbHdrsTotal == cbHdrs
+            && uSeq == pThis->uGroNextSeq
+            && cbPayload <= pThis->GroGso.cbMaxSeg
+            && pThis->cbGro + cbPayload <= DRVNAT_GRO_MAXFRAMESIZE
+            && !memcmp(pThis->pbGro, pbFrame, sizeof(RTNETETHERHDR))
+            && pGroIp->ip_tos == pIp->ip_tos
+            && pGroIp->ip_ttl == pIp->ip_ttl
+            && pGroIp->ip_src.u == pIp->ip_src.u
+            && pGroIp->ip_dst.u == pIp->ip_dst.u
+            && pGroTcp->th_sport == pTcp->th_sport
+            && pGroTcp->th_dport == pTcp->th_dport
+            && pGroTcp->th_ack == pTcp->th_ack
+            && pGroTcp->th_win == pTcp->th_win
+            && !memcmp(pGroTcp + 1, pTcp + 1, cbHdrs - offTcp - sizeof(RTNETTCP)))
+        {
+            memcpy(pThis->pbGro + pThis->cbGro, pbFrame + cbHdrs, cbPayload);
+            pThis->cbGro       += cbPayload;
+            pThis->cGroSegs    += 1;
+            pThis->uGroNextSeq  = uSeq + cbPayload;
+            ((PRTNETTCP)(pThis->pbGro + offTcp))->th_flags |= pTcp->th_flags;
+
+            /* A short or pushed segment ends the burst. */
+            if (   cbPayload < pThis->GroGso.cbMaxSeg
+                || (pTcp->th_flags & RTNETTCP_F_PSH))
+                drvNATRecvGroFlush(pThis);
+            return true;
+        }
+        drvNATRecvGroFlush(pThis);
+    }
+
+    /*
+     * Start a new super-frame unless this segment already ends the burst.
+     */
+    if (pTcp->th_flags & RTNETTCP_F_PSH)
+        return false;
+    memcpy(pThis->pbGro, pbFrame, cbFrame);
+    pThis->cbGro              = (uint32_t)cbFrame;
+    pThis->cGroSegs           = 1;
+    pThis->uGroNextSeq        = uSeq + cbPayload;
+    pThis->GroGso.u8Type      = PDMNETWORKGSOTYPE_IPV4_TCP;
+    pThis->GroGso.cbHdrsTotal = (uint8_t)cbHdrs;
+    pThis->GroGso.cbMaxSeg    = (uint16_t)cbPayload;
+    pThis->GroGso.offHdr1     = (uint8_t)offIp;
+    pThis->GroGso.offHdr2     = (uint8_t)offTcp;
+    pThis->GroGso.cbHdrsSeg   = (uint8_t)cbHdrs;
+    pThis->GroGso.u8Unused    = 0;
+    return true;
+}
+
+
+static DECLCALLBACK(void) drvNATRecvWorker(PDRVNAT pThis, uint8_t *pu8Buf, int cb, struct mbuf *m)
+{
+    int rc;
+    STAM_PROFILE_START(&pThis->StatNATRecv, a);
+
+
+    while (ASMAtomicReadU32(&pThis->cUrgPkts) != 0)
+    {
+        rc = RTSemEventWait(pThis->EventRecv, RT_INDEFINITE_WAIT);
+        if (   RT_FAILURE(rc)
+            && (   rc == VERR_TIMEOUT
+                || rc == VERR_INTERRUPTED))
+            goto done_unlocked;
+    }
+
+    if (   !pThis->pbGro
+        || !drvNATRecvGroAdd(pThis, pu8Buf, cb))
+    {
+        drvNATRecvGroFlush(pThis);
+        drvNATRecvDeliver(pThis, pu8Buf, cb, NULL);
+    }
+
+    /* Don't sit on a coalesced frame when nothing more is queued. */
+    if (ASMAtomicReadU32(&pThis->cPkts) == 1)
+        drvNATRecvGroFlush(pThis);
 
 done_unlocked:
     slirp_ext_m_free(pThis->pNATState, m, pu8Buf);
@@ -1490,6 +1682,9 @@ static DECLCALLBACK(void) drvNATDestruct(PPDMDRVINS pDrvIns)
     if (RTCritSectIsInitialized(&pThis->XmitLock))
         RTCritSectDelete(&pThis->XmitLock);
 
+    RTMemFree(pThis->pbGro);
+    pThis->pbGro = NULL;
+
 #ifdef RT_OS_DARWIN
     /* Cleanup the DNS watcher. */
     CFRunLoopRef hRunLoopMain = CFRunLoopGetMain();
@@ -1567,7 +1762,7 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
                               "SlirpMTU\0AliasMode\0"
                               "SockRcv\0SockSnd\0TcpRcv\0TcpSnd\0"
                               "ICMPCacheLimit\0"
-                              "SoMaxConnection\0"
+                              "SoMaxConnection\0GRO\0"
 #ifdef VBOX_WITH_DNSMAPPING_IN_HOSTRESOLVER
                               "HostResolverMappings\0"
 #endif
@@ -1604,6 +1799,8 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
     i32AliasMode |= (i32MainAliasMode & 0x4 ? 0x4 : 0);
     int i32SoMaxConn = 10;
     GET_S32(rc, pThis, pCfg, "SoMaxConnection", i32SoMaxConn);
+    bool fGro = true;
+    GET_BOOL(rc, pThis, pCfg, "GRO", fGro);
     /*
      * Query the network port interface.
      */
@@ -1618,6 +1815,14 @@ static DECLCALLBACK(int) drvNATConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pCfg, uin
                                 N_("Configuration error: the above device/driver didn't "
                                 "export the network config interface"));
 
+    /* Coalesce received TCP segments if the device can take GSO frames. */
+    if (fGro && pThis->pIAboveNet->pfnReceiveGso)
+    {
+        pThis->pbGro = (uint8_t *)RTMemAlloc(DRVNAT_GRO_MAXFRAMESIZE);
+        if (!pThis->pbGro)
+            return VERR_NO_MEMORY;
+    }
+
     /* Generate a network address for this network card. */
     char szNetwork[32]; /* xxx.xxx.xxx.xxx/yy */
     GET_STRING(rc, pThis, pCfg, "Network", szNetwork[0], sizeof(szNetwork));
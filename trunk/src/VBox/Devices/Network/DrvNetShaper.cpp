@@ -238,6 +238,28 @@ static DECLCALLBACK(int) drvR3NetShaperDown_ReceiveGso(PPDMINETWORKDOWN pInterfa
 }
 
 
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnBeginReceiveBatch}
+ */
+static DECLCALLBACK(void) drvR3NetShaperDown_BeginReceiveBatch(PPDMINETWORKDOWN pInterface)
+{
+    PDRVNETSHAPER pThis = RT_FROM_MEMBER(pInterface, DRVNETSHAPER, INetworkDown);
+    if (pThis->pIAboveNet->pfnBeginReceiveBatch)
+        pThis->pIAboveNet->pfnBeginReceiveBatch(pThis->pIAboveNet);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnEndReceiveBatch}
+ */
+static DECLCALLBACK(void) drvR3NetShaperDown_EndReceiveBatch(PPDMINETWORKDOWN pInterface)
+{
+    PDRVNETSHAPER pThis = RT_FROM_MEMBER(pInterface, DRVNETSHAPER, INetworkDown);
+    if (pThis->pIAboveNet->pfnEndReceiveBatch)
+        pThis->pIAboveNet->pfnEndReceiveBatch(pThis->pIAboveNet);
+}
+
+
 /**
  * @interface_method_impl{PDMINETWORKDOWN,pfnXmitPending}
  */
@@ -445,6 +467,8 @@ static DECLCALLBACK(int) drvR3NetShaperConstruct(PPDMDRVINS pDrvIns, PCFGMNODE p
     pThis->INetworkDown.pfnReceive                  = drvR3NetShaperDown_Receive;
     pThis->INetworkDown.pfnReceiveGso               = drvR3NetShaperDown_ReceiveGso;
     pThis->INetworkDown.pfnXmitPending              = drvR3NetShaperDown_XmitPending;
+    pThis->INetworkDown.pfnBeginReceiveBatch        = drvR3NetShaperDown_BeginReceiveBatch;
+    pThis->INetworkDown.pfnEndReceiveBatch          = drvR3NetShaperDown_EndReceiveBatch;
     /* INetworkConfig */
     pThis->INetworkConfig.pfnGetMac                 = drvR3NetShaperDownCfg_GetMac;
     pThis->INetworkConfig.pfnGetLinkState           = drvR3NetShaperDownCfg_GetLinkState;
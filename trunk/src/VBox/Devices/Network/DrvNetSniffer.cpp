@@ -24,23 +24,94 @@
 #include <VBox/vmm/pdmnetifs.h>
 
 #include <VBox/log.h>
+#include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/critsect.h>
 #include <iprt/file.h>
+#include <iprt/mem.h>
 #include <iprt/process.h>
+#include <iprt/semaphore.h>
 #include <iprt/string.h>
+#include <iprt/thread.h>
 #include <iprt/time.h>
 #include <iprt/uuid.h>
 #include <iprt/path.h>
 #include <VBox/param.h>
+#include <VBox/vmm/pdmnetinline.h>
 
 #include "Pcap.h"
 #include "VBoxDD.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The default size of each capture ring. */
+#define DRVNETSNIFFER_RING_SIZE_DEF         _1M
+/** The max size of each capture ring. */
+#define DRVNETSNIFFER_RING_SIZE_MAX         _256M
+/** How long the writer thread sleeps when nobody wakes it up (ms). */
+#define DRVNETSNIFFER_WRITER_INTERVAL       50
+
+/** @name DRVNETSNIFFERREC::fFlags
+ * @{ */
+/** The frame was received by the guest. */
+#define DRVNETSNIFFERREC_F_INBOUND          RT_BIT_32(0)
+/** The frame is a GSO super-frame, segment it when writing. */
+#define DRVNETSNIFFERREC_F_GSO              RT_BIT_32(1)
+/** Filler up to the end of the ring buffer, skip it. */
+#define DRVNETSNIFFERREC_F_WRAP             RT_BIT_32(2)
+/** @} */
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/**
+ * Capture record header, followed by the captured bytes.
+ */
+typedef struct DRVNETSNIFFERREC
+{
+    /** The size of the whole record, 8 byte aligned. */
+    uint32_t                cbRec;
+    /** DRVNETSNIFFERREC_F_XXX. */
+    uint32_t                fFlags;
+    /** The original size of the frame. */
+    uint32_t                cbFrame;
+    /** The number of frame bytes following this header. */
+    uint32_t                cbCaptured;
+    /** RTTimeNanoTS() at the time of capture. */
+    uint64_t                u64NanoTS;
+    /** The GSO context if DRVNETSNIFFERREC_F_GSO is set. */
+    PDMNETWORKGSO           Gso;
+} DRVNETSNIFFERREC;
+AssertCompileSize(DRVNETSNIFFERREC, 32);
+/** Pointer to a capture record header. */
+typedef DRVNETSNIFFERREC *PDRVNETSNIFFERREC;
+
+/**
+ * Single producer, single consumer capture ring.
+ *
+ * There is one ring per direction.  Transmits are serialized by the transmit
+ * session and receives come from the one receive thread of the driver below,
+ * so the producer side never needs a lock.
+ */
+typedef struct DRVNETSNIFFERRING
+{
+    /** The ring buffer. */
+    uint8_t                *pbBuf;
+    /** The size of the ring buffer, power of two. */
+    uint32_t                cbBuf;
+    /** Free running write offset (producer). */
+    uint32_t volatile       offWrite;
+    /** Free running read offset (consumer). */
+    uint32_t volatile       offRead;
+    /** Number of frames dropped because the ring was full. */
+    uint32_t volatile       cDropped;
+} DRVNETSNIFFERRING;
+/** Pointer to a capture ring. */
+typedef DRVNETSNIFFERRING *PDRVNETSNIFFERRING;
+
 /**
  * Block driver instance data.
  *
@@ -65,21 +136,338 @@ typedef struct DRVNETSNIFFER
     PPDMINETWORKUP          pIBelowNet;
     /** The filename. */
     char                    szFilename[RTPATH_MAX];
-    /** The filehandle. */
+    /** The interface name recorded in pcapng files. */
+    char                    szIfName[64];
+    /** The filehandle, only accessed by the writer thread after construction. */
     RTFILE                  hFile;
-    /** The lock serializing the file access. */
-    RTCRITSECT              Lock;
     /** The NanoTS delta we pass to the pcap writers. */
     uint64_t                StartNanoTS;
+    /** What to add to RTTimeNanoTS() to get nanoseconds since 1970 (pcapng). */
+    int64_t                 offUnixNanoTS;
     /** Pointer to the driver instance. */
     PPDMDRVINS              pDrvIns;
     /** For when we're the leaf driver. */
     RTCRITSECT              XmitLock;
 
+    /** Frames sent by the guest. */
+    DRVNETSNIFFERRING       RingOut;
+    /** Frames received by the guest. */
+    DRVNETSNIFFERRING       RingIn;
+    /** The max number of bytes written per frame. */
+    uint32_t                cbSnapLen;
+    /** Set if writing pcapng rather than classic pcap. */
+    bool                    fPcapNg;
+    /** Set when the writer thread should terminate. */
+    bool volatile           fTerminate;
+    /** Set when the writer thread has been signalled. */
+    bool volatile           fWriterSignalled;
+    /** The writer thread. */
+    RTTHREAD                hWriterThread;
+    /** The event semaphore the writer thread waits on. */
+    RTSEMEVENT              hWriterEvt;
+    /** Scratch buffer the writer thread assembles GSO segments in. */
+    uint8_t                *pbSegScratch;
+
+    /** Rotate the file when it reaches this size, 0 if disabled. */
+    uint64_t                cbMaxFileSize;
+    /** Rotate the file after this many seconds, 0 if disabled. */
+    uint32_t                cSecsMaxFileTime;
+    /** The number of files to keep when rotating, 0 for all. */
+    uint32_t                cMaxFiles;
+    /** The index of the current file. */
+    uint32_t                iFile;
+    /** The number of bytes written to the current file. */
+    uint64_t                cbFileWritten;
+    /** RTTimeMilliTS() when the current file was started. */
+    uint64_t                msFileStarted;
+
 } DRVNETSNIFFER, *PDRVNETSNIFFER;
 
 
 
+/**
+ * Puts a frame into a capture ring, dropping it if there is no room.
+ *
+ * @param   pThis           The sniffer instance.
+ * @param   pRing           The ring, RingIn or RingOut.
+ * @param   fFlags          DRVNETSNIFFERREC_F_XXX.
+ * @param   pGso            The GSO context, NULL if not a GSO frame.
+ * @param   pvFrame         The frame bytes.
+ * @param   cbFrame         The size of the frame.
+ * @param   cbAvail         The number of frame bytes at @a pvFrame.
+ */
+static void drvNetSnifferCapture(PDRVNETSNIFFER pThis, PDRVNETSNIFFERRING pRing, uint32_t fFlags, PCPDMNETWORKGSO pGso,
+                                 const void *pvFrame, size_t cbFrame, size_t cbAvail)
+{
+    /* GSO frames must be captured whole, the snap length applies per segment when writing them. */
+    size_t const    cbCapture = pGso ? cbAvail : RT_MIN(cbAvail, pThis->cbSnapLen);
+    uint32_t const  cbRec     = RT_ALIGN_32((uint32_t)(sizeof(DRVNETSNIFFERREC) + cbCapture), 8);
+    uint32_t const  cbBuf     = pRing->cbBuf;
+    uint32_t        offWrite  = pRing->offWrite;
+    uint32_t const  cbFree    = cbBuf - (offWrite - ASMAtomicReadU32(&pRing->offRead));
+    uint32_t const  cbTail    = cbBuf - (offWrite & (cbBuf - 1));
+    if (   cbCapture > cbBuf / 2
+        || cbFree < cbRec + (cbTail < cbRec ? cbTail : 0))
+    {
+        ASMAtomicIncU32(&pRing->cDropped);
+        return;
+    }
+
+    if (cbTail < cbRec)
+    {
+        PDRVNETSNIFFERREC pWrap = (PDRVNETSNIFFERREC)&pRing->pbBuf[offWrite & (cbBuf - 1)];
+        pWrap->cbRec  = cbTail;
+        pWrap->fFlags = DRVNETSNIFFERREC_F_WRAP;
+        offWrite += cbTail;
+    }
+
+    PDRVNETSNIFFERREC pRec = (PDRVNETSNIFFERREC)&pRing->pbBuf[offWrite & (cbBuf - 1)];
+    pRec->cbRec      = cbRec;
+    pRec->fFlags     = fFlags | (pGso ? DRVNETSNIFFERREC_F_GSO : 0);
+    pRec->cbFrame    = (uint32_t)cbFrame;
+    pRec->cbCaptured = (uint32_t)cbCapture;
+    pRec->u64NanoTS  = RTTimeNanoTS();
+    if (pGso)
+        pRec->Gso = *pGso;
+    memcpy(pRec + 1, pvFrame, cbCapture);
+    ASMAtomicWriteU32(&pRing->offWrite, offWrite + cbRec);
+
+    /* Kick the writer when the ring starts filling up, otherwise it polls. */
+    if (   cbFree - cbRec < cbBuf / 2
+        && !ASMAtomicXchgBool(&pThis->fWriterSignalled, true))
+        RTSemEventSignal(pThis->hWriterEvt);
+}
+
+
+/**
+ * Gets the next record from a capture ring without consuming it.
+ *
+ * @returns Pointer to the record, NULL if the ring is empty.
+ * @param   pRing           The ring.
+ */
+static PDRVNETSNIFFERREC drvNetSnifferRingPeek(PDRVNETSNIFFERRING pRing)
+{
+    for (;;)
+    {
+        uint32_t offRead = pRing->offRead;
+        if (offRead == ASMAtomicReadU32(&pRing->offWrite))
+            return NULL;
+        PDRVNETSNIFFERREC pRec = (PDRVNETSNIFFERREC)&pRing->pbBuf[offRead & (pRing->cbBuf - 1)];
+        if (!(pRec->fFlags & DRVNETSNIFFERREC_F_WRAP))
+            return pRec;
+        ASMAtomicWriteU32(&pRing->offRead, offRead + pRec->cbRec);
+    }
+}
+
+
+/**
+ * Opens the capture file with the given index and writes the file header.
+ *
+ * @returns IPRT status code.
+ * @param   pThis           The sniffer instance.
+ * @param   iFile           The file index, 0 for the configured name.
+ */
+static int drvNetSnifferOpenFile(PDRVNETSNIFFER pThis, uint32_t iFile)
+{
+    char szFilename[RTPATH_MAX];
+    if (iFile)
+        RTStrPrintf(szFilename, sizeof(szFilename), "%s.%u", pThis->szFilename, iFile);
+    else
+        RTStrCopy(szFilename, sizeof(szFilename), pThis->szFilename);
+
+    int rc = RTFileOpen(&pThis->hFile, szFilename, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
+    if (RT_FAILURE(rc))
+    {
+        pThis->hFile = NIL_RTFILE;
+        return rc;
+    }
+
+    pThis->iFile         = iFile;
+    pThis->cbFileWritten = 0;
+    pThis->msFileStarted = RTTimeMilliTS();
+
+    /*
+     * Write the header.
+     * Some time has gone by since capturing pThis->StartNanoTS so get the
+     * current time again.
+     */
+    if (pThis->fPcapNg)
+        rc = PcapNgFileHdr(pThis->hFile, pThis->szIfName, pThis->cbSnapLen);
+    else
+        rc = PcapFileHdr(pThis->hFile, RTTimeNanoTS());
+    pThis->cbFileWritten = RTFileTell(pThis->hFile);
+    return rc;
+}
+
+
+/**
+ * Closes the current capture file and starts the next one.
+ *
+ * @param   pThis           The sniffer instance.
+ */
+static void drvNetSnifferRotate(PDRVNETSNIFFER pThis)
+{
+    RTFileClose(pThis->hFile);
+    pThis->hFile = NIL_RTFILE;
+
+    uint32_t iFile = pThis->iFile + 1;
+    if (pThis->cMaxFiles && iFile >= pThis->cMaxFiles)
+    {
+        uint32_t const iOldest = iFile - pThis->cMaxFiles;
+        if (iOldest)
+        {
+            char szOldest[RTPATH_MAX];
+            RTStrPrintf(szOldest, sizeof(szOldest), "%s.%u", pThis->szFilename, iOldest);
+            RTFileDelete(szOldest);
+        }
+        else
+            RTFileDelete(pThis->szFilename);
+    }
+
+    int rc = drvNetSnifferOpenFile(pThis, iFile);
+    if (RT_FAILURE(rc))
+        LogRel(("NetSniffer: Failed to open the next capture file (#%u): %Rrc\n", iFile, rc));
+}
+
+
+/**
+ * Writes one capture record to the current file.
+ *
+ * @param   pThis           The sniffer instance.
+ * @param   pRec            The record.
+ */
+static void drvNetSnifferWriteRecord(PDRVNETSNIFFER pThis, PDRVNETSNIFFERREC pRec)
+{
+    if (pThis->hFile == NIL_RTFILE)
+        return;
+
+    bool const      fInbound   = RT_BOOL(pRec->fFlags & DRVNETSNIFFERREC_F_INBOUND);
+    uint8_t const  *pbFrame    = (uint8_t const *)(pRec + 1);
+    size_t          cbWritten  = 0;
+    if (!(pRec->fFlags & DRVNETSNIFFERREC_F_GSO))
+    {
+        if (pThis->fPcapNg)
+            PcapNgFileFrame(pThis->hFile, pRec->u64NanoTS + pThis->offUnixNanoTS, pbFrame, pRec->cbFrame,
+                            pRec->cbCaptured, fInbound, &cbWritten);
+        else
+            PcapFileFrameAt(pThis->hFile, pRec->u64NanoTS - pThis->StartNanoTS, pbFrame, pRec->cbFrame, pRec->cbCaptured,
+                            &cbWritten);
+        pThis->cbFileWritten += cbWritten;
+        return;
+    }
+
+    /*
+     * Carve GSO frames into the segments that go onto the wire.
+     */
+    PCPDMNETWORKGSO pGso   = &pRec->Gso;
+    uint32_t const  cbGso  = pRec->cbCaptured;
+    if (!PDMNetGsoIsValid(pGso, sizeof(*pGso), cbGso))
+        return;
+    uint32_t const  cSegs  = PDMNetGsoCalcSegmentCount(pGso, cbGso);
+    for (uint32_t iSeg = 0; iSeg < cSegs; iSeg++)
+    {
+        uint32_t cbSegPayload, cbHdrs;
+        uint32_t offSegPayload = PDMNetGsoCarveSegment(pGso, pbFrame, cbGso, iSeg, cSegs, pThis->pbSegScratch,
+                                                       &cbHdrs, &cbSegPayload);
+        uint32_t const cbSeg = cbHdrs + cbSegPayload;
+        uint32_t const cbCopy = RT_MIN(cbSeg, pThis->cbSnapLen);
+        if (cbCopy > cbHdrs)
+            memcpy(&pThis->pbSegScratch[cbHdrs], &pbFrame[offSegPayload], cbCopy - cbHdrs);
+        cbWritten = 0;
+        if (pThis->fPcapNg)
+            PcapNgFileFrame(pThis->hFile, pRec->u64NanoTS + pThis->offUnixNanoTS, pThis->pbSegScratch, cbSeg, cbCopy, fInbound,
+                            &cbWritten);
+        else
+            PcapFileFrameAt(pThis->hFile, pRec->u64NanoTS - pThis->StartNanoTS, pThis->pbSegScratch, cbSeg, cbCopy,
+                            &cbWritten);
+        pThis->cbFileWritten += cbWritten;
+    }
+}
+
+
+/**
+ * Writes everything currently in the capture rings to the file, merging the
+ * two directions in timestamp order.
+ *
+ * @param   pThis           The sniffer instance.
+ */
+static void drvNetSnifferDrain(PDRVNETSNIFFER pThis)
+{
+    for (;;)
+    {
+        PDRVNETSNIFFERREC pRecOut = drvNetSnifferRingPeek(&pThis->RingOut);
+        PDRVNETSNIFFERREC pRecIn  = drvNetSnifferRingPeek(&pThis->RingIn);
+        PDRVNETSNIFFERRING pRing;
+        PDRVNETSNIFFERREC  pRec;
+        if (pRecOut && (!pRecIn || pRecOut->u64NanoTS <= pRecIn->u64NanoTS))
+        {
+            pRing = &pThis->RingOut;
+            pRec  = pRecOut;
+        }
+        else if (pRecIn)
+        {
+            pRing = &pThis->RingIn;
+            pRec  = pRecIn;
+        }
+        else
+            break;
+
+        if (   pThis->hFile != NIL_RTFILE
+            && (   (pThis->cbMaxFileSize    && pThis->cbFileWritten >= pThis->cbMaxFileSize)
+                || (pThis->cSecsMaxFileTime && RTTimeMilliTS() - pThis->msFileStarted >= pThis->cSecsMaxFileTime * UINT64_C(1000))))
+            drvNetSnifferRotate(pThis);
+
+        drvNetSnifferWriteRecord(pThis, pRec);
+        ASMAtomicWriteU32(&pRing->offRead, pRing->offRead + pRec->cbRec);
+    }
+}
+
+
+/**
+ * The writer thread, moving frames from the capture rings to the file.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf     Thread handle.
+ * @param   pvUser          Pointer to a DRVNETSNIFFER structure.
+ */
+static DECLCALLBACK(int) drvNetSnifferWriterThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf);
+    PDRVNETSNIFFER pThis = (PDRVNETSNIFFER)pvUser;
+
+    while (!ASMAtomicReadBool(&pThis->fTerminate))
+    {
+        RTSemEventWait(pThis->hWriterEvt, DRVNETSNIFFER_WRITER_INTERVAL);
+        ASMAtomicWriteBool(&pThis->fWriterSignalled, false);
+        drvNetSnifferDrain(pThis);
+    }
+
+    /* Flush what's left. */
+    drvNetSnifferDrain(pThis);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Allocates the buffer of a capture ring.
+ *
+ * @returns VBox status code.
+ * @param   pRing           The ring.
+ * @param   cbBuf           The size, power of two.
+ */
+static int drvNetSnifferRingInit(PDRVNETSNIFFERRING pRing, uint32_t cbBuf)
+{
+    pRing->pbBuf = (uint8_t *)RTMemAllocZ(cbBuf);
+    if (!pRing->pbBuf)
+        return VERR_NO_MEMORY;
+    pRing->cbBuf    = cbBuf;
+    pRing->offWrite = 0;
+    pRing->offRead  = 0;
+    pRing->cDropped = 0;
+    return VINF_SUCCESS;
+}
+
+
 /**
  * @interface_method_impl{PDMINETWORKUP,pfnBeginXmit}
  */
@@ -132,18 +520,8 @@ static DECLCALLBACK(int) drvNetSnifferUp_SendBuf(PPDMINETWORKUP pInterface, PPDM
         return VERR_NET_DOWN;
 
     /* output to sniffer */
-    RTCritSectEnter(&pThis->Lock);
-    if (!pSgBuf->pvUser)
-        PcapFileFrame(pThis->hFile, pThis->StartNanoTS,
-                      pSgBuf->aSegs[0].pvSeg,
-                      pSgBuf->cbUsed,
-                      RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
-    else
-        PcapFileGsoFrame(pThis->hFile, pThis->StartNanoTS, (PCPDMNETWORKGSO)pSgBuf->pvUser,
-                         pSgBuf->aSegs[0].pvSeg,
-                         pSgBuf->cbUsed,
-                         RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
-    RTCritSectLeave(&pThis->Lock);
+    drvNetSnifferCapture(pThis, &pThis->RingOut, 0 /*fFlags*/, (PCPDMNETWORKGSO)pSgBuf->pvUser,
+                         pSgBuf->aSegs[0].pvSeg, pSgBuf->cbUsed, RT_MIN(pSgBuf->cbUsed, pSgBuf->aSegs[0].cbSeg));
 
     return pThis->pIBelowNet->pfnSendBuf(pThis->pIBelowNet, pSgBuf, fOnWorkerThread);
 }
@@ -205,22 +583,32 @@ static DECLCALLBACK(int) drvNetSnifferDown_Receive(PPDMINETWORKDOWN pInterface,
     PDRVNETSNIFFER pThis = RT_FROM_MEMBER(pInterface, DRVNETSNIFFER, INetworkDown);
 
     /* output to sniffer */
-    RTCritSectEnter(&pThis->Lock);
-    PcapFileFrame(pThis->hFile, pThis->StartNanoTS, pvBuf, cb, cb);
-    RTCritSectLeave(&pThis->Lock);
+    drvNetSnifferCapture(pThis, &pThis->RingIn, DRVNETSNIFFERREC_F_INBOUND, NULL /*pGso*/, pvBuf, cb, cb);
 
     /* pass up */
-    int rc = pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvBuf, cb);
-#if 0
-    RTCritSectEnter(&pThis->Lock);
-    u64TS = RTTimeProgramNanoTS();
-    Hdr.ts_sec = (uint32_t)(u64TS / 1000000000);
-    Hdr.ts_usec = (uint32_t)((u64TS / 1000) % 1000000);
-    Hdr.incl_len = 0;
-    RTFileWrite(pThis->hFile, &Hdr, sizeof(Hdr), NULL);
-    RTCritSectLeave(&pThis->Lock);
-#endif
-    return rc;
+    return pThis->pIAboveNet->pfnReceive(pThis->pIAboveNet, pvBuf, cb);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnBeginReceiveBatch}
+ */
+static DECLCALLBACK(void) drvNetSnifferDown_BeginReceiveBatch(PPDMINETWORKDOWN pInterface)
+{
+    PDRVNETSNIFFER pThis = RT_FROM_MEMBER(pInterface, DRVNETSNIFFER, INetworkDown);
+    if (pThis->pIAboveNet->pfnBeginReceiveBatch)
+        pThis->pIAboveNet->pfnBeginReceiveBatch(pThis->pIAboveNet);
+}
+
+
+/**
+ * @interface_method_impl{PDMINETWORKDOWN,pfnEndReceiveBatch}
+ */
+static DECLCALLBACK(void) drvNetSnifferDown_EndReceiveBatch(PPDMINETWORKDOWN pInterface)
+{
+    PDRVNETSNIFFER pThis = RT_FROM_MEMBER(pInterface, DRVNETSNIFFER, INetworkDown);
+    if (pThis->pIAboveNet->pfnEndReceiveBatch)
+        pThis->pIAboveNet->pfnEndReceiveBatch(pThis->pIAboveNet);
 }
 
 
@@ -353,8 +741,25 @@ static DECLCALLBACK(void) drvNetSnifferDestruct(PPDMDRVINS pDrvIns)
     PDRVNETSNIFFER pThis = PDMINS_2_DATA(pDrvIns, PDRVNETSNIFFER);
     PDMDRV_CHECK_VERSIONS_RETURN_VOID(pDrvIns);
 
-    if (RTCritSectIsInitialized(&pThis->Lock))
-        RTCritSectDelete(&pThis->Lock);
+    /* Stop the writer thread, it flushes the rings before exiting. */
+    if (pThis->hWriterThread != NIL_RTTHREAD)
+    {
+        ASMAtomicWriteBool(&pThis->fTerminate, true);
+        RTSemEventSignal(pThis->hWriterEvt);
+        int rc = RTThreadWait(pThis->hWriterThread, 30000, NULL);
+        AssertRC(rc);
+        pThis->hWriterThread = NIL_RTTHREAD;
+    }
+
+    if (pThis->RingOut.cDropped || pThis->RingIn.cDropped)
+        LogRel(("NetSniffer: Dropped %u outbound and %u inbound frames because the capture ring was full\n",
+                pThis->RingOut.cDropped, pThis->RingIn.cDropped));
+
+    if (pThis->hWriterEvt != NIL_RTSEMEVENT)
+    {
+        RTSemEventDestroy(pThis->hWriterEvt);
+        pThis->hWriterEvt = NIL_RTSEMEVENT;
+    }
 
     if (RTCritSectIsInitialized(&pThis->XmitLock))
         RTCritSectDelete(&pThis->XmitLock);
@@ -364,6 +769,13 @@ static DECLCALLBACK(void) drvNetSnifferDestruct(PPDMDRVINS pDrvIns)
         RTFileClose(pThis->hFile);
         pThis->hFile = NIL_RTFILE;
     }
+
+    RTMemFree(pThis->RingOut.pbBuf);
+    pThis->RingOut.pbBuf = NULL;
+    RTMemFree(pThis->RingIn.pbBuf);
+    pThis->RingIn.pbBuf = NULL;
+    RTMemFree(pThis->pbSegScratch);
+    pThis->pbSegScratch = NULL;
 }
 
 
@@ -382,8 +794,12 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
      */
     pThis->pDrvIns                                  = pDrvIns;
     pThis->hFile                                    = NIL_RTFILE;
+    pThis->hWriterThread                            = NIL_RTTHREAD;
+    pThis->hWriterEvt                               = NIL_RTSEMEVENT;
     /* The pcap file *must* start at time offset 0,0. */
     pThis->StartNanoTS                              = RTTimeNanoTS() - RTTimeProgramNanoTS();
+    RTTIMESPEC Now;
+    pThis->offUnixNanoTS                            = RTTimeSpecGetNano(RTTimeNow(&Now)) - (int64_t)RTTimeNanoTS();
     /* IBase */
     pDrvIns->IBase.pfnQueryInterface                = drvNetSnifferQueryInterface;
     /* INetworkUp */
@@ -398,23 +814,30 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     pThis->INetworkDown.pfnWaitReceiveAvail         = drvNetSnifferDown_WaitReceiveAvail;
     pThis->INetworkDown.pfnReceive                  = drvNetSnifferDown_Receive;
     pThis->INetworkDown.pfnXmitPending              = drvNetSnifferDown_XmitPending;
+    pThis->INetworkDown.pfnBeginReceiveBatch        = drvNetSnifferDown_BeginReceiveBatch;
+    pThis->INetworkDown.pfnEndReceiveBatch          = drvNetSnifferDown_EndReceiveBatch;
     /* INetworkConfig */
     pThis->INetworkConfig.pfnGetMac                 = drvNetSnifferDownCfg_GetMac;
     pThis->INetworkConfig.pfnGetLinkState           = drvNetSnifferDownCfg_GetLinkState;
     pThis->INetworkConfig.pfnSetLinkState           = drvNetSnifferDownCfg_SetLinkState;
 
     /*
-     * Create the locks.
+     * Create the lock.
      */
-    int rc = RTCritSectInit(&pThis->Lock);
-    AssertRCReturn(rc, rc);
-    rc = RTCritSectInit(&pThis->XmitLock);
+    int rc = RTCritSectInit(&pThis->XmitLock);
     AssertRCReturn(rc, rc);
 
     /*
      * Validate the config.
      */
-    if (!CFGMR3AreValuesValid(pCfg, "File\0"))
+    if (!CFGMR3AreValuesValid(pCfg, "File\0"
+                                    "Format\0"
+                                    "InterfaceName\0"
+                                    "SnapLen\0"
+                                    "RingSize\0"
+                                    "MaxFileSize\0"
+                                    "MaxFileTime\0"
+                                    "MaxFiles\0"))
         return VERR_PDM_DRVINS_UNKNOWN_CFG_VALUES;
 
     if (CFGMR3GetFirstChild(pCfg))
@@ -438,6 +861,59 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
         return rc;
     }
 
+    /*
+     * Get the capture parameters.
+     */
+    char szFormat[16];
+    rc = CFGMR3QueryStringDef(pCfg, "Format", szFormat, sizeof(szFormat), "pcap");
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"Format\" value"));
+    if (!RTStrICmp(szFormat, "pcapng"))
+        pThis->fPcapNg = true;
+    else if (RTStrICmp(szFormat, "pcap"))
+        return PDMDrvHlpVMSetError(pDrvIns, VERR_INVALID_PARAMETER, RT_SRC_POS,
+                                   N_("Configuration error: Unknown capture format \"%s\", expected \"pcap\" or \"pcapng\""), szFormat);
+
+    rc = CFGMR3QueryString(pCfg, "InterfaceName", pThis->szIfName, sizeof(pThis->szIfName));
+    if (rc == VERR_CFGM_VALUE_NOT_FOUND)
+        RTStrPrintf(pThis->szIfName, sizeof(pThis->szIfName), "%s#%u", pDrvIns->pReg->szName, pDrvIns->iInstance);
+    else if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"InterfaceName\" value"));
+
+    rc = CFGMR3QueryU32Def(pCfg, "SnapLen", &pThis->cbSnapLen, 0xffff);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"SnapLen\" value"));
+    if (pThis->cbSnapLen < 14)
+        pThis->cbSnapLen = 14;
+
+    uint32_t cbRing;
+    rc = CFGMR3QueryU32Def(pCfg, "RingSize", &cbRing, DRVNETSNIFFER_RING_SIZE_DEF);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"RingSize\" value"));
+    cbRing = RT_MIN(RT_MAX(cbRing, _128K), DRVNETSNIFFER_RING_SIZE_MAX);
+    if (!RT_IS_POWER_OF_TWO(cbRing))
+        cbRing = RT_BIT_32(ASMBitLastSetU32(cbRing)); /* round up */
+
+    rc = CFGMR3QueryU64Def(pCfg, "MaxFileSize", &pThis->cbMaxFileSize, 0);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"MaxFileSize\" value"));
+    rc = CFGMR3QueryU32Def(pCfg, "MaxFileTime", &pThis->cSecsMaxFileTime, 0);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"MaxFileTime\" value"));
+    rc = CFGMR3QueryU32Def(pCfg, "MaxFiles", &pThis->cMaxFiles, 0);
+    if (RT_FAILURE(rc))
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("Configuration error: Failed to get the \"MaxFiles\" value"));
+
+    /*
+     * Allocate the capture rings.
+     */
+    rc = drvNetSnifferRingInit(&pThis->RingOut, cbRing);
+    if (RT_SUCCESS(rc))
+        rc = drvNetSnifferRingInit(&pThis->RingIn, cbRing);
+    AssertRCReturn(rc, rc);
+    pThis->pbSegScratch = (uint8_t *)RTMemAlloc(_64K + 256);
+    AssertReturn(pThis->pbSegScratch, VERR_NO_MEMORY);
+
     /*
      * Query the network port interface.
      */
@@ -482,10 +958,9 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
     }
 
     /*
-     * Open output file / pipe.
+     * Open output file / pipe and write the pcap header.
      */
-    rc = RTFileOpen(&pThis->hFile, pThis->szFilename,
-                    RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
+    rc = drvNetSnifferOpenFile(pThis, 0 /*iFile*/);
     if (RT_FAILURE(rc))
         return PDMDrvHlpVMSetError(pDrvIns, rc, RT_SRC_POS,
                                    N_("Netsniffer cannot open '%s' for writing. The directory must exist and it must be writable for the current user"), pThis->szFilename);
@@ -500,11 +975,17 @@ static DECLCALLBACK(int) drvNetSnifferConstruct(PPDMDRVINS pDrvIns, PCFGMNODE pC
         LogRel(("NetSniffer: Sniffing to '%s'\n", pThis->szFilename));
 
     /*
-     * Write pcap header.
-     * Some time has gone by since capturing pThis->StartNanoTS so get the
-     * current time again.
+     * Start the writer thread.
      */
-    PcapFileHdr(pThis->hFile, RTTimeNanoTS());
+    rc = RTSemEventCreate(&pThis->hWriterEvt);
+    AssertRCReturn(rc, rc);
+    rc = RTThreadCreateF(&pThis->hWriterThread, drvNetSnifferWriterThread, pThis, 0,
+                         RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "NetSniff%u", pDrvIns->iInstance);
+    if (RT_FAILURE(rc))
+    {
+        pThis->hWriterThread = NIL_RTTHREAD;
+        return PDMDRV_SET_ERROR(pDrvIns, rc, N_("NetSniffer: Failed to create the writer thread"));
+    }
 
     return VINF_SUCCESS;
 }
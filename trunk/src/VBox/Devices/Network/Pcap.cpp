@@ -23,6 +23,7 @@
 
 #include <iprt/file.h>
 #include <iprt/stream.h>
+#include <iprt/string.h>
 #include <iprt/time.h>
 #include <iprt/err.h>
 #include <VBox/vmm/pdmnetinline.h>
@@ -61,6 +62,58 @@ struct pcaprec_hdr_init
     struct pcap_hdr     pcap;
 };
 
+/* "pcapng" block types. */
+#define PCAPNG_BT_SHB           UINT32_C(0x0a0d0d0a)
+#define PCAPNG_BT_IDB           UINT32_C(0x00000001)
+#define PCAPNG_BT_EPB           UINT32_C(0x00000006)
+/* "pcapng" byte order magic. */
+#define PCAPNG_BYTE_ORDER_MAGIC UINT32_C(0x1a2b3c4d)
+/* "pcapng" option codes. */
+#define PCAPNG_OPT_ENDOFOPT     0
+#define PCAPNG_OPT_IF_NAME      2
+#define PCAPNG_OPT_IF_TSRESOL   9
+#define PCAPNG_OPT_EPB_FLAGS    2
+
+/* "pcapng" section header block (without options and trailing length). */
+struct pcapng_shb
+{
+    uint32_t    block_type;     /* PCAPNG_BT_SHB */
+    uint32_t    block_total_length;
+    uint32_t    byte_order_magic;
+    uint16_t    major_version;  /* = 1 */
+    uint16_t    minor_version;  /* = 0 */
+    int64_t     section_length; /* = -1, not specified */
+};
+
+/* "pcapng" interface description block (without options and trailing length). */
+struct pcapng_idb
+{
+    uint32_t    block_type;     /* PCAPNG_BT_IDB */
+    uint32_t    block_total_length;
+    uint16_t    linktype;       /* = 1, ethernet */
+    uint16_t    reserved;
+    uint32_t    snaplen;
+};
+
+/* "pcapng" enhanced packet block (without data, options and trailing length). */
+struct pcapng_epb
+{
+    uint32_t    block_type;     /* PCAPNG_BT_EPB */
+    uint32_t    block_total_length;
+    uint32_t    interface_id;
+    uint32_t    timestamp_high;
+    uint32_t    timestamp_low;
+    uint32_t    captured_len;
+    uint32_t    packet_len;
+};
+
+/* "pcapng" option header. */
+struct pcapng_opt
+{
+    uint16_t    code;
+    uint16_t    length;
+};
+
 
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
@@ -255,3 +308,179 @@ int PcapFileGsoFrame(RTFILE File, uint64_t StartNanoTS, PCPDMNETWORKGSO pGso,
     return VINF_SUCCESS;
 }
 
+
+/**
+ * Writes a frame with a given timestamp to a file.
+ *
+ * @returns IPRT status code, @see RTFileWrite.
+ *
+ * @param   File            The file handle.
+ * @param   cNsTimestamp    The capture timestamp relative to the start of the
+ *                          capture, in nanoseconds.
+ * @param   pvFrame         The start of the frame.
+ * @param   cbFrame         The size of the frame.
+ * @param   cbMax           The max number of bytes to include in the file.
+ * @param   pcbWritten      Where to return the number of bytes written to the
+ *                          file, optional.
+ */
+int PcapFileFrameAt(RTFILE File, uint64_t cNsTimestamp, const void *pvFrame, size_t cbFrame, size_t cbMax,
+                    size_t *pcbWritten)
+{
+    struct pcaprec_hdr  Hdr;
+    Hdr.ts_sec   = (uint32_t)(cNsTimestamp / 1000000000);
+    Hdr.ts_usec  = (uint32_t)((cNsTimestamp / 1000) % 1000000);
+    pcapUpdateHeader(&Hdr, cbFrame, cbMax);
+    size_t cbWritten1 = 0;
+    size_t cbWritten2 = 0;
+    int rc1 = RTFileWrite(File, &Hdr, sizeof(Hdr), &cbWritten1);
+    int rc2 = RTFileWrite(File, pvFrame, Hdr.incl_len, &cbWritten2);
+    if (pcbWritten)
+        *pcbWritten = cbWritten1 + cbWritten2;
+    return RT_SUCCESS(rc1) ? rc2 : rc1;
+}
+
+
+/**
+ * Writes the pcapng section header and the interface description block for
+ * our single interface to a file.
+ *
+ * Timestamps in the following blocks are in nanoseconds since 1970.
+ *
+ * @returns IPRT status code, @see RTFileWrite.
+ *
+ * @param   File            The file handle.
+ * @param   pszIfName       The interface name to record, NULL if none.
+ * @param   cbSnapLen       The max number of bytes captured per frame.
+ */
+int PcapNgFileHdr(RTFILE File, const char *pszIfName, uint32_t cbSnapLen)
+{
+    /* Section header block, no options. */
+    struct pcapng_shb Shb;
+    Shb.block_type          = PCAPNG_BT_SHB;
+    Shb.block_total_length  = sizeof(Shb) + sizeof(uint32_t);
+    Shb.byte_order_magic    = PCAPNG_BYTE_ORDER_MAGIC;
+    Shb.major_version       = 1;
+    Shb.minor_version       = 0;
+    Shb.section_length      = -1;
+    int rc = RTFileWrite(File, &Shb, sizeof(Shb), NULL);
+    if (RT_SUCCESS(rc))
+        rc = RTFileWrite(File, &Shb.block_total_length, sizeof(uint32_t), NULL);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /* Interface description block with if_name and if_tsresol options. */
+    uint8_t  abOpts[sizeof(struct pcapng_opt) * 3 + 256 + 4];
+    size_t   cbOpts = 0;
+    struct pcapng_opt Opt;
+    if (pszIfName && *pszIfName)
+    {
+        size_t cchIfName = RT_MIN(strlen(pszIfName), 255);
+        Opt.code   = PCAPNG_OPT_IF_NAME;
+        Opt.length = (uint16_t)cchIfName;
+        memcpy(&abOpts[cbOpts], &Opt, sizeof(Opt));
+        cbOpts += sizeof(Opt);
+        memset(&abOpts[cbOpts], 0, RT_ALIGN_Z(cchIfName, 4));
+        memcpy(&abOpts[cbOpts], pszIfName, cchIfName);
+        cbOpts += RT_ALIGN_Z(cchIfName, 4);
+    }
+    Opt.code   = PCAPNG_OPT_IF_TSRESOL;
+    Opt.length = 1;
+    memcpy(&abOpts[cbOpts], &Opt, sizeof(Opt));
+    cbOpts += sizeof(Opt);
+    abOpts[cbOpts++] = 9; /* 10^-9 s */
+    abOpts[cbOpts++] = 0;
+    abOpts[cbOpts++] = 0;
+    abOpts[cbOpts++] = 0;
+    Opt.code   = PCAPNG_OPT_ENDOFOPT;
+    Opt.length = 0;
+    memcpy(&abOpts[cbOpts], &Opt, sizeof(Opt));
+    cbOpts += sizeof(Opt);
+
+    struct pcapng_idb Idb;
+    Idb.block_type          = PCAPNG_BT_IDB;
+    Idb.block_total_length  = (uint32_t)(sizeof(Idb) + cbOpts + sizeof(uint32_t));
+    Idb.linktype            = 1;
+    Idb.reserved            = 0;
+    Idb.snaplen             = cbSnapLen;
+    rc = RTFileWrite(File, &Idb, sizeof(Idb), NULL);
+    if (RT_SUCCESS(rc))
+        rc = RTFileWrite(File, abOpts, cbOpts, NULL);
+    if (RT_SUCCESS(rc))
+        rc = RTFileWrite(File, &Idb.block_total_length, sizeof(uint32_t), NULL);
+    return rc;
+}
+
+
+/**
+ * Writes a frame as a pcapng enhanced packet block to a file.
+ *
+ * @returns IPRT status code, @see RTFileWrite.
+ *
+ * @param   File            The file handle.
+ * @param   cNsTimestamp    The capture timestamp in nanoseconds since 1970.
+ * @param   pvFrame         The start of the frame.
+ * @param   cbFrame         The size of the frame.
+ * @param   cbMax           The max number of bytes to include in the file.
+ * @param   fInbound        Set if the frame was received by the guest, clear
+ *                          if it was sent by it.
+ * @param   pcbWritten      Where to return the number of bytes written to the
+ *                          file, optional.
+ */
+int PcapNgFileFrame(RTFILE File, uint64_t cNsTimestamp, const void *pvFrame, size_t cbFrame, size_t cbMax, bool fInbound,
+                    size_t *pcbWritten)
+{
+    static const uint8_t s_abPad[4] = { 0, 0, 0, 0 };
+    uint32_t const cbCaptured = (uint32_t)RT_MIN(cbFrame, cbMax);
+    uint32_t const cbPad      = RT_ALIGN_32(cbCaptured, 4) - cbCaptured;
+
+    /* epb_flags: inbound = 1, outbound = 2 in the direction bits. */
+    struct
+    {
+        struct pcapng_opt   Flags;
+        uint32_t            fFlags;
+        struct pcapng_opt   End;
+        uint32_t            cbTotal;
+    } Trailer;
+
+    struct pcapng_epb Epb;
+    Epb.block_type          = PCAPNG_BT_EPB;
+    Epb.block_total_length  = (uint32_t)(sizeof(Epb) + cbCaptured + cbPad + sizeof(Trailer));
+    Epb.interface_id        = 0;
+    Epb.timestamp_high      = (uint32_t)(cNsTimestamp >> 32);
+    Epb.timestamp_low       = (uint32_t)cNsTimestamp;
+    Epb.captured_len        = cbCaptured;
+    Epb.packet_len          = (uint32_t)cbFrame;
+
+    Trailer.Flags.code      = PCAPNG_OPT_EPB_FLAGS;
+    Trailer.Flags.length    = sizeof(uint32_t);
+    Trailer.fFlags          = fInbound ? 1 : 2;
+    Trailer.End.code        = PCAPNG_OPT_ENDOFOPT;
+    Trailer.End.length      = 0;
+    Trailer.cbTotal         = Epb.block_total_length;
+
+    size_t cbTotal = 0;
+    size_t cbWritten = 0;
+    int rc = RTFileWrite(File, &Epb, sizeof(Epb), &cbWritten);
+    cbTotal += cbWritten;
+    if (RT_SUCCESS(rc))
+    {
+        cbWritten = 0;
+        rc = RTFileWrite(File, pvFrame, cbCaptured, &cbWritten);
+        cbTotal += cbWritten;
+    }
+    if (RT_SUCCESS(rc) && cbPad)
+    {
+        cbWritten = 0;
+        rc = RTFileWrite(File, s_abPad, cbPad, &cbWritten);
+        cbTotal += cbWritten;
+    }
+    if (RT_SUCCESS(rc))
+    {
+        cbWritten = 0;
+        rc = RTFileWrite(File, &Trailer, sizeof(Trailer), &cbWritten);
+        cbTotal += cbWritten;
+    }
+    if (pcbWritten)
+        *pcbWritten = cbTotal;
+    return rc;
+}
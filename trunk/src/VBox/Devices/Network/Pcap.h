@@ -32,6 +32,12 @@ int PcapFileHdr(RTFILE File, uint64_t StartNanoTS);
 int PcapFileFrame(RTFILE File, uint64_t StartNanoTS, const void *pvFrame, size_t cbFrame, size_t cbMax);
 int PcapFileGsoFrame(RTFILE File, uint64_t StartNanoTS, PCPDMNETWORKGSO pGso,
                      const void *pvFrame, size_t cbFrame, size_t cbSegMax);
+int PcapFileFrameAt(RTFILE File, uint64_t cNsTimestamp, const void *pvFrame, size_t cbFrame, size_t cbMax,
+                    size_t *pcbWritten);
+
+int PcapNgFileHdr(RTFILE File, const char *pszIfName, uint32_t cbSnapLen);
+int PcapNgFileFrame(RTFILE File, uint64_t cNsTimestamp, const void *pvFrame, size_t cbFrame, size_t cbMax, bool fInbound,
+                    size_t *pcbWritten);
 
 RT_C_DECLS_END
 
@@ -119,6 +119,8 @@ DRV_PROFILE_COUNTER(NATRecvWait,"Time spent in NATRecv worker in waiting of free
 DRV_COUNTING_COUNTER(QueuePktSent, "counting packet sent via PDM Queue");
 DRV_COUNTING_COUNTER(QueuePktDropped, "counting packet drops by PDM Queue");
 DRV_COUNTING_COUNTER(ConsumerFalse, "counting consumer's reject number to process the queue's item");
+DRV_COUNTING_COUNTER(NATRecvGroFrames, "counting coalesced TCP super-frames passed to the guest");
+DRV_COUNTING_COUNTER(NATRecvGroSegs, "counting TCP segments coalesced into super-frames");
 # endif
 #endif /*!COUNTERS_INIT*/
 
@@ -97,6 +97,10 @@ signal_event(void)
 
 # define QUERYID queryid++
 
+static int dnsproxy_send_answer(PNATState pData, const char *answer, int nanswer,
+                                const unsigned short *pid, uint32_t age,
+                                struct sockaddr_in *dst);
+
 #endif
 /* timeout -- Called by the event loop when a query times out. Removes the
  * query from the queue.
@@ -120,6 +124,25 @@ timeout(PNATState pData, struct socket *so, void *arg)
     /* be paranoid */
     AssertPtrReturnVoid(arg);
 
+    if (req->held != NULL && req->dnsgen == pData->dnsgen)
+    {
+        /*
+         * Some raced server answered, just not with records and the others
+         * didn't answer at all.  Give the guest the last answer we got
+         * instead of asking yet another server.  It isn't cached, as not
+         * every raced server agreed on it.
+         */
+        Log2(("NAT: dnsproxy: timeout: forwarding held answer on %R[natsock]\n", so));
+        if (dnsproxy_send_answer(pData, req->held, req->nheld, &req->clientid, 0, &req->client))
+            ++answered_queries;
+        else
+            ++dropped_answers;
+        hash_remove_request(pData, req);
+        RTMemFree(req->held);
+        RTMemFree(req);
+        goto socket_clean_up;
+    }
+
     if (   req->dnsgen != pData->dnsgen
         || req->dns_server == NULL
         || (de = TAILQ_PREV(req->dns_server, dns_list_head, de_list)) == NULL)
@@ -131,6 +154,7 @@ timeout(PNATState pData, struct socket *so, void *arg)
                     req, req->dnsgen, pData->dnsgen, so));
         }
         hash_remove_request(pData, req);
+        RTMemFree(req->held);
         RTMemFree(req);
         ++removed_queries;
         /* the rest of clean up at the end of the method. */
@@ -190,6 +214,384 @@ timeout(PNATState pData, struct socket *so, void *arg)
 }
 #endif /* VBOX */
 
+#ifdef VBOX
+/* dnsproxy_sendto -- Sends the query to the DNS server de on the request's
+ * socket.  Returns the number of bytes sent or -1.
+ */
+static int
+dnsproxy_sendto(PNATState pData, struct socket *so, struct dns_entry *de,
+                char *buf, int byte, int retransmit)
+{
+    struct sockaddr_in addr;
+
+    memset(&addr, 0, sizeof(struct sockaddr_in));
+    addr.sin_family = AF_INET;
+    if (de->de_addr.s_addr == (pData->special_addr.s_addr | RT_H2N_U32_C(CTL_ALIAS))) {
+        /* undo loopback remapping done in get_dns_addr_domain() */
+        addr.sin_addr.s_addr = RT_N2H_U32_C(INADDR_LOOPBACK);
+    }
+    else {
+        addr.sin_addr.s_addr = de->de_addr.s_addr;
+    }
+    addr.sin_port = htons(53);
+
+    /* send it to our authoritative server */
+    Log2(("NAT: request will be %ssent to %RTnaipv4 on %R[natsock]\n",
+          retransmit ? "re" : "", addr.sin_addr, so));
+
+    byte = sendto(so->s, buf, (unsigned int)byte, 0,
+                  (struct sockaddr *)&addr,
+                  sizeof(struct sockaddr_in));
+    if (byte == -1)
+    {
+        LogRel(("NAT: sendto failed: %s\n", strerror(errno)));
+        return -1;
+    }
+
+    Log2(("NAT: request was %ssent to %RTnaipv4 on %R[natsock]\n",
+          retransmit ? "re" : "", addr.sin_addr, so));
+
+    ++authoritative_queries;
+    return byte;
+}
+
+
+/* dnsproxy_skip_name -- Returns the offset just past the (possibly
+ * compressed) domain name at off, or -1 if it runs past the message.
+ */
+static int
+dnsproxy_skip_name(const uint8_t *msg, int len, int off)
+{
+    while (off < len)
+    {
+        uint8_t label = msg[off];
+        if (label == 0)
+            return off + 1;
+        if ((label & 0xc0) == 0xc0)
+            return off + 2 <= len ? off + 2 : -1;
+        if (label & 0xc0)
+            return -1;
+        off += 1 + label;
+    }
+    return -1;
+}
+
+
+/* dnsproxy_walk_ttl -- Walks the resource records of a DNS message and
+ * returns the smallest TTL in *pminttl and, for negative answers, the
+ * SOA derived TTL of RFC 2308 in *pnegttl (UINT32_MAX if none).  When
+ * age is non-zero the TTLs are decremented by it in place.  Returns -1
+ * if the message is malformed.
+ */
+static int
+dnsproxy_walk_ttl(uint8_t *msg, int len, uint32_t age,
+                  uint32_t *pminttl, uint32_t *pnegttl)
+{
+    int qdcount = RT_MAKE_U16(msg[5], msg[4]);
+    int ancount = RT_MAKE_U16(msg[7], msg[6]);
+    int nscount = RT_MAKE_U16(msg[9], msg[8]);
+    int arcount = RT_MAKE_U16(msg[11], msg[10]);
+    int off = 12;
+    int i;
+
+    *pminttl = UINT32_MAX;
+    *pnegttl = UINT32_MAX;
+
+    for (i = 0; i < qdcount; ++i)
+    {
+        off = dnsproxy_skip_name(msg, len, off);
+        if (off < 0 || off + 4 > len)
+            return -1;
+        off += 4;
+    }
+
+    for (i = 0; i < ancount + nscount + arcount; ++i)
+    {
+        uint16_t type;
+        uint32_t ttl;
+        int rdlen;
+
+        off = dnsproxy_skip_name(msg, len, off);
+        if (off < 0 || off + 10 > len)
+            return -1;
+        type  = RT_MAKE_U16(msg[off + 1], msg[off]);
+        ttl   = RT_MAKE_U32_FROM_U8(msg[off + 7], msg[off + 6], msg[off + 5], msg[off + 4]);
+        rdlen = RT_MAKE_U16(msg[off + 9], msg[off + 8]);
+        if (off + 10 + rdlen > len)
+            return -1;
+
+        if (type != 41 /* OPT, the "TTL" is EDNS flags */)
+        {
+            if (ttl < *pminttl)
+                *pminttl = ttl;
+
+            if (type == 6 /* SOA */ && i >= ancount && i < ancount + nscount)
+            {
+                int rdoff = dnsproxy_skip_name(msg, len, off + 10);
+                if (rdoff >= 0)
+                    rdoff = dnsproxy_skip_name(msg, len, rdoff);
+                if (rdoff >= 0 && rdoff + 20 <= off + 10 + rdlen)
+                {
+                    uint32_t minimum = RT_MAKE_U32_FROM_U8(msg[rdoff + 19], msg[rdoff + 18],
+                                                           msg[rdoff + 17], msg[rdoff + 16]);
+                    *pnegttl = RT_MIN(ttl, minimum);
+                }
+            }
+
+            if (age)
+            {
+                ttl = ttl > age ? ttl - age : 0;
+                msg[off + 4] = RT_BYTE4(ttl);
+                msg[off + 5] = RT_BYTE3(ttl);
+                msg[off + 6] = RT_BYTE2(ttl);
+                msg[off + 7] = RT_BYTE1(ttl);
+            }
+        }
+
+        off += 10 + rdlen;
+    }
+
+    return 0;
+}
+
+
+/* dnsproxy_answer_class -- Returns -1 for an answer which settles the
+ * query, i.e. one carrying records or a truncated one the guest has to
+ * retry over TCP anyway.  Otherwise the answer is negative (NXDOMAIN, or
+ * NOERROR without records, i.e. NODATA) or an error like SERVFAIL or
+ * REFUSED, and its rcode is returned.
+ */
+static int
+dnsproxy_answer_class(const char *answer, int nanswer)
+{
+    const uint8_t *hdr = (const uint8_t *)answer;
+
+    if (nanswer < 12)
+        return -1;
+    if (   (hdr[2] & 0x02) /* TC */
+        || ((hdr[3] & 0x0f) == 0 && RT_MAKE_U16(hdr[7], hdr[6]) != 0))
+        return -1;
+    return hdr[3] & 0x0f;
+}
+
+
+/* dnsproxy_cache_key -- FNV-1a hash of the query sans id.
+ */
+static uint32_t
+dnsproxy_cache_key(const char *query, int nquery)
+{
+    uint32_t key = UINT32_C(2166136261);
+    int i;
+
+    for (i = 0; i < nquery; ++i)
+    {
+        key ^= (uint8_t)query[i];
+        key *= UINT32_C(16777619);
+    }
+    return key;
+}
+
+
+static void
+dnsproxy_cache_remove(PNATState pData, struct dnscache_entry *entry)
+{
+    LIST_REMOVE(entry, dc_hash);
+    TAILQ_REMOVE(&dnscache_lru, entry, dc_lru);
+    --dnscache_count;
+    RTMemFree(entry);
+}
+
+
+/* dnsproxy_cache_find -- Looks up the live cache entry for the query sans
+ * id, dropping it if it has expired or the resolvers have changed since.
+ */
+static struct dnscache_entry *
+dnsproxy_cache_find(PNATState pData, const char *query, int nquery, uint32_t key)
+{
+    struct dnscache_entry *entry;
+
+    LIST_FOREACH(entry, &dnscache_hash[key % DNSCACHE_HASHSIZE], dc_hash)
+    {
+        if (   entry->dc_key == key
+            && entry->dc_nquery == nquery
+            && memcmp(entry->dc_data, query, nquery) == 0)
+        {
+            if (   entry->dc_dnsgen != pData->dnsgen
+                || curtime - entry->dc_stored >= entry->dc_ttl)
+            {
+                dnsproxy_cache_remove(pData, entry);
+                return NULL;
+            }
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+
+/* dnsproxy_cache_store -- Caches the answer to the query (both with the id
+ * stripped) for the smallest TTL in it, or for the SOA derived TTL if it is
+ * a negative one.  Truncated answers and server failures aren't cached.
+ */
+static void
+dnsproxy_cache_store(PNATState pData, const char *query, int nquery,
+                     const char *answer, int nanswer)
+{
+    struct dnscache_entry *entry;
+    uint32_t key, ttl, minttl, negttl;
+    const uint8_t *hdr = (const uint8_t *)answer;
+    int rcode;
+
+    if (   nquery < 10
+        || nquery > DNSCACHE_MAXQUERY
+        || nanswer < 12
+        || nanswer > DNSCACHE_MAXANSWER)
+        return;
+
+    /* standard query response, not truncated, single question */
+    if (   (hdr[2] & 0xfa) != 0x80
+        || RT_MAKE_U16(hdr[5], hdr[4]) != 1)
+        return;
+
+    if (dnsproxy_walk_ttl((uint8_t *)answer, nanswer, 0, &minttl, &negttl) < 0)
+        return;
+
+    rcode = hdr[3] & 0x0f;
+    if (rcode == 0 && RT_MAKE_U16(hdr[7], hdr[6]) != 0)
+        ttl = RT_MIN(minttl, DNSCACHE_TTL_MAX);
+    else if (rcode == 0 || rcode == 3 /* NXDOMAIN */)
+        ttl = negttl != UINT32_MAX ? RT_MIN(negttl, DNSCACHE_NEGTTL_MAX) : 0;
+    else
+        ttl = 0;
+    if (ttl == 0)
+        return;
+
+    key = dnsproxy_cache_key(query, nquery);
+    entry = dnsproxy_cache_find(pData, query, nquery, key);
+    if (entry != NULL)
+        dnsproxy_cache_remove(pData, entry);
+    else if (dnscache_count >= DNSCACHE_MAXENTRIES)
+        dnsproxy_cache_remove(pData, TAILQ_FIRST(&dnscache_lru));
+
+    entry = RTMemAlloc(RT_UOFFSETOF(struct dnscache_entry, dc_data) + nquery + nanswer);
+    if (entry == NULL)
+        return;
+
+    entry->dc_key     = key;
+    entry->dc_dnsgen  = pData->dnsgen;
+    entry->dc_stored  = curtime;
+    entry->dc_ttl     = ttl * 1000;
+    entry->dc_nquery  = nquery;
+    entry->dc_nanswer = nanswer;
+    memcpy(entry->dc_data, query, nquery);
+    memcpy(entry->dc_data + nquery, answer, nanswer);
+
+    LIST_INSERT_HEAD(&dnscache_hash[key % DNSCACHE_HASHSIZE], entry, dc_hash);
+    TAILQ_INSERT_TAIL(&dnscache_lru, entry, dc_lru);
+    ++dnscache_count;
+
+    Log2(("NAT: dnsproxy: cached %d byte answer for %us\n", nanswer, ttl));
+}
+
+
+/* dnsproxy_send_answer -- Sends the answer to the guest at dst as coming
+ * from the DNS proxy, with the guest's query id *pid and the TTLs aged by
+ * age seconds.  Returns 1 if the answer was sent, 0 otherwise.
+ */
+static int
+dnsproxy_send_answer(PNATState pData, const char *answer, int nanswer,
+                     const unsigned short *pid, uint32_t age,
+                     struct sockaddr_in *dst)
+{
+    struct sockaddr_in src;
+    struct mbuf *mans;
+    void *pvBuf;
+    size_t cbBuf;
+    uint32_t minttl, negttl;
+    uint8_t *data;
+
+    mans = slirp_ext_m_get(pData, if_maxlinkhdr + sizeof(struct ip) + sizeof(struct udphdr)
+                                  + nanswer, &pvBuf, &cbBuf);
+    if (mans == NULL)
+        return 0;
+
+    /* reserve leading space for ethernet and protocol headers */
+    mans->m_data += if_maxlinkhdr;
+    mans->m_pkthdr.header = mtod(mans, void *);
+    mans->m_data += sizeof(struct ip) + sizeof(struct udphdr);
+
+    data = mtod(mans, uint8_t *);
+    memcpy(data, answer, nanswer);
+    mans->m_len = nanswer;
+
+    memcpy(data, pid, 2);
+    if (age)
+        dnsproxy_walk_ttl(data, nanswer, age, &minttl, &negttl);
+
+    slirpMbufTagService(pData, mans, CTL_DNS);
+
+    src.sin_addr.s_addr = RT_H2N_U32(RT_N2H_U32(pData->special_addr.s_addr) | CTL_DNS);
+    src.sin_port = RT_H2N_U16_C(53);
+
+    udp_output2(pData, NULL, mans, &src, dst, IPTOS_LOWDELAY);
+    return 1;
+}
+
+
+/* dnsproxy_cache_answer -- Answers the guest query in m (pointing at the
+ * IP header) from the cache.  Returns 1 if the answer was sent and the
+ * query needs no further processing, 0 otherwise.
+ */
+int
+dnsproxy_cache_answer(PNATState pData, struct mbuf *m, int iphlen)
+{
+    struct ip *ip = mtod(m, struct ip *);
+    struct udphdr *udp = (struct udphdr *)(m->m_data + iphlen);
+    char *buf = m->m_data + iphlen + sizeof(struct udphdr);
+    int byte = m->m_len - iphlen - (int)sizeof(struct udphdr);
+    struct dnscache_entry *entry;
+    struct sockaddr_in dst;
+
+    if (   byte < 12
+        || byte - 2 > DNSCACHE_MAXQUERY)
+        return 0;
+
+    entry = dnsproxy_cache_find(pData, buf + 2, byte - 2,
+                                dnsproxy_cache_key(buf + 2, byte - 2));
+    if (entry == NULL)
+    {
+        ++dnscache_misses;
+        return 0;
+    }
+
+    /* the guest's query id and the remaining TTLs */
+    dst.sin_addr.s_addr = ip->ip_src.s_addr;
+    dst.sin_port = udp->uh_sport;
+    if (!dnsproxy_send_answer(pData, entry->dc_data + entry->dc_nquery, entry->dc_nanswer,
+                              (const unsigned short *)buf,
+                              (curtime - entry->dc_stored) / 1000, &dst))
+        return 0;
+
+    /* keep the most recently used entries */
+    TAILQ_REMOVE(&dnscache_lru, entry, dc_lru);
+    TAILQ_INSERT_TAIL(&dnscache_lru, entry, dc_lru);
+    ++dnscache_hits;
+
+    Log2(("NAT: dnsproxy: answered %RTnaipv4 from the cache\n", dst.sin_addr));
+    return 1;
+}
+
+
+/* dnsproxy_cache_flush -- Drops all cached answers.
+ */
+void
+dnsproxy_cache_flush(PNATState pData)
+{
+    while (!TAILQ_EMPTY(&dnscache_lru))
+        dnsproxy_cache_remove(pData, TAILQ_FIRST(&dnscache_lru));
+}
+#endif /* VBOX */
+
 /* do_query -- Called by the event loop when a packet arrives at our
  * listening socket. Read the packet, create a new query, append it to the
  * queue and send it to the correct server.
@@ -218,8 +620,10 @@ dnsproxy_query(PNATState pData, struct socket *so, struct mbuf *m, int iphlen)
     char *buf;
     int retransmit;
     struct udphdr *udp;
+    struct dns_entry *de;
+    int cRace;
+    int cSent;
 #endif
-    struct sockaddr_in addr;
     struct request *req = NULL;
 #ifndef VBOX
     struct sockaddr_in fromaddr;
@@ -406,37 +810,35 @@ dnsproxy_query(PNATState pData, struct socket *so, struct mbuf *m, int iphlen)
     /* let's slirp to care about expiration */
     so->so_expire = curtime + recursive_timeout * 1000;
 
-    memset(&addr, 0, sizeof(struct sockaddr_in));
-    addr.sin_family = AF_INET;
-    if (req->dns_server->de_addr.s_addr == (pData->special_addr.s_addr | RT_H2N_U32_C(CTL_ALIAS))) {
-        /* undo loopback remapping done in get_dns_addr_domain() */
-        addr.sin_addr.s_addr = RT_N2H_U32_C(INADDR_LOOPBACK);
-    }
-    else {
-        addr.sin_addr.s_addr = req->dns_server->de_addr.s_addr;
+    /*
+     * A new query is raced against the first DNSPROXY_RACE_MAX servers,
+     * the first answer with records wins and the late ones are dropped by
+     * dnsproxy_answer(), which also deals with negative and error answers.
+     * req->dns_server is left at the last server tried, so timeout()
+     * continues with the ones not asked yet.
+     */
+    cRace = retransmit ? 1 : DNSPROXY_RACE_MAX;
+    cSent = 0;
+    for (de = req->dns_server; de != NULL; de = TAILQ_PREV(de, dns_list_head, de_list))
+    {
+        req->dns_server = de;
+        if (dnsproxy_sendto(pData, so, de, buf, byte, retransmit) != -1)
+            ++cSent;
+        if (--cRace == 0)
+            break;
     }
-    addr.sin_port = htons(53);
 
-    /* send it to our authoritative server */
-    Log2(("NAT: request will be %ssent to %RTnaipv4 on %R[natsock]\n",
-          retransmit ? "re" : "", addr.sin_addr, so));
-
-    byte = sendto(so->s, buf, (unsigned int)byte, 0,
-                  (struct sockaddr *)&addr,
-                  sizeof(struct sockaddr_in));
-    if (byte == -1)
+    if (cSent == 0)
     {
         /* XXX: is it really enough? */
-        LogRel(("NAT: sendto failed: %s\n", strerror(errno)));
         ++dropped_queries;
         return;
     }
 
-    so->so_state = SS_ISFCONNECTED; /* now it's selected */
-    Log2(("NAT: request was %ssent to %RTnaipv4 on %R[natsock]\n",
-          retransmit ? "re" : "", addr.sin_addr, so));
+    req->nracing = cSent;
+    req->nasked += cSent;
 
-    ++authoritative_queries;
+    so->so_state = SS_ISFCONNECTED; /* now it's selected */
 
 # if 0
     /* XXX: this stuff for _debugging_ only,
@@ -467,7 +869,7 @@ dnsproxy_query(PNATState pData, struct socket *so, struct mbuf *m, int iphlen)
 static void
 do_answer(int fd, short event, void *arg)
 #else
-void
+int
 dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m)
 #endif
 {
@@ -519,6 +921,7 @@ dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m)
 
     char *buf = NULL;
     int byte = 0;
+    int ansclass;
     struct request *query = NULL;
 
     AssertPtr(pData);
@@ -531,7 +934,7 @@ dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m)
     if (byte < 12) {
         LogRel(("NAT: Answer too short\n"));
         ++dropped_answers;
-        return;
+        return 1;
     }
 
     /* find corresponding query (XXX: but see below) */
@@ -545,7 +948,7 @@ dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m)
         ++late_answers;
         so->so_expire = curtime + SO_EXPIREFAST;
         Log2(("NAT: query wasn't found\n"));
-        return;
+        return 0;
     }
 
     /*
@@ -559,7 +962,40 @@ dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m)
      * use-after-free later on.
      */
     if (query != so->so_timeout_arg)
-        return;
+        return 0;
+
+    /*
+     * Only an answer with records ends the race right away.  A fast
+     * server answering NXDOMAIN, NODATA, SERVFAIL or REFUSED must not
+     * beat a slower one with the real answer, think of split DNS with a
+     * VPN resolver.  So such an answer is held while other raced servers
+     * may still answer, and forwarded when the last of them is in or, by
+     * timeout(), when they don't show up in time.
+     */
+    ansclass = m->m_next == NULL ? dnsproxy_answer_class(buf, byte) : -1;
+    if (ansclass != -1)
+    {
+        if (query->nnegative == 0)
+            query->negclass = ansclass;
+        else if (query->negclass != ansclass)
+            query->negclass = -1;
+        ++query->nnegative;
+
+        if (query->nracing > 1)
+        {
+            char *held = RTMemRealloc(query->held, byte);
+            if (held != NULL)
+            {
+                --query->nracing;
+                memcpy(held, buf, byte);
+                query->held = held;
+                query->nheld = byte;
+                Log2(("NAT: dnsproxy: holding rcode %d answer on %R[natsock]\n", ansclass, so));
+                return 0;
+            }
+            /* can't hold it, so forward it */
+        }
+    }
 
     so->so_timeout = NULL;
     so->so_timeout_arg = NULL;
@@ -571,7 +1007,19 @@ dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m)
 
     ++answered_queries;
 
+    /*
+     * A negative answer is only cached when every server the query was
+     * sent to agreed on it, so a resolver which doesn't know a split DNS
+     * name can't make it vanish for the negative TTL.
+     */
+    if (   m->m_next == NULL
+        && (   ansclass == -1
+            || (query->nnegative == query->nasked && query->negclass == ansclass)))
+        dnsproxy_cache_store(pData, query->byte + 2, query->nbyte - 2, buf, byte);
+
+    RTMemFree(query->held);
     RTMemFree(query);
+    return 1;
 #endif /* VBOX */
 }
 
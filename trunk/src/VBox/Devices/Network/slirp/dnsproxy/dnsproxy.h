@@ -88,11 +88,47 @@ struct request {
      */
     struct dns_entry    *dns_server;
     uint32_t            dnsgen;
+    /*
+     * Raced servers answering with an error or without records don't end
+     * the race, see dnsproxy_answer(): the last such answer is held here
+     * and forwarded once the other racers had their say or on timeout.
+     */
+    int nracing;    /* servers of the current race yet to answer */
+    int nasked;     /* servers the query was sent to in total */
+    int nnegative;  /* negative or error answers received */
+    int negclass;   /* their class, see dnsproxy_answer_class() */
+    int nheld;      /* length of the held answer */
+    char *held;     /* last negative or error answer, or NULL */
     int nbyte; /* length of dns request */
     char byte[1]; /* copy of original request */
 #endif
 };
 
+#ifdef VBOX
+/* Number of resolvers a new query is sent to in parallel. */
+# define DNSPROXY_RACE_MAX      2
+
+/* Limits of the answer cache. */
+# define DNSCACHE_MAXENTRIES    256
+# define DNSCACHE_MAXQUERY      512
+# define DNSCACHE_MAXANSWER     4096
+# define DNSCACHE_TTL_MAX       3600    /* seconds */
+# define DNSCACHE_NEGTTL_MAX    300     /* seconds, see RFC 2308 */
+
+/* A cached answer, keyed by the query sans its id. */
+struct dnscache_entry {
+    LIST_ENTRY(dnscache_entry)  dc_hash;
+    TAILQ_ENTRY(dnscache_entry) dc_lru;
+    uint32_t            dc_key;         /* hash of the query */
+    uint32_t            dc_dnsgen;      /* pData->dnsgen when stored */
+    uint32_t            dc_stored;      /* curtime when stored */
+    uint32_t            dc_ttl;         /* lifetime in ms */
+    int                 dc_nquery;      /* length of the query sans id */
+    int                 dc_nanswer;     /* length of the answer */
+    char                dc_data[1];     /* query sans id followed by the answer */
+};
+#endif
+
 #ifndef VBOX
 GLOBAL_INIT(unsigned int authoritative_port, 53);
 GLOBAL_INIT(unsigned int authoritative_timeout, 10);
@@ -151,7 +187,9 @@ void statistics_start(void);
 # define DPRINTF Log2
 int dnsproxy_init(PNATState pData);
 void dnsproxy_query(PNATState pData, struct socket *so, struct mbuf *m, int iphlen);
-void dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m);
+int dnsproxy_answer(PNATState pData, struct socket *so, struct mbuf *m);
+int dnsproxy_cache_answer(PNATState pData, struct mbuf *m, int iphlen);
+void dnsproxy_cache_flush(PNATState pData);
 #endif
 
 #endif /* _DNSPROXY_H_ */
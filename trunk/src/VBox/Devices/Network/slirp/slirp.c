@@ -386,6 +386,9 @@ int slirp_init(PNATState *ppData, uint32_t u32NetAddr, uint32_t u32Netmask,
     /* set default addresses */
     inet_aton("127.0.0.1", &loopback_addr);
 
+    /* dnsproxy answer cache */
+    TAILQ_INIT(&dnscache_lru);
+
     rc = slirpTftpInit(pData);
     AssertRCReturn(rc, VINF_NAT_DNS);
 
@@ -289,6 +289,9 @@ int slirpReleaseDnsSettings(PNATState pData)
     /* tell any pending dnsproxy requests their copy is expired */
     ++pData->dnsgen;
 
+    /* the cached answers came from the old resolvers */
+    dnsproxy_cache_flush(pData);
+
     LogFlowFuncLeaveRC(rc);
     return rc;
 }
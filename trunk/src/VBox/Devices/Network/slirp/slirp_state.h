@@ -284,6 +284,13 @@ typedef struct NATState
 #define HASHSIZE 10
 #define HASH(id) (id & ((1 << HASHSIZE) - 1))
     struct request *request_hash[1 << HASHSIZE];
+    /* dnsproxy answer cache */
+#define DNSCACHE_HASHSIZE 64
+    LIST_HEAD(RT_NOTHING, dnscache_entry) dnscache_hash[DNSCACHE_HASHSIZE];
+    TAILQ_HEAD(dnscache_lru_head, dnscache_entry) dnscache_lru;
+    unsigned int dnscache_count;
+    unsigned long dnscache_hits;
+    unsigned long dnscache_misses;
     /* this field control behaviour of DHCP server */
     bool fUseDnsProxy;
 
@@ -477,6 +484,11 @@ typedef struct NATState
 #define answered_queries pData->answered_queries
 #define dropped_answers pData->dropped_answers
 #define late_answers pData->late_answers
+#define dnscache_hash pData->dnscache_hash
+#define dnscache_lru pData->dnscache_lru
+#define dnscache_count pData->dnscache_count
+#define dnscache_hits pData->dnscache_hits
+#define dnscache_misses pData->dnscache_misses
 
 /* dnsproxy/dnsproxy.c */
 #define queryid pData->queryid
@@ -815,18 +815,24 @@ sorecvfrom(PNATState pData, struct socket *so)
              */
             if (   pData->fUseDnsProxy
                 && so->so_fport == RT_H2N_U16_C(53)
-                && CTL_CHECK(so->so_faddr.s_addr, CTL_DNS))
-                dnsproxy_answer(pData, so, m);
-
-            /* packets definetly will be fragmented, could confuse receiver peer. */
-            if (nread > if_mtu)
-                m->m_flags |= M_SKIP_FIREWALL;
-
-            /*
-             * If this packet was destined for CTL_ADDR,
-             * make it look like that's where it came from, done by udp_output
-             */
-            udp_output(pData, so, m, &addr);
+                && CTL_CHECK(so->so_faddr.s_addr, CTL_DNS)
+                && !dnsproxy_answer(pData, so, m))
+            {
+                /* late or held answer from one of the raced resolvers */
+                m_freem(pData, m);
+            }
+            else
+            {
+                /* packets definetly will be fragmented, could confuse receiver peer. */
+                if (nread > if_mtu)
+                    m->m_flags |= M_SKIP_FIREWALL;
+
+                /*
+                 * If this packet was destined for CTL_ADDR,
+                 * make it look like that's where it came from, done by udp_output
+                 */
+                udp_output(pData, so, m, &addr);
+            }
         }
         else
         {
@@ -227,6 +227,8 @@ udp_input(PNATState pData, register struct mbuf *m, int iphlen)
         && CTL_CHECK(ip->ip_dst.s_addr, CTL_DNS)
         && (uh->uh_dport == RT_H2N_U16_C(53)))
     {
+        if (dnsproxy_cache_answer(pData, m, iphlen))
+            goto done_free_mbuf;
         so = NULL;
         goto new_socket;
     }
@@ -46,7 +46,9 @@
 #include <iprt/assert.h>
 #include <iprt/cpp/autores.h>
 #include <iprt/cpp/utils.h>
+#include <iprt/critsect.h>
 #include <iprt/err.h>
+#include <iprt/list.h>
 #include <iprt/mem.h>
 #include <iprt/req.h>
 #include <iprt/string.h>
@@ -56,6 +58,9 @@
 
 #include <string>
 #include <list>
+#include <algorithm>
+#include <map>
+#include <vector>
 
 /** @todo Delete the old !ASYNC_HOST_NOTIFY code and remove this define. */
 #define ASYNC_HOST_NOTIFY
@@ -131,6 +136,39 @@ struct Property
 /** The properties list type */
 typedef std::list <Property> PropertyList;
 
+/**
+ * Orders property names the same way as RTStrSimplePatternMatch() compares
+ * them, i.e. case sensitively, so that all names starting with a given
+ * prefix form one range.
+ */
+struct PropertyNameLess
+{
+    bool operator()(const char *pszName1, const char *pszName2) const
+    {
+        return strcmp(pszName1, pszName2) < 0;
+    }
+};
+/** The ordered property name index type, keyed by Property::mName. */
+typedef std::map <const char *, Property *, PropertyNameLess> PropertyIndex;
+
+#ifdef ASYNC_HOST_NOTIFY
+/**
+ * A host notification waiting to be delivered by the notification thread.
+ * The strings are stored right after the structure.
+ */
+typedef struct HOSTNOTIFYENTRY
+{
+    /** The pending notification list node. */
+    RTLISTNODE          ListNode;
+    /** The string space core, keyed by the property name. */
+    RTSTRSPACECORE      StrCore;
+    /** The data passed to the host callback. */
+    HOSTCALLBACKDATA    Data;
+} HOSTNOTIFYENTRY;
+/** Pointer to a pending host notification. */
+typedef HOSTNOTIFYENTRY *PHOSTNOTIFYENTRY;
+#endif
+
 /**
  * Structure for holding an uncompleted guest call
  */
@@ -158,6 +196,9 @@ struct GuestCall
 };
 /** The guest call list type */
 typedef std::list <GuestCall> CallList;
+/** Guest calls by the property names they wait for, used for the calls
+ *  whose patterns are plain names without wildcards. */
+typedef std::multimap <std::string, CallList::iterator> CallIndex;
 
 /**
  * Class containing the shared information service functionality.
@@ -175,11 +216,19 @@ private:
     RTSTRSPACE mhProperties;
     /** The number of properties. */
     unsigned mcProperties;
+    /** The properties ordered by name, used for enumerating by prefix. */
+    PropertyIndex mPropertyIndex;
     /** The list of property changes for guest notifications;
      *  only used for timestamp tracking in notifications at the moment */
     PropertyList mGuestNotifications;
-    /** The list of outstanding guest notification calls */
+    /** The list of outstanding guest notification calls with wildcard
+     *  patterns */
     CallList mGuestWaiters;
+    /** The list of outstanding guest notification calls which wait for
+     *  plain property names */
+    CallList mGuestWaitersByName;
+    /** mGuestWaitersByName indexed by the names they wait for */
+    CallIndex mGuestWaiterIndex;
     /** @todo we should have classes for thread and request handler thread */
     /** Callback function supplied by the host for notification of updates
      * to properties */
@@ -278,6 +327,42 @@ private:
         return (Property *)RTStrSpaceGet(&mhProperties, pszName);
     }
 
+    /**
+     * Adds a new property to the string space and the name index.
+     *
+     * @returns IPRT status code.
+     * @param   pProp       The property, the caller deletes it on failure.
+     */
+    int insertPropertyInternal(Property *pProp)
+    {
+        if (!RTStrSpaceInsert(&mhProperties, &pProp->mStrCore))
+            return VERR_ALREADY_EXISTS;
+        try
+        {
+            mPropertyIndex[pProp->mName.c_str()] = pProp;
+        }
+        catch (std::bad_alloc)
+        {
+            RTStrSpaceRemove(&mhProperties, pProp->mStrCore.pszString);
+            return VERR_NO_MEMORY;
+        }
+        mcProperties++;
+        return VINF_SUCCESS;
+    }
+
+    /**
+     * Removes a property from the string space and the name index.
+     *
+     * @param   pProp       The property, the caller deletes it.
+     */
+    void removePropertyInternal(Property *pProp)
+    {
+        PRTSTRSPACECORE pStrCore = RTStrSpaceRemove(&mhProperties, pProp->mStrCore.pszString);
+        AssertPtr(pStrCore); NOREF(pStrCore);
+        mPropertyIndex.erase(pProp->mName.c_str());
+        mcProperties--;
+    }
+
 public:
     explicit Service(PVBOXHGCMSVCHELPERS pHelpers)
         : mpHelpers(pHelpers)
@@ -291,8 +376,15 @@ public:
 #ifdef ASYNC_HOST_NOTIFY
         , mhThreadNotifyHost(NIL_RTTHREAD)
         , mhReqQNotifyHost(NIL_RTREQQUEUE)
+        , mhPendingNotify(NULL)
+        , mfNotifyQueued(false)
+#endif
+    {
+#ifdef ASYNC_HOST_NOTIFY
+        RT_ZERO(mCritSectNotify);
+        RTListInit(&mPendingNotifyList);
 #endif
-    { }
+    }
 
     /**
      * @interface_method_impl{VBOXHGCMSVCFNTABLE,pfnUnload}
@@ -385,11 +477,15 @@ private:
     int setProperty(uint32_t cParms, VBOXHGCMSVCPARM paParms[], bool isGuest);
     int delProperty(uint32_t cParms, VBOXHGCMSVCPARM paParms[], bool isGuest);
     int enumProps(uint32_t cParms, VBOXHGCMSVCPARM paParms[]);
+    int enumPropsByPrefix(const char *pszPatterns, void *pvEnumData);
     int getNotification(uint32_t u32ClientId, VBOXHGCMCALLHANDLE callHandle, uint32_t cParms,
                         VBOXHGCMSVCPARM paParms[]);
     int getOldNotificationInternal(const char *pszPattern,
                                    uint64_t u64Timestamp, Property *pProp);
     int getNotificationWriteOut(uint32_t cParms, VBOXHGCMSVCPARM paParms[], Property prop);
+    static bool isPlainNameList(const char *pszPatterns);
+    void addGuestWaiter(const GuestCall &call, const char *pszPatterns);
+    void removeGuestWaiterByName(CallList::iterator itCall);
     int doNotifications(const char *pszProperty, uint64_t u64Timestamp);
     int notifyHost(const char *pszName, const char *pszValue,
                    uint64_t u64Timestamp, const char *pszFlags);
@@ -407,7 +503,17 @@ private:
     RTTHREAD mhThreadNotifyHost;
     /* Queue for handling requests for notifications. */
     RTREQQUEUE mhReqQNotifyHost;
+    /** Protects the pending host notifications and mfNotifyQueued. */
+    RTCRITSECT mCritSectNotify;
+    /** Host notifications not delivered yet, oldest first (HOSTNOTIFYENTRY). */
+    RTLISTANCHOR mPendingNotifyList;
+    /** The pending host notifications by property name, for coalescing. */
+    RTSTRSPACE mhPendingNotify;
+    /** Whether a notifyHostBatch() request is queued and has not started
+     *  taking the pending notifications yet. */
+    bool mfNotifyQueued;
     static DECLCALLBACK(int) threadNotifyHost(RTTHREAD self, void *pvUser);
+    static DECLCALLBACK(void) notifyHostBatch(Service *pThis);
 #endif
 
     DECLARE_CLS_COPY_CTOR_ASSIGN_NOOP(Service);
@@ -556,13 +662,11 @@ int Service::setPropertyBlock(uint32_t cParms, VBOXHGCMSVCPARM paParms[])
                         rc = VERR_NO_MEMORY;
                         break;
                     }
-                    if (RTStrSpaceInsert(&mhProperties, &pProp->mStrCore))
-                        mcProperties++;
-                    else
+                    rc = insertPropertyInternal(pProp);
+                    if (RT_FAILURE(rc))
                     {
                         delete pProp;
-                        rc = VERR_INTERNAL_ERROR_3;
-                        AssertFailedBreak();
+                        AssertMsgFailedBreak(("%Rrc\n", rc));
                     }
                 }
             }
@@ -733,14 +837,11 @@ int Service::setProperty(uint32_t cParms, VBOXHGCMSVCPARM paParms[], bool isGues
                 pProp = new Property(pcszName, pcszValue, u64TimeNano, fFlags);
                 AssertPtr(pProp);
 
-                if (RTStrSpaceInsert(&mhProperties, &pProp->mStrCore))
-                    mcProperties++;
-                else
+                rc = insertPropertyInternal(pProp);
+                if (RT_FAILURE(rc))
                 {
-                    AssertFailed();
+                    AssertMsg(rc == VERR_NO_MEMORY, ("%Rrc\n", rc));
                     delete pProp;
-
-                    rc = VERR_ALREADY_EXISTS;
                 }
             }
             catch (std::bad_alloc)
@@ -813,9 +914,7 @@ int Service::delProperty(uint32_t cParms, VBOXHGCMSVCPARM paParms[], bool isGues
     if (rc == VINF_SUCCESS && pProp)
     {
         uint64_t u64Timestamp = getCurrentTimestamp();
-        PRTSTRSPACECORE pStrCore = RTStrSpaceRemove(&mhProperties, pProp->mStrCore.pszString);
-        AssertPtr(pStrCore); NOREF(pStrCore);
-        mcProperties--;
+        removePropertyInternal(pProp);
         delete pProp;
         // if (isGuest)  /* Notify the host even for properties that the host
         //                * changed.  Less efficient, but ensures consistency. */
@@ -895,6 +994,64 @@ static DECLCALLBACK(int) enumPropsCallback(PRTSTRSPACECORE pStr, void *pvUser)
     return 0;
 }
 
+/**
+ * Enumerates the properties matching @a pszPatterns using the name index,
+ * visiting only the names starting with the literal prefix of one of the
+ * patterns.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NOT_SUPPORTED if one of the patterns starts with a wildcard,
+ *          the caller should enumerate all properties instead.
+ * @param   pszPatterns The '|' separated patterns.
+ * @param   pvEnumData  The enumeration data for enumPropsCallback.
+ * @thread  HGCM
+ */
+int Service::enumPropsByPrefix(const char *pszPatterns, void *pvEnumData)
+{
+    /*
+     * Collect the literal prefixes, i.e. the part before the first wildcard.
+     */
+    if (!*pszPatterns)
+        return VERR_NOT_SUPPORTED;
+    std::vector<std::string> vecPrefixes;
+    for (const char *pszCur = pszPatterns;;)
+    {
+        size_t cchPrefix = strcspn(pszCur, "*?|");
+        if (!cchPrefix)
+            return VERR_NOT_SUPPORTED;
+        vecPrefixes.push_back(std::string(pszCur, cchPrefix));
+
+        const char *pszNext = strchr(pszCur + cchPrefix, '|');
+        if (!pszNext)
+            break;
+        pszCur = pszNext + 1;
+    }
+
+    /*
+     * Sort them and drop those covered by a shorter one, so that no property
+     * is visited twice.  Then walk the index range of each remaining prefix.
+     */
+    std::sort(vecPrefixes.begin(), vecPrefixes.end());
+    const std::string *pLastPrefix = NULL;
+    for (std::vector<std::string>::const_iterator itPrefix = vecPrefixes.begin(); itPrefix != vecPrefixes.end(); ++itPrefix)
+    {
+        if (pLastPrefix && itPrefix->compare(0, pLastPrefix->size(), *pLastPrefix) == 0)
+            continue;
+        pLastPrefix = &*itPrefix;
+
+        for (PropertyIndex::const_iterator it = mPropertyIndex.lower_bound(itPrefix->c_str());
+                it != mPropertyIndex.end()
+             && strncmp(it->first, itPrefix->c_str(), itPrefix->size()) == 0;
+             ++it)
+        {
+            int rc = enumPropsCallback(&it->second->mStrCore, pvEnumData);
+            if (rc != 0)
+                return rc;
+        }
+    }
+    return VINF_SUCCESS;
+}
+
 /**
  * Enumerate guest properties by mask, checking the validity
  * of the arguments passed.
@@ -948,7 +1105,9 @@ int Service::enumProps(uint32_t cParms, VBOXHGCMSVCPARM paParms[])
         EnumData.pchCur     = pchBuf;
         EnumData.cbLeft     = cbBuf;
         EnumData.cbNeeded   = 0;
-        rc = RTStrSpaceEnumerate(&mhProperties, enumPropsCallback, &EnumData);
+        rc = enumPropsByPrefix(szPatterns, &EnumData);
+        if (rc == VERR_NOT_SUPPORTED)
+            rc = RTStrSpaceEnumerate(&mhProperties, enumPropsCallback, &EnumData);
         AssertRCSuccess(rc);
         if (RT_SUCCESS(rc))
         {
@@ -1090,9 +1249,12 @@ int Service::getNotification(uint32_t u32ClientId, VBOXHGCMCALLHANDLE callHandle
                  * Check if the client already had the same request.
                  * Complete the old request with an error in this case.
                  * Protection against clients, which cancel and resubmits requests.
+                 * Identical patterns always end up in the same list.
                  */
-                CallList::iterator it = mGuestWaiters.begin();
-                while (it != mGuestWaiters.end())
+                bool const fByName = isPlainNameList(pszPatterns);
+                CallList &rWaiters = fByName ? mGuestWaitersByName : mGuestWaiters;
+                CallList::iterator it = rWaiters.begin();
+                while (it != rWaiters.end())
                 {
                     const char *pszPatternsExisting;
                     uint32_t cchPatternsExisting;
@@ -1104,15 +1266,26 @@ int Service::getNotification(uint32_t u32ClientId, VBOXHGCMCALLHANDLE callHandle
                     {
                         /* Complete the old request. */
                         mpHelpers->pfnCallComplete(it->mHandle, VERR_INTERRUPTED);
-                        it = mGuestWaiters.erase(it);
+                        CallList::iterator itOld = it++;
+                        if (fByName)
+                            removeGuestWaiterByName(itOld);
+                        else
+                            rWaiters.erase(itOld);
                     }
                     else
                         ++it;
                 }
 
-                mGuestWaiters.push_back(GuestCall(u32ClientId, callHandle, GET_NOTIFICATION,
-                                                  cParms, paParms, rc));
-                rc = VINF_HGCM_ASYNC_EXECUTE;
+                try
+                {
+                    addGuestWaiter(GuestCall(u32ClientId, callHandle, GET_NOTIFICATION,
+                                             cParms, paParms, rc), pszPatterns);
+                    rc = VINF_HGCM_ASYNC_EXECUTE;
+                }
+                catch (std::bad_alloc)
+                {
+                    rc = VERR_NO_MEMORY;
+                }
             }
             /*
              * Otherwise reply at once with the enqueued notification we found.
@@ -1131,6 +1304,92 @@ int Service::getNotification(uint32_t u32ClientId, VBOXHGCMCALLHANDLE callHandle
 }
 
 
+/**
+ * Checks whether a GET_NOTIFICATION pattern list only consists of plain
+ * property names, i.e. contains no wildcards and does not match everything.
+ *
+ * @returns true if so, false if not.
+ * @param   pszPatterns     The '|' separated pattern list.
+ */
+/* static */
+bool Service::isPlainNameList(const char *pszPatterns)
+{
+    return    pszPatterns[0] != '\0'
+           && strpbrk(pszPatterns, "*?") == NULL;
+}
+
+/**
+ * Queues a GET_NOTIFICATION call until a matching property changes.
+ *
+ * Calls which wait for plain property names are indexed by those names so
+ * that doNotifications() does not have to match them against every change.
+ *
+ * @param   call            The call to queue.
+ * @param   pszPatterns     The patterns of the call.
+ *
+ * @throws  std::bad_alloc
+ */
+void Service::addGuestWaiter(const GuestCall &call, const char *pszPatterns)
+{
+    if (!isPlainNameList(pszPatterns))
+    {
+        mGuestWaiters.push_back(call);
+        return;
+    }
+
+    CallList::iterator itCall = mGuestWaitersByName.insert(mGuestWaitersByName.end(), call);
+    try
+    {
+        const char *pszName = pszPatterns;
+        for (;;)
+        {
+            const char *pszEnd = strchr(pszName, '|');
+            size_t cchName = pszEnd ? (size_t)(pszEnd - pszName) : strlen(pszName);
+            if (cchName)
+                mGuestWaiterIndex.insert(std::make_pair(std::string(pszName, cchName), itCall));
+            if (!pszEnd)
+                break;
+            pszName = pszEnd + 1;
+        }
+    }
+    catch (std::bad_alloc)
+    {
+        removeGuestWaiterByName(itCall);
+        throw;
+    }
+}
+
+/**
+ * Removes a call waiting for plain property names and its index entries.
+ *
+ * @param   itCall          The call in mGuestWaitersByName.
+ */
+void Service::removeGuestWaiterByName(CallList::iterator itCall)
+{
+    const char *pszPatterns;
+    uint32_t cchPatterns;
+    if (RT_SUCCESS(itCall->mParms[0].getString(&pszPatterns, &cchPatterns)))
+    {
+        const char *pszName = pszPatterns;
+        for (;;)
+        {
+            const char *pszEnd = strchr(pszName, '|');
+            size_t cchName = pszEnd ? (size_t)(pszEnd - pszName) : strlen(pszName);
+            std::pair<CallIndex::iterator, CallIndex::iterator> Range
+                = mGuestWaiterIndex.equal_range(std::string(pszName, cchName));
+            for (CallIndex::iterator it = Range.first; it != Range.second; )
+                if (it->second == itCall)
+                    mGuestWaiterIndex.erase(it++);
+                else
+                    ++it;
+            if (!pszEnd)
+                break;
+            pszName = pszEnd + 1;
+        }
+    }
+    mGuestWaitersByName.erase(itCall);
+}
+
 /**
  * Notify the service owner and the guest that a property has been
  * added/deleted/changed
@@ -1169,6 +1428,25 @@ int Service::doNotifications(const char *pszProperty, uint64_t u64Timestamp)
     int rc = VINF_SUCCESS;
     try
     {
+        /* Calls waiting for plain names are looked up by the property name.
+         * Collect them first, completing one removes its index entries. */
+        std::vector<CallList::iterator> vecByName;
+        std::pair<CallIndex::const_iterator, CallIndex::const_iterator> Range
+            = mGuestWaiterIndex.equal_range(prop.mName);
+        for (CallIndex::const_iterator itIdx = Range.first; itIdx != Range.second; ++itIdx)
+            if (std::find(vecByName.begin(), vecByName.end(), itIdx->second) == vecByName.end())
+                vecByName.push_back(itIdx->second);
+        for (size_t i = 0; i < vecByName.size(); i++)
+        {
+            GuestCall curCall = *vecByName[i];
+            int rc2 = getNotificationWriteOut(curCall.mParmsCnt, curCall.mParms, prop);
+            if (RT_SUCCESS(rc2))
+                rc2 = curCall.mRc;
+            mpHelpers->pfnCallComplete(curCall.mHandle, rc2);
+            removeGuestWaiterByName(vecByName[i]);
+        }
+
+        /* The remaining calls have wildcard patterns. */
         CallList::iterator it = mGuestWaiters.begin();
         while (it != mGuestWaiters.end())
         {
@@ -1232,14 +1510,35 @@ int Service::doNotifications(const char *pszProperty, uint64_t u64Timestamp)
 }
 
 #ifdef ASYNC_HOST_NOTIFY
-static DECLCALLBACK(void) notifyHostAsyncWorker(PFNHGCMSVCEXT pfnHostCallback,
-                                                void *pvHostData,
-                                                HOSTCALLBACKDATA *pHostCallbackData)
+/**
+ * Delivers all pending host notifications.
+ *
+ * Only one of these requests is queued at a time, so a burst of property
+ * changes costs a single request and the notifications for a property which
+ * changed again before the host saw it are reduced to the latest one.
+ *
+ * @param   pThis       The service instance.
+ * @thread  GSTPROPNTFY
+ */
+/* static */
+DECLCALLBACK(void) Service::notifyHostBatch(Service *pThis)
 {
-    pfnHostCallback(pvHostData, 0 /*u32Function*/,
-                   (void *)pHostCallbackData,
-                   sizeof(HOSTCALLBACKDATA));
-    RTMemFree(pHostCallbackData);
+    RTLISTANCHOR Batch;
+    RTCritSectEnter(&pThis->mCritSectNotify);
+    RTListMove(&Batch, &pThis->mPendingNotifyList);
+    pThis->mhPendingNotify = NULL;
+    pThis->mfNotifyQueued  = false;
+    RTCritSectLeave(&pThis->mCritSectNotify);
+
+    PHOSTNOTIFYENTRY pEntry, pNext;
+    RTListForEachSafe(&Batch, pEntry, pNext, HOSTNOTIFYENTRY, ListNode)
+    {
+        PFNHGCMSVCEXT pfnHostCallback = pThis->mpfnHostCallback;
+        if (pfnHostCallback)
+            pfnHostCallback(pThis->mpvHostData, 0 /*u32Function*/,
+                            (void *)&pEntry->Data, sizeof(HOSTCALLBACKDATA));
+        RTMemFree(pEntry);
+    }
 }
 #endif
 
@@ -1263,12 +1562,12 @@ int Service::notifyHost(const char *pszName, const char *pszValue,
     size_t cbName = pszName? strlen(pszName): 0;
     size_t cbValue = pszValue? strlen(pszValue): 0;
     size_t cbFlags = pszFlags? strlen(pszFlags): 0;
-    size_t cbAlloc = sizeof(HOSTCALLBACKDATA) + cbName + cbValue + cbFlags + 3;
-    HOSTCALLBACKDATA *pHostCallbackData = (HOSTCALLBACKDATA *)RTMemAlloc(cbAlloc);
-    if (pHostCallbackData)
+    size_t cbAlloc = sizeof(HOSTNOTIFYENTRY) + cbName + cbValue + cbFlags + 3;
+    PHOSTNOTIFYENTRY pEntry = (PHOSTNOTIFYENTRY)RTMemAllocZ(cbAlloc);
+    if (pEntry)
     {
-        uint8_t *pu8 = (uint8_t *)pHostCallbackData;
-        pu8 += sizeof(HOSTCALLBACKDATA);
+        HOSTCALLBACKDATA *pHostCallbackData = &pEntry->Data;
+        uint8_t *pu8 = (uint8_t *)(pEntry + 1);
 
         pHostCallbackData->u32Magic     = HOSTCALLBACKMAGIC;
 
@@ -1289,12 +1588,38 @@ int Service::notifyHost(const char *pszName, const char *pszValue,
         pu8 += cbFlags;
         *pu8++ = 0;
 
-        rc = RTReqQueueCallEx(mhReqQNotifyHost, NULL, 0, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
-                              (PFNRT)notifyHostAsyncWorker, 3,
-                              mpfnHostCallback, mpvHostData, pHostCallbackData);
-        if (RT_FAILURE(rc))
+        pEntry->StrCore.pszString = pHostCallbackData->pcszName;
+
+        /*
+         * Queue it, replacing any older notification for the same property
+         * which the host has not seen yet.  Only post a request to the
+         * notification thread if none is outstanding.
+         */
+        RTCritSectEnter(&mCritSectNotify);
+        PHOSTNOTIFYENTRY pOld = (PHOSTNOTIFYENTRY)RTStrSpaceRemove(&mhPendingNotify, pEntry->StrCore.pszString);
+        if (pOld)
+        {
+            pOld = RT_FROM_MEMBER(pOld, HOSTNOTIFYENTRY, StrCore);
+            RTListNodeRemove(&pOld->ListNode);
+            RTMemFree(pOld);
+        }
+        RTStrSpaceInsert(&mhPendingNotify, &pEntry->StrCore);
+        RTListAppend(&mPendingNotifyList, &pEntry->ListNode);
+        bool const fQueue = !mfNotifyQueued;
+        mfNotifyQueued = true;
+        RTCritSectLeave(&mCritSectNotify);
+
+        if (fQueue)
         {
-            RTMemFree(pHostCallbackData);
+            rc = RTReqQueueCallEx(mhReqQNotifyHost, NULL, 0, RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT,
+                                  (PFNRT)notifyHostBatch, 1, this);
+            if (RT_FAILURE(rc))
+            {
+                /* Leave the notifications pending, the next change retries. */
+                RTCritSectEnter(&mCritSectNotify);
+                mfNotifyQueued = false;
+                RTCritSectLeave(&mCritSectNotify);
+            }
         }
     }
     else
@@ -1417,8 +1742,10 @@ static DECLCALLBACK(int) dbgInfoCallback(PRTSTRSPACECORE pStr, void *pvUser)
 
 void Service::dbgInfoShow(PCDBGFINFOHLP pHlp)
 {
+    /* Use the name index so the properties are listed in sorted order. */
     ENUMDBGINFO EnumData = { pHlp };
-    RTStrSpaceEnumerate(&mhProperties, dbgInfoCallback, &EnumData);
+    for (PropertyIndex::const_iterator it = mPropertyIndex.begin(); it != mPropertyIndex.end(); ++it)
+        dbgInfoCallback(&it->second->mStrCore, &EnumData);
 }
 
 /**
@@ -1559,7 +1886,9 @@ static DECLCALLBACK(int) wakeupNotifyHost(void)
 int Service::initialize()
 {
     /* The host notification thread and queue. */
-    int rc = RTReqQueueCreate(&mhReqQNotifyHost);
+    int rc = RTCritSectInit(&mCritSectNotify);
+    if (RT_SUCCESS(rc))
+        rc = RTReqQueueCreate(&mhReqQNotifyHost);
     if (RT_SUCCESS(rc))
     {
         rc = RTThreadCreate(&mhThreadNotifyHost,
@@ -1578,6 +1907,8 @@ int Service::initialize()
             RTReqQueueDestroy(mhReqQNotifyHost);
             mhReqQNotifyHost = NIL_RTREQQUEUE;
         }
+        if (RTCritSectIsInitialized(&mCritSectNotify))
+            RTCritSectDelete(&mCritSectNotify);
     }
 
     return rc;
@@ -1601,6 +1932,15 @@ int Service::uninit()
         mhReqQNotifyHost = NIL_RTREQQUEUE;
         mhThreadNotifyHost = NIL_RTTHREAD;
     }
+
+    /* Drop the notifications which could not be queued. */
+    PHOSTNOTIFYENTRY pEntry, pNext;
+    RTListForEachSafe(&mPendingNotifyList, pEntry, pNext, HOSTNOTIFYENTRY, ListNode)
+        RTMemFree(pEntry);
+    RTListInit(&mPendingNotifyList);
+    mhPendingNotify = NULL;
+    if (RTCritSectIsInitialized(&mCritSectNotify))
+        RTCritSectDelete(&mCritSectNotify);
 #endif
 
     return VINF_SUCCESS;
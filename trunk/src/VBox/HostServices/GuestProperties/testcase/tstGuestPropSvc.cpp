@@ -21,7 +21,11 @@
 *   Header Files                                                                                                                 *
 *********************************************************************************************************************************/
 #include <VBox/HostServices/GuestPropertySvc.h>
+#include <iprt/asm.h>
+#include <iprt/semaphore.h>
+#include <iprt/string.h>
 #include <iprt/test.h>
+#include <iprt/thread.h>
 #include <iprt/time.h>
 
 
@@ -313,6 +317,19 @@ static const struct enumStringStruct
         g_apchEnumResult1,
         g_acbEnumResult1,
         g_cbEnumBuffer1
+    },
+    {
+        "/test/*\0TEST*", sizeof("/test/*\0TEST*"),
+        g_apchEnumResult1,
+        g_acbEnumResult1,
+        g_cbEnumBuffer1
+    },
+    {
+        /* Overlapping prefixes must not report a property twice. */
+        "/t*|/test/n*|TEST NAME", sizeof("/t*|/test/n*|TEST NAME"),
+        g_apchEnumResult1,
+        g_acbEnumResult1,
+        g_cbEnumBuffer1
     }
 };
 
@@ -1133,7 +1150,176 @@ static void test6(void)
     RTTESTI_CHECK_RC_OK(svcTable.pfnUnload(svcTable.pvService));
 }
 
+/** State of the host callback used by test7. */
+static struct
+{
+    /** Signalled when the first notification is being delivered. */
+    RTSEMEVENT          hEvtEntered;
+    /** The first notification waits for this before returning. */
+    RTSEMEVENT          hEvtRelease;
+    /** The number of notifications delivered. */
+    uint32_t volatile   cCalls;
+    /** The names of the first few notifications. */
+    char                aszNames[8][MAX_NAME_LEN];
+    /** The values of the first few notifications. */
+    char                aszValues[8][MAX_VALUE_LEN];
+    /** The timestamps of the first few notifications. */
+    uint64_t            au64Timestamps[8];
+} g_HostNotify;
+
+/** Host callback for test7, holds up the notification thread on the first
+ * notification until the test releases it. */
+static DECLCALLBACK(int) hostNotifyCallback(void *pvExtension, uint32_t u32Function, void *pvParms, uint32_t cbParms)
+{
+    RT_NOREF2(pvExtension, u32Function);
+    PHOSTCALLBACKDATA pData = (PHOSTCALLBACKDATA)pvParms;
+    RTTESTI_CHECK_RET(cbParms == sizeof(HOSTCALLBACKDATA), VERR_INVALID_PARAMETER);
+    RTTESTI_CHECK_RET(pData->u32Magic == HOSTCALLBACKMAGIC, VERR_INVALID_PARAMETER);
+
+    uint32_t i = g_HostNotify.cCalls;
+    if (i < RT_ELEMENTS(g_HostNotify.aszNames))
+    {
+        RTStrCopy(g_HostNotify.aszNames[i], sizeof(g_HostNotify.aszNames[i]), pData->pcszName);
+        RTStrCopy(g_HostNotify.aszValues[i], sizeof(g_HostNotify.aszValues[i]), pData->pcszValue);
+        g_HostNotify.au64Timestamps[i] = pData->u64Timestamp;
+    }
+    ASMAtomicIncU32(&g_HostNotify.cCalls);
+
+    if (i == 0)
+    {
+        RTSemEventSignal(g_HostNotify.hEvtEntered);
+        RTSemEventWait(g_HostNotify.hEvtRelease, 30000);
+    }
+    return VINF_SUCCESS;
+}
+
+/**
+ * Host notifications for a property which changes several times before the
+ * host sees it are reduced to the latest one, the others keep their order.
+ */
+static void test7(void)
+{
+    RTTestISub("Host notification batching");
+
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    initTable(&svcTable, &svcHelpers);
+    RT_ZERO(g_HostNotify);
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventCreate(&g_HostNotify.hEvtEntered));
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventCreate(&g_HostNotify.hEvtRelease));
+    RTTESTI_CHECK_RC_OK_RETV(VBoxHGCMSvcLoad(&svcTable));
+    RTTESTI_CHECK_RC_OK(svcTable.pfnRegisterExtension(svcTable.pvService, hostNotifyCallback, NULL));
+
+    /* Hold up the notification thread in the callback for the first change. */
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/First", "1", "", true, true));
+    RTTESTI_CHECK_RC_OK(RTSemEventWait(g_HostNotify.hEvtEntered, 30000));
+
+    /* These all queue up behind it. */
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/A", "1", "", true, true));
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/A", "2", "", true, true));
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/B", "1", "", true, true));
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/C", "1", "", false, true));
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/A", "3", "", false, true));
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Batch/B", "2", "", true, true));
+
+    RTTESTI_CHECK_RC_OK(RTSemEventSignal(g_HostNotify.hEvtRelease));
+    static struct { const char *pszName, *pszValue; } const s_aExpected[] =
+    {
+        { "/Batch/First", "1" },
+        { "/Batch/C",     "1" },
+        { "/Batch/A",     "3" },
+        { "/Batch/B",     "2" },
+    };
+    uint64_t const msStart = RTTimeMilliTS();
+    while (   g_HostNotify.cCalls < RT_ELEMENTS(s_aExpected)
+           && RTTimeMilliTS() - msStart < 30000)
+        RTThreadSleep(1);
+    /* Give stray notifications a chance to show up. */
+    RTThreadSleep(50);
+
+    RTTESTI_CHECK_RC_OK(svcTable.pfnUnload(svcTable.pvService));
+    RTTESTI_CHECK_MSG(g_HostNotify.cCalls == RT_ELEMENTS(s_aExpected),
+                      ("cCalls=%u\n", g_HostNotify.cCalls));
+    for (unsigned i = 0; i < RT_MIN(g_HostNotify.cCalls, RT_ELEMENTS(s_aExpected)); i++)
+    {
+        RTTESTI_CHECK_MSG(   !strcmp(g_HostNotify.aszNames[i], s_aExpected[i].pszName)
+                          && !strcmp(g_HostNotify.aszValues[i], s_aExpected[i].pszValue),
+                          ("#%u: %s=%s, expected %s=%s\n", i, g_HostNotify.aszNames[i], g_HostNotify.aszValues[i],
+                           s_aExpected[i].pszName, s_aExpected[i].pszValue));
+        if (i > 0)
+            RTTESTI_CHECK_MSG(g_HostNotify.au64Timestamps[i] > g_HostNotify.au64Timestamps[i - 1],
+                              ("#%u: %RU64 <= %RU64\n", i, g_HostNotify.au64Timestamps[i],
+                               g_HostNotify.au64Timestamps[i - 1]));
+    }
+
+    RTSemEventDestroy(g_HostNotify.hEvtRelease);
+    RTSemEventDestroy(g_HostNotify.hEvtEntered);
+}
+
+/**
+ * Guest notification calls waiting for plain property names only complete
+ * for those properties, the ones with wildcards for all matching ones.
+ */
+static void test8(void)
+{
+    RTTestISub("GET_NOTIFICATION by name");
 
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    initTable(&svcTable, &svcHelpers);
+    RTTESTI_CHECK_RC_OK_RETV(VBoxHGCMSvcLoad(&svcTable));
+
+    static struct
+    {
+        char                        szPatterns[64];
+        VBOXHGCMSVCPARM             aParms[4];
+        char                        abBuffer[MAX_NAME_LEN + MAX_VALUE_LEN + MAX_FLAGS_LEN];
+        VBOXHGCMCALLHANDLE_TYPEDEF  callHandle;
+    } s_aWaiters[] =
+    {
+        { "/Name/A|/Name/B" },
+        { "/Name/B" },
+        { "/Name/C|/Name/C" },
+        { "/Name/*" },
+    };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aWaiters); i++)
+    {
+        s_aWaiters[i].aParms[0].setPointer(s_aWaiters[i].szPatterns, (uint32_t)strlen(s_aWaiters[i].szPatterns) + 1);
+        s_aWaiters[i].aParms[1].setUInt64(0);
+        s_aWaiters[i].aParms[2].setPointer(s_aWaiters[i].abBuffer, sizeof(s_aWaiters[i].abBuffer));
+        s_aWaiters[i].callHandle.rc = VINF_HGCM_ASYNC_EXECUTE;
+        svcTable.pfnCall(svcTable.pvService, &s_aWaiters[i].callHandle, 0, NULL,
+                         GET_NOTIFICATION, 4, s_aWaiters[i].aParms);
+        RTTESTI_CHECK_RC(s_aWaiters[i].callHandle.rc, VINF_HGCM_ASYNC_EXECUTE);
+    }
+
+    /* Only the wildcard waiter matches this one. */
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Name/D", "d", "", true, true));
+    RTTESTI_CHECK_RC(s_aWaiters[0].callHandle.rc, VINF_HGCM_ASYNC_EXECUTE);
+    RTTESTI_CHECK_RC(s_aWaiters[1].callHandle.rc, VINF_HGCM_ASYNC_EXECUTE);
+    RTTESTI_CHECK_RC(s_aWaiters[2].callHandle.rc, VINF_HGCM_ASYNC_EXECUTE);
+    RTTESTI_CHECK_RC(s_aWaiters[3].callHandle.rc, VINF_SUCCESS);
+    RTTESTI_CHECK(!strcmp(s_aWaiters[3].abBuffer, "/Name/D"));
+
+    /* Both waiters for B complete, the other index entry of the first goes. */
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Name/B", "b", "", true, true));
+    RTTESTI_CHECK_RC(s_aWaiters[0].callHandle.rc, VINF_SUCCESS);
+    RTTESTI_CHECK(!strcmp(s_aWaiters[0].abBuffer, "/Name/B"));
+    RTTESTI_CHECK_RC(s_aWaiters[1].callHandle.rc, VINF_SUCCESS);
+    RTTESTI_CHECK(!strcmp(s_aWaiters[1].abBuffer, "/Name/B"));
+    RTTESTI_CHECK_RC(s_aWaiters[2].callHandle.rc, VINF_HGCM_ASYNC_EXECUTE);
+
+    s_aWaiters[0].callHandle.rc = VERR_IPE_UNINITIALIZED_STATUS;
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Name/A", "a", "", true, true));
+    RTTESTI_CHECK_RC(s_aWaiters[0].callHandle.rc, VERR_IPE_UNINITIALIZED_STATUS);
+
+    /* A name listed twice completes the call once. */
+    RTTESTI_CHECK_RC_OK(doSetProperty(&svcTable, "/Name/C", "c", "", true, true));
+    RTTESTI_CHECK_RC(s_aWaiters[2].callHandle.rc, VINF_SUCCESS);
+    RTTESTI_CHECK(!strcmp(s_aWaiters[2].abBuffer, "/Name/C"));
+
+    RTTESTI_CHECK_RC_OK(svcTable.pfnUnload(svcTable.pvService));
+}
 
 
 int main()
@@ -1149,6 +1335,8 @@ int main()
     test4();
     test5();
     test6();
+    test7();
+    test8();
 
     return RTTestSummaryAndDestroy(g_hTest);
 }
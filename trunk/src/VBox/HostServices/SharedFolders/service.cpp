@@ -17,20 +17,31 @@
 
 #include <VBox/shflsvc.h>
 
+#ifdef UNITTEST
+# include "testcase/tstSharedFolderService.h"
+#endif
 
 #include "shfl.h"
 #include "mappings.h"
 #include "shflhandle.h"
 #include "vbsf.h"
+#include "vbsfcache.h"
 #include <iprt/alloc.h>
+#include <iprt/asm.h>
 #include <iprt/string.h>
 #include <iprt/assert.h>
+#include <iprt/req.h>
+#include <iprt/semaphore.h>
+#include <iprt/thread.h>
 #include <VBox/vmm/ssm.h>
 #include <VBox/vmm/pdmifs.h>
 
 #define SHFL_SSM_VERSION_FOLDERNAME_UTF16   2
 #define SHFL_SSM_VERSION                    3
 
+/** Number of worker threads processing guest calls. */
+#define SHFL_WORKER_COUNT                   4
+
 
 /** @page pg_shfl_svc   Shared Folders Host Service
  *
@@ -66,6 +77,13 @@
  * To access host file system guest just forwards file system calls
  * to the service, and specifies full paths or handles for objects.
  *
+ * The file system calls are not executed on the HGCM service thread but
+ * handed to a small pool of worker threads which complete the calls
+ * asynchronously, so that one slow operation does not stall all other
+ * shared folder calls. Calls referring to a handle always go to the same
+ * worker, which keeps them in the order the guest issued them. Calls
+ * changing the mappings or the client state are executed on the service
+ * thread after all outstanding calls have been completed.
  *
  */
 
@@ -73,12 +91,244 @@
 PVBOXHGCMSVCHELPERS g_pHelpers;
 static PPDMLED      pStatusLed = NULL;
 
+/**
+ * A worker thread with its request queue.
+ */
+typedef struct SHFLWORKER
+{
+    /** The request queue, NIL_RTREQQUEUE if not created. */
+    RTREQQUEUE          hReqQueue;
+    /** The worker thread, NIL_RTTHREAD if not running. */
+    RTTHREAD            hThread;
+} SHFLWORKER;
+
+/**
+ * A guest call handed to a worker thread.
+ */
+typedef struct SHFLWORKERCALL
+{
+    VBOXHGCMCALLHANDLE  callHandle;
+    SHFLCLIENTDATA     *pClient;
+    uint32_t            u32Function;
+    uint32_t            cParms;
+    VBOXHGCMSVCPARM    *paParms;
+} SHFLWORKERCALL;
+
+/** The worker threads. */
+static SHFLWORKER           g_aWorkers[SHFL_WORKER_COUNT];
+/** Number of running workers, 0 if calls are processed synchronously. */
+static uint32_t             g_cWorkers = 0;
+/** Round robin index for calls which don't refer to a handle. */
+static uint32_t             g_iNextWorker = 0;
+/** Number of calls handed to the workers and not completed yet. */
+static uint32_t volatile    g_cPendingCalls = 0;
+/** Signalled when g_cPendingCalls drops to zero. */
+static RTSEMEVENT           g_hIdleEvent = NIL_RTSEMEVENT;
+
+static int svcCallWorker(SHFLCLIENTDATA *pClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[]);
+
+
+/**
+ * Executes a guest call on a worker thread and completes it.
+ */
+static DECLCALLBACK(int) shflWorkerCall(SHFLWORKERCALL *pCall)
+{
+    int rc = svcCallWorker(pCall->pClient, pCall->u32Function, pCall->cParms, pCall->paParms);
+
+    LogFlow(("SharedFolders host service: worker: fn = %u, rc=%Rrc\n", pCall->u32Function, rc));
+
+    g_pHelpers->pfnCallComplete(pCall->callHandle, rc);
+    RTMemFree(pCall);
+
+    if (ASMAtomicDecU32(&g_cPendingCalls) == 0)
+        RTSemEventSignal(g_hIdleEvent);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Request function telling a worker thread to quit.
+ */
+static DECLCALLBACK(int) shflWorkerStop(void)
+{
+    return VINF_EOF;
+}
+
+static DECLCALLBACK(int) shflWorkerThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF1(hThreadSelf);
+    SHFLWORKER *pWorker = (SHFLWORKER *)pvUser;
+
+    for (;;)
+    {
+        int rc = RTReqQueueProcess(pWorker->hReqQueue, RT_INDEFINITE_WAIT);
+        if (rc == VINF_EOF || rc == VERR_INVALID_HANDLE)
+            break;
+    }
+    return VINF_SUCCESS;
+}
+
+/**
+ * Waits until the workers have completed all calls handed to them.
+ *
+ * @note Must be called on the HGCM service thread, which is the only one
+ *       handing out calls, so no new ones can show up while waiting.
+ */
+static void shflWorkersWaitIdle(void)
+{
+    while (ASMAtomicReadU32(&g_cPendingCalls) != 0)
+        RTSemEventWait(g_hIdleEvent, 1000);
+}
+
+/**
+ * Picks the worker for a guest call.
+ *
+ * @returns Worker index, UINT32_MAX if the call must be executed on the
+ *          service thread.
+ */
+static uint32_t shflWorkerSelect(uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
+{
+    switch (u32Function)
+    {
+        /* Calls for the same handle must be executed in order, so they go to
+         * the worker the handle maps to. Parameter 1 is the handle for all of
+         * them, invalid parameters are rejected by the worker. */
+        case SHFL_FN_CLOSE:
+        case SHFL_FN_READ:
+        case SHFL_FN_WRITE:
+        case SHFL_FN_LOCK:
+        case SHFL_FN_LIST:
+        case SHFL_FN_LIST_BATCH:
+        case SHFL_FN_INFORMATION:
+        case SHFL_FN_FLUSH:
+            if (cParms >= 2 && paParms[1].type == VBOX_HGCM_SVC_PARM_64BIT)
+                return (uint32_t)(paParms[1].u.uint64 % g_cWorkers);
+            return 0;
+
+        /* Calls working on paths have no ordering requirements. */
+        case SHFL_FN_QUERY_MAP_NAME:
+        case SHFL_FN_CREATE:
+        case SHFL_FN_REMOVE:
+        case SHFL_FN_RENAME:
+        case SHFL_FN_READLINK:
+        case SHFL_FN_SYMLINK:
+        case SHFL_FN_QUERY_INFO_BULK:
+            return g_iNextWorker++ % g_cWorkers;
+
+        default:
+            return UINT32_MAX;
+    }
+}
+
+/**
+ * Starts the worker threads. Failing that the service keeps processing all
+ * calls on the service thread.
+ */
+static void shflWorkersStart(void)
+{
+    int rc = RTSemEventCreate(&g_hIdleEvent);
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("SharedFolders host service: Failed to create the idle event (%Rrc), no worker threads\n", rc));
+        return;
+    }
+
+    uint32_t i;
+    for (i = 0; i < SHFL_WORKER_COUNT; i++)
+    {
+        g_aWorkers[i].hReqQueue = NIL_RTREQQUEUE;
+        g_aWorkers[i].hThread   = NIL_RTTHREAD;
+
+        rc = RTReqQueueCreate(&g_aWorkers[i].hReqQueue);
+        if (RT_FAILURE(rc))
+            break;
+        rc = RTThreadCreateF(&g_aWorkers[i].hThread, shflWorkerThread, &g_aWorkers[i], 0,
+                             RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "ShFl-%u", i);
+        if (RT_FAILURE(rc))
+        {
+            RTReqQueueDestroy(g_aWorkers[i].hReqQueue);
+            g_aWorkers[i].hReqQueue = NIL_RTREQQUEUE;
+            break;
+        }
+    }
+    g_cWorkers = i;
+
+    if (RT_FAILURE(rc))
+        LogRel(("SharedFolders host service: Failed to start worker thread #%u (%Rrc), using %u\n", i, rc, i));
+}
+
+/**
+ * Stops the worker threads after all outstanding calls have been completed.
+ */
+static void shflWorkersStop(void)
+{
+    shflWorkersWaitIdle();
+
+    for (uint32_t i = 0; i < g_cWorkers; i++)
+    {
+        int rc = RTReqQueueCallEx(g_aWorkers[i].hReqQueue, NULL, 0, RTREQFLAGS_NO_WAIT,
+                                  (PFNRT)shflWorkerStop, 0);
+        if (RT_SUCCESS(rc))
+            RTThreadWait(g_aWorkers[i].hThread, RT_INDEFINITE_WAIT, NULL);
+        else
+            AssertRC(rc);
+        RTReqQueueDestroy(g_aWorkers[i].hReqQueue);
+        g_aWorkers[i].hReqQueue = NIL_RTREQQUEUE;
+        g_aWorkers[i].hThread   = NIL_RTTHREAD;
+    }
+    g_cWorkers = 0;
+
+    RTSemEventDestroy(g_hIdleEvent);
+    g_hIdleEvent = NIL_RTSEMEVENT;
+}
+
+#ifdef UNITTEST
+/** Unit test the worker pool.  The testcase loads the service without workers
+ * as most tests expect the calls to complete synchronously, the sub-tests
+ * start and stop them using the helpers below. */
+void testWorkers(RTTEST hTest)
+{
+    /* Calls for a handle always go to the same worker. */
+    testWorkersRouting(hTest);
+    /* Calls from many handles at once complete, in order for each handle. */
+    testWorkersConcurrent(hTest);
+    /* Add tests as required... */
+}
+
+void testWorkersStart(void)
+{
+    shflWorkersStart();
+}
+
+void testWorkersStop(void)
+{
+    shflWorkersStop();
+}
+
+void testWorkersWaitIdle(void)
+{
+    shflWorkersWaitIdle();
+}
+
+uint32_t testWorkersCount(void)
+{
+    return g_cWorkers;
+}
+
+uint32_t testWorkerSelect(uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
+{
+    return shflWorkerSelect(u32Function, cParms, paParms);
+}
+#endif
+
 static DECLCALLBACK(int) svcUnload (void *)
 {
     int rc = VINF_SUCCESS;
 
     Log(("svcUnload\n"));
 
+    shflWorkersStop();
+    vbsfCacheTerm();
+
     return rc;
 }
 
@@ -100,6 +350,7 @@ static DECLCALLBACK(int) svcDisconnect (void *, uint32_t u32ClientID, void *pvCl
 
     Log(("SharedFolders host service: disconnected, u32ClientID = %u\n", u32ClientID));
 
+    shflWorkersWaitIdle();
     vbsfDisconnect(pClient);
     return rc;
 }
@@ -118,6 +369,8 @@ static DECLCALLBACK(int) svcSaveState(void *, uint32_t u32ClientID, void *pvClie
 
     Log(("SharedFolders host service: saving state, u32ClientID = %u\n", u32ClientID));
 
+    shflWorkersWaitIdle();
+
     int rc = SSMR3PutU32(pSSM, SHFL_SSM_VERSION);
     AssertRCReturn(rc, rc);
 
@@ -185,6 +438,8 @@ static DECLCALLBACK(int) svcLoadState(void *, uint32_t u32ClientID, void *pvClie
 
     Log(("SharedFolders host service: loading state, u32ClientID = %u\n", u32ClientID));
 
+    shflWorkersWaitIdle();
+
     int rc = SSMR3GetU32(pSSM, &version);
     AssertRCReturn(rc, rc);
 
@@ -298,14 +553,11 @@ static DECLCALLBACK(int) svcLoadState(void *, uint32_t u32ClientID, void *pvClie
 static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32_t u32ClientID, void *pvClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
 {
     RT_NOREF1(u32ClientID);
-    int rc = VINF_SUCCESS;
 
     Log(("SharedFolders host service: svcCall: u32ClientID = %u, fn = %u, cParms = %u, pparms = %p\n", u32ClientID, u32Function, cParms, paParms));
 
     SHFLCLIENTDATA *pClient = (SHFLCLIENTDATA *)pvClient;
 
-    bool fAsynchronousProcessing = false;
-
 #ifdef LOG_ENABLED
     for (uint32_t i = 0; i < cParms; i++)
     {
@@ -314,6 +566,59 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
     }
 #endif
 
+    if (g_cWorkers)
+    {
+        uint32_t iWorker = shflWorkerSelect(u32Function, cParms, paParms);
+        if (iWorker != UINT32_MAX)
+        {
+            /* Hand the call to the worker, which completes it. */
+            SHFLWORKERCALL *pCall = (SHFLWORKERCALL *)RTMemAlloc(sizeof(*pCall));
+            if (pCall)
+            {
+                pCall->callHandle  = callHandle;
+                pCall->pClient     = pClient;
+                pCall->u32Function = u32Function;
+                pCall->cParms      = cParms;
+                pCall->paParms     = paParms;
+
+                ASMAtomicIncU32(&g_cPendingCalls);
+                int rc = RTReqQueueCallEx(g_aWorkers[iWorker].hReqQueue, NULL, 0, RTREQFLAGS_NO_WAIT,
+                                          (PFNRT)shflWorkerCall, 1, pCall);
+                if (RT_SUCCESS(rc))
+                    return;
+
+                RTMemFree(pCall);
+                ASMAtomicDecU32(&g_cPendingCalls);
+            }
+            /* Fall back on processing the call right here. */
+            shflWorkersWaitIdle();
+        }
+        else
+        {
+            /* The remaining calls change the mappings or the client state,
+             * which the workers rely on. */
+            shflWorkersWaitIdle();
+        }
+    }
+
+    int rc = svcCallWorker(pClient, u32Function, cParms, paParms);
+
+    LogFlow(("SharedFolders host service: svcCall: rc=%Rrc\n", rc));
+
+    g_pHelpers->pfnCallComplete (callHandle, rc);
+
+    LogFlow(("\n"));        /* Add a new line to differentiate between calls more easily. */
+}
+
+/**
+ * Executes a guest call, either on the service thread or on a worker.
+ *
+ * @returns VBox status code to complete the call with.
+ */
+static int svcCallWorker(SHFLCLIENTDATA *pClient, uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[])
+{
+    int rc = VINF_SUCCESS;
+
     switch (u32Function)
     {
         case SHFL_FN_QUERY_MAPPINGS:
@@ -809,6 +1114,122 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
             break;
         }
 
+        /** List directory entries with their object information. */
+        case SHFL_FN_LIST_BATCH:
+        {
+            Log(("SharedFolders host service: svcCall: SHFL_FN_LIST_BATCH\n"));
+
+            /* Verify parameter count and types. */
+            if (cParms != SHFL_CPARMS_LIST_BATCH)
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            if (   paParms[0].type != VBOX_HGCM_SVC_PARM_32BIT   /* root */
+                || paParms[1].type != VBOX_HGCM_SVC_PARM_64BIT   /* handle */
+                || paParms[2].type != VBOX_HGCM_SVC_PARM_32BIT   /* flags */
+                || paParms[3].type != VBOX_HGCM_SVC_PARM_32BIT   /* cb */
+                || paParms[4].type != VBOX_HGCM_SVC_PARM_PTR     /* buffer */
+                || paParms[5].type != VBOX_HGCM_SVC_PARM_32BIT   /* cEntries (out) */
+                || paParms[6].type != VBOX_HGCM_SVC_PARM_32BIT   /* fEnd (out) */
+                    )
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            {
+                /* Fetch parameters. */
+                SHFLROOT  root     = (SHFLROOT)paParms[0].u.uint32;
+                SHFLHANDLE Handle  = paParms[1].u.uint64;
+                uint32_t   flags   = paParms[2].u.uint32;
+                uint32_t   length  = paParms[3].u.uint32;
+                uint8_t   *pBuffer = (uint8_t *)paParms[4].u.pointer.addr;
+                uint32_t   cEntries = 0;
+                bool       fEnd    = false;
+
+                /* Verify parameters values. */
+                if (   length < sizeof(SHFLDIRBATCHENTRY)
+                    || length > paParms[4].u.pointer.size)
+                {
+                    rc = VERR_INVALID_PARAMETER;
+                }
+                else
+                {
+                    if (pStatusLed)
+                    {
+                        Assert(pStatusLed->u32Magic == PDMLED_MAGIC);
+                        pStatusLed->Asserted.s.fReading = pStatusLed->Actual.s.fReading = 1;
+                    }
+
+                    /* Execute the function. */
+                    rc = vbsfDirListBatch(pClient, root, Handle, flags, &length, pBuffer, &cEntries, &fEnd);
+
+                    if (pStatusLed)
+                        pStatusLed->Actual.s.fReading = 0;
+
+                    if (RT_SUCCESS(rc))
+                    {
+                        /* Update parameters.*/
+                        paParms[3].u.uint32 = length;
+                        paParms[5].u.uint32 = cEntries;
+                        paParms[6].u.uint32 = fEnd;
+                    }
+                    else
+                    {
+                        paParms[3].u.uint32 = 0;  /* nothing read */
+                        paParms[5].u.uint32 = 0;
+                        paParms[6].u.uint32 = 0;
+                    }
+                }
+            }
+            break;
+        }
+
+        /** Query the object information of several paths. */
+        case SHFL_FN_QUERY_INFO_BULK:
+        {
+            Log(("SharedFolders host service: svcCall: SHFL_FN_QUERY_INFO_BULK\n"));
+
+            /* Verify parameter count and types. */
+            if (cParms != SHFL_CPARMS_QUERY_INFO_BULK)
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            if (   paParms[0].type != VBOX_HGCM_SVC_PARM_32BIT   /* root */
+                || paParms[1].type != VBOX_HGCM_SVC_PARM_32BIT   /* flags */
+                || paParms[2].type != VBOX_HGCM_SVC_PARM_32BIT   /* cPaths */
+                || paParms[3].type != VBOX_HGCM_SVC_PARM_PTR     /* paths */
+                || paParms[4].type != VBOX_HGCM_SVC_PARM_PTR     /* results */
+                    )
+            {
+                rc = VERR_INVALID_PARAMETER;
+            }
+            else
+            {
+                /* Fetch parameters. */
+                SHFLROOT  root     = (SHFLROOT)paParms[0].u.uint32;
+                uint32_t  flags    = paParms[1].u.uint32;
+                uint32_t  cPaths   = paParms[2].u.uint32;
+                uint8_t  *pbPaths  = (uint8_t *)paParms[3].u.pointer.addr;
+                uint32_t  cbPaths  = paParms[3].u.pointer.size;
+                PSHFLINFOBULKRESULT paResults = (PSHFLINFOBULKRESULT)paParms[4].u.pointer.addr;
+
+                /* Verify parameters values. */
+                if (   cPaths > SHFL_QUERY_INFO_BULK_MAX_PATHS
+                    || paParms[4].u.pointer.size < cPaths * sizeof(SHFLINFOBULKRESULT))
+                {
+                    rc = VERR_INVALID_PARAMETER;
+                }
+                else
+                {
+                    /* Execute the function. */
+                    rc = vbsfQueryInfoBulk(pClient, root, flags, cPaths, pbPaths, cbPaths, paResults);
+                }
+            }
+            break;
+        }
+
         /* Read symlink destination */
         case SHFL_FN_READLINK:
         {
@@ -1266,18 +1687,7 @@ static DECLCALLBACK(void) svcCall (void *, VBOXHGCMCALLHANDLE callHandle, uint32
         }
     }
 
-    LogFlow(("SharedFolders host service: svcCall: rc=%Rrc\n", rc));
-
-    if (   !fAsynchronousProcessing
-        || RT_FAILURE (rc))
-    {
-        /* Complete the operation if it was unsuccessful or
-         * it was processed synchronously.
-         */
-        g_pHelpers->pfnCallComplete (callHandle, rc);
-    }
-
-    LogFlow(("\n"));        /* Add a new line to differentiate between calls more easily. */
+    return rc;
 }
 
 /*
@@ -1291,6 +1701,9 @@ static DECLCALLBACK(int) svcHostCall (void *, uint32_t u32Function, uint32_t cPa
 
     Log(("svcHostCall: fn = %d, cParms = %d, pparms = %d\n", u32Function, cParms, paParms));
 
+    /* Mapping changes must not happen under the feet of the workers. */
+    shflWorkersWaitIdle();
+
 #ifdef DEBUG
     uint32_t i;
 
@@ -1502,6 +1915,14 @@ extern "C" DECLCALLBACK(DECLEXPORT(int)) VBoxHGCMSvcLoad (VBOXHGCMSVCFNTABLE *pt
         AssertRC(rc);
 
         vbsfMappingInit();
+
+#ifndef UNITTEST /* The testcase changes the stubbed file system between calls,
+                  * it enables the cache and starts the workers itself, see
+                  * testCache() and testWorkers(). */
+        int rc2 = vbsfCacheInit(); /* Not fatal, all lookups go to the host then. */
+        AssertRC(rc2);
+        shflWorkersStart();
+#endif
     }
 
     return rc;
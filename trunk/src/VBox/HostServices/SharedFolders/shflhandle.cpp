@@ -20,6 +20,7 @@
 #include <iprt/alloc.h>
 #include <iprt/assert.h>
 #include <iprt/critsect.h>
+#include <iprt/string.h>
 
 
 /*
@@ -123,6 +124,10 @@ SHFLHANDLE  vbsfAllocHandle(PSHFLCLIENTDATA pClient, uint32_t uType,
 
 static int vbsfFreeHandle(PSHFLCLIENTDATA pClient, SHFLHANDLE handle)
 {
+    int rc = VERR_INVALID_HANDLE;
+
+    /* The workers may allocate other handles concurrently. */
+    RTCritSectEnter(&lock);
     if (   handle < SHFLHANDLE_MAX
         && (pHandles[handle].uFlags & SHFL_HF_VALID)
         && pHandles[handle].pClient == pClient)
@@ -130,9 +135,10 @@ static int vbsfFreeHandle(PSHFLCLIENTDATA pClient, SHFLHANDLE handle)
         pHandles[handle].uFlags     = 0;
         pHandles[handle].pvUserData = 0;
         pHandles[handle].pClient    = 0;
-        return VINF_SUCCESS;
+        rc = VINF_SUCCESS;
     }
-    return VERR_INVALID_HANDLE;
+    RTCritSectLeave(&lock);
+    return rc;
 }
 
 uintptr_t vbsfQueryHandle(PSHFLCLIENTDATA pClient, SHFLHANDLE handle,
@@ -208,6 +214,7 @@ void vbsfFreeFileHandle(PSHFLCLIENTDATA pClient, SHFLHANDLE hHandle)
     if (pHandle)
     {
         vbsfFreeHandle(pClient, hHandle);
+        RTStrFree(pHandle->pszPath);
         RTMemFree (pHandle);
     }
     else
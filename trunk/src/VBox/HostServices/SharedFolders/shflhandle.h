@@ -56,6 +56,9 @@ typedef struct _SHFLFILEHANDLE
             PRTDIRENTRYEX pLastValidEntry; /* last found file in a directory search */
         } dir;
     };
+    /** The host path the object was opened with, for keeping the attribute
+     *  cache up to date.  NULL if not known. */
+    char *pszPath;
 } SHFLFILEHANDLE;
 
 
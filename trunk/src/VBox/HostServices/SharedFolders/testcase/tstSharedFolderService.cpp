@@ -28,14 +28,18 @@
 
 #include "tstSharedFolderService.h"
 #include "vbsf.h"
+#include "vbsfcache.h"
 
+#include <iprt/asm.h>
 #include <iprt/fs.h>
 #include <iprt/dir.h>
+#include <iprt/env.h>
 #include <iprt/file.h>
 #include <iprt/path.h>
 #include <iprt/symlink.h>
 #include <iprt/stream.h>
 #include <iprt/test.h>
+#include <iprt/thread.h>
 
 #include "teststubs.h"
 
@@ -139,11 +143,15 @@ extern int testRTDirCreate(const char *pszPath, RTFMODE fMode, uint32_t fCreate)
 
 static char testRTDirOpenName[256];
 static PRTDIR testRTDirOpenpDir;
+static unsigned g_cTestRTDirOpen;
+static unsigned g_iTestRTDirReadEntry;
 
 extern int testRTDirOpen(PRTDIR *ppDir, const char *pszPath)
 {
  /* RTPrintf("%s: pszPath=%s\n", __PRETTY_FUNCTION__, pszPath); */
     ARRAY_FROM_PATH(testRTDirOpenName, pszPath);
+    g_cTestRTDirOpen++;
+    g_iTestRTDirReadEntry = 0;
     *ppDir = testRTDirOpenpDir;
     testRTDirOpenpDir = 0;
     return VINF_SUCCESS;
@@ -154,6 +162,8 @@ extern int testRTDirOpenFiltered(PRTDIR *ppDir, const char *pszPath, RTDIRFILTER
 {
  /* RTPrintf("%s: pszPath=%s\n", __PRETTY_FUNCTION__, pszPath); */
     ARRAY_FROM_PATH(testRTDirOpenName, pszPath);
+    g_cTestRTDirOpen++;
+    g_iTestRTDirReadEntry = 0;
     *ppDir = testRTDirOpenpDir;
     testRTDirOpenpDir = 0;
     return VINF_SUCCESS;
@@ -181,6 +191,25 @@ extern int testRTDirRemove(const char *pszPath)
     return 0;
 }
 
+/** The names testRTDirRead() and testRTDirReadEx() return, terminated by a
+ * NULL entry. */
+static const char * const *g_papszTestRTDirReadEntries;
+
+extern int testRTDirRead(PRTDIR pDir, PRTDIRENTRY pDirEntry, size_t *pcbDirEntry)
+{
+    RT_NOREF1(pDir);
+    if (   !g_papszTestRTDirReadEntries
+        || !g_papszTestRTDirReadEntries[g_iTestRTDirReadEntry])
+        return VERR_NO_MORE_FILES;
+    const char *pszName = g_papszTestRTDirReadEntries[g_iTestRTDirReadEntry++];
+    size_t cchName = strlen(pszName);
+    AssertRelease(RT_OFFSETOF(RTDIRENTRY, szName) + cchName + 1 <= *pcbDirEntry);
+    RT_BZERO(pDirEntry, RT_OFFSETOF(RTDIRENTRY, szName));
+    pDirEntry->cbName = (uint16_t)cchName;
+    memcpy(pDirEntry->szName, pszName, cchName + 1);
+    return VINF_SUCCESS;
+}
+
 static PRTDIR g_testRTDirReadExDir;
 
 extern int testRTDirReadEx(PRTDIR pDir, PRTDIRENTRYEX pDirEntry, size_t *pcbDirEntry,
@@ -191,7 +220,19 @@ extern int testRTDirReadEx(PRTDIR pDir, PRTDIRENTRYEX pDirEntry, size_t *pcbDirE
              __PRETTY_FUNCTION__, pDir, pcbDirEntry ? (int) *pcbDirEntry : -1,
              LLUIFY(enmAdditionalAttribs), LLUIFY(fFlags)); */
     g_testRTDirReadExDir = pDir;
-    return VERR_NO_MORE_FILES;
+    if (   !g_papszTestRTDirReadEntries
+        || !g_papszTestRTDirReadEntries[g_iTestRTDirReadEntry])
+        return VERR_NO_MORE_FILES;
+    /* The size tells the entries apart, it is the 1-based index. */
+    const char *pszName = g_papszTestRTDirReadEntries[g_iTestRTDirReadEntry++];
+    size_t cchName = strlen(pszName);
+    AssertRelease(RT_OFFSETOF(RTDIRENTRYEX, szName) + cchName + 1 <= *pcbDirEntry);
+    RT_BZERO(pDirEntry, RT_OFFSETOF(RTDIRENTRYEX, szName));
+    pDirEntry->Info.cbObject   = g_iTestRTDirReadEntry;
+    pDirEntry->Info.Attr.fMode = RTFS_TYPE_FILE;
+    pDirEntry->cbName = (uint16_t)cchName;
+    memcpy(pDirEntry->szName, pszName, cchName + 1);
+    return VINF_SUCCESS;
 }
 
 static RTTIMESPEC testRTDirSetTimesATime;
@@ -371,11 +412,33 @@ extern int  testRTFileUnlock(RTFILE File, int64_t offLock, uint64_t cbLock)
 
 static char testRTFileWriteData[256];
 
+/** Writes recorded while g_fTestRecordWrites is set, the first four bytes
+ * written are taken as a sequence number.  For the worker pool tests. */
+static struct
+{
+    RTFILE hFile;
+    uint32_t uSeq;
+} g_aTestWrites[256];
+static uint32_t volatile g_cTestWrites;
+static bool volatile g_fTestRecordWrites;
+
 extern int  testRTFileWrite(RTFILE File, const void *pvBuf, size_t cbToWrite, size_t *pcbWritten)
 {
     RT_NOREF2(File, cbToWrite);
  /* RTPrintf("%s: File=%p, pvBuf=%.*s, cbToWrite=%llu\n", __PRETTY_FUNCTION__,
              File, cbToWrite, (const char *)pvBuf, LLUIFY(cbToWrite)); */
+    if (ASMAtomicReadBool(&g_fTestRecordWrites))
+    {
+        uint32_t i = ASMAtomicIncU32(&g_cTestWrites) - 1;
+        if (i < RT_ELEMENTS(g_aTestWrites) && cbToWrite >= sizeof(uint32_t))
+        {
+            g_aTestWrites[i].hFile = File;
+            memcpy(&g_aTestWrites[i].uSeq, pvBuf, sizeof(uint32_t));
+        }
+        if (pcbWritten)
+            *pcbWritten = cbToWrite;
+        return VINF_SUCCESS;
+    }
     ARRAY_FROM_PATH(testRTFileWriteData, (const char *)pvBuf);
     if (pcbWritten)
         *pcbWritten = strlen(testRTFileWriteData) + 1;
@@ -405,13 +468,23 @@ extern int testRTFsQuerySizes(const char *pszFsPath, PRTFOFF pcbTotal, RTFOFF *p
     return 0;
 }
 
+static unsigned g_cTestRTPathQueryInfoEx;
+static RTFOFF g_cbTestRTPathQueryInfoExObject;
+/** Name of an object testRTPathQueryInfoEx() reports as not existing. */
+static const char *g_pszTestRTPathQueryInfoExMissing;
+
 extern int testRTPathQueryInfoEx(const char *pszPath, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAdditionalAttribs, uint32_t fFlags)
 {
     RT_NOREF3(pszPath, enmAdditionalAttribs, fFlags);
  /* RTPrintf("%s: pszPath=%s, enmAdditionalAttribs=0x%x, fFlags=0x%x\n",
              __PRETTY_FUNCTION__, pszPath, (unsigned) enmAdditionalAttribs,
              (unsigned) fFlags); */
+    g_cTestRTPathQueryInfoEx++;
     RT_ZERO(*pObjInfo);
+    if (   g_pszTestRTPathQueryInfoExMissing
+        && !strcmp(RTPathFilename(pszPath), g_pszTestRTPathQueryInfoExMissing))
+        return VERR_FILE_NOT_FOUND;
+    pObjInfo->cbObject = g_cbTestRTPathQueryInfoExObject;
     return VINF_SUCCESS;
 }
 
@@ -697,6 +770,32 @@ static int listDir(VBOXHGCMSVCFNTABLE *psvcTable, SHFLROOT root,
     return callHandle.rc;
 }
 
+static int listDirBatch(VBOXHGCMSVCFNTABLE *psvcTable, SHFLROOT root,
+                        SHFLHANDLE handle, void *pvBuf, uint32_t cbBuf,
+                        uint32_t *pcbUsed, uint32_t *pcEntries, bool *pfEnd)
+{
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_LIST_BATCH];
+    VBOXHGCMCALLHANDLE_TYPEDEF callHandle = { VINF_SUCCESS };
+
+    aParms[0].setUInt32(root);
+    aParms[1].setUInt64(handle);
+    aParms[2].setUInt32(0);
+    aParms[3].setUInt32(cbBuf);
+    aParms[4].setPointer(pvBuf, cbBuf);
+    aParms[5].setUInt32(0);
+    aParms[6].setUInt32(0);
+    psvcTable->pfnCall(psvcTable->pvService, &callHandle, 0,
+                       psvcTable->pvService, SHFL_FN_LIST_BATCH,
+                       RT_ELEMENTS(aParms), aParms);
+    if (pcbUsed)
+        *pcbUsed = aParms[3].u.uint32;
+    if (pcEntries)
+        *pcEntries = aParms[5].u.uint32;
+    if (pfEnd)
+        *pfEnd = aParms[6].u.uint32 != 0;
+    return callHandle.rc;
+}
+
 static int sfInformation(VBOXHGCMSVCFNTABLE *psvcTable, SHFLROOT root,
                          SHFLHANDLE handle, uint32_t fFlags, uint32_t cb,
                          SHFLFSOBJINFO *pInfo)
@@ -915,6 +1014,336 @@ void testDirListEmpty(RTTEST hTest)
     RTTEST_CHECK_MSG(hTest, g_testRTDirClosepDir == pcDir, (hTest, "pDir=%p\n", g_testRTDirClosepDir));
 }
 
+void testDirListBatchEmpty(RTTEST hTest)
+{
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    SHFLROOT Root;
+    PRTDIR pcDir = (PRTDIR)0x10000;
+    SHFLHANDLE Handle;
+    uint64_t au64Buf[64];
+    uint32_t cEntries;
+    bool fEnd;
+    int rc;
+
+    RTTestSub(hTest, "List empty directory in batch mode");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    testRTDirOpenpDir = pcDir;
+    rc = createFile(&svcTable, Root, "test/dir",
+                    SHFL_CF_DIRECTORY | SHFL_CF_ACCESS_READ, &Handle, NULL);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(au64Buf),
+                      NULL, &cEntries, &fEnd);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK_MSG(hTest, g_testRTDirReadExDir == pcDir, (hTest, "Dir=%p\n", g_testRTDirReadExDir));
+    RTTEST_CHECK_MSG(hTest, cEntries == 0,
+                     (hTest, "cEntries=%llu\n", LLUIFY(cEntries)));
+    RTTEST_CHECK_MSG(hTest, fEnd, (hTest, "fEnd=%RTbool\n", fEnd));
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+    RTTEST_CHECK_MSG(hTest, g_testRTDirClosepDir == pcDir, (hTest, "pDir=%p\n", g_testRTDirClosepDir));
+}
+
+/**
+ * Checks the entries SHFL_FN_LIST_BATCH returned against the names
+ * testRTDirReadEx() handed out.
+ *
+ * @param  piNext  The index of the first expected entry, updated.
+ */
+static void checkBatchEntries(RTTEST hTest, const void *pvBuf, uint32_t cbUsed,
+                              uint32_t cEntries, const char * const *papszNames,
+                              unsigned *piNext)
+{
+    uint32_t off = 0;
+    for (uint32_t i = 0; i < cEntries; i++)
+    {
+        RTTEST_CHECK_RETV(hTest, off + RT_OFFSETOF(SHFLDIRBATCHENTRY, Name) <= cbUsed);
+        RTTEST_CHECK_MSG(hTest, !(off & 7), (hTest, "entry %u at %#x\n", i, off));
+        SHFLDIRBATCHENTRY const *pEntry = (SHFLDIRBATCHENTRY const *)((const uint8_t *)pvBuf + off);
+        const char *pszExpect = papszNames[*piNext];
+        RTTEST_CHECK_RETV(hTest, pszExpect != NULL);
+        size_t const cwcExpect = strlen(pszExpect);
+        RTTEST_CHECK_MSG(hTest, pEntry->cbName == cwcExpect * 2,
+                         (hTest, "entry %u: cbName=%u, expected %u\n", i, pEntry->cbName, (unsigned)cwcExpect * 2));
+        RTTEST_CHECK_RETV(hTest, off + RT_OFFSETOF(SHFLDIRBATCHENTRY, Name) + pEntry->cbName + 2 <= cbUsed);
+        bool fMatch = pEntry->Name.ucs2[cwcExpect] == 0;
+        for (size_t iwc = 0; iwc < cwcExpect && fMatch; iwc++)
+            fMatch = pEntry->Name.ucs2[iwc] == (RTUTF16)pszExpect[iwc];
+        RTTEST_CHECK_MSG(hTest, fMatch, (hTest, "entry %u: name is not '%s'\n", i, pszExpect));
+        RTTEST_CHECK_MSG(hTest, pEntry->Info.cbObject == (RTFOFF)*piNext + 1,
+                         (hTest, "entry %u: cbObject=%lld\n", i, (long long)pEntry->Info.cbObject));
+        *piNext += 1;
+        if (i + 1 == cEntries)
+            RTTEST_CHECK_MSG(hTest, pEntry->offNext == 0, (hTest, "last entry: offNext=%#x\n", pEntry->offNext));
+        else
+        {
+            RTTEST_CHECK_RETV(hTest, pEntry->offNext >= RT_OFFSETOF(SHFLDIRBATCHENTRY, Name) + pEntry->cbName + 2);
+            off += pEntry->offNext;
+        }
+    }
+}
+
+void testDirListBatchMany(RTTEST hTest)
+{
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    SHFLROOT Root;
+    PRTDIR pcDir = (PRTDIR)0x10000;
+    static const char * const s_apszEntries[] = { "a", "bb", "ccc", "dddd", "eeeee", NULL };
+    SHFLHANDLE Handle;
+    uint64_t au64Buf[256];
+    uint32_t cbUsed;
+    uint32_t cEntries;
+    unsigned iNext = 0;
+    bool fEnd;
+    int rc;
+
+    RTTestSub(hTest, "List several entries in batch mode");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    g_papszTestRTDirReadEntries = s_apszEntries;
+    testRTDirOpenpDir = pcDir;
+    rc = createFile(&svcTable, Root, "test/dir",
+                    SHFL_CF_DIRECTORY | SHFL_CF_ACCESS_READ, &Handle, NULL);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(au64Buf),
+                      &cbUsed, &cEntries, &fEnd);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK_MSG(hTest, cEntries == RT_ELEMENTS(s_apszEntries) - 1,
+                     (hTest, "cEntries=%llu\n", LLUIFY(cEntries)));
+    RTTEST_CHECK_MSG(hTest, fEnd, (hTest, "fEnd=%RTbool\n", fEnd));
+    RTTEST_CHECK_MSG(hTest, cbUsed > 0 && cbUsed <= sizeof(au64Buf), (hTest, "cbUsed=%u\n", cbUsed));
+    checkBatchEntries(hTest, au64Buf, cbUsed, cEntries, s_apszEntries, &iNext);
+    RTTEST_CHECK(hTest, iNext == RT_ELEMENTS(s_apszEntries) - 1);
+
+    /* Nothing more to come. */
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(au64Buf),
+                      &cbUsed, &cEntries, &fEnd);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK(hTest, cEntries == 0 && fEnd);
+    g_papszTestRTDirReadEntries = NULL;
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+    RTTEST_CHECK_MSG(hTest, g_testRTDirClosepDir == pcDir, (hTest, "pDir=%p\n", g_testRTDirClosepDir));
+}
+
+void testDirListBatchContinue(RTTEST hTest)
+{
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    SHFLROOT Root;
+    PRTDIR pcDir = (PRTDIR)0x10000;
+    static const char * const s_apszEntries[] = { "entry0", "entry1", "entry2", "entry3", "entry4", NULL };
+    /* Room for two of the entries, which need 114 bytes and start at
+     * 8 byte aligned offsets. */
+    uint64_t au64Buf[240 / sizeof(uint64_t)];
+    SHFLHANDLE Handle;
+    uint32_t cbUsed;
+    uint32_t cEntries;
+    unsigned iNext = 0;
+    bool fEnd;
+    int rc;
+
+    RTTestSub(hTest, "Continue a batch listing after the buffer filled up");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    g_papszTestRTDirReadEntries = s_apszEntries;
+    testRTDirOpenpDir = pcDir;
+    rc = createFile(&svcTable, Root, "test/dir",
+                    SHFL_CF_DIRECTORY | SHFL_CF_ACCESS_READ, &Handle, NULL);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(au64Buf),
+                      &cbUsed, &cEntries, &fEnd);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK_MSG(hTest, cEntries == 2 && !fEnd, (hTest, "cEntries=%u fEnd=%RTbool\n", cEntries, fEnd));
+    checkBatchEntries(hTest, au64Buf, cbUsed, cEntries, s_apszEntries, &iNext);
+
+    /* A buffer too small for the entry kept from the last call fails
+     * without losing it. */
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(SHFLDIRBATCHENTRY) + 8,
+                      &cbUsed, &cEntries, &fEnd);
+    RTTEST_CHECK_RC(hTest, rc, VERR_BUFFER_OVERFLOW);
+    RTTEST_CHECK(hTest, cEntries == 0);
+
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(au64Buf),
+                      &cbUsed, &cEntries, &fEnd);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK_MSG(hTest, cEntries == 2 && !fEnd, (hTest, "cEntries=%u fEnd=%RTbool\n", cEntries, fEnd));
+    checkBatchEntries(hTest, au64Buf, cbUsed, cEntries, s_apszEntries, &iNext);
+
+    rc = listDirBatch(&svcTable, Root, Handle, au64Buf, sizeof(au64Buf),
+                      &cbUsed, &cEntries, &fEnd);
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK_MSG(hTest, cEntries == 1 && fEnd, (hTest, "cEntries=%u fEnd=%RTbool\n", cEntries, fEnd));
+    checkBatchEntries(hTest, au64Buf, cbUsed, cEntries, s_apszEntries, &iNext);
+    RTTEST_CHECK_MSG(hTest, iNext == RT_ELEMENTS(s_apszEntries) - 1, (hTest, "iNext=%u\n", iNext));
+
+    g_papszTestRTDirReadEntries = NULL;
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+    RTTEST_CHECK_MSG(hTest, g_testRTDirClosepDir == pcDir, (hTest, "pDir=%p\n", g_testRTDirClosepDir));
+}
+
+/**
+ * Packs paths for SHFL_FN_QUERY_INFO_BULK, the strings go back to back at 4
+ * byte aligned offsets.
+ *
+ * @returns Number of bytes used.
+ */
+static uint32_t packBulkPaths(uint32_t *pau32Paths, size_t cbPaths,
+                              const char * const *papszPaths, unsigned cPaths)
+{
+    uint32_t offPaths = 0;
+    for (unsigned i = 0; i < cPaths; i++)
+    {
+        struct TESTSHFLSTRING Path;
+        fillTestShflString(&Path, papszPaths[i]);
+        uint32_t cbPath = RT_UOFFSETOF(SHFLSTRING, String) + Path.string.u16Size;
+        AssertRelease(offPaths + cbPath <= cbPaths);
+        memcpy((uint8_t *)pau32Paths + offPaths, &Path, cbPath);
+        offPaths += RT_ALIGN_32(cbPath, 4);
+    }
+    return offPaths;
+}
+
+static int queryInfoBulk(VBOXHGCMSVCFNTABLE *psvcTable, SHFLROOT root,
+                         uint32_t cPaths, void *pvPaths, uint32_t cbPaths,
+                         PSHFLINFOBULKRESULT paResults, uint32_t cbResults)
+{
+    VBOXHGCMSVCPARM aParms[SHFL_CPARMS_QUERY_INFO_BULK];
+    VBOXHGCMCALLHANDLE_TYPEDEF callHandle = { VINF_SUCCESS };
+
+    memset(paResults, 0xff, cbResults);
+    aParms[0].setUInt32(root);
+    aParms[1].setUInt32(0);
+    aParms[2].setUInt32(cPaths);
+    aParms[3].setPointer(pvPaths, cbPaths);
+    aParms[4].setPointer(paResults, cbResults);
+    psvcTable->pfnCall(psvcTable->pvService, &callHandle, 0,
+                       psvcTable->pvService, SHFL_FN_QUERY_INFO_BULK,
+                       RT_ELEMENTS(aParms), aParms);
+    return callHandle.rc;
+}
+
+void testQueryInfoBulkSimple(RTTEST hTest)
+{
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    static const char * const s_apszPaths[] = { "/test/file1", "/test/file2" };
+    uint32_t au32Paths[128];
+    SHFLINFOBULKRESULT aResults[RT_ELEMENTS(s_apszPaths)];
+    SHFLROOT Root;
+    int rc;
+
+    RTTestSub(hTest, "Query the information of two files at once");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    uint32_t cbPaths = packBulkPaths(au32Paths, sizeof(au32Paths), s_apszPaths, RT_ELEMENTS(s_apszPaths));
+    rc = queryInfoBulk(&svcTable, Root, RT_ELEMENTS(s_apszPaths), au32Paths, cbPaths,
+                       aResults, sizeof(aResults));
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    for (unsigned i = 0; i < RT_ELEMENTS(aResults); i++)
+    {
+        RTTEST_CHECK_RC_OK(hTest, aResults[i].rc);
+        RTTEST_CHECK_MSG(hTest, aResults[i].Result == SHFL_FILE_EXISTS,
+                         (hTest, "Result[%u]=%d\n", i, (int)aResults[i].Result));
+    }
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+}
+
+void testQueryInfoBulkNotFound(RTTEST hTest)
+{
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    static const char * const s_apszPaths[] = { "/test/file1", "/test/missing", "/test/file2" };
+    uint32_t au32Paths[128];
+    SHFLINFOBULKRESULT aResults[RT_ELEMENTS(s_apszPaths)];
+    SHFLROOT Root;
+    int rc;
+
+    RTTestSub(hTest, "Query the information of existing and missing files at once");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    uint32_t cbPaths = packBulkPaths(au32Paths, sizeof(au32Paths), s_apszPaths, RT_ELEMENTS(s_apszPaths));
+    g_pszTestRTPathQueryInfoExMissing = "missing";
+    rc = queryInfoBulk(&svcTable, Root, RT_ELEMENTS(s_apszPaths), au32Paths, cbPaths,
+                       aResults, sizeof(aResults));
+    g_pszTestRTPathQueryInfoExMissing = NULL;
+    /* A missing file is not an error, neither for the call nor for the path. */
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    for (unsigned i = 0; i < RT_ELEMENTS(aResults); i++)
+    {
+        SHFLCREATERESULT const enmExpect = i == 1 ? SHFL_FILE_NOT_FOUND : SHFL_FILE_EXISTS;
+        RTTEST_CHECK_RC_OK(hTest, aResults[i].rc);
+        RTTEST_CHECK_MSG(hTest, aResults[i].Result == enmExpect,
+                         (hTest, "Result[%u]=%d, expected %d\n", i, (int)aResults[i].Result, (int)enmExpect));
+    }
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+}
+
+void testQueryInfoBulkInvalidPath(RTTEST hTest)
+{
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    static const char * const s_apszPaths[] = { "/test/file1", "/../../escape", "/test/file2" };
+    uint32_t au32Paths[128];
+    SHFLINFOBULKRESULT aResults[RT_ELEMENTS(s_apszPaths)];
+    SHFLROOT Root;
+    int rc;
+
+    RTTestSub(hTest, "Query the information of valid and invalid paths at once");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    uint32_t cbPaths = packBulkPaths(au32Paths, sizeof(au32Paths), s_apszPaths, RT_ELEMENTS(s_apszPaths));
+
+    /* A path outside the mapping fails on its own, the others are answered. */
+    rc = queryInfoBulk(&svcTable, Root, RT_ELEMENTS(s_apszPaths), au32Paths, cbPaths,
+                       aResults, sizeof(aResults));
+    RTTEST_CHECK_RC_OK(hTest, rc);
+    RTTEST_CHECK_RC_OK(hTest, aResults[0].rc);
+    RTTEST_CHECK(hTest, aResults[0].Result == SHFL_FILE_EXISTS);
+    RTTEST_CHECK_RC(hTest, aResults[1].rc, VERR_INVALID_NAME);
+    RTTEST_CHECK_MSG(hTest, aResults[1].Result == SHFL_NO_RESULT, (hTest, "Result[1]=%d\n", (int)aResults[1].Result));
+    RTTEST_CHECK_RC_OK(hTest, aResults[2].rc);
+    RTTEST_CHECK(hTest, aResults[2].Result == SHFL_FILE_EXISTS);
+
+    /* More paths than the buffer holds. */
+    rc = queryInfoBulk(&svcTable, Root, RT_ELEMENTS(s_apszPaths), au32Paths, cbPaths / 2,
+                       aResults, sizeof(aResults));
+    RTTEST_CHECK_RC(hTest, rc, VERR_INVALID_PARAMETER);
+
+    /* A string claiming to be longer than the buffer it is in. */
+    PSHFLSTRING pLast = (PSHFLSTRING)((uint8_t *)au32Paths + cbPaths
+                                      - RT_ALIGN_32(RT_UOFFSETOF(SHFLSTRING, String) + (strlen(s_apszPaths[2]) + 1) * 2, 4));
+    RTTEST_CHECK(hTest, pLast->u16Length == strlen(s_apszPaths[2]) * 2);
+    pLast->u16Size   = 0x1000;
+    pLast->u16Length = 0x1000 - 2;
+    rc = queryInfoBulk(&svcTable, Root, RT_ELEMENTS(s_apszPaths), au32Paths, cbPaths,
+                       aResults, sizeof(aResults));
+    RTTEST_CHECK_RC(hTest, rc, VERR_INVALID_PARAMETER);
+
+    /* Too many paths, or too small a result buffer. */
+    rc = queryInfoBulk(&svcTable, Root, SHFL_QUERY_INFO_BULK_MAX_PATHS + 1, au32Paths, cbPaths,
+                       aResults, sizeof(aResults));
+    RTTEST_CHECK_RC(hTest, rc, VERR_INVALID_PARAMETER);
+    rc = queryInfoBulk(&svcTable, Root, RT_ELEMENTS(s_apszPaths), au32Paths, cbPaths,
+                       aResults, sizeof(aResults) - 1);
+    RTTEST_CHECK_RC(hTest, rc, VERR_INVALID_PARAMETER);
+
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+}
+
 void testFSInfoQuerySetFMode(RTTEST hTest)
 {
     VBOXHGCMSVCFNTABLE  svcTable;
@@ -1116,6 +1545,289 @@ void testLockFileSimple(RTTEST hTest)
 }
 
 
+void testWorkersRouting(RTTEST hTest)
+{
+    static const uint32_t s_au32HandleFns[] =
+    {
+        SHFL_FN_CLOSE, SHFL_FN_READ, SHFL_FN_WRITE, SHFL_FN_LOCK, SHFL_FN_LIST,
+        SHFL_FN_LIST_BATCH, SHFL_FN_INFORMATION, SHFL_FN_FLUSH
+    };
+    static const uint32_t s_au32ServiceFns[] =
+    {
+        SHFL_FN_MAP_FOLDER, SHFL_FN_UNMAP_FOLDER, SHFL_FN_SET_UTF8, SHFL_FN_SET_SYMLINKS
+    };
+    VBOXHGCMSVCPARM aParms[2];
+    uint32_t fRouted;
+
+    RTTestSub(hTest, "Route calls to the workers");
+    testWorkersStart();
+    uint32_t const cWorkers = testWorkersCount();
+    RTTEST_CHECK_MSG(hTest, cWorkers > 0 && cWorkers < 32, (hTest, "cWorkers=%u\n", cWorkers));
+    if (cWorkers > 0 && cWorkers < 32)
+    {
+        /* All calls for a handle go to the worker the handle maps to. */
+        fRouted = 0;
+        aParms[0].setUInt32(0);
+        for (uint64_t u64Handle = 0; u64Handle < 64; u64Handle++)
+        {
+            aParms[1].setUInt64(u64Handle);
+            uint32_t iWorker = testWorkerSelect(SHFL_FN_READ, RT_ELEMENTS(aParms), aParms);
+            RTTEST_CHECK_MSG(hTest, iWorker < cWorkers, (hTest, "iWorker=%#x\n", iWorker));
+            for (unsigned i = 0; i < RT_ELEMENTS(s_au32HandleFns); i++)
+            {
+                uint32_t iWorker2 = testWorkerSelect(s_au32HandleFns[i], RT_ELEMENTS(aParms), aParms);
+                RTTEST_CHECK_MSG(hTest, iWorker2 == iWorker,
+                                 (hTest, "fn=%u handle=%llu: worker %u, expected %u\n",
+                                  s_au32HandleFns[i], LLUIFY(u64Handle), iWorker2, iWorker));
+            }
+            if (iWorker < cWorkers)
+                fRouted |= RT_BIT_32(iWorker);
+        }
+        RTTEST_CHECK_MSG(hTest, fRouted == RT_BIT_32(cWorkers) - 1, (hTest, "fRouted=%#x\n", fRouted));
+
+        /* Calls working on paths are spread over all workers. */
+        fRouted = 0;
+        for (uint32_t i = 0; i < cWorkers; i++)
+        {
+            uint32_t iWorker = testWorkerSelect(SHFL_FN_CREATE, 0, NULL);
+            RTTEST_CHECK_MSG(hTest, iWorker < cWorkers, (hTest, "iWorker=%#x\n", iWorker));
+            if (iWorker < cWorkers)
+                fRouted |= RT_BIT_32(iWorker);
+        }
+        RTTEST_CHECK_MSG(hTest, fRouted == RT_BIT_32(cWorkers) - 1, (hTest, "fRouted=%#x\n", fRouted));
+
+        /* Calls changing the mappings or the client state stay on the
+         * service thread. */
+        for (unsigned i = 0; i < RT_ELEMENTS(s_au32ServiceFns); i++)
+            RTTEST_CHECK_MSG(hTest, testWorkerSelect(s_au32ServiceFns[i], 0, NULL) == UINT32_MAX,
+                             (hTest, "fn=%u\n", s_au32ServiceFns[i]));
+    }
+    testWorkersStop();
+    RTTEST_CHECK(hTest, testWorkersCount() == 0);
+}
+
+void testWorkersConcurrent(RTTEST hTest)
+{
+    enum { cFiles = 8, cRounds = 16, cCalls = cFiles * cRounds };
+    VBOXHGCMSVCFNTABLE  svcTable;
+    VBOXHGCMSVCHELPERS  svcHelpers;
+    SHFLROOT Root;
+    SHFLHANDLE aHandles[cFiles];
+    VBOXHGCMCALLHANDLE_TYPEDEF aCallHandles[cCalls];
+    VBOXHGCMSVCPARM aaParms[cCalls][SHFL_CPARMS_WRITE];
+    uint32_t au32Seq[cCalls];
+    int rc;
+
+    AssertCompile(cCalls <= RT_ELEMENTS(g_aTestWrites));
+    RTTestSub(hTest, "Concurrent calls on the workers");
+    Root = initWithWritableMapping(hTest, &svcTable, &svcHelpers,
+                                   "/test/mapping", "testname");
+    for (unsigned i = 0; i < cFiles; i++)
+    {
+        testRTFileOpenpFile = (RTFILE)(uintptr_t)(0x10000 + i);
+        rc = createFile(&svcTable, Root, "/test/file", SHFL_CF_ACCESS_WRITE,
+                        &aHandles[i], NULL);
+        RTTEST_CHECK_RC_OK(hTest, rc);
+    }
+
+    testWorkersStart();
+    RTTEST_CHECK(hTest, testWorkersCount() > 0);
+    ASMAtomicWriteU32(&g_cTestWrites, 0);
+    ASMAtomicWriteBool(&g_fTestRecordWrites, true);
+    for (unsigned iRound = 0; iRound < cRounds; iRound++)
+        for (unsigned i = 0; i < cFiles; i++)
+        {
+            unsigned iCall = iRound * cFiles + i;
+            au32Seq[iCall] = iRound;
+            aCallHandles[iCall].rc = VERR_IPE_UNINITIALIZED_STATUS;
+            aaParms[iCall][0].setUInt32(Root);
+            aaParms[iCall][1].setUInt64(aHandles[i]);
+            aaParms[iCall][2].setUInt64(0);
+            aaParms[iCall][3].setUInt32(sizeof(au32Seq[iCall]));
+            aaParms[iCall][4].setPointer(&au32Seq[iCall], sizeof(au32Seq[iCall]));
+            svcTable.pfnCall(svcTable.pvService, &aCallHandles[iCall], 0,
+                             svcTable.pvService, SHFL_FN_WRITE,
+                             SHFL_CPARMS_WRITE, aaParms[iCall]);
+        }
+    testWorkersWaitIdle();
+    ASMAtomicWriteBool(&g_fTestRecordWrites, false);
+
+    /* Every call was completed, and the writes to each file were done in
+     * the order they were issued. */
+    for (unsigned iCall = 0; iCall < cCalls; iCall++)
+        RTTEST_CHECK_RC_OK(hTest, aCallHandles[iCall].rc);
+    uint32_t const cWrites = ASMAtomicReadU32(&g_cTestWrites);
+    RTTEST_CHECK_MSG(hTest, cWrites == cCalls, (hTest, "cWrites=%u\n", cWrites));
+    for (unsigned i = 0; i < cFiles; i++)
+    {
+        RTFILE const hFile = (RTFILE)(uintptr_t)(0x10000 + i);
+        uint32_t uNext = 0;
+        for (uint32_t iWrite = 0; iWrite < RT_MIN(cWrites, RT_ELEMENTS(g_aTestWrites)); iWrite++)
+            if (g_aTestWrites[iWrite].hFile == hFile)
+            {
+                RTTEST_CHECK_MSG(hTest, g_aTestWrites[iWrite].uSeq == uNext,
+                                 (hTest, "file %u: write %u, expected %u\n", i, g_aTestWrites[iWrite].uSeq, uNext));
+                uNext = g_aTestWrites[iWrite].uSeq + 1;
+            }
+        RTTEST_CHECK_MSG(hTest, uNext == cRounds, (hTest, "file %u: %u writes\n", i, uNext));
+    }
+    testWorkersStop();
+
+    unmapAndRemoveMapping(hTest, &svcTable, Root, "testname");
+    AssertReleaseRC(svcTable.pfnDisconnect(NULL, 0, svcTable.pvService));
+    RTTestGuardedFree(hTest, svcTable.pvService);
+}
+
+
+/** Host paths for the attribute cache tests. */
+#define TST_CACHE_DIR           RTPATH_SLASH_STR "test" RTPATH_SLASH_STR "dir"
+#define TST_CACHE_PATH(a_Name)  TST_CACHE_DIR RTPATH_SLASH_STR a_Name
+
+/**
+ * Enables the attribute cache for a sub-test.
+ *
+ * @param  cMsTtl  The lifetime of cached information.
+ */
+static void testCacheEnable(RTTEST hTest, uint32_t cMsTtl)
+{
+    char szTtl[32];
+    RTStrPrintf(szTtl, sizeof(szTtl), "%u", cMsTtl);
+    RTTEST_CHECK_RC_OK(hTest, RTEnvSet("VBOX_SHFL_CACHE_TTL_MS", szTtl));
+    RTTEST_CHECK_RC_OK(hTest, vbsfCacheInit());
+    RTEnvUnset("VBOX_SHFL_CACHE_TTL_MS");
+}
+
+/** Queries an object through the cache, returns the size reported. */
+static RTFOFF testCacheQuerySize(RTTEST hTest, const char *pszPath, uint32_t fFlags)
+{
+    RTFSOBJINFO Info;
+    RT_ZERO(Info);
+    RTTEST_CHECK_RC_OK(hTest, vbsfCacheQueryInfo(pszPath, &Info, fFlags));
+    return Info.cbObject;
+}
+
+void testCacheHit(RTTEST hTest)
+{
+    RTTestSub(hTest, "Attribute cache hit");
+    testCacheEnable(hTest, RT_MS_1MIN);
+    g_cTestRTPathQueryInfoEx = 0;
+    g_cbTestRTPathQueryInfoExObject = 42;
+    RTTEST_CHECK(hTest, testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK) == 42);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 1);
+
+    /* Answered from the cache, the host sees the new size only for other
+     * objects and other flags. */
+    g_cbTestRTPathQueryInfoExObject = 43;
+    RTTEST_CHECK(hTest, testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK) == 42);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 1);
+    RTTEST_CHECK(hTest, testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_FOLLOW_LINK) == 43);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 2);
+    RTTEST_CHECK(hTest, testCacheQuerySize(hTest, TST_CACHE_PATH("other"), RTPATH_F_ON_LINK) == 43);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 3);
+    vbsfCacheTerm();
+
+    /* Nothing is cached while the cache is disabled. */
+    RTTEST_CHECK(hTest, testCacheQuerySize(hTest, TST_CACHE_PATH("other"), RTPATH_F_ON_LINK) == 43);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 4);
+    g_cbTestRTPathQueryInfoExObject = 0;
+}
+
+void testCacheExpiry(RTTEST hTest)
+{
+    RTTestSub(hTest, "Attribute cache expiry");
+    testCacheEnable(hTest, 50);
+    g_cTestRTPathQueryInfoEx = 0;
+    testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 1);
+    RTThreadSleep(200);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 2);
+    vbsfCacheTerm();
+}
+
+void testCacheInvalidate(RTTEST hTest)
+{
+    static const char * const s_apszEntries[] = { "file", "other", NULL };
+    char szPath[] = TST_CACHE_PATH("file");
+    char *pszName = &szPath[sizeof(TST_CACHE_DIR)];
+
+    RTTestSub(hTest, "Attribute cache invalidation");
+    testCacheEnable(hTest, RT_MS_1MIN);
+    g_papszTestRTDirReadEntries = s_apszEntries;
+    g_cTestRTPathQueryInfoEx = 0;
+    g_cTestRTDirOpen = 0;
+    testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("other"), RTPATH_F_ON_LINK);
+    testCacheQuerySize(hTest, TST_CACHE_DIR, RTPATH_F_ON_LINK);
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VINF_SUCCESS);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 3);
+    RTTEST_CHECK(hTest, g_cTestRTDirOpen == 1);
+
+    /* Changing the attributes of an object (a write, say) only drops that
+     * object. */
+    vbsfCacheInvalidate(TST_CACHE_PATH("file"), VBSF_CACHE_INV_F_OBJECT);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 4);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("other"), RTPATH_F_ON_LINK);
+    testCacheQuerySize(hTest, TST_CACHE_DIR, RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 4);
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VINF_SUCCESS);
+    RTTEST_CHECK(hTest, g_cTestRTDirOpen == 1);
+
+    /* Removing or creating an entry drops it, the listing and the parent
+     * directory. */
+    vbsfCacheInvalidate(TST_CACHE_PATH("file"), VBSF_CACHE_INV_F_ENTRY);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("other"), RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 4);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("file"), RTPATH_F_ON_LINK);
+    testCacheQuerySize(hTest, TST_CACHE_DIR, RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 6);
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VINF_SUCCESS);
+    RTTEST_CHECK(hTest, g_cTestRTDirOpen == 2);
+
+    /* Removing or renaming a directory drops everything below it. */
+    vbsfCacheInvalidate(TST_CACHE_DIR, VBSF_CACHE_INV_F_SUBTREE);
+    testCacheQuerySize(hTest, TST_CACHE_PATH("other"), RTPATH_F_ON_LINK);
+    RTTEST_CHECK(hTest, g_cTestRTPathQueryInfoEx == 7);
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VINF_SUCCESS);
+    RTTEST_CHECK(hTest, g_cTestRTDirOpen == 3);
+
+    g_papszTestRTDirReadEntries = NULL;
+    vbsfCacheTerm();
+}
+
+void testCacheCorrectCasing(RTTEST hTest)
+{
+    static const char * const s_apszEntries[] = { "File.txt", "other", NULL };
+    char szPath[RTPATH_MAX];
+    char *pszName = &szPath[sizeof(TST_CACHE_DIR)];
+
+    RTTestSub(hTest, "Attribute cache case correction");
+    RTStrCopy(szPath, sizeof(szPath), TST_CACHE_PATH("FILE.TXT"));
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VERR_NOT_SUPPORTED);
+
+    testCacheEnable(hTest, RT_MS_1MIN);
+    g_papszTestRTDirReadEntries = s_apszEntries;
+    g_cTestRTDirOpen = 0;
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VINF_SUCCESS);
+    RTTEST_CHECK_MSG(hTest, !strcmp(szPath, TST_CACHE_PATH("File.txt")), (hTest, "szPath=%s\n", szPath));
+    RTTEST_CHECK(hTest, g_cTestRTDirOpen == 1);
+
+    /* The other names come from the cached listing. */
+    RTStrCopy(szPath, sizeof(szPath), TST_CACHE_PATH("OTHER"));
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VINF_SUCCESS);
+    RTTEST_CHECK_MSG(hTest, !strcmp(szPath, TST_CACHE_PATH("other")), (hTest, "szPath=%s\n", szPath));
+    RTStrCopy(szPath, sizeof(szPath), TST_CACHE_PATH("missing"));
+    RTTEST_CHECK_RC(hTest, vbsfCacheCorrectCasing(szPath, pszName), VERR_FILE_NOT_FOUND);
+    RTTEST_CHECK_MSG(hTest, !strcmp(szPath, TST_CACHE_PATH("missing")), (hTest, "szPath=%s\n", szPath));
+    RTTEST_CHECK(hTest, g_cTestRTDirOpen == 1);
+
+    g_papszTestRTDirReadEntries = NULL;
+    vbsfCacheTerm();
+}
+
+
 /*********************************************************************************************************************************
 *   Main code                                                                                                                    *
 *********************************************************************************************************************************/
@@ -1133,6 +1845,7 @@ static void testAPI(RTTEST hTest)
     testLock(hTest);
     testFlush(hTest);
     testDirList(hTest);
+    testQueryInfoBulk(hTest);
     testReadLink(hTest);
     testFSInfo(hTest);
     testRemove(hTest);
@@ -1140,6 +1853,8 @@ static void testAPI(RTTEST hTest)
     testSymlink(hTest);
     testMappingsAdd(hTest);
     testMappingsRemove(hTest);
+    testWorkers(hTest);
+    testCache(hTest);
     /* testSetStatusLed(hTest); */
 }
 
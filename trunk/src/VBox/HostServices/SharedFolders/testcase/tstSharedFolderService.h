@@ -19,6 +19,7 @@
 
 /* Grumble... if the coding style let us use the anonymous "struct RTTESTINT *"
  * instead of "PRTTEST" here we wouldn't need to unnecessarily include this. */
+#include <VBox/hgcmsvc.h>
 #include <iprt/test.h>
 
 void testMappingsQuery(RTTEST hTest);
@@ -84,6 +85,15 @@ void testDirList(RTTEST hTest);
 /* Sub-tests for testDirList(). */
 void testDirListBadParameters(RTTEST hTest);
 void testDirListEmpty(RTTEST hTest);
+void testDirListBatchEmpty(RTTEST hTest);
+void testDirListBatchMany(RTTEST hTest);
+void testDirListBatchContinue(RTTEST hTest);
+
+void testQueryInfoBulk(RTTEST hTest);
+/* Sub-tests for testQueryInfoBulk(). */
+void testQueryInfoBulkSimple(RTTEST hTest);
+void testQueryInfoBulkNotFound(RTTEST hTest);
+void testQueryInfoBulkInvalidPath(RTTEST hTest);
 
 void testReadLink(RTTEST hTest);
 /* Sub-tests for testReadLink(). */
@@ -117,6 +127,24 @@ void testMappingsRemove(RTTEST hTest);
 /* Sub-tests for testMappingsRemove(). */
 void testMappingsRemoveBadParameters(RTTEST hTest);
 
+void testWorkers(RTTEST hTest);
+/* Sub-tests for testWorkers(). */
+void testWorkersRouting(RTTEST hTest);
+void testWorkersConcurrent(RTTEST hTest);
+/* Worker pool helpers for the sub-tests. */
+void testWorkersStart(void);
+void testWorkersStop(void);
+void testWorkersWaitIdle(void);
+uint32_t testWorkersCount(void);
+uint32_t testWorkerSelect(uint32_t u32Function, uint32_t cParms, VBOXHGCMSVCPARM paParms[]);
+
+void testCache(RTTEST hTest);
+/* Sub-tests for testCache(). */
+void testCacheHit(RTTEST hTest);
+void testCacheExpiry(RTTEST hTest);
+void testCacheInvalidate(RTTEST hTest);
+void testCacheCorrectCasing(RTTEST hTest);
+
 #if 0  /* Where should this go? */
 void testSetStatusLed(RTTEST hTest);
 /* Sub-tests for testStatusLed(). */
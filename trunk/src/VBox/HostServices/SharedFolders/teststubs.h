@@ -34,6 +34,8 @@ extern int testRTDirCreate(const char *pszPath, RTFMODE fMode, uint32_t fCreate)
 extern int testRTDirOpen(PRTDIR *ppDir, const char *pszPath);
 #define RTDirOpenFiltered    testRTDirOpenFiltered
 extern int testRTDirOpenFiltered(PRTDIR *ppDir, const char *pszPath, RTDIRFILTER enmFilter, uint32_t fOpen);
+#define RTDirRead            testRTDirRead
+extern int testRTDirRead(PRTDIR pDir, PRTDIRENTRY pDirEntry, size_t *pcbDirEntry);
 #define RTDirQueryInfo       testRTDirQueryInfo
 extern int testRTDirQueryInfo(PRTDIR pDir, PRTFSOBJINFO pObjInfo, RTFSOBJATTRADD enmAdditionalAttribs);
 #define RTDirRemove          testRTDirRemove
@@ -20,6 +20,7 @@
 #endif
 
 #include "vbsfpath.h"
+#include "vbsfcache.h"
 #include "mappings.h"
 #include "vbsf.h"
 #include "shflhandle.h"
@@ -434,7 +435,7 @@ static int vbsfOpenFile(SHFLCLIENTDATA *pClient, const char *pszPath, SHFLCREATE
             RTFSOBJINFO info;
 
             /** @todo Possible race left here. */
-            if (RT_SUCCESS(RTPathQueryInfoEx(pszPath, &info, RTFSOBJATTRADD_NOTHING, SHFL_RT_LINK(pClient))))
+            if (RT_SUCCESS(vbsfCacheQueryInfo(pszPath, &info, SHFL_RT_LINK(pClient))))
             {
 #ifdef RT_OS_WINDOWS
                 info.Attr.fMode |= 0111;
@@ -487,6 +488,10 @@ static int vbsfOpenFile(SHFLCLIENTDATA *pClient, const char *pszPath, SHFLCREATE
         {
             pParms->Result = SHFL_FILE_CREATED;
         }
+        if (   (fOpen & RTFILE_O_ACTION_MASK) != RTFILE_O_OPEN
+            || (fOpen & RTFILE_O_TRUNCATE))
+            vbsfCacheInvalidate(pszPath, VBSF_CACHE_INV_F_ENTRY);
+        pHandle->pszPath = RTStrDup(pszPath);
 #if 0
         /** @todo */
         /* Set new attributes. */
@@ -586,7 +591,9 @@ static int vbsfOpenDir(SHFLCLIENTDATA *pClient, const char *pszPath,
 
             pParms->Result = SHFL_FILE_CREATED;
             rc = RTDirCreate(pszPath, fMode, 0);
-            if (RT_FAILURE(rc))
+            if (RT_SUCCESS(rc))
+                vbsfCacheInvalidate(pszPath, VBSF_CACHE_INV_F_ENTRY);
+            else
             {
                 switch (rc)
                 {
@@ -615,6 +622,7 @@ static int vbsfOpenDir(SHFLCLIENTDATA *pClient, const char *pszPath,
                 {
                     vbfsCopyFsObjInfoFromIprt(&pParms->Info, &info);
                 }
+                pHandle->pszPath = RTStrDup(pszPath);
             }
             else
             {
@@ -708,7 +716,7 @@ static int vbsfLookupFile(SHFLCLIENTDATA *pClient, char *pszPath, SHFLCREATEPARM
     RTFSOBJINFO info;
     int rc;
 
-    rc = RTPathQueryInfoEx(pszPath, &info, RTFSOBJATTRADD_NOTHING, SHFL_RT_LINK(pClient));
+    rc = vbsfCacheQueryInfo(pszPath, &info, SHFL_RT_LINK(pClient));
     LogFlow(("SHFL_CF_LOOKUP\n"));
     /* Client just wants to know if the object exists. */
     switch (rc)
@@ -814,8 +822,8 @@ int vbsfCreate(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pPath, uint32
             /* Query path information. */
             RTFSOBJINFO info;
 
-            rc = RTPathQueryInfoEx(pszFullPath, &info, RTFSOBJATTRADD_NOTHING, SHFL_RT_LINK(pClient));
-            LogFlow(("RTPathQueryInfoEx returned %Rrc\n", rc));
+            rc = vbsfCacheQueryInfo(pszFullPath, &info, SHFL_RT_LINK(pClient));
+            LogFlow(("vbsfCacheQueryInfo returned %Rrc\n", rc));
 
             if (RT_SUCCESS(rc))
             {
@@ -1030,6 +1038,9 @@ int vbsfWrite(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle, uint64_
 
     rc = RTFileWrite(pHandle->file.Handle, pBuffer, *pcbBuffer, &count);
     *pcbBuffer = (uint32_t)count;
+    /* Only writing data changes the size and the timestamps. */
+    if (count && pHandle->pszPath)
+        vbsfCacheInvalidate(pHandle->pszPath, VBSF_CACHE_INV_F_OBJECT);
     Log(("RTFileWrite returned %Rrc bytes written %x\n", rc, count));
     return rc;
 }
@@ -1066,6 +1077,39 @@ int vbsfFlush(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle)
     return rc;
 }
 
+#ifdef RT_OS_DARWIN
+/**
+ * Converts a directory entry name to Normalization Form C (composed Unicode)
+ * in place.
+ *
+ * We need this because the Mac OS X file system uses NFD (Normalization Form
+ * D, decomposed Unicode) while most other OS', server-side programs usually
+ * expect NFC.  The composed form is never longer than the decomposed one.
+ *
+ * @todo This belongs in rtPathToNative or in the windows shared folder file
+ *       system driver...  The question is simply whether the NFD normalization
+ *       is actually applied on a (virtual) file system level in darwin, or
+ *       just by the user mode application libs.
+ */
+static void vbsfNormalizeNameNFC(PRTUTF16 pwszString)
+{
+    uint16_t ucs2Length;
+    CFRange rangeCharacters;
+    CFMutableStringRef inStr = ::CFStringCreateMutable(NULL, 0);
+
+    ::CFStringAppendCharacters(inStr, (UniChar *)pwszString, RTUtf16Len(pwszString));
+    ::CFStringNormalize(inStr, kCFStringNormalizationFormC);
+    ucs2Length = ::CFStringGetLength(inStr);
+
+    rangeCharacters.location = 0;
+    rangeCharacters.length = ucs2Length;
+    ::CFStringGetCharacters(inStr, rangeCharacters, pwszString);
+    pwszString[ucs2Length] = 0x0000; // NULL terminated
+
+    CFRelease(inStr);
+}
+#endif
+
 #ifdef UNITTEST
 /** Unit test the SHFL_FN_LIST API.  Located here as a form of API
  * documentation. */
@@ -1075,6 +1119,12 @@ void testDirList(RTTEST hTest)
     testDirListBadParameters(hTest);
     /* Test listing an empty directory (simple edge case). */
     testDirListEmpty(hTest);
+    /* Test listing an empty directory in batch mode. */
+    testDirListBatchEmpty(hTest);
+    /* Several entries in one batch. */
+    testDirListBatchMany(hTest);
+    /* Entries which don't fit are returned by the next call. */
+    testDirListBatchContinue(hTest);
     /* Add tests as required... */
 }
 #endif
@@ -1231,29 +1281,7 @@ int vbsfDirList(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle, SHFLS
             AssertRC(rc2);
 
 #ifdef RT_OS_DARWIN
-/** @todo This belongs in rtPathToNative or in the windows shared folder file system driver...
- * The question is simply whether the NFD normalization is actually applied on a (virtual) file
- * system level in darwin, or just by the user mode application libs. */
-            {
-                // Convert to
-                // Normalization Form C (composed Unicode). We need this because
-                // Mac OS X file system uses NFD (Normalization Form D :decomposed Unicode)
-                // while most other OS', server-side programs usually expect NFC.
-                uint16_t ucs2Length;
-                CFRange rangeCharacters;
-                CFMutableStringRef inStr = ::CFStringCreateMutable(NULL, 0);
-
-                ::CFStringAppendCharacters(inStr, (UniChar *)pwszString, RTUtf16Len(pwszString));
-                ::CFStringNormalize(inStr, kCFStringNormalizationFormC);
-                ucs2Length = ::CFStringGetLength(inStr);
-
-                rangeCharacters.location = 0;
-                rangeCharacters.length = ucs2Length;
-                ::CFStringGetCharacters(inStr, rangeCharacters, pwszString);
-                pwszString[ucs2Length] = 0x0000; // NULL terminated
-
-                CFRelease(inStr);
-            }
+            vbsfNormalizeNameNFC(pwszString);
 #endif
             pSFDEntry->name.u16Length = (uint32_t)RTUtf16Len(pSFDEntry->name.String.ucs2) * 2;
             pSFDEntry->name.u16Size = pSFDEntry->name.u16Length + 2;
@@ -1290,6 +1318,246 @@ end:
     return rc;
 }
 
+/**
+ * Lists directory entries together with their object information in the
+ * compact SHFLDIRBATCHENTRY format (SHFL_FN_LIST_BATCH).
+ *
+ * Continues where the previous SHFL_FN_LIST or SHFL_FN_LIST_BATCH call on the
+ * handle stopped.  An entry which does not fit into the buffer is kept in the
+ * handle and returned by the next call.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_BUFFER_OVERFLOW if not even the first entry fits.
+ * @retval  VERR_INVALID_STATE if the handle is used for a filtered
+ *          SHFL_FN_LIST search.
+ * @param   pClient     Data structure describing the client.
+ * @param   root        The index of the shared folder in the table of mappings.
+ * @param   Handle      The directory handle.
+ * @param   flags       Flags, must be zero.
+ * @param   pcbBuffer   In: size of @a pBuffer, out: number of bytes used.
+ * @param   pBuffer     Where to store the entries.
+ * @param   pcEntries   Where to return the number of entries.
+ * @param   pfEnd       Where to return whether the end of the directory was
+ *                      reached.
+ */
+int vbsfDirListBatch(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Handle, uint32_t flags,
+                     uint32_t *pcbBuffer, uint8_t *pBuffer, uint32_t *pcEntries, bool *pfEnd)
+{
+    SHFLFILEHANDLE *pHandle = vbsfQueryDirHandle(pClient, Handle);
+    bool const      fUtf8   = BIT_FLAG(pClient->fu32Flags, SHFL_CF_UTF8) != 0;
+
+    if (pHandle == 0 || pcbBuffer == 0 || pBuffer == 0 || pcEntries == 0 || pfEnd == 0)
+    {
+        AssertFailed();
+        return VERR_INVALID_PARAMETER;
+    }
+    if (flags != 0)
+        return VERR_INVALID_FLAGS;
+
+    /* Is the guest allowed to access this share?
+     * Checked here because the shared folder can be removed from the VM settings. */
+    bool fWritable;
+    int rc = vbsfMappingsQueryWritable(pClient, root, &fWritable);
+    if (RT_FAILURE(rc))
+        return VERR_ACCESS_DENIED;
+
+    /* The search handle belongs to a filtered SHFL_FN_LIST enumeration and
+     * mixing the two would return entries from the wrong listing. */
+    if (pHandle->dir.SearchHandle)
+        return VERR_INVALID_STATE;
+
+    uint32_t const cbBuffer = *pcbBuffer;
+    uint32_t       offEntry = 0;
+    PSHFLDIRBATCHENTRY pPrevEntry = NULL;
+    *pcbBuffer = 0;
+    *pcEntries = 0;
+    *pfEnd     = false;
+
+    uint32_t const cbDirEntry   = 4096;
+    PRTDIRENTRYEX  pDirEntryOrg = (PRTDIRENTRYEX)RTMemAlloc(cbDirEntry);
+    if (!pDirEntryOrg)
+        return VERR_NO_MEMORY;
+
+    for (;;)
+    {
+        PRTDIRENTRYEX pDirEntry;
+        if (pHandle->dir.pLastValidEntry)
+            pDirEntry = pHandle->dir.pLastValidEntry;
+        else
+        {
+            pDirEntry = pDirEntryOrg;
+
+            size_t cbDirEntrySize = cbDirEntry;
+            rc = RTDirReadEx(pHandle->dir.Handle, pDirEntry, &cbDirEntrySize, RTFSOBJATTRADD_NOTHING, SHFL_RT_LINK(pClient));
+            if (rc == VERR_NO_MORE_FILES)
+            {
+                *pfEnd = true;
+                rc = VINF_SUCCESS;
+                break;
+            }
+            if (   rc != VINF_SUCCESS
+                && rc != VWRN_NO_DIRENT_INFO)
+            {
+                if (   rc == VERR_NO_TRANSLATION
+                    || rc == VERR_INVALID_UTF8_ENCODING)
+                    continue;
+                break;
+            }
+        }
+
+        /* Overestimating for UTF-16, the exact size is known after the conversion. */
+        uint32_t cbName   = fUtf8 ? pDirEntry->cbName : pDirEntry->cbName * 2;
+        uint32_t cbNeeded = RT_OFFSETOF(SHFLDIRBATCHENTRY, Name) + cbName + (fUtf8 ? 1 : 2);
+        if (cbNeeded > cbBuffer - offEntry)
+        {
+            if (pDirEntry == pDirEntryOrg)
+            {
+                /* Keep the entry for the next call, or else it's lost forever. */
+                pHandle->dir.pLastValidEntry = pDirEntryOrg;
+                pDirEntryOrg = NULL;
+            }
+            rc = *pcEntries ? VINF_SUCCESS : VERR_BUFFER_OVERFLOW;
+            break;
+        }
+
+        PSHFLDIRBATCHENTRY pEntry = (PSHFLDIRBATCHENTRY)&pBuffer[offEntry];
+#ifdef RT_OS_WINDOWS
+        pDirEntry->Info.Attr.fMode |= 0111;
+#endif
+        vbfsCopyFsObjInfoFromIprt(&pEntry->Info, &pDirEntry->Info);
+        pEntry->offNext     = 0;
+        pEntry->u16Reserved = 0;
+        if (fUtf8)
+            memcpy(&pEntry->Name.utf8[0], pDirEntry->szName, pDirEntry->cbName + 1);
+        else
+        {
+            PRTUTF16 pwszString = &pEntry->Name.ucs2[0];
+            int rc2 = RTStrToUtf16Ex(pDirEntry->szName, RTSTR_MAX, &pwszString, pDirEntry->cbName + 1, NULL);
+            AssertRC(rc2);
+#ifdef RT_OS_DARWIN
+            vbsfNormalizeNameNFC(pwszString);
+#endif
+            cbName   = (uint32_t)RTUtf16Len(pwszString) * 2;
+            cbNeeded = RT_OFFSETOF(SHFLDIRBATCHENTRY, Name) + cbName + 2;
+        }
+        pEntry->cbName = (uint16_t)cbName;
+
+        if (pPrevEntry)
+            pPrevEntry->offNext = (uint32_t)((uintptr_t)pEntry - (uintptr_t)pPrevEntry);
+        pPrevEntry  = pEntry;
+        *pcbBuffer  = offEntry + cbNeeded;
+        offEntry    = RT_MIN(RT_ALIGN_32(*pcbBuffer, 8), cbBuffer);
+        *pcEntries += 1;
+
+        /* Free the saved last entry, that we've just returned */
+        if (pHandle->dir.pLastValidEntry)
+        {
+            RTMemFree(pHandle->dir.pLastValidEntry);
+            pHandle->dir.pLastValidEntry = NULL;
+        }
+    }
+
+    RTMemFree(pDirEntryOrg);
+
+    Log(("vbsfDirListBatch: rc=%Rrc cEntries=%u cb=%u fEnd=%d\n", rc, *pcEntries, *pcbBuffer, *pfEnd));
+    return rc;
+}
+
+#ifdef UNITTEST
+/** Unit test the SHFL_FN_QUERY_INFO_BULK API.  Located here as a form of API
+ * documentation. */
+void testQueryInfoBulk(RTTEST hTest)
+{
+    /* Simple query of two existing files. */
+    testQueryInfoBulkSimple(hTest);
+    /* Missing files are reported per path. */
+    testQueryInfoBulkNotFound(hTest);
+    /* Invalid paths fail on their own, malformed requests as a whole. */
+    testQueryInfoBulkInvalidPath(hTest);
+    /* Add tests as required... */
+}
+#endif
+/**
+ * Queries the object information of several paths at once
+ * (SHFL_FN_QUERY_INFO_BULK).
+ *
+ * Each path is looked up like SHFL_FN_CREATE with SHFL_CF_LOOKUP does it, and
+ * the per path status is returned in the result array.  Lookups are served
+ * from the attribute cache where possible.
+ *
+ * @returns IPRT status code.  Failures of individual lookups are reported in
+ *          the results, not here.
+ * @param   pClient     Data structure describing the client.
+ * @param   root        The index of the shared folder in the table of mappings.
+ * @param   flags       Flags, must be zero.
+ * @param   cPaths      Number of paths.
+ * @param   pbPaths     The paths, SHFLSTRING structures stored back to back at
+ *                      4 byte aligned offsets.
+ * @param   cbPaths     Size of the @a pbPaths buffer.
+ * @param   paResults   Where to return the results, @a cPaths entries.
+ */
+int vbsfQueryInfoBulk(SHFLCLIENTDATA *pClient, SHFLROOT root, uint32_t flags, uint32_t cPaths,
+                      uint8_t *pbPaths, uint32_t cbPaths, PSHFLINFOBULKRESULT paResults)
+{
+    if (pbPaths == 0 || paResults == 0)
+    {
+        AssertFailed();
+        return VERR_INVALID_PARAMETER;
+    }
+    if (flags != 0)
+        return VERR_INVALID_FLAGS;
+    if (cPaths > SHFL_QUERY_INFO_BULK_MAX_PATHS)
+        return VERR_TOO_MUCH_DATA;
+
+    /* Is the guest allowed to access this share? */
+    bool fWritable;
+    int rc = vbsfMappingsQueryWritable(pClient, root, &fWritable);
+    if (RT_FAILURE(rc))
+        return VERR_ACCESS_DENIED;
+
+    bool const fUtf8 = BIT_FLAG(pClient->fu32Flags, SHFL_CF_UTF8) != 0;
+    uint32_t   off   = 0;
+    for (uint32_t i = 0; i < cPaths; i++)
+    {
+        /* Validate the string before doing anything with it. */
+        if (off >= cbPaths)
+            return VERR_INVALID_PARAMETER;
+        PSHFLSTRING pPath    = (PSHFLSTRING)&pbPaths[off];
+        uint32_t    cbRemain = cbPaths - off;
+        if (!ShflStringIsValidIn(pPath, cbRemain, fUtf8))
+            return VERR_INVALID_PARAMETER;
+        off += RT_ALIGN_32(ShflStringSizeOfBuffer(pPath), 4);
+
+        PSHFLINFOBULKRESULT pResult = &paResults[i];
+        RT_ZERO(pResult->Info);
+        pResult->Result = SHFL_NO_RESULT;
+
+        char *pszFullPath = NULL;
+        rc = vbsfBuildFullPath(pClient, root, pPath, ShflStringSizeOfBuffer(pPath), &pszFullPath, NULL);
+        if (RT_SUCCESS(rc))
+        {
+            SHFLCREATEPARMS Parms;
+            RT_ZERO(Parms);
+            Parms.CreateFlags = SHFL_CF_LOOKUP;
+            rc = vbsfLookupFile(pClient, pszFullPath, &Parms);
+            pResult->Result = Parms.Result;
+            pResult->Info   = Parms.Info;
+
+            vbsfFreeFullPath(pszFullPath);
+        }
+        else if (rc == VERR_FILE_NOT_FOUND || rc == VERR_PATH_NOT_FOUND)
+        {
+            /* Case correction did not find a component, same as a lookup would. */
+            pResult->Result = rc == VERR_FILE_NOT_FOUND ? SHFL_FILE_NOT_FOUND : SHFL_PATH_NOT_FOUND;
+            rc = VINF_SUCCESS;
+        }
+        pResult->rc = rc;
+    }
+
+    Log(("vbsfQueryInfoBulk: cPaths=%u\n", cPaths));
+    return VINF_SUCCESS;
+}
+
 #ifdef UNITTEST
 /** Unit test the SHFL_FN_READLINK API.  Located here as a form of API
  * documentation. */
@@ -1433,6 +1701,8 @@ static int vbsfSetFileInfo(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Ha
                             (RTTimeSpecGetNano(&pSFDEntry->BirthTime)) ?        &pSFDEntry->BirthTime: NULL
                             );
     }
+    /* Whether the host object changed and cached information about it is stale. */
+    bool fModified = rc == VINF_SUCCESS;
     if (rc != VINF_SUCCESS)
     {
         Log(("RTFileSetTimes failed with %Rrc\n", rc));
@@ -1460,7 +1730,9 @@ static int vbsfSetFileInfo(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Ha
 #endif
 
             rc = RTFileSetMode(pHandle->file.Handle, fMode);
-            if (rc != VINF_SUCCESS)
+            if (rc == VINF_SUCCESS)
+                fModified = true;
+            else
             {
                 Log(("RTFileSetMode %x failed with %Rrc\n", fMode, rc));
                 /* silent failure, because this tends to fail with e.g. windows guest & linux host */
@@ -1470,6 +1742,14 @@ static int vbsfSetFileInfo(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE Ha
     }
     /** @todo mode for directories */
 
+    if (fModified)
+    {
+        SHFLFILEHANDLE *pHandle = type == SHFL_HF_TYPE_DIR
+                                ? vbsfQueryDirHandle(pClient, Handle) : vbsfQueryFileHandle(pClient, Handle);
+        if (pHandle && pHandle->pszPath)
+            vbsfCacheInvalidate(pHandle->pszPath, VBSF_CACHE_INV_F_OBJECT);
+    }
+
     if (rc == VINF_SUCCESS)
     {
         uint32_t bufsize = sizeof(*pSFDEntry);
@@ -1509,6 +1789,8 @@ static int vbsfSetEndOfFile(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLHANDLE H
         rc = RTFileSetSize(pHandle->file.Handle, pSFDEntry->cbObject);
         if (rc != VINF_SUCCESS)
             AssertFailed();
+        else if (pHandle->pszPath)
+            vbsfCacheInvalidate(pHandle->pszPath, VBSF_CACHE_INV_F_OBJECT);
     }
     else
         AssertFailed();
@@ -1797,6 +2079,8 @@ int vbsfRemove(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pPath, uint32
                 rc = RTFileDelete(pszFullPath);
             else
                 rc = RTDirRemove(pszFullPath);
+            if (RT_SUCCESS(rc))
+                vbsfCacheInvalidate(pszFullPath, flags & SHFL_REMOVE_DIR ? VBSF_CACHE_INV_F_SUBTREE : VBSF_CACHE_INV_F_ENTRY);
         }
 
 #ifndef DEBUG_dmik
@@ -1867,6 +2151,12 @@ int vbsfRename(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pSrc, SHFLSTR
                 rc = RTDirRename(pszFullPathSrc, pszFullPathDest,
                                    ((flags & SHFL_RENAME_REPLACE_IF_EXISTS) ? RTPATHRENAME_FLAGS_REPLACE : 0));
             }
+            if (RT_SUCCESS(rc))
+            {
+                uint32_t fInvalidate = flags & SHFL_RENAME_FILE ? VBSF_CACHE_INV_F_ENTRY : VBSF_CACHE_INV_F_SUBTREE;
+                vbsfCacheInvalidate(pszFullPathSrc, fInvalidate);
+                vbsfCacheInvalidate(pszFullPathDest, fInvalidate);
+            }
         }
 
         /* free the path string */
@@ -1922,6 +2212,8 @@ int vbsfSymlink(SHFLCLIENTDATA *pClient, SHFLROOT root, SHFLSTRING *pNewPath, SH
                          RTSYMLINKTYPE_UNKNOWN, 0);
     if (RT_SUCCESS(rc))
     {
+        vbsfCacheInvalidate(pszFullNewPath, VBSF_CACHE_INV_F_ENTRY);
+
         RTFSOBJINFO info;
         rc = RTPathQueryInfoEx(pszFullNewPath, &info, RTFSOBJATTRADD_NOTHING, SHFL_RT_LINK(pClient));
         if (RT_SUCCESS(rc))
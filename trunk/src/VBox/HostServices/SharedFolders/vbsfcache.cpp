@@ -0,0 +1,990 @@
+/* $Id$ */
+/** @file
+ * Shared Folders - Host file system attribute and directory listing cache.
+ */
+
+/*
+ * Copyright (C) 2006-2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+/** @page pg_shfl_cache     Shared Folders Attribute Cache
+ *
+ * Guests tend to look up the same host paths over and over again, and every
+ * SHFL_FN_CREATE call stats the path on the host, often several times when
+ * the case of the path has to be corrected.  The attribute cache remembers
+ * the results of these queries.
+ *
+ * The cache keeps one record per host directory.  A record holds the
+ * RTPathQueryInfoEx results (including "not found") for entries of the
+ * directory and, when case correction needed it, the names of all entries
+ * in the directory.  Records are kept in LRU order and the cache is bounded
+ * by the number of records, the number of cached objects and the size of
+ * the cached listings.
+ *
+ * Cached information is dropped when:
+ *      - the service itself modifies an object, see vbsfCacheInvalidate;
+ *      - on Linux hosts, inotify reports a change in a directory with a
+ *        record;
+ *      - it expires.  Entries in directories without a watch only live for
+ *        a short time.  Entries in watched directories expire as well, as
+ *        inotify does not report everything (changes made by other hosts
+ *        on network file systems, symbolic link targets).
+ *
+ * The service processes calls on several threads, so a lookup racing a
+ * modification must not put stale information into the cache.  Each cached
+ * object has a generation counter, which invalidating just that object
+ * bumps.  The cache as a whole has a global generation counter, which is
+ * only bumped when records or objects are freed or when the entries of a
+ * directory change (creation, removal, renaming).  A lookup only stores the
+ * result of its host query if neither the global nor the object generation
+ * changed while it was querying.
+ *
+ * Setting the VBOX_SHFL_CACHE_TTL_MS environment variable changes how long
+ * entries live, 0 disables the cache.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "vbsfcache.h"
+
+#include <iprt/alloc.h>
+#include <iprt/assert.h>
+#include <iprt/critsect.h>
+#include <iprt/dir.h>
+#include <iprt/env.h>
+#include <iprt/list.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+#if defined(RT_OS_LINUX) && !defined(UNITTEST)
+# define VBSF_CACHE_WITH_INOTIFY
+# include <errno.h>
+# include <fcntl.h>
+# include <poll.h>
+# include <unistd.h>
+/* Workaround for <sys/cdef.h> defining __flexarr to [] which beats us in
+ * struct inotify_event (char name __flexarr). */
+# include <sys/cdefs.h>
+# undef __flexarr
+# define __flexarr [0]
+# include <sys/inotify.h>
+#endif
+
+#ifdef UNITTEST
+# include "testcase/tstSharedFolderService.h"
+# include "teststubs.h"
+#endif
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Maximum number of directory records. */
+#define VBSF_CACHE_MAX_DIRS             256
+/** Maximum number of cached objects in all directory records. */
+#define VBSF_CACHE_MAX_OBJECTS          16384
+/** Maximum size of a single cached directory listing. */
+#define VBSF_CACHE_MAX_LISTING          _256K
+/** Maximum size of all cached directory listings. */
+#define VBSF_CACHE_MAX_LISTINGS         _8M
+/** Default lifetime of cached information in milliseconds. */
+#define VBSF_CACHE_TTL_MS               2000
+/** Lifetime of cached information for directories which are not watched for
+ *  changes, in milliseconds. */
+#define VBSF_CACHE_TTL_UNWATCHED_MS     200
+
+#ifdef VBSF_CACHE_WITH_INOTIFY
+/** The events we watch directories for. */
+# define VBSF_CACHE_INOTIFY_MASK        (  IN_ATTRIB | IN_CLOSE_WRITE | IN_CREATE | IN_DELETE | IN_DELETE_SELF \
+                                         | IN_MODIFY | IN_MOVE_SELF | IN_MOVED_FROM | IN_MOVED_TO | IN_ONLYDIR)
+#endif
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * Cached query result for an object in a directory.
+ */
+typedef struct VBSFCACHEOBJ
+{
+    /** String space core, keyed by the name of the object. */
+    RTSTRSPACECORE      Core;
+    /** When this entry expires (RTTimeMilliTS), 0 if it holds no information. */
+    uint64_t            msExpire;
+    /** Bumped when the object is invalidated, so that a query racing the
+     *  invalidation doesn't cache stale information. */
+    uint32_t            uGeneration;
+    /** The RTPATH_F_XXX flags the object was queried with. */
+    uint32_t            fFlags;
+    /** The status code of the query. */
+    int                 rc;
+    /** The object information, valid if rc indicates success. */
+    RTFSOBJINFO         Info;
+    /** The name of the object (variable length). */
+    char                szName[1];
+} VBSFCACHEOBJ;
+/** Pointer to a cached object. */
+typedef VBSFCACHEOBJ *PVBSFCACHEOBJ;
+
+/**
+ * Cache record of a host directory.
+ */
+typedef struct VBSFCACHEDIR
+{
+    /** String space core, keyed by the host path including the trailing
+     *  path delimiter. */
+    RTSTRSPACECORE      Core;
+    /** Node in the LRU list, most recently used first. */
+    RTLISTNODE          ListEntry;
+    /** The cached objects in this directory (VBSFCACHEOBJ). */
+    RTSTRSPACE          Objects;
+    /** Number of cached objects. */
+    uint32_t            cObjects;
+    /** The inotify watch descriptor, -1 if not watched. */
+    int                 iWatch;
+    /** When the listing expires (RTTimeMilliTS). */
+    uint64_t            msListingExpire;
+    /** The names of the directory entries, each one zero terminated and the
+     *  list terminated by an empty string.  NULL if not cached. */
+    char               *pszzListing;
+    /** Size of the listing in bytes. */
+    size_t              cbListing;
+    /** The host path (variable length). */
+    char                szPath[1];
+} VBSFCACHEDIR;
+/** Pointer to a directory record. */
+typedef VBSFCACHEDIR *PVBSFCACHEDIR;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Whether the cache is enabled. */
+static bool             g_fCacheEnabled = false;
+/** Protects all the cache data below. */
+static RTCRITSECT       g_CacheCritSect;
+/** The directory records (VBSFCACHEDIR) by path. */
+static RTSTRSPACE       g_CacheDirs = NULL;
+/** The directory records in LRU order. */
+static RTLISTANCHOR     g_CacheLru;
+/** Number of directory records. */
+static uint32_t         g_cCacheDirs = 0;
+/** Number of cached objects in all directory records. */
+static uint32_t         g_cCacheObjects = 0;
+/** Size of all cached listings. */
+static size_t           g_cbCacheListings = 0;
+/** Bumped whenever directory records or objects are freed or the entries of
+ *  a directory change.  Invalidating the attributes of a single object only
+ *  bumps the generation of that object. */
+static uint64_t         g_uCacheGeneration = 0;
+/** Lifetime of cached information in milliseconds. */
+static uint32_t         g_cMsCacheTtl = VBSF_CACHE_TTL_MS;
+#ifdef VBSF_CACHE_WITH_INOTIFY
+/** The inotify file descriptor, -1 if not available. */
+static int              g_fdCacheInotify = -1;
+/** Pipe for waking up the inotify thread on termination. */
+static int              g_afdCacheWakeup[2] = { -1, -1 };
+/** The thread processing inotify events. */
+static RTTHREAD         g_hCacheInotifyThread = NIL_RTTHREAD;
+#endif
+
+
+/**
+ * Finds the directory part of a host path.
+ *
+ * @returns Length of the directory part including the trailing delimiter, 0
+ *          if the path has no directory part or no name.
+ * @param   pszPath     The host path.
+ * @param   cchPath     The length of the path.
+ */
+static size_t vbsfCacheSplitPath(const char *pszPath, size_t cchPath)
+{
+    size_t cchDir = cchPath;
+    while (cchDir > 0 && pszPath[cchDir - 1] != RTPATH_DELIMITER)
+        cchDir--;
+    if (cchDir == cchPath)
+        return 0;
+    return cchDir;
+}
+
+/**
+ * Returns when information cached now for the given directory expires.
+ */
+static uint64_t vbsfCacheExpireTS(PVBSFCACHEDIR pDir)
+{
+    uint32_t cMsTtl = pDir->iWatch >= 0 ? g_cMsCacheTtl : RT_MIN(g_cMsCacheTtl, VBSF_CACHE_TTL_UNWATCHED_MS);
+    return RTTimeMilliTS() + cMsTtl;
+}
+
+static DECLCALLBACK(int) vbsfCacheFreeObj(PRTSTRSPACECORE pStr, void *pvUser)
+{
+    RT_NOREF1(pvUser);
+    RTMemFree(RT_FROM_MEMBER(pStr, VBSFCACHEOBJ, Core));
+    return VINF_SUCCESS;
+}
+
+static void vbsfCacheDirDropListingLocked(PVBSFCACHEDIR pDir)
+{
+    if (pDir->pszzListing)
+    {
+        g_cbCacheListings -= pDir->cbListing;
+        RTMemFree(pDir->pszzListing);
+        pDir->pszzListing = NULL;
+        pDir->cbListing   = 0;
+    }
+}
+
+static void vbsfCacheDirFlushLocked(PVBSFCACHEDIR pDir)
+{
+    g_uCacheGeneration++;
+    RTStrSpaceDestroy(&pDir->Objects, vbsfCacheFreeObj, NULL);
+    g_cCacheObjects -= pDir->cObjects;
+    pDir->cObjects = 0;
+    vbsfCacheDirDropListingLocked(pDir);
+}
+
+static void vbsfCacheDirDestroyLocked(PVBSFCACHEDIR pDir)
+{
+    vbsfCacheDirFlushLocked(pDir);
+
+#ifdef VBSF_CACHE_WITH_INOTIFY
+    if (pDir->iWatch >= 0)
+    {
+        /* Records for different paths of the same directory share the watch. */
+        bool fShared = false;
+        PVBSFCACHEDIR pCur;
+        RTListForEach(&g_CacheLru, pCur, VBSFCACHEDIR, ListEntry)
+            if (pCur != pDir && pCur->iWatch == pDir->iWatch)
+            {
+                fShared = true;
+                break;
+            }
+        if (!fShared)
+            inotify_rm_watch(g_fdCacheInotify, pDir->iWatch);
+    }
+#endif
+
+    PRTSTRSPACECORE pCore = RTStrSpaceRemove(&g_CacheDirs, pDir->szPath);
+    Assert(pCore == &pDir->Core); NOREF(pCore);
+    RTListNodeRemove(&pDir->ListEntry);
+    g_cCacheDirs--;
+    RTMemFree(pDir);
+}
+
+/**
+ * Frees least recently used records until the cache is within its bounds.
+ *
+ * @param   pKeep       The record which is being used and must not go away.
+ */
+static void vbsfCacheEvictLocked(PVBSFCACHEDIR pKeep)
+{
+    while (   g_cCacheDirs > VBSF_CACHE_MAX_DIRS
+           || g_cCacheObjects > VBSF_CACHE_MAX_OBJECTS
+           || g_cbCacheListings > VBSF_CACHE_MAX_LISTINGS)
+    {
+        PVBSFCACHEDIR pLast = RTListGetLast(&g_CacheLru, VBSFCACHEDIR, ListEntry);
+        if (!pLast || pLast == pKeep)
+        {
+            /* A single huge directory. */
+            if (g_cCacheObjects > VBSF_CACHE_MAX_OBJECTS)
+                vbsfCacheDirFlushLocked(pKeep);
+            break;
+        }
+        vbsfCacheDirDestroyLocked(pLast);
+    }
+}
+
+/**
+ * Looks up the record of a directory.
+ *
+ * @returns The record, NULL if not found.
+ * @param   pszDir      The directory path, with trailing delimiter.
+ * @param   cchDir      The length of the directory path.
+ * @param   fCreate     Whether to create the record if it doesn't exist.
+ *                      This also marks the record as most recently used.
+ */
+static PVBSFCACHEDIR vbsfCacheDirLookupLocked(const char *pszDir, size_t cchDir, bool fCreate)
+{
+    PVBSFCACHEDIR pDir = NULL;
+    PRTSTRSPACECORE pCore = RTStrSpaceGetN(&g_CacheDirs, pszDir, cchDir);
+    if (pCore)
+    {
+        pDir = RT_FROM_MEMBER(pCore, VBSFCACHEDIR, Core);
+        if (fCreate)
+        {
+            RTListNodeRemove(&pDir->ListEntry);
+            RTListPrepend(&g_CacheLru, &pDir->ListEntry);
+        }
+        return pDir;
+    }
+    if (!fCreate)
+        return NULL;
+
+    pDir = (PVBSFCACHEDIR)RTMemAllocZ(RT_OFFSETOF(VBSFCACHEDIR, szPath) + cchDir + 1);
+    if (!pDir)
+        return NULL;
+    memcpy(pDir->szPath, pszDir, cchDir);
+    pDir->szPath[cchDir] = '\0';
+    pDir->Core.pszString = pDir->szPath;
+    pDir->Objects        = NULL;
+    pDir->iWatch         = -1;
+#ifdef VBSF_CACHE_WITH_INOTIFY
+    /* The watch must be in place before anything in the directory is queried. */
+    if (g_fdCacheInotify >= 0)
+        pDir->iWatch = inotify_add_watch(g_fdCacheInotify, pDir->szPath, VBSF_CACHE_INOTIFY_MASK);
+#endif
+    bool fRc = RTStrSpaceInsert(&g_CacheDirs, &pDir->Core);
+    Assert(fRc); NOREF(fRc);
+    RTListPrepend(&g_CacheLru, &pDir->ListEntry);
+    g_cCacheDirs++;
+
+    vbsfCacheEvictLocked(pDir);
+    return pDir;
+}
+
+static void vbsfCacheDirRemoveObjLocked(PVBSFCACHEDIR pDir, const char *pszName, size_t cchName)
+{
+    PRTSTRSPACECORE pCore = RTStrSpaceGetN(&pDir->Objects, pszName, cchName);
+    if (pCore)
+    {
+        g_uCacheGeneration++;
+        pCore = RTStrSpaceRemove(&pDir->Objects, pCore->pszString);
+        RTMemFree(RT_FROM_MEMBER(pCore, VBSFCACHEOBJ, Core));
+        pDir->cObjects--;
+        g_cCacheObjects--;
+    }
+}
+
+/**
+ * Marks the cached information of an object as stale without freeing it.
+ */
+static void vbsfCacheDirStaleObjLocked(PVBSFCACHEDIR pDir, const char *pszName, size_t cchName)
+{
+    PRTSTRSPACECORE pCore = RTStrSpaceGetN(&pDir->Objects, pszName, cchName);
+    if (pCore)
+    {
+        PVBSFCACHEOBJ pObj = RT_FROM_MEMBER(pCore, VBSFCACHEOBJ, Core);
+        pObj->msExpire = 0;
+        pObj->uGeneration++;
+    }
+}
+
+/**
+ * Looks up an object in a directory record.
+ *
+ * @returns The object, NULL if not found.
+ * @param   pDir        The directory record.
+ * @param   pszName     The name of the object.
+ * @param   fCreate     Whether to create an object without information if it
+ *                      doesn't exist.  The caller must call
+ *                      vbsfCacheEvictLocked() when done with it.
+ */
+static PVBSFCACHEOBJ vbsfCacheDirGetObjLocked(PVBSFCACHEDIR pDir, const char *pszName, bool fCreate)
+{
+    PRTSTRSPACECORE pCore = RTStrSpaceGet(&pDir->Objects, pszName);
+    if (pCore)
+        return RT_FROM_MEMBER(pCore, VBSFCACHEOBJ, Core);
+    if (!fCreate)
+        return NULL;
+
+    size_t cchName = strlen(pszName);
+    PVBSFCACHEOBJ pObj = (PVBSFCACHEOBJ)RTMemAllocZ(RT_OFFSETOF(VBSFCACHEOBJ, szName) + cchName + 1);
+    if (!pObj)
+        return NULL;
+    memcpy(pObj->szName, pszName, cchName + 1);
+    pObj->Core.pszString = pObj->szName;
+    bool fRc = RTStrSpaceInsert(&pDir->Objects, &pObj->Core);
+    Assert(fRc); NOREF(fRc);
+    pDir->cObjects++;
+    g_cCacheObjects++;
+    return pObj;
+}
+
+static void vbsfCacheDirSetObjLocked(PVBSFCACHEDIR pDir, PVBSFCACHEOBJ pObj, uint32_t fFlags,
+                                     int rc, PCRTFSOBJINFO pObjInfo)
+{
+    pObj->msExpire = vbsfCacheExpireTS(pDir);
+    pObj->fFlags   = fFlags;
+    pObj->rc       = rc;
+    if (RT_SUCCESS(rc))
+        pObj->Info = *pObjInfo;
+    else
+        RT_ZERO(pObj->Info);
+}
+
+/**
+ * Worker for vbsfCacheInvalidate and the inotify event processing.
+ *
+ * @param   pszPath     The host path of the object, trailing delimiters are
+ *                      ignored.
+ * @param   cchPath     The length of the path.
+ * @param   fFlags      VBSF_CACHE_INV_F_XXX.
+ */
+static void vbsfCacheInvalidateLocked(const char *pszPath, size_t cchPath, uint32_t fFlags)
+{
+    if (fFlags & VBSF_CACHE_INV_F_ENTRY)
+        g_uCacheGeneration++;
+
+    while (cchPath > 1 && pszPath[cchPath - 1] == RTPATH_DELIMITER)
+        cchPath--;
+
+    size_t cchDir = vbsfCacheSplitPath(pszPath, cchPath);
+    if (cchDir)
+    {
+        PVBSFCACHEDIR pDir = vbsfCacheDirLookupLocked(pszPath, cchDir, false /*fCreate*/);
+        if (pDir)
+        {
+            if (fFlags & VBSF_CACHE_INV_F_ENTRY)
+            {
+                vbsfCacheDirRemoveObjLocked(pDir, &pszPath[cchDir], cchPath - cchDir);
+                vbsfCacheDirDropListingLocked(pDir);
+            }
+            else
+                vbsfCacheDirStaleObjLocked(pDir, &pszPath[cchDir], cchPath - cchDir);
+        }
+
+        /* Adding or removing an entry also changes the timestamps of the directory. */
+        if ((fFlags & VBSF_CACHE_INV_F_ENTRY) && cchDir > 1)
+        {
+            size_t cchParent = vbsfCacheSplitPath(pszPath, cchDir - 1);
+            if (cchParent)
+            {
+                pDir = vbsfCacheDirLookupLocked(pszPath, cchParent, false /*fCreate*/);
+                if (pDir)
+                    vbsfCacheDirRemoveObjLocked(pDir, &pszPath[cchParent], cchDir - 1 - cchParent);
+            }
+        }
+    }
+
+    if ((fFlags & VBSF_CACHE_INV_F_SUBTREE) == VBSF_CACHE_INV_F_SUBTREE)
+    {
+        PVBSFCACHEDIR pCur, pNext;
+        RTListForEachSafe(&g_CacheLru, pCur, pNext, VBSFCACHEDIR, ListEntry)
+        {
+            if (   pCur->Core.cchString > cchPath
+                && pCur->szPath[cchPath] == RTPATH_DELIMITER
+                && !memcmp(pCur->szPath, pszPath, cchPath))
+                vbsfCacheDirDestroyLocked(pCur);
+        }
+    }
+}
+
+static void vbsfCacheFlushAllLocked(void)
+{
+    PVBSFCACHEDIR pCur, pNext;
+    RTListForEachSafe(&g_CacheLru, pCur, pNext, VBSFCACHEDIR, ListEntry)
+        vbsfCacheDirDestroyLocked(pCur);
+}
+
+
+#ifdef VBSF_CACHE_WITH_INOTIFY
+
+/**
+ * Processes an inotify event.
+ */
+static void vbsfCacheInotifyEventLocked(struct inotify_event const *pEvent)
+{
+    if (pEvent->mask & IN_Q_OVERFLOW)
+    {
+        LogRel2(("SharedFolders: inotify queue overflow, flushing the attribute cache\n"));
+        vbsfCacheFlushAllLocked();
+        return;
+    }
+
+    /*
+     * Several records may share the watch.  Collect their paths first, as
+     * invalidating a subtree destroys records.
+     */
+    char    *apszDirs[8];
+    unsigned cDirs = 0;
+    PVBSFCACHEDIR pCur;
+    RTListForEach(&g_CacheLru, pCur, VBSFCACHEDIR, ListEntry)
+    {
+        if (pCur->iWatch == pEvent->wd)
+        {
+            char *pszDir = cDirs < RT_ELEMENTS(apszDirs) ? RTStrDup(pCur->szPath) : NULL;
+            if (!pszDir)
+            {
+                while (cDirs > 0)
+                    RTStrFree(apszDirs[--cDirs]);
+                vbsfCacheFlushAllLocked();
+                return;
+            }
+            apszDirs[cDirs++] = pszDir;
+        }
+    }
+
+    for (unsigned i = 0; i < cDirs; i++)
+    {
+        char   *pszDir = apszDirs[i];
+        size_t  cchDir = strlen(pszDir);
+        if (pEvent->len == 0 || !pEvent->name[0])
+        {
+            /* The directory itself. */
+            if (pEvent->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED | IN_UNMOUNT))
+                vbsfCacheInvalidateLocked(pszDir, cchDir, VBSF_CACHE_INV_F_SUBTREE);
+            else
+                vbsfCacheInvalidateLocked(pszDir, cchDir, VBSF_CACHE_INV_F_OBJECT);
+        }
+        else
+        {
+            uint32_t fFlags = VBSF_CACHE_INV_F_OBJECT;
+            if (pEvent->mask & (IN_DELETE | IN_MOVED_FROM))
+                fFlags = pEvent->mask & IN_ISDIR ? VBSF_CACHE_INV_F_SUBTREE : VBSF_CACHE_INV_F_ENTRY;
+            else if (pEvent->mask & (IN_CREATE | IN_MOVED_TO))
+                fFlags = VBSF_CACHE_INV_F_ENTRY;
+
+            char *pszPath = NULL;
+            if (RTStrAPrintf(&pszPath, "%s%s", pszDir, pEvent->name) > 0)
+            {
+                vbsfCacheInvalidateLocked(pszPath, strlen(pszPath), fFlags);
+                RTStrFree(pszPath);
+            }
+            else
+                vbsfCacheInvalidateLocked(pszDir, cchDir, VBSF_CACHE_INV_F_SUBTREE);
+        }
+        RTStrFree(pszDir);
+    }
+}
+
+/**
+ * Thread reading the inotify events.
+ */
+static DECLCALLBACK(int) vbsfCacheInotifyThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF2(hThreadSelf, pvUser);
+
+    /* Aligned for struct inotify_event. */
+    uint64_t au64Buf[512];
+    for (;;)
+    {
+        struct pollfd aFds[2];
+        aFds[0].fd      = g_fdCacheInotify;
+        aFds[0].events  = POLLIN;
+        aFds[0].revents = 0;
+        aFds[1].fd      = g_afdCacheWakeup[0];
+        aFds[1].events  = POLLIN;
+        aFds[1].revents = 0;
+        int rc = poll(aFds, RT_ELEMENTS(aFds), -1);
+        if (rc < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            break;
+        }
+        if (aFds[1].revents)
+            return VINF_SUCCESS; /* vbsfCacheInotifyStop */
+        if (!(aFds[0].revents & POLLIN))
+            continue;
+
+        ssize_t cbRead = read(g_fdCacheInotify, au64Buf, sizeof(au64Buf));
+        if (cbRead <= 0)
+        {
+            if (cbRead < 0 && (errno == EINTR || errno == EAGAIN))
+                continue;
+            break;
+        }
+
+        RTCritSectEnter(&g_CacheCritSect);
+        size_t off = 0;
+        while (off + sizeof(struct inotify_event) <= (size_t)cbRead)
+        {
+            struct inotify_event const *pEvent = (struct inotify_event const *)((uint8_t *)au64Buf + off);
+            vbsfCacheInotifyEventLocked(pEvent);
+            off += sizeof(struct inotify_event) + pEvent->len;
+        }
+        RTCritSectLeave(&g_CacheCritSect);
+    }
+
+    /* Without events the cache cannot be trusted for long. */
+    LogRel(("SharedFolders: Stopped watching the host file system for changes\n"));
+    RTCritSectEnter(&g_CacheCritSect);
+    vbsfCacheFlushAllLocked();
+    close(g_fdCacheInotify);
+    g_fdCacheInotify = -1;
+    RTCritSectLeave(&g_CacheCritSect);
+    return VINF_SUCCESS;
+}
+
+/**
+ * Sets up the inotify instance and starts the event thread.
+ */
+static void vbsfCacheInotifyStart(void)
+{
+    int fd = inotify_init();
+    if (fd < 0)
+    {
+        LogRel(("SharedFolders: inotify_init failed (errno=%d), the attribute cache uses a short lifetime\n", errno));
+        return;
+    }
+    int aFds[2] = { -1, -1 };
+    if (   fcntl(fd, F_SETFD, FD_CLOEXEC) < 0
+        || fcntl(fd, F_SETFL, O_NONBLOCK) < 0
+        || pipe(aFds) < 0
+        || fcntl(aFds[0], F_SETFD, FD_CLOEXEC) < 0
+        || fcntl(aFds[1], F_SETFD, FD_CLOEXEC) < 0)
+    {
+        LogRel(("SharedFolders: Setting up inotify failed (errno=%d)\n", errno));
+        close(fd);
+        if (aFds[0] >= 0)
+        {
+            close(aFds[0]);
+            close(aFds[1]);
+        }
+        return;
+    }
+
+    g_fdCacheInotify    = fd;
+    g_afdCacheWakeup[0] = aFds[0];
+    g_afdCacheWakeup[1] = aFds[1];
+    int rc = RTThreadCreate(&g_hCacheInotifyThread, vbsfCacheInotifyThread, NULL, 0,
+                            RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "ShFlWatch");
+    if (RT_FAILURE(rc))
+    {
+        LogRel(("SharedFolders: Creating the inotify thread failed: %Rrc\n", rc));
+        g_hCacheInotifyThread = NIL_RTTHREAD;
+        close(g_fdCacheInotify);
+        g_fdCacheInotify = -1;
+        close(g_afdCacheWakeup[0]);
+        close(g_afdCacheWakeup[1]);
+        g_afdCacheWakeup[0] = g_afdCacheWakeup[1] = -1;
+    }
+}
+
+/**
+ * Stops the event thread and closes the inotify instance.
+ */
+static void vbsfCacheInotifyStop(void)
+{
+    if (g_hCacheInotifyThread != NIL_RTTHREAD)
+    {
+        char ch = 0;
+        ssize_t cbIgn = write(g_afdCacheWakeup[1], &ch, 1); NOREF(cbIgn);
+        int rc = RTThreadWait(g_hCacheInotifyThread, RT_INDEFINITE_WAIT, NULL);
+        AssertRC(rc);
+        g_hCacheInotifyThread = NIL_RTTHREAD;
+        close(g_afdCacheWakeup[0]);
+        close(g_afdCacheWakeup[1]);
+        g_afdCacheWakeup[0] = g_afdCacheWakeup[1] = -1;
+    }
+    if (g_fdCacheInotify >= 0)
+    {
+        close(g_fdCacheInotify);
+        g_fdCacheInotify = -1;
+    }
+}
+
+#endif /* VBSF_CACHE_WITH_INOTIFY */
+
+
+#ifdef UNITTEST
+/** Unit test the attribute cache.  The service is loaded without the cache as
+ * the other tests change the stubbed file system between calls, the sub-tests
+ * initialize and terminate it themselves. */
+void testCache(RTTEST hTest)
+{
+    /* Repeated queries are answered from the cache. */
+    testCacheHit(hTest);
+    /* Cached information is only used for its lifetime. */
+    testCacheExpiry(hTest);
+    /* Changes made by the service drop what they make stale, and only that. */
+    testCacheInvalidate(hTest);
+    /* Case correction uses the cached directory listing. */
+    testCacheCorrectCasing(hTest);
+    /* Add tests as required... */
+}
+#endif
+
+int vbsfCacheInit(void)
+{
+    const char *pszTtl = RTEnvGet("VBOX_SHFL_CACHE_TTL_MS");
+    if (pszTtl)
+    {
+        uint32_t cMsTtl;
+        int rc = RTStrToUInt32Full(pszTtl, 10, &cMsTtl);
+        if (rc == VINF_SUCCESS)
+            g_cMsCacheTtl = cMsTtl;
+        else
+            LogRel(("SharedFolders: Ignoring invalid VBOX_SHFL_CACHE_TTL_MS value '%s'\n", pszTtl));
+    }
+    if (!g_cMsCacheTtl)
+    {
+        LogRel(("SharedFolders: Attribute cache disabled\n"));
+        return VINF_SUCCESS;
+    }
+
+    int rc = RTCritSectInit(&g_CacheCritSect);
+    AssertRCReturn(rc, rc);
+    RTListInit(&g_CacheLru);
+    g_CacheDirs = NULL;
+
+#ifdef VBSF_CACHE_WITH_INOTIFY
+    vbsfCacheInotifyStart();
+#endif
+
+    g_fCacheEnabled = true;
+    return VINF_SUCCESS;
+}
+
+void vbsfCacheTerm(void)
+{
+    if (!g_fCacheEnabled)
+        return;
+    g_fCacheEnabled = false;
+
+#ifdef VBSF_CACHE_WITH_INOTIFY
+    vbsfCacheInotifyStop();
+#endif
+
+    RTCritSectEnter(&g_CacheCritSect);
+    vbsfCacheFlushAllLocked();
+    RTCritSectLeave(&g_CacheCritSect);
+    RTCritSectDelete(&g_CacheCritSect);
+}
+
+int vbsfCacheQueryInfo(const char *pszPath, PRTFSOBJINFO pObjInfo, uint32_t fFlags)
+{
+    size_t cchPath = strlen(pszPath);
+    size_t cchDir  = vbsfCacheSplitPath(pszPath, cchPath);
+    if (!g_fCacheEnabled || !cchDir)
+        return RTPathQueryInfoEx(pszPath, pObjInfo, RTFSOBJATTRADD_NOTHING, fFlags);
+
+    const char *pszName = &pszPath[cchDir];
+
+    bool     fCache         = false;
+    uint32_t uObjGeneration = 0;
+    RTCritSectEnter(&g_CacheCritSect);
+    PVBSFCACHEDIR pDir = vbsfCacheDirLookupLocked(pszPath, cchDir, true /*fCreate*/);
+    if (pDir)
+    {
+        PVBSFCACHEOBJ pObj = vbsfCacheDirGetObjLocked(pDir, pszName, true /*fCreate*/);
+        if (pObj)
+        {
+            if (   pObj->fFlags == fFlags
+                && pObj->msExpire > RTTimeMilliTS())
+            {
+                int rc = pObj->rc;
+                if (RT_SUCCESS(rc))
+                    *pObjInfo = pObj->Info;
+                RTCritSectLeave(&g_CacheCritSect);
+                return rc;
+            }
+            /* Remember the object generation to detect invalidations while
+             * querying the host. */
+            uObjGeneration = pObj->uGeneration;
+            fCache = true;
+            vbsfCacheEvictLocked(pDir);
+        }
+    }
+    uint64_t const uGeneration = g_uCacheGeneration;
+    RTCritSectLeave(&g_CacheCritSect);
+
+    int rc = RTPathQueryInfoEx(pszPath, pObjInfo, RTFSOBJATTRADD_NOTHING, fFlags);
+    if (   fCache
+        && (   rc == VINF_SUCCESS
+            || rc == VERR_FILE_NOT_FOUND
+            || rc == VERR_PATH_NOT_FOUND))
+    {
+        RTCritSectEnter(&g_CacheCritSect);
+        /* Freeing records or objects bumps the global generation, so they
+         * are still around if it is unchanged. */
+        if (uGeneration == g_uCacheGeneration)
+        {
+            pDir = vbsfCacheDirLookupLocked(pszPath, cchDir, false /*fCreate*/);
+            PVBSFCACHEOBJ pObj = pDir ? vbsfCacheDirGetObjLocked(pDir, pszName, false /*fCreate*/) : NULL;
+            if (pObj && pObj->uGeneration == uObjGeneration)
+                vbsfCacheDirSetObjLocked(pDir, pObj, fFlags, rc, pObjInfo);
+        }
+        RTCritSectLeave(&g_CacheCritSect);
+    }
+    return rc;
+}
+
+/**
+ * Searches a listing for a name, ignoring case.
+ *
+ * @returns Pointer to the name in the listing, NULL if not found.
+ */
+static const char *vbsfCacheListingFind(const char *pszzListing, const char *pszName, size_t cchName)
+{
+    for (const char *psz = pszzListing; *psz; )
+    {
+        size_t cch = strlen(psz);
+        if (   cch == cchName
+            && !RTStrICmp(psz, pszName))
+            return psz;
+        psz += cch + 1;
+    }
+    return NULL;
+}
+
+int vbsfCacheCorrectCasing(char *pszFullPath, char *pszStartComponent)
+{
+    if (!g_fCacheEnabled)
+        return VERR_NOT_SUPPORTED;
+
+    AssertReturn((uintptr_t)pszFullPath < (uintptr_t)pszStartComponent, VERR_INTERNAL_ERROR_2);
+    AssertReturn(pszStartComponent[-1] == RTPATH_DELIMITER, VERR_INTERNAL_ERROR_5);
+
+    size_t const cchDir       = pszStartComponent - pszFullPath;
+    size_t const cchComponent = strlen(pszStartComponent);
+
+    /*
+     * Try the cached listing first.
+     */
+    RTCritSectEnter(&g_CacheCritSect);
+    PVBSFCACHEDIR pDir = vbsfCacheDirLookupLocked(pszFullPath, cchDir, true /*fCreate*/);
+    if (   pDir
+        && pDir->pszzListing
+        && pDir->msListingExpire > RTTimeMilliTS())
+    {
+        const char *pszFound = vbsfCacheListingFind(pDir->pszzListing, pszStartComponent, cchComponent);
+        if (pszFound)
+            memcpy(pszStartComponent, pszFound, cchComponent);
+        RTCritSectLeave(&g_CacheCritSect);
+        return pszFound ? VINF_SUCCESS : VERR_FILE_NOT_FOUND;
+    }
+    uint64_t const uGeneration = g_uCacheGeneration;
+    RTCritSectLeave(&g_CacheCritSect);
+
+    /*
+     * Read the directory, looking for the name and collecting the listing.
+     */
+    char chSaved = *pszStartComponent;
+    *pszStartComponent = '\0';
+    PRTDIR hDir = NULL;
+    int rc = RTDirOpen(&hDir, pszFullPath);
+    *pszStartComponent = chSaved;
+    if (RT_FAILURE(rc))
+        return rc;
+
+    size_t const cbDirEntry = RT_OFFSETOF(RTDIRENTRY, szName) + RTPATH_MAX;
+    PRTDIRENTRY  pDirEntry  = (PRTDIRENTRY)RTMemTmpAlloc(cbDirEntry);
+    char        *pszzListing = NULL;
+    size_t       cbListing   = 0;
+    size_t       cbAlloc     = 0;
+    bool         fComplete   = false;
+    bool         fFound      = false;
+    if (pDirEntry)
+    {
+        for (;;)
+        {
+            size_t cbDirEntrySize = cbDirEntry;
+            rc = RTDirRead(hDir, pDirEntry, &cbDirEntrySize);
+            if (rc == VERR_NO_MORE_FILES)
+            {
+                fComplete = true;
+                break;
+            }
+            if (RT_FAILURE(rc))
+            {
+                if (   rc == VERR_NO_TRANSLATION
+                    || rc == VERR_INVALID_UTF8_ENCODING)
+                    continue;
+                break;
+            }
+
+            if (   !fFound
+                && pDirEntry->cbName == cchComponent
+                && !RTStrICmp(pszStartComponent, pDirEntry->szName))
+            {
+                Log(("Found original name %s (%s)\n", pDirEntry->szName, pszStartComponent));
+                memcpy(pszStartComponent, pDirEntry->szName, cchComponent);
+                fFound = true;
+            }
+
+            /* Collect the listing while it is small enough to be cached. */
+            if (cbAlloc != ~(size_t)0)
+            {
+                size_t cbNeeded = cbListing + pDirEntry->cbName + 2;
+                if (cbNeeded > VBSF_CACHE_MAX_LISTING)
+                {
+                    RTMemFree(pszzListing);
+                    pszzListing = NULL;
+                    cbAlloc     = ~(size_t)0;
+                    if (fFound)
+                        break;
+                }
+                else
+                {
+                    if (cbNeeded > cbAlloc)
+                    {
+                        size_t cbNew = RT_MIN(RT_MAX(RT_MAX(cbAlloc * 2, _4K), cbNeeded), VBSF_CACHE_MAX_LISTING);
+                        void *pvNew = RTMemRealloc(pszzListing, cbNew);
+                        if (!pvNew)
+                        {
+                            RTMemFree(pszzListing);
+                            pszzListing = NULL;
+                            cbAlloc     = ~(size_t)0;
+                            if (fFound)
+                                break;
+                            continue;
+                        }
+                        pszzListing = (char *)pvNew;
+                        cbAlloc     = cbNew;
+                    }
+                    memcpy(&pszzListing[cbListing], pDirEntry->szName, pDirEntry->cbName + 1);
+                    cbListing += pDirEntry->cbName + 1;
+                }
+            }
+            else if (fFound)
+                break;
+        }
+        RTMemTmpFree(pDirEntry);
+    }
+    else
+        rc = VERR_NO_MEMORY;
+    RTDirClose(hDir);
+
+    /*
+     * Cache the complete listing unless the directory changed meanwhile.
+     */
+    if (fComplete && pszzListing)
+    {
+        pszzListing[cbListing++] = '\0';
+        RTCritSectEnter(&g_CacheCritSect);
+        if (uGeneration == g_uCacheGeneration)
+        {
+            pDir = vbsfCacheDirLookupLocked(pszFullPath, cchDir, false /*fCreate*/);
+            if (pDir)
+            {
+                vbsfCacheDirDropListingLocked(pDir);
+                pDir->pszzListing     = pszzListing;
+                pDir->cbListing       = cbListing;
+                pDir->msListingExpire = vbsfCacheExpireTS(pDir);
+                g_cbCacheListings    += cbListing;
+                pszzListing = NULL;
+                vbsfCacheEvictLocked(pDir);
+            }
+        }
+        RTCritSectLeave(&g_CacheCritSect);
+    }
+    RTMemFree(pszzListing);
+
+    if (fFound)
+        return VINF_SUCCESS;
+    return RT_SUCCESS(rc) || rc == VERR_NO_MORE_FILES ? VERR_FILE_NOT_FOUND : rc;
+}
+
+void vbsfCacheInvalidate(const char *pszPath, uint32_t fFlags)
+{
+    if (!g_fCacheEnabled)
+        return;
+
+    RTCritSectEnter(&g_CacheCritSect);
+    vbsfCacheInvalidateLocked(pszPath, strlen(pszPath), fFlags);
+    RTCritSectLeave(&g_CacheCritSect);
+}
@@ -0,0 +1,84 @@
+/* $Id$ */
+/** @file
+ * Shared Folders - Host file system attribute and directory listing cache.
+ */
+
+/*
+ * Copyright (C) 2006-2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#ifndef __VBSFCACHE__H
+#define __VBSFCACHE__H
+
+#include "shfl.h"
+#include <iprt/fs.h>
+
+/** @name VBSF_CACHE_INV_F_XXX - Flags for vbsfCacheInvalidate.
+ * @{ */
+/** Only the attributes of the object changed (write, set size, set info). */
+#define VBSF_CACHE_INV_F_OBJECT             UINT32_C(0x00000000)
+/** The object was created, removed or renamed, so the listing and the
+ *  attributes of the parent directory are stale as well. */
+#define VBSF_CACHE_INV_F_ENTRY              UINT32_C(0x00000001)
+/** Everything below the object is stale as well (directory removed or
+ *  renamed).  Implies VBSF_CACHE_INV_F_ENTRY. */
+#define VBSF_CACHE_INV_F_SUBTREE            UINT32_C(0x00000003)
+/** @} */
+
+/**
+ * Initializes the cache.
+ *
+ * The cache stays disabled and all queries go straight to the host file
+ * system if this is not called or fails.
+ *
+ * @returns IPRT status code.
+ */
+int vbsfCacheInit(void);
+
+/**
+ * Disables the cache and frees all resources.
+ */
+void vbsfCacheTerm(void);
+
+/**
+ * Cached version of RTPathQueryInfoEx(pszPath, pObjInfo, RTFSOBJATTRADD_NOTHING, fFlags).
+ *
+ * @returns The status code RTPathQueryInfoEx returned (or would return).
+ * @param   pszPath     The full host path.
+ * @param   pObjInfo    Where to return the object information.
+ * @param   fFlags      RTPATH_F_ON_LINK or RTPATH_F_FOLLOW_LINK.
+ */
+int vbsfCacheQueryInfo(const char *pszPath, PRTFSOBJINFO pObjInfo, uint32_t fFlags);
+
+/**
+ * Looks for a directory entry matching a path component case insensitively,
+ * using the cached listing of the parent directory.
+ *
+ * @returns VINF_SUCCESS and the correctly cased name in @a pszStartComponent.
+ * @returns VERR_FILE_NOT_FOUND if there is no matching entry.
+ * @returns VERR_NOT_SUPPORTED if the cache is disabled, the caller must
+ *          enumerate the directory itself.
+ * @param   pszFullPath         The full host path, terminated after the
+ *                              component.
+ * @param   pszStartComponent   The component in @a pszFullPath, must follow a
+ *                              path delimiter.
+ */
+int vbsfCacheCorrectCasing(char *pszFullPath, char *pszStartComponent);
+
+/**
+ * Drops cached information after the service modified a host object.
+ *
+ * @param   pszPath     The full host path of the object.
+ * @param   fFlags      VBSF_CACHE_INV_F_XXX.
+ */
+void vbsfCacheInvalidate(const char *pszPath, uint32_t fFlags);
+
+#endif /* __VBSFCACHE__H */
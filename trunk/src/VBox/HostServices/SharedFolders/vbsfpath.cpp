@@ -20,6 +20,7 @@
 #endif
 
 #include "vbsfpath.h"
+#include "vbsfcache.h"
 #include "mappings.h"
 #include "vbsf.h"
 #include "shflhandle.h"
@@ -65,6 +66,17 @@ static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, char *p
     AssertReturn((uintptr_t)pszFullPath < (uintptr_t)pszStartComponent - 1U, VERR_INTERNAL_ERROR_2);
     AssertReturn(pszStartComponent[-1] == RTPATH_DELIMITER, VERR_INTERNAL_ERROR_5);
 
+    /*
+     * Use the cached directory listing if possible.
+     */
+    int rc = vbsfCacheCorrectCasing(pszFullPath, pszStartComponent);
+    if (rc != VERR_NOT_SUPPORTED)
+    {
+        if (RT_FAILURE(rc))
+            Log(("vbsfCorrectCasing %s failed with %Rrc\n", pszStartComponent, rc));
+        return rc;
+    }
+
     /*
      * Allocate a buffer that can hold really long file name entries as well as
      * the initial search pattern.
@@ -90,7 +102,7 @@ static int vbsfCorrectCasing(SHFLCLIENTDATA *pClient, char *pszFullPath, char *p
      *        supporting opendir wildcard filters, it would make sense to build
      *        one here with '?' for case foldable charaters. */
     /** @todo Use RTDirOpen here and drop the whole uncessary path copying? */
-    int rc = RTPathJoinEx(pDirEntry->szName, cbDirEntry - RT_OFFSETOF(RTDIRENTRYEX, szName),
+    rc = RTPathJoinEx(pDirEntry->szName, cbDirEntry - RT_OFFSETOF(RTDIRENTRYEX, szName),
                           pszFullPath, cchParentDir,
                           RT_STR_TUPLE("*"));
     AssertRC(rc);
@@ -148,7 +160,7 @@ static int vbsfQueryExistsEx(const char *pszPath, uint32_t fFlags)
     return RTPathExistsEx(pszPath, fFlags);
 #else
     RTFSOBJINFO IgnInfo;
-    return RTPathQueryInfoEx(pszPath, &IgnInfo, RTFSOBJATTRADD_NOTHING, fFlags);
+    return vbsfCacheQueryInfo(pszPath, &IgnInfo, fFlags);
 #endif
 }
 
@@ -107,6 +107,12 @@ private:
     HRESULT registerListener(const ComPtr<IEventListener> &aListener,
                              const std::vector<VBoxEventType_T> &aInteresting,
                              BOOL aActive);
+    HRESULT registerFilteredListener(const ComPtr<IEventListener> &aListener,
+                                     const std::vector<VBoxEventType_T> &aInteresting,
+                                     BOOL aActive,
+                                     BOOL aCoalesce,
+                                     const std::vector<com::Utf8Str> &aMachines,
+                                     const com::Utf8Str &aProperties);
     HRESULT unregisterListener(const ComPtr<IEventListener> &aListener);
     HRESULT fireEvent(const ComPtr<IEvent> &aEvent,
                       LONG aTimeout,
@@ -114,6 +120,10 @@ private:
     HRESULT getEvent(const ComPtr<IEventListener> &aListener,
                      LONG aTimeout,
                      ComPtr<IEvent> &aEvent);
+    HRESULT getEvents(const ComPtr<IEventListener> &aListener,
+                      LONG aTimeout,
+                      ULONG aMaxEvents,
+                      std::vector<ComPtr<IEvent> > &aEvents);
     HRESULT eventProcessed(const ComPtr<IEventListener> &aListener,
                            const ComPtr<IEvent> &aEvent);
 
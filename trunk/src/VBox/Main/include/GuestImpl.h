@@ -36,6 +36,7 @@
 #endif
 #include "EventImpl.h"
 #include "HGCM.h"
+#include "VmStatsRing.h"
 
 typedef enum
 {
@@ -240,6 +241,8 @@ private:
 #endif
 
     RTTIMERLR                       mStatTimer;
+    /** Where i_updateStats() leaves the statistics for VBoxSVC. */
+    pm::VmStatsRing                 mStatsRing;
     uint32_t                        mMagic; /** @todo r=andy Rename this to something more meaningful. */
 };
 #define GUEST_MAGIC 0xCEED2006u /** @todo r=andy Not very well defined!? */
@@ -57,6 +57,13 @@ class HGCMObject
         virtual ~HGCMObject()
         {};
 
+        /** Called when the last reference is gone. Objects which are recycled
+         *  instead of being deleted override this. */
+        virtual void Destroy()
+        {
+            delete this;
+        };
+
     public:
         HGCMObject(HGCMOBJ_TYPE enmObjType)
             : m_cRefs(0)
@@ -84,7 +91,7 @@ class HGCMObject
                 return;
             }
 
-            delete this;
+            Destroy();
         }
 
         uint32_t Handle()
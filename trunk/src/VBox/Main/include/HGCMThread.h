@@ -68,13 +68,11 @@ class HGCMMsgCore: public HGCMObject
         /** Callback function pointer. */
         PHGCMMSGCALLBACK m_pfnCallback;
 
-        /** Next element in a message queue. */
+        /** Next element in a message queue or in the free list. */
         HGCMMsgCore *m_pNext;
-        /** @todo seems not necessary. Previous element in a message queue. */
-        HGCMMsgCore *m_pPrev;
 
         /** Various internal flags. */
-        uint32_t m_fu32Flags;
+        uint32_t volatile m_fu32Flags;
 
         /** Result code for a Send */
         int32_t m_rcSend;
@@ -84,6 +82,9 @@ class HGCMMsgCore: public HGCMObject
     protected:
         virtual ~HGCMMsgCore ();
 
+        /** Returns the message to the free list of the thread, if there is room. */
+        virtual void Destroy ();
+
     public:
         HGCMMsgCore () : HGCMObject(HGCMOBJ_MSG) {};
 
@@ -91,10 +92,13 @@ class HGCMMsgCore: public HGCMObject
 
         HGCMThread *Thread (void) { return m_pThread; };
 
-        /** Initialize message after it was allocated. */
+        /** Initialize message after it was allocated or taken from the
+         *  free list. Messages are recycled, so the message specific data
+         *  must not be assumed to be in the freshly constructed state. */
         virtual void Initialize (void) {};
 
-        /** Uninitialize message. */
+        /** Uninitialize message, called before the message is deleted or
+         *  put on the free list. */
         virtual void Uninitialize (void) {};
 
 };
@@ -33,6 +33,7 @@
 #include <queue>
 
 #include "MediumImpl.h"
+#include "VmStatsRing.h"
 
 /* Forward decl. */
 class Machine;
@@ -282,7 +283,13 @@ namespace pm
         HRESULT enableInternal(ULONG mask);
         int disableInternal(ULONG mask);
 
+        /** Whether the VM pushes its statistics into a shared ring. */
+        bool hasRing()              { return mRing.isOpen(); };
+        bool readSample(uint32_t *piSample, VMSTATSRINGSAMPLE *pSample);
+        void pollVMMStats();
+
         const com::Utf8Str& getVMName() const { return mMachineName; };
+        ComPtr<IUnknown> getObject();
 
         RTPROCESS getProcess()  { return mProcess; };
         ULONG getCpuUser()      { return mCpuUser; };
@@ -329,6 +336,10 @@ namespace pm
         ULONG                mSharedVMM;
         ULONG                mVmNetRx;
         ULONG                mVmNetTx;
+        /** Statistics the VM pushed, read when the metrics are queried. */
+        VmStatsRing          mRing;
+        /** Number of ring samples when pollVMMStats() last looked. */
+        uint32_t             mcRingPolled;
     };
 
     typedef std::list<CollectorGuest*> CollectorGuestList;
@@ -340,6 +351,7 @@ namespace pm
         void registerGuest(CollectorGuest* pGuest);
         void unregisterGuest(CollectorGuest* pGuest);
         CollectorGuest *getVMMStatsProvider() { return mVMMStatsProvider; };
+        const CollectorGuestList &getGuests() { return mGuests; };
         void preCollect(CollectorHints& hints, uint64_t iTick);
         void destroyUnregistered();
         int enqueueRequest(CollectorGuestRequest *aRequest);
@@ -353,6 +365,13 @@ namespace pm
         CollectorGuest     *mVMMStatsProvider;
         CollectorGuestQueue mQueue;
         CollectorGuest     *mGuestBeingCalled;
+        /** Number of requests the processing thread has finished executing.
+         * enqueueRequest() uses it to tell whether the call it found in
+         * progress is still the same one. */
+        uint32_t volatile   mcCallsDone;
+        /** Signalled by the request processing thread whenever it is done
+         * with a request, so enqueueRequest() need not sleep. */
+        RTSEMEVENTMULTI     mCallDone;
     };
 
     /* Collector Hardware Abstraction Layer *********************************/
@@ -410,6 +429,9 @@ namespace pm
         virtual ULONG getMinValue() = 0;
         virtual ULONG getMaxValue() = 0;
         virtual ULONG getScale() = 0;
+        /** Brings the sub-metrics up to date with samples collected
+         * elsewhere, called right before they are queried. */
+        virtual void sync() {};
 
         bool collectorBeat(uint64_t nowAt);
 
@@ -440,9 +462,18 @@ namespace pm
     {
     public:
         BaseGuestMetric(CollectorGuest *cguest, const char *name, ComPtr<IUnknown> object)
-            : BaseMetric(NULL, name, object), mCGuest(cguest) {};
+            : BaseMetric(NULL, name, object), mCGuest(cguest), mRingNext(0), mRingLastTimestamp(0) {};
+        void sync();
     protected:
+        /** Stores the values of a ring sample, returns false if the sample
+         * has none of them. */
+        virtual bool putSample(const VMSTATSRINGSAMPLE &aSample) = 0;
+
         CollectorGuest *mCGuest;
+        /** Number of the next ring sample to look at. */
+        uint32_t        mRingNext;
+        /** Timestamp of the last ring sample stored. */
+        int64_t         mRingLastTimestamp;
     };
 
     class HostCpuLoad : public BaseMetric
@@ -760,6 +791,8 @@ namespace pm
         ULONG getMinValue() { return 0; };
         ULONG getMaxValue() { return INT32_MAX; };
         ULONG getScale() { return 1; }
+    protected:
+        bool putSample(const VMSTATSRINGSAMPLE &aSample);
     private:
         SubMetric *mRx, *mTx;
     };
@@ -781,6 +814,8 @@ namespace pm
         ULONG getMaxValue() { return PM_CPU_LOAD_MULTIPLIER; };
         ULONG getScale() { return PM_CPU_LOAD_MULTIPLIER / 100; }
     protected:
+        bool putSample(const VMSTATSRINGSAMPLE &aSample);
+
         SubMetric *mUser;
         SubMetric *mKernel;
         SubMetric *mIdle;
@@ -802,6 +837,8 @@ namespace pm
         ULONG getMinValue() { return 0; };
         ULONG getMaxValue() { return INT32_MAX; };
         ULONG getScale() { return 1; }
+    protected:
+        bool putSample(const VMSTATSRINGSAMPLE &aSample);
     private:
         SubMetric *mTotal, *mFree, *mBallooned, *mCache, *mPagedTotal, *mShared;
     };
@@ -868,7 +905,15 @@ namespace pm
         ULONG getLength()
             { return mAggregate ? 1 : mBaseMetric->getLength(); };
         ULONG getScale() { return mBaseMetric->getScale(); }
-        void query(ULONG **data, ULONG *count, ULONG *sequenceNumber);
+        /**
+         * Lets the base metric catch up on samples kept elsewhere, then
+         * copies the collected values, or their aggregate, to @a data which
+         * must have room for getLength() values. @a scratch is used for
+         * computing aggregates and is grown as needed, so the caller can
+         * reuse it for all the metrics it queries.
+         * @returns The number of values written.
+         */
+        ULONG query(ULONG *data, std::vector<ULONG> &scratch, ULONG *sequenceNumber);
 
     private:
         RTCString mName;
@@ -157,6 +157,12 @@ private:
                              std::vector<ULONG> &aReturnDataIndices,
                              std::vector<ULONG> &aReturnDataLengths,
                              std::vector<LONG> &aReturnData);
+    HRESULT queryVmStatistics(const std::vector<ComPtr<IUnknown> > &aObjects,
+                              LONG64 aSince,
+                              std::vector<com::Utf8Str> &aReturnNames,
+                              std::vector<ComPtr<IUnknown> > &aReturnObjects,
+                              std::vector<LONG64> &aReturnTimestamps,
+                              std::vector<ULONG> &aReturnData);
 
 
     HRESULT toIPerformanceMetric(pm::Metric *src, ComPtr<IPerformanceMetric> &dst);
@@ -168,6 +168,7 @@ public:
     void i_getOpenedMachines(SessionMachinesList &aMachines,
                            InternalControlList *aControls = NULL);
     MachinesOList &i_getMachinesList();
+    void i_updateMachineIndex(Machine *pMachine);
 
     HRESULT i_findMachine(const Guid &aId,
                           bool fPermitInaccessible,
@@ -222,6 +223,8 @@ public:
     HRESULT i_registerMedium(const ComObjPtr<Medium> &pMedium, ComObjPtr<Medium> *ppMedium,
                              AutoWriteLock &mediaTreeLock);
     HRESULT i_unregisterMedium(Medium *pMedium);
+    void i_updateMediumLocation(Medium *pMedium, DeviceType_T devType,
+                                const Utf8Str &strOldLocation, const Utf8Str &strNewLocation);
     void i_pushMediumToListWithChildren(MediaList &llMedia, Medium *pMedium);
     HRESULT i_unregisterMachineMedia(const Guid &id);
     HRESULT i_unregisterMachine(Machine *pMachine, const Guid &id);
@@ -233,7 +236,7 @@ public:
     HRESULT i_saveSettings();
     void i_markRegistryModified(const Guid &uuid);
     void i_unmarkRegistryModified(const Guid &uuid);
-    void i_saveModifiedRegistries();
+    void i_saveModifiedRegistries(bool fSync = false);
     static const com::Utf8Str &i_getVersionNormalized();
     static HRESULT i_ensureFilePathExists(const Utf8Str &strFileName, bool fCreate);
     const Utf8Str& i_settingsFilePath();
@@ -345,6 +348,13 @@ private:
     }
 
     HRESULT i_registerMachine(Machine *aMachine);
+    bool i_scheduleSettingsSave();
+    void i_stopSettingsSaver();
+    void i_addMachineToIndex(Machine *pMachine, bool fOnlyIfIndexed);
+    void i_removeMachineFromIndex(Machine *pMachine);
+    HRESULT i_checkMachineNameOrSettingsFile(const ComObjPtr<Machine> &pMachine,
+                                             const Utf8Str &aName,
+                                             ComObjPtr<Machine> *aMachine);
     HRESULT i_registerDHCPServer(DHCPServer *aDHCPServer,
                                  bool aSaveRegistry = true);
     HRESULT i_unregisterDHCPServer(DHCPServer *aDHCPServer);
@@ -381,6 +391,7 @@ private:
     static RWLockHandle* spMtxNatNetworkNameToRefCountLock;
 
     static DECLCALLBACK(int) AsyncEventHandler(RTTHREAD thread, void *pvUser);
+    static DECLCALLBACK(int) SettingsSaverThread(RTTHREAD hThreadSelf, void *pvUser);
 
 #ifdef RT_OS_WINDOWS
     friend class StartSVCHelperClientData;
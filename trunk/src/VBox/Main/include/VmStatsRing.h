@@ -0,0 +1,152 @@
+/* $Id$ */
+/** @file
+ * Main - VM statistics ring shared between a VM process and VBoxSVC.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#ifndef ____H_VMSTATSRING
+#define ____H_VMSTATSRING
+
+#include <iprt/types.h>
+#include <iprt/assert.h>
+#include <iprt/process.h>
+
+namespace pm
+{
+    /**
+     * Index of a value in a VM statistics sample. The order is the one of
+     * the CollectorGuest::updateStats() parameters.
+     */
+    typedef enum VMSTATSRINGVALUE
+    {
+        VMSTATSRINGVALUE_CPUUSER = 0,
+        VMSTATSRINGVALUE_CPUKERNEL,
+        VMSTATSRINGVALUE_CPUIDLE,
+        VMSTATSRINGVALUE_MEMTOTAL,
+        VMSTATSRINGVALUE_MEMFREE,
+        VMSTATSRINGVALUE_MEMBALLOON,
+        VMSTATSRINGVALUE_MEMSHARED,
+        VMSTATSRINGVALUE_MEMCACHE,
+        VMSTATSRINGVALUE_PAGETOTAL,
+        VMSTATSRINGVALUE_ALLOCVMM,
+        VMSTATSRINGVALUE_FREEVMM,
+        VMSTATSRINGVALUE_BALLOONEDVMM,
+        VMSTATSRINGVALUE_SHAREDVMM,
+        VMSTATSRINGVALUE_NETRX,
+        VMSTATSRINGVALUE_NETTX,
+        VMSTATSRINGVALUE_MAX
+    } VMSTATSRINGVALUE;
+
+    /** Number of samples the ring keeps, a bit over eight minutes worth at
+     * the one second interval CollectorGuest asks the VM for. */
+    const uint32_t VMSTATSRING_SAMPLES = 512;
+    /** VMSTATSRINGHDR::u32Magic value. */
+    const uint32_t VMSTATSRING_MAGIC   = UINT32_C(0x19630416);
+    /** VMSTATSRINGHDR::u32Version value. */
+    const uint32_t VMSTATSRING_VERSION = UINT32_C(0x00010000);
+
+    /**
+     * One sample in the ring.
+     *
+     * Sample number i lives in slot i % VMSTATSRING_SAMPLES. The writer sets
+     * u32Seq to 2*i+1 before touching the slot and to 2*i+2 when it is done,
+     * so a reader knows a copy is good if it saw 2*i+2 both before and after
+     * copying.
+     */
+    typedef struct VMSTATSRINGSAMPLE
+    {
+        uint32_t volatile   u32Seq;
+        /** VMSTATMASK bits of the values that are valid. */
+        uint32_t            fValid;
+        /** When the sample was taken, milliseconds since the Unix epoch. */
+        int64_t             i64Timestamp;
+        uint32_t            au32Values[VMSTATSRINGVALUE_MAX];
+        uint32_t            u32Reserved;
+    } VMSTATSRINGSAMPLE;
+    AssertCompileSizeAlignment(VMSTATSRINGSAMPLE, 8);
+
+    /**
+     * The shared memory layout.
+     */
+    typedef struct VMSTATSRINGHDR
+    {
+        uint32_t            u32Magic;
+        uint32_t            u32Version;
+        uint32_t            cSamples;
+        uint32_t            cbSample;
+        /** Number of samples pushed so far. Only the writer changes it. */
+        uint32_t volatile   cPushed;
+        /** Set by VBoxSVC while it reads the ring, the VM falls back to
+         * IInternalMachineControl::ReportVmStatistics while it is clear. */
+        uint32_t volatile   fReaderAttached;
+        VMSTATSRINGSAMPLE   aSamples[VMSTATSRING_SAMPLES];
+    } VMSTATSRINGHDR;
+
+    /**
+     * Ring of VM statistics samples in memory shared between the VM process
+     * and VBoxSVC.
+     *
+     * The VM process creates the ring and pushes a sample each statistics
+     * interval without talking to VBoxSVC. VBoxSVC opens the ring of the VM
+     * process and reads whatever samples it needs when metrics are queried.
+     * There is a single writer and there are no locks, readers detect the
+     * samples the writer overwrote under them and skip those.
+     */
+    class VmStatsRing
+    {
+    public:
+        VmStatsRing();
+        ~VmStatsRing();
+
+        /** Creates the ring of the calling process (VM side). */
+        int create();
+        /** Opens the ring of the given VM process (VBoxSVC side). */
+        int open(RTPROCESS aProcess);
+        void close();
+        bool isOpen() const { return mHdr != NULL; }
+
+        /** Appends a sample, @a paValues has VMSTATSRINGVALUE_MAX elements. */
+        void push(uint32_t fValid, const uint32_t *paValues);
+        bool isReaderAttached() const;
+        void setReaderAttached(bool fAttached);
+        /** Returns the number of samples pushed so far, i.e. the number of
+         * the next sample. */
+        uint32_t getPushed() const;
+        /**
+         * Copies sample number @a iSample.
+         * @returns false if the sample was not pushed yet or was overwritten.
+         */
+        bool read(uint32_t iSample, VMSTATSRINGSAMPLE *pSample) const;
+        /** Returns the number of the oldest sample still in the ring. */
+        uint32_t getOldest() const;
+
+    private:
+        static void makeName(char *pszName, size_t cbName, RTPROCESS aProcess);
+
+        VMSTATSRINGHDR          *mHdr;
+        bool                     mfOwner;
+#ifdef RT_OS_WINDOWS
+        void                    *mhMapping;
+#else
+        char                     mszName[32];
+#endif
+
+        /* Not copyable. */
+        VmStatsRing(const VmStatsRing &);
+        VmStatsRing &operator=(const VmStatsRing &);
+    };
+}
+
+#endif /* !____H_VMSTATSRING */
+/* vi: set tabstop=4 shiftwidth=4 expandtab: */
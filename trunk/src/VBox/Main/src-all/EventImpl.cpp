@@ -47,11 +47,25 @@
  * reach zero, element is removed from pending events map, and event is marked as processed.
  * Thus if passive listener's user forgets to call IEventSource's EventProcessed()
  * waiters may never know that event processing finished.
+ *
+ * Listeners registered with RegisterFilteredListener() may restrict machine events
+ * to a set of machines and guest property events to a set of property name patterns.
+ * Events filtered out are treated as processed by them without being delivered.
+ * Passive ones may also opt in to coalescing: an unread event in their queue is
+ * replaced by a newer one carrying the complete new state of the same thing.  Each
+ * queue entry keeps its coalescing key, and the key maps to the entry, so both
+ * replacing and reading are logarithmic in the queue size.  GetEvents() drains up
+ * to a given number of queued events in one call.
+ *
+ * A passive listener which doesn't read its events is unregistered when its queue
+ * grows too large.  The event source remembers such listeners until they are
+ * unregistered or registered again, and GetEvent() on them fails with
+ * VBOX_E_EVENT_QUEUE_OVERFLOW instead of VBOX_E_OBJECT_NOT_FOUND.
  */
 
 #include <list>
 #include <map>
-#include <deque>
+#include <set>
 
 #include "EventImpl.h"
 #include "AutoCaller.h"
@@ -591,19 +605,41 @@ public:
 
 typedef EventMapList EventMap[NumEvents];
 typedef std::map<IEvent *, int32_t> PendingEventsMap;
-typedef std::deque<ComPtr<IEvent> > PassiveQueue;
+/** An event in the queue of a passive listener. */
+struct QueuedEvent
+{
+    QueuedEvent(IEvent *aEvent, const Utf8Str &aKey) :
+        mEvent(aEvent), mKey(aKey)
+    {}
+
+    ComPtr<IEvent>                mEvent;
+    /** The coalescing key, empty if the event is never superseded. */
+    Utf8Str                       mKey;
+};
+typedef std::list<QueuedEvent> PassiveQueue;
+/** The queued event for each coalescing key, there is at most one. */
+typedef std::map<Utf8Str, PassiveQueue::iterator> CoalescableMap;
+/** Machine UUIDs a listener wants machine events for, empty for all. */
+typedef std::set<Utf8Str> MachineFilter;
 
 class ListenerRecord
 {
 private:
     ComPtr<IEventListener>        mListener;
     BOOL const                    mActive;
+    BOOL const                    mCoalesce;
+    MachineFilter const           mMachines;
+    /** Guest property name patterns, empty for all. */
+    Utf8Str const                 mProperties;
     EventSource                  *mOwner;
 
     RTSEMEVENT                    mQEvent;
     int32_t volatile              mQEventBusyCnt;
     RTCRITSECT                    mcsQLock;
     PassiveQueue                  mQueue;
+    /** Number of entries in mQueue. */
+    size_t                        mQueueSize;
+    CoalescableMap                mCoalescable;
     int32_t volatile              mRefCnt;
     uint64_t                      mLastRead;
 
@@ -611,12 +647,17 @@ public:
     ListenerRecord(IEventListener *aListener,
                    com::SafeArray<VBoxEventType_T> &aInterested,
                    BOOL aActive,
+                   BOOL aCoalesce,
+                   const MachineFilter &aMachines,
+                   const Utf8Str &aProperties,
                    EventSource *aOwner);
     ~ListenerRecord();
 
+    bool isFilteredOut(IEvent *aEvent);
     HRESULT process(IEvent *aEvent, BOOL aWaitable, PendingEventsMap::iterator &pit, AutoLockBase &alock);
-    HRESULT enqueue(IEvent *aEvent);
+    HRESULT enqueue(IEvent *aEvent, BOOL aWaitable);
     HRESULT dequeue(IEvent **aEvent, LONG aTimeout, AutoLockBase &aAlock);
+    HRESULT dequeue(std::vector<ComPtr<IEvent> > &aEvents, size_t cMax, LONG aTimeout, AutoLockBase &aAlock);
     HRESULT eventProcessed(IEvent *aEvent, PendingEventsMap::iterator &pit);
     void shutdown();
 
@@ -697,6 +738,8 @@ private:
 };
 
 typedef std::map<IEventListener *, RecordHolder<ListenerRecord> > Listeners;
+/** Passive listeners unregistered because of an overflowing queue. */
+typedef std::map<IEventListener *, ComPtr<IEventListener> > OverflowedListeners;
 
 struct EventSource::Data
 {
@@ -704,6 +747,7 @@ struct EventSource::Data
     {}
 
     Listeners                     mListeners;
+    OverflowedListeners           mOverflowed;
     EventMap                      mEvMap;
     PendingEventsMap              mPendingMap;
     bool                          fShutdown;
@@ -747,8 +791,12 @@ static BOOL implies(VBoxEventType_T who, VBoxEventType_T what)
 ListenerRecord::ListenerRecord(IEventListener *aListener,
                                com::SafeArray<VBoxEventType_T> &aInterested,
                                BOOL aActive,
+                               BOOL aCoalesce,
+                               const MachineFilter &aMachines,
+                               const Utf8Str &aProperties,
                                EventSource *aOwner) :
-    mActive(aActive), mOwner(aOwner), mQEventBusyCnt(0), mRefCnt(0)
+    mActive(aActive), mCoalesce(aCoalesce), mMachines(aMachines), mProperties(aProperties), mOwner(aOwner),
+    mQEventBusyCnt(0), mQueueSize(0), mRefCnt(0)
 {
     mListener = aListener;
     EventMap *aEvMap = &aOwner->m->mEvMap;
@@ -801,8 +849,9 @@ ListenerRecord::~ListenerRecord()
             if (mQueue.empty())
                 break;
 
-            mQueue.front().queryInterfaceTo(aEvent.asOutParam());
+            mQueue.front().mEvent.queryInterfaceTo(aEvent.asOutParam());
             mQueue.pop_front();
+            mQueueSize--;
 
             BOOL aWaitable = FALSE;
             aEvent->COMGETTER(Waitable)(&aWaitable);
@@ -819,11 +868,56 @@ ListenerRecord::~ListenerRecord()
     shutdown();
 }
 
+/**
+ * Checks whether the event is a machine event relating to a machine not in the
+ * machine filter, or a guest property event for a property not matching the
+ * name patterns.  Events not relating to any particular machine or property
+ * always pass.
+ */
+bool ListenerRecord::isFilteredOut(IEvent *aEvent)
+{
+    if (!mMachines.empty())
+    {
+        ComPtr<IMachineEvent> pEvent = aEvent;
+        Bstr bstrMachineId;
+        if (   pEvent.isNotNull()
+            && SUCCEEDED(pEvent->COMGETTER(MachineId)(bstrMachineId.asOutParam())))
+        {
+            com::Guid uuid(bstrMachineId);
+            if (   uuid.isValid()
+                && !uuid.isZero()
+                && mMachines.find(uuid.toString()) == mMachines.end())
+                return true;
+        }
+    }
+
+    if (mProperties.isNotEmpty())
+    {
+        ComPtr<IGuestPropertyChangedEvent> pEvent = aEvent;
+        Bstr bstrName;
+        if (   pEvent.isNotNull()
+            && SUCCEEDED(pEvent->COMGETTER(Name)(bstrName.asOutParam()))
+            && !RTStrSimplePatternMultiMatch(mProperties.c_str(), RTSTR_MAX,
+                                             Utf8Str(bstrName).c_str(), RTSTR_MAX, NULL))
+            return true;
+    }
+
+    return false;
+}
+
 HRESULT ListenerRecord::process(IEvent *aEvent,
                                 BOOL aWaitable,
                                 PendingEventsMap::iterator &pit,
                                 AutoLockBase &aAlock)
 {
+    /* Events filtered out count as processed by this listener. */
+    if (isFilteredOut(aEvent))
+    {
+        if (aWaitable)
+            eventProcessed(aEvent, pit);
+        return S_OK;
+    }
+
     if (mActive)
     {
         /*
@@ -843,36 +937,96 @@ HRESULT ListenerRecord::process(IEvent *aEvent,
             eventProcessed(aEvent, pit);
         return rc;
     }
-    return enqueue(aEvent);
+    return enqueue(aEvent, aWaitable);
 }
 
+/**
+ * Returns the key under which a queued event gets replaced by a newer one.
+ *
+ * Only events carrying the complete new state of something qualify, as a
+ * passive listener which has not read the older event yet would act on the
+ * newer one right after it anyway.  Events with an empty key are always
+ * delivered.
+ */
+static Utf8Str coalescingKey(IEvent *aEvent)
+{
+    VBoxEventType_T enmType = VBoxEventType_Invalid;
+    HRESULT hrc = aEvent->COMGETTER(Type)(&enmType);
+    if (FAILED(hrc))
+        return Utf8Str::Empty;
+
+    switch (enmType)
+    {
+        case VBoxEventType_OnMouseCapabilityChanged:
+        case VBoxEventType_OnKeyboardLedsChanged:
+            /* Fired by the console event source only, one VM. */
+            return Utf8StrFmt("%d", enmType);
 
-HRESULT ListenerRecord::enqueue(IEvent *aEvent)
+        case VBoxEventType_OnGuestPropertyChanged:
+        {
+            ComPtr<IGuestPropertyChangedEvent> pEvent = aEvent;
+            Bstr bstrMachineId;
+            Bstr bstrName;
+            if (   pEvent.isNull()
+                || FAILED(pEvent->COMGETTER(MachineId)(bstrMachineId.asOutParam()))
+                || FAILED(pEvent->COMGETTER(Name)(bstrName.asOutParam())))
+                return Utf8Str::Empty;
+            return Utf8StrFmt("%d/%ls/%ls", enmType, bstrMachineId.raw(), bstrName.raw());
+        }
+
+        default:
+            return Utf8Str::Empty;
+    }
+}
+
+
+HRESULT ListenerRecord::enqueue(IEvent *aEvent, BOOL aWaitable)
 {
     AssertMsg(!mActive, ("must be passive\n"));
 
+    Utf8Str strKey;
+    if (mCoalesce && !aWaitable)
+        strKey = coalescingKey(aEvent);
+
     // put an event the queue
     ::RTCritSectEnter(&mcsQLock);
 
     // If there was no events reading from the listener for the long time,
     // and events keep coming, or queue is oversized we shall unregister this listener.
     uint64_t sinceRead = RTTimeMilliTS() - mLastRead;
-    size_t queueSize = mQueue.size();
+    size_t queueSize = mQueueSize;
     if (queueSize > 1000 || (queueSize > 500 && sinceRead > 60 * 1000))
     {
         ::RTCritSectLeave(&mcsQLock);
+        LogRel(("EventSource: Unregistering passive listener %p with %zu unread events, last read %RU64 ms ago\n",
+                (IEventListener *)mListener, queueSize, sinceRead));
         return E_ABORT;
     }
 
 
     RTSEMEVENT hEvt = mQEvent;
-    if (queueSize != 0 && mQueue.back() == aEvent)
+    if (queueSize != 0 && mQueue.back().mEvent == aEvent)
         /* if same event is being pushed multiple times - it's reusable event and
            we don't really need multiple instances of it in the queue */
         hEvt = NIL_RTSEMEVENT;
     else if (hEvt != NIL_RTSEMEVENT) /* don't bother queuing after shutdown */
     {
-        mQueue.push_back(aEvent);
+        // drop the unread event this one supersedes
+        if (!strKey.isEmpty())
+        {
+            CoalescableMap::iterator cit = mCoalescable.find(strKey);
+            if (cit != mCoalescable.end())
+            {
+                mQueue.erase(cit->second);
+                mQueueSize--;
+                mCoalescable.erase(cit);
+            }
+        }
+
+        PassiveQueue::iterator qit = mQueue.insert(mQueue.end(), QueuedEvent(aEvent, strKey));
+        mQueueSize++;
+        if (!strKey.isEmpty())
+            mCoalescable[strKey] = qit;
         ASMAtomicIncS32(&mQEventBusyCnt);
     }
 
@@ -891,6 +1045,23 @@ HRESULT ListenerRecord::enqueue(IEvent *aEvent)
 HRESULT ListenerRecord::dequeue(IEvent **aEvent,
                                 LONG aTimeout,
                                 AutoLockBase &aAlock)
+{
+    std::vector<ComPtr<IEvent> > events;
+    HRESULT rc = dequeue(events, 1, aTimeout, aAlock);
+    if (SUCCEEDED(rc))
+    {
+        if (events.empty())
+            *aEvent = NULL;
+        else
+            events.front().queryInterfaceTo(aEvent);
+    }
+    return rc;
+}
+
+HRESULT ListenerRecord::dequeue(std::vector<ComPtr<IEvent> > &aEvents,
+                                size_t cMax,
+                                LONG aTimeout,
+                                AutoLockBase &aAlock)
 {
     if (mActive)
         return VBOX_E_INVALID_OBJECT_STATE;
@@ -926,12 +1097,14 @@ HRESULT ListenerRecord::dequeue(IEvent **aEvent,
         }
     }
 
-    if (mQueue.empty())
-        *aEvent = NULL;
-    else
+    while (!mQueue.empty() && aEvents.size() < cMax)
     {
-        mQueue.front().queryInterfaceTo(aEvent);
+        QueuedEvent &rEntry = mQueue.front();
+        if (!rEntry.mKey.isEmpty())
+            mCoalescable.erase(rEntry.mKey);
+        aEvents.push_back(rEntry.mEvent);
         mQueue.pop_front();
+        mQueueSize--;
     }
 
     ::RTCritSectLeave(&mcsQLock);
@@ -1047,6 +1220,7 @@ void EventSource::uninit()
         return;
 
     m->mListeners.clear();
+    m->mOverflowed.clear();
     // m->mEvMap shall be cleared at this point too by destructors, assert?
 }
 
@@ -1054,6 +1228,27 @@ HRESULT EventSource::registerListener(const ComPtr<IEventListener> &aListener,
                                       const std::vector<VBoxEventType_T> &aInteresting,
                                       BOOL aActive)
 {
+    return registerFilteredListener(aListener, aInteresting, aActive, FALSE /* aCoalesce */,
+                                    std::vector<com::Utf8Str>(), com::Utf8Str::Empty);
+}
+
+HRESULT EventSource::registerFilteredListener(const ComPtr<IEventListener> &aListener,
+                                              const std::vector<VBoxEventType_T> &aInteresting,
+                                              BOOL aActive,
+                                              BOOL aCoalesce,
+                                              const std::vector<com::Utf8Str> &aMachines,
+                                              const com::Utf8Str &aProperties)
+{
+    MachineFilter machines;
+    for (size_t i = 0; i < aMachines.size(); ++i)
+    {
+        com::Guid uuid(aMachines[i]);
+        if (!uuid.isValid())
+            return setError(E_INVALIDARG,
+                            tr("Invalid machine UUID {%s}"), aMachines[i].c_str());
+        machines.insert(uuid.toString());
+    }
+
     AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
 
     if (m->fShutdown)
@@ -1066,8 +1261,10 @@ HRESULT EventSource::registerListener(const ComPtr<IEventListener> &aListener,
                         tr("This listener already registered"));
 
     com::SafeArray<VBoxEventType_T> interested(aInteresting);
-    RecordHolder<ListenerRecord> lrh(new ListenerRecord(aListener, interested, aActive, this));
+    RecordHolder<ListenerRecord> lrh(new ListenerRecord(aListener, interested, aActive, aCoalesce, machines,
+                                                        aProperties, this));
     m->mListeners.insert(Listeners::value_type((IEventListener *)aListener, lrh));
+    m->mOverflowed.erase(aListener);
 
     VBoxEventDesc evDesc;
     evDesc.init(this, VBoxEventType_OnEventSourceChanged, (IEventListener *)aListener, TRUE);
@@ -1091,6 +1288,11 @@ HRESULT EventSource::unregisterListener(const ComPtr<IEventListener> &aListener)
         // destructor removes refs from the event map
         rc = S_OK;
     }
+    else if (m->mOverflowed.erase(aListener))
+    {
+        /* Already unregistered by fireEvent(), just forget about it. */
+        return S_OK;
+    }
     else
     {
         rc = setError(VBOX_E_OBJECT_NOT_FOUND,
@@ -1172,6 +1374,9 @@ HRESULT EventSource::fireEvent(const ComPtr<IEvent> &aEvent,
                 {
                     lit->second.obj()->shutdown();
                     m->mListeners.erase(lit);
+                    if (cbRc == E_ABORT)
+                        m->mOverflowed.insert(OverflowedListeners::value_type(record.obj()->mListener,
+                                                                              record.obj()->mListener));
                 }
             }
             // anything else to do with cbRc?
@@ -1202,6 +1407,43 @@ HRESULT EventSource::getEvent(const ComPtr<IEventListener> &aListener,
 
     if (it != m->mListeners.end())
         rc = it->second.obj()->dequeue(aEvent.asOutParam(), aTimeout, alock);
+    else if (m->mOverflowed.find(aListener) != m->mOverflowed.end())
+        rc = setError(VBOX_E_EVENT_QUEUE_OVERFLOW,
+                      tr("Listener was unregistered because it did not pick up its events"));
+    else
+        rc = setError(VBOX_E_OBJECT_NOT_FOUND,
+                      tr("Listener was never registered"));
+
+    if (rc == VBOX_E_INVALID_OBJECT_STATE)
+        return setError(rc, tr("Listener must be passive"));
+
+    return rc;
+}
+
+HRESULT EventSource::getEvents(const ComPtr<IEventListener> &aListener,
+                               LONG aTimeout,
+                               ULONG aMaxEvents,
+                               std::vector<ComPtr<IEvent> > &aEvents)
+{
+    if (aMaxEvents == 0)
+        return setError(E_INVALIDARG,
+                        tr("At least one event must be requested"));
+
+    AutoReadLock alock(this COMMA_LOCKVAL_SRC_POS);
+
+    if (m->fShutdown)
+        return setError(VBOX_E_INVALID_OBJECT_STATE,
+                        tr("This event source is already shut down"));
+
+    Listeners::iterator it = m->mListeners.find(aListener);
+    HRESULT rc = S_OK;
+
+    aEvents.clear();
+    if (it != m->mListeners.end())
+        rc = it->second.obj()->dequeue(aEvents, aMaxEvents, aTimeout, alock);
+    else if (m->mOverflowed.find(aListener) != m->mOverflowed.end())
+        rc = setError(VBOX_E_EVENT_QUEUE_OVERFLOW,
+                      tr("Listener was unregistered because it did not pick up its events"));
     else
         rc = setError(VBOX_E_OBJECT_NOT_FOUND,
                       tr("Listener was never registered"));
@@ -1416,6 +1658,12 @@ public:
     STDMETHOD(RegisterListener)(IEventListener *aListener,
                                 ComSafeArrayIn(VBoxEventType_T, aInterested),
                                 BOOL aActive);
+    STDMETHOD(RegisterFilteredListener)(IEventListener *aListener,
+                                        ComSafeArrayIn(VBoxEventType_T, aInterested),
+                                        BOOL aActive,
+                                        BOOL aCoalesce,
+                                        ComSafeArrayIn(IN_BSTR, aMachines),
+                                        IN_BSTR aProperties);
     STDMETHOD(UnregisterListener)(IEventListener *aListener);
     STDMETHOD(FireEvent)(IEvent *aEvent,
                          LONG aTimeout,
@@ -1423,6 +1671,10 @@ public:
     STDMETHOD(GetEvent)(IEventListener *aListener,
                         LONG aTimeout,
                         IEvent **aEvent);
+    STDMETHOD(GetEvents)(IEventListener *aListener,
+                         LONG aTimeout,
+                         ULONG aMaxEvents,
+                         ComSafeArrayOut(IEvent *, aEvents));
     STDMETHOD(EventProcessed)(IEventListener *aListener,
                               IEvent *aEvent);
 
@@ -1543,6 +1795,46 @@ STDMETHODIMP EventSourceAggregator::RegisterListener(IEventListener *aListener,
     return rc;
 }
 
+STDMETHODIMP EventSourceAggregator::RegisterFilteredListener(IEventListener *aListener,
+                                                             ComSafeArrayIn(VBoxEventType_T, aInterested),
+                                                             BOOL aActive,
+                                                             BOOL aCoalesce,
+                                                             ComSafeArrayIn(IN_BSTR, aMachines),
+                                                             IN_BSTR aProperties)
+{
+    CheckComArgNotNull(aListener);
+    CheckComArgSafeArrayNotNull(aInterested);
+    CheckComArgSafeArrayNotNull(aMachines);
+
+    AutoCaller autoCaller(this);
+    if (FAILED(autoCaller.rc()))
+        return autoCaller.rc();
+
+    HRESULT rc;
+
+    ComPtr<IEventListener> proxy;
+    rc = createProxyListener(aListener, proxy.asOutParam());
+    if (FAILED(rc))
+        return rc;
+
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
+    for (EventSourceList::const_iterator it = mEventSources.begin(); it != mEventSources.end();
+         ++it)
+    {
+        ComPtr<IEventSource> es = *it;
+        /* Filter on the real event sources already, so the proxy only forwards what's wanted */
+        rc = es->RegisterFilteredListener(proxy, ComSafeArrayInArg(aInterested), TRUE, FALSE,
+                                          ComSafeArrayInArg(aMachines), aProperties);
+    }
+    /* And add real listener on our event source, which does the queueing */
+    rc = mSource->RegisterFilteredListener(aListener, ComSafeArrayInArg(aInterested), aActive, aCoalesce,
+                                           ComSafeArrayInArg(aMachines), aProperties);
+
+    rc = S_OK;
+
+    return rc;
+}
+
 STDMETHODIMP EventSourceAggregator::UnregisterListener(IEventListener *aListener)
 {
     CheckComArgNotNull(aListener);
@@ -1607,6 +1899,14 @@ STDMETHODIMP EventSourceAggregator::GetEvent(IEventListener *aListener,
     return mSource->GetEvent(aListener, aTimeout, aEvent);
 }
 
+STDMETHODIMP EventSourceAggregator::GetEvents(IEventListener *aListener,
+                                              LONG aTimeout,
+                                              ULONG aMaxEvents,
+                                              ComSafeArrayOut(IEvent *, aEvents))
+{
+    return mSource->GetEvents(aListener, aTimeout, aMaxEvents, ComSafeArrayOutArg(aEvents));
+}
+
 STDMETHODIMP EventSourceAggregator::EventProcessed(IEventListener *aListener,
                                                    IEvent *aEvent)
 {
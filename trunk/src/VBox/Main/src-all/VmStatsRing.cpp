@@ -0,0 +1,273 @@
+/* $Id$ */
+/** @file
+ * Main - VM statistics ring shared between a VM process and VBoxSVC.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+#include "VmStatsRing.h"
+
+#include <VBox/err.h>
+#include <VBox/log.h>
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/string.h>
+#include <iprt/time.h>
+
+#ifdef RT_OS_WINDOWS
+# include <iprt/win/windows.h>
+#elif !defined(RT_OS_OS2)
+# include <errno.h>
+# include <fcntl.h>
+# include <unistd.h>
+# include <sys/mman.h>
+# include <sys/stat.h>
+#endif
+
+using namespace pm;
+
+VmStatsRing::VmStatsRing()
+    : mHdr(NULL), mfOwner(false)
+{
+#ifdef RT_OS_WINDOWS
+    mhMapping = NULL;
+#else
+    mszName[0] = '\0';
+#endif
+}
+
+VmStatsRing::~VmStatsRing()
+{
+    close();
+}
+
+/* static */
+void VmStatsRing::makeName(char *pszName, size_t cbName, RTPROCESS aProcess)
+{
+#ifdef RT_OS_WINDOWS
+    RTStrPrintf(pszName, cbName, "Local\\VBoxVmStats-%u", aProcess);
+#else
+    RTStrPrintf(pszName, cbName, "/VBoxVmStats-%u", aProcess);
+#endif
+}
+
+int VmStatsRing::create()
+{
+    AssertReturn(!mHdr, VERR_WRONG_ORDER);
+
+    char szName[32];
+    makeName(szName, sizeof(szName), RTProcSelf());
+    VMSTATSRINGHDR *pHdr = NULL;
+#ifdef RT_OS_WINDOWS
+    HANDLE hMapping = CreateFileMappingA(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE,
+                                         0, sizeof(VMSTATSRINGHDR), szName);
+    if (!hMapping)
+        return RTErrConvertFromWin32(GetLastError());
+    pHdr = (VMSTATSRINGHDR *)MapViewOfFile(hMapping, FILE_MAP_WRITE, 0, 0, sizeof(VMSTATSRINGHDR));
+    if (!pHdr)
+    {
+        int rc = RTErrConvertFromWin32(GetLastError());
+        CloseHandle(hMapping);
+        return rc;
+    }
+    mhMapping = hMapping;
+#elif defined(RT_OS_OS2)
+    NOREF(pHdr);
+    return VERR_NOT_SUPPORTED;
+#else
+    /* A ring left behind by a crashed process with the same pid is stale. */
+    shm_unlink(szName);
+    int fd = shm_open(szName, O_RDWR | O_CREAT | O_EXCL, S_IRUSR | S_IWUSR);
+    if (fd < 0)
+        return RTErrConvertFromErrno(errno);
+    if (ftruncate(fd, sizeof(VMSTATSRINGHDR)) == 0)
+    {
+        void *pv = mmap(NULL, sizeof(VMSTATSRINGHDR), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (pv != MAP_FAILED)
+            pHdr = (VMSTATSRINGHDR *)pv;
+    }
+    int rc = pHdr ? VINF_SUCCESS : RTErrConvertFromErrno(errno);
+    ::close(fd);
+    if (RT_FAILURE(rc))
+    {
+        shm_unlink(szName);
+        return rc;
+    }
+    RTStrCopy(mszName, sizeof(mszName), szName);
+#endif
+
+    /* Fresh shared memory is zeroed, fill in the header last. */
+    pHdr->cSamples   = VMSTATSRING_SAMPLES;
+    pHdr->cbSample   = sizeof(VMSTATSRINGSAMPLE);
+    pHdr->u32Version = VMSTATSRING_VERSION;
+    ASMAtomicWriteU32(&pHdr->u32Magic, VMSTATSRING_MAGIC);
+    mfOwner = true;
+    mHdr    = pHdr;
+    LogFlowFunc(("Created VM statistics ring %s\n", szName));
+    return VINF_SUCCESS;
+}
+
+int VmStatsRing::open(RTPROCESS aProcess)
+{
+    AssertReturn(!mHdr, VERR_WRONG_ORDER);
+
+    char szName[32];
+    makeName(szName, sizeof(szName), aProcess);
+    VMSTATSRINGHDR *pHdr = NULL;
+#ifdef RT_OS_WINDOWS
+    HANDLE hMapping = OpenFileMappingA(FILE_MAP_READ | FILE_MAP_WRITE, FALSE, szName);
+    if (!hMapping)
+        return RTErrConvertFromWin32(GetLastError());
+    pHdr = (VMSTATSRINGHDR *)MapViewOfFile(hMapping, FILE_MAP_READ | FILE_MAP_WRITE, 0, 0, sizeof(VMSTATSRINGHDR));
+    if (!pHdr)
+    {
+        int rc = RTErrConvertFromWin32(GetLastError());
+        CloseHandle(hMapping);
+        return rc;
+    }
+    mhMapping = hMapping;
+#elif defined(RT_OS_OS2)
+    NOREF(pHdr);
+    return VERR_NOT_SUPPORTED;
+#else
+    int fd = shm_open(szName, O_RDWR, 0);
+    if (fd < 0)
+        return RTErrConvertFromErrno(errno);
+    int rc = VINF_SUCCESS;
+    struct stat st;
+    if (fstat(fd, &st) != 0)
+        rc = RTErrConvertFromErrno(errno);
+    else if ((uint64_t)st.st_size < sizeof(VMSTATSRINGHDR))
+        rc = VERR_INVALID_MAGIC; /* Not (yet) a ring we know. */
+    else
+    {
+        void *pv = mmap(NULL, sizeof(VMSTATSRINGHDR), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        if (pv != MAP_FAILED)
+            pHdr = (VMSTATSRINGHDR *)pv;
+        else
+            rc = RTErrConvertFromErrno(errno);
+    }
+    ::close(fd);
+    if (RT_FAILURE(rc))
+        return rc;
+#endif
+
+    /* Other threads may look at mHdr already, so only publish a good ring. */
+    mfOwner = false;
+    if (   ASMAtomicReadU32(&pHdr->u32Magic) != VMSTATSRING_MAGIC
+        || pHdr->u32Version != VMSTATSRING_VERSION
+        || pHdr->cSamples   != VMSTATSRING_SAMPLES
+        || pHdr->cbSample   != sizeof(VMSTATSRINGSAMPLE))
+    {
+#ifdef RT_OS_WINDOWS
+        UnmapViewOfFile(pHdr);
+        CloseHandle(hMapping);
+        mhMapping = NULL;
+#elif !defined(RT_OS_OS2)
+        munmap(pHdr, sizeof(VMSTATSRINGHDR));
+#endif
+        return VERR_VERSION_MISMATCH;
+    }
+    ASMAtomicWritePtr(&mHdr, pHdr);
+    LogFlowFunc(("Opened VM statistics ring %s\n", szName));
+    return VINF_SUCCESS;
+}
+
+void VmStatsRing::close()
+{
+    if (!mHdr)
+        return;
+
+    if (!mfOwner)
+        setReaderAttached(false);
+#ifdef RT_OS_WINDOWS
+    UnmapViewOfFile(mHdr);
+    CloseHandle((HANDLE)mhMapping);
+    mhMapping = NULL;
+#elif !defined(RT_OS_OS2)
+    munmap(mHdr, sizeof(VMSTATSRINGHDR));
+    /* The name goes away with the VM, readers keep their mapping. */
+    if (mfOwner)
+        shm_unlink(mszName);
+    mszName[0] = '\0';
+#endif
+    mHdr    = NULL;
+    mfOwner = false;
+}
+
+void VmStatsRing::push(uint32_t fValid, const uint32_t *paValues)
+{
+    AssertReturnVoid(mHdr && mfOwner);
+
+    uint32_t const     iSample = mHdr->cPushed;
+    VMSTATSRINGSAMPLE *pSample = &mHdr->aSamples[iSample % VMSTATSRING_SAMPLES];
+    RTTIMESPEC         Now;
+
+    /* The atomic writes are full barriers on all the hosts we run on. */
+    ASMAtomicWriteU32(&pSample->u32Seq, 2 * iSample + 1);
+    pSample->fValid       = fValid;
+    pSample->i64Timestamp = RTTimeSpecGetMilli(RTTimeNow(&Now));
+    memcpy(pSample->au32Values, paValues, sizeof(pSample->au32Values));
+    ASMAtomicWriteU32(&pSample->u32Seq, 2 * iSample + 2);
+    ASMAtomicWriteU32(&mHdr->cPushed, iSample + 1);
+}
+
+bool VmStatsRing::isReaderAttached() const
+{
+    return mHdr && ASMAtomicReadU32(&mHdr->fReaderAttached) != 0;
+}
+
+void VmStatsRing::setReaderAttached(bool fAttached)
+{
+    if (mHdr)
+        ASMAtomicWriteU32(&mHdr->fReaderAttached, fAttached);
+}
+
+uint32_t VmStatsRing::getPushed() const
+{
+    return mHdr ? ASMAtomicReadU32(&mHdr->cPushed) : 0;
+}
+
+uint32_t VmStatsRing::getOldest() const
+{
+    uint32_t cPushed = getPushed();
+    return cPushed > VMSTATSRING_SAMPLES ? cPushed - VMSTATSRING_SAMPLES : 0;
+}
+
+bool VmStatsRing::read(uint32_t iSample, VMSTATSRINGSAMPLE *pSample) const
+{
+    if (!mHdr)
+        return false;
+
+    uint32_t cPushed = ASMAtomicReadU32(&mHdr->cPushed);
+    if (   iSample >= cPushed
+        || cPushed - iSample > VMSTATSRING_SAMPLES)
+        return false;
+
+    VMSTATSRINGSAMPLE       *pSrc = &mHdr->aSamples[iSample % VMSTATSRING_SAMPLES];
+    uint32_t const           uSeq = 2 * iSample + 2;
+    if (ASMAtomicReadU32(&pSrc->u32Seq) != uSeq)
+        return false;
+    ASMReadFence();
+    pSample->fValid       = pSrc->fValid;
+    pSample->i64Timestamp = pSrc->i64Timestamp;
+    memcpy(pSample->au32Values, pSrc->au32Values, sizeof(pSample->au32Values));
+    ASMReadFence();
+    /* The writer may have lapped us while we were copying. */
+    if (ASMAtomicReadU32(&pSrc->u32Seq) != uSeq)
+        return false;
+    pSample->u32Seq      = uSeq;
+    pSample->u32Reserved = 0;
+    return true;
+}
+/* vi: set tabstop=4 shiftwidth=4 expandtab: */
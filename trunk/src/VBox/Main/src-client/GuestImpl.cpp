@@ -162,6 +162,7 @@ void Guest::uninit()
     AssertMsgRC(vrc, ("Failed to create guest statistics update timer(%Rra)\n", vrc));
     mStatTimer = NULL;
     mMagic     = 0;
+    mStatsRing.close();
 
 #ifdef VBOX_WITH_GUEST_CONTROL
     LogFlowThisFunc(("Closing sessions (%RU64 total)\n",
@@ -340,23 +341,47 @@ void Guest::i_updateStats(uint64_t iTick)
         }
     }
 
-    mParent->i_reportVmStatistics(validStats,
-                                  aGuestStats[GUESTSTATTYPE_CPUUSER],
-                                  aGuestStats[GUESTSTATTYPE_CPUKERNEL],
-                                  aGuestStats[GUESTSTATTYPE_CPUIDLE],
-                                  /* Convert the units for RAM usage stats: page (4K) -> 1KB units */
-                                  mCurrentGuestStat[GUESTSTATTYPE_MEMTOTAL] * (_4K/_1K),
-                                  mCurrentGuestStat[GUESTSTATTYPE_MEMFREE] * (_4K/_1K),
-                                  mCurrentGuestStat[GUESTSTATTYPE_MEMBALLOON] * (_4K/_1K),
-                                  (ULONG)(cbSharedMem / _1K), /* bytes -> KB */
-                                  mCurrentGuestStat[GUESTSTATTYPE_MEMCACHE] * (_4K/_1K),
-                                  mCurrentGuestStat[GUESTSTATTYPE_PAGETOTAL] * (_4K/_1K),
-                                  (ULONG)(cbAllocTotal / _1K), /* bytes -> KB */
-                                  (ULONG)(cbFreeTotal / _1K),
-                                  (ULONG)(cbBalloonedTotal / _1K),
-                                  (ULONG)(cbSharedTotal / _1K),
-                                  uNetStatRx,
-                                  uNetStatTx);
+    uint32_t aValues[pm::VMSTATSRINGVALUE_MAX];
+    aValues[pm::VMSTATSRINGVALUE_CPUUSER]      = aGuestStats[GUESTSTATTYPE_CPUUSER];
+    aValues[pm::VMSTATSRINGVALUE_CPUKERNEL]    = aGuestStats[GUESTSTATTYPE_CPUKERNEL];
+    aValues[pm::VMSTATSRINGVALUE_CPUIDLE]      = aGuestStats[GUESTSTATTYPE_CPUIDLE];
+    /* Convert the units for RAM usage stats: page (4K) -> 1KB units */
+    aValues[pm::VMSTATSRINGVALUE_MEMTOTAL]     = mCurrentGuestStat[GUESTSTATTYPE_MEMTOTAL] * (_4K/_1K);
+    aValues[pm::VMSTATSRINGVALUE_MEMFREE]      = mCurrentGuestStat[GUESTSTATTYPE_MEMFREE] * (_4K/_1K);
+    aValues[pm::VMSTATSRINGVALUE_MEMBALLOON]   = mCurrentGuestStat[GUESTSTATTYPE_MEMBALLOON] * (_4K/_1K);
+    aValues[pm::VMSTATSRINGVALUE_MEMSHARED]    = (ULONG)(cbSharedMem / _1K); /* bytes -> KB */
+    aValues[pm::VMSTATSRINGVALUE_MEMCACHE]     = mCurrentGuestStat[GUESTSTATTYPE_MEMCACHE] * (_4K/_1K);
+    aValues[pm::VMSTATSRINGVALUE_PAGETOTAL]    = mCurrentGuestStat[GUESTSTATTYPE_PAGETOTAL] * (_4K/_1K);
+    aValues[pm::VMSTATSRINGVALUE_ALLOCVMM]     = (ULONG)(cbAllocTotal / _1K); /* bytes -> KB */
+    aValues[pm::VMSTATSRINGVALUE_FREEVMM]      = (ULONG)(cbFreeTotal / _1K);
+    aValues[pm::VMSTATSRINGVALUE_BALLOONEDVMM] = (ULONG)(cbBalloonedTotal / _1K);
+    aValues[pm::VMSTATSRINGVALUE_SHAREDVMM]    = (ULONG)(cbSharedTotal / _1K);
+    aValues[pm::VMSTATSRINGVALUE_NETRX]        = uNetStatRx;
+    aValues[pm::VMSTATSRINGVALUE_NETTX]        = uNetStatTx;
+
+    /*
+     * Once VBoxSVC reads our ring there is no need to bother it with a call
+     * each interval, it looks at the samples when somebody wants them.
+     */
+    if (mStatsRing.isReaderAttached())
+        mStatsRing.push(validStats, aValues);
+    else
+        mParent->i_reportVmStatistics(validStats,
+                                      aValues[pm::VMSTATSRINGVALUE_CPUUSER],
+                                      aValues[pm::VMSTATSRINGVALUE_CPUKERNEL],
+                                      aValues[pm::VMSTATSRINGVALUE_CPUIDLE],
+                                      aValues[pm::VMSTATSRINGVALUE_MEMTOTAL],
+                                      aValues[pm::VMSTATSRINGVALUE_MEMFREE],
+                                      aValues[pm::VMSTATSRINGVALUE_MEMBALLOON],
+                                      aValues[pm::VMSTATSRINGVALUE_MEMSHARED],
+                                      aValues[pm::VMSTATSRINGVALUE_MEMCACHE],
+                                      aValues[pm::VMSTATSRINGVALUE_PAGETOTAL],
+                                      aValues[pm::VMSTATSRINGVALUE_ALLOCVMM],
+                                      aValues[pm::VMSTATSRINGVALUE_FREEVMM],
+                                      aValues[pm::VMSTATSRINGVALUE_BALLOONEDVMM],
+                                      aValues[pm::VMSTATSRINGVALUE_SHAREDVMM],
+                                      aValues[pm::VMSTATSRINGVALUE_NETRX],
+                                      aValues[pm::VMSTATSRINGVALUE_NETTX]);
 }
 
 // IGuest properties
@@ -613,6 +638,14 @@ HRESULT Guest::setStatisticsUpdateInterval(ULONG aStatisticsUpdateInterval)
 {
     AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
 
+    /* VBoxSVC opens the statistics ring as soon as this call returns. */
+    if (aStatisticsUpdateInterval != 0 && !mStatsRing.isOpen())
+    {
+        int vrc = mStatsRing.create();
+        if (RT_FAILURE(vrc))
+            LogRel(("Guest: Failed to create the statistics ring (%Rrc), reporting statistics to VBoxSVC directly\n", vrc));
+    }
+
     if (mStatUpdateInterval)
         if (aStatisticsUpdateInterval == 0)
             RTTimerLRStop(mStatTimer);
@@ -405,6 +405,9 @@ class HGCMMsgHeader: public HGCMMsgCore
     public:
         HGCMMsgHeader() : pCmd(NULL), pHGCMPort(NULL) {};
 
+        /* The message may be a recycled one. */
+        virtual void Initialize (void) { pCmd = NULL; pHGCMPort = NULL; };
+
         /* Command pointer/identifier. */
         PVBOXHGCMCMD pCmd;
 
@@ -21,6 +21,7 @@
 #include "HGCMThread.h"
 
 #include <VBox/err.h>
+#include <iprt/asm.h>
 #include <iprt/semaphore.h>
 #include <iprt/thread.h>
 #include <iprt/string.h>
@@ -46,10 +47,9 @@
  * Worker thread then again may fetch next message.
  *
  * Upon processing the message the worker thread dereferences it.
- * Dereferencing also automatically deletes message from the thread
- * queue and frees memory allocated for the message, if no more
- * references left. If there are references, the message remains
- * in the queue.
+ * When no more references are left, the message is put on a free
+ * list of the thread and reused by a later allocation of a message
+ * with the same identifier, or freed if the list is full.
  *
  */
 
@@ -63,6 +63,11 @@
 /* Thread has been terminated. */
 #define HGCMMSG_TF_TERMINATED          (0x00000004)
 
+/* Messages with identifiers below this value are recycled. */
+#define HGCM_MSG_FREE_LIST_IDS         (32)
+/* How many messages of each identifier are kept for reuse. */
+#define HGCM_MSG_FREE_LIST_MAX         (16)
+
 /** @todo consider use of RTReq */
 
 static DECLCALLBACK(int) hgcmWorkerThreadFunc (RTTHREAD ThreadSelf, void *pvUser);
@@ -82,46 +87,42 @@ class HGCMThread: public HGCMObject
         RTTHREAD m_thread;
 
         /* Event the thread waits for, signalled when a message
-         * to process is posted to the thread.
+         * is posted to an empty queue.
          */
-        RTSEMEVENTMULTI m_eventThread;
+        RTSEMEVENT m_eventThread;
 
         /* A caller thread waits for completion of a SENT message on this event. */
         RTSEMEVENTMULTI m_eventSend;
         int32_t volatile m_i32MessagesProcessed;
 
-        /* Critical section for accessing the thread data, mostly for message queues. */
-        RTCRITSECT m_critsect;
-
         /* thread state/operation flags */
         uint32_t m_fu32ThreadFlags;
 
-        /* Message queue variables. Messages are inserted at tail of message
-         * queue. They are consumed by worker thread sequentially. If a message was
-         * consumed, it is removed from message queue.
+        /* Message queue variables. Any thread pushes messages to the
+         * m_pMsgInputPending LIFO list with a compare and exchange, so
+         * posting does not take a lock. The worker thread takes the whole
+         * list at once, reverses it and then consumes the batch from the
+         * m_pMsgInputQueueHead list, which only the worker thread accesses.
          */
 
-        /* Head of message queue. */
+        /* Posted messages not yet seen by the worker thread, newest first. */
+        HGCMMsgCore * volatile m_pMsgInputPending;
+        /* Head of the batch of messages being consumed by the worker thread. */
         HGCMMsgCore *m_pMsgInputQueueHead;
-        /* Message which another message will be inserted after. */
-        HGCMMsgCore *m_pMsgInputQueueTail;
 
-        /* Head of messages being processed queue. */
-        HGCMMsgCore *m_pMsgInProcessHead;
-        /* Message which another message will be inserted after. */
-        HGCMMsgCore *m_pMsgInProcessTail;
-
-        /* Head of free message structures list. */
-        HGCMMsgCore *m_pFreeHead;
-        /* Tail of free message structures list. */
-        HGCMMsgCore *m_pFreeTail;
+        /* Per message identifier lists of free message structures, for
+         * recycling them instead of going to the heap for every call.
+         * Any thread may push a message. A thread taking one exchanges the
+         * whole list with NULL and puts the rest back, so there is no ABA
+         * problem.
+         */
+        HGCMMsgCore * volatile m_apFreeMsgs[HGCM_MSG_FREE_LIST_IDS];
+        /* Number of messages in each of the free lists, approximate. */
+        uint32_t volatile m_acFreeMsgs[HGCM_MSG_FREE_LIST_IDS];
 
         HGCMTHREADHANDLE m_handle;
 
-        inline int Enter (void);
-        inline void Leave (void);
-
-        HGCMMsgCore *FetchFreeListHead (void);
+        HGCMMsgCore *FetchFreeListHead (uint32_t u32MsgId);
 
     protected:
         virtual ~HGCMThread (void);
@@ -138,6 +139,7 @@ class HGCMThread: public HGCMObject
         int MsgGet (HGCMMsgCore **ppMsg);
         int MsgPost (HGCMMsgCore *pMsg, PHGCMMSGCALLBACK pfnCallback, bool bWait);
         void MsgComplete (HGCMMsgCore *pMsg, int32_t result);
+        bool MsgFree (HGCMMsgCore *pMsg);
 };
 
 
@@ -155,7 +157,6 @@ void HGCMMsgCore::InitializeCore (uint32_t u32MsgId, HGCMTHREADHANDLE hThread)
     m_u32Msg      = u32MsgId;
     m_pfnCallback = NULL;
     m_pNext       = NULL;
-    m_pPrev       = NULL;
     m_fu32Flags   = 0;
     m_rcSend      = VINF_SUCCESS;
 
@@ -172,6 +173,26 @@ void HGCMMsgCore::InitializeCore (uint32_t u32MsgId, HGCMTHREADHANDLE hThread)
     }
 }
 
+/* virtual */ void HGCMMsgCore::Destroy ()
+{
+    Uninitialize ();
+
+    /* A message on the free list must not keep the thread alive. The thread
+     * deletes the messages on its free lists when it is destroyed. */
+    HGCMThread *pThread = m_pThread;
+    m_pThread = NULL;
+
+    if (!pThread || !pThread->MsgFree (this))
+    {
+        delete this;
+    }
+
+    if (pThread)
+    {
+        hgcmObjDereference (pThread);
+    }
+}
+
 /*
  * HGCMThread implementation.
  */
@@ -208,19 +229,19 @@ HGCMThread::HGCMThread ()
     m_pfnThread (NULL),
     m_pvUser (NULL),
     m_thread (NIL_RTTHREAD),
-    m_eventThread (0),
+    m_eventThread (NIL_RTSEMEVENT),
     m_eventSend (0),
     m_i32MessagesProcessed (0),
     m_fu32ThreadFlags (0),
+    m_pMsgInputPending (NULL),
     m_pMsgInputQueueHead (NULL),
-    m_pMsgInputQueueTail (NULL),
-    m_pMsgInProcessHead (NULL),
-    m_pMsgInProcessTail (NULL),
-    m_pFreeHead (NULL),
-    m_pFreeTail (NULL),
     m_handle (0)
 {
-    RT_ZERO(m_critsect);
+    for (unsigned i = 0; i < RT_ELEMENTS(m_apFreeMsgs); i++)
+    {
+        m_apFreeMsgs[i] = NULL;
+        m_acFreeMsgs[i] = 0;
+    }
 }
 
 HGCMThread::~HGCMThread ()
@@ -231,9 +252,17 @@ HGCMThread::~HGCMThread ()
 
     Assert(m_fu32ThreadFlags & HGCMMSG_TF_TERMINATED);
 
-    if (RTCritSectIsInitialized (&m_critsect))
+    for (unsigned i = 0; i < RT_ELEMENTS(m_apFreeMsgs); i++)
     {
-        RTCritSectDelete (&m_critsect);
+        HGCMMsgCore *pMsg = m_apFreeMsgs[i];
+        m_apFreeMsgs[i] = NULL;
+
+        while (pMsg)
+        {
+            HGCMMsgCore *pNext = pMsg->m_pNext;
+            delete pMsg;
+            pMsg = pNext;
+        }
     }
 
     if (m_eventSend)
@@ -241,9 +270,9 @@ HGCMThread::~HGCMThread ()
         RTSemEventMultiDestroy (m_eventSend);
     }
 
-    if (m_eventThread)
+    if (m_eventThread != NIL_RTSEMEVENT)
     {
-        RTSemEventMultiDestroy (m_eventThread);
+        RTSemEventDestroy (m_eventThread);
     }
 
     return;
@@ -267,7 +296,7 @@ int HGCMThread::Initialize (HGCMTHREADHANDLE handle, const char *pszThreadName,
 {
     int rc = VINF_SUCCESS;
 
-    rc = RTSemEventMultiCreate (&m_eventThread);
+    rc = RTSemEventCreate (&m_eventThread);
 
     if (RT_SUCCESS(rc))
     {
@@ -275,39 +304,29 @@ int HGCMThread::Initialize (HGCMTHREADHANDLE handle, const char *pszThreadName,
 
         if (RT_SUCCESS(rc))
         {
-            rc = RTCritSectInit (&m_critsect);
+            m_pfnThread = pfnThread;
+            m_pvUser    = pvUser;
+            m_handle    = handle;
+
+            m_fu32ThreadFlags = HGCMMSG_TF_INITIALIZING;
+
+            RTTHREAD thread;
+            rc = RTThreadCreate (&thread, hgcmWorkerThreadFunc, this, 0, /* default stack size; some service
+                                                                            may need quite a bit */
+                                 RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE,
+                                 pszThreadName);
 
             if (RT_SUCCESS(rc))
             {
-                m_pfnThread = pfnThread;
-                m_pvUser    = pvUser;
-                m_handle    = handle;
-
-                m_fu32ThreadFlags = HGCMMSG_TF_INITIALIZING;
-
-                RTTHREAD thread;
-                rc = RTThreadCreate (&thread, hgcmWorkerThreadFunc, this, 0, /* default stack size; some service
-                                                                                may need quite a bit */
-                                     RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE,
-                                     pszThreadName);
-
-                if (RT_SUCCESS(rc))
-                {
-                    /* Wait until the thread is ready. */
-                    rc = RTThreadUserWait (thread, 30000);
-                    AssertRC(rc);
-                    Assert(!(m_fu32ThreadFlags & HGCMMSG_TF_INITIALIZING) || RT_FAILURE(rc));
-                }
-                else
-                {
-                    m_thread = NIL_RTTHREAD;
-                    Log(("hgcmThreadCreate: FAILURE: Can't start worker thread.\n"));
-                }
+                /* Wait until the thread is ready. */
+                rc = RTThreadUserWait (thread, 30000);
+                AssertRC(rc);
+                Assert(!(m_fu32ThreadFlags & HGCMMSG_TF_INITIALIZING) || RT_FAILURE(rc));
             }
             else
             {
-                Log(("hgcmThreadCreate: FAILURE: Can't init a critical section for a hgcm worker thread.\n"));
-                RT_ZERO(m_critsect);
+                m_thread = NIL_RTTHREAD;
+                Log(("hgcmThreadCreate: FAILURE: Can't start worker thread.\n"));
             }
         }
         else
@@ -319,39 +338,82 @@ int HGCMThread::Initialize (HGCMTHREADHANDLE handle, const char *pszThreadName,
     else
     {
         Log(("hgcmThreadCreate: FAILURE: Can't create an event semaphore for a hgcm worker thread.\n"));
-        m_eventThread = 0;
+        m_eventThread = NIL_RTSEMEVENT;
     }
 
     return rc;
 }
 
-inline int HGCMThread::Enter (void)
+HGCMMsgCore *HGCMThread::FetchFreeListHead (uint32_t u32MsgId)
 {
-    int rc = RTCritSectEnter (&m_critsect);
+    if (u32MsgId >= HGCM_MSG_FREE_LIST_IDS)
+    {
+        return NULL;
+    }
 
-#ifdef LOG_ENABLED
-    if (RT_FAILURE(rc))
+    /* Take the whole list, so nobody else can pop the head concurrently. */
+    HGCMMsgCore *pMsg = ASMAtomicXchgPtrT (&m_apFreeMsgs[u32MsgId], NULL, HGCMMsgCore *);
+
+    if (pMsg)
     {
-        Log(("HGCMThread::MsgPost: FAILURE: could not obtain worker thread mutex, rc = %Rrc!!!\n", rc));
+        ASMAtomicDecU32 (&m_acFreeMsgs[u32MsgId]);
+
+        /* Put the rest back, in front of anything freed meanwhile. */
+        HGCMMsgCore *pRest = pMsg->m_pNext;
+
+        if (pRest)
+        {
+            HGCMMsgCore *pLast = pRest;
+            while (pLast->m_pNext)
+            {
+                pLast = pLast->m_pNext;
+            }
+
+            HGCMMsgCore *pHead;
+            do
+            {
+                pHead = ASMAtomicReadPtrT (&m_apFreeMsgs[u32MsgId], HGCMMsgCore *);
+                pLast->m_pNext = pHead;
+            } while (!ASMAtomicCmpXchgPtr (&m_apFreeMsgs[u32MsgId], pRest, pHead));
+        }
+
+        pMsg->m_pNext = NULL;
     }
-#endif /* LOG_ENABLED */
 
-    return rc;
+    return pMsg;
 }
 
-inline void HGCMThread::Leave (void)
+bool HGCMThread::MsgFree (HGCMMsgCore *pMsg)
 {
-    RTCritSectLeave (&m_critsect);
-}
+    uint32_t u32MsgId = pMsg->m_u32Msg;
+
+    if (   u32MsgId >= HGCM_MSG_FREE_LIST_IDS
+        || (m_fu32ThreadFlags & HGCMMSG_TF_TERMINATED))
+    {
+        return false;
+    }
+
+    if (ASMAtomicIncU32 (&m_acFreeMsgs[u32MsgId]) > HGCM_MSG_FREE_LIST_MAX)
+    {
+        ASMAtomicDecU32 (&m_acFreeMsgs[u32MsgId]);
+        return false;
+    }
+
+    HGCMMsgCore *pHead;
+    do
+    {
+        pHead = ASMAtomicReadPtrT (&m_apFreeMsgs[u32MsgId], HGCMMsgCore *);
+        pMsg->m_pNext = pHead;
+    } while (!ASMAtomicCmpXchgPtr (&m_apFreeMsgs[u32MsgId], pMsg, pHead));
 
+    return true;
+}
 
 int HGCMThread::MsgAlloc (HGCMMSGHANDLE *pHandle, uint32_t u32MsgId, PFNHGCMNEWMSGALLOC pfnNewMessage)
 {
     int rc = VINF_SUCCESS;
 
-    HGCMMsgCore *pmsg = NULL;
-
-    bool fFromFreeList = false;
+    HGCMMsgCore *pmsg = FetchFreeListHead (u32MsgId);
 
     if (!pmsg && RT_SUCCESS(rc))
     {
@@ -378,12 +440,6 @@ int HGCMThread::MsgAlloc (HGCMMSGHANDLE *pHandle, uint32_t u32MsgId, PFNHGCMNEWM
          *  until the handle is deleted.
          */
         *pHandle = hgcmObjGenerateHandle (pmsg);
-
-        if (fFromFreeList)
-        {
-            /* Message was referenced in the free list, now dereference it. */
-            pmsg->Dereference ();
-        }
     }
 
     return rc;
@@ -395,71 +451,63 @@ int HGCMThread::MsgPost (HGCMMsgCore *pMsg, PHGCMMSGCALLBACK pfnCallback, bool f
 
     LogFlow(("HGCMThread::MsgPost: thread = %p, pMsg = %p, pfnCallback = %p\n", this, pMsg, pfnCallback));
 
-    rc = Enter ();
+    pMsg->m_pfnCallback = pfnCallback;
 
-    if (RT_SUCCESS(rc))
+    if (fWait)
     {
-        pMsg->m_pfnCallback = pfnCallback;
-
-        if (fWait)
-        {
-            pMsg->m_fu32Flags |= HGCM_MSG_F_WAIT;
-        }
-
-        /* Insert the message to the queue tail. */
-        pMsg->m_pNext = NULL;
-        pMsg->m_pPrev = m_pMsgInputQueueTail;
-
-        if (m_pMsgInputQueueTail)
-        {
-            m_pMsgInputQueueTail->m_pNext = pMsg;
-        }
-        else
-        {
-            m_pMsgInputQueueHead = pMsg;
-        }
-
-        m_pMsgInputQueueTail = pMsg;
-
-        Leave ();
+        pMsg->m_fu32Flags |= HGCM_MSG_F_WAIT;
+    }
 
+    /* Push the message to the pending list. The compare and exchange makes
+     * the message fields visible to the worker thread. */
+    HGCMMsgCore *pHead;
+    do
+    {
+        pHead = ASMAtomicReadPtrT (&m_pMsgInputPending, HGCMMsgCore *);
+        pMsg->m_pNext = pHead;
+    } while (!ASMAtomicCmpXchgPtr (&m_pMsgInputPending, pMsg, pHead));
+
+    /* Inform the worker thread that there is a message. If the list was not
+     * empty, the thread has been signalled already and will take this
+     * message together with the others. */
+    if (!pHead)
+    {
         LogFlow(("HGCMThread::MsgPost: going to inform the thread %p about message, fWait = %d\n", this, fWait));
 
-        /* Inform the worker thread that there is a message. */
-        RTSemEventMultiSignal (m_eventThread);
+        RTSemEventSignal (m_eventThread);
 
         LogFlow(("HGCMThread::MsgPost: event signalled\n"));
+    }
 
-        if (fWait)
+    if (fWait)
+    {
+        /* Immediately check if the message has been processed. */
+        while ((ASMAtomicReadU32 (&pMsg->m_fu32Flags) & HGCM_MSG_F_PROCESSED) == 0)
         {
-            /* Immediately check if the message has been processed. */
-            while ((pMsg->m_fu32Flags & HGCM_MSG_F_PROCESSED) == 0)
-            {
-                /* Poll infrequently to make sure no completed message has been missed. */
-                RTSemEventMultiWait (m_eventSend, 1000);
+            /* Poll infrequently to make sure no completed message has been missed. */
+            RTSemEventMultiWait (m_eventSend, 1000);
 
-                LogFlow(("HGCMThread::MsgPost: wait completed flags = %08X\n", pMsg->m_fu32Flags));
+            LogFlow(("HGCMThread::MsgPost: wait completed flags = %08X\n", pMsg->m_fu32Flags));
 
-                if ((pMsg->m_fu32Flags & HGCM_MSG_F_PROCESSED) == 0)
-                {
-                    RTThreadYield();
-                }
-            }
-
-            /* 'Our' message has been processed, so should reset the semaphore.
-             * There is still possible that another message has been processed
-             * and the semaphore has been signalled again.
-             * Reset only if there are no other messages completed.
-             */
-            int32_t c = ASMAtomicDecS32(&m_i32MessagesProcessed);
-            Assert(c >= 0);
-            if (c == 0)
+            if ((ASMAtomicReadU32 (&pMsg->m_fu32Flags) & HGCM_MSG_F_PROCESSED) == 0)
             {
-                RTSemEventMultiReset (m_eventSend);
+                RTThreadYield();
             }
+        }
 
-            rc = pMsg->m_rcSend;
+        /* 'Our' message has been processed, so should reset the semaphore.
+         * There is still possible that another message has been processed
+         * and the semaphore has been signalled again.
+         * Reset only if there are no other messages completed.
+         */
+        int32_t c = ASMAtomicDecS32(&m_i32MessagesProcessed);
+        Assert(c >= 0);
+        if (c == 0)
+        {
+            RTSemEventMultiReset (m_eventSend);
         }
+
+        rc = pMsg->m_rcSend;
     }
 
     LogFlow(("HGCMThread::MsgPost: rc = %Rrc\n", rc));
@@ -482,55 +530,32 @@ int HGCMThread::MsgGet (HGCMMsgCore **ppMsg)
             break;
         }
 
-        LogFlow(("MAIN::hgcmMsgGet: m_pMsgInputQueueHead = %p\n", m_pMsgInputQueueHead));
-
-        if (m_pMsgInputQueueHead)
+        if (!m_pMsgInputQueueHead)
         {
-            /* Move the message to the m_pMsgInProcessHead list */
-            rc = Enter ();
+            /* Take all pending messages at once and restore the posting order. */
+            HGCMMsgCore *pMsg = ASMAtomicXchgPtrT (&m_pMsgInputPending, NULL, HGCMMsgCore *);
 
-            if (RT_FAILURE(rc))
+            while (pMsg)
             {
-                break;
+                HGCMMsgCore *pNext = pMsg->m_pNext;
+                pMsg->m_pNext = m_pMsgInputQueueHead;
+                m_pMsgInputQueueHead = pMsg;
+                pMsg = pNext;
             }
+        }
 
-            HGCMMsgCore *pMsg = m_pMsgInputQueueHead;
-
-            /* Remove the message from the head of Queue list. */
-            Assert(m_pMsgInputQueueHead->m_pPrev == NULL);
-
-            if (m_pMsgInputQueueHead->m_pNext)
-            {
-                m_pMsgInputQueueHead = m_pMsgInputQueueHead->m_pNext;
-                m_pMsgInputQueueHead->m_pPrev = NULL;
-            }
-            else
-            {
-                Assert(m_pMsgInputQueueHead == m_pMsgInputQueueTail);
+        LogFlow(("MAIN::hgcmMsgGet: m_pMsgInputQueueHead = %p\n", m_pMsgInputQueueHead));
 
-                m_pMsgInputQueueHead = NULL;
-                m_pMsgInputQueueTail = NULL;
-            }
+        if (m_pMsgInputQueueHead)
+        {
+            /* Remove the message from the head of the batch. */
+            HGCMMsgCore *pMsg = m_pMsgInputQueueHead;
 
-            /* Insert the message to the tail of the m_pMsgInProcessHead list. */
+            m_pMsgInputQueueHead = pMsg->m_pNext;
             pMsg->m_pNext = NULL;
-            pMsg->m_pPrev = m_pMsgInProcessTail;
-
-            if (m_pMsgInProcessTail)
-            {
-                m_pMsgInProcessTail->m_pNext = pMsg;
-            }
-            else
-            {
-                m_pMsgInProcessHead = pMsg;
-            }
-
-            m_pMsgInProcessTail = pMsg;
 
             pMsg->m_fu32Flags |= HGCM_MSG_F_IN_PROCESS;
 
-            Leave ();
-
             /* Return the message to the caller. */
             *ppMsg = pMsg;
 
@@ -540,8 +565,7 @@ int HGCMThread::MsgGet (HGCMMsgCore **ppMsg)
         }
 
         /* Wait for an event. */
-        RTSemEventMultiWait (m_eventThread, RT_INDEFINITE_WAIT);
-        RTSemEventMultiReset (m_eventThread);
+        RTSemEventWait (m_eventThread, RT_INDEFINITE_WAIT);
     }
 
     LogFlow(("HGCMThread::MsgGet: *ppMsg = %p, return rc = %Rrc\n", *ppMsg, rc));
@@ -553,8 +577,6 @@ void HGCMThread::MsgComplete (HGCMMsgCore *pMsg, int32_t result)
 {
     LogFlow(("HGCMThread::MsgComplete: thread = %p, pMsg = %p\n", this, pMsg));
 
-    int rc = VINF_SUCCESS;
-
     AssertRelease(pMsg->m_pThread == this);
     AssertReleaseMsg((pMsg->m_fu32Flags & HGCM_MSG_F_IN_PROCESS) != 0, ("%p %x\n", pMsg, pMsg->m_fu32Flags));
 
@@ -569,57 +591,29 @@ void HGCMThread::MsgComplete (HGCMMsgCore *pMsg, int32_t result)
 
     /* Message processing has been completed. */
 
-    rc = Enter ();
+    bool fWaited = ((pMsg->m_fu32Flags & HGCM_MSG_F_WAIT) != 0);
 
-    if (RT_SUCCESS(rc))
+    if (fWaited)
     {
-        /* Remove the message from the InProcess queue. */
-
-        if (pMsg->m_pNext)
-        {
-            pMsg->m_pNext->m_pPrev = pMsg->m_pPrev;
-        }
-        else
-        {
-            m_pMsgInProcessTail = pMsg->m_pPrev;
-        }
-
-        if (pMsg->m_pPrev)
-        {
-            pMsg->m_pPrev->m_pNext = pMsg->m_pNext;
-        }
-        else
-        {
-            m_pMsgInProcessHead = pMsg->m_pNext;
-        }
-
-        pMsg->m_pNext = NULL;
-        pMsg->m_pPrev = NULL;
-
-        bool fWaited = ((pMsg->m_fu32Flags & HGCM_MSG_F_WAIT) != 0);
+        ASMAtomicIncS32(&m_i32MessagesProcessed);
 
-        if (fWaited)
-        {
-            ASMAtomicIncS32(&m_i32MessagesProcessed);
-
-            /* This should be done before setting the HGCM_MSG_F_PROCESSED flag. */
-            pMsg->m_rcSend = result;
-        }
-
-        /* The message is now completed. */
-        pMsg->m_fu32Flags &= ~HGCM_MSG_F_IN_PROCESS;
-        pMsg->m_fu32Flags &= ~HGCM_MSG_F_WAIT;
-        pMsg->m_fu32Flags |= HGCM_MSG_F_PROCESSED;
+        /* This should be done before setting the HGCM_MSG_F_PROCESSED flag. */
+        pMsg->m_rcSend = result;
+    }
 
-        hgcmObjDeleteHandle (pMsg->Handle ());
+    /* The message is now completed. The sender keeps a reference to a
+     * waited message until it has fetched the result. */
+    uint32_t fu32Flags = pMsg->m_fu32Flags;
+    fu32Flags &= ~(HGCM_MSG_F_IN_PROCESS | HGCM_MSG_F_WAIT);
+    fu32Flags |= HGCM_MSG_F_PROCESSED;
+    ASMAtomicWriteU32 (&pMsg->m_fu32Flags, fu32Flags);
 
-        Leave ();
+    hgcmObjDeleteHandle (pMsg->Handle ());
 
-        if (fWaited)
-        {
-            /* Wake up all waiters. so they can decide if their message has been processed. */
-            RTSemEventMultiSignal (m_eventSend);
-        }
+    if (fWaited)
+    {
+        /* Wake up all waiters. so they can decide if their message has been processed. */
+        RTSemEventMultiSignal (m_eventSend);
     }
 
     return;
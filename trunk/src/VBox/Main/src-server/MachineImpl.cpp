@@ -9835,6 +9835,7 @@ HRESULT Machine::i_prepareSaveSettings(bool *pfNeedsGlobalSaveSettings)
             mData->m_strConfigFileFull = newConfigFile;
             // compute the relative path too
             mParent->i_copyPathRelativeToConfig(newConfigFile, mData->m_strConfigFile);
+            mParent->i_updateMachineIndex(this);
 
             // store the old and new so that VirtualBox::i_saveSettings() can update
             // the media registry
@@ -11853,6 +11854,10 @@ void Machine::i_commit()
      */
     mUserData.commitCopy();
 
+    /* the machine name might have changed, keep the lookup index in sync */
+    if (!i_isSnapshotMachine())
+        mParent->i_updateMachineIndex(this);
+
     mHWData.commit();
 
     if (mMediaData.isBackedUp())
@@ -1756,7 +1756,7 @@ HRESULT Medium::setDescription(const com::Utf8Str &aDescription)
 
         // save the settings
         i_markRegistriesModified();
-        m->pVirtualBox->i_saveModifiedRegistries();
+        m->pVirtualBox->i_saveModifiedRegistries(true /* fSync */);
     }
     catch (HRESULT aRC) { rc = aRC; }
 
@@ -1990,7 +1990,7 @@ HRESULT Medium::setType(AutoCaller &autoCaller, MediumType_T aType)
     mlock.release();
     treeLock.release();
     i_markRegistriesModified();
-    m->pVirtualBox->i_saveModifiedRegistries();
+    m->pVirtualBox->i_saveModifiedRegistries(true /* fSync */);
 
     return S_OK;
 }
@@ -2101,7 +2101,7 @@ HRESULT Medium::setAutoReset(BOOL aAutoReset)
         // save the settings
         mlock.release();
         i_markRegistriesModified();
-        m->pVirtualBox->i_saveModifiedRegistries();
+        m->pVirtualBox->i_saveModifiedRegistries(true /* fSync */);
     }
 
     return S_OK;
@@ -2472,7 +2472,7 @@ HRESULT Medium::close(AutoCaller &aAutoCaller)
 
     MultiResult mrc = i_close(aAutoCaller);
 
-    pVirtualBox->i_saveModifiedRegistries();
+    pVirtualBox->i_saveModifiedRegistries(true /* fSync */);
 
     return mrc;
 }
@@ -2541,7 +2541,7 @@ HRESULT Medium::setProperty(const com::Utf8Str &aName,
     // save the settings
     mlock.release();
     i_markRegistriesModified();
-    m->pVirtualBox->i_saveModifiedRegistries();
+    m->pVirtualBox->i_saveModifiedRegistries(true /* fSync */);
 
     return S_OK;
 }
@@ -2620,7 +2620,7 @@ HRESULT Medium::setProperties(const std::vector<com::Utf8Str> &aNames,
     // save the settings
     mlock.release();
     i_markRegistriesModified();
-    m->pVirtualBox->i_saveModifiedRegistries();
+    m->pVirtualBox->i_saveModifiedRegistries(true /* fSync */);
 
     return S_OK;
 }
@@ -8983,7 +8983,12 @@ HRESULT Medium::i_taskMoveHandler(Medium::MoveTask &task)
                  * also reset moving flag
                  */
                 i_resetMoveOperationData();
-                m->strLocationFull = targetLocation;
+                {
+                    AutoWriteLock treeLock(m->pVirtualBox->i_getMediaTreeLockHandle() COMMA_LOCKVAL_SRC_POS);
+                    Utf8Str strOldLocation = m->strLocationFull;
+                    m->strLocationFull = targetLocation;
+                    m->pVirtualBox->i_updateMediumLocation(this, m->devType, strOldLocation, targetLocation);
+                }
 
             }
             catch (HRESULT aRC) { rcOut = aRC; }
@@ -35,9 +35,11 @@
 #include <VBox/com/ptr.h>
 #include <VBox/com/string.h>
 #include <VBox/err.h>
+#include <iprt/asm.h>
 #include <iprt/string.h>
 #include <iprt/mem.h>
 #include <iprt/cpuset.h>
+#include <iprt/time.h>
 
 #include <algorithm>
 
@@ -227,7 +229,8 @@ CollectorGuest::CollectorGuest(Machine *machine, RTPROCESS process) :
     mUnregistered(false), mEnabled(false), mValid(false), mMachine(machine), mProcess(process),
     mCpuUser(0), mCpuKernel(0), mCpuIdle(0),
     mMemTotal(0), mMemFree(0), mMemBalloon(0), mMemShared(0), mMemCache(0), mPageTotal(0),
-    mAllocVMM(0), mFreeVMM(0), mBalloonedVMM(0), mSharedVMM(0), mVmNetRx(0), mVmNetTx(0)
+    mAllocVMM(0), mFreeVMM(0), mBalloonedVMM(0), mSharedVMM(0), mVmNetRx(0), mVmNetTx(0),
+    mcRingPolled(0)
 {
     Assert(mMachine);
     /* cannot use ComObjPtr<Machine> in Performance.h, do it manually */
@@ -314,6 +317,20 @@ HRESULT CollectorGuest::enableInternal(ULONG mask)
             Log7(("{%p} " LOG_FN_FMT ": Set guest statistics update interval to 1 sec (%s)\n",
                   this, __PRETTY_FUNCTION__, SUCCEEDED(ret) ? "success" : "failed"));
         }
+        /*
+         * The VM has created its statistics ring by now. Once we say we
+         * read it the VM stops calling ReportVmStatistics and the samples
+         * are only looked at when somebody queries the metrics. If there
+         * is no ring we keep getting the statistics the old way.
+         */
+        if (!mRing.isOpen())
+        {
+            int vrc = mRing.open(mProcess);
+            Log7(("{%p} " LOG_FN_FMT ": Opening VM statistics ring -> %Rrc\n",
+                  this, __PRETTY_FUNCTION__, vrc));
+            NOREF(vrc);
+        }
+        mRing.setReaderAttached(true);
     }
     if ((mask & VMSTATS_VMM_RAM) == VMSTATS_VMM_RAM)
         enableVMMStats(true);
@@ -333,6 +350,8 @@ int CollectorGuest::disableInternal(ULONG mask)
     if (!mEnabled)
     {
         Assert(mGuest && mConsole);
+        /* The mapping stays, metrics may still be querying older samples. */
+        mRing.setReaderAttached(false);
         HRESULT ret = mGuest->COMSETTER(StatisticsUpdateInterval)(0 /* off */);
         NOREF(ret);
         Log7(("{%p} " LOG_FN_FMT ": Set guest statistics update interval to 0 sec (%s)\n",
@@ -394,12 +413,61 @@ void CollectorGuest::updateStats(ULONG aValidStats, ULONG aCpuUser,
     mValid = aValidStats;
 }
 
+/**
+ * Copies the VM statistics sample number *piSample, or the oldest one left if
+ * the VM has overwritten it already, and advances *piSample past it.
+ *
+ * @returns false if there are no more samples.
+ */
+bool CollectorGuest::readSample(uint32_t *piSample, VMSTATSRINGSAMPLE *pSample)
+{
+    uint32_t iOldest = mRing.getOldest();
+    if ((int32_t)(*piSample - iOldest) < 0)
+        *piSample = iOldest;
+    while ((int32_t)(*piSample - mRing.getPushed()) < 0)
+        if (mRing.read((*piSample)++, pSample))
+            return true;
+    return false;
+}
+
+/**
+ * Picks up the VMM statistics from the newest sample in the ring, HostRamVmm
+ * wants the current values on each of its collections.
+ */
+void CollectorGuest::pollVMMStats()
+{
+    uint32_t cPushed = mRing.getPushed();
+    if (cPushed == mcRingPolled)
+        return;
+
+    VMSTATSRINGSAMPLE sample;
+    if (   mRing.read(cPushed - 1, &sample)
+        && (sample.fValid & VMSTATS_VMM_RAM) == VMSTATS_VMM_RAM)
+    {
+        mAllocVMM     = sample.au32Values[VMSTATSRINGVALUE_ALLOCVMM];
+        mFreeVMM      = sample.au32Values[VMSTATSRINGVALUE_FREEVMM];
+        mBalloonedVMM = sample.au32Values[VMSTATSRINGVALUE_BALLOONEDVMM];
+        mSharedVMM    = sample.au32Values[VMSTATSRINGVALUE_SHAREDVMM];
+        mValid |= VMSTATS_VMM_RAM;
+    }
+    mcRingPolled = cPushed;
+}
+
+ComPtr<IUnknown> CollectorGuest::getObject()
+{
+    /* The same object the machine metrics are registered for. */
+    return ComPtr<IUnknown>(mMachine);
+}
+
 CollectorGuestManager::CollectorGuestManager()
-  : mVMMStatsProvider(NULL), mGuestBeingCalled(NULL)
+  : mVMMStatsProvider(NULL), mGuestBeingCalled(NULL), mcCallsDone(0),
+    mCallDone(NIL_RTSEMEVENTMULTI)
 {
-    int rc = RTThreadCreate(&mThread, CollectorGuestManager::requestProcessingThread,
-                            this, 0, RTTHREADTYPE_MAIN_WORKER, RTTHREADFLAGS_WAITABLE,
-                            "CGMgr");
+    int rc = RTSemEventMultiCreate(&mCallDone);
+    AssertRC(rc);
+    rc = RTThreadCreate(&mThread, CollectorGuestManager::requestProcessingThread,
+                        this, 0, RTTHREADTYPE_MAIN_WORKER, RTTHREADFLAGS_WAITABLE,
+                        "CGMgr");
     NOREF(rc);
     Log7(("{%p} " LOG_FN_FMT ": RTThreadCreate returned %Rrc (mThread=%p)\n", this, __PRETTY_FUNCTION__, rc, mThread));
 }
@@ -416,6 +484,7 @@ CollectorGuestManager::~CollectorGuestManager()
         rc = RTThreadWait(mThread, 1000 /* 1 sec */, &rcThread);
         Log7(("{%p} " LOG_FN_FMT ": RTThreadWait returned %u (thread exit code: %u)\n", this, __PRETTY_FUNCTION__, rc, rcThread));
     }
+    RTSemEventMultiDestroy(mCallDone);
 }
 
 void CollectorGuestManager::registerGuest(CollectorGuest* pGuest)
@@ -514,18 +583,28 @@ int CollectorGuestManager::enqueueRequest(CollectorGuestRequest *aRequest)
      * guests. If the guest has not finished processing the previous request
      * after half a second we consider it blocked.
      */
+    uint32_t const cCallsDone = ASMAtomicReadU32(&mcCallsDone);
     if (aRequest->getGuest() && aRequest->getGuest() == mGuestBeingCalled)
     {
         /*
          * Before we can declare a guest blocked we need to wait for a while
          * and then check again as it may never had a chance to process
          * the previous request. Half a second is an eternity for processes
-         * and is barely noticable by humans.
+         * and is barely noticable by humans. The processing thread signals
+         * the end of each call, so a guest which is merely slow does not
+         * cost us the full half second. The guest is only considered stalled
+         * if the very call we found in progress has not finished yet; the
+         * thread may well be busy with the next request for the same guest
+         * by the time we look again, which is fine.
          */
-        Log7(("{%p} " LOG_FN_FMT ": Suspecting %s is stalled. Waiting for .5 sec...\n",
+        Log7(("{%p} " LOG_FN_FMT ": Suspecting %s is stalled. Waiting for up to .5 sec...\n",
               this, __PRETTY_FUNCTION__, aRequest->getGuest()->getVMName().c_str()));
-        RTThreadSleep(500 /* ms */);
-        if (aRequest->getGuest() == mGuestBeingCalled) {
+        uint64_t const u64Deadline = RTTimeMilliTS() + 500 /* ms */;
+        uint64_t u64Now;
+        while (   ASMAtomicReadU32(&mcCallsDone) == cCallsDone
+               && (u64Now = RTTimeMilliTS()) < u64Deadline)
+            RTSemEventMultiWait(mCallDone, (RTMSINTERVAL)(u64Deadline - u64Now));
+        if (ASMAtomicReadU32(&mcCallsDone) == cCallsDone) {
             Log7(("{%p} " LOG_FN_FMT ": Request processing stalled for %s\n",
                   this, __PRETTY_FUNCTION__, aRequest->getGuest()->getVMName().c_str()));
             /* Request execution got stalled for this guest -- report an error */
@@ -550,9 +629,12 @@ DECLCALLBACK(int) CollectorGuestManager::requestProcessingThread(RTTHREAD /* aTh
 #ifdef DEBUG
         pReq->debugPrint(mgr, __PRETTY_FUNCTION__, "is being executed...");
 #endif /* DEBUG */
+        RTSemEventMultiReset(mgr->mCallDone);
         mgr->mGuestBeingCalled = pReq->getGuest();
         rc = pReq->execute();
         mgr->mGuestBeingCalled = NULL;
+        ASMAtomicIncU32(&mgr->mcCallsDone);
+        RTSemEventMultiSignal(mgr->mCallDone);
         delete pReq;
         if (rc == E_ABORT)
             break;
@@ -955,6 +1037,8 @@ void HostRamVmm::collect()
     CollectorGuest *provider = mCollectorGuestManager->getVMMStatsProvider();
     if (provider)
     {
+        if (provider->hasRing())
+            provider->pollVMMStats();
         Log7(("{%p} " LOG_FN_FMT ": provider=%p enabled=%RTbool valid=%RTbool...\n",
               this, __PRETTY_FUNCTION__, provider, provider->isEnabled(), provider->isValid(VMSTATS_VMM_RAM) ));
         if (provider->isValid(VMSTATS_VMM_RAM))
@@ -1094,6 +1178,23 @@ void MachineDiskUsage::collect()
     mUsed->put(used);
 }
 
+void BaseGuestMetric::sync()
+{
+    if (!isEnabled() || !mLength || !mCGuest->hasRing())
+        return;
+
+    VMSTATSRINGSAMPLE sample;
+    while (mCGuest->readSample(&mRingNext, &sample))
+    {
+        /* The VM pushes a sample every second, keep only one per period. */
+        if (   mRingLastTimestamp
+            && sample.i64Timestamp - mRingLastTimestamp + (int64_t)PM_SAMPLER_PRECISION_MS < (int64_t)mPeriod * 1000)
+            continue;
+        if (putSample(sample))
+            mRingLastTimestamp = sample.i64Timestamp;
+    }
+}
+
 void MachineNetRate::init(ULONG period, ULONG length)
 {
     mPeriod = period;
@@ -1113,6 +1214,15 @@ void MachineNetRate::collect()
     }
 }
 
+bool MachineNetRate::putSample(const VMSTATSRINGSAMPLE &aSample)
+{
+    if ((aSample.fValid & VMSTATS_NET_RATE) != VMSTATS_NET_RATE)
+        return false;
+    mRx->put(aSample.au32Values[VMSTATSRINGVALUE_NETRX]);
+    mTx->put(aSample.au32Values[VMSTATSRINGVALUE_NETTX]);
+    return true;
+}
+
 int MachineNetRate::enable()
 {
     int rc = mCGuest->enable(VMSTATS_NET_RATE);
@@ -1157,6 +1267,16 @@ void GuestCpuLoad::collect()
     }
 }
 
+bool GuestCpuLoad::putSample(const VMSTATSRINGSAMPLE &aSample)
+{
+    if ((aSample.fValid & VMSTATS_GUEST_CPULOAD) != VMSTATS_GUEST_CPULOAD)
+        return false;
+    mUser->put((ULONG)(PM_CPU_LOAD_MULTIPLIER * aSample.au32Values[VMSTATSRINGVALUE_CPUUSER]) / 100);
+    mKernel->put((ULONG)(PM_CPU_LOAD_MULTIPLIER * aSample.au32Values[VMSTATSRINGVALUE_CPUKERNEL]) / 100);
+    mIdle->put((ULONG)(PM_CPU_LOAD_MULTIPLIER * aSample.au32Values[VMSTATSRINGVALUE_CPUIDLE]) / 100);
+    return true;
+}
+
 int GuestCpuLoad::enable()
 {
     int rc = mCGuest->enable(VMSTATS_GUEST_CPULOAD);
@@ -1197,6 +1317,19 @@ void GuestRamUsage::collect()
     }
 }
 
+bool GuestRamUsage::putSample(const VMSTATSRINGSAMPLE &aSample)
+{
+    if ((aSample.fValid & VMSTATS_GUEST_RAMUSAGE) != VMSTATS_GUEST_RAMUSAGE)
+        return false;
+    mTotal->put(aSample.au32Values[VMSTATSRINGVALUE_MEMTOTAL]);
+    mFree->put(aSample.au32Values[VMSTATSRINGVALUE_MEMFREE]);
+    mBallooned->put(aSample.au32Values[VMSTATSRINGVALUE_MEMBALLOON]);
+    mShared->put(aSample.au32Values[VMSTATSRINGVALUE_MEMSHARED]);
+    mCache->put(aSample.au32Values[VMSTATSRINGVALUE_MEMCACHE]);
+    mPagedTotal->put(aSample.au32Values[VMSTATSRINGVALUE_PAGETOTAL]);
+    return true;
+}
+
 int GuestRamUsage::enable()
 {
     int rc = mCGuest->enable(VMSTATS_GUEST_RAMUSAGE);
@@ -1267,35 +1400,26 @@ void SubMetric::query(ULONG *data)
     copyTo(data);
 }
 
-void Metric::query(ULONG **data, ULONG *count, ULONG *sequenceNumber)
+ULONG Metric::query(ULONG *data, std::vector<ULONG> &scratch, ULONG *sequenceNumber)
 {
-    ULONG length;
-    ULONG *tmpData;
-
-    length = mSubMetric->length();
+    mBaseMetric->sync();
+    ULONG length = mSubMetric->length();
     *sequenceNumber = mSubMetric->getSequenceNumber() - length;
-    if (length)
-    {
-        tmpData = (ULONG*)RTMemAlloc(sizeof(*tmpData)*length);
-        mSubMetric->query(tmpData);
-        if (mAggregate)
-        {
-            *count = 1;
-            *data  = (ULONG*)RTMemAlloc(sizeof(**data));
-            **data = mAggregate->compute(tmpData, length);
-            RTMemFree(tmpData);
-        }
-        else
-        {
-            *count = length;
-            *data  = tmpData;
-        }
-    }
-    else
+    if (!length)
+        return 0;
+
+    if (mAggregate)
     {
-        *count = 0;
-        *data  = 0;
+        /* Aggregates are computed on demand, the samples are not kept twice. */
+        if (scratch.size() < length)
+            scratch.resize(length);
+        mSubMetric->query(&scratch.front());
+        *data = mAggregate->compute(&scratch.front(), length);
+        return 1;
     }
+
+    mSubMetric->query(data);
+    return length;
 }
 
 ULONG AggregateAvg::compute(ULONG *data, ULONG length)
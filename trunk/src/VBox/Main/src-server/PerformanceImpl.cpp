@@ -470,7 +470,9 @@ HRESULT PerformanceCollector::queryMetricsData(const std::vector<com::Utf8Str> &
 {
     pm::Filter filter(aMetricNames, aObjects);
 
-    AutoReadLock alock(this COMMA_LOCKVAL_SRC_POS);
+    /* Guest metrics store the samples the VM pushed since the last query
+     * when queried, so this modifies the metrics just like the sampler. */
+    AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
 
     /* Let's compute the size of the resulting flat array */
     size_t flatSize = 0;
@@ -495,15 +497,16 @@ HRESULT PerformanceCollector::queryMetricsData(const std::vector<com::Utf8Str> &
     aReturnDataLengths.resize(numberOfMetrics);
     aReturnData.resize(flatSize);
 
+    /* The values are copied straight out of the sample buffers, aggregates
+     * are computed in a scratch buffer shared by all the metrics. */
+    std::vector<ULONG> scratch;
     for (it = filteredMetrics.begin(); it != filteredMetrics.end(); ++it, ++i)
     {
-        ULONG *values, length, sequenceNumber;
-        /** @todo We may want to revise the query method to get rid of excessive alloc/memcpy calls. */
-        (*it)->query(&values, &length, &sequenceNumber);
+        ULONG length, sequenceNumber;
+        ULONG *values = flatSize ? (ULONG *)&aReturnData.front() + flatIndex : NULL;
+        length = (*it)->query(values, scratch, &sequenceNumber);
         LogFlow(("PerformanceCollector::QueryMetricsData() querying metric %s returned %d values.\n",
                  (*it)->getName(), length));
-        memcpy(&aReturnData[flatIndex], values, length * sizeof(*values));
-        RTMemFree(values);
         aReturnMetricNames[i] = (*it)->getName();
         aReturnObjects[i] = (*it)->getObject();
         aReturnUnits[i] = (*it)->getUnit();
@@ -517,6 +520,77 @@ HRESULT PerformanceCollector::queryMetricsData(const std::vector<com::Utf8Str> &
     return S_OK;
 }
 
+/** Names and VMSTATMASK bits of the values in a VM statistics sample, in
+ * pm::VMSTATSRINGVALUE order. */
+static const struct
+{
+    const char *pszName;
+    ULONG       fMask;
+} g_aVmStatsValues[pm::VMSTATSRINGVALUE_MAX] =
+{
+    { "Guest/CPU/Load/User",        pm::VMSTATMASK_GUEST_CPUUSER },
+    { "Guest/CPU/Load/Kernel",      pm::VMSTATMASK_GUEST_CPUKERNEL },
+    { "Guest/CPU/Load/Idle",        pm::VMSTATMASK_GUEST_CPUIDLE },
+    { "Guest/RAM/Usage/Total",      pm::VMSTATMASK_GUEST_MEMTOTAL },
+    { "Guest/RAM/Usage/Free",       pm::VMSTATMASK_GUEST_MEMFREE },
+    { "Guest/RAM/Usage/Balloon",    pm::VMSTATMASK_GUEST_MEMBALLOON },
+    { "Guest/RAM/Usage/Shared",     pm::VMSTATMASK_GUEST_MEMSHARED },
+    { "Guest/RAM/Usage/Cache",      pm::VMSTATMASK_GUEST_MEMCACHE },
+    { "Guest/Pagefile/Usage/Total", pm::VMSTATMASK_GUEST_PAGETOTAL },
+    { "RAM/VMM/Used",               pm::VMSTATMASK_VMM_ALLOC },
+    { "RAM/VMM/Free",               pm::VMSTATMASK_VMM_FREE },
+    { "RAM/VMM/Ballooned",          pm::VMSTATMASK_VMM_BALOON },
+    { "RAM/VMM/Shared",             pm::VMSTATMASK_VMM_SHARED },
+    { "Net/Rate/Rx",                pm::VMSTATMASK_NET_RX },
+    { "Net/Rate/Tx",                pm::VMSTATMASK_NET_TX },
+};
+
+HRESULT PerformanceCollector::queryVmStatistics(const std::vector<ComPtr<IUnknown> > &aObjects,
+                                                LONG64 aSince,
+                                                std::vector<com::Utf8Str> &aReturnNames,
+                                                std::vector<ComPtr<IUnknown> > &aReturnObjects,
+                                                std::vector<LONG64> &aReturnTimestamps,
+                                                std::vector<ULONG> &aReturnData)
+{
+    pm::Filter filter(std::vector<com::Utf8Str>(), aObjects);
+
+    aReturnNames.resize(pm::VMSTATSRINGVALUE_MAX);
+    for (size_t i = 0; i < pm::VMSTATSRINGVALUE_MAX; ++i)
+        aReturnNames[i] = g_aVmStatsValues[i].pszName;
+    aReturnObjects.clear();
+    aReturnTimestamps.clear();
+    aReturnData.clear();
+
+    /* Reading the rings does not touch the guest collectors, the lock only
+     * keeps them from going away. */
+    AutoReadLock alock(this COMMA_LOCKVAL_SRC_POS);
+
+    const pm::CollectorGuestList &guests = m.gm->getGuests();
+    for (pm::CollectorGuestList::const_iterator it = guests.begin(); it != guests.end(); ++it)
+    {
+        pm::CollectorGuest *pGuest = *it;
+        if (pGuest->isUnregistered() || !pGuest->hasRing())
+            continue;
+        ComPtr<IUnknown> object = pGuest->getObject();
+        if (!filter.match(object, "*"))
+            continue;
+
+        pm::VMSTATSRINGSAMPLE sample;
+        uint32_t iSample = 0;
+        while (pGuest->readSample(&iSample, &sample))
+        {
+            if (sample.i64Timestamp <= aSince)
+                continue;
+            aReturnObjects.push_back(object);
+            aReturnTimestamps.push_back(sample.i64Timestamp);
+            for (size_t i = 0; i < pm::VMSTATSRINGVALUE_MAX; ++i)
+                aReturnData.push_back((sample.fValid & g_aVmStatsValues[i].fMask) ? sample.au32Values[i] : UINT32_MAX);
+        }
+    }
+
+    return S_OK;
+}
+
 // public methods for internal purposes
 ///////////////////////////////////////////////////////////////////////////////
 
@@ -661,6 +735,8 @@ DECLCALLBACK(void) PerformanceCollector::staticSamplerCallback(RTTIMERLR hTimerL
  *    Metrics that are collected individually get collected and stored. Values
  *    saved in HAL and CollectorGuestManager are extracted and stored to
  *    individual metrics.
+ * Guest metrics of VMs that share a statistics ring with us have nothing to
+ * do here, they pick up the samples from the ring in queryMetricsData().
  */
 void PerformanceCollector::samplerCallback(uint64_t iTick)
 {
@@ -669,9 +745,11 @@ void PerformanceCollector::samplerCallback(uint64_t iTick)
 
     pm::CollectorHints hints;
     uint64_t timestamp = RTTimeMilliTS();
-    BaseMetricList toBeCollected;
+    std::vector<pm::BaseMetric*> toBeCollected;
     BaseMetricList::iterator it;
-    /* Compose the list of metrics being collected at this moment */
+    /* Compose the list of metrics being collected at this moment, a vector
+     * costs a single allocation per tick no matter how many VMs we watch. */
+    toBeCollected.reserve(m.baseMetrics.size());
     for (it = m.baseMetrics.begin(); it != m.baseMetrics.end(); ++it)
         if ((*it)->collectorBeat(timestamp))
         {
@@ -679,7 +757,7 @@ void PerformanceCollector::samplerCallback(uint64_t iTick)
             toBeCollected.push_back(*it);
         }
 
-    if (toBeCollected.size() == 0)
+    if (toBeCollected.empty())
     {
         Log4(("{%p} " LOG_FN_FMT ": LEAVE (nothing to collect)\n", this, __PRETTY_FUNCTION__));
         return;
@@ -700,7 +778,9 @@ void PerformanceCollector::samplerCallback(uint64_t iTick)
      * Those should be destroyed now.
      */
     Log7(("{%p} " LOG_FN_FMT ": before remove_if: toBeCollected.size()=%d\n", this, __PRETTY_FUNCTION__, toBeCollected.size()));
-    toBeCollected.remove_if(std::mem_fun(&pm::BaseMetric::isUnregistered));
+    toBeCollected.erase(std::remove_if(toBeCollected.begin(), toBeCollected.end(),
+                                       std::mem_fun(&pm::BaseMetric::isUnregistered)),
+                        toBeCollected.end());
     Log7(("{%p} " LOG_FN_FMT ": after remove_if: toBeCollected.size()=%d\n", this, __PRETTY_FUNCTION__, toBeCollected.size()));
     Log7(("{%p} " LOG_FN_FMT ": before remove_if: m.baseMetrics.size()=%d\n", this, __PRETTY_FUNCTION__, m.baseMetrics.size()));
     for (it = m.baseMetrics.begin(); it != m.baseMetrics.end();)
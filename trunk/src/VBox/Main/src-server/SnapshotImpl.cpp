@@ -2594,10 +2594,192 @@ struct MediumDeleteRec
     /* these are for reattaching the hard disk in case of a failure: */
     Guid mMachineId;
     Guid mSnapshotId;
+    /** progress of the merge if it was done concurrently with others by
+     * deleteSnapshotMergeIndependent(), holds its result */
+    ComObjPtr<Progress> mpMergeProgress;
 };
 
 typedef std::list<MediumDeleteRec> MediumDeleteRecList;
 
+/**
+ * Task for deleteSnapshotMergeIndependent(), merges the medium of one record
+ * on a thread of its own and reports the result through its progress object.
+ */
+class DeleteSnapshotMergeTask : public ThreadTask
+{
+public:
+    DeleteSnapshotMergeTask(const MediumDeleteRec &aRec,
+                            Progress *aProgress)
+        : ThreadTask("DelSnapMerge"),
+          mRec(aRec),
+          mpProgress(aProgress)
+    {}
+
+private:
+    void handler()
+    {
+        HRESULT rc = E_FAIL;
+        try
+        {
+            // synchronous merge, leaves the lock list and the uninit of the
+            // source to SessionMachine::deleteSnapshotHandler() as usual
+            rc = mRec.mpSource->i_mergeTo(mRec.mpTarget,
+                                          mRec.mfMergeForward,
+                                          mRec.mpParentForTarget,
+                                          mRec.mpChildrenToReparent,
+                                          mRec.mpMediumLockList,
+                                          &mpProgress,
+                                          true /* aWait */);
+        }
+        catch(...)
+        {
+            LogRel(("Some exception in the function i_mergeTo()\n"));
+        }
+        mpProgress->i_notifyComplete(rc);
+    }
+
+    /** copy of the record, the lock lists still belong to the original */
+    MediumDeleteRec mRec;
+    ComObjPtr<Progress> mpProgress;
+};
+
+/**
+ * Checks whether two merges would get in each other's way, i.e. whether a
+ * medium is in both lock lists and at least one of them writes to it. Media
+ * further up the chain which both merges only read are fine.
+ */
+static bool deleteSnapshotMergesOverlap(MediumLockList *pList1, MediumLockList *pList2)
+{
+    for (MediumLockList::Base::iterator it1 = pList1->GetBegin();
+         it1 != pList1->GetEnd();
+         ++it1)
+        for (MediumLockList::Base::iterator it2 = pList2->GetBegin();
+             it2 != pList2->GetEnd();
+             ++it2)
+            if (   it1->GetMedium() == it2->GetMedium()
+                && (it1->GetLockRequest() || it2->GetLockRequest()))
+                return true;
+    return false;
+}
+
+/**
+ * Helper for SessionMachine::deleteSnapshotHandler() which merges the media
+ * that do not depend on one another at the same time.
+ *
+ * Only offline merges are done here, and only for records whose lock lists
+ * do not overlap with the one of any other record. Each merge runs on its own
+ * thread with its own progress object, the progress of all of them goes into
+ * a single operation of @a pProgress. The merged records are moved to the
+ * front of @a toDelete and have MediumDeleteRec::mpMergeProgress set, the
+ * caller takes the result from there and does the rest of the work for them
+ * like for a merge of its own. If less than two merges are independent,
+ * nothing is done here.
+ *
+ * @param pVirtualBox   VirtualBox object for the progress objects.
+ * @param pInitiator    Initiator for the progress objects.
+ * @param pProgress     Progress object of the snapshot deletion.
+ * @param toDelete      Media of the snapshot.
+ */
+static void deleteSnapshotMergeIndependent(VirtualBox *pVirtualBox,
+                                           IUnknown *pInitiator,
+                                           Progress *pProgress,
+                                           MediumDeleteRecList &toDelete)
+{
+    std::vector<MediumDeleteRecList::iterator> vecMerges;
+    for (MediumDeleteRecList::iterator it = toDelete.begin();
+         it != toDelete.end();
+         ++it)
+    {
+        if (it->mpMediumLockList == NULL || it->mfNeedsOnlineMerge)
+            continue;
+
+        bool fIndependent = true;
+        for (MediumDeleteRecList::iterator it2 = toDelete.begin();
+             it2 != toDelete.end() && fIndependent;
+             ++it2)
+            if (   it2 != it
+                && it2->mpMediumLockList != NULL
+                && deleteSnapshotMergesOverlap(it->mpMediumLockList, it2->mpMediumLockList))
+                fIndependent = false;
+        if (fIndependent)
+            vecMerges.push_back(it);
+    }
+    if (vecMerges.size() < 2)
+        return;
+
+    // same weights as for merging one by one, so the total still adds up
+    std::vector<ULONG> vecWeights;
+    ULONG ulTotalWeight = 0;
+    for (size_t i = 0; i < vecMerges.size(); ++i)
+    {
+        AutoReadLock alock(vecMerges[i]->mpHD COMMA_LOCKVAL_SRC_POS);
+        ULONG ulWeight = (ULONG)(vecMerges[i]->mpHD->i_getSize() / _1M);
+        vecWeights.push_back(ulWeight);
+        ulTotalWeight += ulWeight;
+    }
+
+    pProgress->SetNextOperation(BstrFmt(SessionMachine::tr("Merging %u differencing images"),
+                                        (unsigned)vecMerges.size()).raw(),
+                                ulTotalWeight);
+
+    size_t cStarted = 0;
+    for (; cStarted < vecMerges.size(); ++cStarted)
+    {
+        MediumDeleteRecList::iterator it = vecMerges[cStarted];
+        Utf8Str strName;
+        {
+            AutoReadLock alock(it->mpHD COMMA_LOCKVAL_SRC_POS);
+            strName = it->mpHD->i_getName();
+        }
+
+        ComObjPtr<Progress> pMergeProgress;
+        pMergeProgress.createObject();
+        HRESULT rc = pMergeProgress->init(pVirtualBox, pInitiator,
+                                          Utf8StrFmt(SessionMachine::tr("Merging differencing image '%s'"),
+                                                     strName.c_str()),
+                                          FALSE /* aCancelable */);
+        if (SUCCEEDED(rc))
+        {
+            DeleteSnapshotMergeTask *pTask = new DeleteSnapshotMergeTask(*it, pMergeProgress);
+            rc = pTask->createThread();
+        }
+        // the records not started are merged one by one by the caller
+        if (FAILED(rc))
+            break;
+
+        it->mpMergeProgress = pMergeProgress;
+    }
+    for (size_t i = cStarted; i > 0; --i)
+        toDelete.splice(toDelete.begin(), toDelete, vecMerges[i - 1]);
+
+    // sum up the progress until all merges are done, weighing media below
+    // one MB like one MB so that they count at all
+    for (;;)
+    {
+        uint64_t uDone = 0;
+        uint64_t uTotal = 0;
+        Progress *pWaitFor = NULL;
+        for (size_t i = 0; i < cStarted; ++i)
+        {
+            const ComObjPtr<Progress> &pMergeProgress = vecMerges[i]->mpMergeProgress;
+            ULONG ulPercent = 0;
+            BOOL fCompleted = FALSE;
+            pMergeProgress->COMGETTER(Percent)(&ulPercent);
+            pMergeProgress->COMGETTER(Completed)(&fCompleted);
+            uDone  += (uint64_t)ulPercent * RT_MAX(vecWeights[i], 1);
+            uTotal += RT_MAX(vecWeights[i], 1);
+            if (!fCompleted)
+                pWaitFor = pMergeProgress;
+        }
+        if (uTotal)
+            pProgress->SetCurrentOperationProgress((ULONG)(uDone / uTotal));
+        if (!pWaitFor)
+            break;
+
+        pWaitFor->WaitForCompletion(100);
+    }
+}
+
 /**
  * Worker method for the delete snapshot thread created by
  * SessionMachine::DeleteSnapshot().  This method gets called indirectly
@@ -2956,12 +3138,29 @@ void SessionMachine::i_deleteSnapshotHandler(DeleteSnapshotTask &task)
         /* third pass: */
         LogFlowThisFunc(("3: Performing actual hard disk merging...\n"));
 
+        // Merge the media which do not depend on one another at the same
+        // time first. The loop below only does the rest of the work for them.
+        deleteSnapshotMergeIndependent(mParent, static_cast<IMachine *>(this),
+                                       task.m_pProgress, toDelete);
+
+        // The first of these merges which failed. The other ones may well
+        // have succeeded, so their attachments are still updated before
+        // reporting it, but nothing is merged any more.
+        ComObjPtr<Progress> pFailedMerge;
+
         /// @todo NEWMEDIA turn the following errors into warnings because the
         /// snapshot itself has been already deleted (and interpret these
         /// warnings properly on the GUI side)
         for (MediumDeleteRecList::iterator it = toDelete.begin();
              it != toDelete.end();)
         {
+            const ComObjPtr<Progress> pMergeProgress(it->mpMergeProgress);
+            if (!pFailedMerge.isNull() && pMergeProgress.isNull())
+            {
+                ++it;
+                continue;
+            }
+
             const ComObjPtr<Medium> &pMedium(it->mpHD);
             ULONG ulWeight;
 
@@ -2970,9 +3169,10 @@ void SessionMachine::i_deleteSnapshotHandler(DeleteSnapshotTask &task)
                 ulWeight = (ULONG)(pMedium->i_getSize() / _1M);
             }
 
-            task.m_pProgress->SetNextOperation(BstrFmt(tr("Merging differencing image '%s'"),
-                                               pMedium->i_getName().c_str()).raw(),
-                                               ulWeight);
+            if (pMergeProgress.isNull())
+                task.m_pProgress->SetNextOperation(BstrFmt(tr("Merging differencing image '%s'"),
+                                                   pMedium->i_getName().c_str()).raw(),
+                                                   ulWeight);
 
             bool fNeedSourceUninit = false;
             bool fReparentTarget = false;
@@ -3007,7 +3207,15 @@ void SessionMachine::i_deleteSnapshotHandler(DeleteSnapshotTask &task)
             else
             {
                 bool fNeedsSave = false;
-                if (it->mfNeedsOnlineMerge)
+                if (!pMergeProgress.isNull())
+                {
+                    // merged already, together with the independent media
+                    LONG iRc;
+                    rc = pMergeProgress->COMGETTER(ResultCode)(&iRc);
+                    if (SUCCEEDED(rc))
+                        rc = iRc;
+                }
+                else if (it->mfNeedsOnlineMerge)
                 {
                     // Put the medium merge information (MediumDeleteRec) where
                     // SessionMachine::FinishOnlineMergeMedium can get at it.
@@ -3048,14 +3256,20 @@ void SessionMachine::i_deleteSnapshotHandler(DeleteSnapshotTask &task)
                 if (FAILED(rc))
                 {
                     AutoReadLock mlock(it->mpSource COMMA_LOCKVAL_SRC_POS);
-                    if (!it->mpSource->i_isMediumFormatFile())
-                        // Diff medium not backed by a file - cannot get status so
-                        // be pessimistic.
-                        throw rc;
-                    const Utf8Str &loc = it->mpSource->i_getLocationFull();
-                    // Source medium is still there, so merge failed early.
-                    if (RTFileExists(loc.c_str()))
-                        throw rc;
+                    // Diff medium not backed by a file - cannot get status so
+                    // be pessimistic. Otherwise if the source medium is still
+                    // there, the merge failed early.
+                    if (   !it->mpSource->i_isMediumFormatFile()
+                        || RTFileExists(it->mpSource->i_getLocationFull().c_str()))
+                    {
+                        if (pMergeProgress.isNull())
+                            throw rc;
+                        // keep the record for cancelDeleteSnapshotMedium()
+                        if (pFailedMerge.isNull())
+                            pFailedMerge = pMergeProgress;
+                        ++it;
+                        continue;
+                    }
 
                     // Source medium is gone. Assume the merge succeeded and
                     // thus it's safe to remove the attachment. We use the
@@ -3143,9 +3357,19 @@ void SessionMachine::i_deleteSnapshotHandler(DeleteSnapshotTask &task)
             // Delayed failure exit when the merge cleanup failed but the
             // merge actually succeeded.
             if (FAILED(rc))
-                throw rc;
+            {
+                if (pMergeProgress.isNull())
+                    throw rc;
+                if (pFailedMerge.isNull())
+                    pFailedMerge = pMergeProgress;
+            }
         }
 
+        // If the thread of the progress object has an error, then
+        // retrieve the error info from there, or it'll be lost.
+        if (!pFailedMerge.isNull())
+            throw setError(ProgressErrorInfo(pFailedMerge));
+
         {
             // beginSnapshotDelete() needs the machine lock, and the snapshots
             // tree is protected by the machine lock as well
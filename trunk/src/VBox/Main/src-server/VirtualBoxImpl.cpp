@@ -25,10 +25,12 @@
 #include <iprt/path.h>
 #include <iprt/process.h>
 #include <iprt/rand.h>
+#include <iprt/semaphore.h>
 #include <iprt/sha.h>
 #include <iprt/string.h>
 #include <iprt/stream.h>
 #include <iprt/thread.h>
+#include <iprt/time.h>
 #include <iprt/uuid.h>
 #include <iprt/cpp/xml.h>
 
@@ -175,6 +177,45 @@ typedef ObjectsList<NATNetwork> NATNetworksOList;
 typedef std::map<Guid, ComPtr<IProgress> > ProgressMap;
 typedef std::map<Guid, ComObjPtr<Medium> > HardDiskMap;
 
+/** Default delay in milliseconds for coalescing global settings saves, see
+ * VirtualBox::i_saveModifiedRegistries(). Can be overridden with the
+ * VBOXSVC_SETTINGS_SAVE_DELAY environment variable, 0 disables deferring. */
+#define VBOX_SETTINGS_SAVE_DELAY_MS         250
+/** Upper bound for how much a continuous stream of changes can postpone a
+ * deferred global settings save, as a multiple of the delay. */
+#define VBOX_SETTINGS_SAVE_MAX_DELAY_FACTOR 8
+
+/**
+ * Orders strings the way RTPathCompare() compares them, so that locations
+ * can be looked up in a map with the same semantics as a linear search using
+ * RTPathCompare() would have.
+ */
+struct PathCompareLess
+{
+    bool operator()(const Utf8Str &strPath1, const Utf8Str &strPath2) const
+    {
+        return RTPathCompare(strPath1.c_str(), strPath2.c_str()) < 0;
+    }
+};
+
+typedef std::map<Guid, ComObjPtr<Medium> > MediaIdMap;
+typedef std::map<Utf8Str, ComObjPtr<Medium>, PathCompareLess> MediaLocationMap;
+
+/**
+ * Entry in the machine lookup index. Remembers the keys the machine was
+ * indexed with so they can be removed again when the machine changes.
+ */
+struct MachineIndexEntry
+{
+    ComObjPtr<Machine>  pMachine;
+    Utf8Str             strName;
+    Utf8Str             strSettingsFile;
+};
+
+typedef std::map<Guid, MachineIndexEntry> MachineIdMap;
+typedef std::multimap<Utf8Str, ComObjPtr<Machine> > MachineNameMap;
+typedef std::multimap<Utf8Str, ComObjPtr<Machine>, PathCompareLess> MachineSettingsFileMap;
+
 /**
  *  Main VirtualBox data structure.
  *  @note |const| members are persistent during lifetime so can be accessed
@@ -188,6 +229,7 @@ struct VirtualBox::Data
           uRegistryNeedsSaving(0),
           lockMachines(LOCKCLASS_LISTOFMACHINES),
           allMachines(lockMachines),
+          lockMachineIndex(LOCKCLASS_LISTOFOTHEROBJECTS),
           lockGuestOSTypes(LOCKCLASS_LISTOFOTHEROBJECTS),
           allGuestOSTypes(lockGuestOSTypes),
           lockMedia(LOCKCLASS_LISTOFMEDIA),
@@ -204,6 +246,10 @@ struct VirtualBox::Data
           pClientWatcher(NULL),
           threadAsyncEvent(NIL_RTTHREAD),
           pAsyncEventQ(NULL),
+          threadSettingsSaver(NIL_RTTHREAD),
+          hSettingsSaverEvent(NIL_RTSEMEVENT),
+          fSettingsSaverShutdown(false),
+          cMsSettingsSaveDelay(VBOX_SETTINGS_SAVE_DELAY_MS),
           pAutostartDb(NULL),
           fSettingsCipherKeySet(false)
     {
@@ -248,6 +294,39 @@ struct VirtualBox::Data
     RWLockHandle                        lockMachines;
     MachinesOList                       allMachines;
 
+    // Lookup index for the registered machines by UUID, name and settings
+    // file path. Machine names and settings files change while the machine
+    // object is locked, therefore the index has its own lock which comes after
+    // the machine object locks in the locking order. Entries are only hints,
+    // every match must be verified against the machine itself.
+    RWLockHandle                        lockMachineIndex;
+    MachineIdMap                        mapMachines;
+    MachineNameMap                      mapMachinesByName;
+    MachineSettingsFileMap              mapMachinesBySettingsFile;
+
+    // drops the name and settings file entries of an index entry, the
+    // machine index lock must be held for writing
+    void removeMachineIndexNames(const MachineIndexEntry &entry)
+    {
+        std::pair<MachineNameMap::iterator, MachineNameMap::iterator> names
+            = mapMachinesByName.equal_range(entry.strName);
+        for (MachineNameMap::iterator it = names.first; it != names.second; ++it)
+            if (it->second == entry.pMachine)
+            {
+                mapMachinesByName.erase(it);
+                break;
+            }
+
+        std::pair<MachineSettingsFileMap::iterator, MachineSettingsFileMap::iterator> files
+            = mapMachinesBySettingsFile.equal_range(entry.strSettingsFile);
+        for (MachineSettingsFileMap::iterator it = files.first; it != files.second; ++it)
+            if (it->second == entry.pMachine)
+            {
+                mapMachinesBySettingsFile.erase(it);
+                break;
+            }
+    }
+
     RWLockHandle                        lockGuestOSTypes;
     GuestOSTypesOList                   allGuestOSTypes;
 
@@ -260,6 +339,34 @@ struct VirtualBox::Data
     // and contains ALL hard disks (base and differencing); it is protected by
     // the same lock as the other media lists above
     HardDiskMap                         mapHardDisks;
+    // the DVD and floppy image equivalents of the above map
+    MediaIdMap                          mapDVDImages,
+                                        mapFloppyImages;
+    // all media (including differencing images) indexed by their full
+    // location, one map per device type; same lock as the lists above
+    MediaLocationMap                    mapHardDisksByLocation,
+                                        mapDVDImagesByLocation,
+                                        mapFloppyImagesByLocation;
+
+    MediaIdMap &getMediaIdMap(DeviceType_T devType)
+    {
+        if (devType == DeviceType_DVD)
+            return mapDVDImages;
+        if (devType == DeviceType_Floppy)
+            return mapFloppyImages;
+        Assert(devType == DeviceType_HardDisk);
+        return mapHardDisks;
+    }
+
+    MediaLocationMap &getMediaLocationMap(DeviceType_T devType)
+    {
+        if (devType == DeviceType_DVD)
+            return mapDVDImagesByLocation;
+        if (devType == DeviceType_Floppy)
+            return mapFloppyImagesByLocation;
+        Assert(devType == DeviceType_HardDisk);
+        return mapHardDisksByLocation;
+    }
 
     // list of pending machine renames (also protected by media tree lock;
     // see VirtualBox::rememberMachineNameChangeForMedia())
@@ -290,6 +397,13 @@ struct VirtualBox::Data
     EventQueue * const                  pAsyncEventQ;
     const ComObjPtr<EventSource>        pEventSource;
 
+    // the following are data for the thread doing deferred saves of the
+    // global settings file, see i_saveModifiedRegistries()
+    RTTHREAD                            threadSettingsSaver;
+    RTSEMEVENT                          hSettingsSaverEvent;
+    bool volatile                       fSettingsSaverShutdown;
+    uint32_t                            cMsSettingsSaveDelay;
+
 #ifdef VBOX_WITH_EXTPACK
     /** The extension pack manager object lives here. */
     const ComObjPtr<ExtPackManager>     ptrExtPackManager;
@@ -593,6 +707,43 @@ HRESULT VirtualBox::init()
         }
     }
 
+    if (SUCCEEDED(rc))
+    {
+        /* start the thread coalescing global settings saves, not fatal */
+        const char *pszDelay = RTEnvGet("VBOXSVC_SETTINGS_SAVE_DELAY");
+        if (pszDelay)
+        {
+            uint32_t cMsDelay;
+            int vrc = RTStrToUInt32Full(pszDelay, 0, &cMsDelay);
+            if (vrc == VINF_SUCCESS)
+                m->cMsSettingsSaveDelay = cMsDelay;
+            else
+                LogRel(("VirtualBox: Ignoring invalid VBOXSVC_SETTINGS_SAVE_DELAY value '%s'\n", pszDelay));
+        }
+        if (m->cMsSettingsSaveDelay)
+        {
+            int vrc = RTSemEventCreate(&m->hSettingsSaverEvent);
+            if (RT_SUCCESS(vrc))
+            {
+                vrc = RTThreadCreate(&m->threadSettingsSaver,
+                                     SettingsSaverThread,
+                                     this,
+                                     0,
+                                     RTTHREADTYPE_MAIN_WORKER,
+                                     RTTHREADFLAGS_WAITABLE,
+                                     "SettingsSaver");
+                if (RT_FAILURE(vrc))
+                {
+                    m->threadSettingsSaver = NIL_RTTHREAD;
+                    RTSemEventDestroy(m->hSettingsSaverEvent);
+                    m->hSettingsSaverEvent = NIL_RTSEMEVENT;
+                }
+            }
+            if (RT_FAILURE(vrc))
+                LogRel(("VirtualBox: Failed to start the settings saver thread (%Rrc), saving synchronously\n", vrc));
+        }
+    }
+
 #ifdef VBOX_WITH_EXTPACK
     /* Let the extension packs have a go at things. */
     if (SUCCEEDED(rc))
@@ -759,9 +910,14 @@ void VirtualBox::uninit()
      * uninit, as then the pointer is NULL. */
     if (RT_VALID_PTR(m))
     {
-        Assert(!m->uRegistryNeedsSaving);
+        /* Stop the deferred saving first, any save still pending is done
+         * right here synchronously. */
+        i_stopSettingsSaver();
         if (m->uRegistryNeedsSaving)
+        {
+            AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
             i_saveSettings();
+        }
     }
 
     /* Enclose the state transition Ready->InUninit->NotReady */
@@ -776,6 +932,12 @@ void VirtualBox::uninit()
     /* tell all our child objects we've been uninitialized */
 
     LogFlowThisFunc(("Uninitializing machines (%d)...\n", m->allMachines.size()));
+    {
+        AutoWriteLock il(m->lockMachineIndex COMMA_LOCKVAL_SRC_POS);
+        m->mapMachines.clear();
+        m->mapMachinesByName.clear();
+        m->mapMachinesBySettingsFile.clear();
+    }
     if (m->pHost)
     {
         /* It is necessary to hold the VirtualBox and Host locks here because
@@ -3199,31 +3361,26 @@ HRESULT VirtualBox::i_findMachine(const Guid &aId,
     AutoCaller autoCaller(this);
     AssertComRCReturnRC(autoCaller.rc());
 
+    ComObjPtr<Machine> pMachine;
     {
-        AutoReadLock al(m->allMachines.getLockHandle() COMMA_LOCKVAL_SRC_POS);
+        AutoReadLock al(m->lockMachineIndex COMMA_LOCKVAL_SRC_POS);
+        MachineIdMap::const_iterator it = m->mapMachines.find(aId);
+        if (it != m->mapMachines.end())
+            pMachine = it->second.pMachine;
+    }
 
-        for (MachinesOList::iterator it = m->allMachines.begin();
-             it != m->allMachines.end();
-             ++it)
+    if (!pMachine.isNull())
+    {
+        rc = S_OK;
+        if (!fPermitInaccessible)
         {
-            ComObjPtr<Machine> pMachine = *it;
-
-            if (!fPermitInaccessible)
-            {
-                // skip inaccessible machines
-                AutoCaller machCaller(pMachine);
-                if (FAILED(machCaller.rc()))
-                    continue;
-            }
-
-            if (pMachine->i_getId() == aId)
-            {
-                rc = S_OK;
-                if (aMachine)
-                    *aMachine = pMachine;
-                break;
-            }
+            // skip inaccessible machines
+            AutoCaller machCaller(pMachine);
+            if (FAILED(machCaller.rc()))
+                rc = VBOX_E_OBJECT_NOT_FOUND;
         }
+        if (SUCCEEDED(rc) && aMachine)
+            *aMachine = pMachine;
     }
 
     if (aSetError && FAILED(rc))
@@ -3249,31 +3406,38 @@ HRESULT VirtualBox::i_findMachineByName(const Utf8Str &aName,
 {
     HRESULT rc = VBOX_E_OBJECT_NOT_FOUND;
 
-    AutoReadLock al(m->allMachines.getLockHandle() COMMA_LOCKVAL_SRC_POS);
-    for (MachinesOList::iterator it = m->allMachines.begin();
-         it != m->allMachines.end();
-         ++it)
+    /*
+     * Collect the candidates from the index first, the machine locks must
+     * not be taken while holding the index lock. The candidates are then
+     * checked just like the full search below would do it.
+     */
+    std::list<ComObjPtr<Machine> > llCandidates;
     {
-        ComObjPtr<Machine> &pMachine = *it;
-        AutoCaller machCaller(pMachine);
-        if (machCaller.rc())
-            continue;       // we can't ask inaccessible machines for their names
+        AutoReadLock il(m->lockMachineIndex COMMA_LOCKVAL_SRC_POS);
+        std::pair<MachineNameMap::const_iterator, MachineNameMap::const_iterator> names
+            = m->mapMachinesByName.equal_range(aName);
+        for (MachineNameMap::const_iterator it = names.first; it != names.second; ++it)
+            llCandidates.push_back(it->second);
+        std::pair<MachineSettingsFileMap::const_iterator, MachineSettingsFileMap::const_iterator> files
+            = m->mapMachinesBySettingsFile.equal_range(aName);
+        for (MachineSettingsFileMap::const_iterator it = files.first; it != files.second; ++it)
+            llCandidates.push_back(it->second);
+    }
 
-        AutoReadLock machLock(pMachine COMMA_LOCKVAL_SRC_POS);
-        if (pMachine->i_getName() == aName)
-        {
-            rc = S_OK;
-            if (aMachine)
-                *aMachine = pMachine;
-            break;
-        }
-        if (!RTPathCompare(pMachine->i_getSettingsFileFull().c_str(), aName.c_str()))
-        {
-            rc = S_OK;
-            if (aMachine)
-                *aMachine = pMachine;
-            break;
-        }
+    for (std::list<ComObjPtr<Machine> >::iterator it = llCandidates.begin();
+         it != llCandidates.end() && FAILED(rc);
+         ++it)
+        rc = i_checkMachineNameOrSettingsFile(*it, aName, aMachine);
+
+    /* If the index had candidates that didn't check out, it is out of sync
+     * with the machines somehow; do the full search to be on the safe side. */
+    if (FAILED(rc) && !llCandidates.empty())
+    {
+        AutoReadLock al(m->allMachines.getLockHandle() COMMA_LOCKVAL_SRC_POS);
+        for (MachinesOList::iterator it = m->allMachines.begin();
+             it != m->allMachines.end() && FAILED(rc);
+             ++it)
+            rc = i_checkMachineNameOrSettingsFile(*it, aName, aMachine);
     }
 
     if (aSetError && FAILED(rc))
@@ -3283,6 +3447,34 @@ HRESULT VirtualBox::i_findMachineByName(const Utf8Str &aName,
     return rc;
 }
 
+/**
+ * Helper for i_findMachineByName() which checks whether the given machine
+ * is accessible and has the given name or settings file.
+ *
+ * @returns S_OK if it matches, VBOX_E_OBJECT_NOT_FOUND if not.
+ * @param pMachine  The machine to check.
+ * @param aName     Machine name or location to check for.
+ * @param aMachine  Where to return the machine on success (can be NULL).
+ */
+HRESULT VirtualBox::i_checkMachineNameOrSettingsFile(const ComObjPtr<Machine> &pMachine,
+                                                     const Utf8Str &aName,
+                                                     ComObjPtr<Machine> *aMachine)
+{
+    AutoCaller machCaller(pMachine);
+    if (machCaller.rc())
+        return VBOX_E_OBJECT_NOT_FOUND; // we can't ask inaccessible machines for their names
+
+    AutoReadLock machLock(pMachine COMMA_LOCKVAL_SRC_POS);
+    if (   pMachine->i_getName() == aName
+        || !RTPathCompare(pMachine->i_getSettingsFileFull().c_str(), aName.c_str()))
+    {
+        if (aMachine)
+            *aMachine = pMachine;
+        return S_OK;
+    }
+    return VBOX_E_OBJECT_NOT_FOUND;
+}
+
 static HRESULT i_validateMachineGroupHelper(const Utf8Str &aGroup, bool fPrimary, VirtualBox *pVirtualBox)
 {
     /* empty strings are invalid */
@@ -3462,28 +3654,21 @@ HRESULT VirtualBox::i_findHardDiskByLocation(const Utf8Str &strLocation,
 {
     AssertReturn(!strLocation.isEmpty(), E_INVALIDARG);
 
-    // we use the hard disks map, but it is protected by the
+    // we use the hard disks location map, but it is protected by the
     // hard disk _list_ lock handle
     AutoReadLock alock(m->allHardDisks.getLockHandle() COMMA_LOCKVAL_SRC_POS);
 
-    for (HardDiskMap::const_iterator it = m->mapHardDisks.begin();
-         it != m->mapHardDisks.end();
-         ++it)
+    MediaLocationMap::const_iterator it = m->mapHardDisksByLocation.find(strLocation);
+    if (it != m->mapHardDisksByLocation.end())
     {
         const ComObjPtr<Medium> &pHD = (*it).second;
 
         AutoCaller autoCaller(pHD);
         if (FAILED(autoCaller.rc())) return autoCaller.rc();
-        AutoWriteLock mlock(pHD COMMA_LOCKVAL_SRC_POS);
 
-        Utf8Str strLocationFull = pHD->i_getLocationFull();
-
-        if (0 == RTPathCompare(strLocationFull.c_str(), strLocation.c_str()))
-        {
-            if (aHardDisk)
-                *aHardDisk = pHD;
-            return S_OK;
-        }
+        if (aHardDisk)
+            *aHardDisk = pHD;
+        return S_OK;
     }
 
     if (aSetError)
@@ -3530,56 +3715,50 @@ HRESULT VirtualBox::i_findDVDOrFloppyImage(DeviceType_T mediumType,
                             vrc);
     }
 
-    MediaOList *pMediaList;
-
-    switch (mediumType)
-    {
-        case DeviceType_DVD:
-            pMediaList = &m->allDVDImages;
-        break;
-
-        case DeviceType_Floppy:
-            pMediaList = &m->allFloppyImages;
-        break;
+    if (   mediumType != DeviceType_DVD
+        && mediumType != DeviceType_Floppy)
+        return E_INVALIDARG;
 
-        default:
-            return E_INVALIDARG;
-    }
+    MediaIdMap &mapById = m->getMediaIdMap(mediumType);
+    MediaLocationMap &mapByLocation = m->getMediaLocationMap(mediumType);
 
-    AutoReadLock alock(pMediaList->getLockHandle() COMMA_LOCKVAL_SRC_POS);
+    AutoReadLock alock(m->lockMedia COMMA_LOCKVAL_SRC_POS);
 
     bool found = false;
 
-    for (MediaList::const_iterator it = pMediaList->begin();
-         it != pMediaList->end();
-         ++it)
+    // no AutoCaller, registered image life time is bound to this
+    Medium *pMedium = NULL;
+    if (aId)
+    {
+        MediaIdMap::const_iterator it = mapById.find(*aId);
+        if (it != mapById.end())
+            pMedium = it->second;
+    }
+    if (!pMedium && !aLocation.isEmpty())
+    {
+        MediaLocationMap::const_iterator it = mapByLocation.find(location);
+        if (it != mapByLocation.end())
+            pMedium = it->second;
+    }
+
+    if (pMedium)
     {
-        // no AutoCaller, registered image life time is bound to this
-        Medium *pMedium = *it;
         AutoReadLock imageLock(pMedium COMMA_LOCKVAL_SRC_POS);
         const Utf8Str &strLocationFull = pMedium->i_getLocationFull();
 
-        found =     (    aId
-                      && pMedium->i_getId() == *aId)
-                 || (    !aLocation.isEmpty()
-                      && RTPathCompare(location.c_str(),
-                                       strLocationFull.c_str()) == 0);
-        if (found)
+        if (pMedium->i_getDeviceType() != mediumType)
         {
-            if (pMedium->i_getDeviceType() != mediumType)
-            {
-                if (mediumType == DeviceType_DVD)
-                    return setError(E_INVALIDARG,
-                                    "Cannot mount DVD medium '%s' as floppy", strLocationFull.c_str());
-                else
-                    return setError(E_INVALIDARG,
-                                    "Cannot mount floppy medium '%s' as DVD", strLocationFull.c_str());
-            }
-
-            if (aImage)
-                *aImage = pMedium;
-            break;
+            if (mediumType == DeviceType_DVD)
+                return setError(E_INVALIDARG,
+                                "Cannot mount DVD medium '%s' as floppy", strLocationFull.c_str());
+            else
+                return setError(E_INVALIDARG,
+                                "Cannot mount floppy medium '%s' as DVD", strLocationFull.c_str());
         }
+
+        found = true;
+        if (aImage)
+            *aImage = pMedium;
     }
 
     HRESULT rc = found ? S_OK : VBOX_E_OBJECT_NOT_FOUND;
@@ -4087,10 +4266,24 @@ void VirtualBox::i_saveMediaRegistry(settings::MediaRegistry &mediaRegistry,
                  ++it2)
             {
                 const Data::PendingMachineRename &pmr = *it2;
+                Utf8Str strOldLocation;
+                DeviceType_T devType;
+                {
+                    AutoReadLock mlock(pMedium COMMA_LOCKVAL_SRC_POS);
+                    strOldLocation = pMedium->i_getLocationFull();
+                    devType = pMedium->i_getDeviceType();
+                }
                 HRESULT rc = pMedium->i_updatePath(pmr.strConfigDirOld,
                                                    pmr.strConfigDirNew);
                 if (SUCCEEDED(rc))
                 {
+                    Utf8Str strNewLocation;
+                    {
+                        AutoReadLock mlock(pMedium COMMA_LOCKVAL_SRC_POS);
+                        strNewLocation = pMedium->i_getLocationFull();
+                    }
+                    i_updateMediumLocation(pMedium, devType, strOldLocation, strNewLocation);
+
                     // Remember which medium objects has been changed,
                     // to trigger saving their registries later.
                     pDesc->llMedia.push_back(pMedium);
@@ -4332,6 +4525,7 @@ HRESULT VirtualBox::i_registerMachine(Machine *aMachine)
 
     /* add to the collection of registered machines */
     m->allMachines.addChild(aMachine);
+    i_addMachineToIndex(aMachine, false /* fOnlyIfIndexed */);
 
     if (getObjectState().getState() != ObjectState::InInit)
         rc = i_saveSettings();
@@ -4339,6 +4533,88 @@ HRESULT VirtualBox::i_registerMachine(Machine *aMachine)
     return rc;
 }
 
+/**
+ * Adds the given machine to the lookup index or refreshes its index entry.
+ *
+ * @param pMachine       The machine.
+ * @param fOnlyIfIndexed Only refresh an existing entry, don't add a new one.
+ *
+ * @note Locks the machine for reading and the machine index for writing.
+ *       Must not be called with the machine index lock held.
+ */
+void VirtualBox::i_addMachineToIndex(Machine *pMachine, bool fOnlyIfIndexed)
+{
+    Guid uuid;
+    Utf8Str strName;
+    Utf8Str strSettingsFile;
+    {
+        AutoReadLock machLock(pMachine COMMA_LOCKVAL_SRC_POS);
+        uuid = pMachine->i_getId();
+        if (pMachine->i_isAccessible())
+            strName = pMachine->i_getName();
+        strSettingsFile = pMachine->i_getSettingsFileFull();
+    }
+
+    AutoWriteLock il(m->lockMachineIndex COMMA_LOCKVAL_SRC_POS);
+
+    MachineIdMap::iterator it = m->mapMachines.find(uuid);
+    if (it == m->mapMachines.end())
+    {
+        if (fOnlyIfIndexed)
+            return;
+        it = m->mapMachines.insert(std::make_pair(uuid, MachineIndexEntry())).first;
+        it->second.pMachine = pMachine;
+    }
+    else
+    {
+        MachineIndexEntry &entry = it->second;
+        if (entry.strName == strName && entry.strSettingsFile == strSettingsFile)
+            return;
+        m->removeMachineIndexNames(entry);
+    }
+
+    MachineIndexEntry &entry = it->second;
+    entry.strName = strName;
+    entry.strSettingsFile = strSettingsFile;
+    if (entry.strName.isNotEmpty())
+        m->mapMachinesByName.insert(std::make_pair(entry.strName, entry.pMachine));
+    if (entry.strSettingsFile.isNotEmpty())
+        m->mapMachinesBySettingsFile.insert(std::make_pair(entry.strSettingsFile, entry.pMachine));
+}
+
+/**
+ * Removes the given machine from the lookup index.
+ *
+ * @param pMachine  The machine.
+ *
+ * @note Locks the machine index for writing.
+ */
+void VirtualBox::i_removeMachineFromIndex(Machine *pMachine)
+{
+    AutoWriteLock il(m->lockMachineIndex COMMA_LOCKVAL_SRC_POS);
+
+    MachineIdMap::iterator it = m->mapMachines.find(pMachine->i_getId());
+    if (it == m->mapMachines.end() || it->second.pMachine != pMachine)
+        return;
+    m->removeMachineIndexNames(it->second);
+    m->mapMachines.erase(it);
+}
+
+/**
+ * Refreshes the lookup index entry of a registered machine after its name or
+ * settings file changed. Does nothing for machines which aren't registered.
+ *
+ * @param pMachine  The machine or its session machine, the index entry is
+ *                  looked up by the machine UUID.
+ *
+ * @note Locks the machine for reading, so the caller must not hold the
+ *       machine index lock.
+ */
+void VirtualBox::i_updateMachineIndex(Machine *pMachine)
+{
+    i_addMachineToIndex(pMachine, true /* fOnlyIfIndexed */);
+}
+
 /**
  * Remembers the given medium object by storing it in either the global
  * medium registry or a machine one.
@@ -4430,9 +4706,10 @@ HRESULT VirtualBox::i_registerMedium(const ComObjPtr<Medium> &pMedium,
         if (pParent.isNull())
             pall->getList().push_back(pMedium);
 
-        // store all hard disks (even differencing images) in the map
-        if (devType == DeviceType_HardDisk)
-            m->mapHardDisks[id] = pMedium;
+        // store all media (even differencing images) in the maps
+        m->getMediaIdMap(devType)[id] = pMedium;
+        if (strLocationFull.isNotEmpty())
+            m->getMediaLocationMap(devType)[strLocationFull] = pMedium;
 
         mediumCaller.release();
         mediaTreeLock.release();
@@ -4480,11 +4757,13 @@ HRESULT VirtualBox::i_unregisterMedium(Medium *pMedium)
     Assert(i_getMediaTreeLockHandle().isWriteLockOnCurrentThread());
 
     Guid id;
+    Utf8Str strLocationFull;
     ComObjPtr<Medium> pParent;
     DeviceType_T devType;
     {
         AutoReadLock mediumLock(pMedium COMMA_LOCKVAL_SRC_POS);
         id = pMedium->i_getId();
+        strLocationFull = pMedium->i_getLocationFull();
         pParent = pMedium->i_getParent();
         devType = pMedium->i_getDeviceType();
     }
@@ -4509,17 +4788,53 @@ HRESULT VirtualBox::i_unregisterMedium(Medium *pMedium)
     if (pParent.isNull())
         pall->getList().remove(pMedium);
 
-    // remove all hard disks (even differencing images) from map
-    if (devType == DeviceType_HardDisk)
-    {
-        size_t cnt = m->mapHardDisks.erase(id);
-        Assert(cnt == 1);
-        NOREF(cnt);
-    }
+    // remove all media (even differencing images) from the maps
+    size_t cnt = m->getMediaIdMap(devType).erase(id);
+    Assert(cnt == 1);
+    NOREF(cnt);
+
+    MediaLocationMap &mapByLocation = m->getMediaLocationMap(devType);
+    MediaLocationMap::iterator it = mapByLocation.find(strLocationFull);
+    if (it != mapByLocation.end() && it->second == pMedium)
+        mapByLocation.erase(it);
 
     return S_OK;
 }
 
+/**
+ * Updates the location index after the location of a registered medium
+ * changed, see Medium::i_updatePath() and the medium move task.
+ *
+ * @param pMedium        The medium which changed its location.
+ * @param devType        The device type of the medium.
+ * @param strOldLocation The full location before the change.
+ * @param strNewLocation The full location after the change.
+ *
+ * @note Caller must hold the media tree lock for writing.
+ */
+void VirtualBox::i_updateMediumLocation(Medium *pMedium, DeviceType_T devType,
+                                        const Utf8Str &strOldLocation, const Utf8Str &strNewLocation)
+{
+    Assert(i_getMediaTreeLockHandle().isWriteLockOnCurrentThread());
+
+    if (   devType != DeviceType_HardDisk
+        && devType != DeviceType_DVD
+        && devType != DeviceType_Floppy)
+        return;
+
+    MediaIdMap &mapById = m->getMediaIdMap(devType);
+    MediaIdMap::const_iterator itId = mapById.find(pMedium->i_getId());
+    if (itId == mapById.end() || itId->second != pMedium)
+        return; /* not registered (yet) */
+
+    MediaLocationMap &mapByLocation = m->getMediaLocationMap(devType);
+    MediaLocationMap::iterator it = mapByLocation.find(strOldLocation);
+    if (it != mapByLocation.end() && it->second == pMedium)
+        mapByLocation.erase(it);
+    if (strNewLocation.isNotEmpty())
+        mapByLocation[strNewLocation] = pMedium;
+}
+
 /**
  * Little helper called from unregisterMachineMedia() to recursively add media to the given list,
  * with children appearing before their parents.
@@ -4611,6 +4926,7 @@ HRESULT VirtualBox::i_unregisterMachine(Machine *pMachine,
     // remove from the collection of registered machines
     AutoWriteLock alock(this COMMA_LOCKVAL_SRC_POS);
     m->allMachines.removeChild(pMachine);
+    i_removeMachineFromIndex(pMachine);
     // save the global registry
     HRESULT rc = i_saveSettings();
     alock.release();
@@ -4659,7 +4975,7 @@ HRESULT VirtualBox::i_unregisterMachine(Machine *pMachine,
         }
     }
 
-    i_saveModifiedRegistries();
+    i_saveModifiedRegistries(true /* fSync */);
 
     /* fire an event */
     i_onMachineRegistered(id, FALSE);
@@ -4744,12 +5060,19 @@ void VirtualBox::i_unmarkRegistryModified(const Guid &uuid)
  * Saves all settings files according to the modified flags in the Machine
  * objects and in the VirtualBox object.
  *
+ * The machine settings files are written right away. A global registry that
+ * was only modified because of media changes is saved by the settings saver
+ * thread a little later, so that bulk operations end up writing VirtualBox.xml
+ * once instead of once per medium. API calls which promise the change to be
+ * on disk when they return must pass @a fSync.
+ *
  * This locks machines and the VirtualBox object as necessary, so better not
  * hold any locks before calling this.
  *
- * @return
+ * @param   fSync       Write a modified global registry right away instead of
+ *                      handing it to the settings saver thread.
  */
-void VirtualBox::i_saveModifiedRegistries()
+void VirtualBox::i_saveModifiedRegistries(bool fSync /* = false */)
 {
     HRESULT rc = S_OK;
     bool fNeedsGlobalSettings = false;
@@ -4787,6 +5110,12 @@ void VirtualBox::i_saveModifiedRegistries()
         }
     }
 
+    /* A modified global media registry alone is left to the settings saver
+     * thread, which coalesces the saves of bulk operations into one. Machine
+     * renames need the machine registry updated right away. */
+    if (!fSync && !fNeedsGlobalSettings && i_scheduleSettingsSave())
+        return;
+
     for (;;)
     {
         uOld = ASMAtomicReadU64(&m->uRegistryNeedsSaving);
@@ -4804,6 +5133,43 @@ void VirtualBox::i_saveModifiedRegistries()
     NOREF(rc); /* XXX */
 }
 
+/**
+ * Hands a pending save of the global settings file over to the settings
+ * saver thread.
+ *
+ * @returns true if the save was taken care of (or there is nothing to save),
+ *          false if the caller has to save the settings itself.
+ */
+bool VirtualBox::i_scheduleSettingsSave()
+{
+    if (   m->threadSettingsSaver == NIL_RTTHREAD
+        || ASMAtomicReadBool(&m->fSettingsSaverShutdown))
+        return false;
+    if (ASMAtomicReadU64(&m->uRegistryNeedsSaving))
+        RTSemEventSignal(m->hSettingsSaverEvent);
+    return true;
+}
+
+/**
+ * Stops the settings saver thread. Pending saves are not done by the
+ * thread, the caller must check uRegistryNeedsSaving afterwards.
+ */
+void VirtualBox::i_stopSettingsSaver()
+{
+    if (m->threadSettingsSaver == NIL_RTTHREAD)
+        return;
+
+    ASMAtomicWriteBool(&m->fSettingsSaverShutdown, true);
+    RTSemEventSignal(m->hSettingsSaverEvent);
+    int vrc = RTThreadWait(m->threadSettingsSaver, 60000, NULL);
+    if (RT_FAILURE(vrc))
+        Log1WarningFunc(("RTThreadWait(%RTthrd) -> %Rrc\n", m->threadSettingsSaver, vrc));
+    m->threadSettingsSaver = NIL_RTTHREAD;
+
+    RTSemEventDestroy(m->hSettingsSaverEvent);
+    m->hSettingsSaverEvent = NIL_RTSEMEVENT;
+}
+
 
 /* static */
 const com::Utf8Str &VirtualBox::i_getVersionNormalized()
@@ -4939,6 +5305,62 @@ DECLCALLBACK(int) VirtualBox::AsyncEventHandler(RTTHREAD thread, void *pvUser)
 }
 
 
+/**
+ *  Thread function doing the deferred saves of the global settings file.
+ *
+ *  Waits for i_scheduleSettingsSave() to signal a modified global registry,
+ *  then waits until no further changes arrive for the configured delay (but
+ *  not forever), and writes VirtualBox.xml once for all of them.
+ */
+// static
+DECLCALLBACK(int) VirtualBox::SettingsSaverThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    RT_NOREF(hThreadSelf);
+    VirtualBox *pThis = (VirtualBox *)pvUser;
+    AssertPtrReturn(pThis, VERR_INVALID_POINTER);
+    Data *m = pThis->m;
+
+    while (!ASMAtomicReadBool(&m->fSettingsSaverShutdown))
+    {
+        RTSemEventWait(m->hSettingsSaverEvent, RT_INDEFINITE_WAIT);
+
+        uint64_t const msStart = RTTimeMilliTS();
+        uint64_t const cMsMax  = (uint64_t)m->cMsSettingsSaveDelay * VBOX_SETTINGS_SAVE_MAX_DELAY_FACTOR;
+        while (   !ASMAtomicReadBool(&m->fSettingsSaverShutdown)
+               && RTSemEventWait(m->hSettingsSaverEvent, m->cMsSettingsSaveDelay) == VINF_SUCCESS
+               && RTTimeMilliTS() - msStart < cMsMax)
+        { /* more changes came in, wait for them to settle */ }
+
+        if (ASMAtomicReadBool(&m->fSettingsSaverShutdown))
+            break;
+
+        if (ASMAtomicReadU64(&m->uRegistryNeedsSaving))
+        {
+            /* The object is going away. Don't drop the save on the floor but
+             * stop taking new ones: i_scheduleSettingsSave() makes the callers
+             * save synchronously from now on and uninit() flushes what is
+             * still pending. */
+            AutoCaller autoCaller(pThis);
+            if (FAILED(autoCaller.rc()))
+            {
+                ASMAtomicWriteBool(&m->fSettingsSaverShutdown, true);
+                break;
+            }
+            AutoWriteLock alock(pThis COMMA_LOCKVAL_SRC_POS);
+            /* i_saveSettings() resets the modified counter */
+            if (ASMAtomicReadU64(&m->uRegistryNeedsSaving))
+            {
+                HRESULT rc = pThis->i_saveSettings();
+                if (FAILED(rc))
+                    LogRel(("VirtualBox: Deferred save of the global settings failed: %Rhrc\n", rc));
+            }
+        }
+    }
+
+    return VINF_SUCCESS;
+}
+
+
 ////////////////////////////////////////////////////////////////////////////////
 
 /**
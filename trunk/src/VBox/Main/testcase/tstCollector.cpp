@@ -79,6 +79,97 @@ void shutdownProcessList(std::vector<RTPROCESS> const &rProcesses)
         RTProcTerminate(rProcesses[i]);
 }
 
+int testRing()
+{
+    RTPrintf("tstCollector: TESTING - VM statistics ring\n");
+
+    pm::VmStatsRing writer, reader;
+    int rc = writer.create();
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("tstCollector: VmStatsRing::create() -> %Rrc\n", rc);
+        return 1;
+    }
+    rc = reader.open(RTProcSelf());
+    if (RT_FAILURE(rc))
+    {
+        RTPrintf("tstCollector: VmStatsRing::open() -> %Rrc\n", rc);
+        return 1;
+    }
+    if (writer.isReaderAttached())
+    {
+        RTPrintf("tstCollector: reader attached before it said so\n");
+        return 1;
+    }
+    reader.setReaderAttached(true);
+    if (!writer.isReaderAttached())
+    {
+        RTPrintf("tstCollector: writer does not see the reader\n");
+        return 1;
+    }
+
+    /* Wrap around so the first ten samples get overwritten. */
+    const uint32_t cSamples = pm::VMSTATSRING_SAMPLES + 10;
+    uint32_t aValues[pm::VMSTATSRINGVALUE_MAX];
+    for (uint32_t i = 0; i < cSamples; ++i)
+    {
+        for (uint32_t j = 0; j < pm::VMSTATSRINGVALUE_MAX; ++j)
+            aValues[j] = i * 100 + j;
+        writer.push(i % 2 ? pm::VMSTATS_ALL : pm::VMSTATS_NET_RATE, aValues);
+    }
+    if (reader.getPushed() != cSamples || reader.getOldest() != 10)
+    {
+        RTPrintf("tstCollector: ring has %u samples starting at %u, expected %u starting at 10\n",
+                 reader.getPushed(), reader.getOldest(), cSamples);
+        return 1;
+    }
+
+    pm::VMSTATSRINGSAMPLE sample;
+    if (reader.read(9, &sample))
+    {
+        RTPrintf("tstCollector: read an overwritten sample\n");
+        return 1;
+    }
+    if (reader.read(cSamples, &sample))
+    {
+        RTPrintf("tstCollector: read a sample that was not pushed\n");
+        return 1;
+    }
+    int64_t iPrevTimestamp = 0;
+    for (uint32_t i = 10; i < cSamples; ++i)
+    {
+        if (!reader.read(i, &sample))
+        {
+            RTPrintf("tstCollector: failed to read sample %u\n", i);
+            return 1;
+        }
+        if (   sample.fValid != (i % 2 ? pm::VMSTATS_ALL : pm::VMSTATS_NET_RATE)
+            || sample.au32Values[0] != i * 100
+            || sample.au32Values[pm::VMSTATSRINGVALUE_NETTX] != i * 100 + pm::VMSTATSRINGVALUE_NETTX
+            || sample.i64Timestamp < iPrevTimestamp)
+        {
+            RTPrintf("tstCollector: sample %u is corrupt (valid=%#x value=%u)\n", i, sample.fValid, sample.au32Values[0]);
+            return 1;
+        }
+        iPrevTimestamp = sample.i64Timestamp;
+    }
+
+    reader.close();
+    if (writer.isReaderAttached())
+    {
+        RTPrintf("tstCollector: reader still attached after closing\n");
+        return 1;
+    }
+    writer.close();
+    if (RT_SUCCESS(reader.open(RTProcSelf())))
+    {
+        RTPrintf("tstCollector: opened the ring after the VM closed it\n");
+        return 1;
+    }
+    RTPrintf("tstCollector: VM statistics ring OK\n\n");
+    return 0;
+}
+
 void measurePerformance(pm::CollectorHAL *collector, const char *pszName, int cVMs)
 {
 
@@ -326,8 +417,8 @@ int testDisk(pm::CollectorHAL *collector)
 
 int main(int argc, char *argv[])
 {
-    bool cpuTest, ramTest, netTest, diskTest, fsTest, perfTest;
-    cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = false;
+    bool cpuTest, ramTest, netTest, diskTest, fsTest, perfTest, ringTest;
+    cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = ringTest = false;
     /*
      * Initialize the VBox runtime without loading
      * the support driver.
@@ -360,6 +451,8 @@ int main(int argc, char *argv[])
                 fsTest = true;
             else if (!strcmp(argv[i], "-perf"))
                 perfTest = true;
+            else if (!strcmp(argv[i], "-ring"))
+                ringTest = true;
             else
             {
                 RTPrintf("tstCollector: Unknown option: %s\n", argv[i]);
@@ -368,7 +461,7 @@ int main(int argc, char *argv[])
         }
     }
     else
-        cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = true;
+        cpuTest = ramTest = netTest = diskTest = fsTest = perfTest = ringTest = true;
 
 #ifdef RT_OS_WINDOWS
     HRESULT hRes = CoInitialize(NULL);
@@ -564,6 +657,8 @@ int main(int argc, char *argv[])
     rc = testFsUsage(collector);
     if (diskTest)
         rc = testDisk(collector);
+    if (ringTest)
+        rc = testRing();
     if (perfTest)
     {
         RTPrintf("tstCollector: TESTING - Performance\n\n");
@@ -0,0 +1,254 @@
+/* $Id$ */
+/** @file
+ * tstHGCMThreadPerf - Measures the round trip latency and the throughput of
+ * HGCM worker thread messages with a service thread doing nothing.
+ */
+
+/*
+ * Copyright (C) 2006-2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "../include/HGCMThread.h"
+
+#include <VBox/err.h>
+#include <iprt/asm.h>
+#include <iprt/semaphore.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
+#include <iprt/time.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Message processed by the null service thread. */
+#define TST_MSG_CALL    (1)
+/** Terminates the null service thread. */
+#define TST_MSG_QUIT    (2)
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** The message, the null service needs no data. */
+class TstMsgCall: public HGCMMsgCore
+{
+};
+
+/** Arguments of tstPosterThread(). */
+typedef struct TSTPOSTER
+{
+    HGCMTHREADHANDLE    hThread;
+    uint32_t            cCalls;
+} TSTPOSTER;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST               g_hTest;
+/** Number of posted messages not completed yet. */
+static uint32_t volatile    g_cPending;
+/** Signalled when g_cPending drops to zero. */
+static RTSEMEVENT           g_hEventDone;
+
+
+static HGCMMsgCore *tstMsgAlloc(uint32_t u32MsgId)
+{
+    NOREF(u32MsgId);
+    return new TstMsgCall();
+}
+
+/**
+ * The null service thread, completes every message right away.
+ */
+static DECLCALLBACK(void) tstNullServiceThread(HGCMTHREADHANDLE ThreadHandle, void *pvUser)
+{
+    NOREF(pvUser);
+
+    bool fQuit = false;
+    while (!fQuit)
+    {
+        HGCMMsgCore *pMsgCore;
+        int rc = hgcmMsgGet(ThreadHandle, &pMsgCore);
+        if (RT_FAILURE(rc))
+        {
+            RTTestFailed(g_hTest, "hgcmMsgGet failed: %Rrc", rc);
+            break;
+        }
+
+        fQuit = pMsgCore->MsgId() == TST_MSG_QUIT;
+        hgcmMsgComplete(pMsgCore, VINF_SUCCESS);
+    }
+}
+
+static DECLCALLBACK(void) tstMsgCompletion(int32_t result, HGCMMsgCore *pMsgCore)
+{
+    NOREF(result); NOREF(pMsgCore);
+    if (ASMAtomicDecU32(&g_cPending) == 0)
+        RTSemEventSignal(g_hEventDone);
+}
+
+/**
+ * Posts @a cCalls messages without waiting for them.
+ */
+static int tstPostCalls(HGCMTHREADHANDLE hThread, uint32_t cCalls)
+{
+    for (uint32_t i = 0; i < cCalls; i++)
+    {
+        HGCMMSGHANDLE hMsg = 0;
+        int rc = hgcmMsgAlloc(hThread, &hMsg, TST_MSG_CALL, tstMsgAlloc);
+        if (RT_SUCCESS(rc))
+            rc = hgcmMsgPost(hMsg, tstMsgCompletion);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+    return VINF_SUCCESS;
+}
+
+static DECLCALLBACK(int) tstPosterThread(RTTHREAD hSelf, void *pvUser)
+{
+    NOREF(hSelf);
+    TSTPOSTER *pArgs = (TSTPOSTER *)pvUser;
+    return tstPostCalls(pArgs->hThread, pArgs->cCalls);
+}
+
+
+/**
+ * Sends messages one by one, waiting for each, which is what host calls do.
+ */
+static void tstSendLatency(HGCMTHREADHANDLE hThread)
+{
+    RTTestSub(g_hTest, "hgcmMsgSend round trip");
+
+    uint32_t const cCalls   = 100000;
+    uint64_t       uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cCalls; i++)
+    {
+        HGCMMSGHANDLE hMsg = 0;
+        int rc = hgcmMsgAlloc(hThread, &hMsg, TST_MSG_CALL, tstMsgAlloc);
+        if (RT_SUCCESS(rc))
+            rc = hgcmMsgSend(hMsg);
+        if (RT_FAILURE(rc))
+        {
+            RTTestFailed(g_hTest, "Sending message #%u failed: %Rrc", i, rc);
+            return;
+        }
+    }
+    uint64_t uElapsed = RTTimeNanoTS() - uStartTS;
+    RTTestValue(g_hTest, "hgcmMsgSend average", uElapsed / cCalls, RTTESTUNIT_NS_PER_CALL);
+    RTTestSubDone(g_hTest);
+}
+
+
+/**
+ * Posts messages from @a cPosters threads at once and waits for all the
+ * completion callbacks, which is what guest calls do.
+ */
+static void tstPostThroughput(HGCMTHREADHANDLE hThread, uint32_t cPosters)
+{
+    RTTestSubF(g_hTest, "hgcmMsgPost from %u thread(s)", cPosters);
+
+    uint32_t const cCallsPerPoster = 100000;
+    RTTHREAD       ahPosters[8];
+    TSTPOSTER      Args = { hThread, cCallsPerPoster };
+    AssertReturnVoid(cPosters <= RT_ELEMENTS(ahPosters));
+
+    ASMAtomicWriteU32(&g_cPending, cPosters * cCallsPerPoster);
+    uint64_t uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cPosters; i++)
+    {
+        int rc = RTThreadCreateF(&ahPosters[i], tstPosterThread, &Args, 0, RTTHREADTYPE_DEFAULT,
+                                 RTTHREADFLAGS_WAITABLE, "tstPost%u", i);
+        if (RT_FAILURE(rc))
+        {
+            RTTestFailed(g_hTest, "RTThreadCreateF failed: %Rrc", rc);
+            ASMAtomicSubU32(&g_cPending, (cPosters - i) * cCallsPerPoster);
+            cPosters = i;
+            break;
+        }
+    }
+
+    for (uint32_t i = 0; i < cPosters; i++)
+    {
+        int rcThread = VINF_SUCCESS;
+        int rc = RTThreadWait(ahPosters[i], RT_INDEFINITE_WAIT, &rcThread);
+        if (RT_FAILURE(rc) || RT_FAILURE(rcThread))
+            RTTestFailed(g_hTest, "Poster #%u failed: %Rrc / %Rrc", i, rc, rcThread);
+    }
+
+    while (ASMAtomicReadU32(&g_cPending) != 0)
+    {
+        int rc = RTSemEventWait(g_hEventDone, 30000);
+        if (rc == VERR_TIMEOUT)
+        {
+            RTTestFailed(g_hTest, "Timed out with %u messages pending", ASMAtomicReadU32(&g_cPending));
+            return;
+        }
+    }
+    uint64_t uElapsed = RTTimeNanoTS() - uStartTS;
+
+    if (cPosters)
+        RTTestValue(g_hTest, "hgcmMsgPost average", uElapsed / (cPosters * cCallsPerPoster), RTTESTUNIT_NS_PER_CALL);
+    RTTestSubDone(g_hTest);
+}
+
+
+int main()
+{
+    /*
+     * Initialization.
+     */
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstHGCMThreadPerf", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    int rc = hgcmThreadInit();
+    if (RT_SUCCESS(rc))
+        rc = RTSemEventCreate(&g_hEventDone);
+    if (RT_FAILURE(rc))
+    {
+        RTTestFailed(g_hTest, "Initialization failed: %Rrc", rc);
+        return RTTestSummaryAndDestroy(g_hTest);
+    }
+
+    HGCMTHREADHANDLE hThread = 0;
+    rc = hgcmThreadCreate(&hThread, "tstNullSvc", tstNullServiceThread, NULL);
+    if (RT_SUCCESS(rc))
+    {
+        /*
+         * Call test functions.
+         */
+        tstSendLatency(hThread);
+        tstPostThroughput(hThread, 1);
+        tstPostThroughput(hThread, 4);
+
+        HGCMMSGHANDLE hMsg = 0;
+        rc = hgcmMsgAlloc(hThread, &hMsg, TST_MSG_QUIT, tstMsgAlloc);
+        if (RT_SUCCESS(rc))
+            rc = hgcmMsgSend(hMsg);
+        if (RT_FAILURE(rc))
+            RTTestFailed(g_hTest, "Stopping the service thread failed: %Rrc", rc);
+        hgcmThreadWait(hThread);
+    }
+    else
+        RTTestFailed(g_hTest, "hgcmThreadCreate failed: %Rrc", rc);
+
+    RTSemEventDestroy(g_hEventDone);
+    hgcmThreadUninit();
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
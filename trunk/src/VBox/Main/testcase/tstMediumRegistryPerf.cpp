@@ -0,0 +1,263 @@
+/* $Id$ */
+/** @file
+ * tstMediumRegistryPerf - Checks the performance of media and machine
+ * lookups in VBoxSVC with a large number of registered media.
+ */
+
+/*
+ * Copyright (C) 2006-2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <VBox/com/com.h>
+#include <VBox/com/string.h>
+#include <VBox/com/array.h>
+#include <VBox/com/Guid.h>
+#include <VBox/com/ErrorInfo.h>
+#include <VBox/com/VirtualBox.h>
+#include <VBox/sup.h>
+
+#include <iprt/dir.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/time.h>
+
+#include <vector>
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+static RTTEST g_hTest;
+
+
+/** Worker fro TST_COM_EXPR(). */
+static HRESULT tstComExpr(HRESULT hrc, const char *pszOperation, int iLine)
+{
+    if (FAILED(hrc))
+        RTTestFailed(g_hTest, "%s failed on line %u with hrc=%Rhrc", pszOperation, iLine, hrc);
+    return hrc;
+}
+
+/** Macro that executes the given expression and report any failure.
+ *  The expression must return a HRESULT. */
+#define TST_COM_EXPR(expr) tstComExpr(expr, #expr, __LINE__)
+
+
+
+/**
+ * Creates @a cMedia small dynamic VDI images in @a pszDir and registers them.
+ */
+static void tstCreateMedia(IVirtualBox *pVBox, const char *pszDir, uint32_t cMedia,
+                           std::vector<ComPtr<IMedium> > &aMedia, std::vector<com::Utf8Str> &aLocations)
+{
+    RTTestSubF(g_hTest, "Creating %u hard disk media", cMedia);
+
+    uint64_t uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cMedia; i++)
+    {
+        char szPath[RTPATH_MAX];
+        char szFile[32];
+        RTStrPrintf(szFile, sizeof(szFile), "disk%05u.vdi", i);
+        int rc = RTPathJoin(szPath, sizeof(szPath), pszDir, szFile);
+        if (RT_FAILURE(rc))
+        {
+            RTTestFailed(g_hTest, "RTPathJoin failed: %Rrc", rc);
+            return;
+        }
+
+        ComPtr<IMedium> ptrMedium;
+        HRESULT hrc = TST_COM_EXPR(pVBox->CreateMedium(com::Bstr("VDI").raw(), com::Bstr(szPath).raw(),
+                                                       AccessMode_ReadWrite, DeviceType_HardDisk,
+                                                       ptrMedium.asOutParam()));
+        if (FAILED(hrc))
+            return;
+
+        ComPtr<IProgress> ptrProgress;
+        com::SafeArray<MediumVariant_T> variant;
+        variant.push_back(MediumVariant_Standard);
+        hrc = TST_COM_EXPR(ptrMedium->CreateBaseStorage(_1M, ComSafeArrayAsInParam(variant), ptrProgress.asOutParam()));
+        if (SUCCEEDED(hrc))
+            hrc = TST_COM_EXPR(ptrProgress->WaitForCompletion(30000));
+        aMedia.push_back(ptrMedium);
+        if (FAILED(hrc))
+            return;
+        aLocations.push_back(szPath);
+    }
+    uint64_t uElapsed = RTTimeNanoTS() - uStartTS;
+    RTTestValue(g_hTest, "IMedium::CreateBaseStorage average", uElapsed / RT_MAX(cMedia, 1), RTTESTUNIT_NS_PER_CALL);
+    RTTestSubDone(g_hTest);
+}
+
+
+/**
+ * Opens already registered media by location, which VBoxSVC answers by
+ * looking up the registered medium.
+ */
+static void tstMediumPrf1(IVirtualBox *pVBox, std::vector<com::Utf8Str> const &aLocations)
+{
+    RTTestSub(g_hTest, "IVirtualBox::OpenMedium (registered) performance");
+    if (aLocations.empty())
+        return;
+
+    uint32_t const cCalls   = 16384;
+    uint64_t       uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cCalls; i++)
+    {
+        ComPtr<IMedium> ptrMedium;
+        HRESULT hrc = pVBox->OpenMedium(com::Bstr(aLocations[i % aLocations.size()]).raw(), DeviceType_HardDisk,
+                                        AccessMode_ReadWrite, FALSE /* fForceNewUuid */, ptrMedium.asOutParam());
+        if (FAILED(hrc))
+        {
+            tstComExpr(hrc, "IVirtualBox::OpenMedium", __LINE__);
+            return;
+        }
+    }
+    uint64_t uElapsed = RTTimeNanoTS() - uStartTS;
+    RTTestValue(g_hTest, "IVirtualBox::OpenMedium average", uElapsed / cCalls, RTTESTUNIT_NS_PER_CALL);
+    RTTestSubDone(g_hTest);
+}
+
+
+/**
+ * Looks up machines which don't exist, by name and by UUID.
+ */
+static void tstMachinePrf1(IVirtualBox *pVBox)
+{
+    RTTestSub(g_hTest, "IVirtualBox::FindMachine (not found) performance");
+
+    com::Bstr bstrName("tstMediumRegistryPerf-no-such-machine");
+    uint32_t const cCalls   = 16384;
+    uint64_t       uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cCalls; i++)
+    {
+        ComPtr<IMachine> ptrMachine;
+        HRESULT hrc = pVBox->FindMachine(bstrName.raw(), ptrMachine.asOutParam());
+        if (hrc != VBOX_E_OBJECT_NOT_FOUND)
+        {
+            RTTestFailed(g_hTest, "IVirtualBox::FindMachine returned hrc=%Rhrc", hrc);
+            return;
+        }
+    }
+    uint64_t uElapsed = RTTimeNanoTS() - uStartTS;
+    RTTestValue(g_hTest, "IVirtualBox::FindMachine by name average", uElapsed / cCalls, RTTESTUNIT_NS_PER_CALL);
+
+    com::Guid uuid;
+    uuid.create();
+    com::Bstr bstrUuid(uuid.toString());
+    uStartTS = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cCalls; i++)
+    {
+        ComPtr<IMachine> ptrMachine;
+        HRESULT hrc = pVBox->FindMachine(bstrUuid.raw(), ptrMachine.asOutParam());
+        if (hrc != VBOX_E_OBJECT_NOT_FOUND)
+        {
+            RTTestFailed(g_hTest, "IVirtualBox::FindMachine returned hrc=%Rhrc", hrc);
+            return;
+        }
+    }
+    uElapsed = RTTimeNanoTS() - uStartTS;
+    RTTestValue(g_hTest, "IVirtualBox::FindMachine by UUID average", uElapsed / cCalls, RTTESTUNIT_NS_PER_CALL);
+    RTTestSubDone(g_hTest);
+}
+
+
+/**
+ * Deletes and closes the media created by tstCreateMedia().
+ */
+static void tstDestroyMedia(std::vector<ComPtr<IMedium> > &aMedia)
+{
+    RTTestSub(g_hTest, "Deleting media");
+    for (size_t i = 0; i < aMedia.size(); i++)
+    {
+        ComPtr<IProgress> ptrProgress;
+        HRESULT hrc = TST_COM_EXPR(aMedia[i]->DeleteStorage(ptrProgress.asOutParam()));
+        if (SUCCEEDED(hrc))
+            TST_COM_EXPR(ptrProgress->WaitForCompletion(30000));
+        else
+            TST_COM_EXPR(aMedia[i]->Close());
+    }
+    aMedia.clear();
+    RTTestSubDone(g_hTest);
+}
+
+
+
+int main(int argc, char **argv)
+{
+    /*
+     * Initialization.
+     */
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstMediumRegistryPerf", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    SUPR3Init(NULL); /* Better time support. */
+    RTTestBanner(g_hTest);
+
+    uint32_t cMedia = 2000;
+    if (argc > 1)
+    {
+        int rc = RTStrToUInt32Full(argv[1], 0, &cMedia);
+        if (rc != VINF_SUCCESS || !cMedia)
+            return RTTestSkipAndDestroy(g_hTest, "Invalid media count '%s'", argv[1]);
+    }
+
+    char szDir[RTPATH_MAX];
+    int rc = RTPathTemp(szDir, sizeof(szDir));
+    if (RT_SUCCESS(rc))
+        rc = RTPathAppend(szDir, sizeof(szDir), "tstMediumRegistryPerf-XXXXXX");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreateTemp(szDir, 0700);
+    if (RT_FAILURE(rc))
+    {
+        RTTestFailed(g_hTest, "Creating the temp directory failed: %Rrc", rc);
+        return RTTestSummaryAndDestroy(g_hTest);
+    }
+
+    RTTestSub(g_hTest, "Initializing COM and singletons");
+    HRESULT hrc = com::Initialize();
+    if (SUCCEEDED(hrc))
+    {
+        ComPtr<IVirtualBoxClient> ptrVBoxClient;
+        ComPtr<IVirtualBox> ptrVBox;
+        hrc = TST_COM_EXPR(ptrVBoxClient.createInprocObject(CLSID_VirtualBoxClient));
+        if (SUCCEEDED(hrc))
+            hrc = TST_COM_EXPR(ptrVBoxClient->COMGETTER(VirtualBox)(ptrVBox.asOutParam()));
+        if (SUCCEEDED(hrc))
+        {
+            RTTestSubDone(g_hTest);
+
+            /*
+             * Call test functions.
+             */
+            std::vector<ComPtr<IMedium> > aMedia;
+            std::vector<com::Utf8Str> aLocations;
+            tstCreateMedia(ptrVBox, szDir, cMedia, aMedia, aLocations);
+            tstMediumPrf1(ptrVBox, aLocations);
+            tstMachinePrf1(ptrVBox);
+            tstDestroyMedia(aMedia);
+        }
+
+        ptrVBox.setNull();
+        ptrVBoxClient.setNull();
+        com::Shutdown();
+    }
+    else
+        RTTestIFailed("com::Initialize failed with hrc=%Rhrc", hrc);
+
+    RTDirRemove(szDir);
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
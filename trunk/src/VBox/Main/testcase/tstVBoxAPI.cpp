@@ -31,6 +31,8 @@
 #include <iprt/test.h>
 #include <iprt/time.h>
 
+#include <vector>
+
 using namespace com;
 
 
@@ -335,6 +337,160 @@ static BOOL tstApiIVirtualBox(IVirtualBox *pVBox)
 }
 
 
+/**
+ * Fetches the queued events of a passive listener and returns the guest
+ * property changes among them as "name=value" strings joined by commas.
+ */
+static Utf8Str tstGetGuestPropertyEvents(IEventSource *pEventSource, IEventListener *pListener)
+{
+    Utf8Str strEvents;
+    com::SafeIfaceArray<IEvent> events;
+    HRESULT hrc = TST_COM_EXPR(pEventSource->GetEvents(pListener, 0 /* aTimeout */, 100 /* aMaxEvents */,
+                                                       ComSafeArrayAsOutParam(events)));
+    if (FAILED(hrc))
+        return "<failed>";
+    for (size_t i = 0; i < events.size(); i++)
+    {
+        ComPtr<IGuestPropertyChangedEvent> ptrEvent = events[i];
+        Bstr bstrName;
+        Bstr bstrValue;
+        if (   ptrEvent.isNull()
+            || FAILED(ptrEvent->COMGETTER(Name)(bstrName.asOutParam()))
+            || FAILED(ptrEvent->COMGETTER(Value)(bstrValue.asOutParam())))
+            return "<bad event>";
+        if (i)
+            strEvents.append(',');
+        strEvents.append(Utf8StrFmt("%ls=%ls", bstrName.raw(), bstrValue.raw()));
+    }
+    return strEvents;
+}
+
+
+static BOOL tstApiIEventSource(IVirtualBox *pVBox, ISession *pSession)
+{
+    RTTestSub(g_hTest, "IEventSource::registerFilteredListener");
+
+    ComPtr<IEventSource> ptrEventSource;
+    ComPtr<IMachine> ptrMachine;
+    Bstr bstrMachineId;
+    if (   FAILED(TST_COM_EXPR(pVBox->COMGETTER(EventSource)(ptrEventSource.asOutParam())))
+        || FAILED(TST_COM_EXPR(pVBox->FindMachine(tstMachineName.raw(), ptrMachine.asOutParam())))
+        || FAILED(TST_COM_EXPR(ptrMachine->COMGETTER(Id)(bstrMachineId.asOutParam()))))
+        return FALSE;
+
+    com::Guid uuidOther;
+    uuidOther.create();
+    com::SafeArray<BSTR> thisMachine(1);
+    bstrMachineId.cloneTo(&thisMachine[0]);
+    com::SafeArray<BSTR> otherMachine(1);
+    uuidOther.toUtf16().cloneTo(&otherMachine[0]);
+
+    com::SafeArray<VBoxEventType_T> guestPropertyEvents;
+    guestPropertyEvents.push_back(VBoxEventType_OnGuestPropertyChanged);
+    com::SafeArray<VBoxEventType_T> extraDataEvents;
+    extraDataEvents.push_back(VBoxEventType_OnExtraDataCanChange);
+
+    /*
+     * Superseded events are only dropped for the listener asking for it, and
+     * the machine and property filters only let the wanted events through.
+     */
+    static struct
+    {
+        const char *pszName;
+        BOOL        fCoalesce;
+        bool        fOtherMachine;
+        const char *pszProperties;
+        const char *pszExpected;
+    } const s_aListeners[] =
+    {
+        { "unfiltered",     FALSE, false, NULL,                       "/tstVBoxAPI/A=1,/tstVBoxAPI/A=2,/tstVBoxAPI/B=1" },
+        { "filtered",       FALSE, false, "",                         "/tstVBoxAPI/A=1,/tstVBoxAPI/A=2,/tstVBoxAPI/B=1" },
+        { "coalescing",     TRUE,  false, "/tstVBoxAPI/*",            "/tstVBoxAPI/A=2,/tstVBoxAPI/B=1" },
+        { "other machine",  TRUE,  true,  "",                         "" },
+        { "property names", FALSE, false, "/nothing|/tstVBoxAPI/B",   "/tstVBoxAPI/B=1" },
+    };
+    ComPtr<IEventListener> aptrListeners[RT_ELEMENTS(s_aListeners)];
+    for (size_t i = 0; i < RT_ELEMENTS(s_aListeners); i++)
+    {
+        if (FAILED(TST_COM_EXPR(ptrEventSource->CreateListener(aptrListeners[i].asOutParam()))))
+            return FALSE;
+        com::SafeArray<BSTR> *pMachines = s_aListeners[i].fOtherMachine ? &otherMachine : &thisMachine;
+        if (!s_aListeners[i].pszProperties)
+            TST_COM_EXPR(ptrEventSource->RegisterListener(aptrListeners[i], ComSafeArrayAsInParam(guestPropertyEvents),
+                                                          FALSE /* active */));
+        else
+            TST_COM_EXPR(ptrEventSource->RegisterFilteredListener(aptrListeners[i],
+                                                                  ComSafeArrayAsInParam(guestPropertyEvents),
+                                                                  FALSE /* active */, s_aListeners[i].fCoalesce,
+                                                                  ComSafeArrayAsInParam(*pMachines),
+                                                                  Bstr(s_aListeners[i].pszProperties).raw()));
+    }
+
+    if (FAILED(TST_COM_EXPR(ptrMachine->LockMachine(pSession, LockType_Write))))
+        return FALSE;
+    ComPtr<IMachine> ptrSessionMachine;
+    TST_COM_EXPR(pSession->COMGETTER(Machine)(ptrSessionMachine.asOutParam()));
+    TST_COM_EXPR(ptrSessionMachine->SetGuestProperty(Bstr("/tstVBoxAPI/A").raw(), Bstr("1").raw(), Bstr("").raw()));
+    TST_COM_EXPR(ptrSessionMachine->SetGuestProperty(Bstr("/tstVBoxAPI/A").raw(), Bstr("2").raw(), Bstr("").raw()));
+    TST_COM_EXPR(ptrSessionMachine->SetGuestProperty(Bstr("/tstVBoxAPI/B").raw(), Bstr("1").raw(), Bstr("").raw()));
+
+    for (size_t i = 0; i < RT_ELEMENTS(s_aListeners); i++)
+    {
+        Utf8Str strEvents = tstGetGuestPropertyEvents(ptrEventSource, aptrListeners[i]);
+        if (!strEvents.equals(s_aListeners[i].pszExpected))
+            RTTestFailed(g_hTest, "%s listener got '%s', expected '%s'",
+                         s_aListeners[i].pszName, strEvents.c_str(), s_aListeners[i].pszExpected);
+        TST_COM_EXPR(ptrEventSource->UnregisterListener(aptrListeners[i]));
+    }
+
+    /*
+     * A waitable event filtered out for a passive listener counts as processed
+     * by it, so firing it doesn't wait for the listener.
+     */
+    RTTestSub(g_hTest, "IEventSource filtered waitable events");
+    ComPtr<IEventListener> ptrListener;
+    TST_COM_EXPR(ptrEventSource->CreateListener(ptrListener.asOutParam()));
+    TST_COM_EXPR(ptrEventSource->RegisterFilteredListener(ptrListener, ComSafeArrayAsInParam(extraDataEvents),
+                                                          FALSE /* active */, FALSE /* coalesce */,
+                                                          ComSafeArrayAsInParam(otherMachine), Bstr("").raw()));
+    uint64_t msStart = RTTimeMilliTS();
+    TST_COM_EXPR(ptrSessionMachine->SetExtraData(Bstr("tstVBoxAPI/Key").raw(), Bstr("1").raw()));
+    uint64_t cMsElapsed = RTTimeMilliTS() - msStart;
+    /* Unprocessed events make the caller wait for 3 seconds. */
+    if (cMsElapsed >= 2000)
+        RTTestFailed(g_hTest, "Setting extra data took %RU64 ms, the filtered event was not completed", cMsElapsed);
+    ComPtr<IEvent> ptrEvent;
+    TST_COM_EXPR(ptrEventSource->GetEvent(ptrListener, 0 /* aTimeout */, ptrEvent.asOutParam()));
+    if (ptrEvent.isNotNull())
+        RTTestFailed(g_hTest, "The filtered event was delivered");
+    TST_COM_EXPR(ptrEventSource->UnregisterListener(ptrListener));
+
+    /*
+     * A passive listener not picking up its events gets unregistered, which
+     * getEvent() reports until it is unregistered.
+     */
+    RTTestSub(g_hTest, "IEventSource queue overflow");
+    ptrListener.setNull();
+    TST_COM_EXPR(ptrEventSource->CreateListener(ptrListener.asOutParam()));
+    TST_COM_EXPR(ptrEventSource->RegisterListener(ptrListener, ComSafeArrayAsInParam(guestPropertyEvents),
+                                                  FALSE /* active */));
+    for (unsigned i = 0; i < 1100; i++)
+        TST_COM_EXPR(ptrSessionMachine->SetGuestProperty(Bstr("/tstVBoxAPI/C").raw(), BstrFmt("%u", i).raw(),
+                                                         Bstr("").raw()));
+    ptrEvent.setNull();
+    HRESULT hrc = ptrEventSource->GetEvent(ptrListener, 0 /* aTimeout */, ptrEvent.asOutParam());
+    if (hrc != VBOX_E_EVENT_QUEUE_OVERFLOW)
+        RTTestFailed(g_hTest, "GetEvent after an overflow returned %Rhrc, expected VBOX_E_EVENT_QUEUE_OVERFLOW", hrc);
+    TST_COM_EXPR(ptrEventSource->UnregisterListener(ptrListener));
+    hrc = ptrEventSource->GetEvent(ptrListener, 0 /* aTimeout */, ptrEvent.asOutParam());
+    if (hrc != VBOX_E_OBJECT_NOT_FOUND)
+        RTTestFailed(g_hTest, "GetEvent after unregistering returned %Rhrc, expected VBOX_E_OBJECT_NOT_FOUND", hrc);
+
+    TST_COM_EXPR(pSession->UnlockMachine());
+    return TRUE;
+}
+
+
 static BOOL tstApiClean(IVirtualBox *pVBox)
 {
     HRESULT rc;
@@ -388,6 +544,8 @@ int main()
                 /** Test IVirtualBox interface */
                 tstApiIVirtualBox(ptrVBox);
 
+                /** Test IEventSource listener filters and queues */
+                tstApiIEventSource(ptrVBox, ptrSession);
 
                 /** Clean files/configs */
                 tstApiClean(ptrVBox);
@@ -36,11 +36,31 @@
 #include <iprt/critsect.h>
 #include <iprt/err.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
+#include <iprt/once.h>
 #include <iprt/param.h>
+#include <iprt/string.h>
+#include <iprt/thread.h>
 
 #include "internal/magics.h"
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The number of objects a magazine can hold.
+ * Chosen so that a magazine is 512 bytes on 64-bit hosts and that a slot can
+ * absorb bursts of around a hundred objects without going to the depot. */
+#define RTMEMCACHE_MAG_SIZE             63
+/** The max number of slots (magazine pairs) per cache. */
+#define RTMEMCACHE_MAX_SLOTS            256
+/** The max number of full magazines kept in the depot per slot.  Anything
+ * beyond this is flushed back to the pages. */
+#define RTMEMCACHE_DEPOT_FULL_PER_SLOT  4
+/** The max number of empty magazines kept in the depot per slot. */
+#define RTMEMCACHE_DEPOT_EMPTY_PER_SLOT 2
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
@@ -52,18 +72,64 @@ typedef struct RTMEMCACHEPAGE *PRTMEMCACHEPAGE;
 
 
 /**
- * A free object.
+ * A magazine, i.e. a small stack of objects.
  *
- * @remarks This only works if the objects don't have a constructor or
- *          destructor and are big enough.
+ * The objects in a magazine are allocated as far as the pages are concerned
+ * and have been through the constructor.
  */
-typedef struct RTMEMCACHEFREEOBJ
+typedef struct RTMEMCACHEMAG
 {
-    /** Pointer to the next free object  */
-    struct RTMEMCACHEFREEOBJ * volatile pNext;
-} RTMEMCACHEFREEOBJ;
-/** Pointer to a free object. */
-typedef RTMEMCACHEFREEOBJ *PRTMEMCACHEFREEOBJ;
+    /** Pointer to the next magazine in the depot list. */
+    struct RTMEMCACHEMAG       *pNext;
+    /** The number of objects in the magazine. */
+    uint32_t                    cObjs;
+    /** Explicit padding. */
+    uint32_t                    u32Padding;
+    /** The objects. */
+    void                       *apvObjs[RTMEMCACHE_MAG_SIZE];
+} RTMEMCACHEMAG;
+/** Pointer to a magazine. */
+typedef RTMEMCACHEMAG *PRTMEMCACHEMAG;
+
+
+/**
+ * A magazine slot.
+ *
+ * Each thread is assigned a number on first use (shared by all caches) and
+ * that picks the slot, so as long as there are fewer threads than slots each
+ * thread has its own and the cache line stays with the CPU the thread runs
+ * on.  A slot is owned by whoever manages to set fBusy; when that fails the
+ * caller tries the neighbouring slot and then bypasses the magazine layer.
+ *
+ * The layout follows Bonwick's magazine design: allocations and frees are
+ * served by the loaded magazine; the previous magazine is always either full
+ * or empty and is swapped in when the loaded one runs dry or overflows.  Only
+ * when both are exhausted do we exchange a magazine with the depot.
+ */
+typedef struct RTMEMCACHESLOT
+{
+    /** Set while owned by a thread. */
+    uint32_t volatile           fBusy;
+    /** Explicit padding. */
+    uint32_t                    u32Padding;
+    /** The loaded magazine, partially filled.  NULL if none. */
+    PRTMEMCACHEMAG              pLoaded;
+    /** The previous magazine, always full or empty.  NULL if none. */
+    PRTMEMCACHEMAG              pPrevious;
+    /** Statistics: Allocations served by the magazines. */
+    uint64_t                    cAllocHits;
+    /** Statistics: Frees served by the magazines. */
+    uint64_t                    cFreeHits;
+    /** Statistics: Magazine exchanges with the depot. */
+    uint64_t                    cDepotExchanges;
+    /** Statistics: Bulk refills of the loaded magazine from the pages. */
+    uint64_t                    cRefills;
+    /** Padding the structure up to a cache line (ASSUMES CL = 64). */
+    uint8_t                     abPadding[64 - 8 - 2 * sizeof(void *) - 4 * 8];
+} RTMEMCACHESLOT;
+AssertCompileSize(RTMEMCACHESLOT, 64);
+/** Pointer to a magazine slot. */
+typedef RTMEMCACHESLOT *PRTMEMCACHESLOT;
 
 
 /**
@@ -118,8 +184,6 @@ typedef struct RTMEMCACHEINT
     uint32_t                    cBits;
     /** The maximum number of objects. */
     uint32_t                    cMax;
-    /** Whether to the use the free list or not. */
-    bool                        fUseFreeList;
     /** Head of the page list. */
     PRTMEMCACHEPAGE             pPageHead;
     /** Poiner to the insertion point in the page list. */
@@ -139,20 +203,63 @@ typedef struct RTMEMCACHEINT
     int32_t volatile            cFree;
     /** This may point to a page with free entries. */
     PRTMEMCACHEPAGE volatile    pPageHint;
-    /** Stack of free items.
-     * These are marked as used in the allocation bitmaps.
-     *
-     * @todo This doesn't scale well when several threads are beating on the
-     *       cache.  Also, it totally doesn't work when the objects are too
-     *       small. */
-    PRTMEMCACHEFREEOBJ volatile pFreeTop;
+    /** The number of pages. */
+    uint32_t volatile           cPages;
+
+    /** The magazine slots (cache line aligned), NULL if not using magazines. */
+    PRTMEMCACHESLOT             paSlots;
+    /** The slot index mask (number of slots - 1). */
+    uint32_t                    fSlotMask;
+    /** Max number of full magazines in the depot. */
+    uint32_t                    cMaxDepotFull;
+    /** Max number of empty magazines in the depot. */
+    uint32_t                    cMaxDepotEmpty;
+    /** The number of full magazines in the depot. */
+    uint32_t volatile           cDepotFull;
+    /** The number of empty magazines in the depot. */
+    uint32_t                    cDepotEmpty;
+    /** List of full magazines in the depot (protected by CritSect). */
+    PRTMEMCACHEMAG              pDepotFull;
+    /** List of empty magazines in the depot (protected by CritSect). */
+    PRTMEMCACHEMAG              pDepotEmpty;
+    /** Statistics: Number of times a slot was busy and the magazines had to be
+     * bypassed. */
+    uint64_t volatile           cSlotBusy;
+    /** Statistics: Number of full magazines flushed back to the pages. */
+    uint64_t volatile           cFlushes;
+    /** Statistics: Number of reclaim runs. */
+    uint64_t volatile           cReclaims;
+    /** The memory backing paSlots. */
+    void                       *pvSlotsAlloc;
 } RTMEMCACHEINT;
 
 
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Initialize g_iMemCacheThreadTls once. */
+static RTONCE               g_MemCacheOnce = RTONCE_INITIALIZER;
+/** TLS entry holding the slot number of the calling thread (plus one). */
+static RTTLS                g_iMemCacheThreadTls = NIL_RTTLS;
+/** Slot number allocator. */
+static uint32_t volatile    g_cMemCacheThreads = 0;
+
+
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
 *********************************************************************************************************************************/
-static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead);
+static void rtMemCacheFreeOne(RTMEMCACHEINT *pThis, void *pvObj);
+
+
+/**
+ * @callback_method_impl{FNRTONCE, Allocates the slot number TLS entry.}
+ */
+static DECLCALLBACK(int) rtMemCacheInitOnce(void *pvUser)
+{
+    RT_NOREF_PV(pvUser);
+    g_iMemCacheThreadTls = RTTlsAlloc();
+    return g_iMemCacheThreadTls != NIL_RTTLS ? VINF_SUCCESS : VERR_NO_MEMORY;
+}
 
 
 RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbAlignment, uint32_t cMaxObjects,
@@ -212,9 +319,6 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
         pThis->cPerPage--;
     pThis->cBits            = RT_ALIGN(pThis->cPerPage, 64);
     pThis->cMax             = cMaxObjects;
-    pThis->fUseFreeList     = cbObject >= sizeof(RTMEMCACHEFREEOBJ)
-                           && !pfnCtor
-                           && !pfnDtor;
     pThis->pPageHead        = NULL;
     pThis->ppPageNext       = &pThis->pPageHead;
     pThis->pfnCtor          = pfnCtor;
@@ -223,7 +327,40 @@ RTDECL(int) RTMemCacheCreate(PRTMEMCACHE phMemCache, size_t cbObject, size_t cbA
     pThis->cTotal           = 0;
     pThis->cFree            = 0;
     pThis->pPageHint        = NULL;
-    pThis->pFreeTop         = NULL;
+    pThis->cPages           = 0;
+    pThis->fSlotMask        = 0;
+    pThis->cMaxDepotFull    = 0;
+    pThis->cMaxDepotEmpty   = 0;
+    pThis->cDepotFull       = 0;
+    pThis->cDepotEmpty      = 0;
+    pThis->pDepotFull       = NULL;
+    pThis->pDepotEmpty      = NULL;
+    pThis->cSlotBusy        = 0;
+    pThis->cFlushes         = 0;
+    pThis->cReclaims        = 0;
+
+    /*
+     * Allocate the magazine slots.  Two per CPU since there are usually more
+     * threads than CPUs using a cache.  If this fails we just run without
+     * magazines.
+     */
+    uint32_t cSlots = RTMpGetCount() * 2;
+    cSlots = RT_MIN(RT_MAX(cSlots, 2), RTMEMCACHE_MAX_SLOTS);
+    if (!RT_IS_POWER_OF_TWO(cSlots))
+        cSlots = RT_BIT_32(ASMBitLastSetU32(cSlots));
+    cSlots = RT_MIN(cSlots, RTMEMCACHE_MAX_SLOTS);
+    pThis->pvSlotsAlloc     = NULL;
+    if (RT_SUCCESS(RTOnce(&g_MemCacheOnce, rtMemCacheInitOnce, NULL)))
+        pThis->pvSlotsAlloc = RTMemAllocZ(cSlots * sizeof(RTMEMCACHESLOT) + 64);
+    if (pThis->pvSlotsAlloc)
+    {
+        pThis->paSlots        = RT_ALIGN_PT(pThis->pvSlotsAlloc, 64, PRTMEMCACHESLOT);
+        pThis->fSlotMask      = cSlots - 1;
+        pThis->cMaxDepotFull  = cSlots * RTMEMCACHE_DEPOT_FULL_PER_SLOT;
+        pThis->cMaxDepotEmpty = cSlots * RTMEMCACHE_DEPOT_EMPTY_PER_SLOT;
+    }
+    else
+        pThis->paSlots        = NULL;
 
     *phMemCache = pThis;
     return VINF_SUCCESS;
@@ -238,19 +375,32 @@ RTDECL(int) RTMemCacheDestroy(RTMEMCACHE hMemCache)
     AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
     AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_HANDLE);
 
-#if 0 /*def RT_STRICT - don't require eveything to be freed. Caches are very convenient for lazy cleanup. */
-    uint32_t cFree = pThis->cFree;
-    for (PRTMEMCACHEFREEOBJ pFree = pThis->pFreeTop; pFree && cFree < pThis->cTotal + 5; pFree = pFree->pNext)
-        cFree++;
-    AssertMsg(cFree == pThis->cTotal, ("cFree=%u cTotal=%u\n", cFree, pThis->cTotal));
-#endif
-
     /*
      * Destroy it.
      */
     AssertReturn(ASMAtomicCmpXchgU32(&pThis->u32Magic, RTMEMCACHE_MAGIC_DEAD, RTMEMCACHE_MAGIC), VERR_INVALID_HANDLE);
     RTCritSectDelete(&pThis->CritSect);
 
+    /* The magazines.  The objects in them are still marked as allocated and
+       constructed in the pages, so the destructor loop below covers them. */
+    if (pThis->paSlots)
+    {
+        for (uint32_t iSlot = 0; iSlot <= pThis->fSlotMask; iSlot++)
+        {
+            RTMemFree(pThis->paSlots[iSlot].pLoaded);
+            RTMemFree(pThis->paSlots[iSlot].pPrevious);
+        }
+        RTMemFree(pThis->pvSlotsAlloc);
+    }
+    PRTMEMCACHEMAG apHeads[2] = { pThis->pDepotFull, pThis->pDepotEmpty };
+    for (unsigned i = 0; i < RT_ELEMENTS(apHeads); i++)
+        while (apHeads[i])
+        {
+            PRTMEMCACHEMAG pMag = apHeads[i];
+            apHeads[i] = pMag->pNext;
+            RTMemFree(pMag);
+        }
+
     while (pThis->pPageHead)
     {
         PRTMEMCACHEPAGE pPage = pThis->pPageHead;
@@ -333,6 +483,7 @@ static int rtMemCacheGrow(RTMEMCACHEINT *pThis)
             /* Add it to the page counts. */
             ASMAtomicAddS32(&pThis->cFree, cObjects);
             ASMAtomicAddU32(&pThis->cTotal, cObjects);
+            ASMAtomicIncU32(&pThis->cPages);
         }
         else
             rc = VERR_NO_MEMORY;
@@ -360,35 +511,15 @@ DECL_FORCE_INLINE(int32_t) rtMemCacheGrabObj(PRTMEMCACHEPAGE pPage)
 }
 
 
-RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+/**
+ * Allocates an object from the pages, growing the cache if necessary.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The memory cache instance.
+ * @param   ppvObj              Where to return the object.
+ */
+static int rtMemCacheAllocFromPages(RTMEMCACHEINT *pThis, void **ppvObj)
 {
-    RTMEMCACHEINT *pThis = hMemCache;
-    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
-    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
-
-    /*
-     * Try grab a free object from the stack.
-     */
-    PRTMEMCACHEFREEOBJ pObj = ASMAtomicUoReadPtrT(&pThis->pFreeTop, PRTMEMCACHEFREEOBJ);
-    if (pObj)
-    {
-        pObj = ASMAtomicXchgPtrT(&pThis->pFreeTop, NULL, PRTMEMCACHEFREEOBJ);
-        if (pObj)
-        {
-            if (pObj->pNext)
-            {
-                Assert(pObj->pNext != pObj);
-                PRTMEMCACHEFREEOBJ pAllocRace = ASMAtomicXchgPtrT(&pThis->pFreeTop, pObj->pNext, PRTMEMCACHEFREEOBJ);
-                if (pAllocRace)
-                    rtMemCacheFreeList(pThis, pAllocRace);
-            }
-
-            pObj->pNext = NULL;
-            *ppvObj = pObj;
-            return VINF_SUCCESS;
-        }
-    }
-
     /*
      * Try grab a free object at the cache level.
      */
@@ -468,11 +599,12 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
     if (   pThis->pfnCtor
         && !ASMAtomicBitTestAndSet(pPage->pbmCtor, iObj))
     {
-        int rc = pThis->pfnCtor(hMemCache, pvObj, pThis->pvUser);
+        int rc = pThis->pfnCtor(pThis, pvObj, pThis->pvUser);
         if (RT_FAILURE(rc))
         {
+            /* Straight back to the page, it must not end up in a magazine. */
             ASMAtomicBitClear(pPage->pbmCtor, iObj);
-            RTMemCacheFree(pThis, pvObj);
+            rtMemCacheFreeOne(pThis, pvObj);
             return rc;
         }
     }
@@ -482,6 +614,285 @@ RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
 }
 
 
+/**
+ * Tries to take ownership of the slot of the calling thread.
+ *
+ * @returns Pointer to the slot on success, NULL if busy (or no magazines).
+ * @param   pThis               The memory cache instance.
+ */
+DECLINLINE(PRTMEMCACHESLOT) rtMemCacheSlotAcquire(RTMEMCACHEINT *pThis)
+{
+    if (!pThis->paSlots)
+        return NULL;
+
+    uintptr_t uSlot = (uintptr_t)RTTlsGet(g_iMemCacheThreadTls);
+    if (RT_UNLIKELY(!uSlot))
+    {
+        uSlot = ASMAtomicIncU32(&g_cMemCacheThreads);
+        RTTlsSet(g_iMemCacheThreadTls, (void *)uSlot);
+    }
+
+    PRTMEMCACHESLOT pSlot = &pThis->paSlots[uSlot & pThis->fSlotMask];
+    if (RT_LIKELY(ASMAtomicCmpXchgU32(&pSlot->fBusy, 1, 0)))
+        return pSlot;
+    pSlot = &pThis->paSlots[(uSlot + 1) & pThis->fSlotMask];
+    if (ASMAtomicCmpXchgU32(&pSlot->fBusy, 1, 0))
+        return pSlot;
+
+    ASMAtomicIncU64(&pThis->cSlotBusy);
+    return NULL;
+}
+
+
+/**
+ * Releases a slot acquired by rtMemCacheSlotAcquire.
+ */
+DECLINLINE(void) rtMemCacheSlotRelease(PRTMEMCACHESLOT pSlot)
+{
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+    /* Stores aren't reordered with older loads and stores on x86, so there is
+       no need for a locked instruction here. */
+    ASMCompilerBarrier();
+    ASMAtomicUoWriteU32(&pSlot->fBusy, 0);
+#else
+    ASMAtomicWriteU32(&pSlot->fBusy, 0);
+#endif
+}
+
+
+/**
+ * Returns the objects of a magazine to the pages.
+ *
+ * @param   pThis               The memory cache instance.
+ * @param   pMag                The magazine.
+ */
+static void rtMemCacheMagFlush(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pMag)
+{
+    uint32_t i = pMag->cObjs;
+    while (i-- > 0)
+        rtMemCacheFreeOne(pThis, pMag->apvObjs[i]);
+    pMag->cObjs = 0;
+}
+
+
+/**
+ * Trades a full magazine for an empty one at the depot.
+ *
+ * If the depot already has enough full magazines, the objects are returned to
+ * the pages instead.
+ *
+ * @returns Pointer to an empty magazine, NULL if out of memory.  @a pFull is
+ *          handed in even then, so the caller must forget about it either way.
+ * @param   pThis               The memory cache instance.
+ * @param   pFull               The full magazine to hand in.  Optional.
+ */
+static PRTMEMCACHEMAG rtMemCacheDepotTradeFull(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pFull)
+{
+    RTCritSectEnter(&pThis->CritSect);
+    PRTMEMCACHEMAG pEmpty = pThis->pDepotEmpty;
+    if (pEmpty)
+    {
+        pThis->pDepotEmpty = pEmpty->pNext;
+        pThis->cDepotEmpty--;
+    }
+    if (pFull && pThis->cDepotFull < pThis->cMaxDepotFull)
+    {
+        pFull->pNext = pThis->pDepotFull;
+        pThis->pDepotFull = pFull;
+        ASMAtomicIncU32(&pThis->cDepotFull);
+        pFull = NULL;
+    }
+    RTCritSectLeave(&pThis->CritSect);
+
+    if (pFull)
+    {
+        /* Bulk flush; reuse the magazine if the depot didn't have an empty one. */
+        rtMemCacheMagFlush(pThis, pFull);
+        ASMAtomicIncU64(&pThis->cFlushes);
+        if (!pEmpty)
+            pEmpty = pFull;
+        else
+            RTMemFree(pFull);
+    }
+    else if (!pEmpty)
+        pEmpty = (PRTMEMCACHEMAG)RTMemAllocZ(sizeof(*pEmpty));
+    return pEmpty;
+}
+
+
+/**
+ * Trades an empty magazine for a full one at the depot.
+ *
+ * @returns Pointer to a full magazine, NULL if the depot has none.  In the
+ *          latter case the caller keeps @a pEmpty.
+ * @param   pThis               The memory cache instance.
+ * @param   pEmpty              The empty magazine to hand in.  Optional.
+ */
+static PRTMEMCACHEMAG rtMemCacheDepotTradeEmpty(RTMEMCACHEINT *pThis, PRTMEMCACHEMAG pEmpty)
+{
+    if (!ASMAtomicUoReadU32(&pThis->cDepotFull))
+        return NULL;
+
+    RTCritSectEnter(&pThis->CritSect);
+    PRTMEMCACHEMAG pFull = pThis->pDepotFull;
+    if (pFull)
+    {
+        pThis->pDepotFull = pFull->pNext;
+        ASMAtomicDecU32(&pThis->cDepotFull);
+        if (pEmpty && pThis->cDepotEmpty < pThis->cMaxDepotEmpty)
+        {
+            pEmpty->pNext = pThis->pDepotEmpty;
+            pThis->pDepotEmpty = pEmpty;
+            pThis->cDepotEmpty++;
+            pEmpty = NULL;
+        }
+    }
+    RTCritSectLeave(&pThis->CritSect);
+
+    if (pFull)
+        RTMemFree(pEmpty);
+    return pFull;
+}
+
+
+/**
+ * Allocates an object from the magazines of an owned slot.
+ *
+ * @returns Pointer to the object, NULL if the caller should go to the pages.
+ * @param   pThis               The memory cache instance.
+ * @param   pSlot               The slot, owned by the caller.
+ */
+static void *rtMemCacheSlotAlloc(RTMEMCACHEINT *pThis, PRTMEMCACHESLOT pSlot)
+{
+    PRTMEMCACHEMAG pLoaded = pSlot->pLoaded;
+    if (RT_LIKELY(pLoaded && pLoaded->cObjs > 0))
+    {
+        pSlot->cAllocHits++;
+        return pLoaded->apvObjs[--pLoaded->cObjs];
+    }
+
+    PRTMEMCACHEMAG pPrevious = pSlot->pPrevious;
+    if (pPrevious && pPrevious->cObjs > 0)
+    {
+        pSlot->pLoaded   = pPrevious;
+        pSlot->pPrevious = pLoaded;
+        pSlot->cAllocHits++;
+        return pPrevious->apvObjs[--pPrevious->cObjs];
+    }
+
+    /*
+     * Both are empty (or missing), try get a full one from the depot.
+     */
+    PRTMEMCACHEMAG pFull = rtMemCacheDepotTradeEmpty(pThis, pPrevious);
+    if (pFull)
+    {
+        pSlot->pPrevious = pLoaded;
+        pSlot->pLoaded   = pFull;
+        pSlot->cDepotExchanges++;
+        pSlot->cAllocHits++;
+        return pFull->apvObjs[--pFull->cObjs];
+    }
+
+    /*
+     * Bulk refill the loaded magazine from the pages, leaving half of it for
+     * frees.  The first object goes to the caller.
+     */
+    if (pLoaded)
+    {
+        void *pvObj;
+        if (RT_FAILURE(rtMemCacheAllocFromPages(pThis, &pvObj)))
+            return NULL;
+        while (pLoaded->cObjs < RTMEMCACHE_MAG_SIZE / 2)
+        {
+            void *pvExtra;
+            if (RT_FAILURE(rtMemCacheAllocFromPages(pThis, &pvExtra)))
+                break;
+            pLoaded->apvObjs[pLoaded->cObjs++] = pvExtra;
+        }
+        pSlot->cRefills++;
+        return pvObj;
+    }
+    return NULL;
+}
+
+
+/**
+ * Returns objects sitting in the depot and in idle slots to the pages.
+ *
+ * This is done when a bounded cache hits its limit, as the objects might just
+ * be parked in the magazines of other threads.
+ *
+ * @param   pThis               The memory cache instance.
+ */
+static void rtMemCacheReclaim(RTMEMCACHEINT *pThis)
+{
+    ASMAtomicIncU64(&pThis->cReclaims);
+
+    RTCritSectEnter(&pThis->CritSect);
+    PRTMEMCACHEMAG pFull = pThis->pDepotFull;
+    pThis->pDepotFull = NULL;
+    ASMAtomicWriteU32(&pThis->cDepotFull, 0);
+    RTCritSectLeave(&pThis->CritSect);
+
+    while (pFull)
+    {
+        PRTMEMCACHEMAG pNext = pFull->pNext;
+        rtMemCacheMagFlush(pThis, pFull);
+        RTMemFree(pFull);
+        pFull = pNext;
+    }
+
+    for (uint32_t iSlot = 0; iSlot <= pThis->fSlotMask; iSlot++)
+    {
+        PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+        if (ASMAtomicCmpXchgU32(&pSlot->fBusy, 1, 0))
+        {
+            if (pSlot->pLoaded)
+                rtMemCacheMagFlush(pThis, pSlot->pLoaded);
+            if (pSlot->pPrevious)
+                rtMemCacheMagFlush(pThis, pSlot->pPrevious);
+            rtMemCacheSlotRelease(pSlot);
+        }
+    }
+}
+
+
+RTDECL(int) RTMemCacheAllocEx(RTMEMCACHE hMemCache, void **ppvObj)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_PARAMETER);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_PARAMETER);
+
+    /*
+     * Try the magazines first.
+     */
+    PRTMEMCACHESLOT pSlot = rtMemCacheSlotAcquire(pThis);
+    if (pSlot)
+    {
+        void *pvObj = rtMemCacheSlotAlloc(pThis, pSlot);
+        rtMemCacheSlotRelease(pSlot);
+        if (pvObj)
+        {
+            *ppvObj = pvObj;
+            return VINF_SUCCESS;
+        }
+    }
+
+    /*
+     * Go to the pages.  If we've hit the limit, check whether the magazines
+     * are hoarding objects before giving up.
+     */
+    int rc = rtMemCacheAllocFromPages(pThis, ppvObj);
+    if (   rc == VERR_MEM_CACHE_MAX_SIZE
+        && pThis->paSlots)
+    {
+        rtMemCacheReclaim(pThis);
+        rc = rtMemCacheAllocFromPages(pThis, ppvObj);
+    }
+    return rc;
+}
+
+
 RTDECL(void *) RTMemCacheAlloc(RTMEMCACHE hMemCache)
 {
     void *pvObj;
@@ -525,21 +936,50 @@ static void rtMemCacheFreeOne(RTMEMCACHEINT *pThis, void *pvObj)
 
 
 /**
- * Really frees a list of 'freed' object.
+ * Frees an object into the magazines of an owned slot.
  *
+ * @returns true if freed, false if the caller should free it to the page.
  * @param   pThis               The memory cache.
- * @param   pHead               The head of the list.
+ * @param   pSlot               The slot, owned by the caller.
+ * @param   pvObj               The memory object to free.
  */
-static void rtMemCacheFreeList(RTMEMCACHEINT *pThis, PRTMEMCACHEFREEOBJ pHead)
+static bool rtMemCacheSlotFree(RTMEMCACHEINT *pThis, PRTMEMCACHESLOT pSlot, void *pvObj)
 {
-    while (pHead)
+    PRTMEMCACHEMAG pLoaded = pSlot->pLoaded;
+    if (RT_LIKELY(pLoaded && pLoaded->cObjs < RTMEMCACHE_MAG_SIZE))
+    {
+        pLoaded->apvObjs[pLoaded->cObjs++] = pvObj;
+        pSlot->cFreeHits++;
+        return true;
+    }
+
+    PRTMEMCACHEMAG pPrevious = pSlot->pPrevious;
+    if (pPrevious && pPrevious->cObjs == 0)
+    {
+        pSlot->pLoaded   = pPrevious;
+        pSlot->pPrevious = pLoaded;
+        pPrevious->apvObjs[pPrevious->cObjs++] = pvObj;
+        pSlot->cFreeHits++;
+        return true;
+    }
+
+    /*
+     * Both are full (or missing), hand the previous one to the depot in
+     * exchange for an empty one.
+     */
+    PRTMEMCACHEMAG pEmpty = rtMemCacheDepotTradeFull(pThis, pPrevious);
+    if (!pEmpty)
     {
-        PRTMEMCACHEFREEOBJ pFreeMe = pHead;
-        pHead = pHead->pNext;
-        pFreeMe->pNext = NULL;
-        ASMCompilerBarrier();
-        rtMemCacheFreeOne(pThis, pFreeMe);
+        /* The previous magazine is in the depot now. */
+        pSlot->pPrevious = NULL;
+        return false;
     }
+    pSlot->pPrevious = pLoaded;
+    pSlot->pLoaded   = pEmpty;
+    pSlot->cDepotExchanges++;
+    pEmpty->apvObjs[pEmpty->cObjs++] = pvObj;
+    pSlot->cFreeHits++;
+    return true;
 }
 
 
@@ -556,30 +996,72 @@ RTDECL(void) RTMemCacheFree(RTMEMCACHE hMemCache, void *pvObj)
     AssertPtr(pvObj);
     Assert(RT_ALIGN_P(pvObj, pThis->cbAlignment) == pvObj);
 
-    if (!pThis->fUseFreeList)
-        rtMemCacheFreeOne(pThis, pvObj);
-    else
+#ifdef RT_STRICT
+    /* Catch double frees and strangers here rather than when the object
+       eventually leaves the magazine. */
+    PRTMEMCACHEPAGE pPage = (PRTMEMCACHEPAGE)(((uintptr_t)pvObj) & ~(uintptr_t)PAGE_OFFSET_MASK);
+    Assert(pPage->pCache == pThis);
+    Assert(ASMAtomicUoReadS32(&pPage->cFree) < (int32_t)pThis->cPerPage);
+    uintptr_t offObj = (uintptr_t)pvObj - (uintptr_t)pPage->pbObjects;
+    uintptr_t iObj   = offObj / pThis->cbObject;
+    Assert(iObj * pThis->cbObject == offObj);
+    Assert(iObj < pThis->cPerPage);
+    AssertReturnVoid(ASMBitTest(pPage->pbmAlloc, (int32_t)iObj));
+#endif
+
+    PRTMEMCACHESLOT pSlot = rtMemCacheSlotAcquire(pThis);
+    if (pSlot)
     {
-# ifdef RT_STRICT
-        /* This is the same as the other branch, except it's not actually freed. */
-        PRTMEMCACHEPAGE pPage = (PRTMEMCACHEPAGE)(((uintptr_t)pvObj) & ~(uintptr_t)PAGE_OFFSET_MASK);
-        Assert(pPage->pCache == pThis);
-        Assert(ASMAtomicUoReadS32(&pPage->cFree) < (int32_t)pThis->cPerPage);
-        uintptr_t offObj = (uintptr_t)pvObj - (uintptr_t)pPage->pbObjects;
-        uintptr_t iObj   = offObj / pThis->cbObject;
-        Assert(iObj * pThis->cbObject == offObj);
-        Assert(iObj < pThis->cPerPage);
-        AssertReturnVoid(ASMBitTest(pPage->pbmAlloc, (int32_t)iObj));
-# endif
+        bool fFreed = rtMemCacheSlotFree(pThis, pSlot, pvObj);
+        rtMemCacheSlotRelease(pSlot);
+        if (fFreed)
+            return;
+    }
+    rtMemCacheFreeOne(pThis, pvObj);
+}
 
-        /*
-         * Push it onto the free stack.
-         */
-        PRTMEMCACHEFREEOBJ pObj = (PRTMEMCACHEFREEOBJ)pvObj;
-        pObj->pNext = ASMAtomicXchgPtrT(&pThis->pFreeTop, NULL, PRTMEMCACHEFREEOBJ);
-        PRTMEMCACHEFREEOBJ pFreeRace = ASMAtomicXchgPtrT(&pThis->pFreeTop, pObj, PRTMEMCACHEFREEOBJ);
-        if (pFreeRace)
-            rtMemCacheFreeList(pThis, pFreeRace);
+
+RTDECL(int) RTMemCacheQueryStats(RTMEMCACHE hMemCache, PRTMEMCACHESTATS pStats)
+{
+    RTMEMCACHEINT *pThis = hMemCache;
+    AssertPtrReturn(pThis, VERR_INVALID_HANDLE);
+    AssertReturn(pThis->u32Magic == RTMEMCACHE_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pStats, VERR_INVALID_POINTER);
+
+    /*
+     * The numbers are only a snapshot, but the magazines are only looked at
+     * while owning the slot (or depot) they belong to.
+     */
+    RT_ZERO(*pStats);
+    pStats->cbObject        = pThis->cbObject;
+    pStats->cPages          = ASMAtomicReadU32(&pThis->cPages);
+    pStats->cTotal          = ASMAtomicReadU32(&pThis->cTotal);
+    pStats->cFree           = (uint32_t)RT_MAX(ASMAtomicReadS32(&pThis->cFree), 0);
+    pStats->cSlots          = pThis->paSlots ? pThis->fSlotMask + 1 : 0;
+    pStats->cSlotBusy       = ASMAtomicReadU64(&pThis->cSlotBusy);
+    pStats->cFlushes        = ASMAtomicReadU64(&pThis->cFlushes);
+    pStats->cReclaims       = ASMAtomicReadU64(&pThis->cReclaims);
+
+    RTCritSectEnter(&pThis->CritSect);
+    for (PRTMEMCACHEMAG pMag = pThis->pDepotFull; pMag; pMag = pMag->pNext)
+        pStats->cMagazineObjs += pMag->cObjs;
+    RTCritSectLeave(&pThis->CritSect);
+
+    for (uint32_t iSlot = 0; iSlot < pStats->cSlots; iSlot++)
+    {
+        PRTMEMCACHESLOT pSlot = &pThis->paSlots[iSlot];
+        while (!ASMAtomicCmpXchgU32(&pSlot->fBusy, 1, 0))
+            ASMNopPause(); /* The owners never hold it for long. */
+        if (pSlot->pLoaded)
+            pStats->cMagazineObjs += pSlot->pLoaded->cObjs;
+        if (pSlot->pPrevious)
+            pStats->cMagazineObjs += pSlot->pPrevious->cObjs;
+        pStats->cAllocHits      += pSlot->cAllocHits;
+        pStats->cFreeHits       += pSlot->cFreeHits;
+        pStats->cDepotExchanges += pSlot->cDepotExchanges;
+        pStats->cRefills        += pSlot->cRefills;
+        rtMemCacheSlotRelease(pSlot);
     }
+    return VINF_SUCCESS;
 }
 
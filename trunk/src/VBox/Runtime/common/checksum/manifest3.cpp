@@ -38,15 +38,34 @@
 #include <iprt/file.h>
 #include <iprt/md5.h>
 #include <iprt/mem.h>
+#include <iprt/semaphore.h>
 #include <iprt/sha.h>
 #include <iprt/string.h>
+#include <iprt/thread.h>
 #include <iprt/vfs.h>
 #include <iprt/vfslowlevel.h>
 
 
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The stream size at which we hand the hashing over to worker threads.
+ * Smaller streams (the OVF, manifest, certificate) are hashed synchronously. */
+#define RTMANIFEST_ASYNC_THRESHOLD      _4M
+/** The number of buffers in the hashing ring. */
+#define RTMANIFEST_ASYNC_BUFFERS        4
+/** The size of each buffer in the hashing ring. */
+#define RTMANIFEST_ASYNC_BUFFER_SIZE    _1M
+/** The max number of hashing workers (one per digest type). */
+#define RTMANIFEST_ASYNC_MAX_WORKERS    4
+
+
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+/** Pointer to the asynchronous hashing state. */
+typedef struct RTMANIFESTHASHASYNC *PRTMANIFESTHASHASYNC;
+
 /**
  * Hashes data.
  *
@@ -77,11 +96,76 @@ typedef struct RTMANIFESTHASHES
     uint8_t         abSha256Digest[RTSHA256_HASH_SIZE];
     /** The SHA-512 digest. */
     uint8_t         abSha512Digest[RTSHA512_HASH_SIZE];
+
+    /** The asynchronous hashing state, NULL if hashing on the caller's thread. */
+    PRTMANIFESTHASHASYNC pAsync;
+    /** Set if we failed to start the asynchronous hashing and shouldn't retry. */
+    bool            fNoAsync;
 } RTMANIFESTHASHES;
 /** Pointer to a the hashes for a stream. */
 typedef RTMANIFESTHASHES *PRTMANIFESTHASHES;
 
 
+/**
+ * A buffer in the asynchronous hashing ring.
+ */
+typedef struct RTMANIFESTHASHBUF
+{
+    /** The buffer memory (RTMANIFEST_ASYNC_BUFFER_SIZE bytes). */
+    uint8_t            *pbBuf;
+    /** The number of valid bytes, set when submitted. */
+    size_t              cbBuf;
+    /** The number of workers that haven't yet processed the buffer. */
+    uint32_t volatile   cPending;
+} RTMANIFESTHASHBUF;
+
+/**
+ * A hashing worker thread, one for each digest type.
+ */
+typedef struct RTMANIFESTHASHWORKER
+{
+    /** Pointer to the asynchronous hashing state. */
+    PRTMANIFESTHASHASYNC pAsync;
+    /** The digest this worker calculates (RTMANIFEST_ATTR_XXX, single bit). */
+    uint32_t            fAttr;
+    /** The event semaphore the worker waits on for more buffers. */
+    RTSEMEVENT          hEvtWork;
+    /** The worker thread. */
+    RTTHREAD            hThread;
+} RTMANIFESTHASHWORKER;
+/** Pointer to a hashing worker. */
+typedef RTMANIFESTHASHWORKER *PRTMANIFESTHASHWORKER;
+
+/**
+ * Asynchronous hashing state.
+ *
+ * The thread doing the I/O copies the data into a small ring of buffers which
+ * are then processed by one worker thread per digest type, so that the digests
+ * are calculated in parallel with each other and with the I/O.  Each worker
+ * works exclusively on its own hash context, so the only thing shared is the
+ * buffer ring.
+ */
+typedef struct RTMANIFESTHASHASYNC
+{
+    /** The hashes structure we're working for. */
+    PRTMANIFESTHASHES   pHashes;
+    /** Number of buffers submitted thus far (index of the one being filled). */
+    uint32_t volatile   cSubmitted;
+    /** Set when the workers should quit after draining the ring. */
+    bool volatile       fTerminate;
+    /** Number of bytes in the buffer currently being filled. */
+    size_t              cbFill;
+    /** Event the I/O thread waits on when the ring is full. */
+    RTSEMEVENT          hEvtFree;
+    /** Number of workers. */
+    uint32_t            cWorkers;
+    /** The workers. */
+    RTMANIFESTHASHWORKER aWorkers[RTMANIFEST_ASYNC_MAX_WORKERS];
+    /** The buffer ring. */
+    RTMANIFESTHASHBUF   aBufs[RTMANIFEST_ASYNC_BUFFERS];
+} RTMANIFESTHASHASYNC;
+
+
 /**
  * The internal data of a manifest passthru I/O stream.
  */
@@ -134,26 +218,228 @@ static PRTMANIFESTHASHES rtManifestHashesCreate(uint32_t fAttrs)
 
 
 /**
- * Updates the hashes with a block of data.
+ * Updates the hash contexts selected by @a fAttrs with a block of data.
  *
  * @param   pHashes             The hashes structure.
+ * @param   fAttrs              The digests to update, RTMANIFEST_ATTR_XXX.
  * @param   pvBuf               The data block.
  * @param   cbBuf               The size of the data block.
  */
-static void rtManifestHashesUpdate(PRTMANIFESTHASHES pHashes, void const *pvBuf, size_t cbBuf)
+static void rtManifestHashesUpdateContexts(PRTMANIFESTHASHES pHashes, uint32_t fAttrs, void const *pvBuf, size_t cbBuf)
 {
-    pHashes->cbStream += cbBuf;
-    if (pHashes->fAttrs & RTMANIFEST_ATTR_MD5)
+    if (fAttrs & RTMANIFEST_ATTR_MD5)
         RTMd5Update(&pHashes->Md5Ctx, pvBuf, cbBuf);
-    if (pHashes->fAttrs & RTMANIFEST_ATTR_SHA1)
+    if (fAttrs & RTMANIFEST_ATTR_SHA1)
         RTSha1Update(&pHashes->Sha1Ctx, pvBuf, cbBuf);
-    if (pHashes->fAttrs & RTMANIFEST_ATTR_SHA256)
+    if (fAttrs & RTMANIFEST_ATTR_SHA256)
         RTSha256Update(&pHashes->Sha256Ctx, pvBuf, cbBuf);
-    if (pHashes->fAttrs & RTMANIFEST_ATTR_SHA512)
+    if (fAttrs & RTMANIFEST_ATTR_SHA512)
         RTSha512Update(&pHashes->Sha512Ctx, pvBuf, cbBuf);
 }
 
 
+/**
+ * Hashing worker thread.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf         The thread handle (ignored).
+ * @param   pvUser              The worker structure.
+ */
+static DECLCALLBACK(int) rtManifestHashesWorker(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTMANIFESTHASHWORKER pWorker = (PRTMANIFESTHASHWORKER)pvUser;
+    PRTMANIFESTHASHASYNC  pAsync  = pWorker->pAsync;
+    uint32_t              iNext   = 0;
+    RT_NOREF(hThreadSelf);
+
+    for (;;)
+    {
+        /* Check fTerminate before cSubmitted, the final buffer is submitted before it is set. */
+        bool const fTerminate = ASMAtomicReadBool(&pAsync->fTerminate);
+        if (iNext != ASMAtomicReadU32(&pAsync->cSubmitted))
+        {
+            RTMANIFESTHASHBUF *pBuf = &pAsync->aBufs[iNext % RTMANIFEST_ASYNC_BUFFERS];
+            rtManifestHashesUpdateContexts(pAsync->pHashes, pWorker->fAttr, pBuf->pbBuf, pBuf->cbBuf);
+            if (ASMAtomicDecU32(&pBuf->cPending) == 0)
+                RTSemEventSignal(pAsync->hEvtFree);
+            iNext++;
+        }
+        else if (fTerminate)
+            break;
+        else
+            RTSemEventWait(pWorker->hEvtWork, RT_INDEFINITE_WAIT);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Stops the hashing workers and frees the asynchronous hashing state.
+ *
+ * The caller must've submitted any pending data, whatever is left in the fill
+ * buffer is dropped.
+ *
+ * @param   pHashes             The hashes structure.
+ */
+static void rtManifestHashesStopAsync(PRTMANIFESTHASHES pHashes)
+{
+    PRTMANIFESTHASHASYNC pAsync = pHashes->pAsync;
+    if (!pAsync)
+        return;
+    pHashes->pAsync = NULL;
+
+    ASMAtomicWriteBool(&pAsync->fTerminate, true);
+    for (uint32_t i = 0; i < pAsync->cWorkers; i++)
+    {
+        if (pAsync->aWorkers[i].hThread != NIL_RTTHREAD)
+        {
+            RTSemEventSignal(pAsync->aWorkers[i].hEvtWork);
+            int rc = RTThreadWait(pAsync->aWorkers[i].hThread, RT_INDEFINITE_WAIT, NULL);
+            AssertRC(rc);
+        }
+        RTSemEventDestroy(pAsync->aWorkers[i].hEvtWork);
+    }
+    RTSemEventDestroy(pAsync->hEvtFree);
+    for (uint32_t i = 0; i < RT_ELEMENTS(pAsync->aBufs); i++)
+        RTMemPageFree(pAsync->aBufs[i].pbBuf, RTMANIFEST_ASYNC_BUFFER_SIZE);
+    RTMemFree(pAsync);
+}
+
+
+/**
+ * Tries to start the hashing worker threads.
+ *
+ * On failure we just continue hashing on the caller's thread.
+ *
+ * @param   pHashes             The hashes structure.
+ */
+static void rtManifestHashesStartAsync(PRTMANIFESTHASHES pHashes)
+{
+    static const struct { uint32_t fAttr; const char *pszName; } s_aDigests[] =
+    {
+        { RTMANIFEST_ATTR_MD5,    "MD5"    },
+        { RTMANIFEST_ATTR_SHA1,   "SHA1"   },
+        { RTMANIFEST_ATTR_SHA256, "SHA256" },
+        { RTMANIFEST_ATTR_SHA512, "SHA512" },
+    };
+    AssertCompile(RT_ELEMENTS(s_aDigests) <= RTMANIFEST_ASYNC_MAX_WORKERS);
+
+    pHashes->fNoAsync = true; /* one attempt only */
+
+    PRTMANIFESTHASHASYNC pAsync = (PRTMANIFESTHASHASYNC)RTMemAllocZ(sizeof(*pAsync));
+    if (!pAsync)
+        return;
+    pAsync->pHashes  = pHashes;
+    pAsync->hEvtFree = NIL_RTSEMEVENT;
+    for (uint32_t i = 0; i < RT_ELEMENTS(pAsync->aWorkers); i++)
+    {
+        pAsync->aWorkers[i].hEvtWork = NIL_RTSEMEVENT;
+        pAsync->aWorkers[i].hThread  = NIL_RTTHREAD;
+    }
+    pHashes->pAsync = pAsync; /* for cleanup */
+
+    int rc = RTSemEventCreate(&pAsync->hEvtFree);
+    for (uint32_t i = 0; i < RT_ELEMENTS(pAsync->aBufs) && RT_SUCCESS(rc); i++)
+    {
+        pAsync->aBufs[i].pbBuf = (uint8_t *)RTMemPageAlloc(RTMANIFEST_ASYNC_BUFFER_SIZE);
+        if (!pAsync->aBufs[i].pbBuf)
+            rc = VERR_NO_MEMORY;
+    }
+
+    for (uint32_t i = 0; i < RT_ELEMENTS(s_aDigests) && RT_SUCCESS(rc); i++)
+        if (pHashes->fAttrs & s_aDigests[i].fAttr)
+        {
+            PRTMANIFESTHASHWORKER pWorker = &pAsync->aWorkers[pAsync->cWorkers++];
+            pWorker->pAsync = pAsync;
+            pWorker->fAttr  = s_aDigests[i].fAttr;
+            rc = RTSemEventCreate(&pWorker->hEvtWork);
+            if (RT_SUCCESS(rc))
+                rc = RTThreadCreateF(&pWorker->hThread, rtManifestHashesWorker, pWorker, 0 /*cbStack*/,
+                                     RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "Man%s", s_aDigests[i].pszName);
+        }
+
+    if (RT_FAILURE(rc) || pAsync->cWorkers == 0)
+    {
+        /* Nothing has been submitted yet, so the contexts are still ours. */
+        rtManifestHashesStopAsync(pHashes);
+    }
+}
+
+
+/**
+ * Submits the fill buffer to the hashing workers.
+ *
+ * @param   pAsync              The asynchronous hashing state.
+ */
+static void rtManifestHashesSubmit(PRTMANIFESTHASHASYNC pAsync)
+{
+    RTMANIFESTHASHBUF *pBuf = &pAsync->aBufs[pAsync->cSubmitted % RTMANIFEST_ASYNC_BUFFERS];
+    pBuf->cbBuf = pAsync->cbFill;
+    ASMAtomicWriteU32(&pBuf->cPending, pAsync->cWorkers);
+    ASMAtomicIncU32(&pAsync->cSubmitted);
+    pAsync->cbFill = 0;
+    for (uint32_t i = 0; i < pAsync->cWorkers; i++)
+        RTSemEventSignal(pAsync->aWorkers[i].hEvtWork);
+}
+
+
+/**
+ * Updates the hashes with a block of data.
+ *
+ * Large streams are handed over to worker threads, one per digest type.
+ *
+ * @param   pHashes             The hashes structure.
+ * @param   pvBuf               The data block.
+ * @param   cbBuf               The size of the data block.
+ */
+static void rtManifestHashesUpdate(PRTMANIFESTHASHES pHashes, void const *pvBuf, size_t cbBuf)
+{
+    pHashes->cbStream += cbBuf;
+
+    PRTMANIFESTHASHASYNC pAsync = pHashes->pAsync;
+    if (!pAsync)
+    {
+        if (   pHashes->cbStream < RTMANIFEST_ASYNC_THRESHOLD
+            || pHashes->fNoAsync
+            || !(pHashes->fAttrs & ~RTMANIFEST_ATTR_SIZE))
+        {
+            rtManifestHashesUpdateContexts(pHashes, pHashes->fAttrs, pvBuf, cbBuf);
+            return;
+        }
+        rtManifestHashesStartAsync(pHashes);
+        pAsync = pHashes->pAsync;
+        if (!pAsync)
+        {
+            rtManifestHashesUpdateContexts(pHashes, pHashes->fAttrs, pvBuf, cbBuf);
+            return;
+        }
+    }
+
+    /*
+     * Copy the data into the ring, submitting full buffers as we go.
+     */
+    uint8_t const *pbSrc = (uint8_t const *)pvBuf;
+    while (cbBuf > 0)
+    {
+        RTMANIFESTHASHBUF *pBuf = &pAsync->aBufs[pAsync->cSubmitted % RTMANIFEST_ASYNC_BUFFERS];
+        if (pAsync->cbFill == 0)
+            while (ASMAtomicReadU32(&pBuf->cPending) != 0)
+                RTSemEventWait(pAsync->hEvtFree, RT_INDEFINITE_WAIT);
+
+        size_t cbToCopy = RTMANIFEST_ASYNC_BUFFER_SIZE - pAsync->cbFill;
+        if (cbToCopy > cbBuf)
+            cbToCopy = cbBuf;
+        memcpy(&pBuf->pbBuf[pAsync->cbFill], pbSrc, cbToCopy);
+        pAsync->cbFill += cbToCopy;
+        pbSrc          += cbToCopy;
+        cbBuf          -= cbToCopy;
+
+        if (pAsync->cbFill == RTMANIFEST_ASYNC_BUFFER_SIZE)
+            rtManifestHashesSubmit(pAsync);
+    }
+}
+
+
 /**
  * Finalizes all the hashes.
  *
@@ -161,6 +447,14 @@ static void rtManifestHashesUpdate(PRTMANIFESTHASHES pHashes, void const *pvBuf,
  */
 static void rtManifestHashesFinal(PRTMANIFESTHASHES pHashes)
 {
+    PRTMANIFESTHASHASYNC pAsync = pHashes->pAsync;
+    if (pAsync)
+    {
+        if (pAsync->cbFill)
+            rtManifestHashesSubmit(pAsync);
+        rtManifestHashesStopAsync(pHashes);
+    }
+
     if (pHashes->fAttrs & RTMANIFEST_ATTR_MD5)
         RTMd5Final(pHashes->abMd5Digest, &pHashes->Md5Ctx);
     if (pHashes->fAttrs & RTMANIFEST_ATTR_SHA1)
@@ -240,6 +534,8 @@ static int rtManifestHashesSetAttrs(PRTMANIFESTHASHES pHashes, RTMANIFEST hManif
  */
 static void rtManifestHashesDestroy(PRTMANIFESTHASHES pHashes)
 {
+    if (pHashes)
+        rtManifestHashesStopAsync(pHashes);
     RTMemTmpFree(pHashes);
 }
 
@@ -43,6 +43,7 @@
 # include <iprt/memcache.h>
 #endif
 #include <iprt/path.h>
+#include <iprt/sort.h>
 #include <iprt/string.h>
 #include <iprt/strcache.h>
 #include "internal/dbgmod.h"
@@ -421,6 +422,44 @@ typedef struct RTDBGDWARFSEG
 /** Pointer to segment info. */
 typedef RTDBGDWARFSEG *PRTDBGDWARFSEG;
 
+/**
+ * Compilation unit reference for on demand loading.
+ */
+typedef struct RTDWARFLAZYUNIT
+{
+    /** The offset of the unit header in debug_info. */
+    uint32_t            offInfo;
+    /** The offset of the line number program in debug_line, UINT32_MAX if
+     *  none. */
+    uint32_t            offLine;
+    /** Set if the unit has been placed in the range table. */
+    bool                fPlaced;
+    /** Set if the unit has been loaded (or failed to load). */
+    bool                fLoaded;
+} RTDWARFLAZYUNIT;
+/** Pointer to a compilation unit reference. */
+typedef RTDWARFLAZYUNIT *PRTDWARFLAZYUNIT;
+
+/**
+ * Code address range of a compilation unit, for on demand loading.
+ */
+typedef struct RTDWARFLAZYRANGE
+{
+    /** The first segment offset in the range. */
+    RTUINTPTR           offFirst;
+    /** The last segment offset in the range (inclusive). */
+    RTUINTPTR           offLast;
+    /** The highest offLast of this and all preceding entries in the same
+     *  segment.  Used to limit the backwards scan for overlapping ranges. */
+    RTUINTPTR           offLastMax;
+    /** The segment index. */
+    RTDBGSEGIDX         iSeg;
+    /** The unit index (RTDBGMODDWARF::paUnits). */
+    uint32_t            iUnit;
+} RTDWARFLAZYRANGE;
+/** Pointer to a code address range. */
+typedef RTDWARFLAZYRANGE *PRTDWARFLAZYRANGE;
+
 
 /**
  * The instance data of the DWARF reader.
@@ -482,6 +521,46 @@ typedef struct RTDBGMODDWARF
     uint32_t                cSegs;
     /** Pointer to segments if iWatcomPass isn't -1. */
     PRTDBGDWARFSEG          paSegs;
+
+    /** @name On demand loading of compilation units.
+     * Only used in one pass mode (iWatcomPass == -1).  Units are loaded when an
+     * address lookup hits their code ranges and everything is loaded when the
+     * caller asks for the whole picture (names, ordinals, counts).
+     * @{ */
+    /** Set while there are compilation units that haven't been loaded yet. */
+    bool                    fLazy;
+    /** Set if there are units without any code ranges that should be loaded
+     *  on the first address lookup. */
+    bool                    fHaveUnplacedUnits;
+    /** Set if symbols or line numbers were added thru the API, in which case the
+     *  container doesn't reflect the image and mustn't be written to the index
+     *  cache. */
+    bool                    fUserAdditions;
+    /** Number of units not yet loaded. */
+    uint32_t                cUnitsLeft;
+    /** Number of units in paUnits. */
+    uint32_t                cUnits;
+    /** The units in debug_info order. */
+    PRTDWARFLAZYUNIT        paUnits;
+    /** Number of entries in paRanges. */
+    uint32_t                cRanges;
+    /** Code ranges sorted by segment and offset. */
+    PRTDWARFLAZYRANGE       paRanges;
+    /** Container for the image symbols until all units are loaded. */
+    RTDBGMOD                hImgSymCnt;
+    /** @} */
+
+    /** @name Symbol index cache.
+     * @{ */
+    /** The index we're serving symbols and lines from, NULL if not used. */
+    PRTDBGMODIDX            pIdx;
+    /** The index cache file, NULL if caching is disabled. */
+    char                   *pszIdxPath;
+    /** The size of the build ID (index cache key). */
+    uint32_t                cbBuildId;
+    /** The build ID. */
+    uint8_t                 abBuildId[64];
+    /** @} */
 #ifdef RTDBGMODDWARF_WITH_MEM_CACHE
     /** DIE allocators. */
     struct
@@ -4437,17 +4516,20 @@ static DECLCALLBACK(int) rtDwarfSyms_EnumSymbolsCallback(RTLDRMOD hLdrMod, const
     RT_NOREF_PV(hLdrMod); RT_NOREF_PV(uSymbol);
     Assert(pThis->iWatcomPass != 1);
 
+    /* While loading on demand, the image symbols are kept separately. */
+    RTDBGMOD const hDstCnt = pThis->hImgSymCnt != NIL_RTDBGMOD ? pThis->hImgSymCnt : pThis->hCnt;
+
     RTLDRADDR uRva = Value - RTDBGDWARF_SYM_ENUM_BASE_ADDRESS;
     if (   Value >= RTDBGDWARF_SYM_ENUM_BASE_ADDRESS
         && uRva  <  _1G)
     {
         RTDBGSYMBOL SymInfo;
         RTINTPTR    offDisp;
-        int rc = RTDbgModSymbolByAddr(pThis->hCnt, RTDBGSEGIDX_RVA, uRva, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL, &offDisp, &SymInfo);
+        int rc = RTDbgModSymbolByAddr(hDstCnt, RTDBGSEGIDX_RVA, uRva, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL, &offDisp, &SymInfo);
         if (   RT_FAILURE(rc)
             || offDisp != 0)
         {
-            rc = RTDbgModSymbolAdd(pThis->hCnt, pszSymbol, RTDBGSEGIDX_RVA, uRva, 1, 0 /*fFlags*/, NULL /*piOrdinal*/);
+            rc = RTDbgModSymbolAdd(hDstCnt, pszSymbol, RTDBGSEGIDX_RVA, uRva, 1, 0 /*fFlags*/, NULL /*piOrdinal*/);
             Log(("Dwarf: Symbol #%05u %#018RTptr %s [%Rrc]\n", uSymbol, Value, pszSymbol, rc)); NOREF(rc);
         }
     }
@@ -4508,6 +4590,640 @@ static int rtDwarfSyms_LoadAll(PRTDBGMODDWARF pThis)
 
 
 
+/*
+ *
+ * On demand loading of compilation units.
+ * On demand loading of compilation units.
+ * On demand loading of compilation units.
+ *
+ */
+
+/**
+ * Frees the abbreviation cache and unmaps all the sections.
+ *
+ * @param   pThis               The DWARF instance.
+ */
+static void rtDbgModDwarfFreeParseState(PRTDBGMODDWARF pThis)
+{
+    pThis->cCachedAbbrevsAlloced = 0;
+    RTMemFree(pThis->paCachedAbbrevs);
+    pThis->paCachedAbbrevs = NULL;
+
+    for (unsigned iSect = 0; iSect < RT_ELEMENTS(pThis->aSections); iSect++)
+        if (pThis->aSections[iSect].pv)
+            pThis->pDbgInfoMod->pImgVt->pfnUnmapPart(pThis->pDbgInfoMod, pThis->aSections[iSect].cb,
+                                                     &pThis->aSections[iSect].pv);
+}
+
+
+/**
+ * Adds a code range to the range table.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   iUnit               The unit the range belongs to.
+ * @param   uLowAddress         The first link address.
+ * @param   uHighAddress        The link address following the range.
+ */
+static int rtDwarfLazy_AddRange(PRTDBGMODDWARF pThis, uint32_t iUnit, uint64_t uLowAddress, uint64_t uHighAddress)
+{
+    if (uHighAddress <= uLowAddress)
+        return VINF_SUCCESS;
+
+    RTDBGSEGIDX iSeg;
+    RTLDRADDR   offSeg;
+    int rc = rtDbgModDwarfLinkAddressToSegOffset(pThis, 0 /*uSegment*/, uLowAddress, &iSeg, &offSeg);
+    if (RT_FAILURE(rc))
+    {
+        Log(("rtDwarfLazy_AddRange: Unit #%u range %#llx-%#llx: %Rrc\n", iUnit, uLowAddress, uHighAddress, rc));
+        return VINF_SUCCESS;
+    }
+
+    uint32_t const cRanges = pThis->cRanges;
+    if (cRanges == 0 || (cRanges >= 16 && RT_IS_POWER_OF_TWO(cRanges)))
+    {
+        void *pvNew = RTMemRealloc(pThis->paRanges, (cRanges ? cRanges * 2 : 16) * sizeof(pThis->paRanges[0]));
+        if (!pvNew)
+            return VERR_NO_MEMORY;
+        pThis->paRanges = (PRTDWARFLAZYRANGE)pvNew;
+    }
+
+    PRTDWARFLAZYRANGE pRange = &pThis->paRanges[cRanges];
+    pRange->offFirst   = offSeg;
+    pRange->offLast    = offSeg + (uHighAddress - uLowAddress - 1);
+    pRange->offLastMax = pRange->offLast;
+    pRange->iSeg       = iSeg;
+    pRange->iUnit      = iUnit;
+    pThis->cRanges     = cRanges + 1;
+    pThis->paUnits[iUnit].fPlaced = true;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Adds the code ranges in a debug_ranges list to the range table.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   iUnit               The unit the ranges belongs to.
+ * @param   pUnitDie            The compilation unit DIE.
+ */
+static int rtDwarfLazy_AddRangeList(PRTDBGMODDWARF pThis, uint32_t iUnit, PRTDWARFDIECOMPILEUNIT pUnitDie)
+{
+    size_t const offRanges = pUnitDie->PcRange.pbRanges - (uint8_t const *)pThis->aSections[krtDbgModDwarfSect_ranges].pv;
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_InitWithOffset(&Cursor, pThis, krtDbgModDwarfSect_ranges, (uint32_t)offRanges);
+    if (RT_FAILURE(rc))
+        return rc;
+    Cursor.cbNativeAddr = pUnitDie->cbNativeAddr;
+
+    /* The base address defaults to the low PC of the unit and can be changed by
+       base address selection entries (start = max address). */
+    uint64_t const uBaseSelector = pUnitDie->cbNativeAddr >= 8 ? UINT64_MAX : RT_BIT_64(pUnitDie->cbNativeAddr * 8) - 1;
+    uint64_t       uBase         = pUnitDie->PcRange.fHaveLowAddress ? pUnitDie->PcRange.uLowAddress : 0;
+    while (   !rtDwarfCursor_IsAtEnd(&Cursor)
+           && RT_SUCCESS(rc))
+    {
+        uint64_t const uStart = rtDwarfCursor_GetNativeUOff(&Cursor, 0);
+        uint64_t const uEnd   = rtDwarfCursor_GetNativeUOff(&Cursor, 0);
+        if (   RT_FAILURE(Cursor.rc)
+            || (!uStart && !uEnd))
+            break;
+        if (uStart == uBaseSelector)
+            uBase = uEnd;
+        else
+            rc = rtDwarfLazy_AddRange(pThis, iUnit, uBase + uStart, uBase + uEnd);
+    }
+
+    /* A truncated list isn't worth failing the module over. */
+    if (RT_FAILURE(Cursor.rc))
+    {
+        Log(("rtDwarfLazy_AddRangeList: Unit #%u: bad range list at %#zx: %Rrc\n", iUnit, offRanges, Cursor.rc));
+        Cursor.rc = VINF_SUCCESS;
+    }
+    return rtDwarfCursor_Delete(&Cursor, rc);
+}
+
+
+/**
+ * Scans the header and compilation unit DIE of a unit, recording the
+ * information needed for loading it later.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ * @param   pCursor             The debug_info cursor, positioned at the start
+ *                              of the unit.  Advanced to the next unit.
+ */
+static int rtDwarfLazy_ScanUnit(PRTDBGMODDWARF pThis, PRTDWARFCURSOR pCursor)
+{
+    /*
+     * Read the compilation unit header (see rtDwarfInfo_LoadUnit).
+     */
+    uint32_t const offUnit = rtDwarfCursor_CalcSectOffsetU32(pCursor);
+    uint64_t       cbUnit  = rtDwarfCursor_GetInitalLength(pCursor);
+    cbUnit += rtDwarfCursor_CalcSectOffsetU32(pCursor) - offUnit;
+    uint16_t const uVer = rtDwarfCursor_GetUHalf(pCursor, 0);
+    if (   uVer < 2
+        || uVer > 4)
+        return rtDwarfCursor_SkipUnit(pCursor);
+    uint64_t const offAbbrev    = rtDwarfCursor_GetUOff(pCursor, UINT64_MAX);
+    uint8_t  const cbNativeAddr = rtDwarfCursor_GetU8(pCursor, UINT8_MAX);
+    if (RT_FAILURE(pCursor->rc))
+        return pCursor->rc;
+    if (offAbbrev > UINT32_MAX)
+    {
+        Log(("Unexpected abbrviation code offset of %#llx\n", offAbbrev));
+        return VERR_DWARF_BAD_INFO;
+    }
+    rtDwarfAbbrev_SetUnitOffset(pThis, (uint32_t)offAbbrev);
+    pCursor->cbNativeAddr = cbNativeAddr;
+
+    /*
+     * Parse the compile or partial unit DIE only.
+     */
+    uint32_t uAbbrCode = rtDwarfCursor_GetULeb128AsU32(pCursor, UINT32_MAX);
+    if (!uAbbrCode)
+    {
+        Log(("Unexpected abbrviation code of zero\n"));
+        return VERR_DWARF_BAD_INFO;
+    }
+    PCRTDWARFABBREV pAbbrev = rtDwarfAbbrev_Lookup(pThis, uAbbrCode);
+    if (!pAbbrev)
+        return VERR_DWARF_ABBREV_NOT_FOUND;
+    if (   pAbbrev->uTag != DW_TAG_compile_unit
+        && pAbbrev->uTag != DW_TAG_partial_unit)
+    {
+        Log(("Unexpected compile/partial unit tag %#x\n", pAbbrev->uTag));
+        return VERR_DWARF_BAD_INFO;
+    }
+
+    PRTDWARFDIECOMPILEUNIT pUnitDie;
+    pUnitDie = (PRTDWARFDIECOMPILEUNIT)rtDwarfInfo_NewDie(pThis, &g_CompileUnitDesc, pAbbrev, NULL /*pParent*/);
+    if (!pUnitDie)
+        return VERR_NO_MEMORY;
+    pUnitDie->offUnit      = offUnit;
+    pUnitDie->cbUnit       = cbUnit;
+    pUnitDie->offAbbrev    = offAbbrev;
+    pUnitDie->cbNativeAddr = cbNativeAddr;
+    pUnitDie->uDwarfVer    = (uint8_t)uVer;
+
+    int rc = rtDwarfInfo_ParseDie(pThis, &pUnitDie->Core, &g_CompileUnitDesc, pCursor, pAbbrev, true /*fInitDie*/);
+    if (RT_SUCCESS(rc))
+    {
+        /*
+         * Record the unit and its code ranges.
+         */
+        uint32_t const iUnit = pThis->cUnits;
+        if (iUnit == 0 || (iUnit >= 16 && RT_IS_POWER_OF_TWO(iUnit)))
+        {
+            void *pvNew = RTMemRealloc(pThis->paUnits, (iUnit ? iUnit * 2 : 16) * sizeof(pThis->paUnits[0]));
+            if (pvNew)
+                pThis->paUnits = (PRTDWARFLAZYUNIT)pvNew;
+            else
+                rc = VERR_NO_MEMORY;
+        }
+        if (RT_SUCCESS(rc))
+        {
+            PRTDWARFLAZYUNIT pUnit = &pThis->paUnits[iUnit];
+            pUnit->offInfo = offUnit;
+            pUnit->offLine =    pUnitDie->StmtListRef.enmWrt == krtDwarfRef_LineSection
+                             && pUnitDie->StmtListRef.off < pThis->aSections[krtDbgModDwarfSect_line].cb
+                           ? (uint32_t)pUnitDie->StmtListRef.off : UINT32_MAX;
+            pUnit->fPlaced = false;
+            pUnit->fLoaded = false;
+            pThis->cUnits     = iUnit + 1;
+            pThis->cUnitsLeft++;
+
+            if (pUnitDie->PcRange.fHaveRanges)
+                rc = rtDwarfLazy_AddRangeList(pThis, iUnit, pUnitDie);
+            else if (   pUnitDie->PcRange.fHaveLowAddress
+                     && pUnitDie->PcRange.fHaveHighAddress
+                     && pUnitDie->PcRange.fHaveHighIsAddress)
+                rc = rtDwarfLazy_AddRange(pThis, iUnit, pUnitDie->PcRange.uLowAddress, pUnitDie->PcRange.uHighAddress);
+            if (!pThis->paUnits[iUnit].fPlaced)
+                pThis->fHaveUnplacedUnits = true;
+            Log2(("rtDwarfLazy_ScanUnit: #%u at %#x: offLine=%#x placed=%RTbool\n",
+                  iUnit, offUnit, pUnit->offLine, pThis->paUnits[iUnit].fPlaced));
+        }
+    }
+
+    rtDwarfInfo_FreeDie(pThis, &pUnitDie->Core);
+    if (RT_SUCCESS(rc))
+        rc = rtDwarfCursor_SkipUnit(pCursor);
+    return rc;
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, Code ranges by segment and offset.} */
+static DECLCALLBACK(int) rtDwarfLazy_CompareRanges(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    PRTDWARFLAZYRANGE pRange1 = (PRTDWARFLAZYRANGE)pvElement1;
+    PRTDWARFLAZYRANGE pRange2 = (PRTDWARFLAZYRANGE)pvElement2;
+    RT_NOREF_PV(pvUser);
+    if (pRange1->iSeg != pRange2->iSeg)
+        return pRange1->iSeg < pRange2->iSeg ? -1 : 1;
+    if (pRange1->offFirst != pRange2->offFirst)
+        return pRange1->offFirst < pRange2->offFirst ? -1 : 1;
+    return 0;
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, 32-bit section offsets.} */
+static DECLCALLBACK(int) rtDwarfLazy_CompareOffsets(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    uint32_t const off1 = *(uint32_t const *)pvElement1;
+    uint32_t const off2 = *(uint32_t const *)pvElement2;
+    RT_NOREF_PV(pvUser);
+    return off1 < off2 ? -1 : off1 > off2 ? 1 : 0;
+}
+
+
+/**
+ * Frees the on demand loading state.
+ *
+ * @param   pThis               The DWARF instance.
+ */
+static void rtDwarfLazy_Term(PRTDBGMODDWARF pThis)
+{
+    if (pThis->hImgSymCnt != NIL_RTDBGMOD)
+    {
+        RTDbgModRelease(pThis->hImgSymCnt);
+        pThis->hImgSymCnt = NIL_RTDBGMOD;
+    }
+    RTMemFree(pThis->paUnits);
+    pThis->paUnits    = NULL;
+    pThis->cUnits     = 0;
+    pThis->cUnitsLeft = 0;
+    RTMemFree(pThis->paRanges);
+    pThis->paRanges   = NULL;
+    pThis->cRanges    = 0;
+    pThis->fLazy      = false;
+    pThis->fHaveUnplacedUnits = false;
+}
+
+
+/**
+ * Completes loading once all units have been loaded.
+ *
+ * This processes line number programs not referenced by any unit, moves the
+ * image symbols into the container, releases all the DWARF parsing resources
+ * and writes the symbol index cache.  Afterwards the container holds exactly
+ * what loading everything up front would've produced.
+ *
+ * @param   pThis               The DWARF instance.
+ */
+static void rtDwarfLazy_Finish(PRTDBGMODDWARF pThis)
+{
+    Assert(pThis->fLazy && !pThis->cUnitsLeft);
+    Log(("rtDwarfLazy_Finish: %u units\n", pThis->cUnits));
+
+    /*
+     * Line number programs not referenced by any unit.
+     */
+    int rc;
+    if (pThis->aSections[krtDbgModDwarfSect_line].fPresent)
+    {
+        uint32_t *paoffLines = (uint32_t *)RTMemTmpAlloc(sizeof(uint32_t) * RT_MAX(pThis->cUnits, 1));
+        if (paoffLines)
+        {
+            uint32_t cLinePrograms = 0;
+            for (uint32_t iUnit = 0; iUnit < pThis->cUnits; iUnit++)
+                if (pThis->paUnits[iUnit].offLine != UINT32_MAX)
+                    paoffLines[cLinePrograms++] = pThis->paUnits[iUnit].offLine;
+            RTSort(paoffLines, cLinePrograms, sizeof(uint32_t), rtDwarfLazy_CompareOffsets, NULL);
+
+            RTDWARFCURSOR Cursor;
+            rc = rtDwarfCursor_Init(&Cursor, pThis, krtDbgModDwarfSect_line);
+            if (RT_SUCCESS(rc))
+            {
+                uint32_t iNext = 0;
+                while (   !rtDwarfCursor_IsAtEnd(&Cursor)
+                       && RT_SUCCESS(rc))
+                {
+                    uint32_t const offLine = rtDwarfCursor_CalcSectOffsetU32(&Cursor);
+                    while (iNext < cLinePrograms && paoffLines[iNext] < offLine)
+                        iNext++;
+                    if (iNext < cLinePrograms && paoffLines[iNext] == offLine)
+                    {
+                        rtDwarfCursor_GetInitalLength(&Cursor);
+                        rc = rtDwarfCursor_SkipUnit(&Cursor);
+                    }
+                    else
+                        rc = rtDwarfLine_ExplodeUnit(pThis, &Cursor);
+                }
+                rc = rtDwarfCursor_Delete(&Cursor, rc);
+            }
+            if (RT_FAILURE(rc))
+                Log(("rtDwarfLazy_Finish: Line numbers: %Rrc\n", rc));
+            RTMemTmpFree(paoffLines);
+        }
+    }
+
+    /*
+     * Redo the image symbols now that all the DWARF ones are known.
+     */
+    RTDbgModRelease(pThis->hImgSymCnt);
+    pThis->hImgSymCnt = NIL_RTDBGMOD;
+    rc = rtDwarfSyms_LoadAll(pThis);
+    if (RT_FAILURE(rc))
+        Log(("rtDwarfLazy_Finish: Image symbols: %Rrc\n", rc));
+
+    rtDwarfLazy_Term(pThis);
+    rtDbgModDwarfFreeParseState(pThis);
+
+    /*
+     * Save the result for the next time this image is loaded.
+     */
+    if (   pThis->pszIdxPath
+        && !pThis->fUserAdditions)
+    {
+        rc = rtDbgModIdxWrite(pThis->pszIdxPath, pThis->abBuildId, pThis->cbBuildId, pThis->hCnt);
+        Log(("rtDwarfLazy_Finish: Wrote '%s': %Rrc\n", pThis->pszIdxPath, rc));
+    }
+    RTStrFree(pThis->pszIdxPath);
+    pThis->pszIdxPath = NULL;
+}
+
+
+/**
+ * Loads a compilation unit and its line numbers.
+ *
+ * Failures are logged and the unit is considered loaded, there is no point
+ * in retrying them on every lookup.
+ *
+ * @param   pThis               The DWARF instance.
+ * @param   iUnit               The unit to load.
+ */
+static void rtDwarfLazy_LoadUnit(PRTDBGMODDWARF pThis, uint32_t iUnit)
+{
+    PRTDWARFLAZYUNIT pUnit = &pThis->paUnits[iUnit];
+    if (pUnit->fLoaded)
+        return;
+    pUnit->fLoaded = true;
+    Assert(pThis->cUnitsLeft > 0);
+    pThis->cUnitsLeft--;
+
+    RTDWARFCURSOR Cursor;
+    int rc = rtDwarfCursor_InitWithOffset(&Cursor, pThis, krtDbgModDwarfSect_info, pUnit->offInfo);
+    if (RT_SUCCESS(rc))
+    {
+        rc = rtDwarfInfo_LoadUnit(pThis, &Cursor, false /* fKeepDies */);
+        rc = rtDwarfCursor_Delete(&Cursor, rc);
+    }
+    if (RT_FAILURE(rc))
+        Log(("rtDwarfLazy_LoadUnit: Unit #%u at %#x: %Rrc\n", iUnit, pUnit->offInfo, rc));
+
+    if (pUnit->offLine != UINT32_MAX)
+    {
+        rc = rtDwarfCursor_InitWithOffset(&Cursor, pThis, krtDbgModDwarfSect_line, pUnit->offLine);
+        if (RT_SUCCESS(rc))
+        {
+            rc = rtDwarfLine_ExplodeUnit(pThis, &Cursor);
+            rc = rtDwarfCursor_Delete(&Cursor, rc);
+        }
+        if (RT_FAILURE(rc))
+            Log(("rtDwarfLazy_LoadUnit: Unit #%u line numbers at %#x: %Rrc\n", iUnit, pUnit->offLine, rc));
+    }
+}
+
+
+/**
+ * Loads all remaining units.
+ *
+ * @param   pThis               The DWARF instance.
+ */
+static void rtDwarfLazy_LoadAll(PRTDBGMODDWARF pThis)
+{
+    Assert(pThis->fLazy);
+    for (uint32_t iUnit = 0; iUnit < pThis->cUnits && pThis->cUnitsLeft > 0; iUnit++)
+        rtDwarfLazy_LoadUnit(pThis, iUnit);
+    rtDwarfLazy_Finish(pThis);
+}
+
+
+/**
+ * Loads the units which may have symbols or line numbers relevant to an
+ * address lookup.
+ *
+ * @param   pThis               The DWARF instance.
+ * @param   iSeg                The segment index.
+ * @param   off                 The segment offset.
+ * @param   fFlags              RTDBGSYMADDR_FLAGS_XXX.
+ */
+static void rtDwarfLazy_LoadUnitsByAddr(PRTDBGMODDWARF pThis, RTDBGSEGIDX iSeg, RTUINTPTR off, uint32_t fFlags)
+{
+    Assert(pThis->fLazy);
+
+    /* Units we couldn't place can contain anything. */
+    if (pThis->fHaveUnplacedUnits)
+    {
+        pThis->fHaveUnplacedUnits = false;
+        for (uint32_t iUnit = 0; iUnit < pThis->cUnits; iUnit++)
+            if (!pThis->paUnits[iUnit].fPlaced)
+                rtDwarfLazy_LoadUnit(pThis, iUnit);
+    }
+
+    if (iSeg >= RTDbgModSegmentCount(pThis->hCnt))
+    {
+        /* Absolute symbols and such, can be anywhere. */
+        rtDwarfLazy_LoadAll(pThis);
+        return;
+    }
+
+    /*
+     * Find the first range starting above the address.
+     */
+    PRTDWARFLAZYRANGE const paRanges = pThis->paRanges;
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pThis->cRanges;
+    while (iStart < iEnd)
+    {
+        uint32_t const i = iStart + (iEnd - iStart) / 2;
+        if (   paRanges[i].iSeg < iSeg
+            || (paRanges[i].iSeg == iSeg && paRanges[i].offFirst <= off))
+            iStart = i + 1;
+        else
+            iEnd = i;
+    }
+    uint32_t const iAbove = iStart;
+
+    /*
+     * Load all units with ranges covering the address, the unit with the
+     * closest range below it, and the closest one above it when the caller
+     * is searching upwards.
+     */
+    if (iAbove > 0 && paRanges[iAbove - 1].iSeg == iSeg)
+        rtDwarfLazy_LoadUnit(pThis, paRanges[iAbove - 1].iUnit);
+
+    uint32_t i = iAbove;
+    while (i-- > 0 && paRanges[i].iSeg == iSeg)
+    {
+        RTUINTPTR const offLastMax = paRanges[i].offLastMax;
+        if (offLastMax < off)
+        {
+            /* Nothing further down covers the address; the range ending
+               closest to it is the one that ends at offLastMax. */
+            while (paRanges[i].offLast != offLastMax)
+                i--;
+            rtDwarfLazy_LoadUnit(pThis, paRanges[i].iUnit);
+            break;
+        }
+        if (paRanges[i].offLast >= off)
+            rtDwarfLazy_LoadUnit(pThis, paRanges[i].iUnit);
+    }
+
+    if (   fFlags == RTDBGSYMADDR_FLAGS_GREATER_OR_EQUAL
+        && iAbove < pThis->cRanges
+        && paRanges[iAbove].iSeg == iSeg)
+        rtDwarfLazy_LoadUnit(pThis, paRanges[iAbove].iUnit);
+
+    if (!pThis->cUnitsLeft)
+        rtDwarfLazy_Finish(pThis);
+}
+
+
+/**
+ * Sets up on demand loading of the compilation units.
+ *
+ * This only parses the unit headers and compilation unit DIEs, building a
+ * table of the code ranges covered by each unit.  The image symbols are
+ * loaded into a separate container for now, as whether they are added depends
+ * on the DWARF symbols.
+ *
+ * @returns IPRT status code.
+ * @param   pThis               The DWARF instance.
+ */
+static int rtDwarfLazy_Init(PRTDBGMODDWARF pThis)
+{
+    Assert(pThis->iWatcomPass == -1);
+
+    int rc = RTDbgModCreate(&pThis->hImgSymCnt, RTDbgModName(pThis->hCnt), 0 /*cbSeg*/, 0 /*fFlags*/);
+    if (RT_FAILURE(rc))
+        return rc;
+    RTDBGSEGIDX const cSegs = RTDbgModSegmentCount(pThis->hCnt);
+    for (RTDBGSEGIDX iSeg = 0; iSeg < cSegs && RT_SUCCESS(rc); iSeg++)
+    {
+        RTDBGSEGMENT SegInfo;
+        rc = RTDbgModSegmentByIndex(pThis->hCnt, iSeg, &SegInfo);
+        if (RT_SUCCESS(rc))
+            rc = RTDbgModSegmentAdd(pThis->hImgSymCnt, SegInfo.uRva, SegInfo.cb, SegInfo.szName, SegInfo.fFlags, NULL);
+    }
+    pThis->fLazy = true;
+
+    /*
+     * Scan the units.
+     */
+    RTDWARFCURSOR Cursor;
+    if (RT_SUCCESS(rc))
+        rc = rtDwarfCursor_Init(&Cursor, pThis, krtDbgModDwarfSect_info);
+    if (RT_SUCCESS(rc))
+    {
+        while (   !rtDwarfCursor_IsAtEnd(&Cursor)
+               && RT_SUCCESS(rc))
+            rc = rtDwarfLazy_ScanUnit(pThis, &Cursor);
+        rc = rtDwarfCursor_Delete(&Cursor, rc);
+    }
+
+    /*
+     * Sort the ranges and calculate the running maximum range end per segment.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        PRTDWARFLAZYRANGE const paRanges = pThis->paRanges;
+        RTSort(paRanges, pThis->cRanges, sizeof(paRanges[0]), rtDwarfLazy_CompareRanges, NULL);
+        for (uint32_t i = 1; i < pThis->cRanges; i++)
+            if (   paRanges[i].iSeg == paRanges[i - 1].iSeg
+                && paRanges[i].offLastMax < paRanges[i - 1].offLastMax)
+                paRanges[i].offLastMax = paRanges[i - 1].offLastMax;
+        Log(("rtDwarfLazy_Init: %u units, %u ranges, fHaveUnplacedUnits=%RTbool\n",
+             pThis->cUnits, pThis->cRanges, pThis->fHaveUnplacedUnits));
+
+        rc = rtDwarfSyms_LoadAll(pThis);
+    }
+
+    if (RT_SUCCESS(rc))
+    {
+        if (!pThis->cUnitsLeft)
+            rtDwarfLazy_Finish(pThis);
+    }
+    else
+        rtDwarfLazy_Term(pThis);
+    return rc;
+}
+
+
+/**
+ * Figures out the build ID of the image and sets up the symbol index cache,
+ * loading the index if there is a valid one for this image.
+ *
+ * @param   pThis               The DWARF instance.
+ * @param   pMod                The debug module.
+ */
+static void rtDbgModDwarfSetupIndexCache(PRTDBGMODDWARF pThis, PRTDBGMODINT pMod)
+{
+    /*
+     * Get the build ID, or failing that, the UUID (Mach-O).
+     */
+    PRTDBGMODINT const apImgMods[2] = { pThis->pImgMod, pThis->pDbgInfoMod };
+    for (unsigned i = 0; i < RT_ELEMENTS(apImgMods) && !pThis->cbBuildId; i++)
+    {
+        PRTDBGMODINT pImgMod = apImgMods[i];
+        if (   !pImgMod
+            || !pImgMod->pImgVt
+            || (i > 0 && pImgMod == apImgMods[0]))
+            continue;
+
+        size_t cbRet = 0;
+        int rc = pImgMod->pImgVt->pfnQueryProp(pImgMod, RTLDRPROP_BUILDID, pThis->abBuildId, sizeof(pThis->abBuildId), &cbRet);
+        if (RT_SUCCESS(rc) && cbRet > 0 && cbRet <= sizeof(pThis->abBuildId))
+            pThis->cbBuildId = (uint32_t)cbRet;
+        else
+        {
+            rc = pImgMod->pImgVt->pfnQueryProp(pImgMod, RTLDRPROP_UUID, pThis->abBuildId, sizeof(RTUUID), NULL);
+            if (RT_SUCCESS(rc))
+                pThis->cbBuildId = sizeof(RTUUID);
+        }
+    }
+    if (!pThis->cbBuildId)
+        return;
+
+    /*
+     * Try load the index, remembering the path for writing it if that fails.
+     */
+    char szPath[RTPATH_MAX];
+    int rc = rtDbgModIdxQueryCachePath(pMod->pszName, pThis->abBuildId, pThis->cbBuildId, szPath, sizeof(szPath));
+    if (RT_SUCCESS(rc))
+    {
+        rc = rtDbgModIdxOpen(szPath, pThis->abBuildId, pThis->cbBuildId, pThis->hCnt, &pThis->pIdx);
+        Log(("rtDbgModDwarfSetupIndexCache: '%s': %Rrc\n", szPath, rc));
+        if (RT_FAILURE(rc))
+            pThis->pszIdxPath = RTStrDup(szPath);
+    }
+}
+
+
+/**
+ * Checks if a symbol from the secondary source is a better match for an
+ * address than the one from the primary source.
+ *
+ * @returns true if the secondary symbol should be used, false if not.
+ * @param   pPrimary            The primary symbol.
+ * @param   offDispPrimary      The displacement of the primary symbol.
+ * @param   offDispSecondary    The displacement of the secondary symbol.
+ */
+static bool rtDbgModDwarfIsSecondarySymbolBetter(PCRTDBGSYMBOL pPrimary, RTINTPTR offDispPrimary, RTINTPTR offDispSecondary)
+{
+    /* A primary symbol covering the address always wins. */
+    if (   offDispPrimary >= 0
+        && (RTUINTPTR)offDispPrimary < RT_MAX(pPrimary->cb, 1))
+        return false;
+    RTUINTPTR const cbDistPrimary   = offDispPrimary   >= 0 ? (RTUINTPTR)offDispPrimary   : (RTUINTPTR)-offDispPrimary;
+    RTUINTPTR const cbDistSecondary = offDispSecondary >= 0 ? (RTUINTPTR)offDispSecondary : (RTUINTPTR)-offDispSecondary;
+    return cbDistSecondary < cbDistPrimary;
+}
+
+
+
 /*
  *
  * DWARF Debug module implementation.
@@ -4522,7 +5238,44 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineByAddr(PRTDBGMODINT pMod, RTDBGSEGIDX
                                                   PRTINTPTR poffDisp, PRTDBGLINE pLineInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
-    return RTDbgModLineByAddr(pThis->hCnt, iSeg, off, poffDisp, pLineInfo);
+    if (pThis->fLazy)
+    {
+        rtDwarfLazy_LoadUnitsByAddr(pThis, iSeg, off, RTDBGSYMADDR_FLAGS_LESS_OR_EQUAL);
+
+        /* The container may not have any line numbers yet, don't let that
+           leak out as VERR_DBG_NO_LINE_NUMBERS while units are outstanding. */
+        int rc = RTDbgModLineByAddr(pThis->hCnt, iSeg, off, poffDisp, pLineInfo);
+        if (   rc == VERR_DBG_NO_LINE_NUMBERS
+            && pThis->fLazy
+            && pThis->aSections[krtDbgModDwarfSect_line].cb > 0)
+            rc = VERR_DBG_LINE_NOT_FOUND;
+        return rc;
+    }
+    if (!pThis->pIdx)
+        return RTDbgModLineByAddr(pThis->hCnt, iSeg, off, poffDisp, pLineInfo);
+
+    /*
+     * The index, then whatever was added to the container afterwards.
+     */
+    RTINTPTR offDisp = 0;
+    int rc = rtDbgModIdxLineByAddr(pThis->pIdx, iSeg, off, &offDisp, pLineInfo);
+    if (RTDbgModLineCount(pThis->hCnt) > 0)
+    {
+        RTDBGLINE LineInfo2;
+        RTINTPTR  offDisp2;
+        int rc2 = RTDbgModLineByAddr(pThis->hCnt, iSeg, off, &offDisp2, &LineInfo2);
+        if (   RT_SUCCESS(rc2)
+            && (RT_FAILURE(rc) || offDisp2 < offDisp))
+        {
+            *pLineInfo = LineInfo2;
+            pLineInfo->iOrdinal += rtDbgModIdxLineCount(pThis->pIdx);
+            offDisp = offDisp2;
+            rc      = rc2;
+        }
+    }
+    if (RT_SUCCESS(rc) && poffDisp)
+        *poffDisp = offDisp;
+    return rc;
 }
 
 
@@ -4530,6 +5283,18 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineByAddr(PRTDBGMODINT pMod, RTDBGSEGIDX
 static DECLCALLBACK(int) rtDbgModDwarf_LineByOrdinal(PRTDBGMODINT pMod, uint32_t iOrdinal, PRTDBGLINE pLineInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    if (pThis->fLazy)
+        rtDwarfLazy_LoadAll(pThis);
+    if (pThis->pIdx)
+    {
+        uint32_t const cIdxLines = rtDbgModIdxLineCount(pThis->pIdx);
+        if (iOrdinal < cIdxLines)
+            return rtDbgModIdxLineByOrdinal(pThis->pIdx, iOrdinal, pLineInfo);
+        int rc = RTDbgModLineByOrdinal(pThis->hCnt, iOrdinal - cIdxLines, pLineInfo);
+        if (RT_SUCCESS(rc))
+            pLineInfo->iOrdinal += cIdxLines;
+        return rc;
+    }
     return RTDbgModLineByOrdinal(pThis->hCnt, iOrdinal, pLineInfo);
 }
 
@@ -4538,6 +5303,10 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineByOrdinal(PRTDBGMODINT pMod, uint32_t
 static DECLCALLBACK(uint32_t) rtDbgModDwarf_LineCount(PRTDBGMODINT pMod)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    if (pThis->fLazy)
+        rtDwarfLazy_LoadAll(pThis);
+    if (pThis->pIdx)
+        return rtDbgModIdxLineCount(pThis->pIdx) + RTDbgModLineCount(pThis->hCnt);
     return RTDbgModLineCount(pThis->hCnt);
 }
 
@@ -4548,7 +5317,11 @@ static DECLCALLBACK(int) rtDbgModDwarf_LineAdd(PRTDBGMODINT pMod, const char *ps
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
     Assert(!pszFile[cchFile]); NOREF(cchFile);
-    return RTDbgModLineAdd(pThis->hCnt, pszFile, uLineNo, iSeg, off, piOrdinal);
+    pThis->fUserAdditions = true;
+    int rc = RTDbgModLineAdd(pThis->hCnt, pszFile, uLineNo, iSeg, off, piOrdinal);
+    if (RT_SUCCESS(rc) && pThis->pIdx && piOrdinal)
+        *piOrdinal += rtDbgModIdxLineCount(pThis->pIdx);
+    return rc;
 }
 
 
@@ -4557,7 +5330,54 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByAddr(PRTDBGMODINT pMod, RTDBGSEGI
                                                     PRTINTPTR poffDisp, PRTDBGSYMBOL pSymInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
-    return RTDbgModSymbolByAddr(pThis->hCnt, iSeg, off, fFlags, poffDisp, pSymInfo);
+    if (pThis->fLazy)
+        rtDwarfLazy_LoadUnitsByAddr(pThis, iSeg, off, fFlags);
+    if (!pThis->pIdx && !pThis->fLazy)
+        return RTDbgModSymbolByAddr(pThis->hCnt, iSeg, off, fFlags, poffDisp, pSymInfo);
+
+    /*
+     * There are two sources to consult: the index and the symbols added to
+     * the container after loading it, or the DWARF symbols of the units
+     * loaded so far and the image symbols.
+     */
+    RTINTPTR offDisp = 0;
+    int      rc;
+    RTDBGMOD hCnt2;
+    if (pThis->pIdx)
+    {
+        rc    = rtDbgModIdxSymbolByAddr(pThis->pIdx, iSeg, off, fFlags, &offDisp, pSymInfo);
+        hCnt2 = RTDbgModSymbolCount(pThis->hCnt) > 0 ? pThis->hCnt : NIL_RTDBGMOD;
+    }
+    else
+    {
+        rc    = RTDbgModSymbolByAddr(pThis->hCnt, iSeg, off, fFlags, &offDisp, pSymInfo);
+        hCnt2 = pThis->hImgSymCnt;
+    }
+    if (hCnt2 != NIL_RTDBGMOD)
+    {
+        PRTDBGSYMBOL pSym2 = (PRTDBGSYMBOL)RTMemTmpAlloc(sizeof(*pSym2));
+        if (pSym2)
+        {
+            RTINTPTR offDisp2;
+            int rc2 = RTDbgModSymbolByAddr(hCnt2, iSeg, off, fFlags, &offDisp2, pSym2);
+            if (   RT_SUCCESS(rc2)
+                && (   RT_FAILURE(rc)
+                    || rtDbgModDwarfIsSecondarySymbolBetter(pSymInfo, offDisp, offDisp2)))
+            {
+                *pSymInfo = *pSym2;
+                if (pThis->pIdx)
+                    pSymInfo->iOrdinal += rtDbgModIdxSymbolCount(pThis->pIdx);
+                else
+                    pSymInfo->iOrdinal = UINT32_MAX; /* Not final until all units are loaded. */
+                offDisp = offDisp2;
+                rc      = rc2;
+            }
+            RTMemTmpFree(pSym2);
+        }
+    }
+    if (RT_SUCCESS(rc) && poffDisp)
+        *poffDisp = offDisp;
+    return rc;
 }
 
 
@@ -4567,6 +5387,25 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByName(PRTDBGMODINT pMod, const cha
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
     Assert(!pszSymbol[cchSymbol]); RT_NOREF_PV(cchSymbol);
+    if (pThis->pIdx)
+    {
+        int rc = rtDbgModIdxSymbolByName(pThis->pIdx, pszSymbol, pSymInfo);
+        if (RT_FAILURE(rc))
+        {
+            rc = RTDbgModSymbolByName(pThis->hCnt, pszSymbol/*, cchSymbol*/, pSymInfo);
+            if (RT_SUCCESS(rc))
+                pSymInfo->iOrdinal += rtDbgModIdxSymbolCount(pThis->pIdx);
+        }
+        return rc;
+    }
+    if (pThis->fLazy)
+    {
+        /* DWARF symbols from units already loaded won't go away, so try those first. */
+        int rc = RTDbgModSymbolByName(pThis->hCnt, pszSymbol/*, cchSymbol*/, pSymInfo);
+        if (RT_SUCCESS(rc))
+            return rc;
+        rtDwarfLazy_LoadAll(pThis);
+    }
     return RTDbgModSymbolByName(pThis->hCnt, pszSymbol/*, cchSymbol*/, pSymInfo);
 }
 
@@ -4575,6 +5414,18 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByName(PRTDBGMODINT pMod, const cha
 static DECLCALLBACK(int) rtDbgModDwarf_SymbolByOrdinal(PRTDBGMODINT pMod, uint32_t iOrdinal, PRTDBGSYMBOL pSymInfo)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    if (pThis->fLazy)
+        rtDwarfLazy_LoadAll(pThis);
+    if (pThis->pIdx)
+    {
+        uint32_t const cIdxSymbols = rtDbgModIdxSymbolCount(pThis->pIdx);
+        if (iOrdinal < cIdxSymbols)
+            return rtDbgModIdxSymbolByOrdinal(pThis->pIdx, iOrdinal, pSymInfo);
+        int rc = RTDbgModSymbolByOrdinal(pThis->hCnt, iOrdinal - cIdxSymbols, pSymInfo);
+        if (RT_SUCCESS(rc))
+            pSymInfo->iOrdinal += cIdxSymbols;
+        return rc;
+    }
     return RTDbgModSymbolByOrdinal(pThis->hCnt, iOrdinal, pSymInfo);
 }
 
@@ -4583,6 +5434,10 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolByOrdinal(PRTDBGMODINT pMod, uint32
 static DECLCALLBACK(uint32_t) rtDbgModDwarf_SymbolCount(PRTDBGMODINT pMod)
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
+    if (pThis->fLazy)
+        rtDwarfLazy_LoadAll(pThis);
+    if (pThis->pIdx)
+        return rtDbgModIdxSymbolCount(pThis->pIdx) + RTDbgModSymbolCount(pThis->hCnt);
     return RTDbgModSymbolCount(pThis->hCnt);
 }
 
@@ -4594,7 +5449,11 @@ static DECLCALLBACK(int) rtDbgModDwarf_SymbolAdd(PRTDBGMODINT pMod, const char *
 {
     PRTDBGMODDWARF pThis = (PRTDBGMODDWARF)pMod->pvDbgPriv;
     Assert(!pszSymbol[cchSymbol]); NOREF(cchSymbol);
-    return RTDbgModSymbolAdd(pThis->hCnt, pszSymbol, iSeg, off, cb, fFlags, piOrdinal);
+    pThis->fUserAdditions = true;
+    int rc = RTDbgModSymbolAdd(pThis->hCnt, pszSymbol, iSeg, off, cb, fFlags, piOrdinal);
+    if (RT_SUCCESS(rc) && pThis->pIdx && piOrdinal)
+        *piOrdinal += rtDbgModIdxSymbolCount(pThis->pIdx);
+    return rc;
 }
 
 
@@ -4651,6 +5510,12 @@ static DECLCALLBACK(int) rtDbgModDwarf_Close(PRTDBGMODINT pMod)
         if (pThis->aSections[iSect].pv)
             pThis->pDbgInfoMod->pImgVt->pfnUnmapPart(pThis->pDbgInfoMod, pThis->aSections[iSect].cb, &pThis->aSections[iSect].pv);
 
+    rtDwarfLazy_Term(pThis);
+    rtDbgModIdxClose(pThis->pIdx);
+    pThis->pIdx = NULL;
+    RTStrFree(pThis->pszIdxPath);
+    pThis->pszIdxPath = NULL;
+
     RTDbgModRelease(pThis->hCnt);
     RTMemFree(pThis->paCachedAbbrevs);
     if (pThis->pNestedMod)
@@ -4871,7 +5736,22 @@ static DECLCALLBACK(int) rtDbgModDwarf_TryOpen(PRTDBGMODINT pMod, RTLDRARCH enmA
                 pMod->pvDbgPriv = pThis;
 
                 rc = rtDbgModDwarfAddSegmentsFromImage(pThis);
-                if (RT_SUCCESS(rc))
+                if (RT_SUCCESS(rc) && pThis->iWatcomPass == -1)
+                {
+                    /*
+                     * Use the symbol index cache if we've got a valid one for
+                     * this image, otherwise load the compilation units on demand.
+                     */
+                    rtDbgModDwarfSetupIndexCache(pThis, pMod);
+                    if (pThis->pIdx)
+                        return VINF_SUCCESS;
+                    rc = rtDwarfLazy_Init(pThis);
+                    if (RT_SUCCESS(rc))
+                        return VINF_SUCCESS;
+                    RTStrFree(pThis->pszIdxPath);
+                    pThis->pszIdxPath = NULL;
+                }
+                else if (RT_SUCCESS(rc))
                     rc = rtDwarfInfo_LoadAll(pThis);
                 if (RT_SUCCESS(rc))
                     rc = rtDwarfSyms_LoadAll(pThis);
@@ -4893,14 +5773,7 @@ static DECLCALLBACK(int) rtDbgModDwarf_TryOpen(PRTDBGMODINT pMod, RTLDRARCH enmA
                     /*
                      * Free the cached abbreviations and unload all sections.
                      */
-                    pThis->cCachedAbbrevsAlloced = 0;
-                    RTMemFree(pThis->paCachedAbbrevs);
-                    pThis->paCachedAbbrevs = NULL;
-
-                    for (unsigned iSect = 0; iSect < RT_ELEMENTS(pThis->aSections); iSect++)
-                        if (pThis->aSections[iSect].pv)
-                            pThis->pDbgInfoMod->pImgVt->pfnUnmapPart(pThis->pDbgInfoMod, pThis->aSections[iSect].cb,
-                                                                     &pThis->aSections[iSect].pv);
+                    rtDbgModDwarfFreeParseState(pThis);
 
                     /** @todo Kill pThis->CompileUnitList and the alloc caches. */
                     return VINF_SUCCESS;
@@ -0,0 +1,784 @@
+/* $Id$ */
+/** @file
+ * IPRT - Debug Module Symbol Index Cache.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/dbg.h>
+#include "internal/iprt.h"
+
+#include <iprt/assert.h>
+#include <iprt/ctype.h>
+#include <iprt/env.h>
+#include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/log.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/sort.h>
+#include <iprt/string.h>
+#include "internal/dbgmod.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The index file signature. */
+#define RTDBGMODIDX_SIGNATURE           "IPRT-DBGMOD-IDX"
+/** The current index file format version. */
+#define RTDBGMODIDX_VERSION             UINT32_C(1)
+/** Endian marker. */
+#define RTDBGMODIDX_ENDIAN              UINT32_C(0x01020304)
+/** The max key (build ID) size. */
+#define RTDBGMODIDX_MAX_KEY             64
+/** The environment variable specifying the cache directory. */
+#define RTDBGMODIDX_ENV_CACHE_DIR       "IPRT_DBG_INDEX_CACHE"
+/** The index file suffix. */
+#define RTDBGMODIDX_SUFF                ".rtdbgidx"
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * The index file header.
+ *
+ * All fields are in host endian, the file is not meant to be portable.  All
+ * tables are 8 byte aligned and the offsets are relative to the start of the
+ * file.
+ */
+typedef struct RTDBGMODIDXHDR
+{
+    /** Signature (RTDBGMODIDX_SIGNATURE). */
+    char            szSignature[16];
+    /** The format version (RTDBGMODIDX_VERSION). */
+    uint32_t        uVersion;
+    /** Endian marker (RTDBGMODIDX_ENDIAN). */
+    uint32_t        uEndian;
+    /** The header size. */
+    uint32_t        cbHdr;
+    /** The size of the key. */
+    uint32_t        cbKey;
+    /** The key (build ID) of the image the index was created from. */
+    uint8_t         abKey[RTDBGMODIDX_MAX_KEY];
+    /** The file size. */
+    uint64_t        cbFile;
+    /** Number of segments. */
+    uint32_t        cSegs;
+    /** Number of symbols. */
+    uint32_t        cSymbols;
+    /** Number of line numbers. */
+    uint32_t        cLines;
+    /** Size of the string table. */
+    uint32_t        cbStrings;
+    /** Offset of the segment table (RTDBGMODIDXSEG). */
+    uint64_t        offSegs;
+    /** Offset of the symbol table (RTDBGMODIDXSYM), in ordinal order. */
+    uint64_t        offSymbols;
+    /** Offset of the symbol indexes sorted by segment and offset. */
+    uint64_t        offSymsByAddr;
+    /** Offset of the symbol indexes sorted by name. */
+    uint64_t        offSymsByName;
+    /** Offset of the line number table (RTDBGMODIDXLINE), in ordinal order. */
+    uint64_t        offLines;
+    /** Offset of the line number indexes sorted by segment and offset. */
+    uint64_t        offLinesByAddr;
+    /** Offset of the string table. */
+    uint64_t        offStrings;
+} RTDBGMODIDXHDR;
+AssertCompileSizeAlignment(RTDBGMODIDXHDR, 8);
+/** Pointer to an index file header. */
+typedef RTDBGMODIDXHDR *PRTDBGMODIDXHDR;
+/** Pointer to a const index file header. */
+typedef RTDBGMODIDXHDR const *PCRTDBGMODIDXHDR;
+
+/**
+ * Index file segment entry.
+ */
+typedef struct RTDBGMODIDXSEG
+{
+    /** The image relative address of the segment. */
+    uint64_t        uRva;
+    /** The segment size. */
+    uint64_t        cb;
+    /** The segment flags. */
+    uint32_t        fFlags;
+    /** The string table offset of the segment name. */
+    uint32_t        offName;
+} RTDBGMODIDXSEG;
+AssertCompileSizeAlignment(RTDBGMODIDXSEG, 8);
+/** Pointer to a const index file segment entry. */
+typedef RTDBGMODIDXSEG const *PCRTDBGMODIDXSEG;
+
+/**
+ * Index file symbol entry.
+ */
+typedef struct RTDBGMODIDXSYM
+{
+    /** The segment offset. */
+    uint64_t        off;
+    /** The symbol size. */
+    uint64_t        cb;
+    /** The segment index (can be RTDBGSEGIDX_ABS). */
+    uint32_t        iSeg;
+    /** The symbol flags. */
+    uint32_t        fFlags;
+    /** The string table offset of the symbol name. */
+    uint32_t        offName;
+    /** The length of the symbol name. */
+    uint32_t        cchName;
+} RTDBGMODIDXSYM;
+AssertCompileSizeAlignment(RTDBGMODIDXSYM, 8);
+/** Pointer to a const index file symbol entry. */
+typedef RTDBGMODIDXSYM const *PCRTDBGMODIDXSYM;
+
+/**
+ * Index file line number entry.
+ */
+typedef struct RTDBGMODIDXLINE
+{
+    /** The segment offset. */
+    uint64_t        off;
+    /** The segment index. */
+    uint32_t        iSeg;
+    /** The line number. */
+    uint32_t        uLineNo;
+    /** The string table offset of the file name. */
+    uint32_t        offFile;
+    /** Reserved / alignment padding. */
+    uint32_t        u32Reserved;
+} RTDBGMODIDXLINE;
+AssertCompileSizeAlignment(RTDBGMODIDXLINE, 8);
+/** Pointer to a const index file line number entry. */
+typedef RTDBGMODIDXLINE const *PCRTDBGMODIDXLINE;
+
+/**
+ * A loaded index file.
+ */
+typedef struct RTDBGMODIDX
+{
+    /** The file content (RTFileReadAll). */
+    void               *pvFile;
+    /** The file size. */
+    size_t              cbFile;
+    /** The header. */
+    PCRTDBGMODIDXHDR    pHdr;
+    /** The symbol table. */
+    PCRTDBGMODIDXSYM    paSymbols;
+    /** Symbol indexes sorted by address. */
+    uint32_t const     *paiSymsByAddr;
+    /** Symbol indexes sorted by name. */
+    uint32_t const     *paiSymsByName;
+    /** The line number table. */
+    PCRTDBGMODIDXLINE   paLines;
+    /** Line number indexes sorted by address. */
+    uint32_t const     *paiLinesByAddr;
+    /** The string table. */
+    const char         *pachStrings;
+} RTDBGMODIDX;
+
+/**
+ * String table builder used when writing an index.
+ */
+typedef struct RTDBGMODIDXSTRTAB
+{
+    /** The string table. */
+    char               *pch;
+    /** Bytes used. */
+    uint32_t            cb;
+    /** Bytes allocated. */
+    uint32_t            cbAlloc;
+} RTDBGMODIDXSTRTAB;
+/** Pointer to a string table builder. */
+typedef RTDBGMODIDXSTRTAB *PRTDBGMODIDXSTRTAB;
+
+/**
+ * Sort context used when writing an index.
+ */
+typedef struct RTDBGMODIDXSORTCTX
+{
+    RTDBGMODIDXSYM const   *paSymbols;
+    RTDBGMODIDXLINE const  *paLines;
+    const char             *pachStrings;
+} RTDBGMODIDXSORTCTX;
+
+
+
+DECLHIDDEN(int) rtDbgModIdxQueryCachePath(const char *pszName, void const *pvKey, size_t cbKey, char *pszPath, size_t cbPath)
+{
+    AssertReturn(cbKey > 0 && cbKey <= RTDBGMODIDX_MAX_KEY, VERR_INVALID_PARAMETER);
+
+    char szDir[RTPATH_MAX];
+    int rc = RTEnvGetEx(RTENV_DEFAULT, RTDBGMODIDX_ENV_CACHE_DIR, szDir, sizeof(szDir), NULL);
+    if (RT_FAILURE(rc) || !szDir[0])
+        return VERR_NOT_FOUND;
+
+    /* Module names are usually plain file names, but sanitize them anyway. */
+    char szName[64];
+    RTStrCopy(szName, sizeof(szName), pszName && *pszName ? RTPathFilename(pszName) : "module");
+    for (char *psz = szName; *psz; psz++)
+        if (!RT_C_IS_ALNUM(*psz) && *psz != '.' && *psz != '-' && *psz != '_')
+            *psz = '_';
+
+    char szKey[RTDBGMODIDX_MAX_KEY * 2 + 1];
+    rc = RTStrPrintHexBytes(szKey, sizeof(szKey), pvKey, cbKey, 0 /*fFlags*/);
+    AssertRCReturn(rc, rc);
+
+    char szFile[64 + 1 + RTDBGMODIDX_MAX_KEY * 2 + sizeof(RTDBGMODIDX_SUFF)];
+    RTStrPrintf(szFile, sizeof(szFile), "%s-%s" RTDBGMODIDX_SUFF, szName, szKey);
+    return RTPathJoin(pszPath, cbPath, szDir, szFile);
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxOpen(const char *pszPath, void const *pvKey, size_t cbKey, RTDBGMOD hCnt, PRTDBGMODIDX *ppIdx)
+{
+    *ppIdx = NULL;
+    AssertReturn(cbKey > 0 && cbKey <= RTDBGMODIDX_MAX_KEY, VERR_INVALID_PARAMETER);
+
+    /*
+     * Read the whole thing into memory; it's laid out so it can be used as-is.
+     */
+    void  *pvFile;
+    size_t cbFile;
+    int rc = RTFileReadAll(pszPath, &pvFile, &cbFile);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    /*
+     * Validate the header.
+     */
+    PCRTDBGMODIDXHDR pHdr = (PCRTDBGMODIDXHDR)pvFile;
+    rc = VERR_INVALID_EXE_SIGNATURE;
+    if (   cbFile >= sizeof(*pHdr)
+        && !memcmp(pHdr->szSignature, RTDBGMODIDX_SIGNATURE, sizeof(RTDBGMODIDX_SIGNATURE))
+        && pHdr->uVersion == RTDBGMODIDX_VERSION
+        && pHdr->uEndian  == RTDBGMODIDX_ENDIAN
+        && pHdr->cbHdr    == sizeof(*pHdr))
+    {
+        rc = VERR_MISMATCH;
+        if (   pHdr->cbKey == cbKey
+            && !memcmp(pHdr->abKey, pvKey, cbKey))
+        {
+            rc = VERR_BAD_EXE_FORMAT;
+#define RTDBGMODIDX_IS_TAB_OK(a_off, a_cEntries, a_cbEntry) \
+            (   !((a_off) & 7) \
+             && (a_off) >= sizeof(*pHdr) \
+             && (a_off) <= cbFile \
+             && (uint64_t)(a_cEntries) * (a_cbEntry) <= cbFile - (a_off) )
+            if (   pHdr->cbFile == cbFile
+                && pHdr->cbStrings > 0
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offSegs,        pHdr->cSegs,     sizeof(RTDBGMODIDXSEG))
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offSymbols,     pHdr->cSymbols,  sizeof(RTDBGMODIDXSYM))
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offSymsByAddr,  pHdr->cSymbols,  sizeof(uint32_t))
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offSymsByName,  pHdr->cSymbols,  sizeof(uint32_t))
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offLines,       pHdr->cLines,    sizeof(RTDBGMODIDXLINE))
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offLinesByAddr, pHdr->cLines,    sizeof(uint32_t))
+                && RTDBGMODIDX_IS_TAB_OK(pHdr->offStrings,     pHdr->cbStrings, 1))
+            {
+#undef RTDBGMODIDX_IS_TAB_OK
+                PRTDBGMODIDX pIdx = (PRTDBGMODIDX)RTMemAllocZ(sizeof(*pIdx));
+                if (pIdx)
+                {
+                    uint8_t const *pbFile = (uint8_t const *)pvFile;
+                    pIdx->pvFile         = pvFile;
+                    pIdx->cbFile         = cbFile;
+                    pIdx->pHdr           = pHdr;
+                    pIdx->paSymbols      = (PCRTDBGMODIDXSYM)&pbFile[pHdr->offSymbols];
+                    pIdx->paiSymsByAddr  = (uint32_t const *)&pbFile[pHdr->offSymsByAddr];
+                    pIdx->paiSymsByName  = (uint32_t const *)&pbFile[pHdr->offSymsByName];
+                    pIdx->paLines        = (PCRTDBGMODIDXLINE)&pbFile[pHdr->offLines];
+                    pIdx->paiLinesByAddr = (uint32_t const *)&pbFile[pHdr->offLinesByAddr];
+                    pIdx->pachStrings    = (const char *)&pbFile[pHdr->offStrings];
+
+                    /*
+                     * Validate the tables so the lookup code doesn't need to.
+                     */
+                    uint32_t const cbStrings = pHdr->cbStrings;
+                    const char    *pachStr   = pIdx->pachStrings;
+                    bool           fOk       = pachStr[cbStrings - 1] == '\0';
+
+                    PCRTDBGMODIDXSEG paSegs = (PCRTDBGMODIDXSEG)&pbFile[pHdr->offSegs];
+                    fOk = fOk && pHdr->cSegs == RTDbgModSegmentCount(hCnt);
+                    for (uint32_t i = 0; i < pHdr->cSegs && fOk; i++)
+                    {
+                        RTDBGSEGMENT SegInfo;
+                        fOk = paSegs[i].offName < cbStrings
+                           && RT_SUCCESS(RTDbgModSegmentByIndex(hCnt, i, &SegInfo))
+                           && SegInfo.uRva == paSegs[i].uRva
+                           && SegInfo.cb   == paSegs[i].cb;
+                    }
+
+                    for (uint32_t i = 0; i < pHdr->cSymbols && fOk; i++)
+                    {
+                        PCRTDBGMODIDXSYM pSym = &pIdx->paSymbols[i];
+                        fOk = (pSym->iSeg < pHdr->cSegs || pSym->iSeg == RTDBGSEGIDX_ABS)
+                           && pSym->cchName < RTDBG_SYMBOL_NAME_LENGTH
+                           && pSym->offName < cbStrings
+                           && pSym->cchName < cbStrings - pSym->offName
+                           && pachStr[pSym->offName + pSym->cchName] == '\0'
+                           && pIdx->paiSymsByAddr[i] < pHdr->cSymbols
+                           && pIdx->paiSymsByName[i] < pHdr->cSymbols;
+                    }
+
+                    for (uint32_t i = 0; i < pHdr->cLines && fOk; i++)
+                    {
+                        PCRTDBGMODIDXLINE pLine = &pIdx->paLines[i];
+                        fOk = pLine->iSeg < pHdr->cSegs
+                           && pLine->offFile < cbStrings
+                           && RTStrNLen(&pachStr[pLine->offFile], cbStrings - pLine->offFile) < RTDBG_FILE_NAME_LENGTH
+                           && pIdx->paiLinesByAddr[i] < pHdr->cLines;
+                    }
+
+                    if (fOk)
+                    {
+                        *ppIdx = pIdx;
+                        return VINF_SUCCESS;
+                    }
+                    Log(("rtDbgModIdxOpen: '%s' failed validation\n", pszPath));
+                    RTMemFree(pIdx);
+                }
+                else
+                    rc = VERR_NO_MEMORY;
+            }
+        }
+    }
+
+    RTFileReadAllFree(pvFile, cbFile);
+    return rc;
+}
+
+
+DECLHIDDEN(void) rtDbgModIdxClose(PRTDBGMODIDX pIdx)
+{
+    if (pIdx)
+    {
+        RTFileReadAllFree(pIdx->pvFile, pIdx->cbFile);
+        pIdx->pvFile = NULL;
+        RTMemFree(pIdx);
+    }
+}
+
+
+/**
+ * Adds a string to the string table.
+ *
+ * @returns Offset of the string, UINT32_MAX on failure.
+ * @param   pStrTab         The string table builder.
+ * @param   pszString       The string.
+ */
+static uint32_t rtDbgModIdxStrTabAdd(PRTDBGMODIDXSTRTAB pStrTab, const char *pszString)
+{
+    size_t const cbString = strlen(pszString) + 1;
+    if (pStrTab->cbAlloc - pStrTab->cb < cbString)
+    {
+        size_t cbNew = RT_MAX((size_t)pStrTab->cbAlloc * 2, pStrTab->cb + cbString + _4K);
+        if (cbNew >= UINT32_MAX)
+            return UINT32_MAX;
+        void *pvNew = RTMemRealloc(pStrTab->pch, cbNew);
+        if (!pvNew)
+            return UINT32_MAX;
+        pStrTab->pch     = (char *)pvNew;
+        pStrTab->cbAlloc = (uint32_t)cbNew;
+    }
+    uint32_t const off = pStrTab->cb;
+    memcpy(&pStrTab->pch[off], pszString, cbString);
+    pStrTab->cb += (uint32_t)cbString;
+    return off;
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, Symbols by segment and offset.} */
+static DECLCALLBACK(int) rtDbgModIdxCmpSymByAddr(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RTDBGMODIDXSORTCTX const *pCtx = (RTDBGMODIDXSORTCTX const *)pvUser;
+    PCRTDBGMODIDXSYM pSym1 = &pCtx->paSymbols[*(uint32_t const *)pvElement1];
+    PCRTDBGMODIDXSYM pSym2 = &pCtx->paSymbols[*(uint32_t const *)pvElement2];
+    if (pSym1->iSeg != pSym2->iSeg)
+        return pSym1->iSeg < pSym2->iSeg ? -1 : 1;
+    if (pSym1->off != pSym2->off)
+        return pSym1->off < pSym2->off ? -1 : 1;
+    return 0;
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, Symbols by name.} */
+static DECLCALLBACK(int) rtDbgModIdxCmpSymByName(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RTDBGMODIDXSORTCTX const *pCtx = (RTDBGMODIDXSORTCTX const *)pvUser;
+    return strcmp(&pCtx->pachStrings[pCtx->paSymbols[*(uint32_t const *)pvElement1].offName],
+                  &pCtx->pachStrings[pCtx->paSymbols[*(uint32_t const *)pvElement2].offName]);
+}
+
+
+/** @callback_method_impl{FNRTSORTCMP, Line numbers by segment and offset.} */
+static DECLCALLBACK(int) rtDbgModIdxCmpLineByAddr(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    RTDBGMODIDXSORTCTX const *pCtx = (RTDBGMODIDXSORTCTX const *)pvUser;
+    PCRTDBGMODIDXLINE pLine1 = &pCtx->paLines[*(uint32_t const *)pvElement1];
+    PCRTDBGMODIDXLINE pLine2 = &pCtx->paLines[*(uint32_t const *)pvElement2];
+    if (pLine1->iSeg != pLine2->iSeg)
+        return pLine1->iSeg < pLine2->iSeg ? -1 : 1;
+    if (pLine1->off != pLine2->off)
+        return pLine1->off < pLine2->off ? -1 : 1;
+    return 0;
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxWrite(const char *pszPath, void const *pvKey, size_t cbKey, RTDBGMOD hCnt)
+{
+    AssertReturn(cbKey > 0 && cbKey <= RTDBGMODIDX_MAX_KEY, VERR_INVALID_PARAMETER);
+
+    uint32_t const cSegs    = RTDbgModSegmentCount(hCnt);
+    uint32_t const cSymbols = RTDbgModSymbolCount(hCnt);
+    uint32_t const cLines   = RTDbgModLineCount(hCnt);
+
+    /*
+     * Collect everything from the container.
+     */
+    int                 rc        = VINF_SUCCESS;
+    RTDBGMODIDXSTRTAB   StrTab    = { NULL, 0, 0 };
+    RTDBGMODIDXSEG     *paSegs    = (RTDBGMODIDXSEG *)RTMemAllocZ(sizeof(paSegs[0]) * RT_MAX(cSegs, 1));
+    RTDBGMODIDXSYM     *paSymbols = (RTDBGMODIDXSYM *)RTMemAllocZ(sizeof(paSymbols[0]) * RT_MAX(cSymbols, 1));
+    RTDBGMODIDXLINE    *paLines   = (RTDBGMODIDXLINE *)RTMemAllocZ(sizeof(paLines[0]) * RT_MAX(cLines, 1));
+    uint32_t           *paiIdxs   = (uint32_t *)RTMemAlloc(sizeof(uint32_t) * (RT_MAX(cSymbols, 1) * 2 + RT_MAX(cLines, 1)));
+    if (   !paSegs
+        || !paSymbols
+        || !paLines
+        || !paiIdxs
+        || rtDbgModIdxStrTabAdd(&StrTab, "") != 0)
+        rc = VERR_NO_MEMORY;
+
+    for (uint32_t i = 0; i < cSegs && RT_SUCCESS(rc); i++)
+    {
+        RTDBGSEGMENT SegInfo;
+        rc = RTDbgModSegmentByIndex(hCnt, i, &SegInfo);
+        if (RT_SUCCESS(rc))
+        {
+            paSegs[i].uRva    = SegInfo.uRva;
+            paSegs[i].cb      = SegInfo.cb;
+            paSegs[i].fFlags  = SegInfo.fFlags;
+            paSegs[i].offName = rtDbgModIdxStrTabAdd(&StrTab, SegInfo.szName);
+            if (paSegs[i].offName == UINT32_MAX)
+                rc = VERR_NO_MEMORY;
+        }
+    }
+
+    for (uint32_t i = 0; i < cSymbols && RT_SUCCESS(rc); i++)
+    {
+        RTDBGSYMBOL SymInfo;
+        rc = RTDbgModSymbolByOrdinal(hCnt, i, &SymInfo);
+        if (RT_SUCCESS(rc))
+        {
+            paSymbols[i].off     = SymInfo.offSeg;
+            paSymbols[i].cb      = SymInfo.cb;
+            paSymbols[i].iSeg    = SymInfo.iSeg;
+            paSymbols[i].fFlags  = SymInfo.fFlags;
+            paSymbols[i].cchName = (uint32_t)strlen(SymInfo.szName);
+            paSymbols[i].offName = rtDbgModIdxStrTabAdd(&StrTab, SymInfo.szName);
+            if (paSymbols[i].offName == UINT32_MAX)
+                rc = VERR_NO_MEMORY;
+        }
+    }
+
+    uint32_t offPrevFile = 0;
+    for (uint32_t i = 0; i < cLines && RT_SUCCESS(rc); i++)
+    {
+        RTDBGLINE LineInfo;
+        rc = RTDbgModLineByOrdinal(hCnt, i, &LineInfo);
+        if (RT_SUCCESS(rc))
+        {
+            paLines[i].off     = LineInfo.offSeg;
+            paLines[i].iSeg    = LineInfo.iSeg;
+            paLines[i].uLineNo = LineInfo.uLineNo;
+            /* Line numbers come in runs from the same file, so only compare with the previous one. */
+            if (i == 0 || strcmp(&StrTab.pch[offPrevFile], LineInfo.szFilename))
+                offPrevFile = rtDbgModIdxStrTabAdd(&StrTab, LineInfo.szFilename);
+            paLines[i].offFile = offPrevFile;
+            if (offPrevFile == UINT32_MAX)
+                rc = VERR_NO_MEMORY;
+        }
+    }
+
+    /*
+     * Sort the lookup indexes.
+     */
+    uint32_t *paiSymsByAddr  = paiIdxs;
+    uint32_t *paiSymsByName  = paiIdxs ? &paiIdxs[cSymbols] : NULL;
+    uint32_t *paiLinesByAddr = paiIdxs ? &paiIdxs[cSymbols * 2] : NULL;
+    if (RT_SUCCESS(rc))
+    {
+        RTDBGMODIDXSORTCTX SortCtx;
+        SortCtx.paSymbols   = paSymbols;
+        SortCtx.paLines     = paLines;
+        SortCtx.pachStrings = StrTab.pch;
+
+        for (uint32_t i = 0; i < cSymbols; i++)
+            paiSymsByAddr[i] = paiSymsByName[i] = i;
+        for (uint32_t i = 0; i < cLines; i++)
+            paiLinesByAddr[i] = i;
+        RTSort(paiSymsByAddr, cSymbols, sizeof(uint32_t), rtDbgModIdxCmpSymByAddr, &SortCtx);
+        RTSort(paiSymsByName, cSymbols, sizeof(uint32_t), rtDbgModIdxCmpSymByName, &SortCtx);
+        RTSort(paiLinesByAddr, cLines, sizeof(uint32_t), rtDbgModIdxCmpLineByAddr, &SortCtx);
+    }
+
+    /*
+     * Lay out the file and write it to a temporary file which is then renamed
+     * into place, so concurrent readers never see a partial index.
+     */
+    if (RT_SUCCESS(rc))
+    {
+        RTDBGMODIDXHDR Hdr;
+        RT_ZERO(Hdr);
+        memcpy(Hdr.szSignature, RTDBGMODIDX_SIGNATURE, sizeof(RTDBGMODIDX_SIGNATURE));
+        Hdr.uVersion        = RTDBGMODIDX_VERSION;
+        Hdr.uEndian         = RTDBGMODIDX_ENDIAN;
+        Hdr.cbHdr           = sizeof(Hdr);
+        Hdr.cbKey           = (uint32_t)cbKey;
+        memcpy(Hdr.abKey, pvKey, cbKey);
+        Hdr.cSegs           = cSegs;
+        Hdr.cSymbols        = cSymbols;
+        Hdr.cLines          = cLines;
+        Hdr.cbStrings       = StrTab.cb;
+        Hdr.offSegs         = sizeof(Hdr);
+        Hdr.offSymbols      = Hdr.offSegs        + RT_ALIGN_64(sizeof(paSegs[0])    * cSegs,    8);
+        Hdr.offSymsByAddr   = Hdr.offSymbols     + RT_ALIGN_64(sizeof(paSymbols[0]) * cSymbols, 8);
+        Hdr.offSymsByName   = Hdr.offSymsByAddr  + RT_ALIGN_64(sizeof(uint32_t)     * cSymbols, 8);
+        Hdr.offLines        = Hdr.offSymsByName  + RT_ALIGN_64(sizeof(uint32_t)     * cSymbols, 8);
+        Hdr.offLinesByAddr  = Hdr.offLines       + RT_ALIGN_64(sizeof(paLines[0])   * cLines,   8);
+        Hdr.offStrings      = Hdr.offLinesByAddr + RT_ALIGN_64(sizeof(uint32_t)     * cLines,   8);
+        Hdr.cbFile          = Hdr.offStrings     + RT_ALIGN_64(StrTab.cb, 8);
+
+        uint8_t *pbFile = (uint8_t *)RTMemAllocZ((size_t)Hdr.cbFile);
+        if (pbFile)
+        {
+            memcpy(pbFile, &Hdr, sizeof(Hdr));
+            memcpy(&pbFile[Hdr.offSegs],        paSegs,         sizeof(paSegs[0])    * cSegs);
+            memcpy(&pbFile[Hdr.offSymbols],     paSymbols,      sizeof(paSymbols[0]) * cSymbols);
+            memcpy(&pbFile[Hdr.offSymsByAddr],  paiSymsByAddr,  sizeof(uint32_t)     * cSymbols);
+            memcpy(&pbFile[Hdr.offSymsByName],  paiSymsByName,  sizeof(uint32_t)     * cSymbols);
+            memcpy(&pbFile[Hdr.offLines],       paLines,        sizeof(paLines[0])   * cLines);
+            memcpy(&pbFile[Hdr.offLinesByAddr], paiLinesByAddr, sizeof(uint32_t)     * cLines);
+            memcpy(&pbFile[Hdr.offStrings],     StrTab.pch,     StrTab.cb);
+
+            char szTmpPath[RTPATH_MAX];
+            rc = RTStrPrintf2(szTmpPath, sizeof(szTmpPath), "%s.%u.tmp", pszPath, RTProcSelf()) > 0
+               ? VINF_SUCCESS : VERR_FILENAME_TOO_LONG;
+            RTFILE hFile = NIL_RTFILE;
+            if (RT_SUCCESS(rc))
+                rc = RTFileOpen(&hFile, szTmpPath, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_WRITE);
+            if (RT_SUCCESS(rc))
+            {
+                rc = RTFileWrite(hFile, pbFile, (size_t)Hdr.cbFile, NULL);
+                int rc2 = RTFileClose(hFile);
+                if (RT_SUCCESS(rc))
+                    rc = rc2;
+                if (RT_SUCCESS(rc))
+                    rc = RTFileRename(szTmpPath, pszPath, RTPATHRENAME_FLAGS_REPLACE);
+                if (RT_FAILURE(rc))
+                    RTFileDelete(szTmpPath);
+            }
+            RTMemFree(pbFile);
+        }
+        else
+            rc = VERR_NO_MEMORY;
+    }
+
+    Log(("rtDbgModIdxWrite: '%s' cSegs=%u cSymbols=%u cLines=%u cbStrings=%#x -> %Rrc\n",
+         pszPath, cSegs, cSymbols, cLines, StrTab.cb, rc));
+
+    RTMemFree(StrTab.pch);
+    RTMemFree(paiIdxs);
+    RTMemFree(paLines);
+    RTMemFree(paSymbols);
+    RTMemFree(paSegs);
+    return rc;
+}
+
+
+/**
+ * Copies an index symbol entry into the API structure.
+ */
+static int rtDbgModIdxReturnSymbol(PRTDBGMODIDX pIdx, uint32_t iOrdinal, PRTDBGSYMBOL pSymInfo)
+{
+    PCRTDBGMODIDXSYM pSym = &pIdx->paSymbols[iOrdinal];
+    pSymInfo->Value    = pSym->off;
+    pSymInfo->offSeg   = pSym->off;
+    pSymInfo->iSeg     = pSym->iSeg;
+    pSymInfo->fFlags   = pSym->fFlags;
+    pSymInfo->cb       = pSym->cb;
+    pSymInfo->iOrdinal = iOrdinal;
+    memcpy(pSymInfo->szName, &pIdx->pachStrings[pSym->offName], pSym->cchName + 1);
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Copies an index line number entry into the API structure.
+ */
+static int rtDbgModIdxReturnLine(PRTDBGMODIDX pIdx, uint32_t iOrdinal, PRTDBGLINE pLineInfo)
+{
+    PCRTDBGMODIDXLINE pLine = &pIdx->paLines[iOrdinal];
+    pLineInfo->Address  = pLine->off;
+    pLineInfo->offSeg   = pLine->off;
+    pLineInfo->iSeg     = pLine->iSeg;
+    pLineInfo->uLineNo  = pLine->uLineNo;
+    pLineInfo->iOrdinal = iOrdinal;
+    RTStrCopy(pLineInfo->szFilename, sizeof(pLineInfo->szFilename), &pIdx->pachStrings[pLine->offFile]);
+    return VINF_SUCCESS;
+}
+
+
+DECLHIDDEN(uint32_t) rtDbgModIdxSymbolCount(PRTDBGMODIDX pIdx)
+{
+    return pIdx->pHdr->cSymbols;
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxSymbolByOrdinal(PRTDBGMODIDX pIdx, uint32_t iOrdinal, PRTDBGSYMBOL pSymInfo)
+{
+    if (iOrdinal >= pIdx->pHdr->cSymbols)
+        return pIdx->pHdr->cSymbols
+             ? VERR_DBG_NO_SYMBOLS
+             : VERR_SYMBOL_NOT_FOUND;
+    return rtDbgModIdxReturnSymbol(pIdx, iOrdinal, pSymInfo);
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxSymbolByName(PRTDBGMODIDX pIdx, const char *pszSymbol, PRTDBGSYMBOL pSymInfo)
+{
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pIdx->pHdr->cSymbols;
+    while (iStart < iEnd)
+    {
+        uint32_t const i     = iStart + (iEnd - iStart) / 2;
+        uint32_t const iSym  = pIdx->paiSymsByName[i];
+        int      const iDiff = strcmp(pszSymbol, &pIdx->pachStrings[pIdx->paSymbols[iSym].offName]);
+        if (iDiff == 0)
+            return rtDbgModIdxReturnSymbol(pIdx, iSym, pSymInfo);
+        if (iDiff < 0)
+            iEnd = i;
+        else
+            iStart = i + 1;
+    }
+    return VERR_SYMBOL_NOT_FOUND;
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxSymbolByAddr(PRTDBGMODIDX pIdx, RTDBGSEGIDX iSeg, RTUINTPTR off, uint32_t fFlags,
+                                        PRTINTPTR poffDisp, PRTDBGSYMBOL pSymInfo)
+{
+    AssertMsgReturn(iSeg == RTDBGSEGIDX_ABS || iSeg < pIdx->pHdr->cSegs,
+                    ("iSeg=%#x cSegs=%#x\n", iSeg, pIdx->pHdr->cSegs),
+                    VERR_DBG_INVALID_SEGMENT_INDEX);
+
+    /* Find the first entry above (iSeg, off). */
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pIdx->pHdr->cSymbols;
+    while (iStart < iEnd)
+    {
+        uint32_t const   i    = iStart + (iEnd - iStart) / 2;
+        PCRTDBGMODIDXSYM pSym = &pIdx->paSymbols[pIdx->paiSymsByAddr[i]];
+        if (pSym->iSeg < iSeg || (pSym->iSeg == iSeg && pSym->off <= off))
+            iStart = i + 1;
+        else
+            iEnd = i;
+    }
+
+    /* Pick the best fit the same way the container does. */
+    uint32_t iSym = UINT32_MAX;
+    if (fFlags == RTDBGSYMADDR_FLAGS_GREATER_OR_EQUAL)
+    {
+        if (iStart > 0)
+        {
+            PCRTDBGMODIDXSYM pSym = &pIdx->paSymbols[pIdx->paiSymsByAddr[iStart - 1]];
+            if (pSym->iSeg == iSeg && pSym->off == off)
+                iSym = pIdx->paiSymsByAddr[iStart - 1];
+        }
+        if (   iSym == UINT32_MAX
+            && iStart < pIdx->pHdr->cSymbols
+            && pIdx->paSymbols[pIdx->paiSymsByAddr[iStart]].iSeg == iSeg)
+            iSym = pIdx->paiSymsByAddr[iStart];
+    }
+    else if (   iStart > 0
+             && pIdx->paSymbols[pIdx->paiSymsByAddr[iStart - 1]].iSeg == iSeg)
+        iSym = pIdx->paiSymsByAddr[iStart - 1];
+    if (iSym == UINT32_MAX)
+        return VERR_SYMBOL_NOT_FOUND;
+
+    if (poffDisp)
+        *poffDisp = off - pIdx->paSymbols[iSym].off;
+    return rtDbgModIdxReturnSymbol(pIdx, iSym, pSymInfo);
+}
+
+
+DECLHIDDEN(uint32_t) rtDbgModIdxLineCount(PRTDBGMODIDX pIdx)
+{
+    return pIdx->pHdr->cLines;
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxLineByOrdinal(PRTDBGMODIDX pIdx, uint32_t iOrdinal, PRTDBGLINE pLineInfo)
+{
+    if (iOrdinal >= pIdx->pHdr->cLines)
+        return pIdx->pHdr->cLines
+             ? VERR_DBG_LINE_NOT_FOUND
+             : VERR_DBG_NO_LINE_NUMBERS;
+    return rtDbgModIdxReturnLine(pIdx, iOrdinal, pLineInfo);
+}
+
+
+DECLHIDDEN(int) rtDbgModIdxLineByAddr(PRTDBGMODIDX pIdx, RTDBGSEGIDX iSeg, RTUINTPTR off, PRTINTPTR poffDisp,
+                                      PRTDBGLINE pLineInfo)
+{
+    AssertMsgReturn(iSeg < pIdx->pHdr->cSegs, ("iSeg=%#x cSegs=%#x\n", iSeg, pIdx->pHdr->cSegs),
+                    VERR_DBG_INVALID_SEGMENT_INDEX);
+
+    /* Find the last entry at or below (iSeg, off). */
+    uint32_t iStart = 0;
+    uint32_t iEnd   = pIdx->pHdr->cLines;
+    while (iStart < iEnd)
+    {
+        uint32_t const    i     = iStart + (iEnd - iStart) / 2;
+        PCRTDBGMODIDXLINE pLine = &pIdx->paLines[pIdx->paiLinesByAddr[i]];
+        if (pLine->iSeg < iSeg || (pLine->iSeg == iSeg && pLine->off <= off))
+            iStart = i + 1;
+        else
+            iEnd = i;
+    }
+    if (   iStart == 0
+        || pIdx->paLines[pIdx->paiLinesByAddr[iStart - 1]].iSeg != iSeg)
+        return pIdx->pHdr->cLines
+             ? VERR_DBG_LINE_NOT_FOUND
+             : VERR_DBG_NO_LINE_NUMBERS;
+
+    uint32_t const iLine = pIdx->paiLinesByAddr[iStart - 1];
+    if (poffDisp)
+        *poffDisp = off - pIdx->paLines[iLine].off;
+    return rtDbgModIdxReturnLine(pIdx, iLine, pLineInfo);
+}
+
@@ -1397,6 +1397,114 @@ static DECLCALLBACK(int) RTLDRELF_NAME(ReadDbgInfo)(PRTLDRMODINTERNAL pMod, uint
 }
 
 
+/**
+ * Looks for the GNU build ID note in the note sections.
+ *
+ * @returns IPRT status code.
+ * @retval  VERR_NOT_FOUND if there is no build ID note.
+ * @retval  VERR_BUFFER_OVERFLOW if the buffer is too small, *pcbRet is set to
+ *          the required size.
+ * @param   pModElf         The ELF loader module instance data.
+ * @param   pvBuf           Where to return the build ID bits.
+ * @param   cbBuf           The size of the buffer.
+ * @param   pcbRet          Where to return the size of the build ID.
+ */
+static int RTLDRELF_NAME(QueryBuildId)(PRTLDRMODELF pModElf, void *pvBuf, size_t cbBuf, size_t *pcbRet)
+{
+    RTFOFF const    cbRawImage = pModElf->Core.pReader->pfnSize(pModElf->Core.pReader);
+    const Elf_Shdr *paShdrs    = pModElf->paOrgShdrs;
+    for (unsigned iShdr = 0; iShdr < pModElf->Ehdr.e_shnum; iShdr++)
+    {
+        if (   paShdrs[iShdr].sh_type != SHT_NOTE
+            || paShdrs[iShdr].sh_size < sizeof(Elf_Nhdr)
+            || paShdrs[iShdr].sh_size > _64K
+            || paShdrs[iShdr].sh_offset >= (uint64_t)cbRawImage
+            || paShdrs[iShdr].sh_size > (uint64_t)cbRawImage - paShdrs[iShdr].sh_offset)
+            continue;
+
+        /*
+         * Get hold of the section bits.
+         */
+        size_t const   cbNotes = (size_t)paShdrs[iShdr].sh_size;
+        uint8_t       *pbFree  = NULL;
+        const uint8_t *pbNotes;
+        if (pModElf->pvBits)
+            pbNotes = (const uint8_t *)pModElf->pvBits + paShdrs[iShdr].sh_offset;
+        else
+        {
+            pbNotes = pbFree = (uint8_t *)RTMemTmpAlloc(cbNotes);
+            if (!pbFree)
+                return VERR_NO_TMP_MEMORY;
+            int rc = pModElf->Core.pReader->pfnRead(pModElf->Core.pReader, pbFree, cbNotes, paShdrs[iShdr].sh_offset);
+            if (RT_FAILURE(rc))
+            {
+                RTMemTmpFree(pbFree);
+                return rc;
+            }
+        }
+
+        /*
+         * Walk the notes.  Name and descriptor are both padded to 4 bytes.
+         */
+        int    rc  = VERR_NOT_FOUND;
+        size_t off = 0;
+        while (off + sizeof(Elf_Nhdr) <= cbNotes)
+        {
+            Elf_Nhdr const *pNhdr   = (Elf_Nhdr const *)&pbNotes[off];
+            size_t const    cbName  = RT_ALIGN_Z(pNhdr->n_namesz, 4);
+            size_t const    cbDesc  = RT_ALIGN_Z(pNhdr->n_descsz, 4);
+            size_t const    offName = off + sizeof(Elf_Nhdr);
+            size_t const    offDesc = offName + cbName;
+            if (   cbName < pNhdr->n_namesz /* overflow */
+                || offDesc > cbNotes
+                || cbDesc > cbNotes - offDesc)
+                break;
+
+            if (   pNhdr->n_type   == NT_GNU_BUILD_ID
+                && pNhdr->n_namesz == sizeof("GNU")
+                && !memcmp(&pbNotes[offName], "GNU", sizeof("GNU"))
+                && pNhdr->n_descsz > 0)
+            {
+                *pcbRet = pNhdr->n_descsz;
+                if (cbBuf >= pNhdr->n_descsz)
+                {
+                    memcpy(pvBuf, &pbNotes[offDesc], pNhdr->n_descsz);
+                    rc = VINF_SUCCESS;
+                }
+                else
+                    rc = VERR_BUFFER_OVERFLOW;
+                break;
+            }
+
+            off = offDesc + cbDesc;
+        }
+
+        RTMemTmpFree(pbFree);
+        if (rc != VERR_NOT_FOUND)
+            return rc;
+    }
+    return VERR_NOT_FOUND;
+}
+
+
+/** @copydoc RTLDROPS::pfnQueryProp */
+static DECLCALLBACK(int) RTLDRELF_NAME(QueryProp)(PRTLDRMODINTERNAL pMod, RTLDRPROP enmProp, void const *pvBits,
+                                                  void *pvBuf, size_t cbBuf, size_t *pcbRet)
+{
+    PRTLDRMODELF pModElf = (PRTLDRMODELF)pMod;
+    RT_NOREF_PV(pvBits);
+
+    switch (enmProp)
+    {
+        case RTLDRPROP_BUILDID:
+            return RTLDRELF_NAME(QueryBuildId)(pModElf, pvBuf, cbBuf, pcbRet);
+
+        default:
+            return VERR_NOT_FOUND;
+    }
+}
+
+
 
 /**
  * The ELF module operations.
@@ -1425,7 +1533,7 @@ static RTLDROPS RTLDRELF_MID(s_rtldrElf,Ops) =
     RTLDRELF_NAME(SegOffsetToRva),
     RTLDRELF_NAME(RvaToSegOffset),
     RTLDRELF_NAME(ReadDbgInfo),
-    NULL /*pfnQueryProp*/,
+    RTLDRELF_NAME(QueryProp),
     NULL /*pfnVerifySignature*/,
     NULL /*pfnHashImage*/,
     42
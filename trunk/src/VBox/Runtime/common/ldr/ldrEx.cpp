@@ -635,6 +635,9 @@ RTDECL(int) RTLdrQueryPropEx(RTLDRMOD hLdrMod, RTLDRPROP enmProp, void *pvBits,
             *pcbRet = sizeof(uint32_t);
             AssertReturn(cbBuf >= sizeof(uint32_t), VERR_INVALID_PARAMETER);
             break;
+        case RTLDRPROP_BUILDID:
+            *pcbRet = 0;
+            break;
 
         default:
             AssertFailedReturn(VERR_INVALID_FUNCTION);
@@ -88,10 +88,77 @@ AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER) == 16);
 #define RTLOG_RINGBUF_EYE_CATCHER_END    "\0\0\0END RING BUF"
 AssertCompile(sizeof(RTLOG_RINGBUF_EYE_CATCHER_END) == 16);
 
+#ifdef IN_RING3
+/** The default size of the per-thread deferred logging buffers. */
+# define RTLOG_DEFERRED_BUF_DEFAULT_SIZE    _256K
+/** The max size of the per-thread deferred logging buffers. */
+# define RTLOG_DEFERRED_BUF_MAX_SIZE        _16M
+/** The min size of the per-thread deferred logging buffers. */
+# define RTLOG_DEFERRED_BUF_MIN_SIZE        _4K
+/** How often the flusher thread drains the deferred buffers (ms). */
+# define RTLOG_DEFERRED_FLUSH_INTERVAL_MS   10
+
+/** @name RTLOGDEFERRED_INIT_XXX - RTLOGGERINTERNAL::uDeferredInitState values.
+ * @{ */
+# define RTLOGDEFERRED_INIT_NONE            UINT32_C(0)
+# define RTLOGDEFERRED_INIT_BUSY            UINT32_C(1)
+# define RTLOGDEFERRED_INIT_DONE            UINT32_C(2)
+# define RTLOGDEFERRED_INIT_FAILED          UINT32_C(3)
+/** @} */
+
+/** @name RTLOGDEFERRED_ARG_XXX - Argument kinds captured for deferred formatting.
+ * @{ */
+/** No argument (%%). */
+# define RTLOGDEFERRED_ARG_NONE             0
+/** Something passed as an int or uint32_t. */
+# define RTLOGDEFERRED_ARG_U32              1
+/** Something passed as an uint64_t. */
+# define RTLOGDEFERRED_ARG_U64              2
+/** A pointer value (%p). */
+# define RTLOGDEFERRED_ARG_PTR              3
+/** A zero terminated string, copied (%s). */
+# define RTLOGDEFERRED_ARG_STR              4
+/** Something we cannot capture by value. */
+# define RTLOGDEFERRED_ARG_INVALID          5
+/** Selects the argument kind for an integer type. */
+# define RTLOGDEFERRED_ARG_FOR_SIZE(cb)     ((cb) > sizeof(uint32_t) ? RTLOGDEFERRED_ARG_U64 : RTLOGDEFERRED_ARG_U32)
+/** @} */
+
+/** @name RTLOGDEFERREDREC_TYPE_XXX - Deferred record types.
+ * @{ */
+/** A log message. */
+# define RTLOGDEFERREDREC_TYPE_MSG          UINT32_C(0x4d534731)
+/** Padding up to the end of the ring buffer. */
+# define RTLOGDEFERREDREC_TYPE_WRAP         UINT32_C(0x57524150)
+/** @} */
+#endif
+
 
 /*********************************************************************************************************************************
 *   Structures and Typedefs                                                                                                      *
 *********************************************************************************************************************************/
+#ifdef IN_RING3
+/**
+ * The caller context of a deferred log message, used for the prefix when the
+ * message is finally formatted on the flusher thread.
+ */
+typedef struct RTLOGDEFERREDCTX
+{
+    /** RTTimeNanoTS at the time of logging. */
+    uint64_t                nsTs;
+    /** The TSC (or RTTimeNanoTS) at the time of logging. */
+    uint64_t                uTsc;
+    /** The native thread handle of the logging thread. */
+    RTNATIVETHREAD          hNativeThread;
+    /** The name of the logging thread. */
+    const char             *pszThreadName;
+    /** The CPU / APIC ID at the time of logging. */
+    uint32_t                idCpu;
+} RTLOGDEFERREDCTX;
+/** Pointer to a const deferred caller context. */
+typedef RTLOGDEFERREDCTX const *PCRTLOGDEFERREDCTX;
+#endif
+
 /**
  * Arguments passed to the output function.
  */
@@ -103,6 +170,10 @@ typedef struct RTLOGOUTPUTPREFIXEDARGS
     unsigned                fFlags;
     /** The group. (used for prefixing.) */
     unsigned                iGroup;
+#ifdef IN_RING3
+    /** The caller context when formatting a deferred message, NULL otherwise. */
+    PCRTLOGDEFERREDCTX      pDeferredCtx;
+#endif
 } RTLOGOUTPUTPREFIXEDARGS, *PRTLOGOUTPUTPREFIXEDARGS;
 
 #ifndef IN_RC
@@ -199,11 +270,25 @@ typedef struct RTLOGGERINTERNAL
     /** Pointer to filename. */
     char                    szFilename[RTPATH_MAX];
     /** @} */
+
+    /** @name Deferred logging (RTLOGFLAGS_DEFERRED).
+     * @{ */
+    /** The deferred logging state, NULL until first used. */
+    struct RTLOGDEFERRED * volatile pDeferred;
+    /** Lazy initialization state of pDeferred (RTLOGDEFERRED_INIT_XXX). */
+    uint32_t volatile       uDeferredInitState;
+    /** Number of threads currently in rtlogDeferredWrite. */
+    uint32_t volatile       cDeferredWriters;
+    /** The per-thread buffer size. */
+    uint32_t                cbDeferredBuf;
+    /** What to do when a per-thread buffer is full. */
+    RTLOGDEFERREDOVERFLOW   enmDeferredOverflow;
+    /** @} */
 # endif /* IN_RING3 */
 } RTLOGGERINTERNAL;
 
 /** The revision of the internal logger structure. */
-# define RTLOGGERINTERNAL_REV    UINT32_C(10)
+# define RTLOGGERINTERNAL_REV    UINT32_C(11)
 
 # ifdef IN_RING3
 /** The size of the RTLOGGERINTERNAL structure in ring-0.  */
@@ -215,6 +300,118 @@ AssertCompileMemberAlignment(RTLOGGERINTERNAL, cbRingBufUnflushed, sizeof(uint64
 
 #endif /* !IN_RC */
 
+#ifdef IN_RING3
+/**
+ * Deferred log record header.
+ *
+ * The header is followed by a copy of the format string (zero terminated and
+ * padded to 8 bytes) and then the captured arguments.  Each argument takes
+ * one 64-bit slot, strings are stored as a 64-bit length (UINT64_MAX for
+ * NULL) followed by the zero terminated string padded to 8 bytes.
+ */
+typedef struct RTLOGDEFERREDREC
+{
+    /** The record size including this header, multiple of 8. */
+    uint32_t                cbRec;
+    /** The record type (RTLOGDEFERREDREC_TYPE_XXX).  Only cbRec and this member
+     * are valid for RTLOGDEFERREDREC_TYPE_WRAP. */
+    uint32_t                uType;
+    /** The logging flags. */
+    uint32_t                fFlags;
+    /** The group. */
+    uint32_t                iGroup;
+    /** The CPU / APIC ID. */
+    uint32_t                idCpu;
+    /** The length of the format string. */
+    uint32_t                cchFormat;
+    /** The TSC (or RTTimeNanoTS) value, used for ordering. */
+    uint64_t                uTsc;
+    /** RTTimeNanoTS value. */
+    uint64_t                nsTs;
+} RTLOGDEFERREDREC;
+AssertCompileSizeAlignment(RTLOGDEFERREDREC, 8);
+/** Pointer to a deferred log record. */
+typedef RTLOGDEFERREDREC *PRTLOGDEFERREDREC;
+
+/**
+ * A per-thread deferred logging ring buffer.
+ *
+ * There is a single producer, the owner thread, and a single consumer, which
+ * is whoever owns the logger lock.  The positions are free running 64-bit
+ * counters, the buffer size is a power of two.
+ */
+typedef struct RTLOGDEFERREDBUF
+{
+    /** Pointer to the next buffer of this logger. */
+    struct RTLOGDEFERREDBUF * volatile pNext;
+    /** The producer position. */
+    uint64_t volatile       offWrite;
+    /** The consumer position. */
+    uint64_t volatile       offRead;
+    /** The producer position snapshot taken by the consumer at the start of a
+     * drain round.  Consumer only. */
+    uint64_t                offDrainEnd;
+    /** Number of messages dropped because the buffer was full. */
+    uint32_t volatile       cDropped;
+    /** Set when the owner thread has terminated. */
+    bool volatile           fOrphaned;
+    /** Set while the flusher has been signalled for this buffer. */
+    bool volatile           fSignalled;
+    /** The buffer size (power of two). */
+    uint32_t                cbBuf;
+    /** The native handle of the owner thread. */
+    RTNATIVETHREAD          hNativeThread;
+    /** The name of the owner thread. */
+    char                    szThreadName[32];
+    /** The buffer, cbBuf bytes (RT_ALIGNED to 8 bytes). */
+    uint8_t                *pbBuf;
+} RTLOGDEFERREDBUF;
+/** Pointer to a deferred logging buffer. */
+typedef RTLOGDEFERREDBUF *PRTLOGDEFERREDBUF;
+
+/**
+ * Deferred logging state of a logger instance.
+ */
+typedef struct RTLOGDEFERRED
+{
+    /** The logger. */
+    PRTLOGGER               pLogger;
+    /** The TLS index for the per-thread buffers. */
+    RTTLS                   iTls;
+    /** The list of per-thread buffers (LIFO). */
+    PRTLOGDEFERREDBUF volatile pHead;
+    /** The flusher thread. */
+    RTTHREAD                hThread;
+    /** The flusher thread native handle. */
+    RTNATIVETHREAD volatile hNativeFlusher;
+    /** Event semaphore for waking up the flusher thread. */
+    RTSEMEVENT              hEvt;
+    /** Tells the flusher thread to terminate. */
+    bool volatile           fTerminate;
+} RTLOGDEFERRED;
+/** Pointer to the deferred logging state. */
+typedef RTLOGDEFERRED *PRTLOGDEFERRED;
+
+/**
+ * A parsed format specifier for deferred logging.
+ */
+typedef struct RTLOGDEFERREDSPEC
+{
+    /** Where the specifier ends. */
+    const char             *pszEnd;
+    /** The precision given in the format string, -1 if none or '*'. */
+    int                     cchPrecision;
+    /** Whether the width is passed as an argument. */
+    bool                    fWidthArg;
+    /** Whether the precision is passed as an argument. */
+    bool                    fPrecisionArg;
+    /** The argument kind (RTLOGDEFERRED_ARG_XXX). */
+    uint8_t                 uKind;
+} RTLOGDEFERREDSPEC;
+/** Pointer to a parsed format specifier. */
+typedef RTLOGDEFERREDSPEC *PRTLOGDEFERREDSPEC;
+#endif /* IN_RING3 */
+
 
 /*********************************************************************************************************************************
 *   Internal Functions                                                                                                           *
@@ -240,6 +437,11 @@ static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
 #ifndef IN_RC
 static void rtlogLoggerExFLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, ...);
 #endif
+#ifdef IN_RING3
+static bool rtlogDeferredWrite(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args);
+static void rtlogDeferredDrainLocked(PRTLOGGER pLogger, PRTLOGDEFERRED pDeferred);
+static void rtlogDeferredTerm(PRTLOGGER pLogger);
+#endif
 
 
 /*********************************************************************************************************************************
@@ -317,6 +519,7 @@ static struct
     { "writethru",    sizeof("writethru"   ) - 1,   RTLOGFLAGS_WRITE_THROUGH,       false },
     { "writethrough", sizeof("writethrough") - 1,   RTLOGFLAGS_WRITE_THROUGH,       false },
     { "flush",        sizeof("flush"       ) - 1,   RTLOGFLAGS_FLUSH,               false },
+    { "deferred",     sizeof("deferred"    ) - 1,   RTLOGFLAGS_DEFERRED,            false },
     { "lockcnts",     sizeof("lockcnts"    ) - 1,   RTLOGFLAGS_PREFIX_LOCK_COUNTS,  false },
     { "cpuid",        sizeof("cpuid"       ) - 1,   RTLOGFLAGS_PREFIX_CPUID,        false },
     { "pid",          sizeof("pid"         ) - 1,   RTLOGFLAGS_PREFIX_PID,          false },
@@ -366,6 +569,59 @@ static struct
  */
 static const uint32_t g_acMsLogBackoff[] =
 { 10, 10, 10, 20, 50, 100, 200, 200, 200, 200, 500, 500, 500, 500, 1000, 1000, 1000, 1000, 1000, 1000, 1000 };
+
+/**
+ * The IPRT %R format types that take a plain integer argument and can thus
+ * be captured by value for deferred formatting.
+ */
+static struct
+{
+    const char *pszType;                /**< The type following the 'R'. */
+    uint8_t     cchType;                /**< The length of the type. */
+    uint8_t     uKind;                  /**< RTLOGDEFERRED_ARG_XXX. */
+} const g_aLogDeferredRtTypes[] =
+{
+    { RT_STR_TUPLE("X8"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("X16"),      RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("X32"),      RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("X64"),      RTLOGDEFERRED_ARG_U64 },
+    { RT_STR_TUPLE("U8"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("U16"),      RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("U32"),      RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("U64"),      RTLOGDEFERRED_ARG_U64 },
+    { RT_STR_TUPLE("I8"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("I16"),      RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("I32"),      RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("I64"),      RTLOGDEFERRED_ARG_U64 },
+    { RT_STR_TUPLE("rc"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("rs"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("rf"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("ra"),       RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("Gi"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTGCINT)) },
+    { RT_STR_TUPLE("Gp"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTGCPHYS)) },
+    { RT_STR_TUPLE("Gr"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTGCUINTREG)) },
+    { RT_STR_TUPLE("Gu"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTGCUINT)) },
+    { RT_STR_TUPLE("Gv"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTGCPTR)) },
+    { RT_STR_TUPLE("Gx"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTGCUINT)) },
+    { RT_STR_TUPLE("Hi"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTHCINT)) },
+    { RT_STR_TUPLE("Hp"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTHCPHYS)) },
+    { RT_STR_TUPLE("Hr"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTHCUINTREG)) },
+    { RT_STR_TUPLE("Hu"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTHCUINT)) },
+    { RT_STR_TUPLE("Hv"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTHCPTR)) },
+    { RT_STR_TUPLE("Hx"),       RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTHCUINT)) },
+    { RT_STR_TUPLE("Tbool"),    RTLOGDEFERRED_ARG_U32 },
+    { RT_STR_TUPLE("Tfoff"),    RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTFOFF)) },
+    { RT_STR_TUPLE("Tint"),     RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTINT)) },
+    { RT_STR_TUPLE("Tiop"),     RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTIOPORT)) },
+    { RT_STR_TUPLE("Tnthrd"),   RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTNATIVETHREAD)) },
+    { RT_STR_TUPLE("Tproc"),    RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTPROCESS)) },
+    { RT_STR_TUPLE("Tptr"),     RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTUINTPTR)) },
+    { RT_STR_TUPLE("Treg"),     RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTCCUINTREG)) },
+    { RT_STR_TUPLE("Tsel"),     RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTSEL)) },
+    { RT_STR_TUPLE("Tthrd"),    RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTTHREAD)) },
+    { RT_STR_TUPLE("Tuint"),    RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTUINT)) },
+    { RT_STR_TUPLE("Txint"),    RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(RTUINT)) },
+};
 #endif
 
 
@@ -776,6 +1032,792 @@ static void rtLogRingBufFlush(PRTLOGGER pLogger)
 }
 
 
+# ifdef IN_RING3
+
+/**
+ * Parses a format specifier for deferred logging.
+ *
+ * This mirrors the RTStrFormatV specifier syntax closely enough to know
+ * which arguments the specifier consumes.
+ *
+ * @param   pszSpec         The character following the '%'.
+ * @param   pSpec           Where to return the result.
+ */
+static void rtlogDeferredParseSpec(const char *pszSpec, PRTLOGDEFERREDSPEC pSpec)
+{
+    pSpec->cchPrecision  = -1;
+    pSpec->fWidthArg     = false;
+    pSpec->fPrecisionArg = false;
+    if (*pszSpec == '%')
+    {
+        pSpec->uKind  = RTLOGDEFERRED_ARG_NONE;
+        pSpec->pszEnd = pszSpec + 1;
+        return;
+    }
+
+    /* flags */
+    while (   *pszSpec == '#' || *pszSpec == '-' || *pszSpec == '+' || *pszSpec == ' '
+           || *pszSpec == '0' || *pszSpec == '\'')
+        pszSpec++;
+
+    /* width */
+    if (*pszSpec == '*')
+    {
+        pSpec->fWidthArg = true;
+        pszSpec++;
+    }
+    else
+        while (RT_C_IS_DIGIT(*pszSpec))
+            pszSpec++;
+
+    /* precision */
+    if (*pszSpec == '.')
+    {
+        pszSpec++;
+        if (*pszSpec == '*')
+        {
+            pSpec->fPrecisionArg = true;
+            pszSpec++;
+        }
+        else
+            for (pSpec->cchPrecision = 0; RT_C_IS_DIGIT(*pszSpec); pszSpec++)
+                pSpec->cchPrecision = pSpec->cchPrecision * 10 + *pszSpec - '0';
+    }
+
+    /* argument size */
+    char chArgSize = 0;
+    switch (*pszSpec)
+    {
+        case 'z':
+        case 'L':
+        case 'j':
+        case 't':
+            chArgSize = *pszSpec++;
+            break;
+        case 'l':
+            chArgSize = *pszSpec++;
+            if (*pszSpec == 'l')
+            {
+                chArgSize = 'L';
+                pszSpec++;
+            }
+            break;
+        case 'h':
+            chArgSize = *pszSpec++;
+            if (*pszSpec == 'h')
+            {
+                chArgSize = 'H';
+                pszSpec++;
+            }
+            break;
+        case 'I':
+            if (pszSpec[1] == '6' && pszSpec[2] == '4')
+            {
+                pszSpec += 3;
+                chArgSize = 'L';
+            }
+            else if (pszSpec[1] == '3' && pszSpec[2] == '2')
+                pszSpec += 3;
+            else
+            {
+                pszSpec++;
+                chArgSize = 'j';
+            }
+            break;
+        case 'q':
+            pszSpec++;
+            chArgSize = 'L';
+            break;
+    }
+
+    /* type */
+    pSpec->uKind = RTLOGDEFERRED_ARG_INVALID;
+    switch (*pszSpec)
+    {
+        case 'c':
+            pSpec->uKind = RTLOGDEFERRED_ARG_U32;
+            break;
+
+        case 's':
+        case 'S':
+            if (chArgSize != 'l' && chArgSize != 'L') /* UTF-16 and UCS-4 strings aren't worth it. */
+                pSpec->uKind = RTLOGDEFERRED_ARG_STR;
+            break;
+
+        case 'd':
+        case 'i':
+        case 'o':
+        case 'u':
+        case 'x':
+        case 'X':
+            switch (chArgSize)
+            {
+                case 'L':
+                case 'j': pSpec->uKind = RTLOGDEFERRED_ARG_U64; break;
+                case 'l': pSpec->uKind = RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(unsigned long)); break;
+                case 'z': pSpec->uKind = RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(size_t)); break;
+                case 't': pSpec->uKind = RTLOGDEFERRED_ARG_FOR_SIZE(sizeof(ptrdiff_t)); break;
+                default:  pSpec->uKind = RTLOGDEFERRED_ARG_U32; break;
+            }
+            break;
+
+        case 'p':
+            pSpec->uKind = RTLOGDEFERRED_ARG_PTR;
+            break;
+
+        case 'R':
+            if (!chArgSize)
+                for (unsigned i = 0; i < RT_ELEMENTS(g_aLogDeferredRtTypes); i++)
+                    if (!strncmp(pszSpec + 1, g_aLogDeferredRtTypes[i].pszType, g_aLogDeferredRtTypes[i].cchType))
+                    {
+                        pSpec->uKind = g_aLogDeferredRtTypes[i].uKind;
+                        pszSpec += g_aLogDeferredRtTypes[i].cchType;
+                        break;
+                    }
+            break;
+
+        default:
+            break;
+    }
+    if (*pszSpec)
+        pszSpec++;
+    pSpec->pszEnd = pszSpec;
+}
+
+
+/**
+ * TLS destructor, marks the buffer of a terminating thread as orphaned so
+ * the flusher can free it once drained.
+ */
+static DECLCALLBACK(void) rtlogDeferredTlsDtor(void *pvValue)
+{
+    PRTLOGDEFERREDBUF pBuf = (PRTLOGDEFERREDBUF)pvValue;
+    if (pBuf)
+        ASMAtomicWriteBool(&pBuf->fOrphaned, true);
+}
+
+
+/**
+ * The flusher thread.
+ */
+static DECLCALLBACK(int) rtlogDeferredFlusherThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    PRTLOGDEFERRED pDeferred = (PRTLOGDEFERRED)pvUser;
+    PRTLOGGER      pLogger   = pDeferred->pLogger;
+    RT_NOREF_PV(hThreadSelf);
+
+    ASMAtomicWriteHandle(&pDeferred->hNativeFlusher, RTThreadNativeSelf());
+    while (!ASMAtomicReadBool(&pDeferred->fTerminate))
+    {
+        RTSemEventWait(pDeferred->hEvt, RTLOG_DEFERRED_FLUSH_INTERVAL_MS);
+        if (RT_SUCCESS(rtlogLock(pLogger)))
+        {
+            rtlogDeferredDrainLocked(pLogger, pDeferred);
+            rtlogUnlock(pLogger);
+        }
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Lazily sets up deferred logging for a logger.
+ *
+ * @returns Pointer to the deferred logging state, NULL if not (yet) available.
+ * @param   pLogger     The logger instance.
+ */
+static PRTLOGDEFERRED rtlogDeferredInit(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    if (!ASMAtomicCmpXchgU32(&pInt->uDeferredInitState, RTLOGDEFERRED_INIT_BUSY, RTLOGDEFERRED_INIT_NONE))
+        return ASMAtomicUoReadU32(&pInt->uDeferredInitState) == RTLOGDEFERRED_INIT_DONE ? pInt->pDeferred : NULL;
+
+    /*
+     * We're the one doing it.  Anything logged while we're busy here (thread
+     * creation for instance) will take the normal path.
+     */
+    int            rc        = VERR_NO_MEMORY;
+    PRTLOGDEFERRED pDeferred = (PRTLOGDEFERRED)RTMemAllocZ(sizeof(*pDeferred));
+    if (pDeferred)
+    {
+        pDeferred->pLogger        = pLogger;
+        pDeferred->hThread        = NIL_RTTHREAD;
+        pDeferred->hNativeFlusher = NIL_RTNATIVETHREAD;
+        rc = RTTlsAllocEx(&pDeferred->iTls, rtlogDeferredTlsDtor);
+        if (rc == VERR_NOT_SUPPORTED)
+        {
+            /* Buffers of dead threads are then only freed with the logger. */
+            pDeferred->iTls = RTTlsAlloc();
+            rc = pDeferred->iTls != NIL_RTTLS ? VINF_SUCCESS : VERR_NO_MEMORY;
+        }
+        if (RT_SUCCESS(rc))
+        {
+            rc = RTSemEventCreate(&pDeferred->hEvt);
+            if (RT_SUCCESS(rc))
+            {
+                rc = RTThreadCreate(&pDeferred->hThread, rtlogDeferredFlusherThread, pDeferred, 0 /*cbStack*/,
+                                    RTTHREADTYPE_IO, RTTHREADFLAGS_WAITABLE, "LogFlusher");
+                if (RT_SUCCESS(rc))
+                {
+                    ASMAtomicWritePtr(&pInt->pDeferred, pDeferred);
+                    ASMAtomicWriteU32(&pInt->uDeferredInitState, RTLOGDEFERRED_INIT_DONE);
+                    return pDeferred;
+                }
+                RTSemEventDestroy(pDeferred->hEvt);
+            }
+            RTTlsFree(pDeferred->iTls);
+        }
+        RTMemFree(pDeferred);
+    }
+
+    /* Don't retry, the normal logging path still works. */
+    ASMAtomicWriteU32(&pInt->uDeferredInitState, RTLOGDEFERRED_INIT_FAILED);
+    return NULL;
+}
+
+
+/**
+ * Creates the deferred logging buffer for the calling thread.
+ *
+ * @returns Pointer to the buffer, NULL on failure.
+ * @param   pLogger     The logger instance.
+ * @param   pDeferred   The deferred logging state.
+ */
+static PRTLOGDEFERREDBUF rtlogDeferredBufCreate(PRTLOGGER pLogger, PRTLOGDEFERRED pDeferred)
+{
+    uint32_t const    cbBuf = pLogger->pInt->cbDeferredBuf;
+    PRTLOGDEFERREDBUF pBuf  = (PRTLOGDEFERREDBUF)RTMemAllocZ(RT_ALIGN_Z(sizeof(*pBuf), 8) + cbBuf);
+    if (!pBuf)
+        return NULL;
+    pBuf->cbBuf         = cbBuf;
+    pBuf->pbBuf         = (uint8_t *)pBuf + RT_ALIGN_Z(sizeof(*pBuf), 8);
+    pBuf->hNativeThread = RTThreadNativeSelf();
+    const char *pszName = RTThreadSelfName();
+    if (pszName)
+        RTStrCopy(pBuf->szThreadName, sizeof(pBuf->szThreadName), pszName);
+
+    int rc = RTTlsSet(pDeferred->iTls, pBuf);
+    if (RT_FAILURE(rc))
+    {
+        RTMemFree(pBuf);
+        return NULL;
+    }
+
+    /* Push it onto the list.  Only the consumer ever unlinks. */
+    PRTLOGDEFERREDBUF pHead;
+    do
+    {
+        pHead = ASMAtomicReadPtrT(&pDeferred->pHead, PRTLOGDEFERREDBUF);
+        pBuf->pNext = pHead;
+    } while (!ASMAtomicCmpXchgPtr(&pDeferred->pHead, pBuf, pHead));
+    return pBuf;
+}
+
+
+/**
+ * Kicks the flusher thread, once per buffer until it has drained it.
+ */
+DECLINLINE(void) rtlogDeferredSignal(PRTLOGDEFERRED pDeferred, PRTLOGDEFERREDBUF pBuf)
+{
+    if (!ASMAtomicXchgBool(&pBuf->fSignalled, true))
+        RTSemEventSignal(pDeferred->hEvt);
+}
+
+
+/**
+ * Worker for rtlogDeferredWrite.
+ *
+ * @returns See rtlogDeferredWrite.
+ * @param   pLogger     The logger instance.
+ * @param   pDeferred   The deferred logging state.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   pszFormat   The format string.
+ * @param   args        The format arguments.
+ */
+static bool rtlogDeferredWriteWorker(PRTLOGGER pLogger, PRTLOGDEFERRED pDeferred, unsigned fFlags, unsigned iGroup,
+                                     const char *pszFormat, va_list args)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    PRTLOGDEFERREDBUF pBuf = (PRTLOGDEFERREDBUF)RTTlsGet(pDeferred->iTls);
+    if (RT_UNLIKELY(!pBuf))
+    {
+        pBuf = rtlogDeferredBufCreate(pLogger, pDeferred);
+        if (!pBuf)
+            return false;
+    }
+
+    /*
+     * Size the record, checking that every argument can be captured by value.
+     */
+    size_t const cchFormat = strlen(pszFormat);
+    size_t       cbRec     = sizeof(RTLOGDEFERREDREC) + RT_ALIGN_Z(cchFormat + 1, 8);
+    va_list      va;
+    va_copy(va, args);
+    for (const char *psz = strchr(pszFormat, '%'); psz; psz = strchr(psz, '%'))
+    {
+        RTLOGDEFERREDSPEC Spec;
+        rtlogDeferredParseSpec(psz + 1, &Spec);
+        psz = Spec.pszEnd;
+        if (Spec.uKind == RTLOGDEFERRED_ARG_NONE)
+            continue;
+        if (Spec.uKind == RTLOGDEFERRED_ARG_INVALID)
+        {
+            va_end(va);
+            return false;
+        }
+        if (Spec.fWidthArg)
+        {
+            va_arg(va, int);
+            cbRec += sizeof(uint64_t);
+        }
+        int cchPrecision = Spec.cchPrecision;
+        if (Spec.fPrecisionArg)
+        {
+            cchPrecision = va_arg(va, int);
+            cbRec += sizeof(uint64_t);
+        }
+        cbRec += sizeof(uint64_t);
+        switch (Spec.uKind)
+        {
+            case RTLOGDEFERRED_ARG_U32: va_arg(va, uint32_t); break;
+            case RTLOGDEFERRED_ARG_U64: va_arg(va, uint64_t); break;
+            case RTLOGDEFERRED_ARG_PTR: va_arg(va, void *); break;
+            case RTLOGDEFERRED_ARG_STR:
+            {
+                const char *pszArg = va_arg(va, const char *);
+                if (pszArg)
+                    cbRec += RT_ALIGN_Z((cchPrecision >= 0 ? RTStrNLen(pszArg, cchPrecision) : strlen(pszArg)) + 1, 8);
+                break;
+            }
+        }
+    }
+    va_end(va);
+    if (cbRec > pBuf->cbBuf / 4)
+        return false; /* Big dumps are better off done synchronously. */
+
+    /*
+     * Reserve space, padding to the end of the buffer if the record doesn't fit
+     * in one piece.
+     */
+    uint64_t const offWrite = pBuf->offWrite;
+    uint32_t const offPos   = (uint32_t)offWrite & (pBuf->cbBuf - 1);
+    uint32_t const cbPad    = pBuf->cbBuf - offPos < cbRec ? pBuf->cbBuf - offPos : 0;
+    for (;;)
+    {
+        uint64_t const offRead = ASMAtomicReadU64(&pBuf->offRead);
+        if (offWrite + cbPad + cbRec - offRead <= pBuf->cbBuf)
+            break;
+        rtlogDeferredSignal(pDeferred, pBuf);
+        RTNATIVETHREAD hNativeFlusher;
+        ASMAtomicReadHandle(&pDeferred->hNativeFlusher, &hNativeFlusher);
+        if (   pInt->enmDeferredOverflow != RTLOGDEFERREDOVERFLOW_WAIT
+            || pBuf->hNativeThread == hNativeFlusher
+            || ASMAtomicReadBool(&pDeferred->fTerminate))
+        {
+            ASMAtomicIncU32(&pBuf->cDropped);
+            return true;
+        }
+        RTThreadSleep(1);
+    }
+    if (cbPad)
+    {
+        PRTLOGDEFERREDREC pWrap = (PRTLOGDEFERREDREC)&pBuf->pbBuf[offPos];
+        pWrap->cbRec = cbPad;
+        pWrap->uType = RTLOGDEFERREDREC_TYPE_WRAP;
+    }
+
+    /*
+     * Fill in the record.
+     */
+    PRTLOGDEFERREDREC pRec = (PRTLOGDEFERREDREC)&pBuf->pbBuf[(offPos + cbPad) & (pBuf->cbBuf - 1)];
+    pRec->cbRec     = (uint32_t)cbRec;
+    pRec->uType     = RTLOGDEFERREDREC_TYPE_MSG;
+    pRec->fFlags    = fFlags;
+    pRec->iGroup    = iGroup;
+#if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
+    pRec->uTsc      = ASMReadTSC();
+    pRec->idCpu     = pLogger->fFlags & RTLOGFLAGS_PREFIX_CPUID ? ASMGetApicId() : 0;
+#else
+    pRec->uTsc      = RTTimeNanoTS();
+    pRec->idCpu     = pLogger->fFlags & RTLOGFLAGS_PREFIX_CPUID ? RTMpCpuId() : 0;
+#endif
+    pRec->nsTs      = RTTimeNanoTS();
+    pRec->cchFormat = (uint32_t)cchFormat;
+
+    char *pszDst = (char *)(pRec + 1);
+    memcpy(pszDst, pszFormat, cchFormat + 1);
+    uint64_t *pu64Arg = (uint64_t *)(pszDst + RT_ALIGN_Z(cchFormat + 1, 8));
+    for (const char *psz = strchr(pszFormat, '%'); psz; psz = strchr(psz, '%'))
+    {
+        RTLOGDEFERREDSPEC Spec;
+        rtlogDeferredParseSpec(psz + 1, &Spec);
+        psz = Spec.pszEnd;
+        if (Spec.uKind == RTLOGDEFERRED_ARG_NONE)
+            continue;
+        if (Spec.fWidthArg)
+            *pu64Arg++ = (int64_t)va_arg(args, int);
+        int cchPrecision = Spec.cchPrecision;
+        if (Spec.fPrecisionArg)
+        {
+            cchPrecision = va_arg(args, int);
+            *pu64Arg++ = (int64_t)cchPrecision;
+        }
+        switch (Spec.uKind)
+        {
+            case RTLOGDEFERRED_ARG_U32: *pu64Arg++ = va_arg(args, uint32_t); break;
+            case RTLOGDEFERRED_ARG_U64: *pu64Arg++ = va_arg(args, uint64_t); break;
+            case RTLOGDEFERRED_ARG_PTR: *pu64Arg++ = (uintptr_t)va_arg(args, void *); break;
+            case RTLOGDEFERRED_ARG_STR:
+            {
+                const char *pszArg = va_arg(args, const char *);
+                if (pszArg)
+                {
+                    size_t const cchArg = cchPrecision >= 0 ? RTStrNLen(pszArg, cchPrecision) : strlen(pszArg);
+                    *pu64Arg++ = cchArg;
+                    memcpy(pu64Arg, pszArg, cchArg);
+                    ((char *)pu64Arg)[cchArg] = '\0';
+                    pu64Arg += RT_ALIGN_Z(cchArg + 1, 8) / sizeof(uint64_t);
+                }
+                else
+                    *pu64Arg++ = UINT64_MAX;
+                break;
+            }
+        }
+    }
+    Assert((uintptr_t)pu64Arg - (uintptr_t)pRec == cbRec);
+
+    /*
+     * Publish it and wake up the flusher if the buffer is getting full.
+     */
+    ASMAtomicWriteU64(&pBuf->offWrite, offWrite + cbPad + cbRec);
+    if (offWrite + cbPad + cbRec - ASMAtomicUoReadU64(&pBuf->offRead) > pBuf->cbBuf / 2)
+        rtlogDeferredSignal(pDeferred, pBuf);
+    return true;
+}
+
+
+/**
+ * Captures a log message into the per-thread buffer of the calling thread.
+ *
+ * The writer count keeps rtlogDeferredTerm from freeing the state while we
+ * are using it.
+ *
+ * @returns true if the message was dealt with (queued or dropped), false if
+ *          the caller should log it synchronously.
+ * @param   pLogger     The logger instance.
+ * @param   fFlags      The logging flags.
+ * @param   iGroup      The group.
+ * @param   pszFormat   The format string.
+ * @param   args        The format arguments.  Only consumed if true is
+ *                      returned.
+ */
+static bool rtlogDeferredWrite(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup, const char *pszFormat, va_list args)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+    ASMAtomicIncU32(&pInt->cDeferredWriters);
+
+    bool           fRc       = false;
+    PRTLOGDEFERRED pDeferred = ASMAtomicReadPtrT(&pInt->pDeferred, PRTLOGDEFERRED);
+    if (RT_UNLIKELY(!pDeferred))
+        pDeferred = rtlogDeferredInit(pLogger);
+    if (pDeferred)
+        fRc = rtlogDeferredWriteWorker(pLogger, pDeferred, fFlags, iGroup, pszFormat, args);
+
+    ASMAtomicDecU32(&pInt->cDeferredWriters);
+    return fRc;
+}
+
+
+/**
+ * Helper for formatting a single rebuilt format specifier.
+ */
+static void rtlogDeferredFormatOne(PFNRTSTROUTPUT pfnOutput, void *pvOutput, const char *pszSpec, ...)
+{
+    va_list va;
+    va_start(va, pszSpec);
+    RTLogFormatV(pfnOutput, pvOutput, pszSpec, va);
+    va_end(va);
+}
+
+
+/**
+ * Formats a deferred log record into the scratch buffer.
+ *
+ * @param   pLogger     The logger instance, locked.
+ * @param   pBuf        The buffer the record lives in.
+ * @param   pRec        The record.
+ */
+static void rtlogDeferredFormatLocked(PRTLOGGER pLogger, PRTLOGDEFERREDBUF pBuf, PRTLOGDEFERREDREC pRec)
+{
+    RTLOGDEFERREDCTX Ctx;
+    Ctx.nsTs          = pRec->nsTs;
+    Ctx.uTsc          = pRec->uTsc;
+    Ctx.hNativeThread = pBuf->hNativeThread;
+    Ctx.pszThreadName = pBuf->szThreadName;
+    Ctx.idCpu         = pRec->idCpu;
+
+    RTLOGOUTPUTPREFIXEDARGS OutputArgs;
+    OutputArgs.pLogger      = pLogger;
+    OutputArgs.iGroup       = pRec->iGroup;
+    OutputArgs.fFlags       = pRec->fFlags;
+    OutputArgs.pDeferredCtx = &Ctx;
+
+    PFNRTSTROUTPUT pfnOutput = rtLogOutput;
+    void          *pvOutput  = pLogger;
+    if (pLogger->fFlags & (RTLOGFLAGS_PREFIX_MASK | RTLOGFLAGS_USECRLF))
+    {
+        pfnOutput = rtLogOutputPrefixed;
+        pvOutput  = &OutputArgs;
+    }
+
+    const char     *pszFormat = (const char *)(pRec + 1);
+    uint64_t const *pu64Arg   = (uint64_t const *)(pszFormat + RT_ALIGN_Z(pRec->cchFormat + 1, 8));
+    const char     *pszLiteral = pszFormat;
+    for (const char *psz = strchr(pszFormat, '%'); psz; psz = strchr(pszLiteral, '%'))
+    {
+        if (psz != pszLiteral)
+            pfnOutput(pvOutput, pszLiteral, psz - pszLiteral);
+
+        RTLOGDEFERREDSPEC Spec;
+        rtlogDeferredParseSpec(psz + 1, &Spec);
+        pszLiteral = Spec.pszEnd;
+        if (Spec.uKind == RTLOGDEFERRED_ARG_NONE)
+        {
+            pfnOutput(pvOutput, "%", 1);
+            continue;
+        }
+
+        /* Rebuild the specifier with the '*' arguments filled in. */
+        char   szSpec[64];
+        size_t offSpec = 0;
+        for (const char *pszSrc = psz; pszSrc < Spec.pszEnd && offSpec < sizeof(szSpec) - 16; pszSrc++)
+            if (*pszSrc != '*')
+                szSpec[offSpec++] = *pszSrc;
+            else
+            {
+                int64_t iValue = (int64_t)*pu64Arg++;
+                if (pszSrc[-1] == '.' && iValue < 0)
+                    offSpec--; /* A negative precision is taken as if it was omitted. */
+                else
+                    offSpec += RTStrFormatNumber(&szSpec[offSpec], iValue, 10, 0, 0, RTSTR_F_VALSIGNED);
+            }
+        szSpec[offSpec] = '\0';
+
+        switch (Spec.uKind)
+        {
+            case RTLOGDEFERRED_ARG_U32:
+                rtlogDeferredFormatOne(pfnOutput, pvOutput, szSpec, (uint32_t)*pu64Arg++);
+                break;
+            case RTLOGDEFERRED_ARG_U64:
+                rtlogDeferredFormatOne(pfnOutput, pvOutput, szSpec, *pu64Arg++);
+                break;
+            case RTLOGDEFERRED_ARG_PTR:
+                rtlogDeferredFormatOne(pfnOutput, pvOutput, szSpec, (void *)(uintptr_t)*pu64Arg++);
+                break;
+            case RTLOGDEFERRED_ARG_STR:
+            {
+                uint64_t const cchArg = *pu64Arg++;
+                if (cchArg != UINT64_MAX)
+                {
+                    rtlogDeferredFormatOne(pfnOutput, pvOutput, szSpec, (const char *)pu64Arg);
+                    pu64Arg += RT_ALIGN_Z(cchArg + 1, 8) / sizeof(uint64_t);
+                }
+                else
+                    rtlogDeferredFormatOne(pfnOutput, pvOutput, szSpec, (const char *)NULL);
+                break;
+            }
+        }
+    }
+    if (*pszLiteral)
+        pfnOutput(pvOutput, pszLiteral, strlen(pszLiteral));
+}
+
+
+/**
+ * Drains the deferred log buffers, formatting the records in timestamp order.
+ *
+ * Only records present when we start are processed, so a busy producer
+ * cannot keep us here forever.
+ *
+ * @param   pLogger     The logger instance, locked.
+ * @param   pDeferred   The deferred logging state, NULL if not active.
+ */
+static void rtlogDeferredDrainLocked(PRTLOGGER pLogger, PRTLOGDEFERRED pDeferred)
+{
+    if (!pDeferred)
+        return;
+
+    PRTLOGDEFERREDBUF pBuf;
+    for (pBuf = ASMAtomicReadPtrT(&pDeferred->pHead, PRTLOGDEFERREDBUF); pBuf; pBuf = pBuf->pNext)
+    {
+        ASMAtomicWriteBool(&pBuf->fSignalled, false);
+        pBuf->offDrainEnd = ASMAtomicReadU64(&pBuf->offWrite);
+    }
+
+    /*
+     * Merge: repeatedly pick the buffer with the oldest pending record.
+     */
+    for (;;)
+    {
+        PRTLOGDEFERREDBUF pOldest    = NULL;
+        PRTLOGDEFERREDREC pOldestRec = NULL;
+        for (pBuf = ASMAtomicReadPtrT(&pDeferred->pHead, PRTLOGDEFERREDBUF); pBuf; pBuf = pBuf->pNext)
+        {
+            while (pBuf->offRead < pBuf->offDrainEnd)
+            {
+                PRTLOGDEFERREDREC pRec = (PRTLOGDEFERREDREC)&pBuf->pbBuf[(uint32_t)pBuf->offRead & (pBuf->cbBuf - 1)];
+                if (pRec->uType == RTLOGDEFERREDREC_TYPE_MSG)
+                {
+                    if (!pOldestRec || (int64_t)(pRec->uTsc - pOldestRec->uTsc) < 0)
+                    {
+                        pOldest    = pBuf;
+                        pOldestRec = pRec;
+                    }
+                    break;
+                }
+                Assert(pRec->uType == RTLOGDEFERREDREC_TYPE_WRAP);
+                ASMAtomicWriteU64(&pBuf->offRead, pBuf->offRead + pRec->cbRec);
+            }
+        }
+        if (!pOldest)
+            break;
+
+        rtlogDeferredFormatLocked(pLogger, pOldest, pOldestRec);
+        ASMAtomicWriteU64(&pOldest->offRead, pOldest->offRead + pOldestRec->cbRec);
+    }
+
+    /*
+     * Report drops and get rid of the buffers of dead threads.
+     */
+    PRTLOGDEFERREDBUF pPrev = NULL;
+    pBuf = ASMAtomicReadPtrT(&pDeferred->pHead, PRTLOGDEFERREDBUF);
+    while (pBuf)
+    {
+        PRTLOGDEFERREDBUF const pNext    = pBuf->pNext;
+        uint32_t const          cDropped = ASMAtomicXchgU32(&pBuf->cDropped, 0);
+        if (cDropped)
+            rtlogLoggerExFLocked(pLogger, 0, ~0U, "Logger: dropped %u messages from thread '%s' (%RTnthrd), deferred buffer full\n",
+                                 cDropped, pBuf->szThreadName, pBuf->hNativeThread);
+
+        if (   ASMAtomicReadBool(&pBuf->fOrphaned)
+            && pBuf->offRead == ASMAtomicReadU64(&pBuf->offWrite))
+        {
+            /* Unlink it.  New buffers are only ever pushed at the head. */
+            if (pPrev)
+                pPrev->pNext = pNext;
+            else if (!ASMAtomicCmpXchgPtr(&pDeferred->pHead, pNext, pBuf))
+            {
+                pPrev = ASMAtomicReadPtrT(&pDeferred->pHead, PRTLOGDEFERREDBUF);
+                while (pPrev->pNext != pBuf)
+                    pPrev = pPrev->pNext;
+                pPrev->pNext = pNext;
+            }
+            RTMemFree(pBuf);
+        }
+        else
+            pPrev = pBuf;
+        pBuf = pNext;
+    }
+
+    if (    !(pLogger->fFlags & RTLOGFLAGS_BUFFERED)
+        &&  pLogger->offScratch)
+        rtlogFlush(pLogger);
+}
+
+
+/**
+ * Stops the flusher thread and frees all deferred logging resources.
+ *
+ * @param   pLogger     The logger instance, NOT locked.
+ */
+static void rtlogDeferredTerm(PRTLOGGER pLogger)
+{
+    PRTLOGGERINTERNAL pInt = pLogger->pInt;
+
+    /*
+     * Prevent (re-)initialization and detach the state so new messages take
+     * the synchronous path, then wait for the writers still using it.  The
+     * flusher keeps running meanwhile so writers waiting for room get it.
+     */
+    for (;;)
+    {
+        uint32_t const uState = ASMAtomicReadU32(&pInt->uDeferredInitState);
+        if (uState == RTLOGDEFERRED_INIT_BUSY)
+            RTThreadSleep(1);
+        else if (ASMAtomicCmpXchgU32(&pInt->uDeferredInitState, RTLOGDEFERRED_INIT_FAILED, uState))
+            break;
+    }
+    PRTLOGDEFERRED pDeferred = ASMAtomicXchgPtrT(&pInt->pDeferred, NULL, PRTLOGDEFERRED);
+    if (!pDeferred)
+        return;
+    while (ASMAtomicReadU32(&pInt->cDeferredWriters) != 0)
+        RTThreadSleep(1);
+
+    ASMAtomicWriteBool(&pDeferred->fTerminate, true);
+    RTSemEventSignal(pDeferred->hEvt);
+    int rc = RTThreadWait(pDeferred->hThread, RT_INDEFINITE_WAIT, NULL);
+    AssertRC(rc);
+
+    if (RT_SUCCESS(rtlogLock(pLogger)))
+    {
+        rtlogDeferredDrainLocked(pLogger, pDeferred);
+        rtlogUnlock(pLogger);
+    }
+
+    PRTLOGDEFERREDBUF pBuf = pDeferred->pHead;
+    while (pBuf)
+    {
+        PRTLOGDEFERREDBUF pNext = pBuf->pNext;
+        RTMemFree(pBuf);
+        pBuf = pNext;
+    }
+    RTTlsFree(pDeferred->iTls);
+    RTSemEventDestroy(pDeferred->hEvt);
+    RTMemFree(pDeferred);
+}
+
+
+RTDECL(int) RTLogSetDeferred(PRTLOGGER pLogger, bool fEnable, uint32_t cbPerThread, RTLOGDEFERREDOVERFLOW enmOverflow)
+{
+    /*
+     * Resolve defaults and validate input.
+     */
+    if (!pLogger)
+    {
+        pLogger = RTLogDefaultInstance();
+        if (!pLogger)
+            return VINF_SUCCESS;
+    }
+    AssertReturn(enmOverflow > RTLOGDEFERREDOVERFLOW_INVALID && enmOverflow < RTLOGDEFERREDOVERFLOW_END,
+                 VERR_INVALID_PARAMETER);
+    if (!cbPerThread)
+        cbPerThread = RTLOG_DEFERRED_BUF_DEFAULT_SIZE;
+    AssertReturn(cbPerThread <= RTLOG_DEFERRED_BUF_MAX_SIZE, VERR_OUT_OF_RANGE);
+    cbPerThread = RT_MAX(cbPerThread, RTLOG_DEFERRED_BUF_MIN_SIZE);
+    if (!RT_IS_POWER_OF_TWO(cbPerThread))
+        cbPerThread = RT_BIT_32(ASMBitLastSetU32(cbPerThread));
+
+    int rc = rtlogLock(pLogger);
+    if (RT_SUCCESS(rc))
+    {
+        /* The size only applies to buffers created from now on. */
+        pLogger->pInt->cbDeferredBuf       = cbPerThread;
+        pLogger->pInt->enmDeferredOverflow = enmOverflow;
+        if (fEnable)
+            pLogger->fFlags |= RTLOGFLAGS_DEFERRED;
+        else
+        {
+            pLogger->fFlags &= ~RTLOGFLAGS_DEFERRED;
+            rtlogDeferredDrainLocked(pLogger, pLogger->pInt->pDeferred);
+        }
+        rtlogUnlock(pLogger);
+    }
+    return rc;
+}
+RT_EXPORT_SYMBOL(RTLogSetDeferred);
+
+# endif /* IN_RING3 */
 
 
 RTDECL(int) RTLogCreateExV(PRTLOGGER *ppLogger, uint32_t fFlags, const char *pszGroupSettings,
@@ -852,6 +1894,10 @@ RTDECL(int) RTLogCreateExV(PRTLOGGER *ppLogger, uint32_t fFlags, const char *psz
             pLogger->pInt->cSecsHistoryTimeSlot = UINT32_MAX;
         else
             pLogger->pInt->cSecsHistoryTimeSlot = cSecsHistoryTimeSlot;
+        pLogger->pInt->pDeferred                = NULL;
+        pLogger->pInt->uDeferredInitState       = RTLOGDEFERRED_INIT_NONE;
+        pLogger->pInt->cbDeferredBuf            = RTLOG_DEFERRED_BUF_DEFAULT_SIZE;
+        pLogger->pInt->enmDeferredOverflow      = RTLOGDEFERREDOVERFLOW_DROP;
 # else   /* !IN_RING3 */
         RT_NOREF_PV(pfnPhase); RT_NOREF_PV(cHistory); RT_NOREF_PV(cbHistoryFileMax); RT_NOREF_PV(cSecsHistoryTimeSlot);
 # endif  /* !IN_RING3 */
@@ -1086,6 +2132,13 @@ RTDECL(int) RTLogDestroy(PRTLOGGER pLogger)
     AssertReturn(pLogger->u32Magic == RTLOGGER_MAGIC, VERR_INVALID_MAGIC);
     AssertPtrReturn(pLogger->pInt, VERR_INVALID_POINTER);
 
+# ifdef IN_RING3
+    /*
+     * Stop the deferred logging flusher thread and write out what's pending.
+     */
+    rtlogDeferredTerm(pLogger);
+# endif
+
     /*
      * Acquire logger instance sem and disable all logging. (paranoia)
      */
@@ -2584,6 +3637,9 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
     if (   pLogger->offScratch
 #ifndef IN_RC
         || (pLogger->fDestFlags & RTLOGDEST_RINGBUF)
+#endif
+#ifdef IN_RING3
+        || pLogger->pInt->pDeferred
 #endif
        )
     {
@@ -2594,6 +3650,9 @@ RTDECL(void) RTLogFlush(PRTLOGGER pLogger)
         int rc = rtlogLock(pLogger);
         if (RT_FAILURE(rc))
             return;
+#endif
+#ifdef IN_RING3
+        rtlogDeferredDrainLocked(pLogger, pLogger->pInt->pDeferred);
 #endif
         /*
          * Call worker.
@@ -2900,6 +3959,16 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         &&  (pLogger->afGroups[iGroup] & (fFlags | RTLOGGRPFLAGS_ENABLED)) != (fFlags | RTLOGGRPFLAGS_ENABLED))
         return;
 
+#ifdef IN_RING3
+    /*
+     * In deferred mode we just capture the arguments into the per-thread
+     * buffer and leave the formatting to the flusher thread.
+     */
+    if (   (pLogger->fFlags & (RTLOGFLAGS_DEFERRED | RTLOGFLAGS_RESTRICT_GROUPS)) == RTLOGFLAGS_DEFERRED
+        && rtlogDeferredWrite(pLogger, fFlags, iGroup, pszFormat, args))
+        return;
+#endif
+
     /*
      * Acquire logger instance sem.
      */
@@ -2913,6 +3982,12 @@ RTDECL(void) RTLogLoggerExV(PRTLOGGER pLogger, unsigned fFlags, unsigned iGroup,
         return;
     }
 
+#ifdef IN_RING3
+    /* Keep the output ordered when a message couldn't be deferred. */
+    if (pLogger->pInt->pDeferred)
+        rtlogDeferredDrainLocked(pLogger, pLogger->pInt->pDeferred);
+#endif
+
     /*
      * Check restrictions and call worker.
      */
@@ -3551,9 +4626,17 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                  * psz is pointing to the current position.
                  */
                 psz = &pLogger->achScratch[pLogger->offScratch];
+#ifdef IN_RING3
+                /* Deferred records carry the values captured when the message was logged. */
+                PCRTLOGDEFERREDCTX const pCtx = pArgs->pDeferredCtx;
+#endif
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TS)
                 {
+#ifdef IN_RING3
+                    uint64_t     u64    = pCtx ? pCtx->nsTs : RTTimeNanoTS();
+#else
                     uint64_t     u64    = RTTimeNanoTS();
+#endif
                     int          iBase  = 16;
                     unsigned int fFlags = RTSTR_F_ZEROPAD;
                     if (pLogger->fFlags & RTLOGFLAGS_DECIMAL_TS)
@@ -3583,6 +4666,10 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                     uint64_t     u64    = ASMReadTSC();
 #else
                     uint64_t     u64    = RTTimeNanoTS();
+#endif
+#ifdef IN_RING3
+                    if (pCtx)
+                        u64 = pCtx->uTsc;
 #endif
                     int          iBase  = 16;
                     unsigned int fFlags = RTSTR_F_ZEROPAD;
@@ -3609,7 +4696,9 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
 
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_MS_PROG)
                 {
-#if defined(IN_RING3) || defined(IN_RC)
+#if defined(IN_RING3)
+                    uint64_t u64 = pCtx ? (pCtx->nsTs - RTTimeProgramStartNanoTS()) / RT_NS_1MS : RTTimeProgramMilliTS();
+#elif defined(IN_RC)
                     uint64_t u64 = RTTimeProgramMilliTS();
 #else
                     uint64_t u64 = 0;
@@ -3625,7 +4714,12 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
 #if defined(IN_RING3) || defined(IN_RING0)
                     RTTIMESPEC TimeSpec;
                     RTTIME Time;
-                    RTTimeExplode(&Time, RTTimeNow(&TimeSpec));
+                    RTTimeNow(&TimeSpec);
+# ifdef IN_RING3
+                    if (pCtx)
+                        RTTimeSpecSubNano(&TimeSpec, RTTimeNanoTS() - pCtx->nsTs);
+# endif
+                    RTTimeExplode(&Time, &TimeSpec);
                     psz += RTStrFormatNumber(psz, Time.u8Hour, 10, 2, 0, RTSTR_F_ZEROPAD);
                     *psz++ = ':';
                     psz += RTStrFormatNumber(psz, Time.u8Minute, 10, 2, 0, RTSTR_F_ZEROPAD);
@@ -3645,7 +4739,11 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 {
 
 #if defined(IN_RING3) || defined(IN_RC)
+# ifdef IN_RING3
+                    uint64_t u64 = pCtx ? (pCtx->nsTs - RTTimeProgramStartNanoTS()) / RT_NS_1US : RTTimeProgramMicroTS();
+# else
                     uint64_t u64 = RTTimeProgramMicroTS();
+# endif
                     psz += RTStrFormatNumber(psz, (uint32_t)(u64 / RT_US_1HOUR), 10, 2, 0, RTSTR_F_ZEROPAD);
                     *psz++ = ':';
                     uint32_t u32 = (uint32_t)(u64 % RT_US_1HOUR);
@@ -3694,7 +4792,9 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
 
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_TID)
                 {
-#ifndef IN_RC
+#ifdef IN_RING3
+                    RTNATIVETHREAD Thread = pCtx ? pCtx->hNativeThread : RTThreadNativeSelf();
+#elif !defined(IN_RC)
                     RTNATIVETHREAD Thread = RTThreadNativeSelf();
 #else
                     RTNATIVETHREAD Thread = NIL_RTNATIVETHREAD;
@@ -3707,7 +4807,7 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_THREAD)
                 {
 #ifdef IN_RING3
-                    const char *pszName = RTThreadSelfName();
+                    const char *pszName = pCtx ? pCtx->pszThreadName : RTThreadSelfName();
 #elif defined IN_RC
                     const char *pszName = "EMT-RC";
 #else
@@ -3720,9 +4820,13 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_CPUID)
                 {
 #if defined(RT_ARCH_AMD64) || defined(RT_ARCH_X86)
-                    const uint8_t idCpu = ASMGetApicId();
+                    uint8_t idCpu = ASMGetApicId();
 #else
-                    const RTCPUID idCpu = RTMpCpuId();
+                    RTCPUID idCpu = RTMpCpuId();
+#endif
+#ifdef IN_RING3
+                    if (pCtx)
+                        idCpu = (uint8_t)pCtx->idCpu;
 #endif
                     psz += RTStrFormatNumber(psz, idCpu, 16, sizeof(idCpu) * 2, 0, RTSTR_F_ZEROPAD);
                     *psz++ = ' ';
@@ -3742,7 +4846,7 @@ static DECLCALLBACK(size_t) rtLogOutputPrefixed(void *pv, const char *pachChars,
                 if (pLogger->fFlags & RTLOGFLAGS_PREFIX_LOCK_COUNTS)
                 {
 #ifdef IN_RING3 /** @todo implement these counters in ring-0 too? */
-                    RTTHREAD Thread = RTThreadSelf();
+                    RTTHREAD Thread = !pCtx ? RTThreadSelf() : NIL_RTTHREAD;
                     if (Thread != NIL_RTTHREAD)
                     {
                         uint32_t cReadLocks  = RTLockValidatorReadLockGetCount(Thread);
@@ -3935,6 +5039,9 @@ static void rtlogLoggerExVLocked(PRTLOGGER pLogger, unsigned fFlags, unsigned iG
         OutputArgs.pLogger = pLogger;
         OutputArgs.iGroup  = iGroup;
         OutputArgs.fFlags  = fFlags;
+#ifdef IN_RING3
+        OutputArgs.pDeferredCtx = NULL;
+#endif
         RTLogFormatV(rtLogOutputPrefixed, &OutputArgs, pszFormat, args);
     }
     else
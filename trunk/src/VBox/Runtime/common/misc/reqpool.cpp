@@ -33,10 +33,12 @@
 
 #include <iprt/assert.h>
 #include <iprt/asm.h>
+#include <iprt/cpuset.h>
 #include <iprt/critsect.h>
 #include <iprt/list.h>
 #include <iprt/log.h>
 #include <iprt/mem.h>
+#include <iprt/mp.h>
 #include <iprt/string.h>
 #include <iprt/time.h>
 #include <iprt/semaphore.h>
@@ -55,6 +57,9 @@
 #define RTREQPOOL_PUSH_BACK_MAX_MS      RT_MS_1MIN
 /** The max number of free requests to keep around. */
 #define RTREQPOOL_MAX_FREE_REQUESTS     (RTREQPOOL_MAX_THREADS * 2U)
+/** The size of the per worker request deque in work stealing mode.
+ * Must be a power of two. */
+#define RTREQPOOL_WS_DEQUE_SIZE         256
 
 
 /*********************************************************************************************************************************
@@ -96,6 +101,26 @@ typedef struct RTREQPOOLTHREAD
     /** Pointer to the request thread pool instance the thread is associated
      *  with. */
     struct RTREQPOOLINT    *pPool;
+    /** The worker index.  This is the RTREQPOOLINT::papWsThreads index in work
+     * stealing mode, and the creation sequence number otherwise.  Used for
+     * picking a CPU when RTREQPOOLINT::fCpuAffinity is set. */
+    uint32_t                idxWorker;
+
+    /** @name Work stealing mode.
+     * @{ */
+    /** Set while the thread is idle or about to go idle.  Cleared by whoever
+     * wakes it up (or the thread itself). */
+    bool volatile           fWsIdle;
+    /** Incoming requests, newest first, linked by RTREQINT::pNext.  Anyone can
+     * push requests onto this and any worker may grab the whole list. */
+    PRTREQINT volatile      pWsInbox;
+    /** The deque top index.  Other workers steal requests from here. */
+    int64_t volatile        iWsTop;
+    /** The deque bottom index.  Only modified by the owner thread. */
+    int64_t volatile        iWsBottom;
+    /** The deque entries. */
+    PRTREQINT volatile      apWsDeque[RTREQPOOL_WS_DEQUE_SIZE];
+    /** @} */
 } RTREQPOOLTHREAD;
 /** Pointer to a worker thread. */
 typedef RTREQPOOLTHREAD *PRTREQPOOLTHREAD;
@@ -136,6 +161,11 @@ typedef struct RTREQPOOLINT
     uint32_t                cMsMinPushBack;
     /** The max number of free requests in the recycle LIFO. */
     uint32_t                cMaxFreeRequests;
+    /** The number of work stealing worker threads, zero if using the
+     * classic single queue mode. */
+    uint32_t                cWsThreads;
+    /** Whether to bind each worker thread to a CPU. */
+    bool                    fCpuAffinity;
     /** @}  */
 
     /** Signaled by terminating worker threads. */
@@ -190,6 +220,21 @@ typedef struct RTREQPOOLINT
      * entering the critical section, thus volatile. */
     uint32_t volatile       cCurFreeRequests;
 
+    /** @name Work stealing mode.
+     * @{ */
+    /** Set once the work stealing workers have been started.  cWsThreads
+     * doesn't change after this has been set. */
+    bool volatile           fWsStarted;
+    /** The number of idle work stealing workers. */
+    uint32_t volatile       cWsIdle;
+    /** The number of requests in the inboxes and deques of the workers. */
+    uint32_t volatile       cWsPending;
+    /** Round robin index for distributing incoming requests. */
+    uint32_t volatile       iWsNext;
+    /** Array of cWsThreads work stealing workers. */
+    PRTREQPOOLTHREAD volatile *papWsThreads;
+    /** @} */
+
     /** Critical section serializing access to members of this structure.  */
     RTCRITSECT              CritSect;
 
@@ -227,7 +272,9 @@ static void rtReqPoolRecalcPushBack(PRTREQPOOLINT pPool)
     uint32_t const iStep    = pPool->cCurThreads - pPool->cThreadsPushBackThreshold;
 
     uint32_t cMsCurPushBack;
-    if ((cMsRange >> 2) >= cSteps)
+    if (!cSteps || pPool->cCurThreads <= pPool->cThreadsPushBackThreshold)
+        cMsCurPushBack = 0; /* no push back (threshold == max threads), or not yet */
+    else if ((cMsRange >> 2) >= cSteps)
         cMsCurPushBack = cMsRange / cSteps * iStep;
     else
         cMsCurPushBack = (uint32_t)( (uint64_t)cMsRange * RT_NS_1MS  / cSteps * iStep / RT_NS_1MS );
@@ -288,6 +335,67 @@ static int rtReqPoolThreadExit(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread, bo
 
 
 
+/**
+ * Binds the calling worker thread to a CPU if so configured.
+ *
+ * The workers are spread round robin over the online CPUs in set index order,
+ * so that neighbouring workers (which work stealing mode tries first when
+ * looking for work) usually end up on the same core complex / NUMA node.
+ *
+ * @param   pPool               The pool.
+ * @param   pThread             The calling worker thread.
+ */
+static void rtReqPoolThreadApplyAffinity(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread)
+{
+    if (!pPool->fCpuAffinity)
+        return;
+
+    RTCPUSET OnlineSet;
+    RTMpGetOnlineSet(&OnlineSet);
+    int const cCpus = RTCpuSetCount(&OnlineSet);
+    if (cCpus <= 1)
+        return;
+
+    uint32_t iNth = pThread->idxWorker % (uint32_t)cCpus;
+    for (int iCpu = 0; iCpu < RTCPUSET_MAX_CPUS; iCpu++)
+        if (RTCpuSetIsMemberByIndex(&OnlineSet, iCpu))
+        {
+            if (iNth-- == 0)
+            {
+                int rc = RTThreadSetAffinityToCpu(RTMpCpuIdFromSetIndex(iCpu));
+                LogFlow(("rtReqPoolThreadApplyAffinity: %s#%u -> CPU #%d: %Rrc\n", pPool->szName, pThread->idxWorker, iCpu, rc));
+                RT_NOREF(rc);
+                break;
+            }
+        }
+}
+
+
+/**
+ * Updates the pool statistics with the numbers from a worker thread.
+ *
+ * @param   pPool                       The pool.
+ * @param   pThread                     The worker thread.
+ * @param   pcReqPrevProcessedStat      The thread's counter at the last update.
+ * @param   pcNsPrevTotalReqProcessing  The thread's counter at the last update.
+ * @param   pcNsPrevTotalReqQueued      The thread's counter at the last update.
+ * @remarks Caller owns the critical section.
+ */
+static void rtReqPoolThreadUpdateStats(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread, uint64_t *pcReqPrevProcessedStat,
+                                       uint64_t *pcNsPrevTotalReqProcessing, uint64_t *pcNsPrevTotalReqQueued)
+{
+    if (*pcReqPrevProcessedStat != pThread->cReqProcessed)
+    {
+        pPool->cReqProcessed         += pThread->cReqProcessed         - *pcReqPrevProcessedStat;
+        *pcReqPrevProcessedStat       = pThread->cReqProcessed;
+        pPool->cNsTotalReqProcessing += pThread->cNsTotalReqProcessing - *pcNsPrevTotalReqProcessing;
+        *pcNsPrevTotalReqProcessing   = pThread->cNsTotalReqProcessing;
+        pPool->cNsTotalReqQueued     += pThread->cNsTotalReqQueued     - *pcNsPrevTotalReqQueued;
+        *pcNsPrevTotalReqQueued       = pThread->cNsTotalReqQueued;
+    }
+}
+
+
 /**
  * Process one request.
  *
@@ -336,6 +444,8 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
     PRTREQPOOLTHREAD    pThread = (PRTREQPOOLTHREAD)pvArg;
     PRTREQPOOLINT       pPool   = pThread->pPool;
 
+    rtReqPoolThreadApplyAffinity(pPool, pThread);
+
     /*
      * The work loop.
      */
@@ -362,15 +472,7 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
         RTCritSectEnter(&pPool->CritSect);
 
         /* Update the global statistics. */
-        if (cReqPrevProcessedStat != pThread->cReqProcessed)
-        {
-            pPool->cReqProcessed         += pThread->cReqProcessed         - cReqPrevProcessedStat;
-            cReqPrevProcessedStat         = pThread->cReqProcessed;
-            pPool->cNsTotalReqProcessing += pThread->cNsTotalReqProcessing - cNsPrevTotalReqProcessing;
-            cNsPrevTotalReqProcessing     = pThread->cNsTotalReqProcessing;
-            pPool->cNsTotalReqQueued     += pThread->cNsTotalReqQueued     - cNsPrevTotalReqQueued;
-            cNsPrevTotalReqQueued         = pThread->cNsTotalReqQueued;
-        }
+        rtReqPoolThreadUpdateStats(pPool, pThread, &cReqPrevProcessedStat, &cNsPrevTotalReqProcessing, &cNsPrevTotalReqQueued);
 
         /* Recheck the todo request pointer after entering the critsect. */
         pReq = ASMAtomicXchgPtrT(&pThread->pTodoReq, NULL, PRTREQINT);
@@ -438,37 +540,372 @@ static DECLCALLBACK(int) rtReqPoolThreadProc(RTTHREAD hThreadSelf, void *pvArg)
 }
 
 
+/*
+ *
+ *   W o r k   s t e a l i n g   m o d e
+ *   W o r k   s t e a l i n g   m o d e
+ *   W o r k   s t e a l i n g   m o d e
+ *
+ * In this mode the pool runs a fixed set of workers, each with its own request
+ * deque (Chase-Lev) and an incoming request list.  Submitters push requests
+ * onto the inbox of a worker (round robin) without taking any locks and wake
+ * up idle workers.  A worker first processes its own deque, then refills it
+ * from its own inbox, and when that's empty too it steals from the deques and
+ * inboxes of the other workers, starting with its neighbours.
+ *
+ */
+
+/**
+ * Pushes a request onto the bottom of the calling worker's deque.
+ *
+ * @returns true on success, false if the deque is full.
+ * @param   pThread             The calling worker thread.
+ * @param   pReq                The request.
+ */
+static bool rtReqPoolWsPush(PRTREQPOOLTHREAD pThread, PRTREQINT pReq)
+{
+    int64_t const iBottom = pThread->iWsBottom;
+    int64_t const iTop    = ASMAtomicReadS64(&pThread->iWsTop);
+    if (iBottom - iTop >= RTREQPOOL_WS_DEQUE_SIZE)
+        return false;
+    ASMAtomicWritePtr(&pThread->apWsDeque[iBottom & (RTREQPOOL_WS_DEQUE_SIZE - 1)], pReq);
+    ASMAtomicWriteS64(&pThread->iWsBottom, iBottom + 1);
+    return true;
+}
+
+
+/**
+ * Pops a request from the bottom of the calling worker's deque.
+ *
+ * @returns The request, NULL if empty.
+ * @param   pThread             The calling worker thread.
+ */
+static PRTREQINT rtReqPoolWsPop(PRTREQPOOLTHREAD pThread)
+{
+    int64_t const iBottom = pThread->iWsBottom - 1;
+    ASMAtomicXchgS64(&pThread->iWsBottom, iBottom); /* full fence before reading iWsTop */
+    int64_t const iTop    = ASMAtomicReadS64(&pThread->iWsTop);
+    if (iTop <= iBottom)
+    {
+        PRTREQINT pReq = ASMAtomicReadPtrT(&pThread->apWsDeque[iBottom & (RTREQPOOL_WS_DEQUE_SIZE - 1)], PRTREQINT);
+        if (iTop == iBottom)
+        {
+            /* The last entry, race the thieves for it. */
+            if (!ASMAtomicCmpXchgS64(&pThread->iWsTop, iTop + 1, iTop))
+                pReq = NULL;
+            ASMAtomicWriteS64(&pThread->iWsBottom, iBottom + 1);
+        }
+        return pReq;
+    }
+    ASMAtomicWriteS64(&pThread->iWsBottom, iBottom + 1);
+    return NULL;
+}
+
+
+/**
+ * Steals a request from the top of another worker's deque.
+ *
+ * @returns The request, NULL if empty.
+ * @param   pVictim             The worker to steal from.
+ */
+static PRTREQINT rtReqPoolWsSteal(PRTREQPOOLTHREAD pVictim)
+{
+    for (;;)
+    {
+        int64_t const iTop    = ASMAtomicReadS64(&pVictim->iWsTop);
+        int64_t const iBottom = ASMAtomicReadS64(&pVictim->iWsBottom);
+        if (iTop >= iBottom)
+            return NULL;
+        PRTREQINT pReq = ASMAtomicReadPtrT(&pVictim->apWsDeque[iTop & (RTREQPOOL_WS_DEQUE_SIZE - 1)], PRTREQINT);
+        if (ASMAtomicCmpXchgS64(&pVictim->iWsTop, iTop + 1, iTop))
+            return pReq;
+        /* Lost the race against the owner or another thief, try again. */
+    }
+}
+
+
+/**
+ * Pushes a chain of requests onto the inbox of a worker.
+ *
+ * @param   pThread             The worker.
+ * @param   pHead               The first request in the chain (the newest).
+ * @param   pTail               The last request in the chain (the oldest).
+ */
+static void rtReqPoolWsInboxPush(PRTREQPOOLTHREAD pThread, PRTREQINT pHead, PRTREQINT pTail)
+{
+    PRTREQINT pOld;
+    do
+    {
+        pOld = ASMAtomicReadPtrT(&pThread->pWsInbox, PRTREQINT);
+        ASMAtomicWritePtr(&pTail->pNext, pOld);
+    } while (!ASMAtomicCmpXchgPtr(&pThread->pWsInbox, pHead, pOld));
+}
+
+
+/**
+ * Moves the inbox of a worker into the calling worker's (empty) deque and
+ * returns the oldest request.
+ *
+ * @returns The oldest request, NULL if the inbox was empty.
+ * @param   pThread             The calling worker thread.
+ * @param   pFrom               The worker which inbox to grab.  Can be
+ *                              pThread.
+ */
+static PRTREQINT rtReqPoolWsGrabInbox(PRTREQPOOLTHREAD pThread, PRTREQPOOLTHREAD pFrom)
+{
+    if (!ASMAtomicReadPtrT(&pFrom->pWsInbox, PRTREQINT))
+        return NULL;
+    PRTREQINT pReq = ASMAtomicXchgPtrT(&pFrom->pWsInbox, NULL, PRTREQINT);
+    if (!pReq)
+        return NULL;
+
+    /* If there is more than fits into the deque, put the newest ones back. */
+    uint32_t cReqs = 0;
+    for (PRTREQINT pCur = pReq; pCur; pCur = pCur->pNext)
+        cReqs++;
+    if (cReqs > RTREQPOOL_WS_DEQUE_SIZE)
+    {
+        PRTREQINT pHead = pReq;
+        PRTREQINT pTail = pReq;
+        for (uint32_t cSkip = cReqs - RTREQPOOL_WS_DEQUE_SIZE; cSkip > 1; cSkip--)
+            pTail = pTail->pNext;
+        pReq = pTail->pNext;
+        rtReqPoolWsInboxPush(pThread, pHead, pTail);
+    }
+
+    /* Push them newest first so the owner (us) pops the oldest first. */
+    while (pReq)
+    {
+        PRTREQINT pNext = pReq->pNext;
+        ASMAtomicWriteNullPtr(&pReq->pNext);
+        bool fOk = rtReqPoolWsPush(pThread, pReq);
+        Assert(fOk); RT_NOREF(fOk);
+        pReq = pNext;
+    }
+    return rtReqPoolWsPop(pThread);
+}
+
+
+/**
+ * Looks for a request to process.
+ *
+ * @returns The request, NULL if nothing found.
+ * @param   pPool               The pool.
+ * @param   pThread             The calling worker thread.
+ */
+static PRTREQINT rtReqPoolWsFindWork(PRTREQPOOLINT pPool, PRTREQPOOLTHREAD pThread)
+{
+    PRTREQINT pReq = rtReqPoolWsPop(pThread);
+    if (!pReq)
+        pReq = rtReqPoolWsGrabInbox(pThread, pThread);
+    if (!pReq)
+    {
+        uint32_t const cThreads = pPool->cWsThreads;
+        for (uint32_t i = 1; i < cThreads; i++)
+        {
+            PRTREQPOOLTHREAD pVictim = ASMAtomicReadPtrT(&pPool->papWsThreads[(pThread->idxWorker + i) % cThreads],
+                                                         PRTREQPOOLTHREAD);
+            if (pVictim)
+            {
+                pReq = rtReqPoolWsSteal(pVictim);
+                if (!pReq)
+                    pReq = rtReqPoolWsGrabInbox(pThread, pVictim);
+                if (pReq)
+                    break;
+            }
+        }
+    }
+    return pReq;
+}
+
+
+/**
+ * The work stealing worker thread procedure.
+ *
+ * Unlike the classic workers these don't retire when idle, they stay around
+ * till the pool is destroyed.
+ *
+ * @returns VINF_SUCCESS.
+ * @param   hThreadSelf         The thread handle.
+ * @param   pvArg               Pointer to the thread data.
+ */
+static DECLCALLBACK(int) rtReqPoolWsThreadProc(RTTHREAD hThreadSelf, void *pvArg)
+{
+    PRTREQPOOLTHREAD    pThread = (PRTREQPOOLTHREAD)pvArg;
+    PRTREQPOOLINT       pPool   = pThread->pPool;
+
+    rtReqPoolThreadApplyAffinity(pPool, pThread);
+
+    uint64_t cReqPrevProcessedStat     = 0;
+    uint64_t cNsPrevTotalReqProcessing = 0;
+    uint64_t cNsPrevTotalReqQueued     = 0;
+    while (!pPool->fDestructing)
+    {
+        PRTREQINT pReq = rtReqPoolWsFindWork(pPool, pThread);
+        if (pReq)
+        {
+            ASMAtomicDecU32(&pPool->cWsPending);
+            rtReqPoolThreadProcessRequest(pPool, pThread, pReq);
+            continue;
+        }
+
+        /*
+         * Nothing to do.  Publish the statistics and go idle.
+         *
+         * The submitter increments cWsPending before checking cWsIdle, while we
+         * do it the other way around, so one of us will notice the other.
+         */
+        if (cReqPrevProcessedStat != pThread->cReqProcessed)
+        {
+            RTCritSectEnter(&pPool->CritSect);
+            rtReqPoolThreadUpdateStats(pPool, pThread, &cReqPrevProcessedStat, &cNsPrevTotalReqProcessing, &cNsPrevTotalReqQueued);
+            RTCritSectLeave(&pPool->CritSect);
+        }
+
+        RTThreadUserReset(hThreadSelf);
+        ASMAtomicWriteBool(&pThread->fWsIdle, true);
+        ASMAtomicIncU32(&pPool->cWsIdle);
+        if (   ASMAtomicReadU32(&pPool->cWsPending) == 0
+            && !pPool->fDestructing)
+            RTThreadUserWait(hThreadSelf, pPool->cMsIdleSleep);
+        else
+            RTThreadYield(); /* a submitter is in the middle of queuing something */
+
+        /* Un-idle ourselves unless a submitter already did so. */
+        if (ASMAtomicCmpXchgBool(&pThread->fWsIdle, false, true))
+            ASMAtomicDecU32(&pPool->cWsIdle);
+    }
+
+    return rtReqPoolThreadExit(pPool, pThread, false /*fLocked*/);
+}
+
+
+/**
+ * Queues a chain of requests in work stealing mode.
+ *
+ * @param   pPool               The pool.
+ * @param   pHead               The first request in the chain (the newest).
+ * @param   pTail               The last request in the chain (the oldest).
+ * @param   cReqs               The number of requests in the chain.
+ */
+static void rtReqPoolWsSubmit(PRTREQPOOLINT pPool, PRTREQINT pHead, PRTREQINT pTail, uint32_t cReqs)
+{
+    ASMAtomicAddU64(&pPool->cReqSubmitted, cReqs);
+    ASMAtomicAddU32(&pPool->cWsPending, cReqs);
+
+    uint32_t const cThreads = pPool->cWsThreads;
+    uint32_t const iStart   = ASMAtomicIncU32(&pPool->iWsNext) % cThreads;
+    rtReqPoolWsInboxPush(pPool->papWsThreads[iStart], pHead, pTail);
+
+    /* Wake up idle workers, starting with the one we gave the requests to. */
+    uint32_t cToWake = cReqs;
+    for (uint32_t i = 0; i < cThreads && cToWake > 0 && ASMAtomicReadU32(&pPool->cWsIdle) > 0; i++)
+    {
+        PRTREQPOOLTHREAD pThread = pPool->papWsThreads[(iStart + i) % cThreads];
+        if (   ASMAtomicReadBool(&pThread->fWsIdle)
+            && ASMAtomicCmpXchgBool(&pThread->fWsIdle, false, true))
+        {
+            ASMAtomicDecU32(&pPool->cWsIdle);
+            RTThreadUserSignal(pThread->hThread);
+            cToWake--;
+        }
+    }
+}
+
+
 /**
  * Create a new worker thread.
  *
+ * @returns true on success, false on failure.
  * @param   pPool               The pool needing new worker thread.
+ * @param   fWorkStealing       Whether it's a work stealing worker.  These are
+ *                              entered into RTREQPOOLINT::papWsThreads at the
+ *                              index given by cCurThreads.
  * @remarks Caller owns the critical section
  */
-static void rtReqPoolCreateNewWorker(RTREQPOOL pPool)
+static bool rtReqPoolCreateNewWorker(RTREQPOOL pPool, bool fWorkStealing)
 {
     PRTREQPOOLTHREAD pThread = (PRTREQPOOLTHREAD)RTMemAllocZ(sizeof(RTREQPOOLTHREAD));
     if (!pThread)
-        return;
+        return false;
 
     pThread->uBirthNanoTs = RTTimeNanoTS();
     pThread->pPool        = pPool;
     pThread->idLastCpu    = NIL_RTCPUID;
     pThread->hThread      = NIL_RTTHREAD;
+    pThread->idxWorker    = fWorkStealing ? pPool->cCurThreads : pPool->cThreadsCreated;
     RTListInit(&pThread->IdleNode);
     RTListAppend(&pPool->WorkerThreads, &pThread->ListNode);
+    if (fWorkStealing)
+        ASMAtomicWritePtr(&pPool->papWsThreads[pThread->idxWorker], pThread);
     pPool->cCurThreads++;
     pPool->cThreadsCreated++;
 
-    int rc = RTThreadCreateF(&pThread->hThread, rtReqPoolThreadProc, pThread, 0 /*default stack size*/,
-                             pPool->enmThreadType, 0 /*fFlags*/, "%s%02u", pPool->szName, pPool->cThreadsCreated);
+    int rc = RTThreadCreateF(&pThread->hThread, fWorkStealing ? rtReqPoolWsThreadProc : rtReqPoolThreadProc, pThread,
+                             0 /*default stack size*/, pPool->enmThreadType, 0 /*fFlags*/, "%s%02u",
+                             pPool->szName, pPool->cThreadsCreated);
     if (RT_SUCCESS(rc))
+    {
         pPool->uLastThreadCreateNanoTs = pThread->uBirthNanoTs;
-    else
+        return true;
+    }
+
+    pPool->cCurThreads--;
+    RTListNodeRemove(&pThread->ListNode);
+    if (fWorkStealing)
+        ASMAtomicWriteNullPtr(&pPool->papWsThreads[pThread->idxWorker]);
+    RTMemFree(pThread);
+    return false;
+}
+
+
+/**
+ * Starts the work stealing workers.
+ *
+ * If we fail to create any workers at all, we fall back on the classic mode.
+ *
+ * @param   pPool               The pool.
+ * @remarks Caller owns the critical section.
+ */
+static void rtReqPoolWsStart(PRTREQPOOLINT pPool)
+{
+    Assert(!pPool->fWsStarted);
+    uint32_t cCreated = 0;
+    pPool->papWsThreads = (PRTREQPOOLTHREAD volatile *)RTMemAllocZ(sizeof(pPool->papWsThreads[0]) * pPool->cWsThreads);
+    if (pPool->papWsThreads)
+        while (   cCreated < pPool->cWsThreads
+               && rtReqPoolCreateNewWorker(pPool, true /*fWorkStealing*/))
+            cCreated++;
+    if (!cCreated)
     {
-        pPool->cCurThreads--;
-        RTListNodeRemove(&pThread->ListNode);
-        RTMemFree(pThread);
+        LogRel(("RTReqPool/%s: Failed to start work stealing workers, using a single queue.\n", pPool->szName));
+        RTMemFree((void *)pPool->papWsThreads);
+        pPool->papWsThreads = NULL;
     }
+    pPool->cWsThreads = cCreated;
+    ASMAtomicWriteBool(&pPool->fWsStarted, true);
+}
+
+
+/**
+ * Checks whether the pool is in work stealing mode, starting the workers on
+ * the first call.
+ *
+ * @returns true if in work stealing mode, false if classic mode.
+ * @param   pPool               The pool.
+ */
+DECLINLINE(bool) rtReqPoolWsIsActive(PRTREQPOOLINT pPool)
+{
+    if (RT_LIKELY(ASMAtomicReadBool(&pPool->fWsStarted)))
+        return pPool->cWsThreads > 0;
+    if (!pPool->cWsThreads)
+        return false;
+
+    RTCritSectEnter(&pPool->CritSect);
+    if (!pPool->fWsStarted)
+        rtReqPoolWsStart(pPool);
+    RTCritSectLeave(&pPool->CritSect);
+    return pPool->cWsThreads > 0;
 }
 
 
@@ -522,10 +959,16 @@ static int rtReqPoolPushBack(PRTREQPOOLINT pPool, PRTREQINT pReq)
 
 
 
-DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
+/**
+ * Hands a request to an idle worker or puts it in the pending queue.
+ *
+ * @returns true if handed to an idle worker, false if queued.
+ * @param   pPool               The pool.
+ * @param   pReq                The request.
+ * @remarks Caller owns the critical section.
+ */
+static bool rtReqPoolQueueLocked(PRTREQPOOLINT pPool, PRTREQINT pReq)
 {
-    RTCritSectEnter(&pPool->CritSect);
-
     pPool->cReqSubmitted++;
 
     /*
@@ -534,7 +977,6 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
     PRTREQPOOLTHREAD pThread = RTListGetFirst(&pPool->IdleThreads, RTREQPOOLTHREAD, IdleNode);
     if (pThread)
     {
-        /** @todo CPU affinity??? */
         ASMAtomicWritePtr(&pThread->pTodoReq, pReq);
 
         RTListNodeRemove(&pThread->IdleNode);
@@ -542,9 +984,7 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
         ASMAtomicDecU32(&pPool->cIdleThreads);
 
         RTThreadUserSignal(pThread->hThread);
-
-        RTCritSectLeave(&pPool->CritSect);
-        return;
+        return true;
     }
     Assert(RTListIsEmpty(&pPool->IdleThreads));
 
@@ -555,6 +995,25 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
     *pPool->ppPendingRequests = pReq;
     pPool->ppPendingRequests  = (PRTREQINT*)&pReq->pNext;
     pPool->cCurPendingRequests++;
+    return false;
+}
+
+
+DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
+{
+    if (rtReqPoolWsIsActive(pPool))
+    {
+        rtReqPoolWsSubmit(pPool, pReq, pReq, 1);
+        return;
+    }
+
+    RTCritSectEnter(&pPool->CritSect);
+
+    if (rtReqPoolQueueLocked(pPool, pReq))
+    {
+        RTCritSectLeave(&pPool->CritSect);
+        return;
+    }
 
     /*
      * If there is an incoming worker thread already or we've reached the
@@ -582,7 +1041,7 @@ DECLHIDDEN(void) rtReqPoolSubmit(PRTREQPOOLINT pPool, PRTREQINT pReq)
      * Create a new thread for processing the request.
      * For simplicity, we don't bother leaving the critical section while doing so.
      */
-    rtReqPoolCreateNewWorker(pPool);
+    rtReqPoolCreateNewWorker(pPool, false /*fWorkStealing*/);
 
     RTCritSectLeave(&pPool->CritSect);
     return;
@@ -668,6 +1127,8 @@ RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
     pPool->cMsMaxPushBack       = cMsMaxPushBack;
     pPool->cMsMinPushBack       = cMsMinPushBack;
     pPool->cMaxFreeRequests     = cMaxThreads * 2;
+    pPool->cWsThreads           = 0;
+    pPool->fCpuAffinity         = false;
     pPool->hThreadTermEvt       = NIL_RTSEMEVENTMULTI;
     pPool->fDestructing         = false;
     pPool->cMsCurPushBack       = 0;
@@ -688,6 +1149,11 @@ RTDECL(int) RTReqPoolCreate(uint32_t cMaxThreads, RTMSINTERVAL cMsMinIdle,
     pPool->cReqSubmitted        = 0;
     pPool->pFreeRequests        = NULL;
     pPool->cCurFreeRequests     = 0;
+    pPool->fWsStarted           = false;
+    pPool->cWsIdle              = 0;
+    pPool->cWsPending           = 0;
+    pPool->iWsNext              = 0;
+    pPool->papWsThreads         = NULL;
 
     int rc = RTSemEventMultiCreate(&pPool->hThreadTermEvt);
     if (RT_SUCCESS(rc))
@@ -839,6 +1305,20 @@ RTDECL(int) RTReqPoolSetCfgVar(RTREQPOOL hPool, RTREQPOOLCFGVAR enmVar, uint64_t
             }
             break;
 
+        case RTREQPOOLCFGVAR_WORK_STEALING_THREADS:
+            AssertMsgBreakStmt(!pPool->fWsStarted && pPool->cCurThreads == 0, ("%u threads\n", pPool->cCurThreads),
+                               rc = VERR_WRONG_ORDER);
+            if (uValue == UINT64_MAX)
+                uValue = RT_MIN(RTMpGetOnlineCount(), pPool->cMaxThreads);
+            else
+                AssertMsgBreakStmt(uValue <= pPool->cMaxThreads,  ("%llu\n",  uValue), rc = VERR_OUT_OF_RANGE);
+            pPool->cWsThreads = (uint32_t)uValue;
+            break;
+
+        case RTREQPOOLCFGVAR_CPU_AFFINITY:
+            pPool->fCpuAffinity = uValue != 0;
+            break;
+
         default:
             AssertFailed();
             rc = VERR_IPE_NOT_REACHED_DEFAULT_CASE;
@@ -910,6 +1390,14 @@ RTDECL(uint64_t) RTReqPoolGetCfgVar(RTREQPOOL hPool, RTREQPOOLCFGVAR enmVar)
             u64 = pPool->cMaxFreeRequests;
             break;
 
+        case RTREQPOOLCFGVAR_WORK_STEALING_THREADS:
+            u64 = pPool->cWsThreads;
+            break;
+
+        case RTREQPOOLCFGVAR_CPU_AFFINITY:
+            u64 = pPool->fCpuAffinity;
+            break;
+
         default:
             AssertFailed();
             u64 = UINT64_MAX;
@@ -939,7 +1427,7 @@ RTDECL(uint64_t) RTReqPoolGetStat(RTREQPOOL hPool, RTREQPOOLSTAT enmStat)
         case RTREQPOOLSTAT_THREADS_CREATED:             u64 = pPool->cThreadsCreated; break;
         case RTREQPOOLSTAT_REQUESTS_PROCESSED:          u64 = pPool->cReqProcessed; break;
         case RTREQPOOLSTAT_REQUESTS_SUBMITTED:          u64 = pPool->cReqSubmitted; break;
-        case RTREQPOOLSTAT_REQUESTS_PENDING:            u64 = pPool->cCurPendingRequests; break;
+        case RTREQPOOLSTAT_REQUESTS_PENDING:            u64 = pPool->cCurPendingRequests + pPool->cWsPending; break;
         case RTREQPOOLSTAT_REQUESTS_ACTIVE:             u64 = pPool->cCurActiveRequests; break;
         case RTREQPOOLSTAT_REQUESTS_FREE:               u64 = pPool->cCurFreeRequests; break;
         case RTREQPOOLSTAT_NS_TOTAL_REQ_PROCESSING:     u64 = pPool->cNsTotalReqProcessing; break;
@@ -1023,6 +1511,30 @@ RTDECL(uint32_t) RTReqPoolRelease(RTREQPOOL hPool)
             /** @todo should we wait forever here? */
         }
 
+        /* Cancel requests left in the work stealing queues and free the workers
+           (they're all gone now). */
+        if (pPool->papWsThreads)
+        {
+            for (uint32_t i = 0; i < pPool->cWsThreads; i++)
+            {
+                PRTREQPOOLTHREAD pWsThread = pPool->papWsThreads[i];
+                PRTREQINT        pReq      = pWsThread->pWsInbox;
+                while (pReq)
+                {
+                    PRTREQINT pNext = pReq->pNext;
+                    pReq->pNext = NULL;
+                    rtReqPoolCancelReq(pReq);
+                    pReq = pNext;
+                }
+                while (pWsThread->iWsTop < pWsThread->iWsBottom)
+                    rtReqPoolCancelReq(pWsThread->apWsDeque[pWsThread->iWsTop++ & (RTREQPOOL_WS_DEQUE_SIZE - 1)]);
+                RTMemFree(pWsThread);
+            }
+            RTMemFree((void *)pPool->papWsThreads);
+            pPool->papWsThreads = NULL;
+            pPool->cWsPending   = 0;
+        }
+
         /* Free recycled requests. */
         for (;;)
         {
@@ -1208,3 +1720,146 @@ RTDECL(int) RTReqPoolCallVoidNoWait(RTREQPOOL hPool, PFNRT pfnFunction, unsigned
 }
 RT_EXPORT_SYMBOL(RTReqPoolCallVoidNoWait);
 
+
+
+RTDECL(int) RTReqPoolCallVoidNoWaitBatch(RTREQPOOL hPool, PFNRT pfnFunction, uint32_t cCalls, uintptr_t const *pauArgs)
+{
+    PRTREQPOOLINT pPool = hPool;
+    AssertPtrReturn(pPool, VERR_INVALID_HANDLE);
+    AssertReturn(pPool->u32Magic == RTREQPOOL_MAGIC, VERR_INVALID_HANDLE);
+    AssertPtrReturn(pfnFunction, VERR_INVALID_POINTER);
+    AssertPtrReturn(pauArgs, VERR_INVALID_POINTER);
+    if (!cCalls)
+        return VINF_SUCCESS;
+
+    /*
+     * Allocate and initialize the requests, chaining them up newest first.
+     * We grab as many recycled requests as we can in one go.
+     */
+    PRTREQINT pRecycled = NULL;
+    if (ASMAtomicReadU32(&pPool->cCurFreeRequests) > 0)
+    {
+        RTCritSectEnter(&pPool->CritSect);
+        for (uint32_t i = 0; i < cCalls && pPool->pFreeRequests; i++)
+        {
+            PRTREQINT pReq = pPool->pFreeRequests;
+            pPool->pFreeRequests = pReq->pNext;
+            ASMAtomicDecU32(&pPool->cCurFreeRequests);
+            pReq->pNext = pRecycled;
+            pRecycled = pReq;
+        }
+        RTCritSectLeave(&pPool->CritSect);
+    }
+
+    int       rc    = VINF_SUCCESS;
+    PRTREQINT pHead = NULL;
+    PRTREQINT pTail = NULL;
+    for (uint32_t i = 0; i < cCalls; i++)
+    {
+        PRTREQINT pReq = pRecycled;
+        if (pReq)
+        {
+            pRecycled = pReq->pNext;
+            Assert(pReq->fPoolOrQueue);
+            Assert(pReq->uOwner.hPool == pPool);
+            rc = rtReqReInit(pReq, RTREQTYPE_INTERNAL);
+            if (RT_FAILURE(rc))
+                pReq = NULL;
+        }
+        if (!pReq)
+        {
+            rc = rtReqAlloc(RTREQTYPE_INTERNAL, true /*fPoolOrQueue*/, pPool, &pReq);
+            if (RT_FAILURE(rc))
+                break;
+        }
+
+        pReq->fFlags              = RTREQFLAGS_VOID | RTREQFLAGS_NO_WAIT;
+        pReq->u.Internal.pfn      = pfnFunction;
+        pReq->u.Internal.cArgs    = 1;
+        pReq->u.Internal.aArgs[0] = pauArgs[i];
+        pReq->pNext               = pHead;
+        pHead = pReq;
+        if (!pTail)
+            pTail = pReq;
+    }
+
+    /* Return unused recycled requests. */
+    while (pRecycled)
+    {
+        PRTREQINT pNext = pRecycled->pNext;
+        if (!rtReqPoolRecycle(pPool, pRecycled))
+            rtReqFreeIt(pRecycled);
+        pRecycled = pNext;
+    }
+
+    if (RT_FAILURE(rc))
+    {
+        while (pHead)
+        {
+            PRTREQINT pNext = pHead->pNext;
+            pHead->pNext = NULL;
+            RTReqRelease(pHead);
+            pHead = pNext;
+        }
+        LogFlow(("RTReqPoolCallVoidNoWaitBatch: returns %Rrc\n", rc));
+        return rc;
+    }
+
+    /*
+     * Submit them.  The requests belong to the pool now (RTREQFLAGS_NO_WAIT).
+     */
+    uint64_t const uNsTs = RTTimeNanoTS();
+    for (PRTREQINT pReq = pHead; pReq; pReq = pReq->pNext)
+    {
+        pReq->uSubmitNanoTs = uNsTs;
+        pReq->enmState      = RTREQSTATE_QUEUED;
+    }
+
+    if (rtReqPoolWsIsActive(pPool))
+        rtReqPoolWsSubmit(pPool, pHead, pTail, cCalls);
+    else
+    {
+        /* Reverse the chain so we queue them in submission order. */
+        PRTREQINT pOldest = NULL;
+        while (pHead)
+        {
+            PRTREQINT pNext = pHead->pNext;
+            pHead->pNext = pOldest;
+            pOldest = pHead;
+            pHead = pNext;
+        }
+
+        RTCritSectEnter(&pPool->CritSect);
+
+        uint32_t cQueued = 0;
+        while (pOldest)
+        {
+            PRTREQINT pNext = pOldest->pNext;
+            if (!rtReqPoolQueueLocked(pPool, pOldest))
+                cQueued++;
+            pOldest = pNext;
+        }
+
+        /* Spawn workers for what was queued, up to the push back threshold
+           (we don't push back batch submitters).  Make sure there is at least
+           one worker if there are none and nobody is on the way. */
+        if (cQueued > pPool->cIdleThreads)
+        {
+            uint32_t cNew = cQueued - pPool->cIdleThreads;
+            uint32_t const cLimit = RT_MAX(pPool->cThreadsPushBackThreshold, 1);
+            cNew = pPool->cCurThreads < cLimit ? RT_MIN(cNew, cLimit - pPool->cCurThreads) : 0;
+            if (!cNew && !pPool->cCurThreads)
+                cNew = 1;
+            while (   cNew-- > 0
+                   && pPool->cCurThreads < pPool->cMaxThreads
+                   && rtReqPoolCreateNewWorker(pPool, false /*fWorkStealing*/))
+            { /* likely */ }
+        }
+
+        RTCritSectLeave(&pPool->CritSect);
+    }
+
+    LogFlow(("RTReqPoolCallVoidNoWaitBatch: returns VINF_SUCCESS (%u calls)\n", cCalls));
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTReqPoolCallVoidNoWaitBatch);
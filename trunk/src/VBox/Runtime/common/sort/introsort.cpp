@@ -0,0 +1,396 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTSort, RTSortApv - introspective quick sort.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Partitions at or below this size are finished off by insertion sort. */
+#define RTSORT_INSERTION_THRESHOLD      16
+/** Partitions above this size use the pseudo median of nine (Tukey's ninther)
+ * instead of the median of three for picking the pivot. */
+#define RTSORT_NINTHER_THRESHOLD        128
+
+
+/*********************************************************************************************************************************
+*   Variable Sized Elements                                                                                                      *
+*********************************************************************************************************************************/
+
+/**
+ * Swaps two array elements.
+ *
+ * Elements which are a multiple of the native word size and suitably aligned
+ * are swapped a word at the time, everything else byte by byte.
+ */
+DECLINLINE(void) rtSortSwap(uint8_t *pb1, uint8_t *pb2, size_t cbElement)
+{
+    if (   !(cbElement & (sizeof(uintptr_t) - 1))
+        && !(((uintptr_t)pb1 | (uintptr_t)pb2) & (sizeof(uintptr_t) - 1)))
+    {
+        uintptr_t *pu1 = (uintptr_t *)pb1;
+        uintptr_t *pu2 = (uintptr_t *)pb2;
+        size_t     c   = cbElement / sizeof(uintptr_t);
+        while (c-- > 0)
+        {
+            uintptr_t uTmp = *pu1;
+            *pu1++ = *pu2;
+            *pu2++ = uTmp;
+        }
+    }
+    else
+        while (cbElement-- > 0)
+        {
+            uint8_t bTmp = *pb1;
+            *pb1++ = *pb2;
+            *pb2++ = bTmp;
+        }
+}
+
+
+/**
+ * Orders three elements so that the median ends up in the middle one.
+ */
+DECLINLINE(void) rtSortMedian3(uint8_t *pb1, uint8_t *pb2, uint8_t *pb3, size_t cbElement,
+                               PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    if (pfnCmp(pb2, pb1, pvUser) < 0)
+        rtSortSwap(pb1, pb2, cbElement);
+    if (pfnCmp(pb3, pb2, pvUser) < 0)
+    {
+        rtSortSwap(pb2, pb3, cbElement);
+        if (pfnCmp(pb2, pb1, pvUser) < 0)
+            rtSortSwap(pb1, pb2, cbElement);
+    }
+}
+
+
+/**
+ * Insertion sort, used for finishing off small partitions.
+ */
+static void rtSortInsertion(uint8_t *pbArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    for (size_t i = 1; i < cElements; i++)
+    {
+        uint8_t *pbCur = &pbArray[i * cbElement];
+        while (   pbCur != pbArray
+               && pfnCmp(pbCur - cbElement, pbCur, pvUser) > 0)
+        {
+            rtSortSwap(pbCur - cbElement, pbCur, cbElement);
+            pbCur -= cbElement;
+        }
+    }
+}
+
+
+/**
+ * Heap sort, the fallback when quick sort hits too many bad pivots.
+ */
+static void rtSortHeap(uint8_t *pbArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Heapify, then repeatedly move the max to the end. */
+    size_t iStart = cElements / 2;
+    size_t iEnd   = cElements;
+    while (iEnd > 1)
+    {
+        if (iStart > 0)
+            iStart--;
+        else
+        {
+            iEnd--;
+            rtSortSwap(pbArray, &pbArray[iEnd * cbElement], cbElement);
+        }
+
+        /* sift down */
+        size_t iRoot = iStart;
+        for (;;)
+        {
+            size_t iChild = iRoot * 2 + 1;
+            if (iChild >= iEnd)
+                break;
+            if (   iChild + 1 < iEnd
+                && pfnCmp(&pbArray[iChild * cbElement], &pbArray[(iChild + 1) * cbElement], pvUser) < 0)
+                iChild++;
+            if (pfnCmp(&pbArray[iRoot * cbElement], &pbArray[iChild * cbElement], pvUser) >= 0)
+                break;
+            rtSortSwap(&pbArray[iRoot * cbElement], &pbArray[iChild * cbElement], cbElement);
+            iRoot = iChild;
+        }
+    }
+}
+
+
+/**
+ * The introsort worker.
+ *
+ * Recurses into the smaller partition and loops on the larger one, so the
+ * stack depth is bounded by log2(cElements) regardless of the pivots.
+ */
+static void rtSortIntro(uint8_t *pbArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser,
+                        unsigned cDepthLeft)
+{
+    while (cElements > RTSORT_INSERTION_THRESHOLD)
+    {
+        if (cDepthLeft-- == 0)
+        {
+            rtSortHeap(pbArray, cElements, cbElement, pfnCmp, pvUser);
+            return;
+        }
+
+        /*
+         * Pick the pivot and move it to the head of the partition.
+         */
+        uint8_t *pbMid  = &pbArray[(cElements / 2) * cbElement];
+        uint8_t *pbLast = &pbArray[(cElements - 1) * cbElement];
+        if (cElements > RTSORT_NINTHER_THRESHOLD)
+        {
+            size_t const cbStep = (cElements / 8) * cbElement;
+            rtSortMedian3(pbArray,          pbArray + cbStep, pbArray + 2 * cbStep, cbElement, pfnCmp, pvUser);
+            rtSortMedian3(pbMid - cbStep,   pbMid,            pbMid + cbStep,       cbElement, pfnCmp, pvUser);
+            rtSortMedian3(pbLast - 2 * cbStep, pbLast - cbStep, pbLast,             cbElement, pfnCmp, pvUser);
+            rtSortMedian3(pbArray + cbStep, pbMid,            pbLast - cbStep,      cbElement, pfnCmp, pvUser);
+        }
+        else
+            rtSortMedian3(pbArray, pbMid, pbLast, cbElement, pfnCmp, pvUser);
+        rtSortSwap(pbArray, pbMid, cbElement);
+
+        /*
+         * Hoare partitioning.  Both scans stop on elements equal to the pivot,
+         * which keeps arrays with lots of duplicates balanced.  The pivot stays
+         * at index 0 and acts as the sentinel for the downward scan.
+         */
+        size_t i = 0;
+        size_t j = cElements;
+        for (;;)
+        {
+            do
+                i++;
+            while (i < cElements && pfnCmp(&pbArray[i * cbElement], pbArray, pvUser) < 0);
+            do
+                j--;
+            while (pfnCmp(&pbArray[j * cbElement], pbArray, pvUser) > 0);
+            if (i >= j)
+                break;
+            rtSortSwap(&pbArray[i * cbElement], &pbArray[j * cbElement], cbElement);
+        }
+        rtSortSwap(pbArray, &pbArray[j * cbElement], cbElement);
+
+        /*
+         * [0, j) <= pivot, j = pivot, (j, cElements) >= pivot.
+         */
+        size_t const cLeft  = j;
+        size_t const cRight = cElements - j - 1;
+        if (cLeft < cRight)
+        {
+            rtSortIntro(pbArray, cLeft, cbElement, pfnCmp, pvUser, cDepthLeft);
+            pbArray  += (j + 1) * cbElement;
+            cElements = cRight;
+        }
+        else
+        {
+            rtSortIntro(&pbArray[(j + 1) * cbElement], cRight, cbElement, pfnCmp, pvUser, cDepthLeft);
+            cElements = cLeft;
+        }
+    }
+
+    rtSortInsertion(pbArray, cElements, cbElement, pfnCmp, pvUser);
+}
+
+
+RTDECL(void) RTSort(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    AssertReturnVoid(cbElement > 0);
+
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return;
+
+    unsigned const cDepth = 2 * (ASMBitLastSetU64(cElements) + 1);
+    rtSortIntro((uint8_t *)pvArray, cElements, cbElement, pfnCmp, pvUser, cDepth);
+}
+RT_EXPORT_SYMBOL(RTSort);
+
+
+/*********************************************************************************************************************************
+*   Pointer Arrays                                                                                                               *
+*********************************************************************************************************************************/
+
+DECLINLINE(void) rtSortApvMedian3(void **ppv1, void **ppv2, void **ppv3, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    void *pvTmp;
+    if (pfnCmp(*ppv2, *ppv1, pvUser) < 0)
+    {
+        pvTmp = *ppv1; *ppv1 = *ppv2; *ppv2 = pvTmp;
+    }
+    if (pfnCmp(*ppv3, *ppv2, pvUser) < 0)
+    {
+        pvTmp = *ppv2; *ppv2 = *ppv3; *ppv3 = pvTmp;
+        if (pfnCmp(*ppv2, *ppv1, pvUser) < 0)
+        {
+            pvTmp = *ppv1; *ppv1 = *ppv2; *ppv2 = pvTmp;
+        }
+    }
+}
+
+
+static void rtSortApvInsertion(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    for (size_t i = 1; i < cElements; i++)
+    {
+        void   *pvTmp = papvArray[i];
+        size_t  j     = i;
+        while (   j > 0
+               && pfnCmp(papvArray[j - 1], pvTmp, pvUser) > 0)
+        {
+            papvArray[j] = papvArray[j - 1];
+            j--;
+        }
+        papvArray[j] = pvTmp;
+    }
+}
+
+
+static void rtSortApvHeap(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    size_t iStart = cElements / 2;
+    size_t iEnd   = cElements;
+    while (iEnd > 1)
+    {
+        void *pvTmp;
+        if (iStart > 0)
+            iStart--;
+        else
+        {
+            iEnd--;
+            pvTmp = papvArray[0]; papvArray[0] = papvArray[iEnd]; papvArray[iEnd] = pvTmp;
+        }
+
+        size_t iRoot = iStart;
+        pvTmp = papvArray[iRoot];
+        for (;;)
+        {
+            size_t iChild = iRoot * 2 + 1;
+            if (iChild >= iEnd)
+                break;
+            if (   iChild + 1 < iEnd
+                && pfnCmp(papvArray[iChild], papvArray[iChild + 1], pvUser) < 0)
+                iChild++;
+            if (pfnCmp(pvTmp, papvArray[iChild], pvUser) >= 0)
+                break;
+            papvArray[iRoot] = papvArray[iChild];
+            iRoot = iChild;
+        }
+        papvArray[iRoot] = pvTmp;
+    }
+}
+
+
+static void rtSortApvIntro(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser, unsigned cDepthLeft)
+{
+    while (cElements > RTSORT_INSERTION_THRESHOLD)
+    {
+        if (cDepthLeft-- == 0)
+        {
+            rtSortApvHeap(papvArray, cElements, pfnCmp, pvUser);
+            return;
+        }
+
+        size_t const iMid  = cElements / 2;
+        size_t const iLast = cElements - 1;
+        if (cElements > RTSORT_NINTHER_THRESHOLD)
+        {
+            size_t const cStep = cElements / 8;
+            rtSortApvMedian3(&papvArray[0],             &papvArray[cStep],        &papvArray[2 * cStep], pfnCmp, pvUser);
+            rtSortApvMedian3(&papvArray[iMid - cStep],  &papvArray[iMid],         &papvArray[iMid + cStep], pfnCmp, pvUser);
+            rtSortApvMedian3(&papvArray[iLast - 2 * cStep], &papvArray[iLast - cStep], &papvArray[iLast], pfnCmp, pvUser);
+            rtSortApvMedian3(&papvArray[cStep],         &papvArray[iMid],         &papvArray[iLast - cStep], pfnCmp, pvUser);
+        }
+        else
+            rtSortApvMedian3(&papvArray[0], &papvArray[iMid], &papvArray[iLast], pfnCmp, pvUser);
+
+        void * const pvPivot = papvArray[iMid];
+        papvArray[iMid] = papvArray[0];
+        papvArray[0]    = pvPivot;
+
+        size_t i = 0;
+        size_t j = cElements;
+        for (;;)
+        {
+            do
+                i++;
+            while (i < cElements && pfnCmp(papvArray[i], pvPivot, pvUser) < 0);
+            do
+                j--;
+            while (pfnCmp(papvArray[j], pvPivot, pvUser) > 0);
+            if (i >= j)
+                break;
+            void *pvTmp = papvArray[i];
+            papvArray[i] = papvArray[j];
+            papvArray[j] = pvTmp;
+        }
+        papvArray[0] = papvArray[j];
+        papvArray[j] = pvPivot;
+
+        size_t const cLeft  = j;
+        size_t const cRight = cElements - j - 1;
+        if (cLeft < cRight)
+        {
+            rtSortApvIntro(papvArray, cLeft, pfnCmp, pvUser, cDepthLeft);
+            papvArray += j + 1;
+            cElements  = cRight;
+        }
+        else
+        {
+            rtSortApvIntro(&papvArray[j + 1], cRight, pfnCmp, pvUser, cDepthLeft);
+            cElements = cLeft;
+        }
+    }
+
+    rtSortApvInsertion(papvArray, cElements, pfnCmp, pvUser);
+}
+
+
+RTDECL(void) RTSortApv(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return;
+
+    unsigned const cDepth = 2 * (ASMBitLastSetU64(cElements) + 1);
+    rtSortApvIntro(papvArray, cElements, pfnCmp, pvUser, cDepth);
+}
+RT_EXPORT_SYMBOL(RTSortApv);
+
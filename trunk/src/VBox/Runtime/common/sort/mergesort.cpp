@@ -0,0 +1,438 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTSortMerge, RTSortApvMerge, RTSortParallel - stable merge sorting.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/mp.h>
+#include <iprt/req.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The length of the runs sorted by insertion sort before merging starts. */
+#define RTSORT_MERGE_RUN                16
+/** Arrays smaller than this are not worth spreading over several threads. */
+#define RTSORT_PARALLEL_MIN_ELEMENTS    _64K
+/** The minimum number of elements each parallel chunk should get. */
+#define RTSORT_PARALLEL_MIN_CHUNK       _16K
+/** The max number of parallel chunks. */
+#define RTSORT_PARALLEL_MAX_CHUNKS      64
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/**
+ * A unit of work for RTSortParallel.
+ */
+typedef struct RTSORTPARTASK
+{
+    /** The source array (first run starts here). */
+    uint8_t        *pbSrc;
+    /** The destination / scratch buffer. */
+    uint8_t        *pbDst;
+    /** Number of elements in the first run (or the whole chunk when sorting). */
+    size_t          cLeft;
+    /** Number of elements in the second run, 0 when sorting a chunk. */
+    size_t          cRight;
+    /** The element size. */
+    size_t          cbElement;
+    /** The compare callback. */
+    PFNRTSORTCMP    pfnCmp;
+    /** The compare callback user argument. */
+    void           *pvUser;
+    /** The request handle while pending on the pool. */
+    PRTREQ          hReq;
+} RTSORTPARTASK;
+/** Pointer to a parallel sort task. */
+typedef RTSORTPARTASK *PRTSORTPARTASK;
+
+
+/*********************************************************************************************************************************
+*   Variable Sized Elements                                                                                                      *
+*********************************************************************************************************************************/
+
+/**
+ * Stable insertion sort.
+ *
+ * @param   pvTmp           Scratch space for one element.
+ */
+static void rtSortMergeInsertion(uint8_t *pbArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser,
+                                 void *pvTmp)
+{
+    for (size_t i = 1; i < cElements; i++)
+    {
+        uint8_t *pbCur = &pbArray[i * cbElement];
+        if (pfnCmp(pbCur - cbElement, pbCur, pvUser) <= 0)
+            continue;
+
+        memcpy(pvTmp, pbCur, cbElement);
+        size_t j = i;
+        do
+        {
+            memcpy(&pbArray[j * cbElement], &pbArray[(j - 1) * cbElement], cbElement);
+            j--;
+        } while (   j > 0
+                 && pfnCmp(&pbArray[(j - 1) * cbElement], pvTmp, pvUser) > 0);
+        memcpy(&pbArray[j * cbElement], pvTmp, cbElement);
+    }
+}
+
+
+/**
+ * Merges two adjacent sorted runs from @a pbSrc into @a pbDst.
+ *
+ * Elements from the left run win ties, which is what makes the sort stable.
+ */
+static void rtSortMergeRuns(uint8_t const *pbSrc, size_t cLeft, size_t cRight, uint8_t *pbDst,
+                            size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    uint8_t const *pbLeft     = pbSrc;
+    uint8_t const *pbLeftEnd  = pbSrc + cLeft * cbElement;
+    uint8_t const *pbRight    = pbLeftEnd;
+    uint8_t const *pbRightEnd = pbRight + cRight * cbElement;
+
+    /* Already in order?  Common for presorted and nearly sorted input. */
+    if (   cLeft
+        && cRight
+        && pfnCmp(pbLeftEnd - cbElement, pbRight, pvUser) > 0)
+    {
+        while (pbLeft < pbLeftEnd && pbRight < pbRightEnd)
+        {
+            if (pfnCmp(pbRight, pbLeft, pvUser) < 0)
+            {
+                memcpy(pbDst, pbRight, cbElement);
+                pbRight += cbElement;
+            }
+            else
+            {
+                memcpy(pbDst, pbLeft, cbElement);
+                pbLeft += cbElement;
+            }
+            pbDst += cbElement;
+        }
+    }
+
+    if (pbLeft < pbLeftEnd)
+    {
+        memcpy(pbDst, pbLeft, pbLeftEnd - pbLeft);
+        pbDst += pbLeftEnd - pbLeft;
+    }
+    if (pbRight < pbRightEnd)
+        memcpy(pbDst, pbRight, pbRightEnd - pbRight);
+}
+
+
+/**
+ * Bottom up merge sort worker.
+ *
+ * @param   pbArray         The array to sort; this is also where the result
+ *                          ends up.
+ * @param   pbTmp           Scratch buffer of the same size as the array.
+ */
+static void rtSortMergeWorker(uint8_t *pbArray, uint8_t *pbTmp, size_t cElements, size_t cbElement,
+                              PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Sort short runs in place.  The scratch buffer isn't used yet, so lend
+       the first element of it to the insertion sort. */
+    for (size_t i = 0; i < cElements; i += RTSORT_MERGE_RUN)
+        rtSortMergeInsertion(&pbArray[i * cbElement], RT_MIN(RTSORT_MERGE_RUN, cElements - i), cbElement,
+                             pfnCmp, pvUser, pbTmp);
+
+    /* Merge the runs, ping-ponging between the two buffers. */
+    uint8_t *pbSrc = pbArray;
+    uint8_t *pbDst = pbTmp;
+    for (size_t cWidth = RTSORT_MERGE_RUN; cWidth < cElements; cWidth *= 2)
+    {
+        for (size_t i = 0; i < cElements; i += 2 * cWidth)
+        {
+            size_t const cLeft  = RT_MIN(cWidth, cElements - i);
+            size_t const cRight = RT_MIN(cWidth, cElements - i - cLeft);
+            rtSortMergeRuns(&pbSrc[i * cbElement], cLeft, cRight, &pbDst[i * cbElement], cbElement, pfnCmp, pvUser);
+        }
+        uint8_t *pbSwap = pbSrc;
+        pbSrc = pbDst;
+        pbDst = pbSwap;
+    }
+
+    if (pbSrc != pbArray)
+        memcpy(pbArray, pbSrc, cElements * cbElement);
+}
+
+
+RTDECL(int) RTSortMerge(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    AssertReturn(cbElement > 0, VERR_INVALID_PARAMETER);
+
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+
+    uint8_t *pbTmp = (uint8_t *)RTMemTmpAlloc(cElements * cbElement);
+    if (!pbTmp)
+        return VERR_NO_MEMORY;
+    rtSortMergeWorker((uint8_t *)pvArray, pbTmp, cElements, cbElement, pfnCmp, pvUser);
+    RTMemTmpFree(pbTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortMerge);
+
+
+/*********************************************************************************************************************************
+*   Pointer Arrays                                                                                                               *
+*********************************************************************************************************************************/
+
+RTDECL(int) RTSortApvMerge(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+
+    void **papvTmp = (void **)RTMemTmpAlloc(cElements * sizeof(void *));
+    if (!papvTmp)
+        return VERR_NO_MEMORY;
+
+    /* Stable insertion sort of the short runs. */
+    for (size_t iRun = 0; iRun < cElements; iRun += RTSORT_MERGE_RUN)
+    {
+        size_t const iEnd = RT_MIN(iRun + RTSORT_MERGE_RUN, cElements);
+        for (size_t i = iRun + 1; i < iEnd; i++)
+        {
+            void   *pvTmp = papvArray[i];
+            size_t  j     = i;
+            while (   j > iRun
+                   && pfnCmp(papvArray[j - 1], pvTmp, pvUser) > 0)
+            {
+                papvArray[j] = papvArray[j - 1];
+                j--;
+            }
+            papvArray[j] = pvTmp;
+        }
+    }
+
+    /* Merge them. */
+    void **papvSrc = papvArray;
+    void **papvDst = papvTmp;
+    for (size_t cWidth = RTSORT_MERGE_RUN; cWidth < cElements; cWidth *= 2)
+    {
+        for (size_t i = 0; i < cElements; i += 2 * cWidth)
+        {
+            size_t       iLeft     = i;
+            size_t const iLeftEnd  = RT_MIN(i + cWidth, cElements);
+            size_t       iRight    = iLeftEnd;
+            size_t const iRightEnd = RT_MIN(iLeftEnd + cWidth, cElements);
+            size_t       iDst      = i;
+            if (   iRight < iRightEnd
+                && pfnCmp(papvSrc[iLeftEnd - 1], papvSrc[iRight], pvUser) > 0)
+                while (iLeft < iLeftEnd && iRight < iRightEnd)
+                {
+                    if (pfnCmp(papvSrc[iRight], papvSrc[iLeft], pvUser) < 0)
+                        papvDst[iDst++] = papvSrc[iRight++];
+                    else
+                        papvDst[iDst++] = papvSrc[iLeft++];
+                }
+            while (iLeft < iLeftEnd)
+                papvDst[iDst++] = papvSrc[iLeft++];
+            while (iRight < iRightEnd)
+                papvDst[iDst++] = papvSrc[iRight++];
+        }
+        void **papvSwap = papvSrc;
+        papvSrc = papvDst;
+        papvDst = papvSwap;
+    }
+
+    if (papvSrc != papvArray)
+        memcpy(papvArray, papvSrc, cElements * sizeof(void *));
+    RTMemTmpFree(papvTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortApvMerge);
+
+
+/*********************************************************************************************************************************
+*   Parallel Sorting                                                                                                             *
+*********************************************************************************************************************************/
+
+/**
+ * Pool worker sorting one chunk.
+ */
+static DECLCALLBACK(void) rtSortParallelSortChunk(PRTSORTPARTASK pTask)
+{
+    rtSortMergeWorker(pTask->pbSrc, pTask->pbDst, pTask->cLeft, pTask->cbElement, pTask->pfnCmp, pTask->pvUser);
+}
+
+
+/**
+ * Pool worker merging two adjacent chunks.
+ */
+static DECLCALLBACK(void) rtSortParallelMergeChunks(PRTSORTPARTASK pTask)
+{
+    rtSortMergeRuns(pTask->pbSrc, pTask->cLeft, pTask->cRight, pTask->pbDst, pTask->cbElement, pTask->pfnCmp, pTask->pvUser);
+}
+
+
+/**
+ * Runs a batch of tasks, all but the last on the pool and the last one on the
+ * calling thread, then waits for all of them to complete.
+ *
+ * Should the pool refuse a task, it is executed on the calling thread.
+ */
+static void rtSortParallelRunBatch(RTREQPOOL hPool, PRTSORTPARTASK paTasks, size_t cTasks,
+                                   DECLCALLBACKMEMBER(void, pfnWorker)(PRTSORTPARTASK pTask))
+{
+    for (size_t i = 0; i + 1 < cTasks; i++)
+    {
+        paTasks[i].hReq = NIL_RTREQ;
+        int rc = RTReqPoolCallEx(hPool, 0 /*cMillies*/, &paTasks[i].hReq, RTREQFLAGS_VOID,
+                                 (PFNRT)pfnWorker, 1, &paTasks[i]);
+        if (rc != VERR_TIMEOUT && RT_FAILURE(rc))
+        {
+            if (paTasks[i].hReq != NIL_RTREQ)
+                RTReqRelease(paTasks[i].hReq);
+            paTasks[i].hReq = NIL_RTREQ;
+            pfnWorker(&paTasks[i]);
+        }
+    }
+
+    pfnWorker(&paTasks[cTasks - 1]);
+
+    for (size_t i = 0; i + 1 < cTasks; i++)
+        if (paTasks[i].hReq != NIL_RTREQ)
+        {
+            int rc = RTReqWait(paTasks[i].hReq, RT_INDEFINITE_WAIT);
+            AssertRC(rc);
+            RTReqRelease(paTasks[i].hReq);
+            paTasks[i].hReq = NIL_RTREQ;
+        }
+}
+
+
+RTDECL(int) RTSortParallel(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser,
+                           RTREQPOOL hPool)
+{
+    AssertReturn(cbElement > 0, VERR_INVALID_PARAMETER);
+
+    /*
+     * Figure out how many chunks to split the array into.  Small arrays and
+     * single CPU systems are handed straight to the serial merge sort.
+     */
+    size_t cChunks = RTMpGetOnlineCount();
+    cChunks = RT_MIN(cChunks, RTSORT_PARALLEL_MAX_CHUNKS);
+    cChunks = RT_MIN(cChunks, cElements / RTSORT_PARALLEL_MIN_CHUNK);
+    if (   cElements < RTSORT_PARALLEL_MIN_ELEMENTS
+        || cChunks < 2)
+        return RTSortMerge(pvArray, cElements, cbElement, pfnCmp, pvUser);
+
+    uint8_t *pbTmp = (uint8_t *)RTMemTmpAlloc(cElements * cbElement);
+    if (!pbTmp)
+        return VERR_NO_MEMORY;
+
+    RTSORTPARTASK aTasks[RTSORT_PARALLEL_MAX_CHUNKS];
+    size_t        aoffChunks[RTSORT_PARALLEL_MAX_CHUNKS + 1];
+
+    /*
+     * Use a private pool if the caller didn't supply one.
+     */
+    if (hPool == NIL_RTREQPOOL)
+    {
+        int rc = RTReqPoolCreate((uint32_t)cChunks, RT_MS_1SEC, UINT32_MAX /*cThreadsPushBackThreshold*/,
+                                 0 /*cMsMaxPushBack*/, "RTSort", &hPool);
+        if (RT_FAILURE(rc))
+        {
+            RTMemTmpFree(pbTmp);
+            return rc;
+        }
+    }
+    else
+        RTReqPoolRetain(hPool);
+
+    /*
+     * Sort the chunks.
+     */
+    uint8_t * const pbArray = (uint8_t *)pvArray;
+    for (size_t i = 0; i <= cChunks; i++)
+        aoffChunks[i] = cElements * i / cChunks;
+    for (size_t i = 0; i < cChunks; i++)
+    {
+        aTasks[i].pbSrc     = &pbArray[aoffChunks[i] * cbElement];
+        aTasks[i].pbDst     = &pbTmp[aoffChunks[i] * cbElement];
+        aTasks[i].cLeft     = aoffChunks[i + 1] - aoffChunks[i];
+        aTasks[i].cRight    = 0;
+        aTasks[i].cbElement = cbElement;
+        aTasks[i].pfnCmp    = pfnCmp;
+        aTasks[i].pvUser    = pvUser;
+    }
+    rtSortParallelRunBatch(hPool, aTasks, cChunks, rtSortParallelSortChunk);
+
+    /*
+     * Merge pairs of neighbouring chunks until there is only one left.  Odd
+     * chunks out are merged with nothing, i.e. copied to the other buffer.
+     */
+    uint8_t *pbSrc = pbArray;
+    uint8_t *pbDst = pbTmp;
+    size_t   cRuns = cChunks;
+    while (cRuns > 1)
+    {
+        size_t cTasks = 0;
+        for (size_t i = 0; i < cRuns; i += 2)
+        {
+            size_t const offStart = aoffChunks[i];
+            size_t const offMid   = aoffChunks[i + 1];
+            size_t const offEnd   = i + 2 <= cRuns ? aoffChunks[i + 2] : offMid;
+            aTasks[cTasks].pbSrc  = &pbSrc[offStart * cbElement];
+            aTasks[cTasks].pbDst  = &pbDst[offStart * cbElement];
+            aTasks[cTasks].cLeft  = offMid - offStart;
+            aTasks[cTasks].cRight = offEnd - offMid;
+            aoffChunks[cTasks + 1] = offEnd;
+            cTasks++;
+        }
+        rtSortParallelRunBatch(hPool, aTasks, cTasks, rtSortParallelMergeChunks);
+
+        cRuns = cTasks;
+        uint8_t *pbSwap = pbSrc;
+        pbSrc = pbDst;
+        pbDst = pbSwap;
+    }
+
+    if (pbSrc != pbArray)
+        memcpy(pbArray, pbSrc, cElements * cbElement);
+
+    RTReqPoolRelease(hPool);
+    RTMemTmpFree(pbTmp);
+    return VINF_SUCCESS;
+}
+RT_EXPORT_SYMBOL(RTSortParallel);
+
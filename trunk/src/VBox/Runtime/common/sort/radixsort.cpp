@@ -0,0 +1,160 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTSortRadixU32, RTSortRadixU64 - LSD radix sorting on integer keys.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include "internal/iprt.h"
+#include <iprt/sort.h>
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/string.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Number of key bits consumed per pass. */
+#define RTSORT_RADIX_BITS       8
+/** Number of buckets per pass. */
+#define RTSORT_RADIX_BUCKETS    (1 << RTSORT_RADIX_BITS)
+
+
+/**
+ * Reads the key of an element.  The key may be unaligned.
+ */
+DECLINLINE(uint64_t) rtSortRadixGetKey(uint8_t const *pbElement, size_t offKey, size_t cbKey)
+{
+    if (cbKey == sizeof(uint32_t))
+    {
+        uint32_t u32;
+        memcpy(&u32, pbElement + offKey, sizeof(u32));
+        return u32;
+    }
+    uint64_t u64;
+    memcpy(&u64, pbElement + offKey, sizeof(u64));
+    return u64;
+}
+
+
+/**
+ * Common worker for RTSortRadixU32 and RTSortRadixU64.
+ *
+ * Counts all the digit histograms in a single pass over the input, then does
+ * one scatter pass per digit, skipping digits that are the same for every
+ * element (common with small keys or pointers).
+ */
+static int rtSortRadix(void *pvArray, size_t cElements, size_t cbElement, size_t offKey, size_t cbKey)
+{
+    AssertReturn(cbElement >= offKey + cbKey, VERR_INVALID_PARAMETER);
+
+    /* Anything worth sorting? */
+    if (cElements < 2)
+        return VINF_SUCCESS;
+
+    unsigned const cPasses = (unsigned)(cbKey * 8 / RTSORT_RADIX_BITS);
+    size_t        *pacCounts = (size_t *)RTMemTmpAllocZ(sizeof(size_t) * RTSORT_RADIX_BUCKETS * cPasses);
+    uint8_t       *pbTmp     = (uint8_t *)RTMemTmpAlloc(cElements * cbElement);
+    if (!pacCounts || !pbTmp)
+    {
+        RTMemTmpFree(pacCounts);
+        RTMemTmpFree(pbTmp);
+        return VERR_NO_MEMORY;
+    }
+
+    /*
+     * Histograms.
+     */
+    uint8_t *pbSrc = (uint8_t *)pvArray;
+    for (size_t i = 0; i < cElements; i++)
+    {
+        uint64_t uKey = rtSortRadixGetKey(&pbSrc[i * cbElement], offKey, cbKey);
+        for (unsigned iPass = 0; iPass < cPasses; iPass++, uKey >>= RTSORT_RADIX_BITS)
+            pacCounts[iPass * RTSORT_RADIX_BUCKETS + (uKey & (RTSORT_RADIX_BUCKETS - 1))]++;
+    }
+
+    /*
+     * Scatter, least significant digit first.
+     */
+    uint8_t *pbDst = pbTmp;
+    for (unsigned iPass = 0; iPass < cPasses; iPass++)
+    {
+        size_t  *pacBucket = &pacCounts[iPass * RTSORT_RADIX_BUCKETS];
+        unsigned iBucket;
+        for (iBucket = 0; iBucket < RTSORT_RADIX_BUCKETS; iBucket++)
+            if (pacBucket[iBucket])
+                break;
+        if (pacBucket[iBucket] == cElements)
+            continue; /* all elements have the same digit */
+
+        /* Bucket counts -> starting offsets. */
+        size_t off = 0;
+        for (iBucket = 0; iBucket < RTSORT_RADIX_BUCKETS; iBucket++)
+        {
+            size_t const c = pacBucket[iBucket];
+            pacBucket[iBucket] = off;
+            off += c;
+        }
+
+        unsigned const cShift = iPass * RTSORT_RADIX_BITS;
+        for (size_t i = 0; i < cElements; i++)
+        {
+            uint8_t const *pbElement = &pbSrc[i * cbElement];
+            uint64_t const uKey      = rtSortRadixGetKey(pbElement, offKey, cbKey);
+            size_t const   iDst      = pacBucket[(uKey >> cShift) & (RTSORT_RADIX_BUCKETS - 1)]++;
+            memcpy(&pbDst[iDst * cbElement], pbElement, cbElement);
+        }
+
+        uint8_t *pbSwap = pbSrc;
+        pbSrc = pbDst;
+        pbDst = pbSwap;
+    }
+
+    if (pbSrc != (uint8_t *)pvArray)
+        memcpy(pvArray, pbSrc, cElements * cbElement);
+
+    RTMemTmpFree(pbTmp);
+    RTMemTmpFree(pacCounts);
+    return VINF_SUCCESS;
+}
+
+
+RTDECL(int) RTSortRadixU32(void *pvArray, size_t cElements, size_t cbElement, size_t offKey)
+{
+    return rtSortRadix(pvArray, cElements, cbElement, offKey, sizeof(uint32_t));
+}
+RT_EXPORT_SYMBOL(RTSortRadixU32);
+
+
+RTDECL(int) RTSortRadixU64(void *pvArray, size_t cElements, size_t cbElement, size_t offKey)
+{
+    return rtSortRadix(pvArray, cElements, cbElement, offKey, sizeof(uint64_t));
+}
+RT_EXPORT_SYMBOL(RTSortRadixU64);
+
@@ -386,7 +386,13 @@ static int rtUtf16CalcUtf8Length(PCRTUTF16 pwsz, size_t cwc, size_t *pcch)
         else if (wc < 0xd800 || wc > 0xdfff)
         {
             if (wc < 0x80)
-                cch++;
+            {
+                /* the rest of an ASCII run */
+                size_t const cwcAscii = rtUtf16AsciiRunLength(pwsz, cwc);
+                pwsz += cwcAscii;
+                cwc  -= cwcAscii;
+                cch  += 1 + cwcAscii;
+            }
             else if (wc < 0x800)
                 cch += 2;
             else if (wc < 0xfffe)
@@ -462,6 +468,14 @@ static int rtUtf16RecodeAsUtf8(PCRTUTF16 pwsz, size_t cwc, char *psz, size_t cch
                 }
                 cch--;
                 *pwch++ = (unsigned char)wc;
+
+                /* the rest of an ASCII run */
+                size_t const cwcAscii = rtUtf16AsciiRunLength(pwsz, RT_MIN(cwc, cch));
+                rtUtf16AsciiToUtf8(pwsz, cwcAscii, pwch);
+                pwsz += cwcAscii;
+                cwc  -= cwcAscii;
+                cch  -= cwcAscii;
+                pwch += cwcAscii;
             }
             else if (wc < 0x800)
             {
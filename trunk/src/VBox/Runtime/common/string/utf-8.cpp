@@ -159,9 +159,12 @@ DECLHIDDEN(int) rtUtf8Length(const char *psz, size_t cch, size_t *pcuc, size_t *
         }
         else
         {
-             /* one ASCII byte */
-            puch++;
-            cch--;
+            /* a run of ASCII bytes */
+            size_t const cchAscii = rtUtf8AsciiRunLength(puch, cch);
+            puch        += cchAscii;
+            cch         -= cchAscii;
+            cCodePoints += cchAscii;
+            continue;
         }
         cCodePoints++;
     }
@@ -552,10 +555,11 @@ static int rtUtf8CalcUtf16Length(const char *psz, size_t cch, size_t *pcwc)
             break;
         if (!(uch & RT_BIT(7)))
         {
-             /* one ASCII byte */
-            cwc++;
-            puch++;
-            cch--;
+            /* a run of ASCII bytes */
+            size_t const cchAscii = rtUtf8AsciiRunLength(puch, cch);
+            cwc  += cchAscii;
+            puch += cchAscii;
+            cch  -= cchAscii;
         }
         else
         {
@@ -702,9 +706,13 @@ static int rtUtf8RecodeAsUtf16(const char *psz, size_t cch, PRTUTF16 pwsz, size_
         /* decode and recode the code point */
         if (!(uch & RT_BIT(7)))
         {
-            *pwc++ = uch;
-            puch++;
-            cch--;
+            /* a run of ASCII bytes (cwc already accounts for the first one) */
+            size_t const cchAscii = rtUtf8AsciiRunLength(puch, RT_MIN(cch, cwc + 1));
+            rtUtf8AsciiToUtf16(puch, cchAscii, pwc);
+            pwc  += cchAscii;
+            puch += cchAscii;
+            cch  -= cchAscii;
+            cwc  -= cchAscii - 1;
         }
         else if ((uch & (RT_BIT(7) | RT_BIT(6) | RT_BIT(5))) == (RT_BIT(7) | RT_BIT(6)))
         {
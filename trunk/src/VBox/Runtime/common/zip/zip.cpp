@@ -35,6 +35,8 @@
 #define RTZIP_LZF_BLOCK_BY_BLOCK
 //#define RTZIP_USE_LZJB 1
 //#define RTZIP_USE_LZO 1
+//#define RTZIP_USE_ZSTD 1
+//#define RTZIP_USE_LZ4 1
 
 /** @todo FastLZ? QuickLZ? Others? */
 
@@ -58,11 +60,20 @@
 #ifdef RTZIP_USE_LZO
 # include <lzo/lzo1x.h>
 #endif
+#ifdef RTZIP_USE_ZSTD
+# include <zstd.h>
+# include <zstd_errors.h>
+#endif
+#ifdef RTZIP_USE_LZ4
+# include <lz4.h>
+# include <lz4hc.h>
+# include <lz4frame.h>
+#endif
 
 #include <iprt/zip.h>
 #include "internal/iprt.h"
 
-/*#include <iprt/asm.h>*/
+#include <iprt/asm.h>
 #include <iprt/alloc.h>
 #include <iprt/assert.h>
 #include <iprt/err.h>
@@ -176,6 +187,28 @@ typedef struct RTZIPCOMP
             uint8_t     abInput[RTZIPLZF_MAX_UNCOMPRESSED_DATA_SIZE];
         } LZF;
 #endif
+#ifdef RTZIP_USE_ZSTD
+        /** Zstandard stream. */
+        struct
+        {
+            /** The zstd compression stream. */
+            ZSTD_CStream       *pStream;
+            /** The output buffer descriptor (abBuffer). */
+            ZSTD_outBuffer      Out;
+        } Zstd;
+#endif
+#ifdef RTZIP_USE_LZ4
+        /** LZ4 frame stream. */
+        struct
+        {
+            /** The LZ4 frame compression context. */
+            LZ4F_cctx          *pCtx;
+            /** The frame preferences (needed for the bound calculations). */
+            LZ4F_preferences_t  Prefs;
+            /** The current output buffer offset. */
+            size_t              offOutput;
+        } LZ4;
+#endif
 
     } u;
 } RTZIPCOMP;
@@ -248,6 +281,32 @@ typedef struct RTZIPDECOMP
             uint8_t    *pbSpill;
         } LZF;
 #endif
+#ifdef RTZIP_USE_ZSTD
+        /** Zstandard stream. */
+        struct
+        {
+            /** The zstd decompression stream. */
+            ZSTD_DStream       *pStream;
+            /** The input buffer descriptor (abBuffer). */
+            ZSTD_inBuffer       In;
+            /** Set when the end of the frame has been reached. */
+            bool                fEndOfStream;
+        } Zstd;
+#endif
+#ifdef RTZIP_USE_LZ4
+        /** LZ4 frame stream. */
+        struct
+        {
+            /** The LZ4 frame decompression context. */
+            LZ4F_dctx          *pCtx;
+            /** The current input buffer offset. */
+            size_t              offInput;
+            /** The number of valid bytes in the input buffer. */
+            size_t              cbInput;
+            /** Set when the end of the frame has been reached. */
+            bool                fEndOfStream;
+        } LZ4;
+#endif
 
     } u;
 } RTZIPDECOM;
@@ -1351,6 +1410,419 @@ static DECLCALLBACK(int) rtZipLZFDecompInit(PRTZIPDECOMP pZip)
 #endif /* RTZIP_USE_LZF */
 
 
+#ifdef RTZIP_USE_ZSTD
+
+/**
+ * Converts a zstd error to an IPRT status code.
+ *
+ * @returns iprt status code.
+ * @param   rcZstd          The zstd return code (ZSTD_isError is true).
+ * @param   fCompressing    Set if we're compressing, clear if decompressing.
+ */
+static int zipErrConvertFromZstd(size_t rcZstd, bool fCompressing)
+{
+    switch (ZSTD_getErrorCode(rcZstd))
+    {
+        case ZSTD_error_memory_allocation:
+            return VERR_ZIP_NO_MEMORY;
+        case ZSTD_error_dstSize_tooSmall:
+            return VERR_BUFFER_OVERFLOW;
+        case ZSTD_error_version_unsupported:
+        case ZSTD_error_frameParameter_unsupported:
+            return VERR_ZIP_UNSUPPORTED_VERSION;
+        default:
+            return fCompressing ? VERR_ZIP_ERROR : VERR_ZIP_CORRUPTED;
+    }
+}
+
+
+/**
+ * Maps the IPRT compression level to a zstd one.
+ */
+static int rtZipZstdLevel(RTZIPLEVEL enmLevel)
+{
+    switch (enmLevel)
+    {
+        case RTZIPLEVEL_STORE:      return 1;
+        case RTZIPLEVEL_FAST:       return 1;
+        case RTZIPLEVEL_DEFAULT:    return 3;
+        case RTZIPLEVEL_MAX:        return 19;
+    }
+    return 3;
+}
+
+
+/**
+ * @copydoc RTZipCompress
+ */
+static DECLCALLBACK(int) rtZipZstdCompress(PRTZIPCOMP pZip, const void *pvBuf, size_t cbBuf)
+{
+    ZSTD_inBuffer In = { pvBuf, cbBuf, 0 };
+    while (In.pos < In.size)
+    {
+        /*
+         * Flush output buffer?
+         */
+        if (pZip->u.Zstd.Out.pos >= pZip->u.Zstd.Out.size)
+        {
+            int rc = pZip->pfnOut(pZip->pvUser, &pZip->abBuffer[0], pZip->u.Zstd.Out.pos);
+            if (RT_FAILURE(rc))
+                return rc;
+            pZip->u.Zstd.Out.pos = 0;
+        }
+
+        size_t rcZstd = ZSTD_compressStream(pZip->u.Zstd.pStream, &pZip->u.Zstd.Out, &In);
+        if (ZSTD_isError(rcZstd))
+            return zipErrConvertFromZstd(rcZstd, true /*fCompressing*/);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipCompFinish
+ */
+static DECLCALLBACK(int) rtZipZstdCompFinish(PRTZIPCOMP pZip)
+{
+    for (;;)
+    {
+        size_t cbLeft = ZSTD_endStream(pZip->u.Zstd.pStream, &pZip->u.Zstd.Out);
+        if (ZSTD_isError(cbLeft))
+            return zipErrConvertFromZstd(cbLeft, true /*fCompressing*/);
+
+        if (   pZip->u.Zstd.Out.pos > 0
+            && (cbLeft == 0 || pZip->u.Zstd.Out.pos >= pZip->u.Zstd.Out.size))
+        {
+            int rc = pZip->pfnOut(pZip->pvUser, &pZip->abBuffer[0], pZip->u.Zstd.Out.pos);
+            if (RT_FAILURE(rc))
+                return rc;
+            pZip->u.Zstd.Out.pos = 0;
+        }
+        if (cbLeft == 0)
+            return VINF_SUCCESS;
+    }
+}
+
+
+/**
+ * @copydoc RTZipCompDestroy
+ */
+static DECLCALLBACK(int) rtZipZstdCompDestroy(PRTZIPCOMP pZip)
+{
+    ZSTD_freeCStream(pZip->u.Zstd.pStream);
+    pZip->u.Zstd.pStream = NULL;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initializes the compressor instance.
+ * @returns iprt status code.
+ * @param   pZip        The compressor instance.
+ * @param   enmLevel    The desired compression level.
+ */
+static DECLCALLBACK(int) rtZipZstdCompInit(PRTZIPCOMP pZip, RTZIPLEVEL enmLevel)
+{
+    pZip->pfnCompress = rtZipZstdCompress;
+    pZip->pfnFinish   = rtZipZstdCompFinish;
+    pZip->pfnDestroy  = rtZipZstdCompDestroy;
+
+    pZip->u.Zstd.Out.dst  = &pZip->abBuffer[0];
+    pZip->u.Zstd.Out.size = sizeof(pZip->abBuffer);
+    pZip->u.Zstd.Out.pos  = 1;          /* the type byte */
+
+    pZip->u.Zstd.pStream = ZSTD_createCStream();
+    if (!pZip->u.Zstd.pStream)
+        return VERR_ZIP_NO_MEMORY;
+    size_t rcZstd = ZSTD_initCStream(pZip->u.Zstd.pStream, rtZipZstdLevel(enmLevel));
+    if (ZSTD_isError(rcZstd))
+    {
+        ZSTD_freeCStream(pZip->u.Zstd.pStream);
+        pZip->u.Zstd.pStream = NULL;
+        return zipErrConvertFromZstd(rcZstd, true /*fCompressing*/);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipDecompress
+ */
+static DECLCALLBACK(int) rtZipZstdDecompress(PRTZIPDECOMP pZip, void *pvBuf, size_t cbBuf, size_t *pcbWritten)
+{
+    ZSTD_outBuffer Out = { pvBuf, cbBuf, 0 };
+    while (Out.pos < Out.size && !pZip->u.Zstd.fEndOfStream)
+    {
+        /*
+         * Read more input?
+         */
+        if (pZip->u.Zstd.In.pos >= pZip->u.Zstd.In.size)
+        {
+            size_t cb = sizeof(pZip->abBuffer);
+            int rc = pZip->pfnIn(pZip->pvUser, &pZip->abBuffer[0], sizeof(pZip->abBuffer), &cb);
+            if (RT_FAILURE(rc))
+                return rc;
+            if (!cb)
+                return VERR_ZIP_CORRUPTED;
+            pZip->u.Zstd.In.size = cb;
+            pZip->u.Zstd.In.pos  = 0;
+        }
+
+        size_t rcZstd = ZSTD_decompressStream(pZip->u.Zstd.pStream, &Out, &pZip->u.Zstd.In);
+        if (ZSTD_isError(rcZstd))
+            return zipErrConvertFromZstd(rcZstd, false /*fCompressing*/);
+        if (rcZstd == 0)
+            pZip->u.Zstd.fEndOfStream = true;
+    }
+
+    if (pcbWritten)
+        *pcbWritten = Out.pos;
+    else if (Out.pos < cbBuf)
+        return VERR_NO_DATA;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipDecompDestroy
+ */
+static DECLCALLBACK(int) rtZipZstdDecompDestroy(PRTZIPDECOMP pZip)
+{
+    ZSTD_freeDStream(pZip->u.Zstd.pStream);
+    pZip->u.Zstd.pStream = NULL;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initialize the decompressor instance.
+ * @returns iprt status code.
+ * @param   pZip        The decompressor instance.
+ */
+static DECLCALLBACK(int) rtZipZstdDecompInit(PRTZIPDECOMP pZip)
+{
+    pZip->pfnDecompress = rtZipZstdDecompress;
+    pZip->pfnDestroy    = rtZipZstdDecompDestroy;
+
+    pZip->u.Zstd.In.src       = &pZip->abBuffer[0];
+    pZip->u.Zstd.In.size      = 0;
+    pZip->u.Zstd.In.pos       = 0;
+    pZip->u.Zstd.fEndOfStream = false;
+
+    pZip->u.Zstd.pStream = ZSTD_createDStream();
+    if (!pZip->u.Zstd.pStream)
+        return VERR_ZIP_NO_MEMORY;
+    size_t rcZstd = ZSTD_initDStream(pZip->u.Zstd.pStream);
+    if (ZSTD_isError(rcZstd))
+    {
+        ZSTD_freeDStream(pZip->u.Zstd.pStream);
+        pZip->u.Zstd.pStream = NULL;
+        return zipErrConvertFromZstd(rcZstd, false /*fCompressing*/);
+    }
+    return VINF_SUCCESS;
+}
+
+
+/** Cached block compression context, see RTZipBlockCompress. */
+static ZSTD_CCtx * volatile g_pZstdBlockCCtx = NULL;
+/** Cached block decompression context, see RTZipBlockDecompress. */
+static ZSTD_DCtx * volatile g_pZstdBlockDCtx = NULL;
+
+#endif /* RTZIP_USE_ZSTD */
+
+
+#ifdef RTZIP_USE_LZ4
+
+/** The max amount of input we feed LZ4F_compressUpdate in one go.  With
+ * auto flushing enabled the output bound for this fits in abBuffer. */
+# define RTZIPLZ4_MAX_INPUT_CHUNK   _64K
+
+/**
+ * Flushes the LZ4 output buffer.
+ */
+static int rtZipLZ4CompFlushOutput(PRTZIPCOMP pZip)
+{
+    int rc = VINF_SUCCESS;
+    if (pZip->u.LZ4.offOutput > 0)
+        rc = pZip->pfnOut(pZip->pvUser, &pZip->abBuffer[0], pZip->u.LZ4.offOutput);
+    pZip->u.LZ4.offOutput = 0;
+    return rc;
+}
+
+
+/**
+ * @copydoc RTZipCompress
+ */
+static DECLCALLBACK(int) rtZipLZ4Compress(PRTZIPCOMP pZip, const void *pvBuf, size_t cbBuf)
+{
+    const uint8_t *pbBuf = (const uint8_t *)pvBuf;
+    while (cbBuf > 0)
+    {
+        size_t const cbChunk = RT_MIN(cbBuf, RTZIPLZ4_MAX_INPUT_CHUNK);
+        if (sizeof(pZip->abBuffer) - pZip->u.LZ4.offOutput < LZ4F_compressBound(cbChunk, &pZip->u.LZ4.Prefs))
+        {
+            int rc = rtZipLZ4CompFlushOutput(pZip);
+            if (RT_FAILURE(rc))
+                return rc;
+        }
+
+        size_t cbOut = LZ4F_compressUpdate(pZip->u.LZ4.pCtx, &pZip->abBuffer[pZip->u.LZ4.offOutput],
+                                           sizeof(pZip->abBuffer) - pZip->u.LZ4.offOutput, pbBuf, cbChunk, NULL);
+        if (LZ4F_isError(cbOut))
+            return VERR_ZIP_ERROR;
+        pZip->u.LZ4.offOutput += cbOut;
+        pbBuf += cbChunk;
+        cbBuf -= cbChunk;
+    }
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipCompFinish
+ */
+static DECLCALLBACK(int) rtZipLZ4CompFinish(PRTZIPCOMP pZip)
+{
+    if (sizeof(pZip->abBuffer) - pZip->u.LZ4.offOutput < LZ4F_compressBound(0, &pZip->u.LZ4.Prefs))
+    {
+        int rc = rtZipLZ4CompFlushOutput(pZip);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
+
+    size_t cbOut = LZ4F_compressEnd(pZip->u.LZ4.pCtx, &pZip->abBuffer[pZip->u.LZ4.offOutput],
+                                    sizeof(pZip->abBuffer) - pZip->u.LZ4.offOutput, NULL);
+    if (LZ4F_isError(cbOut))
+        return VERR_ZIP_ERROR;
+    pZip->u.LZ4.offOutput += cbOut;
+    return rtZipLZ4CompFlushOutput(pZip);
+}
+
+
+/**
+ * @copydoc RTZipCompDestroy
+ */
+static DECLCALLBACK(int) rtZipLZ4CompDestroy(PRTZIPCOMP pZip)
+{
+    LZ4F_freeCompressionContext(pZip->u.LZ4.pCtx);
+    pZip->u.LZ4.pCtx = NULL;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initializes the compressor instance.
+ * @returns iprt status code.
+ * @param   pZip        The compressor instance.
+ * @param   enmLevel    The desired compression level.
+ */
+static DECLCALLBACK(int) rtZipLZ4CompInit(PRTZIPCOMP pZip, RTZIPLEVEL enmLevel)
+{
+    pZip->pfnCompress = rtZipLZ4Compress;
+    pZip->pfnFinish   = rtZipLZ4CompFinish;
+    pZip->pfnDestroy  = rtZipLZ4CompDestroy;
+
+    RT_ZERO(pZip->u.LZ4.Prefs);
+    pZip->u.LZ4.Prefs.frameInfo.blockSizeID         = LZ4F_max64KB;
+    pZip->u.LZ4.Prefs.frameInfo.contentChecksumFlag = LZ4F_contentChecksumEnabled;
+    pZip->u.LZ4.Prefs.autoFlush                     = 1;
+    pZip->u.LZ4.Prefs.compressionLevel              = enmLevel == RTZIPLEVEL_MAX ? LZ4HC_CLEVEL_DEFAULT : 0;
+
+    LZ4F_errorCode_t rcLz4 = LZ4F_createCompressionContext(&pZip->u.LZ4.pCtx, LZ4F_VERSION);
+    if (LZ4F_isError(rcLz4))
+        return VERR_ZIP_NO_MEMORY;
+
+    /* The frame header goes after the type byte. */
+    size_t cbHdr = LZ4F_compressBegin(pZip->u.LZ4.pCtx, &pZip->abBuffer[1], sizeof(pZip->abBuffer) - 1, &pZip->u.LZ4.Prefs);
+    if (LZ4F_isError(cbHdr))
+    {
+        LZ4F_freeCompressionContext(pZip->u.LZ4.pCtx);
+        pZip->u.LZ4.pCtx = NULL;
+        return VERR_ZIP_ERROR;
+    }
+    pZip->u.LZ4.offOutput = 1 + cbHdr;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipDecompress
+ */
+static DECLCALLBACK(int) rtZipLZ4Decompress(PRTZIPDECOMP pZip, void *pvBuf, size_t cbBuf, size_t *pcbWritten)
+{
+    uint8_t *pbBuf  = (uint8_t *)pvBuf;
+    size_t   offBuf = 0;
+    while (offBuf < cbBuf && !pZip->u.LZ4.fEndOfStream)
+    {
+        /*
+         * Read more input?
+         */
+        if (pZip->u.LZ4.offInput >= pZip->u.LZ4.cbInput)
+        {
+            size_t cb = sizeof(pZip->abBuffer);
+            int rc = pZip->pfnIn(pZip->pvUser, &pZip->abBuffer[0], sizeof(pZip->abBuffer), &cb);
+            if (RT_FAILURE(rc))
+                return rc;
+            if (!cb)
+                return VERR_ZIP_CORRUPTED;
+            pZip->u.LZ4.cbInput  = cb;
+            pZip->u.LZ4.offInput = 0;
+        }
+
+        size_t cbDst  = cbBuf - offBuf;
+        size_t cbSrc  = pZip->u.LZ4.cbInput - pZip->u.LZ4.offInput;
+        size_t cbHint = LZ4F_decompress(pZip->u.LZ4.pCtx, &pbBuf[offBuf], &cbDst,
+                                        &pZip->abBuffer[pZip->u.LZ4.offInput], &cbSrc, NULL);
+        if (LZ4F_isError(cbHint))
+            return VERR_ZIP_CORRUPTED;
+        offBuf               += cbDst;
+        pZip->u.LZ4.offInput += cbSrc;
+        if (cbHint == 0)
+            pZip->u.LZ4.fEndOfStream = true;
+    }
+
+    if (pcbWritten)
+        *pcbWritten = offBuf;
+    else if (offBuf < cbBuf)
+        return VERR_NO_DATA;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * @copydoc RTZipDecompDestroy
+ */
+static DECLCALLBACK(int) rtZipLZ4DecompDestroy(PRTZIPDECOMP pZip)
+{
+    LZ4F_freeDecompressionContext(pZip->u.LZ4.pCtx);
+    pZip->u.LZ4.pCtx = NULL;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Initialize the decompressor instance.
+ * @returns iprt status code.
+ * @param   pZip        The decompressor instance.
+ */
+static DECLCALLBACK(int) rtZipLZ4DecompInit(PRTZIPDECOMP pZip)
+{
+    pZip->pfnDecompress = rtZipLZ4Decompress;
+    pZip->pfnDestroy    = rtZipLZ4DecompDestroy;
+
+    pZip->u.LZ4.offInput     = 0;
+    pZip->u.LZ4.cbInput      = 0;
+    pZip->u.LZ4.fEndOfStream = false;
+
+    LZ4F_errorCode_t rcLz4 = LZ4F_createDecompressionContext(&pZip->u.LZ4.pCtx, LZ4F_VERSION);
+    if (LZ4F_isError(rcLz4))
+        return VERR_ZIP_NO_MEMORY;
+    return VINF_SUCCESS;
+}
+
+#endif /* RTZIP_USE_LZ4 */
+
+
 /**
  * Create a compressor instance.
  *
@@ -1437,6 +1909,18 @@ RTDECL(int)     RTZipCompCreate(PRTZIPCOMP *ppZip, void *pvUser, PFNRTZIPOUT pfn
 #endif
             break;
 
+        case RTZIPTYPE_ZSTD:
+#ifdef RTZIP_USE_ZSTD
+            rc = rtZipZstdCompInit(pZip, enmLevel);
+#endif
+            break;
+
+        case RTZIPTYPE_LZ4:
+#ifdef RTZIP_USE_LZ4
+            rc = rtZipLZ4CompInit(pZip, enmLevel);
+#endif
+            break;
+
         case RTZIPTYPE_LZJB:
         case RTZIPTYPE_LZO:
             break;
@@ -1638,6 +2122,22 @@ static int rtzipDecompInit(PRTZIPDECOMP pZip)
 #endif
             break;
 
+        case RTZIPTYPE_ZSTD:
+#ifdef RTZIP_USE_ZSTD
+            rc = rtZipZstdDecompInit(pZip);
+#else
+            AssertMsgFailed(("Zstandard is not include in this build!\n"));
+#endif
+            break;
+
+        case RTZIPTYPE_LZ4:
+#ifdef RTZIP_USE_LZ4
+            rc = rtZipLZ4DecompInit(pZip);
+#else
+            AssertMsgFailed(("LZ4 is not include in this build!\n"));
+#endif
+            break;
+
         default:
             AssertMsgFailed(("Invalid compression type %d (%#x)!\n", pZip->enmType, pZip->enmType));
             rc = VERR_INVALID_MAGIC;
@@ -1816,6 +2316,49 @@ RTDECL(int) RTZipBlockCompress(RTZIPTYPE enmType, RTZIPLEVEL enmLevel, uint32_t
 #endif
         }
 
+        case RTZIPTYPE_ZSTD:
+        {
+#ifdef RTZIP_USE_ZSTD
+            /* Creating a context costs more than compressing a page, so keep one around. */
+            ZSTD_CCtx *pCCtx = ASMAtomicXchgPtrT(&g_pZstdBlockCCtx, NULL, ZSTD_CCtx *);
+            if (!pCCtx)
+            {
+                pCCtx = ZSTD_createCCtx();
+                if (RT_UNLIKELY(!pCCtx))
+                    return VERR_ZIP_NO_MEMORY;
+            }
+            size_t cbDstActual = ZSTD_compressCCtx(pCCtx, pvDst, cbDst, pvSrc, cbSrc, rtZipZstdLevel(enmLevel));
+            if (!ASMAtomicCmpXchgPtr(&g_pZstdBlockCCtx, pCCtx, NULL))
+                ZSTD_freeCCtx(pCCtx);
+            if (RT_UNLIKELY(ZSTD_isError(cbDstActual)))
+                return zipErrConvertFromZstd(cbDstActual, true /*fCompressing*/);
+            *pcbDstActual = cbDstActual;
+            break;
+#else
+            return VERR_NOT_SUPPORTED;
+#endif
+        }
+
+        case RTZIPTYPE_LZ4:
+        {
+#ifdef RTZIP_USE_LZ4
+            AssertReturn(cbSrc <= (size_t)LZ4_MAX_INPUT_SIZE, VERR_TOO_MUCH_DATA);
+            int const cbDstMax = (int)RT_MIN(cbDst, (size_t)INT32_MAX);
+            int cbDstActual;
+            if (enmLevel == RTZIPLEVEL_MAX)
+                cbDstActual = LZ4_compress_HC((const char *)pvSrc, (char *)pvDst, (int)cbSrc, cbDstMax, LZ4HC_CLEVEL_DEFAULT);
+            else
+                cbDstActual = LZ4_compress_fast((const char *)pvSrc, (char *)pvDst, (int)cbSrc, cbDstMax,
+                                                enmLevel == RTZIPLEVEL_FAST ? 4 : 1 /*acceleration*/);
+            if (RT_UNLIKELY(cbDstActual <= 0))
+                return VERR_BUFFER_OVERFLOW;
+            *pcbDstActual = (size_t)cbDstActual;
+            break;
+#else
+            return VERR_NOT_SUPPORTED;
+#endif
+        }
+
         case RTZIPTYPE_ZLIB:
         case RTZIPTYPE_BZLIB:
             return VERR_NOT_SUPPORTED;
@@ -1972,6 +2515,49 @@ RTDECL(int) RTZipBlockDecompress(RTZIPTYPE enmType, uint32_t fFlags,
 #endif
         }
 
+        case RTZIPTYPE_ZSTD:
+        {
+#ifdef RTZIP_USE_ZSTD
+            ZSTD_DCtx *pDCtx = ASMAtomicXchgPtrT(&g_pZstdBlockDCtx, NULL, ZSTD_DCtx *);
+            if (!pDCtx)
+            {
+                pDCtx = ZSTD_createDCtx();
+                if (RT_UNLIKELY(!pDCtx))
+                    return VERR_ZIP_NO_MEMORY;
+            }
+            size_t cbDstActual = ZSTD_decompressDCtx(pDCtx, pvDst, cbDst, pvSrc, cbSrc);
+            if (!ASMAtomicCmpXchgPtr(&g_pZstdBlockDCtx, pDCtx, NULL))
+                ZSTD_freeDCtx(pDCtx);
+            if (RT_UNLIKELY(ZSTD_isError(cbDstActual)))
+                return zipErrConvertFromZstd(cbDstActual, false /*fCompressing*/);
+            if (pcbSrcActual)
+                *pcbSrcActual = cbSrc;
+            if (pcbDstActual)
+                *pcbDstActual = cbDstActual;
+            break;
+#else
+            return VERR_NOT_SUPPORTED;
+#endif
+        }
+
+        case RTZIPTYPE_LZ4:
+        {
+#ifdef RTZIP_USE_LZ4
+            AssertReturn(cbSrc <= (size_t)INT32_MAX, VERR_TOO_MUCH_DATA);
+            int cbDstActual = LZ4_decompress_safe((const char *)pvSrc, (char *)pvDst, (int)cbSrc,
+                                                  (int)RT_MIN(cbDst, (size_t)INT32_MAX));
+            if (RT_UNLIKELY(cbDstActual < 0))
+                return VERR_ZIP_CORRUPTED; /* LZ4 doesn't tell a too small buffer from bad input. */
+            if (pcbSrcActual)
+                *pcbSrcActual = cbSrc;
+            if (pcbDstActual)
+                *pcbDstActual = (size_t)cbDstActual;
+            break;
+#else
+            return VERR_NOT_SUPPORTED;
+#endif
+        }
+
         case RTZIPTYPE_BZLIB:
             return VERR_NOT_SUPPORTED;
 
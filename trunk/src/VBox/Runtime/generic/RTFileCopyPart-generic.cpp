@@ -0,0 +1,65 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTFileCopyPart and RTFileClone, generic implementation.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/assert.h>
+#include <iprt/err.h>
+#include <iprt/file.h>
+
+#include "internal/iprt.h"
+
+
+RTDECL(int) RTFileCopyPart(RTFILE hFileSrc, RTFOFF offSrc, RTFILE hFileDst, RTFOFF offDst, uint64_t cbToCopy,
+                           uint32_t fFlags, uint64_t *pcbCopied)
+{
+    /*
+     * Quick validation.
+     */
+    AssertReturn(hFileSrc != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertReturn(hFileDst != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertReturn(!fFlags, VERR_INVALID_FLAGS);
+    AssertPtrReturn(pcbCopied, VERR_INVALID_POINTER);
+
+    NOREF(offSrc); NOREF(offDst); NOREF(cbToCopy);
+    *pcbCopied = 0;
+
+    return VERR_NOT_SUPPORTED;
+}
+RT_EXPORT_SYMBOL(RTFileCopyPart);
+
+
+RTDECL(int) RTFileClone(RTFILE hFileSrc, RTFILE hFileDst)
+{
+    AssertReturn(hFileSrc != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertReturn(hFileDst != NIL_RTFILE, VERR_INVALID_HANDLE);
+
+    return VERR_NOT_SUPPORTED;
+}
+RT_EXPORT_SYMBOL(RTFileClone);
+
@@ -968,7 +968,7 @@ RTDECL(int) RTEnvQueryUtf16Block(RTENV hEnv, PRTUTF16 *ppwszzBlock)
     /*
      * Sort it first.
      */
-    RTSortApvShell((void **)pIntEnv->papszEnv, pIntEnv->cVars, rtEnvSortCompare, pIntEnv);
+    RTSortApv((void **)pIntEnv->papszEnv, pIntEnv->cVars, rtEnvSortCompare, pIntEnv);
 
     /*
      * Calculate the size.
@@ -1065,7 +1065,7 @@ RTDECL(int) RTEnvQueryUtf8Block(RTENV hEnv, bool fSorted, char **ppszzBlock, siz
      * Sort it, if requested.
      */
     if (fSorted)
-        RTSortApvShell((void **)pIntEnv->papszEnv, pIntEnv->cVars, rtEnvSortCompare, pIntEnv);
+        RTSortApv((void **)pIntEnv->papszEnv, pIntEnv->cVars, rtEnvSortCompare, pIntEnv);
 
     /*
      * Calculate the size. We add one extra terminator just to be on the safe side.
@@ -235,9 +235,12 @@ typedef struct RTDBGMODVTIMG
      * @param   enmProp         The property to query.
      * @param   pvBuf           Pointer to the return buffer.
      * @param   cbBuf           The size of the return buffer.
-     * @sa      RTLdrQueryProp
+     * @param   pcbRet          How many bytes was actually returned.  In the
+     *                          case of VERR_BUFFER_OVERFLOW this will contain
+     *                          the required buffer size.  Optional.
+     * @sa      RTLdrQueryPropEx
      */
-    DECLCALLBACKMEMBER(int, pfnQueryProp)(PRTDBGMODINT pMod, RTLDRPROP enmProp, void *pvBuf, size_t cbBuf);
+    DECLCALLBACKMEMBER(int, pfnQueryProp)(PRTDBGMODINT pMod, RTLDRPROP enmProp, void *pvBuf, size_t cbBuf, size_t *pcbRet);
 
     /** For catching initialization errors (RTDBGMODVTIMG_MAGIC). */
     uint32_t    u32EndMagic;
@@ -664,6 +667,22 @@ DECLHIDDEN(int) rtDbgModDeferredCreate(PRTDBGMODINT pDbgMod, PFNRTDBGMODDEFERRED
 
 DECLHIDDEN(int) rtDbgModLdrOpenFromHandle(PRTDBGMODINT pDbgMod, RTLDRMOD hLdrMod);
 
+/** Pointer to a loaded symbol index cache (dbgmodidx.cpp). */
+typedef struct RTDBGMODIDX *PRTDBGMODIDX;
+DECLHIDDEN(int)      rtDbgModIdxQueryCachePath(const char *pszName, void const *pvKey, size_t cbKey, char *pszPath, size_t cbPath);
+DECLHIDDEN(int)      rtDbgModIdxOpen(const char *pszPath, void const *pvKey, size_t cbKey, RTDBGMOD hCnt, PRTDBGMODIDX *ppIdx);
+DECLHIDDEN(void)     rtDbgModIdxClose(PRTDBGMODIDX pIdx);
+DECLHIDDEN(int)      rtDbgModIdxWrite(const char *pszPath, void const *pvKey, size_t cbKey, RTDBGMOD hCnt);
+DECLHIDDEN(uint32_t) rtDbgModIdxSymbolCount(PRTDBGMODIDX pIdx);
+DECLHIDDEN(int)      rtDbgModIdxSymbolByOrdinal(PRTDBGMODIDX pIdx, uint32_t iOrdinal, PRTDBGSYMBOL pSymInfo);
+DECLHIDDEN(int)      rtDbgModIdxSymbolByName(PRTDBGMODIDX pIdx, const char *pszSymbol, PRTDBGSYMBOL pSymInfo);
+DECLHIDDEN(int)      rtDbgModIdxSymbolByAddr(PRTDBGMODIDX pIdx, RTDBGSEGIDX iSeg, RTUINTPTR off, uint32_t fFlags,
+                                             PRTINTPTR poffDisp, PRTDBGSYMBOL pSymInfo);
+DECLHIDDEN(uint32_t) rtDbgModIdxLineCount(PRTDBGMODIDX pIdx);
+DECLHIDDEN(int)      rtDbgModIdxLineByOrdinal(PRTDBGMODIDX pIdx, uint32_t iOrdinal, PRTDBGLINE pLineInfo);
+DECLHIDDEN(int)      rtDbgModIdxLineByAddr(PRTDBGMODIDX pIdx, RTDBGSEGIDX iSeg, RTUINTPTR off, PRTINTPTR poffDisp,
+                                           PRTDBGLINE pLineInfo);
+
 /** @} */
 
 RT_C_DECLS_END
@@ -312,6 +312,9 @@ typedef struct {
 #define NT_VBOXCPU  0xb01
 #endif
 
+/* GNU specific NOTE types (n_name "GNU"). */
+#define NT_GNU_BUILD_ID	3	/* Unique build ID bits, as generated by ld --build-id. */
+
 /* Symbol Binding - ELFNN_ST_BIND - st_info */
 #define STB_LOCAL	0	/* Local symbol */
 #define STB_GLOBAL	1	/* Global symbol */
@@ -80,6 +80,154 @@ DECLHIDDEN(int) rtStrConvert(const char *pchInput, size_t cchInput, const char *
 DECLHIDDEN(const char *) rtStrGetLocaleCodeset(void);
 DECLHIDDEN(int) rtUtf8Length(const char *psz, size_t cch, size_t *pcuc, size_t *pcchActual);
 
+
+/** @def RTSTR_WITH_SSE2
+ * Use SSE2 for scanning and converting runs of ASCII characters.  SSE2 is
+ * part of the AMD64 base architecture, so no CPUID check is needed.  Kernel
+ * contexts must not touch the vector registers without saving them first. */
+#if defined(RT_ARCH_AMD64) && defined(IN_RING3) && (defined(__GNUC__) || defined(_MSC_VER)) && !defined(DOXYGEN_RUNNING)
+# define RTSTR_WITH_SSE2
+RT_C_DECLS_END
+# include <emmintrin.h>
+# include <iprt/asm.h>
+RT_C_DECLS_BEGIN
+#endif
+
+
+/**
+ * Gets the length of the run of non-zero ASCII characters (1..0x7f) at the
+ * start of an UTF-8 string.
+ *
+ * The SSE2 variant may read beyond @a cchMax and the terminator, but never
+ * across an 16 byte alignment boundary and thus never into another page.
+ *
+ * @returns Number of ASCII bytes, at most @a cchMax.
+ * @param   puch        The string.
+ * @param   cchMax      The max number of bytes to look at.
+ */
+DECLINLINE(size_t) rtUtf8AsciiRunLength(const unsigned char *puch, size_t cchMax)
+{
+    size_t off = 0;
+#ifdef RTSTR_WITH_SSE2
+    while ((uintptr_t)&puch[off] & 15)
+    {
+        if (off >= cchMax || puch[off] - 1U >= 0x7fU)
+            return RT_MIN(off, cchMax);
+        off++;
+    }
+    __m128i const Zero = _mm_setzero_si128();
+    while (off < cchMax)
+    {
+        __m128i const  Chunk = _mm_load_si128((__m128i const *)&puch[off]);
+        uint32_t const fStop = (uint32_t)_mm_movemask_epi8(Chunk) | (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(Chunk, Zero));
+        if (fStop)
+        {
+            off += ASMBitFirstSetU32(fStop) - 1;
+            break;
+        }
+        off += 16;
+    }
+    return RT_MIN(off, cchMax);
+#else
+    while (off < cchMax && puch[off] - 1U < 0x7fU)
+        off++;
+    return off;
+#endif
+}
+
+
+/**
+ * Widens a run of ASCII characters to UTF-16.
+ *
+ * @param   puch        The ASCII characters, see rtUtf8AsciiRunLength.
+ * @param   cch         The number of characters.
+ * @param   pwc         Where to store the UTF-16 characters (no terminator).
+ */
+DECLINLINE(void) rtUtf8AsciiToUtf16(const unsigned char *puch, size_t cch, PRTUTF16 pwc)
+{
+    size_t off = 0;
+#ifdef RTSTR_WITH_SSE2
+    __m128i const Zero = _mm_setzero_si128();
+    for (; off + 16 <= cch; off += 16)
+    {
+        __m128i const Chunk = _mm_loadu_si128((__m128i const *)&puch[off]);
+        _mm_storeu_si128((__m128i *)&pwc[off],     _mm_unpacklo_epi8(Chunk, Zero));
+        _mm_storeu_si128((__m128i *)&pwc[off + 8], _mm_unpackhi_epi8(Chunk, Zero));
+    }
+#endif
+    for (; off < cch; off++)
+        pwc[off] = puch[off];
+}
+
+
+/**
+ * Gets the length of the run of non-zero ASCII characters (1..0x7f) at the
+ * start of an UTF-16 string.
+ *
+ * Same read-ahead rules as rtUtf8AsciiRunLength.
+ *
+ * @returns Number of ASCII characters, at most @a cwcMax.
+ * @param   pwsz        The string.
+ * @param   cwcMax      The max number of RTUTF16 characters to look at.
+ */
+DECLINLINE(size_t) rtUtf16AsciiRunLength(PCRTUTF16 pwsz, size_t cwcMax)
+{
+    size_t off = 0;
+#ifdef RTSTR_WITH_SSE2
+    if (!((uintptr_t)pwsz & 1))
+    {
+        while ((uintptr_t)&pwsz[off] & 15)
+        {
+            if (off >= cwcMax || pwsz[off] - 1U >= 0x7fU)
+                return RT_MIN(off, cwcMax);
+            off++;
+        }
+        __m128i const Zero     = _mm_setzero_si128();
+        __m128i const NonAscii = _mm_set1_epi16((short)0xff80);
+        while (off < cwcMax)
+        {
+            __m128i const  Chunk = _mm_load_si128((__m128i const *)&pwsz[off]);
+            __m128i const  Ok    = _mm_andnot_si128(_mm_cmpeq_epi16(Chunk, Zero),
+                                                    _mm_cmpeq_epi16(_mm_and_si128(Chunk, NonAscii), Zero));
+            uint32_t const fStop = ~(uint32_t)_mm_movemask_epi8(Ok) & 0xffff;
+            if (fStop)
+            {
+                off += (ASMBitFirstSetU32(fStop) - 1) / 2;
+                break;
+            }
+            off += 8;
+        }
+        return RT_MIN(off, cwcMax);
+    }
+#endif
+    while (off < cwcMax && pwsz[off] - 1U < 0x7fU)
+        off++;
+    return off;
+}
+
+
+/**
+ * Narrows a run of ASCII UTF-16 characters to UTF-8.
+ *
+ * @param   pwsz        The ASCII characters, see rtUtf16AsciiRunLength.
+ * @param   cwc         The number of characters.
+ * @param   puch        Where to store the UTF-8 characters (no terminator).
+ */
+DECLINLINE(void) rtUtf16AsciiToUtf8(PCRTUTF16 pwsz, size_t cwc, unsigned char *puch)
+{
+    size_t off = 0;
+#ifdef RTSTR_WITH_SSE2
+    for (; off + 16 <= cwc; off += 16)
+    {
+        __m128i const Lo = _mm_loadu_si128((__m128i const *)&pwsz[off]);
+        __m128i const Hi = _mm_loadu_si128((__m128i const *)&pwsz[off + 8]);
+        _mm_storeu_si128((__m128i *)&puch[off], _mm_packus_epi16(Lo, Hi));
+    }
+#endif
+    for (; off < cwc; off++)
+        puch[off] = (unsigned char)pwsz[off];
+}
+
 DECLHIDDEN(int) rtStrToIpAddr6Str(const char *psz, char *pszAddrOut, size_t addrOutSize, char *pszPortOut, size_t portOutSize, bool followRfc);
 
 RT_C_DECLS_END
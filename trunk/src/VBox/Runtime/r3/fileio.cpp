@@ -32,6 +32,7 @@
 #include <iprt/file.h>
 
 #include <iprt/mem.h>
+#include <iprt/asm.h>
 #include <iprt/assert.h>
 #include <iprt/alloca.h>
 #include <iprt/string.h>
@@ -422,6 +423,36 @@ RTDECL(int) RTFileCopyEx(const char *pszSrc, const char *pszDst, uint32_t fFlags
 }
 
 
+/**
+ * Progress reporting state for RTFileCopyByHandlesEx.
+ */
+typedef struct RTFILECOPYPROGRESS
+{
+    PFNRTPROGRESS   pfnProgress;
+    void           *pvUser;
+    unsigned        uPercentage;
+    uint64_t        cbPercent;
+    uint64_t        offNextPercent;
+} RTFILECOPYPROGRESS;
+typedef RTFILECOPYPROGRESS *PRTFILECOPYPROGRESS;
+
+
+/**
+ * Reports progress up to @a off (holes count as copied).
+ */
+static int rtFileCopyProgress(PRTFILECOPYPROGRESS pProgress, uint64_t off)
+{
+    if (!pProgress->pfnProgress || pProgress->offNextPercent >= off)
+        return VINF_SUCCESS;
+    while (pProgress->offNextPercent < off && pProgress->uPercentage < 100)
+    {
+        pProgress->uPercentage++;
+        pProgress->offNextPercent += pProgress->cbPercent;
+    }
+    return pProgress->pfnProgress(pProgress->uPercentage, pProgress->pvUser);
+}
+
+
 RTDECL(int) RTFileCopyByHandlesEx(RTFILE FileSrc, RTFILE FileDst, PFNRTPROGRESS pfnProgress, void *pvUser)
 {
     /*
@@ -442,93 +473,148 @@ RTDECL(int) RTFileCopyByHandlesEx(RTFILE FileSrc, RTFILE FileDst, PFNRTPROGRESS
     /*
      * Get the file size.
      */
-    RTFOFF cbSrc;
-    rc = RTFileSeek(FileSrc, 0, RTFILE_SEEK_END, (uint64_t *)&cbSrc);
+    uint64_t cbSrc;
+    rc = RTFileSeek(FileSrc, 0, RTFILE_SEEK_END, &cbSrc);
     if (RT_FAILURE(rc))
         return rc;
 
+    RTFILECOPYPROGRESS Progress;
+    Progress.pfnProgress    = pfnProgress;
+    Progress.pvUser         = pvUser;
+    Progress.uPercentage    = 0;
+    Progress.cbPercent      = RT_MAX(cbSrc / 100, 1);
+    Progress.offNextPercent = Progress.cbPercent;
+    if (pfnProgress)
+        rc = pfnProgress(0, pvUser);
+
     /*
-     * Allocate buffer.
+     * Try have the file system share the blocks first, it's all or nothing
+     * and takes the same time regardless of the size.
      */
-    size_t      cbBuf;
-    uint8_t    *pbBufFree = NULL;
-    uint8_t    *pbBuf;
-    if (cbSrc < _512K)
-    {
-        cbBuf = 8*_1K;
-        pbBuf = (uint8_t *)alloca(cbBuf);
-    }
-    else
-    {
-        cbBuf = _128K;
-        pbBuf = pbBufFree = (uint8_t *)RTMemTmpAlloc(cbBuf);
-    }
-    if (pbBuf)
+    if (RT_SUCCESS(rc))
+        rc = RTFileClone(FileSrc, FileDst);
+    if (rc == VERR_NOT_SUPPORTED)
     {
         /*
-         * Seek to the start of each file
-         * and set the size of the destination file.
+         * Truncate the destination before sizing it so that the ranges we
+         * skip below end up as holes and not as stale data.
          */
-        rc = RTFileSeek(FileSrc, 0, RTFILE_SEEK_BEGIN, NULL);
+        rc = RTFileSetSize(FileDst, 0);
         if (RT_SUCCESS(rc))
+            rc = RTFileSetSize(FileDst, cbSrc);
+
+        /*
+         * Walk the data ranges of the source and copy them, preferring the
+         * in-kernel copy and falling back on reading and writing.  The
+         * buffer is only allocated when needed.
+         */
+        bool        fCopyPart = true;
+        size_t      cbBuf     = 0;
+        uint8_t    *pbBufFree = NULL;
+        uint8_t    *pbBuf     = NULL;
+        uint64_t    off       = 0;
+        while (off < cbSrc && RT_SUCCESS(rc))
         {
-            rc = RTFileSeek(FileDst, 0, RTFILE_SEEK_BEGIN, NULL);
-            if (RT_SUCCESS(rc))
-                rc = RTFileSetSize(FileDst, cbSrc);
-            if (RT_SUCCESS(rc) && pfnProgress)
-                rc = pfnProgress(0, pvUser);
-            if (RT_SUCCESS(rc))
+            uint64_t offData;
+            uint64_t cbData;
+            rc = RTFileQueryDataRange(FileSrc, off, &offData, &cbData);
+            if (rc == VERR_EOF)
             {
-                /*
-                 * Copy loop.
-                 */
-                unsigned    uPercentage = 0;
-                RTFOFF      off = 0;
-                RTFOFF      cbPercent = cbSrc / 100;
-                RTFOFF      offNextPercent = cbPercent;
-                while (off < cbSrc)
+                rc = VINF_SUCCESS;
+                break;
+            }
+            if (rc == VERR_NOT_SUPPORTED)
+            {
+                offData = off;
+                cbData  = cbSrc - off;
+                rc = VINF_SUCCESS;
+            }
+            else if (RT_FAILURE(rc))
+                break;
+            if (offData >= cbSrc)
+                break;
+            cbData = RT_MIN(cbData, cbSrc - offData);
+
+            off = offData;
+            rc = rtFileCopyProgress(&Progress, off);
+            uint64_t const offEnd = offData + cbData;
+            while (off < offEnd && RT_SUCCESS(rc))
+            {
+                if (fCopyPart)
                 {
-                    /* copy block */
-                    RTFOFF cbLeft = cbSrc - off;
-                    size_t cbBlock = cbLeft >= (RTFOFF)cbBuf ? cbBuf : (size_t)cbLeft;
-                    rc = RTFileRead(FileSrc, pbBuf, cbBlock, NULL);
-                    if (RT_FAILURE(rc))
-                        break;
-                    rc = RTFileWrite(FileDst, pbBuf, cbBlock, NULL);
-                    if (RT_FAILURE(rc))
+                    /* Chunked so progress gets reported on large files. */
+                    uint64_t cbCopied = 0;
+                    rc = RTFileCopyPart(FileSrc, off, FileDst, off, RT_MIN(offEnd - off, _16M), 0 /*fFlags*/, &cbCopied);
+                    if (RT_SUCCESS(rc) && cbCopied)
+                        off += cbCopied;
+                    else if (RT_SUCCESS(rc) || rc == VERR_NOT_SUPPORTED)
+                    {
+                        /* Nothing copied happens with procfs/sysfs style files and some
+                           cross file system setups, let the read/write loop handle those
+                           (and report EOF if the source really shrunk). */
+                        fCopyPart = false;
+                        rc = VINF_SUCCESS;
+                        continue;
+                    }
+                    else
                         break;
-
-                    /* advance */
-                    off += cbBlock;
-                    if (pfnProgress && offNextPercent < off)
+                }
+                else
+                {
+                    if (!pbBuf)
                     {
-                        while (offNextPercent < off)
+                        if (cbSrc < _512K)
                         {
-                            uPercentage++;
-                            offNextPercent += cbPercent;
+                            cbBuf = 8*_1K;
+                            pbBuf = (uint8_t *)alloca(cbBuf);
                         }
-                        rc = pfnProgress(uPercentage, pvUser);
+                        else
+                        {
+                            cbBuf = _1M;
+                            pbBuf = pbBufFree = (uint8_t *)RTMemTmpAlloc(cbBuf);
+                            if (!pbBuf)
+                            {
+                                rc = VERR_NO_MEMORY;
+                                break;
+                            }
+                        }
+                    }
+
+                    /* Blocks of zeros are left as holes. */
+                    size_t cbBlock = (size_t)RT_MIN(offEnd - off, cbBuf);
+                    rc = RTFileReadAt(FileSrc, off, pbBuf, cbBlock, NULL);
+                    if (RT_FAILURE(rc))
+                        break;
+                    if (!ASMMemIsZero(pbBuf, cbBlock))
+                    {
+                        rc = RTFileWriteAt(FileDst, off, pbBuf, cbBlock, NULL);
                         if (RT_FAILURE(rc))
                             break;
                     }
+                    off += cbBlock;
                 }
 
-#if 0
-                /*
-                 * Copy OS specific data (EAs and stuff).
-                 */
-                rtFileCopyOSStuff(FileSrc, FileDst);
-#endif
-
-                /* 100% */
-                if (pfnProgress && uPercentage < 100 && RT_SUCCESS(rc))
-                    rc = pfnProgress(100, pvUser);
+                rc = rtFileCopyProgress(&Progress, off);
             }
+            off = offEnd;
         }
         RTMemTmpFree(pbBufFree);
+
+#if 0
+        /*
+         * Copy OS specific data (EAs and stuff).
+         */
+        rtFileCopyOSStuff(FileSrc, FileDst);
+#endif
     }
-    else
-        rc = VERR_NO_MEMORY;
+
+    /*
+     * Leave the destination position at the end and report 100%.
+     */
+    if (RT_SUCCESS(rc))
+        rc = RTFileSeek(FileDst, cbSrc, RTFILE_SEEK_BEGIN, NULL);
+    if (pfnProgress && Progress.uPercentage < 100 && RT_SUCCESS(rc))
+        rc = pfnProgress(100, pvUser);
 
     /*
      * Restore source position.
@@ -0,0 +1,141 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTFileCopyPart and RTFileClone, linux implementation.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP RTLOGGROUP_FILE
+#include <iprt/file.h>
+#include "internal/iprt.h"
+
+#include <iprt/asm.h>
+#include <iprt/assert.h>
+#include <iprt/err.h>
+
+#include <errno.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/* copy_file_range() appeared in Linux 4.5; older glibc headers lack the number. */
+#ifndef __NR_copy_file_range
+# if defined(RT_ARCH_AMD64)
+#  define __NR_copy_file_range  326
+# elif defined(RT_ARCH_X86)
+#  define __NR_copy_file_range  377
+# endif
+#endif
+
+/** The FICLONE ioctl (_IOW(0x94, 9, int)), Linux 4.5+. */
+#ifndef FICLONE
+# define FICLONE                0x40049409
+#endif
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Set when the kernel has told us it does not know copy_file_range(). */
+static bool volatile g_fNoCopyFileRange = false;
+/** Set when the kernel has told us it does not know FICLONE. */
+static bool volatile g_fNoClone = false;
+
+
+RTDECL(int) RTFileCopyPart(RTFILE hFileSrc, RTFOFF offSrc, RTFILE hFileDst, RTFOFF offDst, uint64_t cbToCopy,
+                           uint32_t fFlags, uint64_t *pcbCopied)
+{
+    AssertReturn(hFileSrc != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertReturn(hFileDst != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertReturn(offSrc >= 0 && offDst >= 0, VERR_INVALID_PARAMETER);
+    AssertReturn(!fFlags, VERR_INVALID_FLAGS);
+    AssertPtrReturn(pcbCopied, VERR_INVALID_POINTER);
+    *pcbCopied = 0;
+
+#ifdef __NR_copy_file_range
+    if (g_fNoCopyFileRange)
+        return VERR_NOT_SUPPORTED;
+
+    /* The kernel caps a single call at about 2GB anyway. */
+    size_t const cbThis = (size_t)RT_MIN(cbToCopy, (uint64_t)_1G);
+    loff_t       offSrcLnx = offSrc;
+    loff_t       offDstLnx = offDst;
+    ssize_t      cbDone;
+    do
+        cbDone = syscall(__NR_copy_file_range, (int)RTFileToNative(hFileSrc), &offSrcLnx,
+                         (int)RTFileToNative(hFileDst), &offDstLnx, cbThis, 0 /*fFlags*/);
+    while (cbDone < 0 && errno == EINTR);
+    if (cbDone >= 0)
+    {
+        *pcbCopied = (uint64_t)cbDone;
+        return VINF_SUCCESS;
+    }
+
+    int const iErr = errno;
+    if (iErr == ENOSYS)
+    {
+        ASMAtomicWriteBool(&g_fNoCopyFileRange, true);
+        return VERR_NOT_SUPPORTED;
+    }
+    /* Cross file system (pre 5.3 kernels), special files or file systems without support. */
+    if (iErr == EXDEV || iErr == EINVAL || iErr == EOPNOTSUPP || iErr == ETXTBSY)
+        return VERR_NOT_SUPPORTED;
+    return RTErrConvertFromErrno(iErr);
+#else
+    NOREF(offSrc); NOREF(offDst); NOREF(cbToCopy);
+    return VERR_NOT_SUPPORTED;
+#endif
+}
+RT_EXPORT_SYMBOL(RTFileCopyPart);
+
+
+RTDECL(int) RTFileClone(RTFILE hFileSrc, RTFILE hFileDst)
+{
+    AssertReturn(hFileSrc != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertReturn(hFileDst != NIL_RTFILE, VERR_INVALID_HANDLE);
+
+    if (g_fNoClone)
+        return VERR_NOT_SUPPORTED;
+
+    if (ioctl((int)RTFileToNative(hFileDst), FICLONE, (int)RTFileToNative(hFileSrc)) == 0)
+        return VINF_SUCCESS;
+
+    int const iErr = errno;
+    if (iErr == ENOTTY)
+    {
+        ASMAtomicWriteBool(&g_fNoClone, true);
+        return VERR_NOT_SUPPORTED;
+    }
+    if (iErr == EXDEV || iErr == EINVAL || iErr == EOPNOTSUPP || iErr == ETXTBSY)
+        return VERR_NOT_SUPPORTED;
+    return RTErrConvertFromErrno(iErr);
+}
+RT_EXPORT_SYMBOL(RTFileClone);
+
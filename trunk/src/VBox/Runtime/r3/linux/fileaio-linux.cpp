@@ -40,6 +40,19 @@
  * compensated if the user of this API implements caching itself. The next
  * limitation is that data buffers must be aligned at a 512 byte boundary or the
  * request will fail.
+ *
+ * Kernels with io_uring (5.1 and later) don't have these limitations, requests
+ * on files opened without O_DIRECT are processed asynchronously by kernel
+ * worker threads instead of blocking in io_submit.  So a context uses an
+ * io_uring instance if the kernel lets us create one and falls back to the old
+ * interface otherwise.  The requests are described by the same LNXKAIOIOCB
+ * structure for both and only translated into submission queue entries when
+ * submitted.  Completions are reaped straight from the mapped completion queue
+ * and only if there aren't enough the thread waits for more by polling the ring
+ * file descriptor.  With RTFILEAIOCTX_FLAGS_POLL_SUBMISSIONS a kernel thread
+ * polls the submission queue as well, so submitting doesn't even need a syscall
+ * while it is busy (this requires CAP_SYS_ADMIN before Linux 5.11, we silently
+ * fall back to a normal ring if we aren't allowed).
  */
 /** @todo r=bird: What's this about "must be opened with O_DIRECT"? An
  *        explanation would be nice, esp. seeing what Linus is quoted saying
@@ -57,10 +70,16 @@
 #include <iprt/err.h>
 #include <iprt/log.h>
 #include <iprt/thread.h>
+#include <iprt/once.h>
+#include <iprt/critsect.h>
+#include <iprt/time.h>
 #include "internal/fileaio.h"
 
 #include <unistd.h>
 #include <sys/syscall.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <poll.h>
 #include <errno.h>
 
 #include <iprt/file.h>
@@ -167,13 +186,134 @@ typedef struct LNXKAIOIOEVENT
 } LNXKAIOIOEVENT, *PLNXKAIOIOEVENT;
 
 
+/**
+ * io_uring submission queue ring offsets (struct io_sqring_offsets).
+ */
+typedef struct LNXIOURINGSQOFFSETS
+{
+    uint32_t  offHead;
+    uint32_t  offTail;
+    uint32_t  offRingMask;
+    uint32_t  offRingEntries;
+    uint32_t  offFlags;
+    uint32_t  offDropped;
+    uint32_t  offArray;
+    uint32_t  u32Reserved0;
+    uint64_t  u64Reserved1;
+} LNXIOURINGSQOFFSETS;
+AssertCompileSize(LNXIOURINGSQOFFSETS, 40);
+
+/**
+ * io_uring completion queue ring offsets (struct io_cqring_offsets).
+ */
+typedef struct LNXIOURINGCQOFFSETS
+{
+    uint32_t  offHead;
+    uint32_t  offTail;
+    uint32_t  offRingMask;
+    uint32_t  offRingEntries;
+    uint32_t  offOverflow;
+    uint32_t  offCqes;
+    uint64_t  au64Reserved[2];
+} LNXIOURINGCQOFFSETS;
+AssertCompileSize(LNXIOURINGCQOFFSETS, 40);
+
+/**
+ * io_uring setup parameters (struct io_uring_params).
+ */
+typedef struct LNXIOURINGPARAMS
+{
+    uint32_t            cSqEntries;
+    uint32_t            cCqEntries;
+    uint32_t            fFlags;
+    uint32_t            idSqThreadCpu;
+    uint32_t            cMsSqThreadIdle;
+    uint32_t            fFeatures;
+    uint32_t            au32Reserved[4];
+    LNXIOURINGSQOFFSETS SqOffsets;
+    LNXIOURINGCQOFFSETS CqOffsets;
+} LNXIOURINGPARAMS;
+AssertCompileSize(LNXIOURINGPARAMS, 120);
+
+/**
+ * io_uring submission queue entry (struct io_uring_sqe).
+ */
+typedef struct LNXIOURINGSQE
+{
+    uint8_t   u8Opcode;
+    uint8_t   fFlags;
+    uint16_t  u16IoPrio;
+    int32_t   iFd;
+    uint64_t  off;
+    uint64_t  uAddr;
+    uint32_t  cbLen;
+    uint32_t  fOpFlags;
+    uint64_t  u64User;
+    uint64_t  au64Reserved[3];
+} LNXIOURINGSQE;
+AssertCompileSize(LNXIOURINGSQE, 64);
+/** Pointer to a submission queue entry. */
+typedef LNXIOURINGSQE *PLNXIOURINGSQE;
+
+/**
+ * io_uring completion queue entry (struct io_uring_cqe).
+ */
+typedef struct LNXIOURINGCQE
+{
+    uint64_t  u64User;
+    int32_t   rcLnx;
+    uint32_t  fFlags;
+} LNXIOURINGCQE;
+AssertCompileSize(LNXIOURINGCQE, 16);
+/** Pointer to a completion queue entry. */
+typedef LNXIOURINGCQE *PLNXIOURINGCQE;
+
+/**
+ * The mapped io_uring of a context.
+ */
+typedef struct LNXIOURING
+{
+    /** The ring file descriptor. */
+    int                 iFdRing;
+    /** Whether a kernel thread polls the submission queue. */
+    bool                fSqPoll;
+    /** The submission queue ring mapping and its size. */
+    uint8_t            *pbSqRing;
+    size_t              cbSqRing;
+    /** The completion queue ring mapping and its size. */
+    uint8_t            *pbCqRing;
+    size_t              cbCqRing;
+    /** The submission queue entries and the size of the mapping. */
+    PLNXIOURINGSQE      paSqes;
+    size_t              cbSqes;
+    /** Pointers into the submission queue ring. */
+    uint32_t volatile  *pidxSqHead;
+    uint32_t volatile  *pidxSqTail;
+    uint32_t volatile  *pfSqFlags;
+    uint32_t           *paidxSqArray;
+    uint32_t            fSqMask;
+    uint32_t            cSqEntries;
+    /** Pointers into the completion queue ring. */
+    uint32_t volatile  *pidxCqHead;
+    uint32_t volatile  *pidxCqTail;
+    PLNXIOURINGCQE      paCqes;
+    uint32_t            fCqMask;
+    /** Serializes submissions, the submission queue has a single producer. */
+    RTCRITSECT          CritSectSubmit;
+} LNXIOURING;
+/** Pointer to a mapped io_uring. */
+typedef LNXIOURING *PLNXIOURING;
+
+
 /**
  * Async I/O completion context state.
  */
 typedef struct RTFILEAIOCTXINTERNAL
 {
-    /** Handle to the async I/O context. */
+    /** Handle to the async I/O context, 0 if io_uring is used. */
     LNXKAIOCONTEXT      AioContext;
+    /** The io_uring instance, NULL if the legacy interface is used. */
+    PLNXIOURING         pUring;
     /** Maximum number of requests this context can handle. */
     int                 cRequestsMax;
     /** Current number of requests active on this context. */
@@ -210,6 +350,8 @@ typedef struct RTFILEAIOREQINTERNAL
     size_t                cbTransfered;
     /** Completion context we are assigned to. */
     PRTFILEAIOCTXINTERNAL pCtxInt;
+    /** The I/O vector for io_uring read and write requests. */
+    struct iovec          IoVec;
     /** Magic value  (RTFILEAIOREQ_MAGIC). */
     uint32_t              u32Magic;
 } RTFILEAIOREQINTERNAL;
@@ -223,6 +365,45 @@ typedef RTFILEAIOREQINTERNAL *PRTFILEAIOREQINTERNAL;
 /** The max number of events to get in one call. */
 #define AIO_MAXIMUM_REQUESTS_PER_CONTEXT 64
 
+/** @name io_uring syscall numbers, the same for all architectures.
+ * @{ */
+#ifndef __NR_io_uring_setup
+# define __NR_io_uring_setup    425
+#endif
+#ifndef __NR_io_uring_enter
+# define __NR_io_uring_enter    426
+#endif
+/** @} */
+
+/** @name io_uring constants.
+ * @{ */
+#define LNXIOURING_SETUP_SQPOLL         RT_BIT_32(1)
+#define LNXIOURING_ENTER_GETEVENTS      RT_BIT_32(0)
+#define LNXIOURING_ENTER_SQ_WAKEUP      RT_BIT_32(1)
+#define LNXIOURING_SQ_NEED_WAKEUP       RT_BIT_32(0)
+#define LNXIOURING_FEAT_NODROP          RT_BIT_32(1)
+#define LNXIOURING_FEAT_SQPOLL_NONFIXED RT_BIT_32(7)
+#define LNXIOURING_OP_READV             1
+#define LNXIOURING_OP_WRITEV            2
+#define LNXIOURING_OP_FSYNC             3
+#define LNXIOURING_OFF_SQ_RING          UINT64_C(0)
+#define LNXIOURING_OFF_CQ_RING          UINT64_C(0x8000000)
+#define LNXIOURING_OFF_SQES             UINT64_C(0x10000000)
+/** The max number of entries in a ring. */
+#define LNXIOURING_ENTRIES_MAX          _32K
+/** How long the submission polling thread spins before going to sleep. */
+#define LNXIOURING_SQPOLL_IDLE_MS       50
+/** @} */
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Init once for g_fLnxIoUring. */
+static RTONCE   g_LnxIoUringOnce = RTONCE_INITIALIZER;
+/** Whether the host kernel supports io_uring. */
+static bool     g_fLnxIoUring = false;
+
 
 /**
  * Creates a new async I/O context.
@@ -293,11 +474,338 @@ DECLINLINE(int) rtFileAsyncIoLinuxGetEvents(LNXKAIOCONTEXT AioContext, long cReq
     return rc;
 }
 
+/**
+ * Destroys an io_uring instance.
+ */
+static void rtFileAioLinuxUringDestroy(PLNXIOURING pUring)
+{
+    if (pUring->paSqes)
+        munmap(pUring->paSqes, pUring->cbSqes);
+    if (pUring->pbCqRing)
+        munmap(pUring->pbCqRing, pUring->cbCqRing);
+    if (pUring->pbSqRing)
+        munmap(pUring->pbSqRing, pUring->cbSqRing);
+    if (pUring->iFdRing >= 0)
+        close(pUring->iFdRing);
+    if (RTCritSectIsInitialized(&pUring->CritSectSubmit))
+        RTCritSectDelete(&pUring->CritSectSubmit);
+    RTMemFree(pUring);
+}
+
+/**
+ * Creates and maps an io_uring instance.
+ *
+ * @returns IPRT status code.
+ * @param   cEntries    Number of requests which can be outstanding at a time.
+ * @param   fSqPoll     Whether to try having a kernel thread poll the
+ *                      submission queue.
+ * @param   ppUring     Where to store the instance on success.
+ */
+static int rtFileAioLinuxUringCreate(uint32_t cEntries, bool fSqPoll, PLNXIOURING *ppUring)
+{
+    if (cEntries > LNXIOURING_ENTRIES_MAX)
+        return VERR_OUT_OF_RANGE;
+
+    PLNXIOURING pUring = (PLNXIOURING)RTMemAllocZ(sizeof(*pUring));
+    if (RT_UNLIKELY(!pUring))
+        return VERR_NO_MEMORY;
+    pUring->iFdRing = -1;
+
+    /*
+     * Create the ring, the completion queue is twice the size of the submission
+     * queue so it can't overflow with cEntries requests outstanding.
+     *
+     * Submission polling is only usable if the kernel accepts ordinary file
+     * descriptors with it (5.11+), older kernels require registered files.
+     */
+    LNXIOURINGPARAMS Params;
+    RT_ZERO(Params);
+    if (fSqPoll)
+    {
+        Params.fFlags          = LNXIOURING_SETUP_SQPOLL;
+        Params.cMsSqThreadIdle = LNXIOURING_SQPOLL_IDLE_MS;
+        pUring->iFdRing = (int)syscall(__NR_io_uring_setup, cEntries, &Params);
+        if (   pUring->iFdRing >= 0
+            && !(Params.fFeatures & LNXIOURING_FEAT_SQPOLL_NONFIXED))
+        {
+            close(pUring->iFdRing);
+            pUring->iFdRing = -1;
+        }
+        if (pUring->iFdRing < 0)
+        {
+            /* Not privileged or too old a kernel, do without. */
+            RT_ZERO(Params);
+            fSqPoll = false;
+        }
+    }
+    if (pUring->iFdRing < 0)
+        pUring->iFdRing = (int)syscall(__NR_io_uring_setup, cEntries, &Params);
+    if (pUring->iFdRing < 0)
+    {
+        int rc = errno == EAGAIN || errno == ENOMEM
+               ? VERR_FILE_AIO_INSUFFICIENT_EVENTS
+               : RTErrConvertFromErrno(errno);
+        rtFileAioLinuxUringDestroy(pUring);
+        return rc;
+    }
+    pUring->fSqPoll = fSqPoll;
+
+    /*
+     * Kernels without NODROP throw away completions when the queue overflows.
+     * RTFileAioCtxSubmit caps the requests in flight at cEntries, so make sure
+     * that fits.
+     */
+    if (   !(Params.fFeatures & LNXIOURING_FEAT_NODROP)
+        && Params.cCqEntries < cEntries)
+    {
+        rtFileAioLinuxUringDestroy(pUring);
+        return VERR_FILE_AIO_INSUFFICIENT_EVENTS;
+    }
+
+    /*
+     * Map the two rings and the submission queue entries.
+     */
+    int rc = VINF_SUCCESS;
+    pUring->cbSqRing = Params.SqOffsets.offArray + Params.cSqEntries * sizeof(uint32_t);
+    pUring->cbCqRing = Params.CqOffsets.offCqes  + Params.cCqEntries * sizeof(LNXIOURINGCQE);
+    pUring->cbSqes   = Params.cSqEntries * sizeof(LNXIOURINGSQE);
+    void *pv = mmap(NULL, pUring->cbSqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                    pUring->iFdRing, LNXIOURING_OFF_SQ_RING);
+    if (pv != MAP_FAILED)
+    {
+        pUring->pbSqRing = (uint8_t *)pv;
+        pv = mmap(NULL, pUring->cbCqRing, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                  pUring->iFdRing, LNXIOURING_OFF_CQ_RING);
+        if (pv != MAP_FAILED)
+        {
+            pUring->pbCqRing = (uint8_t *)pv;
+            pv = mmap(NULL, pUring->cbSqes, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+                      pUring->iFdRing, LNXIOURING_OFF_SQES);
+            if (pv != MAP_FAILED)
+                pUring->paSqes = (PLNXIOURINGSQE)pv;
+            else
+                rc = RTErrConvertFromErrno(errno);
+        }
+        else
+            rc = RTErrConvertFromErrno(errno);
+    }
+    else
+        rc = RTErrConvertFromErrno(errno);
+
+    if (RT_SUCCESS(rc))
+        rc = RTCritSectInit(&pUring->CritSectSubmit);
+    if (RT_FAILURE(rc))
+    {
+        rtFileAioLinuxUringDestroy(pUring);
+        return rc;
+    }
+
+    pUring->pidxSqHead   = (uint32_t volatile *)(pUring->pbSqRing + Params.SqOffsets.offHead);
+    pUring->pidxSqTail   = (uint32_t volatile *)(pUring->pbSqRing + Params.SqOffsets.offTail);
+    pUring->pfSqFlags    = (uint32_t volatile *)(pUring->pbSqRing + Params.SqOffsets.offFlags);
+    pUring->paidxSqArray = (uint32_t *)(pUring->pbSqRing + Params.SqOffsets.offArray);
+    pUring->fSqMask      = *(uint32_t *)(pUring->pbSqRing + Params.SqOffsets.offRingMask);
+    pUring->cSqEntries   = *(uint32_t *)(pUring->pbSqRing + Params.SqOffsets.offRingEntries);
+    pUring->pidxCqHead   = (uint32_t volatile *)(pUring->pbCqRing + Params.CqOffsets.offHead);
+    pUring->pidxCqTail   = (uint32_t volatile *)(pUring->pbCqRing + Params.CqOffsets.offTail);
+    pUring->paCqes       = (PLNXIOURINGCQE)(pUring->pbCqRing + Params.CqOffsets.offCqes);
+    pUring->fCqMask      = *(uint32_t *)(pUring->pbCqRing + Params.CqOffsets.offRingMask);
+
+    *ppUring = pUring;
+    return VINF_SUCCESS;
+}
+
+/**
+ * @callback_method_impl{FNRTONCE, Checks whether the kernel supports io_uring.}
+ */
+static DECLCALLBACK(int32_t) rtFileAioLinuxUringInitOnce(void *pvUser)
+{
+    NOREF(pvUser);
+    PLNXIOURING pUring = NULL;
+    int rc = rtFileAioLinuxUringCreate(1, false /*fSqPoll*/, &pUring);
+    if (RT_SUCCESS(rc))
+    {
+        rtFileAioLinuxUringDestroy(pUring);
+        g_fLnxIoUring = true;
+    }
+    else
+        LogRel(("RTFileAio: io_uring not available (%Rrc), using the legacy kernel interface\n", rc));
+    return VINF_SUCCESS;
+}
+
+/**
+ * Returns whether the kernel supports io_uring.
+ */
+DECLINLINE(bool) rtFileAioLinuxUringIsAvailable(void)
+{
+    RTOnce(&g_LnxIoUringOnce, rtFileAioLinuxUringInitOnce, NULL);
+    return g_fLnxIoUring;
+}
+
+/**
+ * Submits requests to an io_uring.
+ *
+ * All requests end up in the submission queue, the kernel reports errors
+ * with individual requests through the completion queue.
+ *
+ * @returns IPRT status code.
+ * @param   pUring      The io_uring.
+ * @param   pahReqs     The requests.
+ * @param   cReqs       Number of requests.
+ * @param   pcSubmitted Where to store the number of requests submitted.
+ */
+static int rtFileAioLinuxUringSubmit(PLNXIOURING pUring, PRTFILEAIOREQ pahReqs, size_t cReqs, size_t *pcSubmitted)
+{
+    int    rc         = VINF_SUCCESS;
+    size_t cSubmitted = 0;
+
+    RTCritSectEnter(&pUring->CritSectSubmit);
+    while (cSubmitted < cReqs)
+    {
+        /*
+         * Fill as many submission queue entries as there is room for.
+         */
+        uint32_t const idxHead = ASMAtomicReadU32(pUring->pidxSqHead);
+        uint32_t       idxTail = *pUring->pidxSqTail;
+        uint32_t const cFree   = pUring->cSqEntries - (idxTail - idxHead);
+        uint32_t       cQueued = 0;
+        while (   cQueued < cFree
+               && cSubmitted + cQueued < cReqs)
+        {
+            PRTFILEAIOREQINTERNAL pReqInt = pahReqs[cSubmitted + cQueued];
+            uint32_t const        idxSqe  = idxTail & pUring->fSqMask;
+            PLNXIOURINGSQE        pSqe    = &pUring->paSqes[idxSqe];
+
+            RT_ZERO(*pSqe);
+            pSqe->iFd     = (int32_t)pReqInt->AioCB.uFileDesc;
+            pSqe->u64User = (uintptr_t)pReqInt;
+            switch (pReqInt->AioCB.u16IoOpCode)
+            {
+                case LNXKAIO_IOCB_CMD_READ:
+                case LNXKAIO_IOCB_CMD_WRITE:
+                    pReqInt->IoVec.iov_base = pReqInt->AioCB.pvBuf;
+                    pReqInt->IoVec.iov_len  = pReqInt->AioCB.cbTransfer;
+                    pSqe->u8Opcode = pReqInt->AioCB.u16IoOpCode == LNXKAIO_IOCB_CMD_READ
+                                   ? LNXIOURING_OP_READV : LNXIOURING_OP_WRITEV;
+                    pSqe->off      = pReqInt->AioCB.off;
+                    pSqe->uAddr    = (uintptr_t)&pReqInt->IoVec;
+                    pSqe->cbLen    = 1;
+                    break;
+                case LNXKAIO_IOCB_CMD_FSYNC:
+                    pSqe->u8Opcode = LNXIOURING_OP_FSYNC;
+                    break;
+                default:
+                    AssertMsgFailed(("%u\n", pReqInt->AioCB.u16IoOpCode));
+                    pSqe->u8Opcode = LNXIOURING_OP_FSYNC;
+                    break;
+            }
+            pUring->paidxSqArray[idxSqe] = idxSqe;
+            idxTail++;
+            cQueued++;
+        }
+
+        /* Publish the new entries, the entries must be visible before the tail. */
+        ASMAtomicWriteU32(pUring->pidxSqTail, idxTail);
+
+        /*
+         * Tell the kernel.  The polling thread only needs a kick if it went to sleep.
+         */
+        if (pUring->fSqPoll)
+        {
+            ASMMemoryFence();
+            if (ASMAtomicReadU32(pUring->pfSqFlags) & LNXIOURING_SQ_NEED_WAKEUP)
+                syscall(__NR_io_uring_enter, pUring->iFdRing, 0, 0, LNXIOURING_ENTER_SQ_WAKEUP, NULL, 0);
+            cSubmitted += cQueued;
+            if (cSubmitted < cReqs)
+                RTThreadYield(); /* Let the polling thread drain the queue. */
+        }
+        else if (cQueued)
+        {
+            long cDone = syscall(__NR_io_uring_enter, pUring->iFdRing, cQueued, 0, 0, NULL, 0);
+            if (RT_UNLIKELY(cDone < 0))
+            {
+                /* Take the entries back, they weren't consumed. */
+                rc = errno == EAGAIN || errno == EBUSY
+                   ? VERR_FILE_AIO_INSUFFICIENT_RESSOURCES
+                   : RTErrConvertFromErrno(errno);
+                ASMAtomicWriteU32(pUring->pidxSqTail, idxTail - cQueued);
+                break;
+            }
+            cSubmitted += (size_t)cDone;
+            if ((uint32_t)cDone < cQueued)
+            {
+                ASMAtomicWriteU32(pUring->pidxSqTail, idxTail - (cQueued - (uint32_t)cDone));
+                if (!cDone)
+                {
+                    rc = VERR_FILE_AIO_INSUFFICIENT_RESSOURCES;
+                    break;
+                }
+            }
+        }
+    }
+    RTCritSectLeave(&pUring->CritSectSubmit);
+
+    *pcSubmitted = cSubmitted;
+    return rc;
+}
+
+/**
+ * Reaps completed requests from the completion queue of an io_uring.
+ *
+ * @returns Number of requests stored in pahReqs.
+ * @param   pUring      The io_uring.
+ * @param   pahReqs     Where to store the completed requests.
+ * @param   cReqs       Maximum number of requests to reap.
+ */
+static uint32_t rtFileAioLinuxUringReap(PLNXIOURING pUring, PRTFILEAIOREQ pahReqs, size_t cReqs)
+{
+    uint32_t       cReaped = 0;
+    uint32_t       idxHead = *pUring->pidxCqHead;
+    uint32_t const idxTail = ASMAtomicReadU32(pUring->pidxCqTail);
+    while (   idxHead != idxTail
+           && cReaped < cReqs)
+    {
+        PLNXIOURINGCQE        pCqe    = &pUring->paCqes[idxHead & pUring->fCqMask];
+        PRTFILEAIOREQINTERNAL pReqInt = (PRTFILEAIOREQINTERNAL)(uintptr_t)pCqe->u64User;
+        AssertPtr(pReqInt);
+        Assert(pReqInt->u32Magic == RTFILEAIOREQ_MAGIC);
+
+        if (RT_UNLIKELY(pCqe->rcLnx < 0))
+            pReqInt->Rc = RTErrConvertFromErrno(-pCqe->rcLnx);
+        else
+        {
+            pReqInt->Rc = VINF_SUCCESS;
+            pReqInt->cbTransfered = (uint32_t)pCqe->rcLnx;
+        }
+        RTFILEAIOREQ_SET_STATE(pReqInt, COMPLETED);
+
+        pahReqs[cReaped++] = (RTFILEAIOREQ)pReqInt;
+        idxHead++;
+    }
+
+    /* Release the entries, we're done reading them. */
+    ASMAtomicWriteU32(pUring->pidxCqHead, idxHead);
+    return cReaped;
+}
+
+
 RTR3DECL(int) RTFileAioGetLimits(PRTFILEAIOLIMITS pAioLimits)
 {
     int rc = VINF_SUCCESS;
     AssertPtrReturn(pAioLimits, VERR_INVALID_POINTER);
 
+    /*
+     * With io_uring the alignment is only required for files opened with
+     * O_DIRECT and the others work asynchronously too.
+     */
+    if (rtFileAioLinuxUringIsAvailable())
+    {
+        pAioLimits->cReqsOutstandingMax = RTFILEAIO_UNLIMITED_REQS;
+        pAioLimits->cbBufferAlignment   = 512;
+        pAioLimits->fFlags              = RTFILEAIOLIMITS_F_BUFFERED_IO;
+        return VINF_SUCCESS;
+    }
+
     /*
      * Check if the API is implemented by creating a
      * completion port.
@@ -314,6 +822,7 @@ RTR3DECL(int) RTFileAioGetLimits(PRTFILEAIOLIMITS pAioLimits)
     /* Supported - fill in the limits. The alignment is the only restriction. */
     pAioLimits->cReqsOutstandingMax = RTFILEAIO_UNLIMITED_REQS;
     pAioLimits->cbBufferAlignment   = 512;
+    pAioLimits->fFlags              = 0;
 
     return VINF_SUCCESS;
 }
@@ -442,6 +951,10 @@ RTDECL(int) RTFileAioReqCancel(RTFILEAIOREQ hReq)
     RTFILEAIOREQ_VALID_RETURN(pReqInt);
     RTFILEAIOREQ_STATE_RETURN_RC(pReqInt, SUBMITTED, VERR_FILE_AIO_NOT_SUBMITTED);
 
+    /* io_uring can only cancel asynchronously, the request completes normally. */
+    if (pReqInt->pCtxInt->pUring)
+        return VERR_FILE_AIO_IN_PROGRESS;
+
     LNXKAIOIOEVENT AioEvent;
     int rc = rtFileAsyncIoLinuxCancel(pReqInt->AioContext, &pReqInt->AioCB, &AioEvent);
     if (RT_SUCCESS(rc))
@@ -495,8 +1008,12 @@ RTDECL(int) RTFileAioCtxCreate(PRTFILEAIOCTX phAioCtx, uint32_t cAioReqsMax,
     if (RT_UNLIKELY(!pCtxInt))
         return VERR_NO_MEMORY;
 
-    /* Init the event handle. */
-    int rc = rtFileAsyncIoLinuxCreate(cAioReqsMax, &pCtxInt->AioContext);
+    /* Init the event handle, preferring io_uring. */
+    int rc = VERR_NOT_SUPPORTED;
+    if (rtFileAioLinuxUringIsAvailable())
+        rc = rtFileAioLinuxUringCreate(cAioReqsMax, RT_BOOL(fFlags & RTFILEAIOCTX_FLAGS_POLL_SUBMISSIONS), &pCtxInt->pUring);
+    if (RT_FAILURE(rc))
+        rc = rtFileAsyncIoLinuxCreate(cAioReqsMax, &pCtxInt->AioContext);
     if (RT_SUCCESS(rc))
     {
         pCtxInt->fWokenUp     = false;
@@ -527,9 +1044,14 @@ RTDECL(int) RTFileAioCtxDestroy(RTFILEAIOCTX hAioCtx)
         return VERR_FILE_AIO_BUSY;
 
     /* The native bit first, then mark it as dead and free it. */
-    int rc = rtFileAsyncIoLinuxDestroy(pCtxInt->AioContext);
-    if (RT_FAILURE(rc))
-        return rc;
+    if (pCtxInt->pUring)
+        rtFileAioLinuxUringDestroy(pCtxInt->pUring);
+    else
+    {
+        int rc = rtFileAsyncIoLinuxDestroy(pCtxInt->AioContext);
+        if (RT_FAILURE(rc))
+            return rc;
+    }
     ASMAtomicUoWriteU32(&pCtxInt->u32Magic, RTFILEAIOCTX_MAGIC_DEAD);
     RTMemFree(pCtxInt);
 
@@ -596,6 +1118,32 @@ RTDECL(int) RTFileAioCtxSubmit(RTFILEAIOCTX hAioCtx, PRTFILEAIOREQ pahReqs, size
         RTFILEAIOREQ_SET_STATE(pReqInt, SUBMITTED);
     }
 
+    if (pCtxInt->pUring)
+    {
+        /*
+         * Count them first, they may complete before we get to it otherwise.
+         * The limit keeps the completion queue from overflowing.
+         */
+        size_t        cReqsSubmitted = 0;
+        int32_t const cReqsActive    = ASMAtomicAddS32(&pCtxInt->cRequests, (int32_t)cReqs) + (int32_t)cReqs;
+        if (RT_LIKELY(cReqsActive <= pCtxInt->cRequestsMax))
+            rc = rtFileAioLinuxUringSubmit(pCtxInt->pUring, pahReqs, cReqs, &cReqsSubmitted);
+        else
+            rc = VERR_FILE_AIO_LIMIT_EXCEEDED;
+        if (RT_FAILURE(rc))
+        {
+            /* Revert the ones which didn't make it into the prepared state. */
+            ASMAtomicSubS32(&pCtxInt->cRequests, (int32_t)(cReqs - cReqsSubmitted));
+            for (i = (uint32_t)cReqsSubmitted; i < cReqs; i++)
+            {
+                pReqInt = pahReqs[i];
+                pReqInt->pCtxInt = NULL;
+                RTFILEAIOREQ_SET_STATE(pReqInt, PREPARED);
+            }
+        }
+        return rc;
+    }
+
     do
     {
         /*
@@ -703,6 +1251,45 @@ RTDECL(int) RTFileAioCtxWait(RTFILEAIOCTX hAioCtx, size_t cMinReqs, RTMSINTERVAL
     int cRequestsCompleted = 0;
     while (!pCtxInt->fWokenUp)
     {
+        if (pCtxInt->pUring)
+        {
+            /*
+             * Take what's in the completion queue and only wait if that isn't enough.
+             */
+            uint32_t const cDone = rtFileAioLinuxUringReap(pCtxInt->pUring, &pahReqs[cRequestsCompleted], cReqs);
+            cRequestsCompleted += cDone;
+            if (cDone >= cMinReqs)
+                break;
+            cMinReqs -= cDone;
+            cReqs    -= cDone;
+
+            int cMsWait = -1;
+            if (cMillies != RT_INDEFINITE_WAIT)
+            {
+                uint64_t cMilliesElapsed = (RTTimeNanoTS() - StartNanoTS) / RT_NS_1MS;
+                if (cMilliesElapsed >= cMillies)
+                {
+                    rc = VERR_TIMEOUT;
+                    break;
+                }
+                cMsWait = (int)(cMillies - (RTMSINTERVAL)cMilliesElapsed);
+            }
+
+            struct pollfd PollFd;
+            PollFd.fd      = pCtxInt->pUring->iFdRing;
+            PollFd.events  = POLLIN;
+            PollFd.revents = 0;
+            ASMAtomicXchgBool(&pCtxInt->fWaiting, true);
+            int rcLnx = pCtxInt->fWokenUp ? 0 : poll(&PollFd, 1, cMsWait);
+            ASMAtomicXchgBool(&pCtxInt->fWaiting, false);
+            if (rcLnx < 0)
+            {
+                rc = RTErrConvertFromErrno(errno);
+                break;
+            }
+            continue;
+        }
+
         LNXKAIOIOEVENT  aPortEvents[AIO_MAXIMUM_REQUESTS_PER_CONTEXT];
         int             cRequestsToWait = RT_MIN(cReqs, AIO_MAXIMUM_REQUESTS_PER_CONTEXT);
         ASMAtomicXchgBool(&pCtxInt->fWaiting, true);
@@ -0,0 +1,89 @@
+/* $Id$ */
+/** @file
+ * IPRT - RTFileQueryDataRange, POSIX implementation.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#define LOG_GROUP RTLOGGROUP_FILE
+#include <iprt/file.h>
+#include "internal/iprt.h"
+
+#include <iprt/assert.h>
+#include <iprt/err.h>
+
+#include <errno.h>
+#include <unistd.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/* Linux 3.1+ knows these even when the headers don't expose them. */
+#if defined(RT_OS_LINUX) && !defined(SEEK_DATA)
+# define SEEK_DATA  3
+# define SEEK_HOLE  4
+#endif
+
+
+RTDECL(int) RTFileQueryDataRange(RTFILE hFile, uint64_t off, uint64_t *poffData, uint64_t *pcbData)
+{
+    AssertReturn(hFile != NIL_RTFILE, VERR_INVALID_HANDLE);
+    AssertPtrReturn(poffData, VERR_INVALID_POINTER);
+    AssertPtrReturn(pcbData, VERR_INVALID_POINTER);
+    AssertMsgReturn(sizeof(off_t) >= sizeof(off) || RT_HIDWORD(off) == 0,
+                    ("64-bit offset not supported! off=%lld\n", off),
+                    VERR_NOT_SUPPORTED);
+
+#if defined(SEEK_DATA) && defined(SEEK_HOLE)
+    int const fd = (int)RTFileToNative(hFile);
+    off_t offData = lseek(fd, (off_t)off, SEEK_DATA);
+    if (offData < 0)
+    {
+        if (errno == ENXIO)
+            return VERR_EOF;
+        if (errno == EINVAL || errno == EOPNOTSUPP)
+            return VERR_NOT_SUPPORTED;
+        return RTErrConvertFromErrno(errno);
+    }
+
+    /* There is always an implicit hole at the end of the file. */
+    off_t offHole = lseek(fd, offData, SEEK_HOLE);
+    if (offHole < 0)
+        return RTErrConvertFromErrno(errno);
+    if (offHole < offData)
+        return VERR_INTERNAL_ERROR_3;
+
+    *poffData = (uint64_t)offData;
+    *pcbData  = (uint64_t)(offHole - offData);
+    return VINF_SUCCESS;
+#else
+    NOREF(off);
+    return VERR_NOT_SUPPORTED;
+#endif
+}
+RT_EXPORT_SYMBOL(RTFileQueryDataRange);
+
@@ -316,6 +316,7 @@ RTR3DECL(int) RTFileAioGetLimits(PRTFILEAIOLIMITS pAioLimits)
 
     pAioLimits->cReqsOutstandingMax = cReqsOutstandingMax;
     pAioLimits->cbBufferAlignment   = 0;
+    pAioLimits->fFlags              = RTFILEAIOLIMITS_F_BUFFERED_IO;
 #elif defined(RT_OS_FREEBSD)
     /*
      * The AIO API is implemented in a kernel module which is not
@@ -341,9 +342,11 @@ RTR3DECL(int) RTFileAioGetLimits(PRTFILEAIOLIMITS pAioLimits)
 
     pAioLimits->cReqsOutstandingMax = cReqsOutstandingMax;
     pAioLimits->cbBufferAlignment   = 0;
+    pAioLimits->fFlags              = RTFILEAIOLIMITS_F_BUFFERED_IO;
 #else
     pAioLimits->cReqsOutstandingMax = RTFILEAIO_UNLIMITED_REQS;
     pAioLimits->cbBufferAlignment   = 0;
+    pAioLimits->fFlags              = RTFILEAIOLIMITS_F_BUFFERED_IO;
 #endif
 
     return VINF_SUCCESS;
@@ -130,6 +130,7 @@ RTR3DECL(int) RTFileAioGetLimits(PRTFILEAIOLIMITS pAioLimits)
     /* No limits known. */
     pAioLimits->cReqsOutstandingMax = RTFILEAIO_UNLIMITED_REQS;
     pAioLimits->cbBufferAlignment   = 0;
+    pAioLimits->fFlags              = RTFILEAIOLIMITS_F_BUFFERED_IO;
 
     return VINF_SUCCESS;
 }
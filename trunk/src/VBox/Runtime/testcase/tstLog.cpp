@@ -29,15 +29,211 @@
 *   Header Files                                                                                                                 *
 *********************************************************************************************************************************/
 #include <iprt/log.h>
-#include <iprt/initterm.h>
 #include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include <iprt/thread.h>
 
 #include <stdio.h>
 
-int main()
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Arguments for tstLogDeferredThread. */
+typedef struct TSTLOGTHREAD
 {
-    RTR3InitExeNoArguments(0);
-    printf("tstLog: Requires manual inspection of the log output!\n");
+    /** The logger to use. */
+    PRTLOGGER   pLogger;
+    /** The thread number, used as message prefix. */
+    uint32_t    iThread;
+    /** Number of messages to log. */
+    uint32_t    cMsgs;
+} TSTLOGTHREAD;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle. */
+static RTTEST g_hTest;
+
+
+/**
+ * Thread logging a numbered sequence of messages.
+ */
+static DECLCALLBACK(int) tstLogDeferredThread(RTTHREAD hThreadSelf, void *pvUser)
+{
+    TSTLOGTHREAD *pArgs = (TSTLOGTHREAD *)pvUser;
+    RT_NOREF_PV(hThreadSelf);
+    for (uint32_t i = 0; i < pArgs->cMsgs; i++)
+        RTLogLoggerEx(pArgs->pLogger, 0, ~0U, "T%u %u %s\n", pArgs->iThread, i, "0123456789abcdef");
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Creates a logger writing to a file in deferred mode.
+ */
+static PRTLOGGER tstLogCreateDeferred(const char *pszPath, uint32_t cbPerThread, RTLOGDEFERREDOVERFLOW enmOverflow)
+{
+    RTFileDelete(pszPath);
+    PRTLOGGER pLogger = NULL;
+    RTTESTI_CHECK_RC_RET(RTLogCreate(&pLogger, 0, "all", NULL, 0, NULL, RTLOGDEST_FILE, "%s", pszPath), VINF_SUCCESS, NULL);
+    RTTESTI_CHECK_RC(RTLogSetDeferred(pLogger, true, cbPerThread, enmOverflow), VINF_SUCCESS);
+    return pLogger;
+}
+
+
+/**
+ * Logs from a number of threads, destroys the logger and checks the output.
+ *
+ * Each thread's messages must appear in order, and every message must either
+ * be in the file or be accounted for by a drop report.
+ *
+ * @returns The number of dropped messages.
+ */
+static uint32_t tstLogDeferredRun(const char *pszPath, PRTLOGGER pLogger, uint32_t cThreads, uint32_t cMsgs, bool fSerialize)
+{
+    TSTLOGTHREAD aArgs[4];
+    RTTHREAD     ahThreads[4];
+    RTTESTI_CHECK_RET(cThreads <= RT_ELEMENTS(aArgs), 0);
+    for (uint32_t i = 0; i < cThreads; i++)
+    {
+        aArgs[i].pLogger = pLogger;
+        aArgs[i].iThread = i;
+        aArgs[i].cMsgs   = cMsgs;
+        ahThreads[i]     = NIL_RTTHREAD;
+        RTTESTI_CHECK_RC(RTThreadCreateF(&ahThreads[i], tstLogDeferredThread, &aArgs[i], 0, RTTHREADTYPE_DEFAULT,
+                                         RTTHREADFLAGS_WAITABLE, "tstLog%u", i), VINF_SUCCESS);
+        if (fSerialize && ahThreads[i] != NIL_RTTHREAD)
+            RTTESTI_CHECK_RC(RTThreadWait(ahThreads[i], RT_INDEFINITE_WAIT, NULL), VINF_SUCCESS);
+    }
+    if (!fSerialize)
+        for (uint32_t i = 0; i < cThreads; i++)
+            if (ahThreads[i] != NIL_RTTHREAD)
+                RTTESTI_CHECK_RC(RTThreadWait(ahThreads[i], RT_INDEFINITE_WAIT, NULL), VINF_SUCCESS);
+
+    /* Logging after the threads are gone must still work and come last. */
+    RTLogLoggerEx(pLogger, 0, ~0U, "the end\n");
+    RTTESTI_CHECK_RC(RTLogDestroy(pLogger), VINF_SUCCESS);
+
+    /*
+     * Check the output.
+     */
+    void  *pvFile = NULL;
+    size_t cbFile = 0;
+    RTTESTI_CHECK_RC_RET(RTFileReadAll(pszPath, &pvFile, &cbFile), VINF_SUCCESS, 0);
+    char *pszFile = (char *)RTMemDupEx(pvFile, cbFile, 1);
+    RTFileReadAllFree(pvFile, cbFile);
+    RTTESTI_CHECK_RET(pszFile, 0);
+
+    uint32_t aiNext[4]   = { 0, 0, 0, 0 };
+    uint32_t cReceived   = 0;
+    uint32_t cDropped    = 0;
+    uint32_t iLastThread = 0;
+    bool     fEnd        = false;
+    char    *pszNext;
+    for (char *pszLine = pszFile; pszLine && *pszLine; pszLine = pszNext)
+    {
+        pszNext = strchr(pszLine, '\n');
+        if (pszNext)
+            *pszNext++ = '\0';
+
+        uint32_t iThread, iMsg, cLost;
+        char     szTail[32];
+        if (sscanf(pszLine, "T%u %u %31s", &iThread, &iMsg, szTail) == 3)
+        {
+            RTTESTI_CHECK_MSG(iThread < cThreads && !strcmp(szTail, "0123456789abcdef"), ("'%s'\n", pszLine));
+            RTTESTI_CHECK_MSG(!fEnd, ("message after the end: '%s'\n", pszLine));
+            if (iThread >= cThreads)
+                continue;
+            RTTESTI_CHECK_MSG(iMsg >= aiNext[iThread], ("T%u: %u after %u\n", iThread, iMsg, aiNext[iThread]));
+            RTTESTI_CHECK_MSG(!fSerialize || iThread >= iLastThread, ("T%u after T%u\n", iThread, iLastThread));
+            aiNext[iThread] = iMsg + 1;
+            iLastThread     = iThread;
+            cReceived++;
+        }
+        else if (sscanf(pszLine, "Logger: dropped %u messages", &cLost) == 1) /* may follow the end */
+            cDropped += cLost;
+        else if (!strcmp(pszLine, "the end"))
+            fEnd = true;
+        else
+            RTTestIFailed("unexpected line: '%s'\n", pszLine);
+    }
+    RTTESTI_CHECK(fEnd);
+    RTTESTI_CHECK_MSG(cReceived + cDropped == cThreads * cMsgs,
+                      ("cReceived=%u cDropped=%u expected %u\n", cReceived, cDropped, cThreads * cMsgs));
+    RTMemFree(pszFile);
+    RTFileDelete(pszPath);
+    return cDropped;
+}
+
+
+/**
+ * Tests deferred logging.
+ */
+static void tstLogDeferred(void)
+{
+    char szPath[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathTemp(szPath, sizeof(szPath)), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTPathAppend(szPath, sizeof(szPath), "tstLog-deferred.log"), VINF_SUCCESS);
+
+    RTTestSub(g_hTest, "Deferred formatting");
+    PRTLOGGER pLogger = tstLogCreateDeferred(szPath, 0, RTLOGDEFERREDOVERFLOW_WAIT);
+    if (pLogger)
+    {
+        char szTransient[16];
+        RTStrCopy(szTransient, sizeof(szTransient), "copied");
+        RTLogLoggerEx(pLogger, 0, ~0U, "%s|%.*s|%.*s|%*u|%-4s|%#x|%RX64|%%\n",
+                      szTransient, 3, "abcdef", -1, "abcdef", 5, 42U, "ab", 0x10, UINT64_C(0x123456789a));
+        RTStrCopy(szTransient, sizeof(szTransient), "clobbered");
+        RTTESTI_CHECK_RC(RTLogDestroy(pLogger), VINF_SUCCESS);
+
+        void  *pvFile = NULL;
+        size_t cbFile = 0;
+        RTTESTI_CHECK_RC(RTFileReadAll(szPath, &pvFile, &cbFile), VINF_SUCCESS);
+        if (pvFile)
+        {
+            static const char s_szExpect[] = "copied|abc|abcdef|   42|ab  |0x10|000000123456789a|%\n";
+            RTTESTI_CHECK_MSG(   cbFile == sizeof(s_szExpect) - 1
+                              && !memcmp(pvFile, s_szExpect, cbFile),
+                              ("got '%.*s'\n", cbFile, pvFile));
+            RTFileReadAllFree(pvFile, cbFile);
+        }
+        RTFileDelete(szPath);
+    }
+
+    RTTestSub(g_hTest, "Deferred ordering");
+    pLogger = tstLogCreateDeferred(szPath, 0, RTLOGDEFERREDOVERFLOW_WAIT);
+    if (pLogger)
+        RTTESTI_CHECK(tstLogDeferredRun(szPath, pLogger, 3, 200, true /*fSerialize*/) == 0);
+
+    RTTestSub(g_hTest, "Deferred ring overflow, waiting");
+    pLogger = tstLogCreateDeferred(szPath, _4K, RTLOGDEFERREDOVERFLOW_WAIT);
+    if (pLogger)
+        RTTESTI_CHECK(tstLogDeferredRun(szPath, pLogger, 4, 2000, false /*fSerialize*/) == 0);
+
+    RTTestSub(g_hTest, "Deferred ring overflow, dropping");
+    pLogger = tstLogCreateDeferred(szPath, _4K, RTLOGDEFERREDOVERFLOW_DROP);
+    if (pLogger)
+    {
+        uint32_t cDropped = tstLogDeferredRun(szPath, pLogger, 4, 2000, false /*fSerialize*/);
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "%u messages dropped\n", cDropped);
+    }
+}
+
+
+/**
+ * Logs a bunch of formatting samples to the default logger.
+ */
+static void tstLogFormatting(void)
+{
+    RTTestSub(g_hTest, "Formatting");
+    RTTestIPrintf(RTTESTLVL_ALWAYS, "Requires manual inspection of the log output!\n");
     RTLogPrintf("%%Rrc %d: %Rrc\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
     RTLogPrintf("%%Rrs %d: %Rrs\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
     RTLogPrintf("%%Rrf %d: %Rrf\n", VERR_INVALID_PARAMETER, VERR_INVALID_PARAMETER);
@@ -79,7 +275,19 @@ int main()
     RTLogPrintf("%%RX64: %RX64 %#RX64\n", _2E, _2E);
 
     RTLogFlush(NULL);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstLog", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    tstLogFormatting();
+    tstLogDeferred();
 
-    return 0;
+    return RTTestSummaryAndDestroy(g_hTest);
 }
 
@@ -0,0 +1,487 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - Debug Modules, lazy DWARF loading and the symbol index cache.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/dbg.h>
+
+#include <iprt/dir.h>
+#include <iprt/env.h>
+#include <iprt/err.h>
+#include <iprt/file.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/process.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+#include "internal/dbgmod.h"
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** The environment variable specifying the index cache directory. */
+#define TST_ENV_CACHE_DIR   "IPRT_DBG_INDEX_CACHE"
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** The test handle. */
+static RTTEST g_hTest;
+/** The index key used by the index file tests. */
+static uint8_t const g_abKey[20] =
+{
+    0x01, 0x23, 0x45, 0x67, 0x89, 0xab, 0xcd, 0xef, 0xfe, 0xdc, 0xba, 0x98, 0x76, 0x54, 0x32, 0x10, 0xde, 0xad, 0xbe, 0xef
+};
+
+
+/**
+ * Compares two symbols.
+ */
+static bool tstSymEquals(PCRTDBGSYMBOL pSym1, PCRTDBGSYMBOL pSym2)
+{
+    return pSym1->iSeg  == pSym2->iSeg
+        && pSym1->offSeg   == pSym2->offSeg
+        && pSym1->cb    == pSym2->cb
+        && !strcmp(pSym1->szName, pSym2->szName);
+}
+
+
+/**
+ * Compares two line numbers.
+ */
+static bool tstLineEquals(PCRTDBGLINE pLine1, PCRTDBGLINE pLine2)
+{
+    return pLine1->iSeg    == pLine2->iSeg
+        && pLine1->offSeg     == pLine2->offSeg
+        && pLine1->uLineNo == pLine2->uLineNo
+        && !strcmp(pLine1->szFilename, pLine2->szFilename);
+}
+
+
+/**
+ * Checks that address lookups in @a hMod give the same results as in @a hRef.
+ *
+ * Only address lookups are done so a lazily loading module stays lazy.
+ *
+ * @param   hRef        The reference module, fully loaded.
+ * @param   hMod        The module to check.
+ */
+static void tstCompareAddrLookups(RTDBGMOD hRef, RTDBGMOD hMod)
+{
+    uint32_t const cSymbols = RTDbgModSymbolCount(hRef);
+    uint32_t const uStep    = cSymbols / 512 + 1;
+    for (uint32_t iOrdinal = 0; iOrdinal < cSymbols; iOrdinal += uStep)
+    {
+        RTDBGSYMBOL Sym;
+        RTTESTI_CHECK_RC_RETV(RTDbgModSymbolByOrdinal(hRef, iOrdinal, &Sym), VINF_SUCCESS);
+        if (Sym.iSeg == RTDBGSEGIDX_ABS)
+            continue;
+        for (RTUINTPTR offAdd = 0; offAdd < RT_MAX(Sym.cb, 1); offAdd += RT_MAX(Sym.cb / 2, 1))
+            for (uint32_t fFlags = 0; fFlags <= RTDBGSYMADDR_FLAGS_VALID_MASK; fFlags++)
+            {
+                RTDBGSYMBOL SymRef, SymMod;
+                RTINTPTR    offDispRef = 0, offDispMod = 0;
+                int rcRef = RTDbgModSymbolByAddr(hRef, Sym.iSeg, Sym.offSeg + offAdd, fFlags, &offDispRef, &SymRef);
+                int rcMod = RTDbgModSymbolByAddr(hMod, Sym.iSeg, Sym.offSeg + offAdd, fFlags, &offDispMod, &SymMod);
+                RTTESTI_CHECK_MSG(rcRef == rcMod, ("%#x:%RTptr: %Rrc vs %Rrc\n", Sym.iSeg, Sym.offSeg + offAdd, rcRef, rcMod));
+                if (RT_SUCCESS(rcRef) && rcRef == rcMod)
+                    RTTESTI_CHECK_MSG(offDispRef == offDispMod && tstSymEquals(&SymRef, &SymMod),
+                                      ("%#x:%RTptr: %s%+RTptr vs %s%+RTptr\n", Sym.iSeg, Sym.offSeg + offAdd,
+                                       SymRef.szName, offDispRef, SymMod.szName, offDispMod));
+            }
+    }
+
+    uint32_t const cLines = RTDbgModLineCount(hRef);
+    uint32_t const uLineStep = cLines / 512 + 1;
+    for (uint32_t iOrdinal = 0; iOrdinal < cLines; iOrdinal += uLineStep)
+    {
+        RTDBGLINE Line;
+        RTTESTI_CHECK_RC_RETV(RTDbgModLineByOrdinal(hRef, iOrdinal, &Line), VINF_SUCCESS);
+
+        RTDBGLINE LineRef, LineMod;
+        RTINTPTR  offDispRef = 0, offDispMod = 0;
+        int rcRef = RTDbgModLineByAddr(hRef, Line.iSeg, Line.offSeg, &offDispRef, &LineRef);
+        int rcMod = RTDbgModLineByAddr(hMod, Line.iSeg, Line.offSeg, &offDispMod, &LineMod);
+        RTTESTI_CHECK_MSG(rcRef == rcMod, ("%#x:%RTptr: %Rrc vs %Rrc\n", Line.iSeg, Line.offSeg, rcRef, rcMod));
+        if (RT_SUCCESS(rcRef) && rcRef == rcMod)
+            RTTESTI_CHECK_MSG(offDispRef == offDispMod && tstLineEquals(&LineRef, &LineMod),
+                              ("%#x:%RTptr: %s(%u) vs %s(%u)\n", Line.iSeg, Line.offSeg,
+                               LineRef.szFilename, LineRef.uLineNo, LineMod.szFilename, LineMod.uLineNo));
+    }
+}
+
+
+/**
+ * Checks that the full picture of @a hMod (counts and name lookups) matches
+ * @a hRef.  This loads everything in a lazily loading module.
+ */
+static void tstCompareAll(RTDBGMOD hRef, RTDBGMOD hMod)
+{
+    uint32_t const cSymbols = RTDbgModSymbolCount(hRef);
+    RTTESTI_CHECK_MSG(RTDbgModSymbolCount(hMod) == cSymbols, ("%u vs %u\n", cSymbols, RTDbgModSymbolCount(hMod)));
+    RTTESTI_CHECK_MSG(RTDbgModLineCount(hMod) == RTDbgModLineCount(hRef),
+                      ("%u vs %u\n", RTDbgModLineCount(hRef), RTDbgModLineCount(hMod)));
+
+    uint32_t const uStep = cSymbols / 512 + 1;
+    for (uint32_t iOrdinal = 0; iOrdinal < cSymbols; iOrdinal += uStep)
+    {
+        RTDBGSYMBOL SymRef, SymByName;
+        RTTESTI_CHECK_RC_RETV(RTDbgModSymbolByOrdinal(hRef, iOrdinal, &SymRef), VINF_SUCCESS);
+        RTDBGSYMBOL SymRefByName;
+        RTTESTI_CHECK_RC_RETV(RTDbgModSymbolByName(hRef, SymRef.szName, &SymRefByName), VINF_SUCCESS);
+        int rc = RTDbgModSymbolByName(hMod, SymRef.szName, &SymByName);
+        RTTESTI_CHECK_MSG(RT_SUCCESS(rc) && tstSymEquals(&SymRefByName, &SymByName), ("'%s': %Rrc\n", SymRef.szName, rc));
+    }
+}
+
+
+/**
+ * Writes the content of @a pvFile to @a pszPath.
+ */
+static int tstWriteFile(const char *pszPath, void const *pvFile, size_t cbFile)
+{
+    RTFILE hFile;
+    int rc = RTFileOpen(&hFile, pszPath, RTFILE_O_WRITE | RTFILE_O_CREATE_REPLACE | RTFILE_O_DENY_NONE);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTFileWrite(hFile, pvFile, cbFile, NULL);
+        RTFileClose(hFile);
+    }
+    return rc;
+}
+
+
+/**
+ * Tests writing and reading an index file built from a hand made container.
+ *
+ * @param   pszDir      Scratch directory.
+ */
+static void tstIndexFile(const char *pszDir)
+{
+    RTTestSub(g_hTest, "Index file round-trip");
+
+    /*
+     * Build a container with two segments, some symbols and line numbers.
+     */
+    RTDBGMOD hCnt;
+    RTTESTI_CHECK_RC_RETV(RTDbgModCreate(&hCnt, "tstRTDbgMod", 0, 0), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTDbgModSegmentAdd(hCnt, 0x1000, 0x4000, ".text", 0, NULL), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTDbgModSegmentAdd(hCnt, 0x8000, 0x1000, ".data", 0, NULL), VINF_SUCCESS);
+    for (uint32_t i = 0; i < 64; i++)
+    {
+        char szName[32];
+        RTStrPrintf(szName, sizeof(szName), "tstSym%02u", i);
+        RTTESTI_CHECK_RC(RTDbgModSymbolAdd(hCnt, szName, i & 1, (i / 2) * 0x40, 0x20, 0, NULL), VINF_SUCCESS);
+        char szFile[32];
+        RTStrPrintf(szFile, sizeof(szFile), "tstFile%u.cpp", i % 4);
+        RTTESTI_CHECK_RC(RTDbgModLineAdd(hCnt, szFile, 100 + i, 0, i * 0x10, NULL), VINF_SUCCESS);
+    }
+    RTTESTI_CHECK_RC(RTDbgModSymbolAdd(hCnt, "tstAbs", RTDBGSEGIDX_ABS, 0x1234, 0, 0, NULL), VINF_SUCCESS);
+
+    /*
+     * The cache path follows the environment.
+     */
+    char szPath[RTPATH_MAX];
+    RTTESTI_CHECK_RC(RTEnvUnset(TST_ENV_CACHE_DIR), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(rtDbgModIdxQueryCachePath("tst/RTDbg Mod", g_abKey, sizeof(g_abKey), szPath, sizeof(szPath)),
+                     VERR_NOT_FOUND);
+    RTTESTI_CHECK_RC(RTEnvSet(TST_ENV_CACHE_DIR, pszDir), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(rtDbgModIdxQueryCachePath("tst/RTDbg Mod", g_abKey, sizeof(g_abKey), szPath, sizeof(szPath)),
+                     VINF_SUCCESS);
+    RTTESTI_CHECK_MSG(   RTPathStartsWith(szPath, pszDir)
+                      && !strcmp(RTPathFilename(szPath), "RTDbg_Mod-0123456789abcdeffedcba9876543210deadbeef.rtdbgidx"),
+                      ("%s\n", szPath));
+    RTTESTI_CHECK_RC(RTEnvUnset(TST_ENV_CACHE_DIR), VINF_SUCCESS);
+
+    /*
+     * Write it, read it back and compare with the container.
+     */
+    RTTESTI_CHECK_RC(rtDbgModIdxWrite(szPath, g_abKey, sizeof(g_abKey), hCnt), VINF_SUCCESS);
+    PRTDBGMODIDX pIdx = NULL;
+    RTTESTI_CHECK_RC(rtDbgModIdxOpen(szPath, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VINF_SUCCESS);
+    if (pIdx)
+    {
+        RTTESTI_CHECK(rtDbgModIdxSymbolCount(pIdx) == RTDbgModSymbolCount(hCnt));
+        RTTESTI_CHECK(rtDbgModIdxLineCount(pIdx) == RTDbgModLineCount(hCnt));
+
+        for (uint32_t i = 0; i < RTDbgModSymbolCount(hCnt); i++)
+        {
+            RTDBGSYMBOL SymCnt, SymIdx;
+            RTTESTI_CHECK_RC_BREAK(RTDbgModSymbolByOrdinal(hCnt, i, &SymCnt), VINF_SUCCESS);
+            RTTESTI_CHECK_RC_BREAK(rtDbgModIdxSymbolByOrdinal(pIdx, i, &SymIdx), VINF_SUCCESS);
+            RTTESTI_CHECK_MSG(tstSymEquals(&SymCnt, &SymIdx), ("#%u: %s vs %s\n", i, SymCnt.szName, SymIdx.szName));
+            RTTESTI_CHECK_RC_BREAK(rtDbgModIdxSymbolByName(pIdx, SymCnt.szName, &SymIdx), VINF_SUCCESS);
+            RTTESTI_CHECK_MSG(tstSymEquals(&SymCnt, &SymIdx), ("'%s' vs '%s'\n", SymCnt.szName, SymIdx.szName));
+            if (SymCnt.iSeg == RTDBGSEGIDX_ABS)
+                continue;
+
+            for (uint32_t fFlags = 0; fFlags <= RTDBGSYMADDR_FLAGS_VALID_MASK; fFlags++)
+            {
+                RTDBGSYMBOL SymCntAddr, SymIdxAddr;
+                RTINTPTR    offDispCnt = 0, offDispIdx = 0;
+                int rcCnt = RTDbgModSymbolByAddr(hCnt, SymCnt.iSeg, SymCnt.offSeg + 0x30, fFlags, &offDispCnt, &SymCntAddr);
+                int rcIdx = rtDbgModIdxSymbolByAddr(pIdx, SymCnt.iSeg, SymCnt.offSeg + 0x30, fFlags, &offDispIdx, &SymIdxAddr);
+                RTTESTI_CHECK_MSG(   rcCnt == rcIdx
+                                  && (   RT_FAILURE(rcCnt)
+                                      || (offDispCnt == offDispIdx && tstSymEquals(&SymCntAddr, &SymIdxAddr))),
+                                  ("#%u/%u: %Rrc %s%+RTptr vs %Rrc %s%+RTptr\n", i, fFlags, rcCnt, SymCntAddr.szName,
+                                   offDispCnt, rcIdx, SymIdxAddr.szName, offDispIdx));
+            }
+        }
+        RTDBGSYMBOL Sym;
+        RTTESTI_CHECK_RC(rtDbgModIdxSymbolByName(pIdx, "tstNoSuchSymbol", &Sym), VERR_SYMBOL_NOT_FOUND);
+
+        for (uint32_t i = 0; i < RTDbgModLineCount(hCnt); i++)
+        {
+            RTDBGLINE LineCnt, LineIdx;
+            RTTESTI_CHECK_RC_BREAK(RTDbgModLineByOrdinal(hCnt, i, &LineCnt), VINF_SUCCESS);
+            RTTESTI_CHECK_RC_BREAK(rtDbgModIdxLineByOrdinal(pIdx, i, &LineIdx), VINF_SUCCESS);
+            RTTESTI_CHECK(tstLineEquals(&LineCnt, &LineIdx));
+
+            RTINTPTR offDispCnt = 0, offDispIdx = 0;
+            RTTESTI_CHECK_RC_BREAK(RTDbgModLineByAddr(hCnt, LineCnt.iSeg, LineCnt.offSeg + 4, &offDispCnt, &LineCnt), VINF_SUCCESS);
+            RTTESTI_CHECK_RC_BREAK(rtDbgModIdxLineByAddr(pIdx, LineIdx.iSeg, LineIdx.offSeg + 4, &offDispIdx, &LineIdx), VINF_SUCCESS);
+            RTTESTI_CHECK(offDispCnt == offDispIdx && tstLineEquals(&LineCnt, &LineIdx));
+        }
+        rtDbgModIdxClose(pIdx);
+    }
+
+    /*
+     * Stale and corrupt index files must be rejected.
+     */
+    RTTestSub(g_hTest, "Index file rejection");
+    uint8_t abOtherKey[sizeof(g_abKey)];
+    memcpy(abOtherKey, g_abKey, sizeof(abOtherKey));
+    abOtherKey[sizeof(abOtherKey) - 1] ^= 0x80;
+    pIdx = NULL;
+    RTTESTI_CHECK_RC(rtDbgModIdxOpen(szPath, abOtherKey, sizeof(abOtherKey), hCnt, &pIdx), VERR_MISMATCH);
+    RTTESTI_CHECK(pIdx == NULL);
+    RTTESTI_CHECK_RC(rtDbgModIdxOpen(szPath, g_abKey, sizeof(g_abKey) - 1, hCnt, &pIdx), VERR_MISMATCH);
+
+    /* Same key, but the image layout changed. */
+    RTDBGMOD hCnt2;
+    RTTESTI_CHECK_RC(RTDbgModCreate(&hCnt2, "tstRTDbgMod2", 0, 0), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTDbgModSegmentAdd(hCnt2, 0x1000, 0x5000, ".text", 0, NULL), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTDbgModSegmentAdd(hCnt2, 0x8000, 0x1000, ".data", 0, NULL), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(rtDbgModIdxOpen(szPath, g_abKey, sizeof(g_abKey), hCnt2, &pIdx), VERR_BAD_EXE_FORMAT);
+    RTDbgModRelease(hCnt2);
+
+    void  *pvFile = NULL;
+    size_t cbFile = 0;
+    RTTESTI_CHECK_RC(RTFileReadAll(szPath, &pvFile, &cbFile), VINF_SUCCESS);
+    if (pvFile && cbFile > 512)
+    {
+        uint8_t *pbCopy = (uint8_t *)RTMemDup(pvFile, cbFile);
+        RTTESTI_CHECK_RETV(pbCopy);
+        char szCopy[RTPATH_MAX];
+        RTTESTI_CHECK_RC(RTStrCopy(szCopy, sizeof(szCopy), szPath), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(RTStrCat(szCopy, sizeof(szCopy), "-corrupt"), VINF_SUCCESS);
+
+        /* Empty and truncated. */
+        RTTESTI_CHECK_RC(tstWriteFile(szCopy, pbCopy, 0), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(rtDbgModIdxOpen(szCopy, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VERR_INVALID_EXE_SIGNATURE);
+        RTTESTI_CHECK_RC(tstWriteFile(szCopy, pbCopy, cbFile / 2), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(rtDbgModIdxOpen(szCopy, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VERR_BAD_EXE_FORMAT);
+        RTTESTI_CHECK_RC(tstWriteFile(szCopy, pbCopy, cbFile - 1), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(rtDbgModIdxOpen(szCopy, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VERR_BAD_EXE_FORMAT);
+
+        /* Bad signature. */
+        pbCopy[0] ^= 0x20;
+        RTTESTI_CHECK_RC(tstWriteFile(szCopy, pbCopy, cbFile), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(rtDbgModIdxOpen(szCopy, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VERR_INVALID_EXE_SIGNATURE);
+        pbCopy[0] ^= 0x20;
+
+        /* Garbage tables (the header is well below 256 bytes). */
+        memset(&pbCopy[256], 0xff, cbFile - 256);
+        RTTESTI_CHECK_RC(tstWriteFile(szCopy, pbCopy, cbFile), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(rtDbgModIdxOpen(szCopy, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VERR_BAD_EXE_FORMAT);
+        RTTESTI_CHECK(pIdx == NULL);
+
+        RTTESTI_CHECK_RC(RTFileDelete(szCopy), VINF_SUCCESS);
+        RTMemFree(pbCopy);
+    }
+    else
+        RTTestIFailed("Index file too small: %zu bytes\n", cbFile);
+    RTFileReadAllFree(pvFile, cbFile);
+
+    RTTESTI_CHECK_RC(RTFileDelete(szPath), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(rtDbgModIdxOpen(szPath, g_abKey, sizeof(g_abKey), hCnt, &pIdx), VERR_FILE_NOT_FOUND);
+    RTDbgModRelease(hCnt);
+}
+
+
+/**
+ * Looks for the index file of the image in the cache directory.
+ *
+ * @returns true if exactly one was found, false if not.
+ * @param   pszDir      The cache directory.
+ * @param   pszPath     Where to return the path.
+ * @param   cbPath      The size of the buffer.
+ */
+static bool tstFindIndexFile(const char *pszDir, char *pszPath, size_t cbPath)
+{
+    char szFilter[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RET(RTPathJoin(szFilter, sizeof(szFilter), pszDir, "*.rtdbgidx"), VINF_SUCCESS, false);
+    PRTDIR hDir;
+    RTTESTI_CHECK_RC_RET(RTDirOpenFiltered(&hDir, szFilter, RTDIRFILTER_WINNT, 0), VINF_SUCCESS, false);
+    uint32_t   cFound = 0;
+    RTDIRENTRY Entry;
+    while (RT_SUCCESS(RTDirRead(hDir, &Entry, NULL)))
+        if (   cFound++ == 0
+            && RT_FAILURE(RTPathJoin(pszPath, cbPath, pszDir, Entry.szName)))
+            cFound = UINT32_MAX / 2;
+    RTDirClose(hDir);
+    return cFound == 1;
+}
+
+
+/**
+ * Tests lazy DWARF loading and the index cache using our own executable.
+ *
+ * @param   pszDir      Scratch directory for the index cache.
+ */
+static void tstDwarfImage(const char *pszDir)
+{
+    RTTestSub(g_hTest, "Lazy DWARF loading");
+
+    char szExe[RTPATH_MAX];
+    RTTESTI_CHECK_RETV(RTProcGetExecutablePath(szExe, sizeof(szExe)) != NULL);
+    RTTESTI_CHECK_RC(RTEnvUnset(TST_ENV_CACHE_DIR), VINF_SUCCESS);
+
+    /* The reference: everything loaded up front. */
+    RTDBGMOD hRef;
+    int rc = RTDbgModCreateFromImage(&hRef, szExe, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG);
+    if (RT_FAILURE(rc))
+    {
+        RTTestSkipped(g_hTest, "RTDbgModCreateFromImage(%s) -> %Rrc", szExe, rc);
+        return;
+    }
+    uint32_t const cSymbols = RTDbgModSymbolCount(hRef);
+    uint32_t const cLines   = RTDbgModLineCount(hRef);
+    RTTestIPrintf(RTTESTLVL_ALWAYS, "%s: %u symbols, %u line numbers\n", szExe, cSymbols, cLines);
+    if (!cSymbols || !cLines)
+    {
+        RTTestSkipped(g_hTest, "No DWARF debug info in '%s'", szExe);
+        RTDbgModRelease(hRef);
+        return;
+    }
+
+    /* Address lookups first so units are loaded one by one, then the rest. */
+    RTDBGMOD hLazy;
+    RTTESTI_CHECK_RC(rc = RTDbgModCreateFromImage(&hLazy, szExe, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG), VINF_SUCCESS);
+    if (RT_SUCCESS(rc))
+    {
+        tstCompareAddrLookups(hRef, hLazy);
+        tstCompareAll(hRef, hLazy);
+        tstCompareAddrLookups(hRef, hLazy);
+        RTDbgModRelease(hLazy);
+    }
+
+    /*
+     * The index cache: written after a full load, used by the next open.
+     */
+    RTTestSub(g_hTest, "Index cache");
+    RTTESTI_CHECK_RC(RTEnvSet(TST_ENV_CACHE_DIR, pszDir), VINF_SUCCESS);
+    RTDBGMOD hMod;
+    RTTESTI_CHECK_RC(rc = RTDbgModCreateFromImage(&hMod, szExe, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG), VINF_SUCCESS);
+    if (RT_SUCCESS(rc))
+    {
+        tstCompareAll(hRef, hMod);
+        RTDbgModRelease(hMod);
+    }
+
+    char szIdx[RTPATH_MAX];
+    if (tstFindIndexFile(pszDir, szIdx, sizeof(szIdx)))
+    {
+        uint64_t cbIdx = 0;
+        RTTESTI_CHECK_RC(RTFileQuerySize(szIdx, &cbIdx), VINF_SUCCESS);
+
+        RTTESTI_CHECK_RC(rc = RTDbgModCreateFromImage(&hMod, szExe, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG), VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            tstCompareAddrLookups(hRef, hMod);
+            tstCompareAll(hRef, hMod);
+            RTDbgModRelease(hMod);
+        }
+
+        /* A corrupt index is ignored, and replaced after the next full load. */
+        RTTestSub(g_hTest, "Corrupt index cache");
+        RTFILE hFile;
+        RTTESTI_CHECK_RC(rc = RTFileOpen(&hFile, szIdx, RTFILE_O_WRITE | RTFILE_O_OPEN | RTFILE_O_DENY_NONE), VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            RTTESTI_CHECK_RC(RTFileSetSize(hFile, cbIdx / 2), VINF_SUCCESS);
+            RTFileClose(hFile);
+        }
+
+        RTTESTI_CHECK_RC(rc = RTDbgModCreateFromImage(&hMod, szExe, NULL, RTLDRARCH_WHATEVER, NIL_RTDBGCFG), VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            tstCompareAddrLookups(hRef, hMod);
+            tstCompareAll(hRef, hMod);
+            RTDbgModRelease(hMod);
+        }
+        uint64_t cbIdxNew = 0;
+        RTTESTI_CHECK_RC(RTFileQuerySize(szIdx, &cbIdxNew), VINF_SUCCESS);
+        RTTESTI_CHECK_MSG(cbIdxNew == cbIdx, ("%RU64 vs %RU64\n", cbIdxNew, cbIdx));
+    }
+    else
+        RTTestSkipped(g_hTest, "No index file was written (no build ID?)");
+
+    RTTESTI_CHECK_RC(RTEnvUnset(TST_ENV_CACHE_DIR), VINF_SUCCESS);
+    RTDbgModRelease(hRef);
+}
+
+
+int main()
+{
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTDbgMod", &g_hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(g_hTest);
+
+    char szDir[RTPATH_MAX];
+    int rc = RTPathTemp(szDir, sizeof(szDir));
+    if (RT_SUCCESS(rc))
+        rc = RTPathAppend(szDir, sizeof(szDir), "tstRTDbgMod-XXXXXX");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreateTemp(szDir, 0700);
+    if (RT_SUCCESS(rc))
+    {
+        tstIndexFile(szDir);
+        tstDwarfImage(szDir);
+        RTDirRemoveRecursive(szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+    }
+    else
+        RTTestFailed(g_hTest, "Failed to create a scratch directory: %Rrc", rc);
+
+    return RTTestSummaryAndDestroy(g_hTest);
+}
+
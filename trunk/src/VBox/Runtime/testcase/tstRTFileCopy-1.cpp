@@ -0,0 +1,354 @@
+/* $Id$ */
+/** @file
+ * IPRT Testcase - RTFileCopy, RTFileCopyPart, RTFileClone and RTFileQueryDataRange.
+ */
+
+/*
+ * Copyright (C) 2016 Oracle Corporation
+ *
+ * This file is part of VirtualBox Open Source Edition (OSE), as
+ * available from http://www.virtualbox.org. This file is free software;
+ * you can redistribute it and/or modify it under the terms of the GNU
+ * General Public License (GPL) as published by the Free Software
+ * Foundation, in version 2 as it comes in the "COPYING" file of the
+ * VirtualBox OSE distribution. VirtualBox OSE is distributed in the
+ * hope that it will be useful, but WITHOUT ANY WARRANTY of any kind.
+ *
+ * The contents of this file may alternatively be used under the terms
+ * of the Common Development and Distribution License Version 1.0
+ * (CDDL) only, as it comes in the "COPYING.CDDL" file of the
+ * VirtualBox OSE distribution, in which case the provisions of the
+ * CDDL are applicable instead of those of the GPL.
+ *
+ * You may elect to license modified versions of this file under the
+ * terms and conditions of either the GPL or the CDDL or both.
+ */
+
+
+/*********************************************************************************************************************************
+*   Header Files                                                                                                                 *
+*********************************************************************************************************************************/
+#include <iprt/file.h>
+
+#include <iprt/asm.h>
+#include <iprt/dir.h>
+#include <iprt/err.h>
+#include <iprt/mem.h>
+#include <iprt/path.h>
+#include <iprt/string.h>
+#include <iprt/test.h>
+
+
+/*********************************************************************************************************************************
+*   Defined Constants And Macros                                                                                                 *
+*********************************************************************************************************************************/
+/** Size of the sparse source file. */
+#define TST_FILE_SIZE       (_4M + _64K)
+/** Size of each data block written to the source file. */
+#define TST_BLOCK_SIZE      _64K
+/** Maximum number of data ranges we keep track of. */
+#define TST_MAX_RANGES      64
+
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** A data range as returned by RTFileQueryDataRange. */
+typedef struct TSTRANGE
+{
+    uint64_t    off;
+    uint64_t    cb;
+} TSTRANGE;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Where the data blocks of the source file go, the rest are holes. */
+static uint64_t const g_aoffBlocks[] = { 0, _1M, _2M + _512K, TST_FILE_SIZE - TST_BLOCK_SIZE };
+
+
+/**
+ * Creates the sparse source file, the block at @a g_aoffBlocks[i] being
+ * filled with the byte i + 1.
+ */
+static int tstCreateSparseFile(const char *pszFilename)
+{
+    RTFILE hFile;
+    int rc = RTFileOpen(&hFile, pszFilename, RTFILE_O_WRITE | RTFILE_O_DENY_NONE | RTFILE_O_CREATE_REPLACE);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    uint8_t *pbBlock = (uint8_t *)RTMemTmpAlloc(TST_BLOCK_SIZE);
+    if (pbBlock)
+    {
+        rc = RTFileSetSize(hFile, TST_FILE_SIZE);
+        for (unsigned i = 0; i < RT_ELEMENTS(g_aoffBlocks) && RT_SUCCESS(rc); i++)
+        {
+            memset(pbBlock, i + 1, TST_BLOCK_SIZE);
+            rc = RTFileWriteAt(hFile, g_aoffBlocks[i], pbBlock, TST_BLOCK_SIZE, NULL);
+        }
+        RTMemTmpFree(pbBlock);
+    }
+    else
+        rc = VERR_NO_TMP_MEMORY;
+
+    int rc2 = RTFileClose(hFile);
+    if (RT_SUCCESS(rc))
+        rc = rc2;
+    return rc;
+}
+
+
+/**
+ * Collects the data ranges of a file.
+ *
+ * @returns IPRT status code, VERR_NOT_SUPPORTED if the file system can't tell.
+ */
+static int tstQueryDataRanges(const char *pszFilename, TSTRANGE *paRanges, unsigned *pcRanges)
+{
+    RTFILE hFile;
+    int rc = RTFileOpen(&hFile, pszFilename, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN);
+    if (RT_FAILURE(rc))
+        return rc;
+
+    unsigned cRanges = 0;
+    uint64_t off = 0;
+    for (;;)
+    {
+        uint64_t offData;
+        uint64_t cbData;
+        rc = RTFileQueryDataRange(hFile, off, &offData, &cbData);
+        if (rc == VERR_EOF)
+        {
+            rc = VINF_SUCCESS;
+            break;
+        }
+        if (RT_FAILURE(rc))
+            break;
+        if (cRanges >= TST_MAX_RANGES || cbData == 0)
+        {
+            rc = VERR_TOO_MUCH_DATA;
+            break;
+        }
+        paRanges[cRanges].off = offData;
+        paRanges[cRanges].cb  = cbData;
+        cRanges++;
+        off = offData + cbData;
+    }
+
+    RTFileClose(hFile);
+    *pcRanges = cRanges;
+    return rc;
+}
+
+
+/**
+ * Checks that the copy has the content of the source and no data where the
+ * source has holes.
+ */
+static void tstCheckCopy(const char *pszSrc, const char *pszDst)
+{
+    RTTESTI_CHECK_RC_RETV(RTFileCompare(pszSrc, pszDst), VINF_SUCCESS);
+
+    TSTRANGE    aSrc[TST_MAX_RANGES];
+    unsigned    cSrc = 0;
+    int rc = tstQueryDataRanges(pszSrc, aSrc, &cSrc);
+    if (rc == VERR_NOT_SUPPORTED)
+    {
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "The file system cannot tell holes, skipping the hole checks.\n");
+        return;
+    }
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+    if (cSrc == 1 && aSrc[0].off == 0 && aSrc[0].cb >= TST_FILE_SIZE)
+    {
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "The file system doesn't keep holes, skipping the hole checks.\n");
+        return;
+    }
+
+    TSTRANGE    aDst[TST_MAX_RANGES];
+    unsigned    cDst = 0;
+    RTTESTI_CHECK_RC_RETV(tstQueryDataRanges(pszDst, aDst, &cDst), VINF_SUCCESS);
+
+    /* Every data range of the copy must lie within one of the source. */
+    for (unsigned iDst = 0; iDst < cDst; iDst++)
+    {
+        bool fFound = false;
+        for (unsigned iSrc = 0; iSrc < cSrc && !fFound; iSrc++)
+            fFound =    aDst[iDst].off >= aSrc[iSrc].off
+                     && aDst[iDst].off + aDst[iDst].cb <= aSrc[iSrc].off + aSrc[iSrc].cb;
+        if (!fFound)
+            RTTestIFailed("Data at %#RX64 LB %#RX64 in the copy where the source has a hole",
+                          aDst[iDst].off, aDst[iDst].cb);
+    }
+}
+
+
+static void tstQueryDataRange(const char *pszDir)
+{
+    RTTestISub("RTFileQueryDataRange");
+
+    char szSrc[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szSrc, sizeof(szSrc), pszDir, "sparse"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(tstCreateSparseFile(szSrc), VINF_SUCCESS);
+
+    TSTRANGE    aRanges[TST_MAX_RANGES];
+    unsigned    cRanges = 0;
+    int rc = tstQueryDataRanges(szSrc, aRanges, &cRanges);
+    if (rc == VERR_NOT_SUPPORTED)
+    {
+        RTTestSkipped(NIL_RTTEST, "not supported by the file system");
+        return;
+    }
+    RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+
+    /* Each block written must be covered by data. */
+    for (unsigned i = 0; i < RT_ELEMENTS(g_aoffBlocks); i++)
+    {
+        bool fFound = false;
+        for (unsigned iRange = 0; iRange < cRanges && !fFound; iRange++)
+            fFound =    g_aoffBlocks[i] >= aRanges[iRange].off
+                     && g_aoffBlocks[i] + TST_BLOCK_SIZE <= aRanges[iRange].off + aRanges[iRange].cb;
+        if (!fFound)
+            RTTestIFailed("Block #%u at %#RX64 not within a data range", i, g_aoffBlocks[i]);
+    }
+
+    /* Nothing to find past the end. */
+    RTFILE hFile;
+    RTTESTI_CHECK_RC_RETV(RTFileOpen(&hFile, szSrc, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN), VINF_SUCCESS);
+    uint64_t offData = 0;
+    uint64_t cbData  = 0;
+    RTTESTI_CHECK_RC(RTFileQueryDataRange(hFile, TST_FILE_SIZE, &offData, &cbData), VERR_EOF);
+    RTFileClose(hFile);
+}
+
+
+static void tstCopyPart(const char *pszDir)
+{
+    RTTestISub("RTFileCopyPart");
+
+    char szSrc[RTPATH_MAX];
+    char szDst[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szSrc, sizeof(szSrc), pszDir, "sparse"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szDst, sizeof(szDst), pszDir, "part"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(tstCreateSparseFile(szSrc), VINF_SUCCESS);
+
+    RTFILE hSrc;
+    RTFILE hDst;
+    RTTESTI_CHECK_RC_RETV(RTFileOpen(&hSrc, szSrc, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN), VINF_SUCCESS);
+    int rc = RTFileOpen(&hDst, szDst, RTFILE_O_READWRITE | RTFILE_O_DENY_NONE | RTFILE_O_CREATE_REPLACE);
+    RTTESTI_CHECK_RC_OK(rc);
+    if (RT_SUCCESS(rc))
+    {
+        /* Copy the second block to the start of the destination, possibly in parts. */
+        uint64_t off = 0;
+        while (off < TST_BLOCK_SIZE)
+        {
+            uint64_t cbCopied = 0;
+            rc = RTFileCopyPart(hSrc, g_aoffBlocks[1] + off, hDst, off, TST_BLOCK_SIZE - off, 0 /*fFlags*/, &cbCopied);
+            if (RT_FAILURE(rc) || !cbCopied)
+                break;
+            off += cbCopied;
+        }
+        if (rc == VERR_NOT_SUPPORTED)
+            RTTestSkipped(NIL_RTTEST, "not supported by the host or file system");
+        else if (RT_SUCCESS(rc))
+        {
+            RTTESTI_CHECK(off == TST_BLOCK_SIZE);
+
+            uint8_t *pbBlock = (uint8_t *)RTMemTmpAlloc(TST_BLOCK_SIZE);
+            RTTESTI_CHECK(pbBlock != NULL);
+            if (pbBlock)
+            {
+                RTTESTI_CHECK_RC(rc = RTFileReadAt(hDst, 0, pbBlock, TST_BLOCK_SIZE, NULL), VINF_SUCCESS);
+                if (RT_SUCCESS(rc))
+                    RTTESTI_CHECK(ASMMemIsAllU8(pbBlock, TST_BLOCK_SIZE, 2));
+                RTMemTmpFree(pbBlock);
+            }
+
+            /* Copying from the end of the source gives nothing. */
+            uint64_t cbCopied = 42;
+            RTTESTI_CHECK_RC(RTFileCopyPart(hSrc, TST_FILE_SIZE, hDst, 0, _4K, 0 /*fFlags*/, &cbCopied), VINF_SUCCESS);
+            RTTESTI_CHECK(cbCopied == 0);
+        }
+        else
+            RTTestIFailed("RTFileCopyPart -> %Rrc", rc);
+        RTFileClose(hDst);
+    }
+    RTFileClose(hSrc);
+}
+
+
+static void tstClone(const char *pszDir)
+{
+    RTTestISub("RTFileClone");
+
+    char szSrc[RTPATH_MAX];
+    char szDst[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szSrc, sizeof(szSrc), pszDir, "sparse"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szDst, sizeof(szDst), pszDir, "clone"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(tstCreateSparseFile(szSrc), VINF_SUCCESS);
+
+    RTFILE hSrc;
+    RTFILE hDst;
+    RTTESTI_CHECK_RC_RETV(RTFileOpen(&hSrc, szSrc, RTFILE_O_READ | RTFILE_O_DENY_NONE | RTFILE_O_OPEN), VINF_SUCCESS);
+    int rc = RTFileOpen(&hDst, szDst, RTFILE_O_READWRITE | RTFILE_O_DENY_NONE | RTFILE_O_CREATE_REPLACE);
+    RTTESTI_CHECK_RC_OK(rc);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTFileClone(hSrc, hDst);
+        RTFileClose(hDst);
+        if (rc == VERR_NOT_SUPPORTED)
+            RTTestSkipped(NIL_RTTEST, "not supported by the host or file system");
+        else if (RT_SUCCESS(rc))
+            tstCheckCopy(szSrc, szDst);
+        else
+            RTTestIFailed("RTFileClone -> %Rrc", rc);
+    }
+    RTFileClose(hSrc);
+}
+
+
+static void tstCopy(const char *pszDir)
+{
+    RTTestISub("RTFileCopy");
+
+    char szSrc[RTPATH_MAX];
+    char szDst[RTPATH_MAX];
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szSrc, sizeof(szSrc), pszDir, "sparse"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(RTPathJoin(szDst, sizeof(szDst), pszDir, "copy"), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_RETV(tstCreateSparseFile(szSrc), VINF_SUCCESS);
+
+    RTTESTI_CHECK_RC_RETV(RTFileCopy(szSrc, szDst), VINF_SUCCESS);
+    tstCheckCopy(szSrc, szDst);
+}
+
+
+int main()
+{
+    RTTEST hTest;
+    RTEXITCODE rcExit = RTTestInitAndCreate("tstRTFileCopy-1", &hTest);
+    if (rcExit != RTEXITCODE_SUCCESS)
+        return rcExit;
+    RTTestBanner(hTest);
+
+    char szDir[RTPATH_MAX];
+    int rc = RTPathTemp(szDir, sizeof(szDir));
+    if (RT_SUCCESS(rc))
+        rc = RTPathAppend(szDir, sizeof(szDir), "tstRTFileCopy-1-XXXXXX");
+    if (RT_SUCCESS(rc))
+        rc = RTDirCreateTemp(szDir, 0700);
+    if (RT_SUCCESS(rc))
+    {
+        tstQueryDataRange(szDir);
+        tstCopyPart(szDir);
+        tstClone(szDir);
+        tstCopy(szDir);
+        RTDirRemoveRecursive(szDir, RTDIRRMREC_F_CONTENT_AND_DIR);
+    }
+    else
+        RTTestFailed(hTest, "Failed to create a scratch directory: %Rrc", rc);
+
+    return RTTestSummaryAndDestroy(hTest);
+}
+
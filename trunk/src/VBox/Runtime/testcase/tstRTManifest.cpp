@@ -32,8 +32,11 @@
 
 #include <iprt/string.h>
 #include <iprt/err.h>
+#include <iprt/file.h>
 #include <iprt/mem.h>
+#include <iprt/sha.h>
 #include <iprt/test.h>
+#include <iprt/vfs.h>
 
 
 
@@ -97,6 +100,93 @@ static void tst1(void)
 }
 
 
+/**
+ * Hashing of streams large enough to be handed to the worker threads.
+ */
+static void tst2(void)
+{
+    RTTestISub("Large streams");
+
+    /* Something big enough to take the asynchronous path, not a multiple of the ring buffer size. */
+    size_t const cbData = _16M + _64K + 17;
+    uint8_t *pbData = (uint8_t *)RTMemAlloc(cbData);
+    RTTESTI_CHECK_RETV(pbData);
+    for (size_t i = 0; i < cbData; i++)
+        pbData[i] = (uint8_t)((i * UINT32_C(2654435761)) >> 13);
+
+    char szSha1[RTSHA1_DIGEST_LEN + 1];
+    uint8_t abSha1[RTSHA1_HASH_SIZE];
+    RTSha1(pbData, cbData, abSha1);
+    RTTESTI_CHECK_RC(RTSha1ToString(abSha1, szSha1, sizeof(szSha1)), VINF_SUCCESS);
+
+    char szSha256[RTSHA256_DIGEST_LEN + 1];
+    uint8_t abSha256[RTSHA256_HASH_SIZE];
+    RTSha256(pbData, cbData, abSha256);
+    RTTESTI_CHECK_RC(RTSha256ToString(abSha256, szSha256, sizeof(szSha256)), VINF_SUCCESS);
+
+    uint32_t const fAttrs = RTMANIFEST_ATTR_SIZE | RTMANIFEST_ATTR_SHA1 | RTMANIFEST_ATTR_SHA256;
+    RTMANIFEST hManifest;
+    RTTESTI_CHECK_RC_RETV(RTManifestCreate(0 /*fFlags*/, &hManifest), VINF_SUCCESS);
+
+    /* Straight stream. */
+    RTVFSIOSTREAM hVfsIos = NIL_RTVFSIOSTREAM;
+    RTTESTI_CHECK_RC(RTVfsIoStrmFromBuffer(RTFILE_O_READ, pbData, cbData, &hVfsIos), VINF_SUCCESS);
+    if (hVfsIos != NIL_RTVFSIOSTREAM)
+    {
+        RTTESTI_CHECK_RC(RTManifestEntryAddIoStream(hManifest, hVfsIos, "stream.bin", fAttrs), VINF_SUCCESS);
+        RTVfsIoStrmRelease(hVfsIos);
+    }
+
+    /* Passthru stream, reading in odd sized chunks. */
+    hVfsIos = NIL_RTVFSIOSTREAM;
+    RTTESTI_CHECK_RC(RTVfsIoStrmFromBuffer(RTFILE_O_READ, pbData, cbData, &hVfsIos), VINF_SUCCESS);
+    if (hVfsIos != NIL_RTVFSIOSTREAM)
+    {
+        RTVFSIOSTREAM hVfsPtIos = NIL_RTVFSIOSTREAM;
+        RTTESTI_CHECK_RC(RTManifestEntryAddPassthruIoStream(hManifest, hVfsIos, "passthru.bin", fAttrs,
+                                                            true /*fReadOrWrite*/, &hVfsPtIos), VINF_SUCCESS);
+        if (hVfsPtIos != NIL_RTVFSIOSTREAM)
+        {
+            size_t const cbBuf = _256K + 3;
+            void *pvBuf = RTMemAlloc(cbBuf);
+            RTTESTI_CHECK(pvBuf != NULL);
+            if (pvBuf)
+            {
+                int    rc;
+                size_t cbRead;
+                while (   RT_SUCCESS(rc = RTVfsIoStrmRead(hVfsPtIos, pvBuf, cbBuf, true /*fBlocking*/, &cbRead))
+                       && rc != VINF_EOF)
+                { /* nothing */ }
+                RTTESTI_CHECK_RC(rc, VINF_EOF);
+                RTMemFree(pvBuf);
+            }
+            RTTESTI_CHECK_RC(RTManifestPtIosAddEntryNow(hVfsPtIos), VINF_SUCCESS);
+            RTVfsIoStrmRelease(hVfsPtIos);
+        }
+        RTVfsIoStrmRelease(hVfsIos);
+    }
+
+    /* Check the results. */
+    static const char * const s_apszEntries[] = { "stream.bin", "passthru.bin" };
+    for (unsigned i = 0; i < RT_ELEMENTS(s_apszEntries); i++)
+    {
+        char szValue[RTSHA512_DIGEST_LEN + 8];
+        RTTESTI_CHECK_RC(RTManifestEntryQueryAttr(hManifest, s_apszEntries[i], NULL, RTMANIFEST_ATTR_SHA1,
+                                                  szValue, sizeof(szValue), NULL), VINF_SUCCESS);
+        RTTESTI_CHECK_MSG(!strcmp(szValue, szSha1), ("%s: %s, expected %s\n", s_apszEntries[i], szValue, szSha1));
+        RTTESTI_CHECK_RC(RTManifestEntryQueryAttr(hManifest, s_apszEntries[i], NULL, RTMANIFEST_ATTR_SHA256,
+                                                  szValue, sizeof(szValue), NULL), VINF_SUCCESS);
+        RTTESTI_CHECK_MSG(!strcmp(szValue, szSha256), ("%s: %s, expected %s\n", s_apszEntries[i], szValue, szSha256));
+        RTTESTI_CHECK_RC(RTManifestEntryQueryAttr(hManifest, s_apszEntries[i], NULL, RTMANIFEST_ATTR_SIZE,
+                                                  szValue, sizeof(szValue), NULL), VINF_SUCCESS);
+        RTTESTI_CHECK_MSG(RTStrToUInt64(szValue) == cbData, ("%s: %s, expected %zu\n", s_apszEntries[i], szValue, cbData));
+    }
+
+    RTManifestRelease(hManifest);
+    RTMemFree(pbData);
+}
+
+
 int main()
 {
     RTTEST hTest;
@@ -106,6 +196,7 @@ int main()
     RTTestBanner(hTest);
 
     tst1();
+    tst2();
 
     return RTTestSummaryAndDestroy(hTest);
 }
@@ -55,6 +55,20 @@ typedef struct TST3THREAD
     bool                fUseCache;
 } TST3THREAD, *PTST3THREAD;
 
+/** A batch of objects handed from one tst4 thread to another. */
+typedef struct TST4BATCH
+{
+    void               *apv[64];
+} TST4BATCH, *PTST4BATCH;
+
+typedef struct TST4THREAD
+{
+    RTTHREAD            hThread;
+    RTSEMEVENTMULTI     hEvt;
+    uint64_t volatile   cIterations;
+    TST4BATCH           aBatches[2];
+} TST4THREAD, *PTST4THREAD;
+
 
 /*********************************************************************************************************************************
 *   Global Variables                                                                                                             *
@@ -65,6 +79,8 @@ static RTTEST               g_hTest;
 static RTMEMCACHE           g_hMemCache;
 /** Stop indicator for tst3 threads.  */
 static bool volatile        g_fTst3Stop;
+/** The batch exchange point for the tst4 threads. */
+static PTST4BATCH volatile  g_pTst4Exchange;
 
 
 /**
@@ -323,6 +339,120 @@ static void tst3AllMethods(uint32_t cThreads, uint32_t cbObject, uint32_t cSecs)
 }
 
 
+/**
+ * Thread that allocates a batch of objects, trades it for a batch allocated
+ * by some other thread and frees that.
+ *
+ * @returns VINF_SUCCESS
+ * @param   hThreadSelf         The thread.
+ * @param   pvArg               Pointer to the TST4THREAD structure.
+ */
+static DECLCALLBACK(int) tst4Thread(RTTHREAD hThreadSelf, void *pvArg)
+{
+    PTST4THREAD pThread     = (PTST4THREAD)pvArg;
+    PTST4BATCH  pCur        = &pThread->aBatches[0];
+    PTST4BATCH  pSpare      = &pThread->aBatches[1];
+    uint64_t    cIterations = 0;
+    RT_NOREF_PV(hThreadSelf);
+
+    RTTEST_CHECK_RC_OK(g_hTest, RTSemEventMultiWait(pThread->hEvt, RT_INDEFINITE_WAIT));
+
+    while (!g_fTst3Stop)
+    {
+        for (unsigned i = 0; i < RT_ELEMENTS(pCur->apv); i++)
+        {
+            pCur->apv[i] = RTMemCacheAlloc(g_hMemCache);
+            RTTEST_CHECK(g_hTest, pCur->apv[i] != NULL);
+        }
+
+        PTST4BATCH pOther = ASMAtomicXchgPtrT(&g_pTst4Exchange, pCur, PTST4BATCH);
+        if (pOther)
+        {
+            for (unsigned i = 0; i < RT_ELEMENTS(pOther->apv); i++)
+                RTMemCacheFree(g_hMemCache, pOther->apv[i]);
+            pCur = pOther;
+        }
+        else
+        {
+            /* Only the first thread to get here gets nothing back. */
+            RTTEST_CHECK(g_hTest, pSpare != NULL);
+            pCur   = pSpare;
+            pSpare = NULL;
+        }
+        cIterations += RT_ELEMENTS(pCur->apv);
+    }
+
+    pThread->cIterations = cIterations;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Benchmark where objects are freed by a different thread than the one
+ * allocating them, which is what the I/O request caches see.
+ */
+static void tst4(uint32_t cThreads, uint32_t cbObject, uint32_t cSecs)
+{
+    RTTestISubF("Benchmark - cross thread, %u threads, %u bytes, %u secs", cThreads, cbObject, cSecs);
+
+    RTTESTI_CHECK_RC_RETV(RTMemCacheCreate(&g_hMemCache, cbObject, 0 /*cbAlignment*/, UINT32_MAX, NULL, NULL, NULL, 0 /*fFlags*/), VINF_SUCCESS);
+
+    RTSEMEVENTMULTI hEvt;
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiCreate(&hEvt));
+
+    static TST4THREAD s_aThreads[64];
+    RTTESTI_CHECK_RETV(cThreads < RT_ELEMENTS(s_aThreads));
+
+    ASMAtomicWriteBool(&g_fTst3Stop, false);
+    ASMAtomicWriteNullPtr(&g_pTst4Exchange);
+    for (uint32_t i = 0; i < cThreads; i++)
+    {
+        s_aThreads[i].hThread     = NIL_RTTHREAD;
+        s_aThreads[i].cIterations = 0;
+        s_aThreads[i].hEvt        = hEvt;
+        RTTESTI_CHECK_RC_OK_RETV(RTThreadCreateF(&s_aThreads[i].hThread, tst4Thread, &s_aThreads[i], 0,
+                                                 RTTHREADTYPE_DEFAULT, RTTHREADFLAGS_WAITABLE, "tst4-%u", i));
+    }
+
+    uint64_t uStartTS = RTTimeNanoTS();
+    RTTESTI_CHECK_RC_OK_RETV(RTSemEventMultiSignal(hEvt));
+    RTThreadSleep(cSecs * 1000);
+    ASMAtomicWriteBool(&g_fTst3Stop, true);
+    for (uint32_t i = 0; i < cThreads; i++)
+        RTTESTI_CHECK_RC_OK_RETV(RTThreadWait(s_aThreads[i].hThread, 60*1000, NULL));
+    uint64_t cElapsedNS = RTTimeNanoTS() - uStartTS;
+
+    /* The last batch traded in is still allocated. */
+    PTST4BATCH pLeft = ASMAtomicXchgPtrT(&g_pTst4Exchange, NULL, PTST4BATCH);
+    if (pLeft)
+        for (unsigned i = 0; i < RT_ELEMENTS(pLeft->apv); i++)
+            RTMemCacheFree(g_hMemCache, pLeft->apv[i]);
+
+    uint64_t cIterations = 0;
+    for (uint32_t i = 0; i < cThreads; i++)
+        cIterations += s_aThreads[i].cIterations;
+    if (cIterations)
+    {
+        RTTestIPrintf(RTTESTLVL_ALWAYS, "%'8u iterations per second, %'llu ns on avg\n",
+                      (unsigned)((long double)cIterations * 1000000000.0 / cElapsedNS),
+                      cElapsedNS / cIterations);
+        RTTestIValueF(cElapsedNS / cIterations, RTTESTUNIT_NS_PER_OCCURRENCE, "cross thread, %u threads, %u bytes",
+                      cThreads, cbObject);
+    }
+
+    RTMEMCACHESTATS Stats;
+    RTTESTI_CHECK_RC(RTMemCacheQueryStats(g_hMemCache, &Stats), VINF_SUCCESS);
+    RTTESTI_CHECK(Stats.cTotal - Stats.cFree == Stats.cMagazineObjs);
+    RTTestIPrintf(RTTESTLVL_ALWAYS,
+                  "%u pages, %u objects, %u in magazines; hits %'llu/%'llu, depot %'llu, refills %'llu, flushes %'llu, busy %'llu\n",
+                  Stats.cPages, Stats.cTotal, Stats.cMagazineObjs, Stats.cAllocHits, Stats.cFreeHits,
+                  Stats.cDepotExchanges, Stats.cRefills, Stats.cFlushes, Stats.cSlotBusy);
+
+    RTTESTI_CHECK_RC(RTMemCacheDestroy(g_hMemCache), VINF_SUCCESS);
+    RTTESTI_CHECK_RC_OK(RTSemEventMultiDestroy(hEvt));
+}
+
+
 int main(int argc, char **argv)
 {
     RT_NOREF_PV(argc); RT_NOREF_PV(argv);
@@ -354,6 +484,10 @@ int main(int argc, char **argv)
         tst3AllMethods(     3,     1, cSecs);
 
         tst3AllMethods(    16,    32, cSecs);
+
+        tst4(               2,   256, cSecs);
+        tst4(               4,   256, cSecs);
+        tst4(              16,    64, cSecs);
     }
 
     /*
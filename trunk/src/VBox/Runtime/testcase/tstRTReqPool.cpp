@@ -30,7 +30,9 @@
 *********************************************************************************************************************************/
 #include <iprt/req.h>
 
+#include <iprt/asm.h>
 #include <iprt/err.h>
+#include <iprt/mp.h>
 #include <iprt/test.h>
 #include <iprt/thread.h>
 #include <iprt/time.h>
@@ -41,6 +43,8 @@
 *   Global Variables                                                                                                             *
 *********************************************************************************************************************************/
 static RTTEST g_hTest = NIL_RTTEST;
+/** Argument array for the batch submissions. */
+static uintptr_t g_auBatchArgs[64];
 
 
 static DECLCALLBACK(int) NopCallback(void)
@@ -48,6 +52,20 @@ static DECLCALLBACK(int) NopCallback(void)
     return VINF_SUCCESS;
 }
 
+static DECLCALLBACK(void) CountCallback(uint32_t volatile *pcCalls)
+{
+    ASMAtomicIncU32(pcCalls);
+}
+
+static void waitForCount(uint32_t volatile *pcCalls, uint32_t cExpected)
+{
+    uint64_t const msStart = RTTimeMilliTS();
+    while (   ASMAtomicReadU32(pcCalls) < cExpected
+           && RTTimeMilliTS() - msStart < RT_MS_1MIN)
+        RTThreadYield();
+    RTTESTI_CHECK_MSG(ASMAtomicReadU32(pcCalls) == cExpected, ("%u, expected %u\n", ASMAtomicReadU32(pcCalls), cExpected));
+}
+
 static void test1(void)
 {
     RTTestISub("Basics");
@@ -132,6 +150,106 @@ static void test2(void)
 }
 
 
+static void test3(void)
+{
+    RTTestISub("Work stealing");
+
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(8, RT_MS_1SEC, UINT32_MAX, UINT32_MAX, "test3", &hPool), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING_THREADS, 4), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING_THREADS) == 4);
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_CPU_AFFINITY, true), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetCfgVar(hPool, RTREQPOOLCFGVAR_CPU_AFFINITY) == 1);
+
+    RTTESTI_CHECK_RC(RTReqPoolCallWait(hPool, (PFNRT)RTThreadSleep, 1, (RTMSINTERVAL)1), VINF_SUCCESS);
+    RTTESTI_CHECK(RTReqPoolGetStat(hPool, RTREQPOOLSTAT_THREADS) == 4);
+
+    /* Mixed single and batch submissions. */
+    uint32_t volatile cCalls = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(g_auBatchArgs); i++)
+        g_auBatchArgs[i] = (uintptr_t)&cCalls;
+    for (unsigned i = 0; i < 1000; i++)
+    {
+        RTTESTI_CHECK_RC_BREAK(RTReqPoolCallVoidNoWait(hPool, (PFNRT)CountCallback, 1, &cCalls), VINF_SUCCESS);
+        RTTESTI_CHECK_RC_BREAK(RTReqPoolCallVoidNoWaitBatch(hPool, (PFNRT)CountCallback, i % RT_ELEMENTS(g_auBatchArgs) + 1,
+                                                            g_auBatchArgs), VINF_SUCCESS);
+    }
+    uint32_t cExpected = 1000;
+    for (unsigned i = 0; i < 1000; i++)
+        cExpected += i % RT_ELEMENTS(g_auBatchArgs) + 1;
+    waitForCount(&cCalls, cExpected);
+
+    /* Longer requests must be spread over the workers. */
+    uint64_t const nsStart = RTTimeNanoTS();
+    for (unsigned i = 0; i < 16; i++)
+        RTTESTI_CHECK_RC(RTReqPoolCallNoWait(hPool, (PFNRT)RTThreadSleep, 1, (RTMSINTERVAL)50), VINF_SUCCESS);
+    RTTESTI_CHECK_RC(RTReqPoolCallWait(hPool, (PFNRT)RTThreadSleep, 1, (RTMSINTERVAL)0), VINF_SUCCESS);
+    while (RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_PENDING) > 0 || RTReqPoolGetStat(hPool, RTREQPOOLSTAT_REQUESTS_ACTIVE) > 0)
+        RTThreadSleep(1);
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTESTI_CHECK_MSG(cNsElapsed < UINT64_C(16) * 50 * RT_NS_1MS / 2, ("%RU64 ns\n", cNsElapsed));
+
+    /* Cannot switch modes after starting. */
+    RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING_THREADS, 2), VERR_WRONG_ORDER);
+
+    RTTESTI_CHECK(RTReqPoolRelease(hPool) == 0);
+}
+
+
+/**
+ * Throughput and latency benchmark for one pool configuration.
+ */
+static void benchmarkOne(const char *pszMode, bool fWorkStealing)
+{
+    uint32_t const cThreads = RT_MAX(RTMpGetOnlineCount(), 2);
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(cThreads, RT_MS_1SEC, UINT32_MAX, UINT32_MAX, "bench", &hPool), VINF_SUCCESS);
+    if (fWorkStealing)
+        RTTESTI_CHECK_RC(RTReqPoolSetCfgVar(hPool, RTREQPOOLCFGVAR_WORK_STEALING_THREADS, cThreads), VINF_SUCCESS);
+
+    /* Latency: one request at a time, waiting for each. */
+    uint32_t const cLatencyCalls = 10000;
+    uint64_t nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cLatencyCalls; i++)
+        RTTESTI_CHECK_RC_BREAK(RTReqPoolCallWait(hPool, (PFNRT)NopCallback, 0), VINF_SUCCESS);
+    uint64_t cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestIValueF(cNsElapsed / cLatencyCalls, RTTESTUNIT_NS_PER_CALL, "%s latency", pszMode);
+
+    /* Throughput: lots of tiny no-wait requests. */
+    uint32_t const   cThroughputCalls = 200000;
+    uint32_t volatile cCalls = 0;
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cThroughputCalls; i++)
+        RTTESTI_CHECK_RC_BREAK(RTReqPoolCallVoidNoWait(hPool, (PFNRT)CountCallback, 1, &cCalls), VINF_SUCCESS);
+    waitForCount(&cCalls, cThroughputCalls);
+    cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestIValueF(cNsElapsed / cThroughputCalls, RTTESTUNIT_NS_PER_CALL, "%s throughput", pszMode);
+
+    /* Batch throughput. */
+    cCalls = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(g_auBatchArgs); i++)
+        g_auBatchArgs[i] = (uintptr_t)&cCalls;
+    nsStart = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cThroughputCalls; i += RT_ELEMENTS(g_auBatchArgs))
+        RTTESTI_CHECK_RC_BREAK(RTReqPoolCallVoidNoWaitBatch(hPool, (PFNRT)CountCallback, RT_ELEMENTS(g_auBatchArgs),
+                                                            g_auBatchArgs), VINF_SUCCESS);
+    uint32_t const cBatchCalls = RT_ALIGN_32(cThroughputCalls, RT_ELEMENTS(g_auBatchArgs));
+    waitForCount(&cCalls, cBatchCalls);
+    cNsElapsed = RTTimeNanoTS() - nsStart;
+    RTTestIValueF(cNsElapsed / cBatchCalls, RTTESTUNIT_NS_PER_CALL, "%s batch throughput", pszMode);
+
+    RTTESTI_CHECK(RTReqPoolRelease(hPool) == 0);
+}
+
+
+static void test4(void)
+{
+    RTTestISub("Queue Benchmark");
+    benchmarkOne("single-queue", false);
+    benchmarkOne("work-stealing", true);
+}
+
+
 int main()
 {
     RTEXITCODE rcExit = RTTestInitAndCreate("tstRTReqPool", &g_hTest);
@@ -143,6 +261,8 @@ int main()
     if (RTTestIErrorCount() == 0)
     {
         test2();
+        test3();
+        test4();
     }
     return RTTestSummaryAndDestroy(g_hTest);
 }
@@ -31,7 +31,9 @@
 #include <iprt/sort.h>
 
 #include <iprt/err.h>
+#include <iprt/mem.h>
 #include <iprt/rand.h>
+#include <iprt/req.h>
 #include <iprt/string.h>
 #include <iprt/test.h>
 #include <iprt/time.h>
@@ -134,6 +136,197 @@ static void testSorter(RTTEST hTest, FNRTSORT pfnSorter, const char *pszName)
 }
 
 
+static DECLCALLBACK(void) testMergeWrapper(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortMerge(pvArray, cElements, cbElement, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+
+static DECLCALLBACK(void) testApvMergeWrapper(void **papvArray, size_t cElements, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortApvMerge(papvArray, cElements, pfnCmp, pvUser), VINF_SUCCESS);
+}
+
+
+static DECLCALLBACK(void) testParallelWrapper(void *pvArray, size_t cElements, size_t cbElement, PFNRTSORTCMP pfnCmp, void *pvUser)
+{
+    RTTESTI_CHECK_RC(RTSortParallel(pvArray, cElements, cbElement, pfnCmp, pvUser, NIL_RTREQPOOL), VINF_SUCCESS);
+}
+
+
+/**
+ * Element used by the stability, radix and benchmark tests.
+ */
+typedef struct TSTRTSORTKEYED
+{
+    uint64_t    uKey;
+    uint32_t    iOrg;
+    uint32_t    uPadding;
+} TSTRTSORTKEYED;
+
+
+static DECLCALLBACK(int) testKeyedCompare(void const *pvElement1, void const *pvElement2, void *pvUser)
+{
+    TSTRTSORTKEYED const *pElement1 = (TSTRTSORTKEYED const *)pvElement1;
+    TSTRTSORTKEYED const *pElement2 = (TSTRTSORTKEYED const *)pvElement2;
+    uint64_t const        fMask     = (uint64_t)(uintptr_t)pvUser;
+    if ((pElement1->uKey & fMask) < (pElement2->uKey & fMask))
+        return -1;
+    if ((pElement1->uKey & fMask) > (pElement2->uKey & fMask))
+        return 1;
+    return 0;
+}
+
+
+/**
+ * Checks that the keyed array is sorted and, if @a fStable, that equal keys
+ * kept their original order.
+ */
+static bool testKeyedIsSorted(TSTRTSORTKEYED const *paElements, size_t cElements, uint64_t fMask, bool fStable)
+{
+    for (size_t i = 1; i < cElements; i++)
+    {
+        int iDiff = testKeyedCompare(&paElements[i - 1], &paElements[i], (void *)(uintptr_t)fMask);
+        if (iDiff > 0)
+            return false;
+        if (fStable && iDiff == 0 && paElements[i - 1].iOrg > paElements[i].iOrg)
+            return false;
+    }
+    return true;
+}
+
+
+static void testKeyedFill(RTRAND hRand, TSTRTSORTKEYED *paElements, size_t cElements, uint64_t fMask)
+{
+    for (size_t i = 0; i < cElements; i++)
+    {
+        paElements[i].uKey     = RTRandAdvU64(hRand) & fMask;
+        paElements[i].iOrg     = (uint32_t)i;
+        paElements[i].uPadding = 0;
+    }
+}
+
+
+static void testStable(void)
+{
+    RTTestISub("Stability - RTSortMerge, RTSortParallel, RTSortRadixU32/U64");
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+
+    static uint32_t const s_acElements[] = { 0, 1, 2, 17, 1000, 4097, _64K + 3, _256K + 11 };
+    size_t const          cMax           = s_acElements[RT_ELEMENTS(s_acElements) - 1];
+    TSTRTSORTKEYED       *paElements     = (TSTRTSORTKEYED *)RTMemAlloc(cMax * sizeof(TSTRTSORTKEYED));
+    RTTESTI_CHECK_RETV(paElements);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(s_acElements); i++)
+    {
+        size_t const cElements = s_acElements[i];
+
+        /* Few distinct keys so there are lots of ties. */
+        testKeyedFill(hRand, paElements, cElements, 0xf);
+        RTTESTI_CHECK_RC(RTSortMerge(paElements, cElements, sizeof(paElements[0]), testKeyedCompare, (void *)(uintptr_t)0xf),
+                         VINF_SUCCESS);
+        if (!testKeyedIsSorted(paElements, cElements, 0xf, true /*fStable*/))
+            RTTestIFailed("RTSortMerge is not stable (%zu elements)", cElements);
+
+        testKeyedFill(hRand, paElements, cElements, 0xf);
+        RTTESTI_CHECK_RC(RTSortParallel(paElements, cElements, sizeof(paElements[0]), testKeyedCompare,
+                                        (void *)(uintptr_t)0xf, NIL_RTREQPOOL), VINF_SUCCESS);
+        if (!testKeyedIsSorted(paElements, cElements, 0xf, true /*fStable*/))
+            RTTestIFailed("RTSortParallel is not stable (%zu elements)", cElements);
+
+        /* Radix on both the full keys and keys with a few ties. */
+        testKeyedFill(hRand, paElements, cElements, UINT32_MAX);
+        RTTESTI_CHECK_RC(RTSortRadixU32(paElements, cElements, sizeof(paElements[0]), RT_OFFSETOF(TSTRTSORTKEYED, uKey)),
+                         VINF_SUCCESS);
+        if (!testKeyedIsSorted(paElements, cElements, UINT32_MAX, true /*fStable*/))
+            RTTestIFailed("RTSortRadixU32 failed (%zu elements)", cElements);
+
+        testKeyedFill(hRand, paElements, cElements, UINT64_C(0xff000000000000ff));
+        RTTESTI_CHECK_RC(RTSortRadixU64(paElements, cElements, sizeof(paElements[0]), RT_OFFSETOF(TSTRTSORTKEYED, uKey)),
+                         VINF_SUCCESS);
+        if (!testKeyedIsSorted(paElements, cElements, UINT64_MAX, true /*fStable*/))
+            RTTestIFailed("RTSortRadixU64 failed (%zu elements)", cElements);
+    }
+
+    /* Presorted and reversed input is where naive quick sorts go quadratic. */
+    for (size_t i = 0; i < cMax; i++)
+        paElements[i].uKey = i;
+    RTSort(paElements, cMax, sizeof(paElements[0]), testKeyedCompare, (void *)(uintptr_t)UINT64_MAX);
+    RTTESTI_CHECK(testKeyedIsSorted(paElements, cMax, UINT64_MAX, false /*fStable*/));
+    for (size_t i = 0; i < cMax; i++)
+        paElements[i].uKey = cMax - i;
+    RTSort(paElements, cMax, sizeof(paElements[0]), testKeyedCompare, (void *)(uintptr_t)UINT64_MAX);
+    RTTESTI_CHECK(testKeyedIsSorted(paElements, cMax, UINT64_MAX, false /*fStable*/));
+
+    RTMemFree(paElements);
+    RTRandAdvDestroy(hRand);
+}
+
+
+/**
+ * Benchmark worker, returns the nanoseconds taken.
+ */
+static uint64_t testBenchmarkOne(TSTRTSORTKEYED *paWork, TSTRTSORTKEYED const *paInput, size_t cElements, int iAlgo,
+                                 RTREQPOOL hPool)
+{
+    void * const pvUser = (void *)(uintptr_t)UINT64_MAX;
+    memcpy(paWork, paInput, cElements * sizeof(paWork[0]));
+    uint64_t const nsStart = RTTimeNanoTS();
+    switch (iAlgo)
+    {
+        case 0: RTSortShell(paWork, cElements, sizeof(paWork[0]), testKeyedCompare, pvUser); break;
+        case 1: RTSort(paWork, cElements, sizeof(paWork[0]), testKeyedCompare, pvUser); break;
+        case 2: RTSortMerge(paWork, cElements, sizeof(paWork[0]), testKeyedCompare, pvUser); break;
+        case 3: RTSortParallel(paWork, cElements, sizeof(paWork[0]), testKeyedCompare, pvUser, hPool); break;
+        case 4: RTSortRadixU64(paWork, cElements, sizeof(paWork[0]), RT_OFFSETOF(TSTRTSORTKEYED, uKey)); break;
+    }
+    uint64_t const cNsElapsed = RTTimeNanoTS() - nsStart;
+    if (!testKeyedIsSorted(paWork, cElements, UINT64_MAX, false /*fStable*/))
+        RTTestIFailed("algorithm #%d failed sorting %zu elements", iAlgo, cElements);
+    return cNsElapsed;
+}
+
+
+static void testBenchmark(void)
+{
+    RTTestISub("Benchmark");
+
+    RTRAND hRand;
+    RTTESTI_CHECK_RC_OK_RETV(RTRandAdvCreateParkMiller(&hRand));
+    RTREQPOOL hPool;
+    RTTESTI_CHECK_RC_RETV(RTReqPoolCreate(UINT32_MAX, RT_MS_1SEC, UINT32_MAX, 0, "tstSort", &hPool), VINF_SUCCESS);
+
+    static const char * const s_apszAlgos[] = { "RTSortShell", "RTSort", "RTSortMerge", "RTSortParallel", "RTSortRadixU64" };
+    static uint32_t const     s_acElements[] = { _4K, _64K, _1M };
+    size_t const              cMax           = s_acElements[RT_ELEMENTS(s_acElements) - 1];
+    TSTRTSORTKEYED           *paInput        = (TSTRTSORTKEYED *)RTMemAlloc(cMax * sizeof(TSTRTSORTKEYED));
+    TSTRTSORTKEYED           *paWork         = (TSTRTSORTKEYED *)RTMemAlloc(cMax * sizeof(TSTRTSORTKEYED));
+    if (paInput && paWork)
+    {
+        testKeyedFill(hRand, paInput, cMax, UINT64_MAX);
+        for (unsigned iSize = 0; iSize < RT_ELEMENTS(s_acElements); iSize++)
+            for (int iAlgo = 0; iAlgo < (int)RT_ELEMENTS(s_apszAlgos); iAlgo++)
+            {
+                /* Shell sort is far too slow for the big arrays. */
+                if (iAlgo == 0 && s_acElements[iSize] > _64K)
+                    continue;
+                uint64_t cNs = testBenchmarkOne(paWork, paInput, s_acElements[iSize], iAlgo, hPool);
+                RTTestIValueF(cNs / s_acElements[iSize], RTTESTUNIT_NS_PER_OCCURRENCE, "%s, %u elements",
+                              s_apszAlgos[iAlgo], s_acElements[iSize]);
+            }
+    }
+    else
+        RTTestIFailed("out of memory");
+
+    RTMemFree(paInput);
+    RTMemFree(paWork);
+    RTReqPoolRelease(hPool);
+    RTRandAdvDestroy(hRand);
+}
+
+
 int main()
 {
     RTTEST hTest;
@@ -147,6 +340,17 @@ int main()
      */
     testSorter(hTest, RTSortShell, "RTSortShell - shell sort, variable sized element array");
     testApvSorter(RTSortApvShell, "RTSortApvShell - shell sort, pointer array");
+    testSorter(hTest, RTSort, "RTSort - introsort, variable sized element array");
+    testApvSorter(RTSortApv, "RTSortApv - introsort, pointer array");
+    testSorter(hTest, testMergeWrapper, "RTSortMerge - merge sort, variable sized element array");
+    testApvSorter(testApvMergeWrapper, "RTSortApvMerge - merge sort, pointer array");
+    testSorter(hTest, testParallelWrapper, "RTSortParallel - parallel merge sort, variable sized element array");
+    testStable();
+
+    /*
+     * Benchmark.
+     */
+    testBenchmark();
 
     /*
      * Summary.
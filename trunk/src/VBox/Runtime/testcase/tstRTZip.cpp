@@ -41,6 +41,207 @@
 #include <iprt/test.h>
 
 
+#if defined(RTZIP_USE_ZSTD) || defined(RTZIP_USE_LZ4)
+
+/*********************************************************************************************************************************
+*   Structures and Typedefs                                                                                                      *
+*********************************************************************************************************************************/
+/** Memory buffer the stream callbacks write to and read from. */
+typedef struct TSTRTZIPBUF
+{
+    uint8_t    *pb;
+    size_t      cb;
+    size_t      off;
+    size_t      cbMax;
+} TSTRTZIPBUF;
+typedef TSTRTZIPBUF *PTSTRTZIPBUF;
+
+
+/*********************************************************************************************************************************
+*   Global Variables                                                                                                             *
+*********************************************************************************************************************************/
+/** Size of the test input. */
+#define TST_INPUT_SIZE  (_256K + 123)
+/** The test input, half repetitive text and half noise. */
+static uint8_t  g_abInput[TST_INPUT_SIZE];
+
+
+static void tstInitInput(void)
+{
+    static const char s_szText[] = "The quick brown fox jumps over the lazy dog. ";
+    size_t const cbText = TST_INPUT_SIZE / 2;
+    for (size_t off = 0; off < cbText; off++)
+        g_abInput[off] = s_szText[off % (sizeof(s_szText) - 1)];
+
+    /* A simple LCG keeps the noise the same from run to run. */
+    uint32_t uSeed = 0x12345678;
+    for (size_t off = cbText; off < TST_INPUT_SIZE; off++)
+    {
+        uSeed = uSeed * 1103515245 + 12345;
+        g_abInput[off] = (uint8_t)(uSeed >> 16);
+    }
+}
+
+
+static DECLCALLBACK(int) tstZipOut(void *pvUser, const void *pvBuf, size_t cbBuf)
+{
+    PTSTRTZIPBUF pBuf = (PTSTRTZIPBUF)pvUser;
+    if (cbBuf > pBuf->cbMax - pBuf->cb)
+        return VERR_BUFFER_OVERFLOW;
+    memcpy(&pBuf->pb[pBuf->cb], pvBuf, cbBuf);
+    pBuf->cb += cbBuf;
+    return VINF_SUCCESS;
+}
+
+
+static DECLCALLBACK(int) tstZipIn(void *pvUser, void *pvBuf, size_t cbBuf, size_t *pcbBuf)
+{
+    PTSTRTZIPBUF pBuf = (PTSTRTZIPBUF)pvUser;
+    size_t cbLeft = pBuf->cb - pBuf->off;
+    if (!pcbBuf && cbBuf > cbLeft)
+        return VERR_EOF;
+    size_t cbRead = RT_MIN(cbBuf, cbLeft);
+    memcpy(pvBuf, &pBuf->pb[pBuf->off], cbRead);
+    pBuf->off += cbRead;
+    if (pcbBuf)
+        *pcbBuf = cbRead;
+    return VINF_SUCCESS;
+}
+
+
+/**
+ * Decompresses a stream from @a pSrc, returning the status and the output in
+ * @a pbDst (TST_INPUT_SIZE bytes).
+ */
+static int tstZipDecompStream(PTSTRTZIPBUF pSrc, uint8_t *pbDst)
+{
+    PRTZIPDECOMP pZip;
+    pSrc->off = 0;
+    int rc = RTZipDecompCreate(&pZip, pSrc, tstZipIn);
+    if (RT_SUCCESS(rc))
+    {
+        rc = RTZipDecompress(pZip, pbDst, TST_INPUT_SIZE, NULL);
+        int rc2 = RTZipDecompDestroy(pZip);
+        if (RT_SUCCESS(rc))
+            rc = rc2;
+    }
+    return rc;
+}
+
+
+/**
+ * Round trips the test input through RTZipCompCreate / RTZipDecompCreate,
+ * then checks that a corrupted stream fails to decompress.
+ */
+static void tstZipStream(RTZIPTYPE enmType, const char *pszType)
+{
+    RTTestISubF("%s stream", pszType);
+
+    static const RTZIPLEVEL s_aenmLevels[] = { RTZIPLEVEL_FAST, RTZIPLEVEL_DEFAULT, RTZIPLEVEL_MAX };
+    TSTRTZIPBUF Buf;
+    Buf.cbMax = TST_INPUT_SIZE * 2;
+    Buf.pb    = (uint8_t *)RTMemAlloc(Buf.cbMax);
+    uint8_t *pbDst = (uint8_t *)RTMemAlloc(TST_INPUT_SIZE);
+    RTTESTI_CHECK_RETV(Buf.pb && pbDst);
+
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aenmLevels); i++)
+    {
+        Buf.cb  = 0;
+        Buf.off = 0;
+
+        /* Feed the input in odd sized pieces to exercise the buffering. */
+        PRTZIPCOMP pZip;
+        RTTESTI_CHECK_RC_BREAK(RTZipCompCreate(&pZip, &Buf, tstZipOut, enmType, s_aenmLevels[i]), VINF_SUCCESS);
+        int rc = VINF_SUCCESS;
+        for (size_t off = 0; off < TST_INPUT_SIZE && RT_SUCCESS(rc); off += 7777)
+            rc = RTZipCompress(pZip, &g_abInput[off], RT_MIN(7777, TST_INPUT_SIZE - off));
+        RTTESTI_CHECK_RC(rc, VINF_SUCCESS);
+        RTTESTI_CHECK_RC(RTZipCompFinish(pZip), VINF_SUCCESS);
+        RTTESTI_CHECK_RC(RTZipCompDestroy(pZip), VINF_SUCCESS);
+        if (RT_FAILURE(rc))
+            break;
+        RTTESTI_CHECK(Buf.cb > 1 && Buf.cb < TST_INPUT_SIZE);
+
+        memset(pbDst, 0xff, TST_INPUT_SIZE);
+        RTTESTI_CHECK_RC(rc = tstZipDecompStream(&Buf, pbDst), VINF_SUCCESS);
+        if (RT_SUCCESS(rc) && memcmp(pbDst, g_abInput, TST_INPUT_SIZE))
+            RTTestIFailed("level %d: the decompressed stream differs from the input", s_aenmLevels[i]);
+    }
+
+    /* Break the frame magic following the type byte. */
+    if (Buf.cb > 1)
+    {
+        Buf.pb[1] ^= 0x5a;
+        int rc = tstZipDecompStream(&Buf, pbDst);
+        if (RT_SUCCESS(rc))
+            RTTestIFailed("decompressing a corrupted stream succeeded");
+    }
+
+    RTMemFree(pbDst);
+    RTMemFree(Buf.pb);
+}
+
+
+/**
+ * Round trips the test input through RTZipBlockCompress and
+ * RTZipBlockDecompress, then checks that corrupted blocks fail to
+ * decompress.
+ */
+static void tstZipBlock(RTZIPTYPE enmType, const char *pszType)
+{
+    RTTestISubF("%s block", pszType);
+
+    static const RTZIPLEVEL s_aenmLevels[] = { RTZIPLEVEL_FAST, RTZIPLEVEL_DEFAULT, RTZIPLEVEL_MAX };
+    size_t const cbComp = TST_INPUT_SIZE * 2;
+    uint8_t *pbComp = (uint8_t *)RTMemAlloc(cbComp);
+    uint8_t *pbDst  = (uint8_t *)RTMemAlloc(TST_INPUT_SIZE);
+    RTTESTI_CHECK_RETV(pbComp && pbDst);
+
+    size_t cbCompActual = 0;
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aenmLevels); i++)
+    {
+        int rc;
+        RTTESTI_CHECK_RC_BREAK(rc = RTZipBlockCompress(enmType, s_aenmLevels[i], 0 /*fFlags*/, g_abInput, TST_INPUT_SIZE,
+                                                       pbComp, cbComp, &cbCompActual), VINF_SUCCESS);
+        RTTESTI_CHECK(cbCompActual > 0 && cbCompActual < TST_INPUT_SIZE);
+
+        size_t cbSrcActual = 0;
+        size_t cbDstActual = 0;
+        memset(pbDst, 0xff, TST_INPUT_SIZE);
+        RTTESTI_CHECK_RC(rc = RTZipBlockDecompress(enmType, 0 /*fFlags*/, pbComp, cbCompActual, &cbSrcActual,
+                                                   pbDst, TST_INPUT_SIZE, &cbDstActual), VINF_SUCCESS);
+        if (RT_SUCCESS(rc))
+        {
+            RTTESTI_CHECK(cbSrcActual == cbCompActual);
+            RTTESTI_CHECK(cbDstActual == TST_INPUT_SIZE);
+            if (memcmp(pbDst, g_abInput, TST_INPUT_SIZE))
+                RTTestIFailed("level %d: the decompressed block differs from the input", s_aenmLevels[i]);
+        }
+    }
+
+    if (cbCompActual > 32)
+    {
+        /* Cut off the tail, the final literals run then points past the input. */
+        size_t cbDstActual = 0;
+        int rc = RTZipBlockDecompress(enmType, 0 /*fFlags*/, pbComp, cbCompActual - 16, NULL,
+                                      pbDst, TST_INPUT_SIZE, &cbDstActual);
+        if (RT_SUCCESS(rc))
+            RTTestIFailed("decompressing a truncated block succeeded");
+
+        /* An output buffer too small for the data must fail as well. */
+        rc = RTZipBlockDecompress(enmType, 0 /*fFlags*/, pbComp, cbCompActual, NULL,
+                                  pbDst, TST_INPUT_SIZE / 2, &cbDstActual);
+        if (RT_SUCCESS(rc))
+            RTTestIFailed("decompressing into a too small buffer succeeded");
+    }
+
+    RTMemFree(pbDst);
+    RTMemFree(pbComp);
+}
+
+#endif /* RTZIP_USE_ZSTD || RTZIP_USE_LZ4 */
+
+
 static void testFile(const char *pszFilename)
 {
     size_t  cbSrcActually = 0;
@@ -76,7 +277,18 @@ int main(int argc, char **argv)
     }
     else
     {
-        /** @todo testcase */
+#if defined(RTZIP_USE_ZSTD) || defined(RTZIP_USE_LZ4)
+        tstInitInput();
+#endif
+#ifdef RTZIP_USE_ZSTD
+        tstZipStream(RTZIPTYPE_ZSTD, "zstd");
+        tstZipBlock(RTZIPTYPE_ZSTD, "zstd");
+#endif
+#ifdef RTZIP_USE_LZ4
+        tstZipStream(RTZIPTYPE_LZ4, "lz4");
+        tstZipBlock(RTZIPTYPE_LZ4, "lz4");
+#endif
+        /** @todo testcase for the other types */
     }
 
     /*
@@ -1010,6 +1010,131 @@ void Benchmarks(RTTEST hTest)
 }
 
 
+/**
+ * Checks the conversions on ASCII runs broken by a non-ASCII character or a
+ * terminator at every position and source alignment.  This exercises the
+ * vectorized ASCII run paths in the string code.
+ */
+static void testAsciiRuns(RTTEST hTest)
+{
+    RTTestSub(hTest, "ASCII runs");
+
+    static char     s_szSrc[128 + 16];
+    static RTUTF16  s_wszSrc[128 + 16];
+    static RTUTF16  s_wszDst[128 + 16];
+    static char     s_szDst[256 + 16];
+
+    for (unsigned offAlign = 0; offAlign < 16; offAlign++)
+        for (unsigned cch = 0; cch < 80; cch++)
+            for (unsigned iSpecial = 0; iSpecial <= cch; iSpecial++)
+            {
+                /* UTF-8 -> UTF-16 with U+00E6 (2 bytes) at iSpecial. */
+                char *psz = &s_szSrc[offAlign];
+                unsigned off = 0;
+                for (unsigned i = 0; i < cch; i++)
+                    if (i == iSpecial)
+                    {
+                        psz[off++] = (char)0xc3;
+                        psz[off++] = (char)0xa6;
+                    }
+                    else
+                        psz[off++] = 'a' + i % 26;
+                psz[off] = '\0';
+
+                PRTUTF16 pwsz = &s_wszDst[0];
+                size_t   cwc  = 0;
+                int rc = RTStrToUtf16Ex(psz, RTSTR_MAX, &pwsz, RT_ELEMENTS(s_wszDst), &cwc);
+                RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+                RTTESTI_CHECK_RETV(cwc == cch);
+                for (unsigned i = 0; i < cch; i++)
+                    RTTESTI_CHECK_MSG_RETV(pwsz[i] == (i == iSpecial ? 0xe6 : 'a' + i % 26),
+                                           ("offAlign=%u cch=%u iSpecial=%u i=%u wc=%#x\n", offAlign, cch, iSpecial, i, pwsz[i]));
+                RTTESTI_CHECK_RETV(pwsz[cch] == '\0');
+
+                /* Buffer overflow must still be detected right at the end of a run. */
+                if (cch > 0)
+                {
+                    pwsz = &s_wszDst[0];
+                    rc = RTStrToUtf16Ex(psz, RTSTR_MAX, &pwsz, cch, NULL);
+                    RTTESTI_CHECK_RC_RETV(rc, VERR_BUFFER_OVERFLOW);
+                }
+
+                /* UTF-16 -> UTF-8, the same string back. */
+                PRTUTF16 pwszSrc = &s_wszSrc[offAlign / 2];
+                memcpy(pwszSrc, s_wszDst, (cch + 1) * sizeof(RTUTF16));
+                char  *pszDst = &s_szDst[0];
+                size_t cchDst = 0;
+                rc = RTUtf16ToUtf8Ex(pwszSrc, RTSTR_MAX, &pszDst, RT_ELEMENTS(s_szDst), &cchDst);
+                RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+                RTTESTI_CHECK_MSG_RETV(cchDst == off && !memcmp(pszDst, psz, off + 1),
+                                       ("offAlign=%u cch=%u iSpecial=%u\n", offAlign, cch, iSpecial));
+
+                /* Length limited. */
+                size_t cchLen = 0;
+                rc = RTUtf16CalcUtf8LenEx(pwszSrc, iSpecial, &cchLen);
+                RTTESTI_CHECK_RC_RETV(rc, VINF_SUCCESS);
+                RTTESTI_CHECK_RETV(cchLen == iSpecial);
+            }
+
+    RTTestSubDone(hTest);
+}
+
+
+/**
+ * Benchmarks the conversions on paths typical for a shared folder directory
+ * listing, which are mostly ASCII.
+ */
+static void BenchmarksPaths(RTTEST hTest)
+{
+    RTTestSub(hTest, "Path benchmarks");
+
+    static char     s_aszPaths[64][128];
+    static RTUTF16  s_awszPaths[64][128];
+    static RTUTF16  s_wszBuf[256];
+    static char     s_szBuf[512];
+    for (unsigned i = 0; i < RT_ELEMENTS(s_aszPaths); i++)
+    {
+        if (i % 8)
+            RTStrPrintf(s_aszPaths[i], sizeof(s_aszPaths[i]), "/home/user/VirtualBox VMs/Shared/projects/dir%04u/source-file-%05u.cpp", i, i * 37);
+        else
+            RTStrPrintf(s_aszPaths[i], sizeof(s_aszPaths[i]), "/home/user/VirtualBox VMs/Shared/d\xc3\xa6ta/pr\xc3\xb8ve-%05u/r\xc3\xa9sum\xc3\xa9.txt", i);
+        PRTUTF16 pwsz = s_awszPaths[i];
+        RTTESTI_CHECK_RC_RETV(RTStrToUtf16Ex(s_aszPaths[i], RTSTR_MAX, &pwsz, RT_ELEMENTS(s_awszPaths[i]), NULL), VINF_SUCCESS);
+    }
+
+    uint32_t const cIterations = 20000;
+
+    uint64_t u64Start = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cIterations; i++)
+        for (unsigned j = 0; j < RT_ELEMENTS(s_aszPaths); j++)
+            RTStrValidateEncoding(s_aszPaths[j]);
+    uint64_t u64Elapsed = RTTimeNanoTS() - u64Start;
+    RTTestValue(hTest, "RTStrValidateEncoding", u64Elapsed / (cIterations * RT_ELEMENTS(s_aszPaths)), RTTESTUNIT_NS_PER_CALL);
+
+    u64Start = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cIterations; i++)
+        for (unsigned j = 0; j < RT_ELEMENTS(s_aszPaths); j++)
+        {
+            PRTUTF16 pwsz = s_wszBuf;
+            RTStrToUtf16Ex(s_aszPaths[j], RTSTR_MAX, &pwsz, RT_ELEMENTS(s_wszBuf), NULL);
+        }
+    u64Elapsed = RTTimeNanoTS() - u64Start;
+    RTTestValue(hTest, "RTStrToUtf16Ex", u64Elapsed / (cIterations * RT_ELEMENTS(s_aszPaths)), RTTESTUNIT_NS_PER_CALL);
+
+    u64Start = RTTimeNanoTS();
+    for (uint32_t i = 0; i < cIterations; i++)
+        for (unsigned j = 0; j < RT_ELEMENTS(s_awszPaths); j++)
+        {
+            char *psz = s_szBuf;
+            RTUtf16ToUtf8Ex(s_awszPaths[j], RTSTR_MAX, &psz, sizeof(s_szBuf), NULL);
+        }
+    u64Elapsed = RTTimeNanoTS() - u64Start;
+    RTTestValue(hTest, "RTUtf16ToUtf8Ex", u64Elapsed / (cIterations * RT_ELEMENTS(s_awszPaths)), RTTESTUNIT_NS_PER_CALL);
+
+    RTTestSubDone(hTest);
+}
+
+
 /**
  * Tests RTStrEnd
  */
@@ -1528,8 +1653,10 @@ int main()
     testUtf16Latin1(hTest);
     testNoTransation(hTest);
     testGetPut(hTest);
+    testAsciiRuns(hTest);
 
     Benchmarks(hTest);
+    BenchmarksPaths(hTest);
 
     /*
      * Summary
@@ -5791,6 +5791,38 @@ static DECLCALLBACK(void) vdIoCtxSyncComplete(void *pvUser1, void *pvUser2, int
     RTSemEventSignal(hEvent);
 }
 
+/**
+ * Reports the progress of a merge after a chunk has been processed.
+ *
+ * Walking the unallocated parts of a sparse image goes in block sized steps,
+ * so progress is only reported there when the percentage changes.  Copying
+ * reports every chunk to keep cancelling responsive.
+ *
+ * @returns VBox status code, failure if the operation should be cancelled.
+ * @param   pIfProgress     The progress interface, NULL if none.
+ * @param   uOffset         Offset up to which the merge got.
+ * @param   cbSize          Size of the merged range.
+ * @param   fCopied         Whether the chunk was actually copied.
+ * @param   puPercentLast   Where the last reported percentage is kept.
+ */
+static int vdMergeProgress(PVDINTERFACEPROGRESS pIfProgress, uint64_t uOffset, uint64_t cbSize,
+                           bool fCopied, unsigned *puPercentLast)
+{
+    int rc = VINF_SUCCESS;
+
+    if (pIfProgress && pIfProgress->pfnProgress)
+    {
+        unsigned uPercent = (unsigned)(uOffset * 99 / cbSize);
+        if (fCopied || uPercent != *puPercentLast)
+        {
+            *puPercentLast = uPercent;
+            rc = pIfProgress->pfnProgress(pIfProgress->Core.pvUser, uPercent);
+        }
+    }
+
+    return rc;
+}
+
 /**
  * Initializes HDD backends.
  *
@@ -7760,6 +7792,7 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
     int rc2;
     bool fLockWrite = false, fLockRead = false;
     void *pvBuf = NULL;
+    unsigned uPercentLast = 0;
 
     LogFlowFunc(("pDisk=%#p nImageFrom=%u nImageTo=%u pVDIfsOperation=%#p\n",
                  pDisk, nImageFrom, nImageTo, pVDIfsOperation));
@@ -7827,6 +7860,7 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
             do
             {
                 size_t cbThisRead = RT_MIN(VD_MERGE_BUFFER_SIZE, cbRemaining);
+                bool fCopied = false;
                 RTSGSEG SegmentBuf;
                 RTSGBUF SgBuf;
                 VDIOCTX IoCtx;
@@ -7870,6 +7904,7 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
                                              VDIOCTX_FLAGS_READ_UPDATE_CACHE, 0);
                         if (RT_FAILURE(rc))
                             break;
+                        fCopied = true;
                     }
                     else
                         rc = VINF_SUCCESS;
@@ -7884,16 +7919,9 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
                 uOffset += cbThisRead;
                 cbRemaining -= cbThisRead;
 
-                if (pIfProgress && pIfProgress->pfnProgress)
-                {
-                    /** @todo r=klaus: this can update the progress to the same
-                     * percentage over and over again if the image format makes
-                     * relatively small increments. */
-                    rc = pIfProgress->pfnProgress(pIfProgress->Core.pvUser,
-                                                  uOffset * 99 / cbSize);
-                    if (RT_FAILURE(rc))
-                        break;
-                }
+                rc = vdMergeProgress(pIfProgress, uOffset, cbSize, fCopied, &uPercentLast);
+                if (RT_FAILURE(rc))
+                    break;
             } while (uOffset < cbSize);
         }
         else
@@ -7956,6 +7984,7 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
             do
             {
                 size_t cbThisRead = RT_MIN(VD_MERGE_BUFFER_SIZE, cbRemaining);
+                bool fCopied = false;
                 RTSGSEG SegmentBuf;
                 RTSGBUF SgBuf;
                 VDIOCTX IoCtx;
@@ -7994,6 +8023,7 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
                                        cbThisRead, VDIOCTX_FLAGS_READ_UPDATE_CACHE);
                     if (RT_FAILURE(rc))
                         break;
+                    fCopied = true;
                 }
                 else
                     rc = VINF_SUCCESS;
@@ -8005,16 +8035,9 @@ VBOXDDU_DECL(int) VDMerge(PVBOXHDD pDisk, unsigned nImageFrom,
                 uOffset += cbThisRead;
                 cbRemaining -= cbThisRead;
 
-                if (pIfProgress && pIfProgress->pfnProgress)
-                {
-                    /** @todo r=klaus: this can update the progress to the same
-                     * percentage over and over again if the image format makes
-                     * relatively small increments. */
-                    rc = pIfProgress->pfnProgress(pIfProgress->Core.pvUser,
-                                                  uOffset * 99 / cbSize);
-                    if (RT_FAILURE(rc))
-                        break;
-                }
+                rc = vdMergeProgress(pIfProgress, uOffset, cbSize, fCopied, &uPercentLast);
+                if (RT_FAILURE(rc))
+                    break;
             } while (uOffset < cbSize);
 
             /* In case we set up a "write proxy" image above we must clear
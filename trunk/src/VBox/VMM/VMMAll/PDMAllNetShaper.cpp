@@ -22,15 +22,79 @@
 #define LOG_GROUP LOG_GROUP_NET_SHAPER
 #include <VBox/vmm/pdm.h>
 #include <VBox/log.h>
+#include <iprt/asm.h>
 #include <iprt/time.h>
 
 #include <VBox/vmm/pdmnetshaper.h>
 #include "PDMNetShaperInternal.h"
 
 
+/**
+ * Takes tokens from a bandwidth group and all its parents.
+ *
+ * The group lock is only held while refilling and charging this group and
+ * its ancestors, the locks being taken child first.
+ *
+ * @returns True if at least @a cbMin tokens were granted, false if not.
+ * @param   pBwGroup        The bandwidth group.
+ * @param   cbMin           The minimum number of tokens required.
+ * @param   cbMax           The number of tokens we'd like to get.
+ * @param   pcbGranted      Where to return the number of tokens granted,
+ *                          between @a cbMin and @a cbMax.
+ */
+static bool pdmNsBwGroupTakeTokens(PPDMNSBWGROUP pBwGroup, uint32_t cbMin, uint32_t cbMax, uint32_t *pcbGranted)
+{
+    int rc = PDMCritSectEnter(&pBwGroup->Lock, VERR_SEM_BUSY); AssertRC(rc);
+    if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
+    {
+        *pcbGranted = cbMin;
+        return true;
+    }
+
+    bool     fAllowed = true;
+    uint32_t cbGrant  = cbMax;
+    uint64_t tsNow    = 0;
+    uint32_t uTokens  = 0;
+    if (pBwGroup->cbPerSecMax)
+    {
+        /* Re-fill the bucket first */
+        tsNow = RTTimeSystemNanoTS();
+        uint32_t uTokensAdded = (tsNow - pBwGroup->tsUpdatedLast) * pBwGroup->cbPerSecMax / (1000 * 1000 * 1000);
+        uTokens = RT_MIN(pBwGroup->cbBucket, uTokensAdded + pBwGroup->cbTokensLast);
+
+        if (cbMin > uTokens)
+            fAllowed = false;
+        else
+            cbGrant = RT_MIN(cbMax, uTokens);
+        Log2(("pdmNsBwGroupTakeTokens: BwGroup=%#p{%s} cbMin=%u cbMax=%u uTokens=%u uTokensAdded=%u fAllowed=%RTbool\n",
+              pBwGroup, R3STRING(pBwGroup->pszNameR3), cbMin, cbMax, uTokens, uTokensAdded, fAllowed));
+    }
+    else
+        Log2(("pdmNsBwGroupTakeTokens: BwGroup=%#p{%s} disabled\n", pBwGroup, R3STRING(pBwGroup->pszNameR3)));
+
+    /* The parent limits apply on top of ours. */
+    PPDMNSBWGROUP pParent = pBwGroup->CTX_SUFF(pParent);
+    if (fAllowed && pParent)
+        fAllowed = pdmNsBwGroupTakeTokens(pParent, cbMin, cbGrant, &cbGrant);
+
+    if (fAllowed && pBwGroup->cbPerSecMax)
+    {
+        pBwGroup->tsUpdatedLast = tsNow;
+        pBwGroup->cbTokensLast  = uTokens - cbGrant;
+    }
+
+    rc = PDMCritSectLeave(&pBwGroup->Lock); AssertRC(rc);
+    *pcbGranted = cbGrant;
+    return fAllowed;
+}
+
+
 /**
  * Obtain bandwidth in a bandwidth group.
  *
+ * Tokens are taken from the group in batches and cached in the filter, so
+ * most calls are satisfied without touching the group lock.
+ *
  * @returns True if bandwidth was allocated, false if not.
  * @param   pFilter         Pointer to the filter that allocates bandwidth.
  * @param   cbTransfer      Number of bytes to allocate.
@@ -42,36 +106,44 @@ VMMDECL(bool) PDMNsAllocateBandwidth(PPDMNSFILTER pFilter, size_t cbTransfer)
         return true;
 
     PPDMNSBWGROUP pBwGroup = ASMAtomicReadPtrT(&pFilter->CTX_SUFF(pBwGroup), PPDMNSBWGROUP);
-    int rc = PDMCritSectEnter(&pBwGroup->Lock, VERR_SEM_BUSY); AssertRC(rc);
-    if (RT_UNLIKELY(rc == VERR_SEM_BUSY))
+    if (RT_UNLIKELY(!pBwGroup))
         return true;
+    AssertReturn(cbTransfer <= UINT32_MAX / 2, true);
+    uint32_t const cbNeeded = (uint32_t)cbTransfer;
 
-    bool fAllowed = true;
-    if (pBwGroup->cbPerSecMax)
+    /*
+     * Fast path: consume previously cached tokens.
+     */
+    uint32_t cbCached = ASMAtomicReadU32(&pFilter->cbTokensCached);
+    while (cbCached >= cbNeeded)
     {
-        /* Re-fill the bucket first */
-        uint64_t tsNow        = RTTimeSystemNanoTS();
-        uint32_t uTokensAdded = (tsNow - pBwGroup->tsUpdatedLast) * pBwGroup->cbPerSecMax / (1000 * 1000 * 1000);
-        uint32_t uTokens      = RT_MIN(pBwGroup->cbBucket, uTokensAdded + pBwGroup->cbTokensLast);
-
-        if (cbTransfer > uTokens)
+        if (ASMAtomicCmpXchgExU32(&pFilter->cbTokensCached, cbCached - cbNeeded, cbCached, &cbCached))
         {
-            fAllowed = false;
-            ASMAtomicWriteBool(&pFilter->fChoked, true);
-        }
-        else
-        {
-            pBwGroup->tsUpdatedLast = tsNow;
-            pBwGroup->cbTokensLast = uTokens - (uint32_t)cbTransfer;
+            Log3(("PDMNsAllocateBandwidth: pFilter=%#p cbTransfer=%u cached (%u left)\n", pFilter, cbNeeded, cbCached - cbNeeded));
+            return true;
         }
-        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} cbTransfer=%u uTokens=%u uTokensAdded=%u fAllowed=%RTbool\n",
-              pBwGroup, R3STRING(pBwGroup->pszNameR3), cbTransfer, uTokens, uTokensAdded, fAllowed));
     }
-    else
-        Log2(("pdmNsAllocateBandwidth: BwGroup=%#p{%s} disabled fAllowed=%RTbool\n",
-              pBwGroup, R3STRING(pBwGroup->pszNameR3), fAllowed));
 
-    rc = PDMCritSectLeave(&pBwGroup->Lock); AssertRC(rc);
+    /*
+     * Slow path: take what's left in the cache and get the rest plus a
+     * batch for the next transfers from the group hierarchy.
+     */
+    cbCached = ASMAtomicXchgU32(&pFilter->cbTokensCached, 0);
+    uint32_t cbMin     = cbCached < cbNeeded ? cbNeeded - cbCached : 0;
+    uint32_t cbBatch   = pBwGroup->cbBucket / PDM_NETSHAPER_FILTER_CACHE_DIV;
+    uint32_t cbGranted = 0;
+    bool fAllowed = pdmNsBwGroupTakeTokens(pBwGroup, cbMin, cbMin + cbBatch, &cbGranted);
+    if (fAllowed)
+    {
+        uint32_t cbLeft = cbCached + cbGranted - cbNeeded;
+        if (cbLeft)
+            ASMAtomicAddU32(&pFilter->cbTokensCached, cbLeft);
+    }
+    else
+    {
+        if (cbCached)
+            ASMAtomicAddU32(&pFilter->cbTokensCached, cbCached);
+        ASMAtomicWriteBool(&pFilter->fChoked, true);
+    }
     return fAllowed;
 }
-
@@ -442,6 +442,7 @@ int pdmacFileAioMgrCreate(PPDMASYNCCOMPLETIONEPCLASSFILE pEpClass, PPPDMACEPFILE
             pAioMgrNew->enmMgrType = pEpClass->enmMgrTypeOverride;
 
         pAioMgrNew->msBwLimitExpired = RT_INDEFINITE_WAIT;
+        pAioMgrNew->fAioCtxFlags     = pEpClass->fAioCtxFlags;
 
         rc = RTSemEventCreate(&pAioMgrNew->EventSem);
         if (RT_SUCCESS(rc))
@@ -810,6 +811,7 @@ static DECLCALLBACK(int) pdmacFileInitialize(PPDMASYNCCOMPLETIONEPCLASS pClassGl
     {
         pEpClassFile->uBitmaskAlignment   = AioLimits.cbBufferAlignment ? ~((RTR3UINTPTR)AioLimits.cbBufferAlignment - 1) : RTR3UINTPTR_MAX;
         pEpClassFile->cReqsOutstandingMax = AioLimits.cReqsOutstandingMax;
+        pEpClassFile->fBufferedAsyncIo    = RT_BOOL(AioLimits.fFlags & RTFILEAIOLIMITS_F_BUFFERED_IO);
 
         if (pCfgNode)
         {
@@ -836,14 +838,20 @@ static DECLCALLBACK(int) pdmacFileInitialize(PPDMASYNCCOMPLETIONEPCLASS pClassGl
 
             LogRel(("AIOMgr: Default file backend is '%s'\n", pdmacFileBackendTypeToName(pEpClassFile->enmEpBackendDefault)));
 
-#ifdef RT_OS_LINUX
             if (   pEpClassFile->enmMgrTypeOverride == PDMACEPFILEMGRTYPE_ASYNC
-                && pEpClassFile->enmEpBackendDefault == PDMACFILEEPBACKEND_BUFFERED)
+                && pEpClassFile->enmEpBackendDefault == PDMACFILEEPBACKEND_BUFFERED
+                && !pEpClassFile->fBufferedAsyncIo)
             {
-                LogRel(("AIOMgr: Linux does not support buffered async I/O, changing to non buffered\n"));
+                LogRel(("AIOMgr: Host does not support buffered async I/O, changing to non buffered\n"));
                 pEpClassFile->enmEpBackendDefault = PDMACFILEEPBACKEND_NON_BUFFERED;
             }
-#endif
+
+            /* Whether the host should poll for submitted requests. */
+            bool fPollSubmissions = false;
+            rc = CFGMR3QueryBoolDef(pCfgNode, "PollSubmissions", &fPollSubmissions, false);
+            AssertLogRelRCReturn(rc, rc);
+            if (fPollSubmissions)
+                pEpClassFile->fAioCtxFlags |= RTFILEAIOCTX_FLAGS_POLL_SUBMISSIONS;
         }
         else
         {
@@ -957,10 +965,11 @@ static DECLCALLBACK(int) pdmacFileEpInitialize(PPDMASYNCCOMPLETIONENDPOINT pEndp
                 /* Downgrade to the buffered backend */
                 enmEpBackend = PDMACFILEEPBACKEND_BUFFERED;
 
-#ifdef RT_OS_LINUX
-                fFileFlags &= ~RTFILE_O_ASYNC_IO;
-                enmMgrType   = PDMACEPFILEMGRTYPE_SIMPLE;
-#endif
+                if (!pEpClassFile->fBufferedAsyncIo)
+                {
+                    fFileFlags &= ~RTFILE_O_ASYNC_IO;
+                    enmMgrType   = PDMACEPFILEMGRTYPE_SIMPLE;
+                }
             }
             RTFileClose(hFile);
         }
@@ -982,15 +991,17 @@ static DECLCALLBACK(int) pdmacFileEpInitialize(PPDMASYNCCOMPLETIONENDPOINT pEndp
          * without blocking the whole application.
          *
          * On Linux we have the same problem with cifs.
-         * Have to disable async I/O here too because it requires O_DIRECT.
+         * Have to disable async I/O here too because it requires O_DIRECT
+         * unless the host does buffered async I/O as well.
          */
         fFileFlags &= ~RTFILE_O_NO_CACHE;
         enmEpBackend = PDMACFILEEPBACKEND_BUFFERED;
 
-#ifdef RT_OS_LINUX
-        fFileFlags &= ~RTFILE_O_ASYNC_IO;
-        enmMgrType   = PDMACEPFILEMGRTYPE_SIMPLE;
-#endif
+        if (!pEpClassFile->fBufferedAsyncIo)
+        {
+            fFileFlags &= ~RTFILE_O_ASYNC_IO;
+            enmMgrType   = PDMACEPFILEMGRTYPE_SIMPLE;
+        }
 
         /* Open again. */
         rc = RTFileOpen(&pEpFile->hFile, pszUri, fFileFlags);
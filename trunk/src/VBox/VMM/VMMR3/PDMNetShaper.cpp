@@ -226,8 +226,11 @@ static void pdmNsBwGroupXmitPending(PPDMNSBWGROUP pBwGroup)
     Assert(RTCritSectIsOwner(&pBwGroup->pShaperR3->Lock));
     //LOCK_NETSHAPER(pShaper);
 
-    /* Check if the group is disabled. */
-    if (pBwGroup->cbPerSecMax == 0)
+    /* Check if the group and all its parents are disabled. */
+    PPDMNSBWGROUP pLimiting = pBwGroup;
+    while (pLimiting && pLimiting->cbPerSecMax == 0)
+        pLimiting = pLimiting->pParentR3;
+    if (!pLimiting)
         return;
 
     PPDMNSFILTER pFilter = pBwGroup->pFiltersHeadR3;
@@ -322,6 +325,7 @@ VMMR3_INT_DECL(int) PDMR3NsAttach(PUVM pUVM, PPDMDRVINS pDrvIns, const char *psz
 
     if (RT_SUCCESS(rc))
     {
+        ASMAtomicWriteU32(&pFilter->cbTokensCached, 0);
         PPDMNSBWGROUP pBwGroupOld = ASMAtomicXchgPtrT(&pFilter->pBwGroupR3, pBwGroupNew, PPDMNSBWGROUP);
         ASMAtomicWritePtr(&pFilter->pBwGroupR0, MMHyperR3ToR0(pUVM->pVM, pBwGroupNew));
         if (pBwGroupOld)
@@ -361,6 +365,7 @@ VMMR3_INT_DECL(int) PDMR3NsDetach(PUVM pUVM, PPDMDRVINS pDrvIns, PPDMNSFILTER pF
     PPDMNSBWGROUP pBwGroup = ASMAtomicXchgPtrT(&pFilter->pBwGroupR3, NULL, PPDMNSBWGROUP);
     if (pBwGroup)
         pdmNsBwGroupUnref(pBwGroup);
+    ASMAtomicWriteU32(&pFilter->cbTokensCached, 0);
 
     UNLOCK_NETSHAPER(pShaper);
     return VINF_SUCCESS;
@@ -405,6 +410,41 @@ VMMR3DECL(int) PDMR3NsBwGroupSetLimit(PUVM pUVM, const char *pszBwGroup, uint64_
 }
 
 
+/**
+ * Makes one bandwidth group a child of another, so that the parent limit
+ * applies to the sum of the traffic of all its children on top of their own
+ * limits (e.g. a per-VM limit inside a per-tenant limit).
+ *
+ * @returns VBox status code.
+ * @param   pShaper         The network shaper.
+ * @param   pszBwGroup      Name of the child bandwidth group.
+ * @param   pszParent       Name of the parent bandwidth group.
+ */
+static int pdmNsBwGroupSetParent(PPDMNETSHAPER pShaper, const char *pszBwGroup, const char *pszParent)
+{
+    PPDMNSBWGROUP pBwGroup = pdmNsBwGroupFindById(pShaper, pszBwGroup);
+    PPDMNSBWGROUP pParent  = pdmNsBwGroupFindById(pShaper, pszParent);
+    if (!pBwGroup || !pParent)
+    {
+        LogRel(("NetShaper: Parent bandwidth group '%s' of '%s' was not found\n", pszParent, pszBwGroup));
+        return VERR_NOT_FOUND;
+    }
+
+    /* Refuse loops, they would make PDMNsAllocateBandwidth recurse forever. */
+    for (PPDMNSBWGROUP pCur = pParent; pCur; pCur = pCur->pParentR3)
+        if (pCur == pBwGroup)
+        {
+            LogRel(("NetShaper: Making '%s' the parent of '%s' would create a loop\n", pszParent, pszBwGroup));
+            return VERR_INVALID_PARAMETER;
+        }
+
+    pBwGroup->pParentR3 = pParent;
+    pBwGroup->pParentR0 = MMHyperR3ToR0(pShaper->pVM, pParent);
+    LogFlow(("pdmNsBwGroupSetParent: '%s' -> '%s'\n", pszBwGroup, pszParent));
+    return VINF_SUCCESS;
+}
+
+
 /**
  * I/O thread for pending TX.
  *
@@ -527,6 +567,30 @@ int pdmR3NetShaperInit(PVM pVM)
                     if (RT_FAILURE(rc))
                         break;
                 }
+
+                /* Link up the hierarchy now that all groups exist. */
+                for (PCFGMNODE pCur = CFGMR3GetFirstChild(pCfgBwGrp); pCur && RT_SUCCESS(rc); pCur = CFGMR3GetNextChild(pCur))
+                {
+                    char *pszParent;
+                    int rc2 = CFGMR3QueryStringAlloc(pCur, "Parent", &pszParent);
+                    if (RT_SUCCESS(rc2))
+                    {
+                        size_t cbName = CFGMR3GetNameLen(pCur) + 1;
+                        char *pszBwGrpId = (char *)RTMemAllocZ(cbName);
+                        if (pszBwGrpId)
+                        {
+                            rc = CFGMR3GetName(pCur, pszBwGrpId, cbName);
+                            if (RT_SUCCESS(rc))
+                                rc = pdmNsBwGroupSetParent(pShaper, pszBwGrpId, pszParent);
+                            RTMemFree(pszBwGrpId);
+                        }
+                        else
+                            rc = VERR_NO_MEMORY;
+                        MMR3HeapFree(pszParent);
+                    }
+                    else if (rc2 != VERR_CFGM_VALUE_NOT_FOUND)
+                        rc = rc2;
+                }
             }
 
             if (RT_SUCCESS(rc))
@@ -155,6 +155,8 @@ typedef struct PDMACEPFILEMGR
     RTTHREAD                               Thread;
     /** The async I/O context for this manager. */
     RTFILEAIOCTX                           hAioCtx;
+    /** Flags to create the async I/O context with (RTFILEAIOCTX_FLAGS_*). */
+    uint32_t                               fAioCtxFlags;
     /** Flag whether the I/O manager was woken up. */
     volatile bool                          fWokenUp;
     /** List of endpoints assigned to this manager. */
@@ -269,6 +271,11 @@ typedef struct PDMASYNCCOMPLETIONEPCLASSFILE
     uint32_t                            cReqsOutstandingMax;
     /** Bitmask for checking the alignment of a buffer. */
     RTR3UINTPTR                         uBitmaskAlignment;
+    /** Flags for the async I/O contexts of the managers (RTFILEAIOCTX_FLAGS_*). */
+    uint32_t                            fAioCtxFlags;
+    /** Flag whether the host does async I/O on files not opened with
+     *  RTFILE_O_NO_CACHE (RTFILEAIOLIMITS_F_BUFFERED_IO). */
+    bool                                fBufferedAsyncIo;
     /** Flag whether the out of resources warning was printed already. */
     bool                                fOutOfResourcesWarningPrinted;
 #ifdef PDM_ASYNC_COMPLETION_FILE_WITH_DELAY
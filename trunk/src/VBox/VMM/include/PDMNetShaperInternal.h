@@ -24,6 +24,11 @@ typedef struct PDMNSBWGROUP
     R3PTRTYPE(struct PDMNSBWGROUP *)            pNextR3;
     /** Pointer to the shared UVM structure. */
     R3PTRTYPE(struct PDMNETSHAPER *)            pShaperR3;
+    /** Pointer to the parent group whose limit applies on top of ours (ring-3),
+     * NULL if this is a top level group. */
+    R3PTRTYPE(struct PDMNSBWGROUP *)            pParentR3;
+    /** Pointer to the parent group (ring-0). */
+    R0PTRTYPE(struct PDMNSBWGROUP *)            pParentR0;
     /** Critical section protecting all members below. */
     PDMCRITSECT                                 Lock;
     /** Pointer to the first filter attached to this group. */
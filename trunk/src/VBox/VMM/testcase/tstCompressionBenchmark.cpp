@@ -394,11 +394,15 @@ int main(int argc, char **argv)
     {
         { 0, 0, 0, VINF_SUCCESS, false, RTZIPTYPE_STORE, RTZIPLEVEL_DEFAULT, "RTZip/Store"      },
         { 0, 0, 0, VINF_SUCCESS, false, RTZIPTYPE_LZF,   RTZIPLEVEL_DEFAULT, "RTZip/LZF"        },
+        { 0, 0, 0, VINF_SUCCESS, false, RTZIPTYPE_ZSTD,  RTZIPLEVEL_FAST,    "RTZip/Zstd"       },
+        { 0, 0, 0, VINF_SUCCESS, false, RTZIPTYPE_LZ4,   RTZIPLEVEL_DEFAULT, "RTZip/LZ4"        },
 /*      { 0, 0, 0, VINF_SUCCESS, false, RTZIPTYPE_ZLIB,  RTZIPLEVEL_DEFAULT, "RTZip/zlib"       }, - slow plus it randomly hits VERR_GENERAL_FAILURE atm. */
         { 0, 0, 0, VINF_SUCCESS, true,  RTZIPTYPE_STORE, RTZIPLEVEL_DEFAULT, "RTZipBlock/Store" },
         { 0, 0, 0, VINF_SUCCESS, true,  RTZIPTYPE_LZF,   RTZIPLEVEL_DEFAULT, "RTZipBlock/LZF"   },
         { 0, 0, 0, VINF_SUCCESS, true,  RTZIPTYPE_LZJB,  RTZIPLEVEL_DEFAULT, "RTZipBlock/LZJB"  },
         { 0, 0, 0, VINF_SUCCESS, true,  RTZIPTYPE_LZO,   RTZIPLEVEL_DEFAULT, "RTZipBlock/LZO"   },
+        { 0, 0, 0, VINF_SUCCESS, true,  RTZIPTYPE_ZSTD,  RTZIPLEVEL_FAST,    "RTZipBlock/Zstd"  },
+        { 0, 0, 0, VINF_SUCCESS, true,  RTZIPTYPE_LZ4,   RTZIPLEVEL_DEFAULT, "RTZipBlock/LZ4"   },
     };
     RTPrintf("tstCompressionBenchmark: TESTING..");
     for (uint32_t i = 0; i < cIterations; i++)